@@ -1426,6 +1426,61 @@ dds_get_topic_filter_extended (
   dds_entity_t topic,
   struct dds_topic_filter *filter);
 
+/** Binds a name used in a filter expression to a member of the topic's data type */
+typedef struct dds_filter_field {
+  const char *name;   /**< name as used in the expression, e.g., "pos.x" */
+  uint32_t offset;    /**< offset of the member in the sample, e.g., offsetof (T, pos.x) */
+} dds_filter_field_t;
+
+/**
+ * @brief Sets a filter expression on a topic, evaluated on the serialized samples
+ * received by readers using the topic and on the samples written by writers using
+ * the topic.
+ *
+ * The expression is a subset of the SQL used for DDS content-filtered topics:
+ * comparisons (=, <>, <, <=, >, >=), BETWEEN, LIKE (with % and _ as wildcards),
+ * combined with AND, OR, NOT and parentheses.  Operands are field names, numbers,
+ * strings in single quotes, TRUE, FALSE and parameters %0 .. %99 that are replaced
+ * by the corresponding entry in params (interpreted as a literal if possible, as a
+ * string otherwise).
+ *
+ * Field names are bound by fields to members of primitive, enumerated or string
+ * types, possibly in nested structs, by their offsets in the sample.  The type must
+ * not be mutable or have optional members.
+ *
+ * Readers evaluate the expression without deserializing the sample, reading only the
+ * referenced fields.  Samples that only contain a key (disposes, unregisters) always
+ * pass.  If a filter function is also set, a sample must pass both.
+ *
+ * Like the filter functions, this is not thread-safe with respect to data being
+ * read/written using readers/writers using this topic: set it before creating them.
+ *
+ * @param[in]  topic       The topic on which the filter is set.
+ * @param[in]  expression  The filter expression, or NULL to remove it.
+ * @param[in]  nfields     Number of entries in fields.
+ * @param[in]  fields      Field names and the members they refer to.
+ * @param[in]  nparams     Number of entries in params.
+ * @param[in]  params      Values of the parameters.
+ *
+ * @returns A dds_return_t indicating success or failure.
+ *
+ * @retval DDS_RETCODE_OK  Filter set successfully
+ * @retval DDS_RETCODE_BAD_PARAMETER  The topic handle is invalid, the expression is
+ *             invalid, refers to an undefined field or parameter or nests
+ *             parentheses and NOT more than 64 levels deep
+ * @retval DDS_RETCODE_UNSUPPORTED  Filter expressions are not supported for the
+ *             topic's type or a member referenced by the expression
+ * @retval DDS_RETCODE_OUT_OF_RESOURCES  The expression refers to more than 64 fields
+ */
+DDS_EXPORT dds_return_t
+dds_set_topic_filter_expression (
+  dds_entity_t topic,
+  const char *expression,
+  uint32_t nfields,
+  const dds_filter_field_t *fields,
+  uint32_t nparams,
+  const char * const *params);
+
 /**
  * @brief Creates a new instance of a DDS subscriber
  *
@@ -3515,7 +3570,7 @@ dds_read_next_wl(
  * @brief Return loaned samples to a reader or writer
  *
  * Used to release sample buffers returned by a read/take operation (a reader-loan)
- * or, in case shared memory is enabled, of the loan_sample operation (a writer-loan).
+ * or of the loan_sample operation (a writer-loan).
  *
  * When the application provides an empty buffer to a reader-loan, memory is allocated and
  * managed by DDS. By calling dds_return_loan, the reader-loan is released so that the buffer
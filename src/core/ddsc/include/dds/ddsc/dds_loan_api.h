@@ -26,7 +26,11 @@ extern "C" {
 
 /** @brief Check if a Loan is available to reader/writer
  * The loan is available if the shared memory is enabled and all the constraints
- * to enable shared memory are met and the type is fixed
+ * to enable shared memory are met and the type is fixed. For a writer that does
+ * not use shared memory, a loan is available if the serialized representation of
+ * the type is identical to its in-memory representation (fixed-size types of
+ * naturally aligned primitives without padding), in which case the loaned sample
+ * is written directly into the serialized data.
  * @note dds_loan_sample can be used if and only if
  * dds_is_loan_available returns true.
  *
@@ -69,14 +73,18 @@ DDS_EXPORT dds_return_t dds_loan_shared_memory_buffer(dds_entity_t writer,
 /** @brief Loan a sample from the writer.
  *
  * @note This function is to be used with dds_write to publish the loaned
- * sample.
+ * sample. Writing the sample (or disposing or unregistering it) consumes
+ * the loan, dds_return_loan cancels it.
  * @note The function can only be used if dds_is_loan_available is
  *       true for the writer.
+ * @note The contents of the loaned sample are undefined.
  *
  * @param[in] writer the writer to loan the buffer from
  * @param[out] sample the loaned sample
  *
- * @returns DDS_RETCODE_OK if successful, DDS_RETCODE_ERROR otherwise
+ * @returns DDS_RETCODE_OK if successful, DDS_RETCODE_UNSUPPORTED if loans are
+ * not available for the writer, DDS_RETCODE_OUT_OF_RESOURCES if too many loans
+ * are outstanding (without shared memory), DDS_RETCODE_ERROR otherwise
  */
 DDS_EXPORT dds_return_t dds_loan_sample(dds_entity_t writer, void **sample);
 
@@ -254,6 +254,7 @@ enum dds_stream_typecode_subtype {
 #define DDS_TOPIC_DISABLE_TYPECHECK             (1u << 3)
 #define DDS_TOPIC_FIXED_SIZE                    (1u << 4)
 #define DDS_TOPIC_FIXED_KEY_XCDR2               (1u << 5)   /* Set if the XCDR2 serialized key fits in 16 bytes */
+#define DDS_TOPIC_MARSHAL                       (1u << 6)   /* Set if m_marshal points to generated marshalling functions */
 
 
 #define DDS_TOPIC_TYPE_EXTENSIBILITY_MASK       0xc0000000
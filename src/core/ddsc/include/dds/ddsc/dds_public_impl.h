@@ -49,6 +49,38 @@ typedef struct dds_key_descriptor
 }
 dds_key_descriptor_t;
 
+/*
+  Straight-line marshalling functions for a fixed-layout type, generated
+  by idlc (-f marshal) alongside the op-codes. Every member of such a type
+  is at a fixed position in the serialized data, so these reduce to copies
+  at constant offsets. All functions operate on native-endian CDR that
+  starts at a position that is a multiple of 8 bytes; the serializer uses
+  the op-code interpreter whenever these conditions are not met.
+
+  m_size is the size of a serialized sample, m_keysize that of a serialized
+  key in the same representation. m_extract_key takes a serialized sample
+  in this representation and produces the key in XCDR2, the form used for
+  instance lookup.
+*/
+
+typedef struct dds_topic_marshal_xcdr
+{
+  uint32_t m_size;
+  uint32_t m_keysize;
+  void (*m_write) (unsigned char *dst, const void *sample);
+  void (*m_read) (void *sample, const unsigned char *src);
+  void (*m_write_key) (unsigned char *dst, const void *sample);
+  void (*m_extract_key) (unsigned char *dst, const unsigned char *src);
+}
+dds_topic_marshal_xcdr_t;
+
+typedef struct dds_topic_marshal
+{
+  dds_topic_marshal_xcdr_t m_xcdr1;
+  dds_topic_marshal_xcdr_t m_xcdr2;
+}
+dds_topic_marshal_t;
+
 /*
   Topic definitions are output by a preprocessor and have an
   implementation-private definition. The only thing exposed on the
@@ -66,6 +98,7 @@ typedef struct dds_topic_descriptor
   const uint32_t m_nops;               /* Number of ops in m_ops */
   const uint32_t * m_ops;              /* Marshalling meta data */
   const char * m_meta;                 /* XML topic description meta data */
+  const dds_topic_marshal_t * m_marshal; /* Generated marshalling functions (only if DDS_TOPIC_MARSHAL is set) */
 }
 dds_topic_descriptor_t;
 
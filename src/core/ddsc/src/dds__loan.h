@@ -15,6 +15,15 @@ bool deregister_pub_loan(dds_writer *wr, const void *pub_loan);
 
 #endif
 
+// Loans on the network path: the loaned sample is the payload of a serdata
+// that dds_write uses as-is. All require the writer to be locked.
+
+void *dds_writer_loan_net_sample(dds_writer *wr);
+
+struct ddsi_serdata *dds_writer_take_net_loan(dds_writer *wr, const void *sample);
+
+void dds_writer_release_net_loans(dds_writer *wr);
+
 #if defined(__cplusplus)
 }
 
@@ -29,6 +29,9 @@ DDS_EXPORT void dds_topic_unpin (struct dds_topic *tp) ddsrt_nonnull_all;
 DDS_EXPORT void dds_topic_defer_set_qos (struct dds_topic *tp) ddsrt_nonnull_all;
 DDS_EXPORT void dds_topic_allow_set_qos (struct dds_topic *tp) ddsrt_nonnull_all;
 
+/* Makes the DDSI reader advertise the topic's current filter expression in discovery */
+DDS_EXPORT void dds_topic_publish_filter (struct dds_topic *tp, struct dds_reader *rd) ddsrt_nonnull_all;
+
 #ifndef DDS_TOPIC_INTERN_FILTER_FN_DEFINED
 #define DDS_TOPIC_INTERN_FILTER_FN_DEFINED
 typedef bool (*dds_topic_intern_filter_fn) (const void * sample, void *ctx);
@@ -27,9 +27,10 @@
 #include "iceoryx_binding_c/publisher.h"
 #include "iceoryx_binding_c/subscriber.h"
 #include "shm__monitor.h"
-#define MAX_PUB_LOANS 8
 #endif
 
+#define MAX_PUB_LOANS 8
+
 #if defined (__cplusplus)
 extern "C" {
 #endif
@@ -43,6 +44,7 @@ struct dds_publisher;
 struct dds_subscriber;
 struct dds_topic;
 struct dds_ktopic;
+struct ddsi_filter_expr;
 struct dds_readcond;
 struct dds_guardcond;
 struct dds_statuscond;
@@ -361,6 +363,8 @@ typedef struct dds_writer {
   iox_pub_t m_iox_pub;
   void *m_iox_pub_loans[MAX_PUB_LOANS];
 #endif
+  /* Loans without shared memory: serdata whose payload is the loaned sample, protected by m_entity.m_mutex */
+  struct ddsi_serdata *m_net_loans[MAX_PUB_LOANS];
 
   /* Status metrics */
 
@@ -376,6 +380,7 @@ typedef struct dds_topic {
   struct ddsi_sertype *m_stype;
   struct dds_ktopic *m_ktopic; /* refc'd, constant */
   struct dds_topic_filter m_filter;
+  struct ddsi_filter_expr *m_filter_expr; /* NULL if no filter expression */
   dds_inconsistent_topic_status_t m_inconsistent_topic_status; /* Status metrics */
 } dds_topic;
 
@@ -25,6 +25,7 @@ struct dds_writer;
 struct whc *whc_new (struct ddsi_domaingv *gv, const struct whc_writer_info *wrinfo);
 struct whc_writer_info *whc_make_wrinfo (struct dds_writer *wr, const dds_qos_t *qos);
 void whc_free_wrinfo (struct whc_writer_info *);
+void whc_restore_from_store (struct whc *whc, struct dds_writer *wr);
 
 #if defined (__cplusplus)
 }
@@ -0,0 +1,72 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef DDS__WHC_STORE_H
+#define DDS__WHC_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+struct ddsi_domaingv;
+struct ddsi_serdata;
+struct ddsi_sertype;
+
+/* Append-only memory-mapped file holding the serialized samples of a writer
+   history cache, so that they are kept out of the heap and survive the
+   process.  Samples are identified by the offset of their record in the
+   file; all operations must be serialized by the caller (the WHC lock). */
+struct whc_store;
+
+/* Offset used for samples that are not in the store */
+#define WHC_STORE_NONE UINT64_MAX
+
+/* Opens (or creates) the store for the given topic, type and partitions in
+   the domain of gv in directory dir, returning NULL if it can't be used (e.g.,
+   it is in use by another writer).  Samples stored by a previous incarnation
+   become available via whc_store_restore_next. */
+struct whc_store *whc_store_new (const struct ddsi_domaingv *gv, const char *dir, const char *topic_name, const char *type_name, uint32_t npartitions, const char * const *partitions);
+
+/* Closes the store, leaving the file with its contents */
+void whc_store_free (struct whc_store *st);
+
+/* Appends a sample, returning its offset or WHC_STORE_NONE on failure */
+uint64_t whc_store_append (struct whc_store *st, const struct ddsi_serdata *sd);
+
+/* Constructs a new serdata of type from the sample stored at off */
+struct ddsi_serdata *whc_store_read (const struct whc_store *st, uint64_t off, const struct ddsi_sertype *type);
+
+/* Marks the sample at off as no longer needed: it won't be restored by a
+   later incarnation and it will be dropped by the next compaction */
+void whc_store_release (struct whc_store *st, uint64_t off);
+
+/* Returns the next sample stored by a previous incarnation, or NULL when
+   there are no more */
+struct ddsi_serdata *whc_store_restore_next (struct whc_store *st, const struct ddsi_sertype *type);
+
+/* Whether the file has grown sufficiently beyond the samples still needed to
+   merit compaction */
+bool whc_store_want_compact (const struct whc_store *st);
+
+/* Rewrites the file retaining only the samples whose offsets are returned by
+   successive calls to next (which returns NULL at the end), updating these
+   offsets in place.  On failure, the store is left unchanged. */
+typedef uint64_t *(*whc_store_next_t) (void *arg);
+bool whc_store_compact (struct whc_store *st, whc_store_next_t next, void *arg);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDS__WHC_STORE_H */
@@ -31,6 +31,10 @@ typedef enum {
 
 dds_return_t dds_write_impl (dds_writer *wr, const void *data, dds_time_t tstamp, dds_write_action action);
 dds_return_t dds_writecdr_impl (dds_writer *wr, struct nn_xpack *xp, struct ddsi_serdata *d, bool flush);
+
+/* Whether the topic filter (expression and/or function) accepts a serialized
+   sample, for writing samples that didn't go through dds_write */
+bool dds_evaluate_topic_filter_serdata (const dds_writer *wr, const struct ddsi_serdata *sd);
 dds_return_t dds_writecdr_local_orphan_impl (struct local_orphan_writer *lowr, struct nn_xpack *xp, struct ddsi_serdata *d);
 
 #if defined (__cplusplus)
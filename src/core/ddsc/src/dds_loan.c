@@ -7,6 +7,8 @@
 #include "dds__writer.h"
 
 #include "dds/ddsi/ddsi_sertype.h"
+#include "dds/ddsi/ddsi_serdata_default.h"
+#include "dds/ddsi/q_entity.h"
 
 #ifdef DDS_HAS_SHM
 #include "dds/ddsi/ddsi_shm_transport.h"
@@ -47,7 +49,6 @@ bool dds_is_shared_memory_available(const dds_entity_t entity) {
 
 bool dds_is_loan_available(const dds_entity_t entity) {
   bool ret = false;
-#ifdef DDS_HAS_SHM
   dds_entity *e;
 
   if (DDS_RETCODE_OK != dds_entity_pin(entity, &e)) {
@@ -55,6 +56,7 @@ bool dds_is_loan_available(const dds_entity_t entity) {
   }
 
   switch (dds_entity_kind(e)) {
+#ifdef DDS_HAS_SHM
   case DDS_KIND_READER: {
     struct dds_reader const *const rd = (struct dds_reader *)e;
     // only if SHM is enabled correctly (i.e. iox subscriber is initialized) and
@@ -62,11 +64,18 @@ bool dds_is_loan_available(const dds_entity_t entity) {
     ret = (rd->m_iox_sub != NULL) && (rd->m_topic->m_stype->fixed_size);
     break;
   }
+#endif
   case DDS_KIND_WRITER: {
     struct dds_writer const *const wr = (struct dds_writer *)e;
+#ifdef DDS_HAS_SHM
     // only if SHM is enabled correctly (i.e. iox publisher is initialized) and
     // the type is fixed
-    ret = (wr->m_iox_pub != NULL) && (wr->m_topic->m_stype->fixed_size);
+    if (wr->m_iox_pub != NULL)
+      ret = wr->m_topic->m_stype->fixed_size;
+    else
+#endif
+      // otherwise if the serialized form is the in-memory representation
+      ret = ddsi_serdata_default_loan_supported(wr->m_wr->type);
     break;
   }
   default:
@@ -74,8 +83,6 @@ bool dds_is_loan_available(const dds_entity_t entity) {
   }
 
   dds_entity_unpin(e);
-#endif
-  (void)entity;
   return ret;
 }
 
@@ -131,6 +138,39 @@ static void *dds_writer_loan_chunk(dds_writer *wr, size_t size) {
 }
 
 #endif
+
+void *dds_writer_loan_net_sample(dds_writer *wr) {
+  for (uint32_t i = 0; i < MAX_PUB_LOANS; ++i) {
+    if (!wr->m_net_loans[i]) {
+      void *sample;
+      if ((wr->m_net_loans[i] = ddsi_serdata_default_loan_new(wr->m_wr->type, &sample)) == NULL)
+        return NULL;
+      return sample;
+    }
+  }
+  return NULL;
+}
+
+struct ddsi_serdata *dds_writer_take_net_loan(dds_writer *wr, const void *sample) {
+  for (uint32_t i = 0; i < MAX_PUB_LOANS; ++i) {
+    struct ddsi_serdata *d = wr->m_net_loans[i];
+    if (d && ((const struct ddsi_serdata_default *)d)->data == sample) {
+      wr->m_net_loans[i] = NULL;
+      return d;
+    }
+  }
+  return NULL;
+}
+
+void dds_writer_release_net_loans(dds_writer *wr) {
+  for (uint32_t i = 0; i < MAX_PUB_LOANS; ++i) {
+    if (wr->m_net_loans[i]) {
+      ddsi_serdata_unref(wr->m_net_loans[i]);
+      wr->m_net_loans[i] = NULL;
+    }
+  }
+}
+
 // we do not register this loan (we do not need to for the use with
 // dds_writecdr)
 dds_return_t dds_loan_shared_memory_buffer(dds_entity_t writer, size_t size,
@@ -166,11 +206,6 @@ dds_return_t dds_loan_shared_memory_buffer(dds_entity_t writer, size_t size,
 }
 
 dds_return_t dds_loan_sample(dds_entity_t writer, void **sample) {
-#ifndef DDS_HAS_SHM
-  (void)writer;
-  (void)sample;
-  return DDS_RETCODE_UNSUPPORTED;
-#else
   dds_return_t ret;
   dds_writer *wr;
 
@@ -180,34 +215,48 @@ dds_return_t dds_loan_sample(dds_entity_t writer, void **sample) {
   if ((ret = dds_writer_lock(writer, &wr)) != DDS_RETCODE_OK)
     return ret;
 
-  // the loaning is only allowed if SHM is enabled correctly and if the type is
-  // fixed
-  if (wr->m_iox_pub && wr->m_topic->m_stype->fixed_size) {
-    *sample = dds_writer_loan_chunk(wr, wr->m_topic->m_stype->iox_size);
-    if (*sample == NULL) {
-      ret = DDS_RETCODE_ERROR; // could not obtain a sample
+#ifdef DDS_HAS_SHM
+  if (wr->m_iox_pub) {
+    // the loaning is only allowed if SHM is enabled correctly and if the type
+    // is fixed
+    if (wr->m_topic->m_stype->fixed_size) {
+      *sample = dds_writer_loan_chunk(wr, wr->m_topic->m_stype->iox_size);
+      if (*sample == NULL) {
+        ret = DDS_RETCODE_ERROR; // could not obtain a sample
+      }
+    } else {
+      ret = DDS_RETCODE_UNSUPPORTED;
     }
-  } else {
+    dds_writer_unlock(wr);
+    return ret;
+  }
+#endif
+
+  // without shared memory the sample is the payload of a serdata, which
+  // requires the type's serialized form to be its in-memory representation
+  if (!ddsi_serdata_default_loan_supported(wr->m_wr->type)) {
     ret = DDS_RETCODE_UNSUPPORTED;
+  } else if ((*sample = dds_writer_loan_net_sample(wr)) == NULL) {
+    ret = DDS_RETCODE_OUT_OF_RESOURCES; // all loans outstanding
   }
 
   dds_writer_unlock(wr);
   return ret;
-#endif
 }
 
 dds_return_t dds_return_writer_loan(dds_writer *writer, void **buf,
                                     int32_t bufsz) {
-#ifndef DDS_HAS_SHM
-  (void)writer;
-  (void)buf;
-  (void)bufsz;
-  return DDS_RETCODE_UNSUPPORTED;
-#else
+#ifdef DDS_HAS_SHM
   // Iceoryx publisher pointer is a constant so we can check outside the locks
   // returning loan is only valid if SHM is enabled correctly (i.e. iox
   // publisher is initialized) and the type is fixed
-  if (writer->m_iox_pub == NULL || !writer->m_topic->m_stype->fixed_size)
+  const bool iox = (writer->m_iox_pub != NULL);
+  if (iox && !writer->m_topic->m_stype->fixed_size)
+    return DDS_RETCODE_UNSUPPORTED;
+#else
+  const bool iox = false;
+#endif
+  if (!iox && !ddsi_serdata_default_loan_supported(writer->m_wr->type))
     return DDS_RETCODE_UNSUPPORTED;
   if (bufsz <= 0) {
     // analogous to long-standing behaviour for the reader case, where it makes
@@ -219,22 +268,32 @@ dds_return_t dds_return_writer_loan(dds_writer *writer, void **buf,
   ddsrt_mutex_lock(&writer->m_entity.m_mutex);
   dds_return_t ret = DDS_RETCODE_OK;
   for (int32_t i = 0; i < bufsz; i++) {
+    struct ddsi_serdata *d;
     if (buf[i] == NULL) {
       ret = DDS_RETCODE_BAD_PARAMETER;
       break;
-    } else if (!deregister_pub_loan(writer, buf[i])) {
+    }
+#ifdef DDS_HAS_SHM
+    else if (iox) {
+      if (!deregister_pub_loan(writer, buf[i])) {
+        ret = DDS_RETCODE_PRECONDITION_NOT_MET;
+        break;
+      }
+      release_iox_chunk(writer, buf[i]);
+    }
+#endif
+    else if ((d = dds_writer_take_net_loan(writer, buf[i])) == NULL) {
       ret = DDS_RETCODE_PRECONDITION_NOT_MET;
       break;
     } else {
-      release_iox_chunk(writer, buf[i]);
-      // return loan on the reader nulls buf[0], but here it makes more sense to
-      // clear all successfully returned ones: then, on failure, the application
-      // can figure out which ones weren't returned by looking for the first
-      // non-null pointer
-      buf[i] = NULL;
+      ddsi_serdata_unref(d);
     }
+    // return loan on the reader nulls buf[0], but here it makes more sense to
+    // clear all successfully returned ones: then, on failure, the application
+    // can figure out which ones weren't returned by looking for the first
+    // non-null pointer
+    buf[i] = NULL;
   }
   ddsrt_mutex_unlock(&writer->m_entity.m_mutex);
   return ret;
-#endif
 }
@@ -680,6 +680,10 @@ static dds_entity_t dds_create_reader_int (dds_entity_t participant_or_subscribe
   rd->m_entity.m_iid = get_entity_instance_id (&rd->m_entity.m_domain->gv, &rd->m_entity.m_guid);
   dds_entity_register_child (&sub->m_entity, &rd->m_entity);
 
+  // Only after registering the reader will changes to the topic's filter expression be
+  // pushed down to it, so picking up the current one must happen afterward
+  dds_topic_publish_filter (tp, rd);
+
   // After including the reader amongst the subscriber's children, the subscriber will start
   // propagating whether data_on_readers is materialised or not.  That doesn't cater for the cases
   // where pessimistically set it to materialized here, nor for the race where the it actually was
@@ -22,11 +22,13 @@
 
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/atomics.h"
 
 #include "dds__entity.h"
 #include "dds__reader.h"
 #include "dds/ddsc/dds_rhc.h"
 #include "dds__rhc_default.h"
+#include "dds/ddsi/ddsi_filter_expr.h"
 #include "dds/ddsi/ddsi_tkmap.h"
 #include "dds/ddsrt/hopscotch.h"
 #include "dds/ddsrt/avl.h"
@@ -150,6 +152,32 @@
    which then runs over the array of attached read conditions and updates
    the trigger. It returns whether or not a trigger changed
    from 0 to 1, as this indicates the attached waitsets must be signalled.
+
+   LOCK-FREE STORE PATH
+   ====================
+
+   For the common case of a KEEP_LAST 1 history, BY_RECEPTION ordering,
+   SHARED ownership, no deadline, no resource limits and no read conditions,
+   the typical update is a plain write from the single live writer of an
+   instance.  The only effect of that is replacing the sample (or adding it
+   if the instance is empty, which without resource limits can't fail), and
+   so for readers with this profile "store" first tries to deposit the sample
+   in a per-instance atomic "pending" slot without taking the lock.
+
+   Instances eligible for this (one live writer, not disposed, no invalid
+   sample, no lifespan) are published in a small direct-mapped cache indexed
+   by instance id, and the first sample deposited in an empty slot also puts
+   the instance on a lock-free list of instances with pending samples.  Any
+   operation that takes the lock and inspects the history (read, take,
+   lock_samples) first merges these pending samples using the regular store
+   logic, so all of the above continues to describe the state.
+
+   Everything else goes through the regular path, which first removes the
+   instance from the cache, waits for stores that may still be using that
+   cache entry to complete, merges pending samples and then, once the update is done, puts
+   the instance back in the cache if it still qualifies.  Operations that
+   may affect all instances (unregistering a writer, adding a condition)
+   empty the cache entirely.
 */
 
 /* FIXME: tkmap should perhaps retain data with timestamp set to invalid
@@ -278,10 +306,26 @@ struct rhc_instance {
 #ifdef DDS_HAS_DEADLINE_MISSED
   struct deadline_elem deadline; /* element in deadline missed administration */
 #endif
+  struct rhc_instance_fastpath *fp; /* lock-free store state, allocated on first use */
   struct ddsi_tkmap_instance *tk;/* backref into TK for unref'ing */
   struct rhc_sample a_sample;  /* pre-allocated storage for 1 sample */
 };
 
+#define FASTPATH_CACHE_SIZE 256
+
+struct rhc_fastpath_slot {
+  ddsrt_atomic_voidp_t inst;         /* instance accepting lock-free stores (struct rhc_instance *) */
+  ddsrt_atomic_uint32_t inflight;    /* # lock-free stores in progress that may be using inst */
+};
+
+struct rhc_instance_fastpath {
+  ddsrt_atomic_voidp_t pending;      /* sample stored lock-free but not yet merged (struct ddsi_serdata *) */
+  ddsrt_atomic_uint32_t queued;      /* whether instance is on the list of instances with a pending sample */
+  struct rhc_instance *next_pending; /* link in that list */
+  struct ddsi_writer_info wrinfo;    /* writer info of the one writer allowed to use the lock-free path */
+  bool cached;                       /* whether in rhc->fp_cache (protected by rhc->lock) */
+};
+
 typedef enum rhc_store_result {
   RHC_STORED,
   RHC_FILTERED,
@@ -333,6 +377,10 @@ struct dds_rhc_default {
 #ifdef DDS_HAS_DEADLINE_MISSED
   struct deadline_adm deadline; /* Deadline missed administration */
 #endif
+
+  bool fastpath;                     /* true if QoS allows lock-free stores (see above) */
+  ddsrt_atomic_voidp_t fp_pending;   /* list of instances with a pending sample (struct rhc_instance *) */
+  struct rhc_fastpath_slot *fp_cache; /* instances accepting lock-free stores, indexed by iid; NULL if !fastpath */
 };
 
 struct trigger_info_cmn {
@@ -363,6 +411,7 @@ struct trigger_info_post {
 };
 
 static const struct dds_rhc_ops dds_rhc_default_ops;
+static const struct dds_rhc_ops dds_rhc_default_fastpath_ops;
 
 static uint32_t qmask_of_sample (const struct rhc_sample *s)
 {
@@ -598,6 +647,216 @@ static dds_return_t dds_rhc_default_associate (struct dds_rhc *rhc, dds_reader *
   return DDS_RETCODE_OK;
 }
 
+/******************************
+ ******  LOCK-FREE STORE  ******
+ ******************************/
+
+static rhc_store_result_t rhc_store_locked (struct dds_rhc_default * __restrict rhc, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk, status_cb_data_t * __restrict cb_data, bool * __restrict nda);
+
+static void *fastpath_swap (ddsrt_atomic_voidp_t *x, void *v)
+{
+  void *old;
+  do {
+    old = ddsrt_atomic_ldvoidp (x);
+  } while (!ddsrt_atomic_casvoidp (x, old, v));
+  return old;
+}
+
+static void fastpath_wait_inflight (struct rhc_fastpath_slot *slot)
+{
+  /* On entry, slot->inst has been changed (with the lock held, so it can't
+     change again).  A store only increments "inflight" after it has seen a
+     non-null slot->inst and backs out if slot->inst changed in the meantime,
+     so the only stores that can keep us waiting are the ones that loaded
+     the old slot->inst before it was changed: at most one per thread, and
+     none of them ever blocks.  Their threads may get preempted, though, so
+     back off if it takes long */
+  uint32_t spins = 0;
+  ddsrt_atomic_fence ();
+  while (ddsrt_atomic_ld32 (&slot->inflight) != 0)
+  {
+    if (++spins > 1000)
+      dds_sleepfor (DDS_USECS (10));
+  }
+  ddsrt_atomic_fence ();
+}
+
+static void fastpath_merge_pending_locked (struct dds_rhc_default *rhc)
+{
+  struct rhc_instance *list, *inst;
+  if (ddsrt_atomic_ldvoidp (&rhc->fp_pending) == NULL)
+    return;
+  /* Instances get pushed in the front, reverse the list to process them in
+     the order in which they were first updated */
+  list = NULL;
+  inst = fastpath_swap (&rhc->fp_pending, NULL);
+  while (inst)
+  {
+    struct rhc_instance * const next = inst->fp->next_pending;
+    inst->fp->next_pending = list;
+    list = inst;
+    inst = next;
+  }
+  while ((inst = list) != NULL)
+  {
+    struct ddsi_serdata *sample;
+    list = inst->fp->next_pending;
+    /* Clearing "queued" before taking the sample means a concurrent store
+       either has its sample merged now or queues the instance again */
+    ddsrt_atomic_st32 (&inst->fp->queued, 0);
+    ddsrt_atomic_fence ();
+    if ((sample = fastpath_swap (&inst->fp->pending, NULL)) != NULL)
+    {
+      /* Data available has been signalled by the lock-free store already.
+         The sample replaces the existing one or goes into an empty instance
+         that is alive and has a single writer, and with no resource limits
+         and no conditions that can't be rejected nor change any status */
+      status_cb_data_t dummy_cb_data = { .raw_status_id = -1 };
+      bool dummy_nda = false;
+      TRACE ("rhc_store %"PRIx64",%"PRIx64" merge pending:", inst->iid, inst->fp->wrinfo.iid);
+      const rhc_store_result_t stored = rhc_store_locked (rhc, &inst->fp->wrinfo, sample, inst->tk, &dummy_cb_data, &dummy_nda);
+      assert (stored != RHC_REJECTED && dummy_cb_data.raw_status_id == -1);
+      (void) stored;
+      ddsi_serdata_unref (sample);
+    }
+  }
+}
+
+static void fastpath_disable_locked (struct dds_rhc_default *rhc, struct rhc_instance *inst)
+{
+  if (inst->fp && inst->fp->cached)
+  {
+    struct rhc_fastpath_slot * const slot = &rhc->fp_cache[inst->iid % FASTPATH_CACHE_SIZE];
+    assert (ddsrt_atomic_ldvoidp (&slot->inst) == inst);
+    ddsrt_atomic_stvoidp (&slot->inst, NULL);
+    fastpath_wait_inflight (slot);
+    inst->fp->cached = false;
+  }
+}
+
+static void fastpath_disable_all_locked (struct dds_rhc_default *rhc)
+{
+  if (rhc->fp_cache == NULL)
+    return;
+  for (uint32_t i = 0; i < FASTPATH_CACHE_SIZE; i++)
+  {
+    struct rhc_instance * const inst = ddsrt_atomic_ldvoidp (&rhc->fp_cache[i].inst);
+    if (inst != NULL)
+    {
+      assert (inst->fp->cached);
+      ddsrt_atomic_stvoidp (&rhc->fp_cache[i].inst, NULL);
+      inst->fp->cached = false;
+    }
+  }
+  for (uint32_t i = 0; i < FASTPATH_CACHE_SIZE; i++)
+    fastpath_wait_inflight (&rhc->fp_cache[i]);
+  fastpath_merge_pending_locked (rhc);
+}
+
+static void fastpath_prepare_store_locked (struct dds_rhc_default *rhc, uint64_t iid)
+{
+  struct rhc_instance dummy_instance, *inst;
+  dummy_instance.iid = iid;
+  if ((inst = ddsrt_hh_lookup (rhc->instances, &dummy_instance)) != NULL)
+    fastpath_disable_locked (rhc, inst);
+  fastpath_merge_pending_locked (rhc);
+}
+
+static void fastpath_maybe_enable_locked (struct dds_rhc_default *rhc, uint64_t iid, const struct ddsi_writer_info *wrinfo)
+{
+  struct rhc_instance dummy_instance, *inst, *old;
+  if (!rhc->fastpath || rhc->nconds > 0)
+    return;
+#ifdef DDS_HAS_LIFESPAN
+  if (wrinfo->lifespan_exp.v != DDS_NEVER)
+    return;
+#endif
+  dummy_instance.iid = iid;
+  if ((inst = ddsrt_hh_lookup (rhc->instances, &dummy_instance)) == NULL)
+    return;
+  if (inst->isdisposed || inst->inv_exists || inst->wrcount != 1 || !inst->wr_iid_islive || inst->wr_iid != wrinfo->iid)
+    return;
+  if (inst->fp == NULL)
+  {
+    inst->fp = ddsrt_malloc (sizeof (*inst->fp));
+    ddsrt_atomic_stvoidp (&inst->fp->pending, NULL);
+    ddsrt_atomic_st32 (&inst->fp->queued, 0);
+    inst->fp->next_pending = NULL;
+    inst->fp->cached = false;
+  }
+  assert (!inst->fp->cached);
+  inst->fp->wrinfo = *wrinfo;
+  inst->fp->cached = true;
+  ddsrt_atomic_fence_rel ();
+  struct rhc_fastpath_slot * const slot = &rhc->fp_cache[iid % FASTPATH_CACHE_SIZE];
+  if ((old = fastpath_swap (&slot->inst, inst)) != NULL)
+  {
+    /* a pending sample on the evicted instance remains queued */
+    assert (old != inst);
+    fastpath_wait_inflight (slot);
+    old->fp->cached = false;
+  }
+}
+
+static void fastpath_free_instance (struct rhc_instance *inst)
+{
+  if (inst->fp)
+  {
+    struct ddsi_serdata * const sample = ddsrt_atomic_ldvoidp (&inst->fp->pending);
+    if (sample)
+      ddsi_serdata_unref (sample);
+    ddsrt_free (inst->fp);
+    inst->fp = NULL;
+  }
+}
+
+static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk);
+
+static bool dds_rhc_default_fastpath_store (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk)
+{
+  struct dds_rhc_default * const __restrict rhc = (struct dds_rhc_default * __restrict) rhc_common;
+  if (sample->statusinfo == 0 && sample->kind == SDK_DATA &&
+#ifdef DDS_HAS_LIFESPAN
+      wrinfo->lifespan_exp.v == DDS_NEVER &&
+#endif
+      (rhc->reader == NULL || (rhc->reader->m_topic->m_filter.mode == DDS_TOPIC_FILTER_NONE && rhc->reader->m_topic->m_filter_expr == NULL)))
+  {
+    struct rhc_fastpath_slot * const slot = &rhc->fp_cache[tk->m_iid % FASTPATH_CACHE_SIZE];
+    struct rhc_instance *inst;
+    bool stored = false;
+    if ((inst = ddsrt_atomic_ldvoidp (&slot->inst)) == NULL)
+      return dds_rhc_default_store (rhc_common, wrinfo, sample, tk);
+    /* inst may only be dereferenced if it is still in the cache after
+       announcing the store, see fastpath_wait_inflight */
+    ddsrt_atomic_inc32 (&slot->inflight);
+    ddsrt_atomic_fence ();
+    if (ddsrt_atomic_ldvoidp (&slot->inst) == inst && inst->iid == tk->m_iid && inst->fp->wrinfo.iid == wrinfo->iid && inst->fp->wrinfo.auto_dispose == wrinfo->auto_dispose)
+    {
+      struct ddsi_serdata *old;
+      if ((old = fastpath_swap (&inst->fp->pending, ddsi_serdata_ref (sample))) != NULL)
+        ddsi_serdata_unref (old);
+      else if (ddsrt_atomic_cas32 (&inst->fp->queued, 0, 1))
+      {
+        struct rhc_instance *head;
+        do {
+          head = ddsrt_atomic_ldvoidp (&rhc->fp_pending);
+          inst->fp->next_pending = head;
+        } while (!ddsrt_atomic_casvoidp (&rhc->fp_pending, head, inst));
+      }
+      stored = true;
+    }
+    ddsrt_atomic_fence_rel ();
+    ddsrt_atomic_dec32 (&slot->inflight);
+    if (stored)
+    {
+      if (rhc->reader)
+        dds_reader_data_available_cb (rhc->reader);
+      return true;
+    }
+  }
+  return dds_rhc_default_store (rhc_common, wrinfo, sample, tk);
+}
+
 static void dds_rhc_default_set_qos (struct ddsi_rhc *rhc_common, const dds_qos_t * qos)
 {
   struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
@@ -613,6 +872,33 @@ static void dds_rhc_default_set_qos (struct ddsi_rhc *rhc_common, const dds_qos_
   rhc->history_depth = (qos->history.kind == DDS_HISTORY_KEEP_LAST) ? (uint32_t)qos->history.depth : ~0u;
   /* FIXME: updating deadline duration not yet supported
   rhc->deadline.dur = qos->deadline.deadline; */
+
+  /* Set before the reader becomes visible and these QoS are immutable, but
+     it costs nothing to handle a change */
+  const bool fastpath =
+    !rhc->xchecks && rhc->history_depth == 1 && !rhc->by_source_ordering && !rhc->exclusive_ownership &&
+    rhc->max_samples == DDS_LENGTH_UNLIMITED && rhc->max_instances == DDS_LENGTH_UNLIMITED
+#ifdef DDS_HAS_DEADLINE_MISSED
+    && rhc->deadline.dur == DDS_INFINITY
+#endif
+    ;
+  if (fastpath != rhc->fastpath)
+  {
+    ddsrt_mutex_lock (&rhc->lock);
+    if (fastpath && rhc->fp_cache == NULL)
+    {
+      rhc->fp_cache = ddsrt_malloc (FASTPATH_CACHE_SIZE * sizeof (*rhc->fp_cache));
+      for (uint32_t i = 0; i < FASTPATH_CACHE_SIZE; i++)
+      {
+        ddsrt_atomic_stvoidp (&rhc->fp_cache[i].inst, NULL);
+        ddsrt_atomic_st32 (&rhc->fp_cache[i].inflight, 0);
+      }
+    }
+    fastpath_disable_all_locked (rhc);
+    rhc->fastpath = fastpath;
+    rhc->common.common.ops = fastpath ? &dds_rhc_default_fastpath_ops : &dds_rhc_default_ops;
+    ddsrt_mutex_unlock (&rhc->lock);
+  }
 }
 
 static bool eval_predicate_sample (const struct dds_rhc_default *rhc, const struct ddsi_serdata *sample, bool (*pred) (const void *sample))
@@ -714,6 +1000,8 @@ static void inst_set_invsample (struct dds_rhc_default *rhc, struct rhc_instance
 static void free_empty_instance (struct rhc_instance *inst, struct dds_rhc_default *rhc)
 {
   assert (inst_is_empty (inst));
+  assert (inst->fp == NULL || (!inst->fp->cached && ddsrt_atomic_ldvoidp (&inst->fp->pending) == NULL));
+  fastpath_free_instance (inst);
   ddsi_tkmap_instance_unref (rhc->tkmap, inst->tk);
 #ifdef DDS_HAS_DEADLINE_MISSED
   if (inst->deadline_reg)
@@ -728,6 +1016,10 @@ static void free_instance_rhc_free (struct rhc_instance *inst, struct dds_rhc_de
   const bool was_empty = inst_is_empty (inst);
   struct trigger_info_qcond dummy_trig_qc;
 
+  /* no more stores at this point, pending sample can simply be dropped */
+  if (inst->fp)
+    inst->fp->cached = false;
+  fastpath_free_instance (inst);
   if (s)
   {
     do {
@@ -756,6 +1048,7 @@ static uint32_t dds_rhc_default_lock_samples (struct dds_rhc *rhc_common)
   struct dds_rhc_default * const rhc = (struct dds_rhc_default *) rhc_common;
   uint32_t no;
   ddsrt_mutex_lock (&rhc->lock);
+  fastpath_merge_pending_locked (rhc);
   no = rhc->n_vsamples + rhc->n_invsamples;
   if (no == 0)
   {
@@ -785,6 +1078,7 @@ static void dds_rhc_default_free (struct ddsi_rhc *rhc_common)
   deadline_fini (&rhc->deadline);
 #endif
   ddsrt_hh_free (rhc->instances);
+  ddsrt_free (rhc->fp_cache);
   lwregs_fini (&rhc->registrations);
   if (rhc->qcond_eval_samplebuf != NULL)
     ddsi_sertype_free_sample (rhc->type, rhc->qcond_eval_samplebuf, DDS_FREE_ALL);
@@ -969,6 +1263,8 @@ static bool content_filter_accepts (const dds_reader *reader, const struct ddsi_
   if (reader)
   {
     const struct dds_topic *tp = reader->m_topic;
+    if (tp->m_filter_expr && !ddsi_filter_expr_eval_serdata (tp->m_filter_expr, sample))
+      return false;
     switch (tp->m_filter.mode)
     {
       case DDS_TOPIC_FILTER_NONE:
@@ -1551,9 +1847,8 @@ static void update_viewstate_and_disposedness (struct dds_rhc_default * __restri
   delivered (true unless a reliable sample rejected).
 */
 
-static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk)
+static rhc_store_result_t rhc_store_locked (struct dds_rhc_default * __restrict rhc, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk, status_cb_data_t * __restrict cb_data, bool * __restrict nda)
 {
-  struct dds_rhc_default * const __restrict rhc = (struct dds_rhc_default * __restrict) rhc_common;
   const uint64_t wr_iid = wrinfo->iid;
   const uint32_t statusinfo = sample->statusinfo;
   const bool has_data = (sample->kind == SDK_DATA);
@@ -1564,28 +1859,12 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
   struct trigger_info_post post;
   struct trigger_info_qcond trig_qc;
   rhc_store_result_t stored;
-  status_cb_data_t cb_data;   /* Callback data for reader status callback */
-  bool notify_data_available;
 
-  TRACE ("rhc_store %"PRIx64",%"PRIx64" si %"PRIx32" has_data %d:", tk->m_iid, wr_iid, statusinfo, has_data);
-  if (!has_data && statusinfo == 0)
-  {
-    /* Write with nothing but a key -- I guess that would be a
-       register, which we do implicitly. (Currently DDSI2 won't allow
-       it through anyway.) */
-    TRACE (" ignore explicit register\n");
-    return true;
-  }
-
-  notify_data_available = false;
   dummy_instance.iid = tk->m_iid;
   stored = RHC_FILTERED;
-  cb_data.raw_status_id = -1;
 
   init_trigger_info_qcond (&trig_qc);
 
-  ddsrt_mutex_lock (&rhc->lock);
-
   inst = ddsrt_hh_lookup (rhc->instances, &dummy_instance);
   if (inst == NULL)
   {
@@ -1601,7 +1880,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
     else
     {
       TRACE (" new instance\n");
-      stored = rhc_store_new_instance (&inst, rhc, wrinfo, sample, tk, has_data, &cb_data, &trig_qc, &notify_data_available);
+      stored = rhc_store_new_instance (&inst, rhc, wrinfo, sample, tk, has_data, cb_data, &trig_qc, nda);
       if (stored != RHC_STORED)
         goto error_or_nochange;
 
@@ -1620,13 +1899,13 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
     get_trigger_info_pre (&pre, inst);
     if (has_data || is_dispose)
     {
-      dds_rhc_register (rhc, inst, wr_iid, wrinfo->auto_dispose, false, &notify_data_available);
-      if (notify_data_available)
+      dds_rhc_register (rhc, inst, wr_iid, wrinfo->auto_dispose, false, nda);
+      if (*nda)
       {
         if (inst->latest == NULL || inst->latest->isread)
         {
           const bool was_empty = inst_is_empty (inst);
-          inst_set_invsample (rhc, inst, &trig_qc, &notify_data_available);
+          inst_set_invsample (rhc, inst, &trig_qc, nda);
           if (was_empty)
             account_for_empty_to_nonempty_transition (rhc, inst);
         }
@@ -1634,10 +1913,10 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
     }
 
     /* notify sample lost */
-    cb_data.raw_status_id = (int) DDS_SAMPLE_LOST_STATUS_ID;
-    cb_data.extra = 0;
-    cb_data.handle = 0;
-    cb_data.add = true;
+    cb_data->raw_status_id = (int) DDS_SAMPLE_LOST_STATUS_ID;
+    cb_data->extra = 0;
+    cb_data->handle = 0;
+    cb_data->add = true;
   }
   else
   {
@@ -1665,14 +1944,14 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
          (i.e., out-of-memory), abort the operation and hope that the
          caller can still notify the application.  */
 
-      dds_rhc_register (rhc, inst, wr_iid, wrinfo->auto_dispose, true, &notify_data_available);
-      update_viewstate_and_disposedness (rhc, inst, has_data, not_alive, is_dispose, &notify_data_available);
+      dds_rhc_register (rhc, inst, wr_iid, wrinfo->auto_dispose, true, nda);
+      update_viewstate_and_disposedness (rhc, inst, has_data, not_alive, is_dispose, nda);
 
       /* Only need to add a sample to the history if the input actually is a sample. */
       if (has_data)
       {
         TRACE (" add_sample");
-        if (!add_sample (rhc, inst, wrinfo, sample, &cb_data, &trig_qc, &notify_data_available))
+        if (!add_sample (rhc, inst, wrinfo, sample, cb_data, &trig_qc, nda))
         {
           TRACE ("(reject)\n");
           stored = RHC_REJECTED;
@@ -1688,7 +1967,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
 
       /* If instance became disposed, add an invalid sample if there are no samples left */
       if ((bool) inst->isdisposed > old_isdisposed && (inst->latest == NULL || inst->latest->isread))
-        inst_set_invsample (rhc, inst, &trig_qc, &notify_data_available);
+        inst_set_invsample (rhc, inst, &trig_qc, nda);
 
       update_inst (inst, wrinfo, true, sample->timestamp);
 
@@ -1711,7 +1990,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
       }
     }
 
-    TRACE(" nda=%d\n", notify_data_available);
+    TRACE(" nda=%d\n", *nda);
     assert (rhc_check_counts_locked (rhc, false, false));
   }
 
@@ -1730,7 +2009,7 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
        mean an application reading "x" after the write and reading it
        again after the unregister will see a change in the
        no_writers_generation field? */
-    dds_rhc_unregister (rhc, inst, wrinfo, sample->timestamp, &post, &trig_qc, &notify_data_available);
+    dds_rhc_unregister (rhc, inst, wrinfo, sample->timestamp, &post, &trig_qc, nda);
   }
   else
   {
@@ -1740,6 +2019,37 @@ static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, cons
   postprocess_instance_update (rhc, &inst, &pre, &post, &trig_qc);
 
 error_or_nochange:
+  return stored;
+}
+
+static bool dds_rhc_default_store (struct ddsi_rhc * __restrict rhc_common, const struct ddsi_writer_info * __restrict wrinfo, struct ddsi_serdata * __restrict sample, struct ddsi_tkmap_instance * __restrict tk)
+{
+  struct dds_rhc_default * const __restrict rhc = (struct dds_rhc_default * __restrict) rhc_common;
+  const uint32_t statusinfo = sample->statusinfo;
+  const bool has_data = (sample->kind == SDK_DATA);
+  rhc_store_result_t stored;
+  status_cb_data_t cb_data;   /* Callback data for reader status callback */
+  bool notify_data_available;
+
+  TRACE ("rhc_store %"PRIx64",%"PRIx64" si %"PRIx32" has_data %d:", tk->m_iid, wrinfo->iid, statusinfo, has_data);
+  if (!has_data && statusinfo == 0)
+  {
+    /* Write with nothing but a key -- I guess that would be a
+       register, which we do implicitly. (Currently DDSI2 won't allow
+       it through anyway.) */
+    TRACE (" ignore explicit register\n");
+    return true;
+  }
+
+  notify_data_available = false;
+  cb_data.raw_status_id = -1;
+
+  ddsrt_mutex_lock (&rhc->lock);
+  if (rhc->fastpath)
+    fastpath_prepare_store_locked (rhc, tk->m_iid);
+  stored = rhc_store_locked (rhc, wrinfo, sample, tk, &cb_data, &notify_data_available);
+  if (rhc->fastpath)
+    fastpath_maybe_enable_locked (rhc, tk->m_iid, wrinfo);
   ddsrt_mutex_unlock (&rhc->lock);
 
   if (rhc->reader)
@@ -1776,6 +2086,7 @@ static void dds_rhc_default_unregister_wr (struct ddsi_rhc * __restrict rhc_comm
   const uint64_t wr_iid = wrinfo->iid;
 
   ddsrt_mutex_lock (&rhc->lock);
+  fastpath_disable_all_locked (rhc);
   TRACE ("rhc_unregister_wr_iid %"PRIx64",%d:\n", wr_iid, wrinfo->auto_dispose);
   for (inst = ddsrt_hh_iter_first (rhc->instances, &iter); inst; inst = ddsrt_hh_iter_next (&iter))
   {
@@ -1805,6 +2116,7 @@ static void dds_rhc_default_relinquish_ownership (struct ddsi_rhc * __restrict r
   struct rhc_instance *inst;
   struct ddsrt_hh_iter iter;
   ddsrt_mutex_lock (&rhc->lock);
+  fastpath_disable_all_locked (rhc);
   TRACE ("rhc_relinquish_ownership(%"PRIx64":\n", wr_iid);
   for (inst = ddsrt_hh_iter_first (rhc->instances, &iter); inst; inst = ddsrt_hh_iter_next (&iter))
   {
@@ -2196,6 +2508,7 @@ static int32_t read_w_qminv (struct dds_rhc_default * __restrict rhc, bool lock,
   {
     ddsrt_mutex_lock (&rhc->lock);
   }
+  fastpath_merge_pending_locked (rhc);
 
   TRACE ("read_w_qminv(%p,%p,%p,%"PRId32",%"PRIx32",%"PRIx64",%p) - inst %"PRIu32" nonempty %"PRIu32" disp %"PRIu32" nowr %"PRIu32" new %"PRIu32" samples %"PRIu32"+%"PRIu32" read %"PRIu32"+%"PRIu32"\n",
     (void *) rhc, (void *) values, (void *) info_seq, max_samples, qminv, handle, (void *) cond,
@@ -2241,6 +2554,7 @@ static int32_t take_w_qminv (struct dds_rhc_default * __restrict rhc, bool lock,
   {
     ddsrt_mutex_lock (&rhc->lock);
   }
+  fastpath_merge_pending_locked (rhc);
 
   TRACE ("take_w_qminv(%p,%p,%p,%"PRId32",%"PRIx32",%"PRIx64",%p) - inst %"PRIu32" nonempty %"PRIu32" disp %"PRIu32" nowr %"PRIu32" new %"PRIu32" samples %"PRIu32"+%"PRIu32" read %"PRIu32"+%"PRIu32"\n",
     (void*) rhc, (void*) values, (void*) info_seq, max_samples, qminv, handle, (void *) cond,
@@ -2367,6 +2681,9 @@ static bool dds_rhc_default_add_readcondition (struct dds_rhc *rhc_common, dds_r
 
   ddsrt_mutex_lock (&rhc->lock);
 
+  /* The lock-free store path is unaware of conditions */
+  fastpath_disable_all_locked (rhc);
+
   /* Allocate a slot in the condition bitmasks; return an error no more slots are available */
   if (cond->m_query.m_filter != 0)
   {
@@ -2906,3 +3223,21 @@ static const struct dds_rhc_ops dds_rhc_default_ops = {
   .lock_samples = dds_rhc_default_lock_samples,
   .associate = dds_rhc_default_associate
 };
+
+static const struct dds_rhc_ops dds_rhc_default_fastpath_ops = {
+  .rhc_ops = {
+    .store = dds_rhc_default_fastpath_store,
+    .unregister_wr = dds_rhc_default_unregister_wr,
+    .relinquish_ownership = dds_rhc_default_relinquish_ownership,
+    .set_qos = dds_rhc_default_set_qos,
+    .free = dds_rhc_default_free
+  },
+  .read = dds_rhc_default_read,
+  .take = dds_rhc_default_take,
+  .readcdr = dds_rhc_default_readcdr,
+  .takecdr = dds_rhc_default_takecdr,
+  .add_readcondition = dds_rhc_default_add_readcondition,
+  .remove_readcondition = dds_rhc_default_remove_readcondition,
+  .lock_samples = dds_rhc_default_lock_samples,
+  .associate = dds_rhc_default_associate
+};
@@ -25,6 +25,7 @@
 #include "dds__get_status.h"
 #include "dds__qos.h"
 #include "dds__builtin.h"
+#include "dds/ddsi/ddsi_filter_expr.h"
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/ddsi_entity_index.h"
 #include "dds/ddsi/q_thread.h"
@@ -214,6 +215,8 @@ static void dds_topic_close (dds_entity *e)
   ddsi_tl_meta_local_unref (&e->m_domain->gv, NULL, tp->m_stype);
 #endif
   ddsrt_free (tp->m_name);
+  if (tp->m_filter_expr)
+    ddsi_filter_expr_free (tp->m_filter_expr);
 
   ddsrt_mutex_lock (&pp->m_entity.m_mutex);
 
@@ -656,7 +659,9 @@ dds_entity_t dds_create_topic (dds_entity_t participant, const dds_topic_descrip
   st->serpool = ppent->m_domain->gv.serpool;
   st->type.size = desc->m_size;
   st->type.align = desc->m_align;
-  st->type.flagset = desc->m_flagset;
+  /* DDS_TOPIC_MARSHAL only says something about the descriptor, not about the type, and
+     must not affect the type identifier */
+  st->type.flagset = desc->m_flagset & ~DDS_TOPIC_MARSHAL;
   st->type.keys.nkeys = desc->m_nkeys;
   st->type.keys.keys = ddsrt_malloc (st->type.keys.nkeys  * sizeof (*st->type.keys.keys));
   for (uint32_t i = 0; i < st->type.keys.nkeys; i++)
@@ -672,6 +677,7 @@ dds_entity_t dds_create_topic (dds_entity_t participant, const dds_topic_descrip
     st->opt_size = dds_stream_check_optimize (&st->type);
     DDS_CTRACE (&ppent->m_domain->gv.logconfig, "Marshalling for type: %s is %soptimised\n", desc->m_typename, st->opt_size ? "" : "not ");
   }
+  st->marshal = (desc->m_flagset & DDS_TOPIC_MARSHAL) ? desc->m_marshal : NULL;
 
   ddsi_plist_init_empty (&plist);
   /* Set Topic meta data (for SEDP publication) */
@@ -977,6 +983,93 @@ dds_return_t dds_set_topic_filter_extended (dds_entity_t topic, const struct dds
   return DDS_RETCODE_OK;
 }
 
+void dds_topic_publish_filter (struct dds_topic *tp, struct dds_reader *rd)
+{
+  /* on entry: tp, rd pinned, no locks held; the topic lock is held while updating the DDSI
+     reader so that concurrent updates of the filter expression are applied in order */
+  nn_content_filter_property_t prop;
+  ddsrt_mutex_lock (&tp->m_entity.m_mutex);
+  if (tp->m_filter_expr)
+    ddsi_filter_expr_get_property (tp->m_filter_expr, tp->m_name, &prop);
+  thread_state_awake (lookup_thread_state (), &tp->m_entity.m_domain->gv);
+  update_reader_content_filter (rd->m_rd, tp->m_filter_expr ? &prop : NULL);
+  thread_state_asleep (lookup_thread_state ());
+  ddsrt_mutex_unlock (&tp->m_entity.m_mutex);
+}
+
+static void pushdown_filter (dds_entity *e, struct dds_topic *tp)
+{
+  /* on entry: e pinned, no locks held */
+  switch (dds_entity_kind (e))
+  {
+    case DDS_KIND_READER: {
+      dds_reader *rd = (dds_reader *) e;
+      if (rd->m_topic == tp)
+        dds_topic_publish_filter (tp, rd);
+      break;
+    }
+    case DDS_KIND_PARTICIPANT:
+    case DDS_KIND_SUBSCRIBER: {
+      struct dds_entity *c;
+      dds_instance_handle_t last_iid = 0;
+      ddsrt_mutex_lock (&e->m_mutex);
+      while ((c = ddsrt_avl_lookup_succ (&dds_entity_children_td, &e->m_children, &last_iid)) != NULL)
+      {
+        struct dds_entity *x;
+        last_iid = c->m_iid;
+        if (dds_entity_pin (c->m_hdllink.hdl, &x) == DDS_RETCODE_OK)
+        {
+          assert (x == c);
+          /* see dds_get_children for why "c" remains valid despite unlocking m_mutex */
+          ddsrt_mutex_unlock (&e->m_mutex);
+          pushdown_filter (c, tp);
+          ddsrt_mutex_lock (&e->m_mutex);
+          dds_entity_unpin (c);
+        }
+      }
+      ddsrt_mutex_unlock (&e->m_mutex);
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+dds_return_t dds_set_topic_filter_expression (dds_entity_t topic, const char *expression, uint32_t nfields, const dds_filter_field_t *fields, uint32_t nparams, const char * const *params)
+{
+  struct ddsi_filter_expr *fx = NULL;
+  dds_topic *t;
+  dds_return_t rc;
+
+  if ((nfields > 0 && fields == NULL) || (nparams > 0 && params == NULL))
+    return DDS_RETCODE_BAD_PARAMETER;
+
+  if ((rc = dds_topic_pin (topic, &t)) != DDS_RETCODE_OK)
+    return rc;
+  if (expression != NULL && (rc = ddsi_filter_expr_new (&fx, t->m_stype, expression, nfields, fields, nparams, params)) != DDS_RETCODE_OK)
+  {
+    dds_topic_unpin (t);
+    return rc;
+  }
+  ddsrt_mutex_lock (&t->m_entity.m_mutex);
+  if (t->m_filter_expr)
+    ddsi_filter_expr_free (t->m_filter_expr);
+  t->m_filter_expr = fx;
+  ddsrt_mutex_unlock (&t->m_entity.m_mutex);
+
+  /* existing readers advertise the new filter, readers created from now on pick it up
+     when they're created */
+  dds_entity *pp;
+  if (dds_entity_pin (t->m_entity.m_parent->m_hdllink.hdl, &pp) == DDS_RETCODE_OK)
+  {
+    pushdown_filter (pp, t);
+    dds_entity_unpin (pp);
+  }
+  dds_topic_unpin (t);
+  return DDS_RETCODE_OK;
+}
+
 dds_return_t dds_set_topic_filter_and_arg (dds_entity_t topic, dds_topic_filter_arg_fn filter, void *arg)
 {
   struct dds_topic_filter f = {
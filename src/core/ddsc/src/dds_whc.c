@@ -34,8 +34,10 @@
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/q_entity.h"
 #include "dds__whc.h"
+#include "dds__whc_store.h"
 #include "dds__entity.h"
 #include "dds__writer.h"
+#include "dds__write.h"
 
 #define USE_EHH 0
 
@@ -56,7 +58,8 @@ struct whc_node {
 #ifdef DDS_HAS_LIFESPAN
   struct lifespan_fhnode lifespan; /* fibheap node for lifespan */
 #endif
-  struct ddsi_serdata *serdata;
+  uint64_t store_off; /* offset in store, WHC_STORE_NONE if it is in serdata */
+  struct ddsi_serdata *serdata; /* NULL if it is in the store */
 };
 
 struct whc_intvnode {
@@ -85,10 +88,27 @@ struct whc_seq_entry {
 };
 #endif
 
+/* Ring of slots indexed by sequence number, covering [base, base + size),
+   used instead of the hash table for locating samples by sequence number if
+   so configured.  Samples with a sequence number below base (there can't be
+   any beyond base + size) are stored in the hash table, which is where they
+   go when the window slides forward because the ring is too sparsely
+   populated to be worth growing. */
+struct whc_seq_ring {
+  struct whc_node **slots;
+  seqno_t base;
+  uint32_t size; /* power of 2 */
+  uint32_t count; /* number of samples in slots */
+};
+
+#define WHC_RING_MINSIZE 32u
+#define WHC_RING_MAXSIZE (1u << 28)
+
 struct whc_writer_info {
   dds_writer * writer; /* can be NULL, eg in case of whc for built-in writers */
   unsigned is_transient_local: 1;
   unsigned has_deadline: 1;
+  unsigned is_durable: 1; /* TRANSIENT or PERSISTENT: may use the store */
   uint32_t hdepth; /* 0 = unlimited */
   uint32_t tldepth; /* 0 = disabled/unlimited (no need to maintain an index if KEEP_ALL <=> is_transient_local + tldepth=0) */
   uint32_t idxdepth; /* = max (hdepth, tldepth) */
@@ -114,6 +134,9 @@ struct whc_impl {
 #else
   struct ddsrt_hh *seq_hash;
 #endif
+  struct whc_seq_ring *seq_ring; /* NULL if using only seq_hash */
+  struct whc_store *store; /* NULL if all samples are kept in memory */
+  struct ddsi_sertype *store_type; /* for reconstructing samples from the store */
   struct ddsrt_hh *idx_hash;
   ddsrt_avl_tree_t seq;
 #ifdef DDS_HAS_LIFESPAN
@@ -145,7 +168,7 @@ DDSRT_STATIC_ASSERT (sizeof (struct whc_sample_iter_impl) <= sizeof (struct whc_
  */
 
 static struct whc_node *whc_findseq (const struct whc_impl *whc, seqno_t seq);
-static void insert_whcn_in_hash (struct whc_impl *whc, struct whc_node *whcn);
+static void insert_whcn_in_seqidx (struct whc_impl *whc, struct whc_node *whcn);
 static void whc_delete_one (struct whc_impl *whc, struct whc_node *whcn);
 static int compare_seq (const void *va, const void *vb);
 static void free_deferred_free_list (struct whc_node *deferred_free_list);
@@ -340,7 +363,7 @@ static void remove_whcn_from_hash (struct whc_impl *whc, struct whc_node *whcn)
 #endif
 }
 
-static struct whc_node *whc_findseq (const struct whc_impl *whc, seqno_t seq)
+static struct whc_node *whc_findseq_hash (const struct whc_impl *whc, seqno_t seq)
 {
 #if USE_EHH
   struct whc_seq_entry e = { .seq = seq }, *r;
@@ -355,6 +378,155 @@ static struct whc_node *whc_findseq (const struct whc_impl *whc, seqno_t seq)
 #endif
 }
 
+static struct whc_seq_ring *seq_ring_new (void)
+{
+  struct whc_seq_ring *r = ddsrt_malloc (sizeof (*r));
+  r->base = 1;
+  r->size = WHC_RING_MINSIZE;
+  r->count = 0;
+  r->slots = ddsrt_malloc (r->size * sizeof (*r->slots));
+  memset (r->slots, 0, r->size * sizeof (*r->slots));
+  return r;
+}
+
+static void seq_ring_free (struct whc_seq_ring *r)
+{
+  ddsrt_free (r->slots);
+  ddsrt_free (r);
+}
+
+static void seq_ring_resize (struct whc_seq_ring *r, uint32_t newsize)
+{
+  /* only possible if everything in the ring fits in the new size */
+  struct whc_node **slots = ddsrt_malloc (newsize * sizeof (*slots));
+  memset (slots, 0, newsize * sizeof (*slots));
+  for (uint32_t i = 0; i < r->size; i++)
+  {
+    if (r->slots[i])
+    {
+      assert (r->slots[i]->seq - r->base < newsize);
+      slots[(uint32_t) r->slots[i]->seq & (newsize - 1)] = r->slots[i];
+    }
+  }
+  ddsrt_free (r->slots);
+  r->slots = slots;
+  r->size = newsize;
+}
+
+static void seq_ring_make_room (struct whc_impl *whc, seqno_t seq)
+{
+  struct whc_seq_ring * const r = whc->seq_ring;
+  while (seq - r->base >= r->size)
+  {
+    if (r->count >= r->size / 2 && r->size < WHC_RING_MAXSIZE)
+      seq_ring_resize (r, 2 * r->size);
+    else
+    {
+      /* slide the window so that it ends at seq, anything that falls out
+         moves into the hash table; the scan is bounded by the size of the
+         ring and each sequence number is passed over at most once */
+      const seqno_t newbase = seq - r->size + 1;
+      for (seqno_t s = r->base; s < newbase && r->count > 0; s++)
+      {
+        struct whc_node ** const slot = &r->slots[(uint32_t) s & (r->size - 1)];
+        if (*slot)
+        {
+          insert_whcn_in_hash (whc, *slot);
+          *slot = NULL;
+          r->count--;
+        }
+      }
+      r->base = newbase;
+    }
+  }
+}
+
+static void insert_whcn_in_seqidx (struct whc_impl *whc, struct whc_node *whcn)
+{
+  /* precondition: whcn is not in index, whcn->seq > seq of any sample in index */
+  struct whc_seq_ring * const r = whc->seq_ring;
+  if (r == NULL)
+    insert_whcn_in_hash (whc, whcn);
+  else
+  {
+    assert (whcn->seq >= r->base);
+    seq_ring_make_room (whc, whcn->seq);
+    assert (r->slots[(uint32_t) whcn->seq & (r->size - 1)] == NULL);
+    r->slots[(uint32_t) whcn->seq & (r->size - 1)] = whcn;
+    r->count++;
+  }
+}
+
+static void remove_whcn_from_seqidx (struct whc_impl *whc, struct whc_node *whcn)
+{
+  /* precondition: whcn is in index */
+  struct whc_seq_ring * const r = whc->seq_ring;
+  if (r == NULL || whcn->seq < r->base)
+    remove_whcn_from_hash (whc, whcn);
+  else
+  {
+    assert (r->slots[(uint32_t) whcn->seq & (r->size - 1)] == whcn);
+    r->slots[(uint32_t) whcn->seq & (r->size - 1)] = NULL;
+    r->count--;
+  }
+}
+
+static void remove_range_from_seqidx (struct whc_impl *whc, struct whc_node *first, seqno_t last_seq)
+{
+  /* precondition: all sequence numbers first->seq .. last_seq are in the index,
+     and linked via next_seq */
+  struct whc_seq_ring * const r = whc->seq_ring;
+  struct whc_node *whcn = first;
+  if (r != NULL)
+  {
+    /* those below the ring are in the hash table, the remainder is
+       a contiguous range of slots (modulo wrapping around) */
+    while (whcn && whcn->seq < r->base && whcn->seq <= last_seq)
+    {
+      remove_whcn_from_hash (whc, whcn);
+      whcn = whcn->next_seq;
+    }
+    if (whcn && whcn->seq <= last_seq)
+    {
+      const uint32_t n = (uint32_t) (last_seq - whcn->seq + 1);
+      const uint32_t lo = (uint32_t) whcn->seq & (r->size - 1);
+      const uint32_t n1 = (n <= r->size - lo) ? n : r->size - lo;
+      assert (n <= r->count);
+      memset (&r->slots[lo], 0, n1 * sizeof (*r->slots));
+      memset (&r->slots[0], 0, (n - n1) * sizeof (*r->slots));
+      r->count -= n;
+      if (r->count == 0 && r->size > WHC_RING_MINSIZE)
+      {
+        /* release the memory after a burst, keeping base, which is all that
+           is needed for the hash table and the ring to remain consistent */
+        ddsrt_free (r->slots);
+        r->size = WHC_RING_MINSIZE;
+        r->slots = ddsrt_malloc (r->size * sizeof (*r->slots));
+        memset (r->slots, 0, r->size * sizeof (*r->slots));
+      }
+    }
+  }
+  else
+  {
+    while (whcn && whcn->seq <= last_seq)
+    {
+      remove_whcn_from_hash (whc, whcn);
+      whcn = whcn->next_seq;
+    }
+  }
+}
+
+static struct whc_node *whc_findseq (const struct whc_impl *whc, seqno_t seq)
+{
+  const struct whc_seq_ring * const r = whc->seq_ring;
+  if (r == NULL || seq < r->base)
+    return whc_findseq_hash (whc, seq);
+  else if (seq - r->base < r->size)
+    return r->slots[(uint32_t) seq & (r->size - 1)];
+  else
+    return NULL;
+}
+
 static struct whc_node *whc_findkey (const struct whc_impl *whc, const struct ddsi_serdata *serdata_key)
 {
   union {
@@ -425,7 +597,9 @@ struct whc_writer_info *whc_make_wrinfo (struct dds_writer *wr, const dds_qos_t
   assert (qos->present & QP_DURABILITY);
   assert (qos->present & QP_DURABILITY_SERVICE);
   wrinfo->writer = wr;
-  wrinfo->is_transient_local = (qos->durability.kind == DDS_DURABILITY_TRANSIENT_LOCAL);
+  /* TRANSIENT and PERSISTENT include TRANSIENT_LOCAL behaviour */
+  wrinfo->is_transient_local = (qos->durability.kind != DDS_DURABILITY_VOLATILE);
+  wrinfo->is_durable = (qos->durability.kind == DDS_DURABILITY_TRANSIENT || qos->durability.kind == DDS_DURABILITY_PERSISTENT);
   wrinfo->has_deadline = (qos->deadline.deadline != DDS_INFINITY);
   wrinfo->hdepth = (qos->history.kind == DDS_HISTORY_KEEP_ALL) ? 0 : (unsigned) qos->history.depth;
   if (!wrinfo->is_transient_local)
@@ -468,6 +642,17 @@ struct whc *whc_new (struct ddsi_domaingv *gv, const struct whc_writer_info *wri
 #else
   whc->seq_hash = ddsrt_hh_new (1, whc_node_hash, whc_node_eq);
 #endif
+  whc->seq_ring = (gv->config.whc_seq_index == DDSI_WHC_SEQIDX_RING) ? seq_ring_new () : NULL;
+  whc->store = NULL;
+  whc->store_type = NULL;
+  if (wrinfo->is_durable && wrinfo->writer != NULL && gv->config.whc_store_dir && *gv->config.whc_store_dir)
+  {
+    const struct dds_topic *tp = wrinfo->writer->m_topic;
+    const dds_qos_t *qos = wrinfo->writer->m_entity.m_qos;
+    const bool has_partitions = (qos->present & QP_PARTITION);
+    whc->store = whc_store_new (gv, gv->config.whc_store_dir, tp->m_name, tp->m_stype->type_name,
+                                has_partitions ? qos->partition.n : 0, has_partitions ? (const char * const *) qos->partition.strs : NULL);
+  }
 
 #ifdef DDS_HAS_LIFESPAN
   lifespan_init (gv, &whc->lifespan, offsetof(struct whc_impl, lifespan), offsetof(struct whc_node, lifespan), whc_sample_expired_cb);
@@ -498,7 +683,8 @@ struct whc *whc_new (struct ddsi_domaingv *gv, const struct whc_writer_info *wri
 
 static void free_whc_node_contents (struct whc_node *whcn)
 {
-  ddsi_serdata_unref (whcn->serdata);
+  if (whcn->serdata)
+    ddsi_serdata_unref (whcn->serdata);
   if (whcn->plist) {
     ddsi_plist_fini (whcn->plist);
     ddsrt_free (whcn->plist);
@@ -556,6 +742,12 @@ void whc_default_free (struct whc *whc_generic)
 #else
   ddsrt_hh_free (whc->seq_hash);
 #endif
+  if (whc->seq_ring)
+    seq_ring_free (whc->seq_ring);
+  if (whc->store)
+    whc_store_free (whc->store);
+  if (whc->store_type)
+    ddsi_sertype_unref (whc->store_type);
   ddsrt_mutex_destroy (&whc->lock);
   ddsrt_free (whc);
 }
@@ -753,6 +945,43 @@ static uint32_t whc_default_downgrade_to_volatile (struct whc *whc_generic, stru
   return cnt;
 }
 
+struct store_compact_iter {
+  const ddsrt_avl_tree_t *seq;
+  struct whc_intvnode *intv;
+  struct whc_node *whcn;
+};
+
+static uint64_t *store_compact_next (void *varg)
+{
+  struct store_compact_iter * const it = varg;
+  struct whc_node *whcn;
+  while (it->whcn == NULL)
+  {
+    if ((it->intv = ddsrt_avl_find_succ (&whc_seq_treedef, it->seq, it->intv)) == NULL)
+      return NULL;
+    it->whcn = it->intv->first;
+  }
+  whcn = it->whcn;
+  it->whcn = (whcn == it->intv->last) ? NULL : whcn->next_seq;
+  return &whcn->store_off;
+}
+
+static void compact_store (struct whc_impl *whc)
+{
+  /* moves all samples in the WHC to a new file */
+  struct store_compact_iter it;
+  it.seq = &whc->seq;
+  it.intv = ddsrt_avl_find_min (&whc_seq_treedef, &whc->seq);
+  it.whcn = it.intv->first;
+  (void) whc_store_compact (whc->store, store_compact_next, &it);
+}
+
+static void maybe_compact_store (struct whc_impl *whc)
+{
+  if (whc->store && whc_store_want_compact (whc->store))
+    compact_store (whc);
+}
+
 static size_t whcn_size (const struct whc_impl *whc, const struct whc_node *whcn)
 {
   size_t sz = ddsi_serdata_size (whcn->serdata);
@@ -788,11 +1017,14 @@ static void whc_delete_one_intv (struct whc_impl *whc, struct whc_intvnode **p_i
 #ifdef DDS_HAS_LIFESPAN
   lifespan_unregister_sample_locked (&whc->lifespan, &whcn->lifespan);
 #endif
+  if (whcn->store_off != WHC_STORE_NONE)
+    whc_store_release (whc->store, whcn->store_off);
 
-  /* Take it out of seqhash; deleting it from the list ordered on
-   sequence numbers is left to the caller (it has to be done unconditionally,
-   but remove_acked_messages defers it until the end or a skipped node). */
-  remove_whcn_from_hash (whc, whcn);
+  /* Take it out of the sequence number index; deleting it from the list
+   ordered on sequence numbers is left to the caller (it has to be done
+   unconditionally, but remove_acked_messages defers it until the end or a
+   skipped node). */
+  remove_whcn_from_seqidx (whc, whcn);
 
   /* We may have introduced a hole & have to split the interval
    node, or we may have nibbled of the first one, or even the
@@ -953,6 +1185,7 @@ static uint32_t whc_default_remove_acked_messages_noidx (struct whc_impl *whc, s
 
   *deferred_free_list = intv->first;
   ndropped = (uint32_t) (whcn->seq - intv->min + 1);
+  const seqno_t last_dropped_seq = whcn->seq;
 
   intv->first = whcn->next_seq;
   intv->min = max_drop_seq + 1;
@@ -975,9 +1208,12 @@ static uint32_t whc_default_remove_acked_messages_noidx (struct whc_impl *whc, s
 #ifdef DDS_HAS_LIFESPAN
     lifespan_unregister_sample_locked (&whc->lifespan, &whcn->lifespan);
 #endif
-    remove_whcn_from_hash (whc, whcn);
+    if (whcn->store_off != WHC_STORE_NONE)
+      whc_store_release (whc->store, whcn->store_off);
     assert (whcn->unacked);
   }
+  /* the dropped samples have consecutive sequence numbers */
+  remove_range_from_seqidx (whc, *deferred_free_list, last_dropped_seq);
 
   assert (ndropped <= whc->seq_size);
   whc->seq_size -= ndropped;
@@ -1152,6 +1388,7 @@ static uint32_t whc_default_remove_acked_messages (struct whc *whc_generic, seqn
     cnt = whc_default_remove_acked_messages_noidx (whc, max_drop_seq, deferred_free_list);
   else
     cnt = whc_default_remove_acked_messages_full (whc, max_drop_seq, deferred_free_list);
+  maybe_compact_store (whc);
   get_state_locked (whc, whcst);
   ddsrt_mutex_unlock (&whc->lock);
   return cnt;
@@ -1176,6 +1413,7 @@ static struct whc_node *whc_default_insert_seq (struct whc_impl *whc, seqno_t ma
   newn->last_rexmit_ts.v = 0;
   newn->rexmit_count = 0;
   newn->serdata = ddsi_serdata_ref (serdata);
+  newn->store_off = WHC_STORE_NONE;
   newn->next_seq = NULL;
   newn->prev_seq = whc->maxseq_node;
   if (newn->prev_seq)
@@ -1188,11 +1426,20 @@ static struct whc_node *whc_default_insert_seq (struct whc_impl *whc, seqno_t ma
   if (newn->unacked)
     whc->unacked_bytes += newn->size;
 
+  if (whc->store && serdata->kind != SDK_EMPTY && (newn->store_off = whc_store_append (whc->store, serdata)) != WHC_STORE_NONE)
+  {
+    /* it'll be reconstructed from the store when needed */
+    if (whc->store_type == NULL)
+      whc->store_type = ddsi_sertype_ref (serdata->type);
+    ddsi_serdata_unref (newn->serdata);
+    newn->serdata = NULL;
+  }
+
 #ifdef DDS_HAS_LIFESPAN
   newn->lifespan.t_expire = exp;
 #endif
 
-  insert_whcn_in_hash (whc, newn);
+  insert_whcn_in_seqidx (whc, newn);
 
   if (whc->open_intv->first == NULL)
   {
@@ -1380,20 +1627,25 @@ static int whc_default_insert (struct whc *whc_generic, seqno_t max_drop_seq, se
     }
     TRACE ("\n");
   }
+  maybe_compact_store (whc);
   ddsrt_mutex_unlock (&whc->lock);
   return 0;
 }
 
-static void make_borrowed_sample (struct whc_borrowed_sample *sample, struct whc_node *whcn)
+static bool make_borrowed_sample (const struct whc_impl *whc, struct whc_borrowed_sample *sample, struct whc_node *whcn)
 {
   assert (!whcn->borrowed);
+  if (whcn->store_off == WHC_STORE_NONE)
+    sample->serdata = whcn->serdata;
+  else if ((sample->serdata = whc_store_read (whc->store, whcn->store_off, whc->store_type)) == NULL)
+    return false;
   whcn->borrowed = 1;
   sample->seq = whcn->seq;
   sample->plist = whcn->plist;
-  sample->serdata = whcn->serdata;
   sample->unacked = whcn->unacked;
   sample->rexmit_count = whcn->rexmit_count;
   sample->last_rexmit_ts = whcn->last_rexmit_ts;
+  return true;
 }
 
 static bool whc_default_borrow_sample (const struct whc *whc_generic, seqno_t seq, struct whc_borrowed_sample *sample)
@@ -1405,10 +1657,7 @@ static bool whc_default_borrow_sample (const struct whc *whc_generic, seqno_t se
   if ((whcn = whc_findseq (whc, seq)) == NULL)
     found = false;
   else
-  {
-    make_borrowed_sample (sample, whcn);
-    found = true;
-  }
+    found = make_borrowed_sample (whc, sample, whcn);
   ddsrt_mutex_unlock ((ddsrt_mutex_t *)&whc->lock);
   return found;
 }
@@ -1422,10 +1671,7 @@ static bool whc_default_borrow_sample_key (const struct whc *whc_generic, const
   if ((whcn = whc_findkey (whc, serdata_key)) == NULL)
     found = false;
   else
-  {
-    make_borrowed_sample (sample, whcn);
-    found = true;
-  }
+    found = make_borrowed_sample (whc, sample, whcn);
   ddsrt_mutex_unlock ((ddsrt_mutex_t *)&whc->lock);
   return found;
 }
@@ -1447,6 +1693,9 @@ static void return_sample_locked (struct whc_impl *whc, struct whc_borrowed_samp
   {
     assert (whcn->borrowed);
     whcn->borrowed = 0;
+    /* a sample reconstructed from the store is owned by the borrower */
+    if (whcn->store_off != WHC_STORE_NONE)
+      ddsi_serdata_unref (sample->serdata);
     if (update_retransmit_info)
     {
       whcn->rexmit_count = sample->rexmit_count;
@@ -1493,10 +1742,40 @@ static bool whc_default_sample_iter_borrow_next (struct whc_sample_iter *opaque_
   if ((whcn = find_nextseq_intv (&intv, whc, seq)) == NULL)
     valid = false;
   else
+    valid = make_borrowed_sample (whc, sample, whcn);
+  ddsrt_mutex_unlock (&whc->lock);
+  return valid;
+}
+
+void whc_restore_from_store (struct whc *whc_generic, struct dds_writer *wr)
+{
+  struct whc_impl * const whc = (struct whc_impl *)whc_generic;
+  struct ddsi_serdata *sd;
+  uint32_t n = 0;
+  if (whc->store == NULL)
+    return;
+  /* writing the samples appends them to the store again, after which the
+     original records are dropped by compacting it */
+  ddsrt_mutex_lock (&whc->lock);
+  while ((sd = whc_store_restore_next (whc->store, wr->m_wr->type)) != NULL)
   {
-    make_borrowed_sample (sample, whcn);
-    valid = true;
+    ddsrt_mutex_unlock (&whc->lock);
+    /* the topic filter may have changed since the sample was written */
+    if (!dds_evaluate_topic_filter_serdata (wr, sd))
+      ddsi_serdata_unref (sd);
+    else
+    {
+      (void) dds_writecdr_impl (wr, wr->m_xp, sd, !wr->whc_batch);
+      n++;
+    }
+    ddsrt_mutex_lock (&whc->lock);
   }
+  if (n > 0)
+    compact_store (whc);
   ddsrt_mutex_unlock (&whc->lock);
-  return valid;
+  if (n > 0)
+  {
+    struct ddsi_domaingv * const gv = whc->gv;
+    GVLOG (DDS_LC_DISCOVERY, "writer "PGUIDFMT": restored %"PRIu32" samples from store\n", PGUID (wr->m_entity.m_guid), n);
+  }
 }
@@ -0,0 +1,455 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/io.h"
+#include "dds/ddsrt/mh3.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/iovec.h"
+#include "dds/ddsi/ddsi_serdata.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/q_log.h"
+#include "dds__whc_store.h"
+
+#if !defined _WIN32 && !LWIP_SOCKET
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* File layout: a header identifying the domain, topic, type and partitions
+   (writers that differ in any of these don't share a history), followed by records
+   that each consist of a fixed-size header and the serialized sample (as
+   obtained from ddsi_serdata_to_ser), padded to a multiple of 8 bytes.  The
+   magic number of a record is written last, so that after a crash the
+   contents can be recovered up to the first incomplete record.  Releasing a
+   sample replaces the magic number of its record, so that records that are
+   no longer needed are skipped when restoring even if the file hasn't been
+   compacted. */
+
+#define WHC_STORE_FILE_MAGIC "CDDSWHC"
+#define WHC_STORE_VERSION 2u
+#define WHC_STORE_REC_MAGIC 0x57484352u /* "WHCR" */
+#define WHC_STORE_REC_DEAD_MAGIC 0x57484344u /* "WHCD" */
+#define WHC_STORE_INITIAL_SIZE ((uint64_t) 1 << 20)
+#define WHC_STORE_COMPACT_MIN ((uint64_t) 1 << 20)
+
+struct whc_store_filehdr {
+  char magic[8];
+  uint32_t version;
+  uint32_t hdrsize; /* including names, multiple of 8 */
+  uint32_t domain_id;
+  uint32_t npartitions;
+  uint32_t names_len; /* topic, type and partition names, each including terminating 0 */
+  /* followed by topic, type and partition names */
+};
+
+struct whc_store_rec {
+  uint32_t magic;
+  uint32_t size; /* of serialized sample following the header */
+  uint32_t statusinfo;
+  uint32_t kind;
+  int64_t timestamp;
+};
+
+struct whc_store {
+  const struct ddsi_domaingv *gv;
+  char *path;
+  int fd;
+  unsigned char *base;
+  uint64_t mapsize; /* = file size */
+  uint64_t hdrsize;
+  uint64_t end; /* offset at which next record is appended */
+  uint64_t live_bytes; /* records appended and not yet released */
+  uint64_t restore_off; /* next record of previous incarnation */
+  uint64_t restore_end; /* end of records of previous incarnation */
+  uint64_t compact_threshold; /* don't try to compact until end exceeds this */
+};
+
+static uint64_t align8 (uint64_t x)
+{
+  return (x + 7) & ~(uint64_t) 7;
+}
+
+static uint64_t rec_total_size (uint32_t size)
+{
+  return align8 (sizeof (struct whc_store_rec) + size);
+}
+
+static uint64_t compact_threshold (uint64_t end)
+{
+  return (end > WHC_STORE_COMPACT_MIN / 2) ? 2 * end : WHC_STORE_COMPACT_MIN;
+}
+
+static struct whc_store_rec *rec_at (const struct whc_store *st, uint64_t off)
+{
+  return (struct whc_store_rec *) (st->base + off);
+}
+
+static bool valid_rec_at (const struct whc_store *st, uint64_t off, uint64_t end)
+{
+  if (end - off < sizeof (struct whc_store_rec))
+    return false;
+  const struct whc_store_rec *rec = rec_at (st, off);
+  return (rec->magic == WHC_STORE_REC_MAGIC || rec->magic == WHC_STORE_REC_DEAD_MAGIC) && rec_total_size (rec->size) <= end - off;
+}
+
+static bool map_file (struct whc_store *st, uint64_t size)
+{
+  void *base;
+  if (ftruncate (st->fd, (off_t) size) != 0)
+    return false;
+  if ((base = mmap (NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_SHARED, st->fd, 0)) == MAP_FAILED)
+    return false;
+  if (st->base)
+    munmap (st->base, (size_t) st->mapsize);
+  st->base = base;
+  st->mapsize = size;
+  return true;
+}
+
+static char *append_name (char *dst, const char *name)
+{
+  const size_t len = strlen (name) + 1;
+  memcpy (dst, name, len);
+  return dst + len;
+}
+
+static uint64_t make_header (struct whc_store_filehdr **hdr, uint32_t domain_id, const char *topic_name, const char *type_name, uint32_t npartitions, const char * const *partitions)
+{
+  /* no partitions is the same as the default partition */
+  static const char *default_partition = "";
+  if (npartitions == 0)
+  {
+    npartitions = 1;
+    partitions = &default_partition;
+  }
+  size_t names_len = strlen (topic_name) + 1 + strlen (type_name) + 1;
+  for (uint32_t i = 0; i < npartitions; i++)
+    names_len += strlen (partitions[i]) + 1;
+  const uint64_t hdrsize = align8 (sizeof (**hdr) + names_len);
+  *hdr = ddsrt_malloc ((size_t) hdrsize);
+  memset (*hdr, 0, (size_t) hdrsize);
+  memcpy ((*hdr)->magic, WHC_STORE_FILE_MAGIC, sizeof ((*hdr)->magic));
+  (*hdr)->version = WHC_STORE_VERSION;
+  (*hdr)->hdrsize = (uint32_t) hdrsize;
+  (*hdr)->domain_id = domain_id;
+  (*hdr)->npartitions = npartitions;
+  (*hdr)->names_len = (uint32_t) names_len;
+  char *names = (char *) (*hdr + 1);
+  names = append_name (names, topic_name);
+  names = append_name (names, type_name);
+  for (uint32_t i = 0; i < npartitions; i++)
+    names = append_name (names, partitions[i]);
+  return hdrsize;
+}
+
+/* Scans the existing contents, returns the offset following the last valid
+   record, or 0 if the file doesn't contain a matching header */
+static uint64_t scan_existing (struct whc_store *st, uint64_t fsize, const struct whc_store_filehdr *hdr)
+{
+  uint64_t off;
+  if (fsize < hdr->hdrsize || memcmp (st->base, hdr, hdr->hdrsize) != 0)
+    return 0;
+  off = hdr->hdrsize;
+  while (valid_rec_at (st, off, fsize))
+    off += rec_total_size (rec_at (st, off)->size);
+  return off;
+}
+
+struct whc_store *whc_store_new (const struct ddsi_domaingv *gv, const char *dir, const char *topic_name, const char *type_name, uint32_t npartitions, const char * const *partitions)
+{
+  struct whc_store *st;
+  struct whc_store_filehdr *hdr;
+  struct stat statbuf;
+  uint64_t fsize;
+
+  st = ddsrt_malloc (sizeof (*st));
+  st->gv = gv;
+  st->base = NULL;
+  st->mapsize = 0;
+  st->live_bytes = 0;
+  st->hdrsize = make_header (&hdr, gv->config.domainId, topic_name, type_name, npartitions, partitions);
+  {
+    /* the names go in the header, the file name only needs to be unique */
+    const uint32_t h0 = ddsrt_mh3 (hdr + 1, hdr->names_len, hdr->domain_id);
+    const uint32_t h1 = ddsrt_mh3 (hdr + 1, hdr->names_len, h0 ^ hdr->npartitions);
+    (void) ddsrt_asprintf (&st->path, "%s/%08"PRIx32"%08"PRIx32".whc", dir, h0, h1);
+  }
+
+  if ((st->fd = open (st->path, O_RDWR | O_CREAT, 0644)) < 0)
+  {
+    GVWARNING ("whc store %s for topic %s: open failed (%d)\n", st->path, topic_name, errno);
+    goto err_open;
+  }
+  if (flock (st->fd, LOCK_EX | LOCK_NB) != 0)
+  {
+    GVWARNING ("whc store %s for topic %s: in use by another writer, keeping history in memory\n", st->path, topic_name);
+    goto err_lock;
+  }
+  if (fstat (st->fd, &statbuf) != 0)
+    goto err_map;
+  fsize = (uint64_t) statbuf.st_size;
+  if (!map_file (st, (fsize > WHC_STORE_INITIAL_SIZE) ? fsize : WHC_STORE_INITIAL_SIZE))
+  {
+    GVWARNING ("whc store %s for topic %s: mapping failed (%d)\n", st->path, topic_name, errno);
+    goto err_map;
+  }
+
+  if ((st->end = scan_existing (st, fsize, hdr)) == 0)
+  {
+    if (fsize > 0)
+      GVWARNING ("whc store %s for topic %s: ignoring existing contents\n", st->path, topic_name);
+    memcpy (st->base, hdr, st->hdrsize);
+    st->end = st->hdrsize;
+  }
+  st->restore_off = st->hdrsize;
+  st->restore_end = st->end;
+  /* anything beyond the last valid record is garbage that might otherwise be
+     mistaken for valid records after appending new ones */
+  memset (st->base + st->end, 0, (size_t) (st->mapsize - st->end));
+  st->compact_threshold = compact_threshold (st->end);
+  ddsrt_free (hdr);
+  return st;
+
+err_map:
+  if (st->base)
+    munmap (st->base, (size_t) st->mapsize);
+err_lock:
+  close (st->fd);
+err_open:
+  ddsrt_free (st->path);
+  ddsrt_free (hdr);
+  ddsrt_free (st);
+  return NULL;
+}
+
+void whc_store_free (struct whc_store *st)
+{
+  munmap (st->base, (size_t) st->mapsize);
+  close (st->fd);
+  ddsrt_free (st->path);
+  ddsrt_free (st);
+}
+
+uint64_t whc_store_append (struct whc_store *st, const struct ddsi_serdata *sd)
+{
+  const uint32_t size = ddsi_serdata_size (sd);
+  const uint64_t total = rec_total_size (size);
+  if (total > st->mapsize - st->end)
+  {
+    uint64_t newsize = st->mapsize;
+    while (total > newsize - st->end)
+      newsize *= 2;
+    if (!map_file (st, newsize))
+    {
+      const struct ddsi_domaingv * const gv = st->gv;
+      GVWARNING ("whc store %s: failed to grow to %"PRIu64" bytes (%d)\n", st->path, newsize, errno);
+      return WHC_STORE_NONE;
+    }
+  }
+
+  const uint64_t off = st->end;
+  struct whc_store_rec * const rec = (struct whc_store_rec *) (st->base + off);
+  rec->size = size;
+  rec->statusinfo = sd->statusinfo;
+  rec->kind = (uint32_t) sd->kind;
+  rec->timestamp = sd->timestamp.v;
+  ddsi_serdata_to_ser (sd, 0, size, rec + 1);
+  ddsrt_atomic_fence_rel ();
+  rec->magic = WHC_STORE_REC_MAGIC;
+  st->end += total;
+  st->live_bytes += total;
+  return off;
+}
+
+static struct ddsi_serdata *serdata_from_rec (const struct whc_store_rec *rec, const struct ddsi_sertype *type)
+{
+  struct ddsi_serdata *sd;
+  ddsrt_iovec_t iov;
+  iov.iov_base = (void *) (rec + 1);
+  iov.iov_len = (ddsrt_iov_len_t) rec->size;
+  if ((sd = ddsi_serdata_from_ser_iov (type, (enum ddsi_serdata_kind) rec->kind, 1, &iov, rec->size)) != NULL)
+  {
+    sd->statusinfo = rec->statusinfo;
+    sd->timestamp.v = rec->timestamp;
+  }
+  return sd;
+}
+
+struct ddsi_serdata *whc_store_read (const struct whc_store *st, uint64_t off, const struct ddsi_sertype *type)
+{
+  assert (off >= st->hdrsize && off < st->end);
+  assert (rec_at (st, off)->magic == WHC_STORE_REC_MAGIC);
+  return serdata_from_rec (rec_at (st, off), type);
+}
+
+void whc_store_release (struct whc_store *st, uint64_t off)
+{
+  struct whc_store_rec * const rec = rec_at (st, off);
+  const uint64_t total = rec_total_size (rec->size);
+  assert (off >= st->restore_end && off < st->end);
+  assert (rec->magic == WHC_STORE_REC_MAGIC);
+  assert (st->live_bytes >= total);
+  rec->magic = WHC_STORE_REC_DEAD_MAGIC;
+  st->live_bytes -= total;
+}
+
+struct ddsi_serdata *whc_store_restore_next (struct whc_store *st, const struct ddsi_sertype *type)
+{
+  struct ddsi_serdata *sd = NULL;
+  while (sd == NULL && st->restore_off < st->restore_end)
+  {
+    const struct whc_store_rec *rec = rec_at (st, st->restore_off);
+    st->restore_off += rec_total_size (rec->size);
+    if (rec->magic == WHC_STORE_REC_DEAD_MAGIC)
+      continue;
+    if ((sd = serdata_from_rec (rec, type)) == NULL)
+    {
+      const struct ddsi_domaingv * const gv = st->gv;
+      GVWARNING ("whc store %s: skipping invalid sample\n", st->path);
+    }
+  }
+  return sd;
+}
+
+bool whc_store_want_compact (const struct whc_store *st)
+{
+  /* the file being more than twice the size needed, but not while restoring,
+     as that would discard what is still to be restored */
+  return st->end > st->compact_threshold && st->end - st->hdrsize > 2 * st->live_bytes && st->restore_off == st->restore_end;
+}
+
+bool whc_store_compact (struct whc_store *st, whc_store_next_t next, void *arg)
+{
+  const struct ddsi_domaingv * const gv = st->gv;
+  struct whc_store new_st = *st;
+  char *tmppath;
+  uint64_t *poff;
+
+  assert (st->restore_off == st->restore_end);
+  (void) ddsrt_asprintf (&tmppath, "%s.tmp", st->path);
+  new_st.base = NULL;
+  new_st.mapsize = 0;
+  if ((new_st.fd = open (tmppath, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+    goto err_open;
+  if (flock (new_st.fd, LOCK_EX | LOCK_NB) != 0)
+    goto err_map;
+  /* size known in advance, so it can't fail once the records are being moved */
+  if (!map_file (&new_st, align8 (st->hdrsize + st->live_bytes + WHC_STORE_INITIAL_SIZE / 2)))
+    goto err_map;
+
+  memcpy (new_st.base, st->base, st->hdrsize);
+  new_st.end = st->hdrsize;
+  while ((poff = next (arg)) != NULL)
+  {
+    if (*poff == WHC_STORE_NONE)
+      continue;
+    const uint64_t total = rec_total_size (rec_at (st, *poff)->size);
+    assert (total <= new_st.mapsize - new_st.end);
+    memcpy (new_st.base + new_st.end, st->base + *poff, (size_t) total);
+    *poff = new_st.end;
+    new_st.end += total;
+  }
+  assert (new_st.end - new_st.hdrsize == st->live_bytes);
+  new_st.restore_off = new_st.restore_end = new_st.hdrsize;
+  new_st.compact_threshold = compact_threshold (new_st.end);
+
+  if (rename (tmppath, st->path) != 0)
+  {
+    /* the offsets have been updated already, so continue using the new file
+       even though it won't be found after a restart */
+    GVWARNING ("whc store %s: failed to replace with compacted file (%d)\n", st->path, errno);
+    ddsrt_free (new_st.path);
+    new_st.path = tmppath;
+    tmppath = NULL;
+  }
+  munmap (st->base, (size_t) st->mapsize);
+  close (st->fd);
+  *st = new_st;
+  ddsrt_free (tmppath);
+  return true;
+
+err_map:
+  close (new_st.fd);
+  (void) unlink (tmppath);
+err_open:
+  GVWARNING ("whc store %s: compaction failed (%d)\n", st->path, errno);
+  /* don't retry until it has grown quite a bit */
+  st->compact_threshold = compact_threshold (st->end);
+  ddsrt_free (tmppath);
+  return false;
+}
+
+#else
+
+struct whc_store *whc_store_new (const struct ddsi_domaingv *gv, const char *dir, const char *topic_name, const char *type_name, uint32_t npartitions, const char * const *partitions)
+{
+  (void) dir; (void) type_name; (void) npartitions; (void) partitions;
+  GVWARNING ("whc store for topic %s: not supported on this platform\n", topic_name);
+  return NULL;
+}
+
+void whc_store_free (struct whc_store *st)
+{
+  (void) st;
+  assert (0);
+}
+
+uint64_t whc_store_append (struct whc_store *st, const struct ddsi_serdata *sd)
+{
+  (void) st; (void) sd;
+  assert (0);
+  return WHC_STORE_NONE;
+}
+
+struct ddsi_serdata *whc_store_read (const struct whc_store *st, uint64_t off, const struct ddsi_sertype *type)
+{
+  (void) st; (void) off; (void) type;
+  assert (0);
+  return NULL;
+}
+
+void whc_store_release (struct whc_store *st, uint64_t off)
+{
+  (void) st; (void) off;
+  assert (0);
+}
+
+struct ddsi_serdata *whc_store_restore_next (struct whc_store *st, const struct ddsi_sertype *type)
+{
+  (void) st; (void) type;
+  assert (0);
+  return NULL;
+}
+
+bool whc_store_want_compact (const struct whc_store *st)
+{
+  (void) st;
+  assert (0);
+  return false;
+}
+
+bool whc_store_compact (struct whc_store *st, whc_store_next_t next, void *arg)
+{
+  (void) st; (void) next; (void) arg;
+  assert (0);
+  return false;
+}
+
+#endif
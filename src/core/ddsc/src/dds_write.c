@@ -13,6 +13,7 @@
 #include <string.h>
 #include "dds__writer.h"
 #include "dds__write.h"
+#include "dds/ddsi/ddsi_filter_expr.h"
 #include "dds/ddsi/ddsi_tkmap.h"
 #include "dds/ddsi/q_thread.h"
 #include "dds/ddsi/q_xmsg.h"
@@ -28,6 +29,7 @@
 #include "dds/ddsi/ddsi_deliver_locally.h"
 
 #include "dds/ddsc/dds_loan_api.h"
+#include "dds/ddsi/ddsi_serdata_default.h"
 #include "dds__loan.h"
 
 #ifdef DDS_HAS_SHM
@@ -66,6 +68,12 @@ dds_return_t dds_writecdr (dds_entity_t writer, struct ddsi_serdata *serdata)
     dds_writer_unlock (wr);
     return DDS_RETCODE_ERROR;
   }
+  if (wr->m_topic->m_filter_expr && !ddsi_filter_expr_eval_serdata (wr->m_topic->m_filter_expr, serdata))
+  {
+    dds_writer_unlock (wr);
+    ddsi_serdata_unref (serdata);
+    return DDS_RETCODE_OK;
+  }
   serdata->statusinfo = 0;
   serdata->timestamp.v = dds_time ();
   ret = dds_writecdr_impl (wr, wr->m_xp, serdata, !wr->whc_batch);
@@ -88,6 +96,12 @@ dds_return_t dds_forwardcdr (dds_entity_t writer, struct ddsi_serdata *serdata)
     dds_writer_unlock (wr);
     return DDS_RETCODE_ERROR;
   }
+  if (wr->m_topic->m_filter_expr && !ddsi_filter_expr_eval_serdata (wr->m_topic->m_filter_expr, serdata))
+  {
+    dds_writer_unlock (wr);
+    ddsi_serdata_unref (serdata);
+    return DDS_RETCODE_OK;
+  }
   ret = dds_writecdr_impl (wr, wr->m_xp, serdata, !wr->whc_batch);
   dds_writer_unlock (wr);
   return ret;
@@ -323,8 +337,10 @@ static dds_return_t dds_writecdr_impl_common (struct writer *ddsi_wr, struct nn_
 static bool evalute_topic_filter (const dds_writer *wr, const void *data, bool writekey)
 {
   // false if data rejected by filter
-  if (wr->m_topic->m_filter.mode == DDS_TOPIC_FILTER_NONE || writekey)
+  if (writekey)
     return true;
+  if (wr->m_topic->m_filter_expr && !ddsi_filter_expr_eval_sample (wr->m_topic->m_filter_expr, data))
+    return false;
 
   const struct dds_topic_filter *f = &wr->m_topic->m_filter;
   switch (f->mode)
@@ -351,6 +367,23 @@ static bool evalute_topic_filter (const dds_writer *wr, const void *data, bool w
   return true;
 }
 
+// A sample loaned on the network path is the payload of a serdata: writing it
+// consumes the loan and reuses that serdata, other samples get serialized
+static struct ddsi_serdata *serdata_from_sample_or_loan (const dds_writer *wr, bool writekey, const void *data, struct ddsi_serdata *loan)
+{
+  struct ddsi_serdata *d;
+  if (loan == NULL)
+    d = ddsi_serdata_from_sample (wr->m_wr->type, writekey ? SDK_KEY : SDK_DATA, data);
+  else if (!writekey)
+    d = ddsi_serdata_default_loan_fini (loan);
+  else
+  {
+    d = ddsi_serdata_from_sample (wr->m_wr->type, SDK_KEY, data);
+    ddsi_serdata_unref (loan);
+  }
+  return d;
+}
+
 #ifdef DDS_HAS_SHM
 static size_t get_required_buffer_size(struct dds_topic *topic, const void *sample) {
   bool has_fixed_size_type = topic->m_stype->fixed_size;
@@ -396,9 +429,17 @@ dds_return_t dds_write_impl (dds_writer *wr, const void * data, dds_time_t tstam
   if (data == NULL)
     return DDS_RETCODE_BAD_PARAMETER;
 
+  // writing a sample loaned on the network path consumes the loan, even if it
+  // is dropped by the filter
+  struct ddsi_serdata * const net_loan = (wr->m_iox_pub == NULL) ? dds_writer_take_net_loan (wr, data) : NULL;
+
   // 2. Topic filter
   if (!evalute_topic_filter (wr, data, writekey))
+  {
+    if (net_loan)
+      ddsi_serdata_unref (net_loan);
     return DDS_RETCODE_OK;
+  }
 
   thread_state_awake (ts1, &wr->m_entity.m_domain->gv);
 
@@ -490,7 +531,7 @@ dds_return_t dds_write_impl (dds_writer *wr, const void * data, dds_time_t tstam
     // serialize for network since we will need to send via network anyway
     // we also need to serialize into an iceoryx chunk
  
-    d = ddsi_serdata_from_sample (ddsi_wr->type, writekey ? SDK_KEY : SDK_DATA, data);
+    d = serdata_from_sample_or_loan (wr, writekey, data, net_loan);
     if(d == NULL) {
       ret = DDS_RETCODE_BAD_PARAMETER;
       goto release_chunk;
@@ -564,14 +605,21 @@ dds_return_t dds_write_impl (dds_writer *wr, const void * data, dds_time_t tstam
   if (data == NULL)
     return DDS_RETCODE_BAD_PARAMETER;
 
+  /* Writing a loaned sample consumes the loan, even if it is dropped by the filter */
+  struct ddsi_serdata * const loan = dds_writer_take_net_loan (wr, data);
+
   /* Check for topic filter */
   if (!evalute_topic_filter(wr, data, writekey))
+  {
+    if (loan)
+      ddsi_serdata_unref (loan);
     return DDS_RETCODE_OK;
+  }
 
   thread_state_awake (ts1, &wr->m_entity.m_domain->gv);
 
-  /* Serialize and write data or key */
-  if ((d = ddsi_serdata_from_sample (ddsi_wr->type, writekey ? SDK_KEY : SDK_DATA, data)) == NULL)
+  /* Serialize (unless loaned) and write data or key */
+  if ((d = serdata_from_sample_or_loan (wr, writekey, data, loan)) == NULL)
     ret = DDS_RETCODE_BAD_PARAMETER;
   else
   {
@@ -603,6 +651,21 @@ dds_return_t dds_write_impl (dds_writer *wr, const void * data, dds_time_t tstam
 }
 #endif
 
+bool dds_evaluate_topic_filter_serdata (const dds_writer *wr, const struct ddsi_serdata *sd)
+{
+  // false if data rejected by filter; function filters can only be applied
+  // to a deserialized sample
+  if (sd->kind != SDK_DATA)
+    return true;
+  if (wr->m_topic->m_filter.mode == DDS_TOPIC_FILTER_NONE)
+    return (wr->m_topic->m_filter_expr == NULL || ddsi_filter_expr_eval_serdata (wr->m_topic->m_filter_expr, sd));
+  const struct ddsi_sertype * const st = wr->m_topic->m_stype;
+  void *sample = ddsi_sertype_alloc_sample (st);
+  const bool accept = ddsi_serdata_to_sample (sd, sample, NULL, NULL) && evalute_topic_filter (wr, sample, false);
+  ddsi_sertype_free_sample (st, sample, DDS_FREE_ALL);
+  return accept;
+}
+
 dds_return_t dds_writecdr_impl (dds_writer *wr, struct nn_xpack *xp, struct ddsi_serdata *dinp, bool flush)
 {
   return dds_writecdr_impl_common (wr->m_wr, xp, dinp, flush, wr);
@@ -34,6 +34,7 @@
 #include "dds__whc.h"
 #include "dds__statistics.h"
 #include "dds__data_allocator.h"
+#include "dds__loan.h"
 #include "dds/ddsi/ddsi_statistics.h"
 
 DECL_ENTITY_LOCK_UNLOCK (dds_writer)
@@ -207,6 +208,7 @@ static dds_return_t dds_writer_delete (dds_entity *e)
     iox_pub_deinit(wr->m_iox_pub);
   }
 #endif
+  dds_writer_release_net_loans (wr);
   /* FIXME: not freeing WHC here because it is owned by the DDSI entity */
   thread_state_awake (lookup_thread_state (), &e->m_domain->gv);
   nn_xpack_free (wr->m_xp);
@@ -252,7 +254,10 @@ static const struct dds_stat_keyvalue_descriptor dds_writer_statistics_kv[] = {
   { "rexmit_bytes", DDS_STAT_KIND_UINT64 },
   { "throttle_count", DDS_STAT_KIND_UINT32 },
   { "time_throttle", DDS_STAT_KIND_UINT64 },
-  { "time_rexmit", DDS_STAT_KIND_UINT64 }
+  { "time_rexmit", DDS_STAT_KIND_UINT64 },
+  { "addrset_rebuild_count", DDS_STAT_KIND_UINT32 },
+  { "time_addrset_rebuild", DDS_STAT_KIND_UINT64 },
+  { "filtered_count", DDS_STAT_KIND_UINT32 }
 };
 
 static const struct dds_stat_descriptor dds_writer_statistics_desc = {
@@ -269,7 +274,7 @@ static void dds_writer_refresh_statistics (const struct dds_entity *entity, stru
 {
   const struct dds_writer *wr = (const struct dds_writer *) entity;
   if (wr->m_wr)
-    ddsi_get_writer_stats (wr->m_wr, &stat->kv[0].u.u64, &stat->kv[1].u.u32, &stat->kv[2].u.u64, &stat->kv[3].u.u64);
+    ddsi_get_writer_stats (wr->m_wr, &stat->kv[0].u.u64, &stat->kv[1].u.u32, &stat->kv[2].u.u64, &stat->kv[3].u.u64, &stat->kv[4].u.u32, &stat->kv[5].u.u64, &stat->kv[6].u.u32);
 }
 
 const struct dds_entity_deriver dds_entity_deriver_writer = {
@@ -458,6 +463,16 @@ dds_entity_t dds_create_writer (dds_entity_t participant_or_publisher, dds_entit
     nn_xpack_sendq_start(gv);
   }
   ddsrt_mutex_unlock (&gv->sendq_running_lock);
+
+  /* republish what a previous incarnation left in the WHC store, if any; this
+     is a regular write that may invoke listeners of local readers, so only
+     once the writer is fully operational and holding no lock but its own */
+  dds_writer *wr_restore;
+  if (dds_writer_lock (writer, &wr_restore) == DDS_RETCODE_OK)
+  {
+    whc_restore_from_store (wr_restore->m_whc, wr_restore);
+    dds_writer_unlock (wr_restore);
+  }
   return writer;
 
 #ifdef DDS_HAS_SECURITY
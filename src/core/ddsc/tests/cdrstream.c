@@ -12,6 +12,7 @@
 
 #include "CUnit/Theory.h"
 #include "dds/dds.h"
+#include "dds/ddsrt/bswap.h"
 #include "dds/ddsrt/environ.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/io.h"
@@ -23,6 +24,7 @@
 #include "dds/ddsi/ddsi_cdrstream.h"
 #include "test_util.h"
 #include "MinXcdrVersion.h"
+#include "MarshalTypes.h"
 
 #define DDS_DOMAINID1 0
 #define DDS_DOMAINID2 1
@@ -86,7 +88,7 @@ static const uint32_t TestIdl_MsgNested_ops [] =
   DDS_OP_RTS
 };
 
-const dds_topic_descriptor_t TestIdl_MsgNested_desc = { sizeof (TestIdl_MsgNested), 4u, DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgNested", NULL, 17, TestIdl_MsgNested_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgNested_desc = { sizeof (TestIdl_MsgNested), 4u, DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgNested", NULL, 17, TestIdl_MsgNested_ops, "", NULL };
 
 static void * sample_init_nested (void)
 {
@@ -141,7 +143,7 @@ static const uint32_t TestIdl_Msg_ops [] =
   DDS_OP_RTS
 };
 
-const dds_topic_descriptor_t TestIdl_MsgStr_desc = { sizeof (TestIdl_MsgStr), sizeof (char *), DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgStr", NULL, 14, TestIdl_Msg_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgStr_desc = { sizeof (TestIdl_MsgStr), sizeof (char *), DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgStr", NULL, 14, TestIdl_Msg_ops, "", NULL };
 
 static void * sample_init_str (void)
 {
@@ -253,7 +255,7 @@ static const uint32_t TestIdl_MsgUnion_ops [] =
   DDS_OP_RTS
 };
 
-const dds_topic_descriptor_t TestIdl_MsgUnion_desc = { sizeof (TestIdl_MsgUnion), 4u, DDS_TOPIC_NO_OPTIMIZE | DDS_TOPIC_CONTAINS_UNION, 0u, "TestIdl::MsgUnion", NULL, 3, TestIdl_MsgUnion_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgUnion_desc = { sizeof (TestIdl_MsgUnion), 4u, DDS_TOPIC_NO_OPTIMIZE | DDS_TOPIC_CONTAINS_UNION, 0u, "TestIdl::MsgUnion", NULL, 3, TestIdl_MsgUnion_ops, "", NULL };
 
 static void * sample_init_union (void)
 {
@@ -319,7 +321,7 @@ static const uint32_t TestIdl_MsgRecursive_ops [] =
   DDS_OP_RTS
 };
 
-const dds_topic_descriptor_t TestIdl_MsgRecursive_desc = { sizeof (TestIdl_MsgRecursive), 4u, DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgRecursive", NULL, 18, TestIdl_MsgRecursive_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgRecursive_desc = { sizeof (TestIdl_MsgRecursive), 4u, DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgRecursive", NULL, 18, TestIdl_MsgRecursive_ops, "", NULL };
 
 static void * sample_init_recursive (void)
 {
@@ -412,7 +414,7 @@ static const uint32_t TestIdl_MsgExt_ops [] =
   DDS_OP_RTS
 };
 
-const dds_topic_descriptor_t TestIdl_MsgExt_desc = { sizeof (TestIdl_MsgExt), sizeof (char *), DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl_MsgExt", NULL, 9, TestIdl_MsgExt_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgExt_desc = { sizeof (TestIdl_MsgExt), sizeof (char *), DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl_MsgExt", NULL, 9, TestIdl_MsgExt_ops, "", NULL };
 
 static void * sample_init_ext (void)
 {
@@ -527,7 +529,7 @@ static const uint32_t TestIdl_MsgOpt_ops [] =
   DDS_OP_RTS
 };
 
-const dds_topic_descriptor_t TestIdl_MsgOpt_desc = { sizeof (TestIdl_MsgOpt), sizeof (char *), DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl_MsgOpt", NULL, 9, TestIdl_MsgOpt_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgOpt_desc = { sizeof (TestIdl_MsgOpt), sizeof (char *), DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl_MsgOpt", NULL, 9, TestIdl_MsgOpt_ops, "", NULL };
 
 static void * sample_init_opt (void)
 {
@@ -708,7 +710,7 @@ static const uint32_t TestIdl_AppendableMsg_ops [] =
   DDS_OP_RTS,
 };
 
-const dds_topic_descriptor_t TestIdl_MsgAppendable_desc = { sizeof (TestIdl_AppendableMsg), 4u, DDS_TOPIC_NO_OPTIMIZE | DDS_TOPIC_TYPE_EXTENSIBILITY_APPENDABLE, 0u, "TestIdl::AppendableMsg", NULL, 4, TestIdl_AppendableMsg_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgAppendable_desc = { sizeof (TestIdl_AppendableMsg), 4u, DDS_TOPIC_NO_OPTIMIZE | DDS_TOPIC_TYPE_EXTENSIBILITY_APPENDABLE, 0u, "TestIdl::AppendableMsg", NULL, 4, TestIdl_AppendableMsg_ops, "", NULL };
 
 static void * sample_init_appendable (void)
 {
@@ -845,7 +847,7 @@ static const dds_key_descriptor_t TestIdl_MsgKeysNested_keys[3] =
   { "msg_field1.submsg_field4.submsg2_field2", 37, 2 }
 };
 
-const dds_topic_descriptor_t TestIdl_MsgKeysNested_desc = { sizeof (TestIdl_MsgKeysNested), sizeof (char *), DDS_TOPIC_FIXED_KEY | DDS_TOPIC_FIXED_KEY_XCDR2 | DDS_TOPIC_NO_OPTIMIZE, 3u, "TestIdl::MsgKeysNested", TestIdl_MsgKeysNested_keys, 8, TestIdl_MsgKeysNested_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgKeysNested_desc = { sizeof (TestIdl_MsgKeysNested), sizeof (char *), DDS_TOPIC_FIXED_KEY | DDS_TOPIC_FIXED_KEY_XCDR2 | DDS_TOPIC_NO_OPTIMIZE, 3u, "TestIdl::MsgKeysNested", TestIdl_MsgKeysNested_keys, 8, TestIdl_MsgKeysNested_ops, "", NULL };
 
 static void * sample_empty_keysnested (void)
 {
@@ -949,7 +951,7 @@ static const uint32_t TestIdl_MsgArr_ops [] =
   DDS_OP_RTS
 };
 
-const dds_topic_descriptor_t TestIdl_MsgArr_desc = { sizeof (TestIdl_MsgArr), sizeof (char *), DDS_TOPIC_NO_OPTIMIZE | DDS_TOPIC_CONTAINS_UNION, 0u, "TestIdl::MsgArr", NULL, 6, TestIdl_MsgArr_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgArr_desc = { sizeof (TestIdl_MsgArr), sizeof (char *), DDS_TOPIC_NO_OPTIMIZE | DDS_TOPIC_CONTAINS_UNION, 0u, "TestIdl::MsgArr", NULL, 6, TestIdl_MsgArr_ops, "", NULL };
 
 static void * sample_init_arr (void)
 {
@@ -1049,8 +1051,8 @@ static const uint32_t TestIdl_MsgAppendStruct2_ops [] =
   DDS_OP_RTS
 };
 
-const dds_topic_descriptor_t TestIdl_MsgAppendStruct1_desc = { sizeof (TestIdl_MsgAppendStruct1), 4u, 0u, 0u, "TestIdl::MsgAppendStruct1", NULL, 0, TestIdl_MsgAppendStruct1_ops, "" };
-const dds_topic_descriptor_t TestIdl_MsgAppendStruct2_desc = { sizeof (TestIdl_MsgAppendStruct2), 4u, 0u, 0u, "TestIdl::MsgAppendStruct2", NULL, 0, TestIdl_MsgAppendStruct2_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgAppendStruct1_desc = { sizeof (TestIdl_MsgAppendStruct1), 4u, 0u, 0u, "TestIdl::MsgAppendStruct1", NULL, 0, TestIdl_MsgAppendStruct1_ops, "", NULL };
+const dds_topic_descriptor_t TestIdl_MsgAppendStruct2_desc = { sizeof (TestIdl_MsgAppendStruct2), 4u, 0u, 0u, "TestIdl::MsgAppendStruct2", NULL, 0, TestIdl_MsgAppendStruct2_ops, "", NULL };
 
 static void * sample_init_appendstruct1 (void)
 {
@@ -1214,8 +1216,8 @@ static const uint32_t TestIdl_MsgAppendDefaults2_ops [] =
   DDS_OP_RTS,
 };
 
-const dds_topic_descriptor_t TestIdl_MsgAppendDefaults1_desc = { sizeof (TestIdl_MsgAppendDefaults1), 4u, 0u, 0u, "TestIdl::MsgAppendDefaults1", NULL, 0, TestIdl_MsgAppendDefaults1_ops, "" };
-const dds_topic_descriptor_t TestIdl_MsgAppendDefaults2_desc = { sizeof (TestIdl_MsgAppendDefaults2), 4u, DDS_TOPIC_NO_OPTIMIZE | DDS_TOPIC_CONTAINS_UNION, 0u, "TestIdl::MsgAppendDefaults2", NULL, 0, TestIdl_MsgAppendDefaults2_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgAppendDefaults1_desc = { sizeof (TestIdl_MsgAppendDefaults1), 4u, 0u, 0u, "TestIdl::MsgAppendDefaults1", NULL, 0, TestIdl_MsgAppendDefaults1_ops, "", NULL };
+const dds_topic_descriptor_t TestIdl_MsgAppendDefaults2_desc = { sizeof (TestIdl_MsgAppendDefaults2), 4u, DDS_TOPIC_NO_OPTIMIZE | DDS_TOPIC_CONTAINS_UNION, 0u, "TestIdl::MsgAppendDefaults2", NULL, 0, TestIdl_MsgAppendDefaults2_ops, "", NULL };
 
 static void * sample_init_appenddefaults1 (void)
 {
@@ -1422,8 +1424,8 @@ static const uint32_t TestIdl_MsgMutable2_ops [] =
   DDS_OP_RTS,
 };
 
-const dds_topic_descriptor_t TestIdl_MsgMutable1_desc = { sizeof (TestIdl_MsgMutable1), 4u, DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgMutable1", NULL, 0, TestIdl_MsgMutable1_ops, "" };
-const dds_topic_descriptor_t TestIdl_MsgMutable2_desc = { sizeof (TestIdl_MsgMutable2), 4u, DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgMutable2", NULL, 0, TestIdl_MsgMutable2_ops, "" };
+const dds_topic_descriptor_t TestIdl_MsgMutable1_desc = { sizeof (TestIdl_MsgMutable1), 4u, DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgMutable1", NULL, 0, TestIdl_MsgMutable1_ops, "", NULL };
+const dds_topic_descriptor_t TestIdl_MsgMutable2_desc = { sizeof (TestIdl_MsgMutable2), 4u, DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgMutable2", NULL, 0, TestIdl_MsgMutable2_ops, "", NULL };
 
 static void * sample_init_mutable1 (void)
 {
@@ -1853,3 +1855,317 @@ CU_Theory ((const dds_topic_descriptor_t *desc, uint16_t min_xcdrv),
 #undef XCDR1
 #undef XCDR2
 #undef D
+
+/**********************************************
+ * Primitive arrays and sequences: correctness of
+ * the bulk (byte-swapping) copies in both byte
+ * orders and a rough measure of their throughput
+ **********************************************/
+#define PRIMARR_SEQLEN 100000u
+#define PRIMARR_ARRLEN 10000u
+
+typedef struct dds_sequence_float
+{
+  uint32_t _maximum;
+  uint32_t _length;
+  float *_buffer;
+  bool _release;
+} dds_sequence_float;
+
+typedef struct TestIdl_MsgPrimArr
+{
+  uint8_t f1;
+  dds_sequence_float points;
+  int16_t f2;
+  double values[PRIMARR_ARRLEN];
+} TestIdl_MsgPrimArr;
+
+static const uint32_t TestIdl_MsgPrimArr_ops [] =
+{
+  DDS_OP_ADR | DDS_OP_TYPE_1BY, offsetof (TestIdl_MsgPrimArr, f1),
+  DDS_OP_ADR | DDS_OP_TYPE_SEQ | DDS_OP_SUBTYPE_4BY | DDS_OP_FLAG_FP, offsetof (TestIdl_MsgPrimArr, points),
+  DDS_OP_ADR | DDS_OP_TYPE_2BY | DDS_OP_FLAG_SGN, offsetof (TestIdl_MsgPrimArr, f2),
+  DDS_OP_ADR | DDS_OP_TYPE_ARR | DDS_OP_SUBTYPE_8BY | DDS_OP_FLAG_FP, offsetof (TestIdl_MsgPrimArr, values), PRIMARR_ARRLEN,
+  DDS_OP_RTS
+};
+
+const dds_topic_descriptor_t TestIdl_MsgPrimArr_desc = { sizeof (TestIdl_MsgPrimArr), 8u, DDS_TOPIC_NO_OPTIMIZE, 0u, "TestIdl::MsgPrimArr", NULL, 0, TestIdl_MsgPrimArr_ops, "", NULL };
+
+CU_TheoryDataPoints (ddsc_cdrstream, prim_array_bulk) = {
+  CU_DataPoints (uint32_t, CDR_ENC_VERSION_1, CDR_ENC_VERSION_1, CDR_ENC_VERSION_2, CDR_ENC_VERSION_2),
+  CU_DataPoints (bool,     false,             true,              false,             true),
+};
+
+CU_Theory ((uint32_t xcdr_version, bool big_endian), ddsc_cdrstream, prim_array_bulk, .timeout = 60)
+{
+  const dds_topic_descriptor_t *desc = &TestIdl_MsgPrimArr_desc;
+  const bool bswap = (DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN) == big_endian;
+  const int niter = 100;
+
+  struct ddsi_sertype_default type;
+  memset (&type, 0, sizeof (type));
+  type.type = (struct ddsi_sertype_default_desc) {
+    .size = desc->m_size,
+    .align = desc->m_align,
+    .flagset = desc->m_flagset,
+    .keys.nkeys = 0,
+    .keys.keys = NULL,
+    .ops.nops = dds_stream_countops (desc->m_ops, desc->m_nkeys, desc->m_keys),
+    .ops.ops = (uint32_t *) desc->m_ops
+  };
+
+  TestIdl_MsgPrimArr *msg_wr = ddsrt_calloc (1, sizeof (*msg_wr));
+  msg_wr->f1 = 1;
+  msg_wr->f2 = -2;
+  msg_wr->points._length = msg_wr->points._maximum = PRIMARR_SEQLEN;
+  msg_wr->points._buffer = ddsrt_malloc (PRIMARR_SEQLEN * sizeof (*msg_wr->points._buffer));
+  msg_wr->points._release = true;
+  for (uint32_t i = 0; i < PRIMARR_SEQLEN; i++)
+    msg_wr->points._buffer[i] = (float) i * 0.5f;
+  for (uint32_t i = 0; i < PRIMARR_ARRLEN; i++)
+    msg_wr->values[i] = (double) i / 3.0;
+
+  /* Serialize in the requested byte order */
+  dds_ostream_t os;
+  dds_time_t tw = 0;
+  for (int i = 0; i < niter; i++)
+  {
+    const dds_time_t t0 = dds_time ();
+    if (big_endian)
+    {
+      dds_ostreamBE_init ((dds_ostreamBE_t *) &os, 0, xcdr_version);
+      dds_stream_write_sampleBE ((dds_ostreamBE_t *) &os, msg_wr, &type);
+    }
+    else
+    {
+      dds_ostreamLE_init ((dds_ostreamLE_t *) &os, 0, xcdr_version);
+      dds_stream_write_sampleLE ((dds_ostreamLE_t *) &os, msg_wr, &type);
+    }
+    tw += dds_time () - t0;
+    if (i < niter - 1)
+      dds_ostream_fini (&os);
+  }
+  const uint32_t size = os.m_index;
+
+  /* Check the byte order of the second float in the sequence: 1 byte, padding
+     and the sequence length precede the first at offset 8 */
+  {
+    const float exp_f = 0.5f;
+    uint32_t exp, act;
+    memcpy (&exp, &exp_f, sizeof (exp));
+    memcpy (&act, os.m_buffer + 12, sizeof (act));
+    if (bswap)
+      act = ddsrt_bswap4u (act);
+    CU_ASSERT_FATAL (act == exp);
+  }
+
+  /* Normalize (swaps in-place if needed) and deserialize */
+  void *data = ddsrt_malloc (size);
+  TestIdl_MsgPrimArr *msg_rd = ddsrt_calloc (1, sizeof (*msg_rd));
+  dds_time_t tn = 0, tr = 0;
+  for (int i = 0; i < niter; i++)
+  {
+    uint32_t actual_size;
+    memcpy (data, os.m_buffer, size);
+    const dds_time_t t0 = dds_time ();
+    bool ok = dds_stream_normalize (data, size, bswap, xcdr_version, &type, false, &actual_size);
+    const dds_time_t t1 = dds_time ();
+    CU_ASSERT_FATAL (ok);
+    CU_ASSERT_FATAL (actual_size == size);
+
+    dds_istream_t is;
+    dds_istream_init (&is, size, data, xcdr_version);
+    dds_stream_read_sample (&is, msg_rd, &type);
+    tr += dds_time () - t1;
+    tn += t1 - t0;
+    dds_istream_fini (&is);
+  }
+
+  CU_ASSERT_FATAL (msg_rd->f1 == msg_wr->f1 && msg_rd->f2 == msg_wr->f2);
+  CU_ASSERT_FATAL (msg_rd->points._length == PRIMARR_SEQLEN);
+  CU_ASSERT_FATAL (memcmp (msg_rd->points._buffer, msg_wr->points._buffer, PRIMARR_SEQLEN * sizeof (float)) == 0);
+  CU_ASSERT_FATAL (memcmp (msg_rd->values, msg_wr->values, sizeof (msg_rd->values)) == 0);
+
+  printf ("prim_array_bulk xcdr%"PRIu32" %s (%s): %"PRIu32" bytes, write %.1f us, normalize %.1f us, read %.1f us\n",
+          xcdr_version == CDR_ENC_VERSION_1 ? 1u : 2u, big_endian ? "BE" : "LE", bswap ? "swapped" : "native", size,
+          (double) tw / niter / 1e3, (double) tn / niter / 1e3, (double) tr / niter / 1e3);
+
+  dds_stream_free_sample (msg_rd, desc->m_ops);
+  dds_stream_free_sample (msg_wr, desc->m_ops);
+  ddsrt_free (msg_rd);
+  ddsrt_free (msg_wr);
+  ddsrt_free (data);
+  dds_ostream_fini (&os);
+}
+
+#undef PRIMARR_SEQLEN
+#undef PRIMARR_ARRLEN
+
+static void marshal_init_type (struct ddsi_sertype_default *type, const dds_topic_descriptor_t *desc, bool generated)
+{
+  memset (type, 0, sizeof (*type));
+  type->type = (struct ddsi_sertype_default_desc) {
+    .size = desc->m_size,
+    .align = desc->m_align,
+    .flagset = desc->m_flagset & ~DDS_TOPIC_MARSHAL,
+    .keys.nkeys = desc->m_nkeys,
+    .keys.keys = ddsrt_malloc (desc->m_nkeys * sizeof (*type->type.keys.keys)),
+    .ops.nops = dds_stream_countops (desc->m_ops, desc->m_nkeys, desc->m_keys),
+    .ops.ops = (uint32_t *) desc->m_ops
+  };
+  for (uint32_t i = 0; i < desc->m_nkeys; i++)
+  {
+    type->type.keys.keys[i].ops_offs = desc->m_keys[i].m_offset;
+    type->type.keys.keys[i].idx = desc->m_keys[i].m_idx;
+  }
+  type->marshal = generated ? desc->m_marshal : NULL;
+}
+
+static void marshal_write (dds_ostream_t *os, const void *sample, const struct ddsi_sertype_default *type, uint32_t xcdr_version)
+{
+#if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN
+  dds_ostreamLE_init ((dds_ostreamLE_t *) os, 0, xcdr_version);
+  dds_stream_write_sampleLE ((dds_ostreamLE_t *) os, sample, type);
+#else
+  dds_ostreamBE_init ((dds_ostreamBE_t *) os, 0, xcdr_version);
+  dds_stream_write_sampleBE ((dds_ostreamBE_t *) os, sample, type);
+#endif
+}
+
+CU_Test (ddsc_cdrstream, generated_marshal_flag)
+{
+  /* Types requiring the interpreter don't get generated functions */
+  CU_ASSERT_FATAL (MarshalTypes_msg_desc.m_flagset & DDS_TOPIC_MARSHAL);
+  CU_ASSERT_FATAL (MarshalTypes_msg_desc.m_marshal != NULL);
+  CU_ASSERT_FATAL (!(MarshalTypes_seq_desc.m_flagset & DDS_TOPIC_MARSHAL));
+}
+
+CU_TheoryDataPoints (ddsc_cdrstream, generated_marshal) = {
+  CU_DataPoints (uint32_t, CDR_ENC_VERSION_1, CDR_ENC_VERSION_2),
+};
+
+CU_Theory ((uint32_t xcdr_version), ddsc_cdrstream, generated_marshal, .timeout = 60)
+{
+  const dds_topic_descriptor_t *desc = &MarshalTypes_msg_desc;
+  const int niter = 10000;
+  struct ddsi_sertype_default type_int, type_gen;
+  marshal_init_type (&type_int, desc, false);
+  marshal_init_type (&type_gen, desc, true);
+
+  MarshalTypes_msg msg_wr;
+  memset (&msg_wr, 0, sizeof (msg_wr));
+  msg_wr.id = RND_INT32;
+  for (uint32_t i = 0; i < 3; i++)
+    msg_wr.k[i] = RND_CHAR;
+  msg_wr.o = (uint8_t) RND_UINT32;
+  msg_wr.d = (double) RND_INT32 / 7.0;
+  msg_wr.en = MarshalTypes_E2;
+  msg_wr.in.s = RND_INT16;
+  msg_wr.in.d = (double) RND_INT32 / 3.0;
+  for (uint32_t i = 0; i < 4; i++)
+    msg_wr.ll[i] = (int64_t) RND_INT32 << 16;
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    msg_wr.ia[i].s = RND_INT16;
+    msg_wr.ia[i].d = (double) RND_INT32 / 11.0;
+  }
+  for (uint32_t i = 0; i < 5; i++)
+  {
+    msg_wr.oa[i].c = RND_CHAR;
+    msg_wr.oa[i].s = RND_INT16;
+  }
+  msg_wr.ik.a = RND_INT32;
+  msg_wr.ik.c = RND_CHAR;
+  for (uint32_t i = 0; i < 2; i++)
+    msg_wr.k8[i] = (uint64_t) RND_UINT32 << 32 | RND_UINT32;
+  msg_wr.b = true;
+
+  /* Serialized sample: generated and interpreted must be byte-for-byte equal */
+  dds_ostream_t os_int, os_gen;
+  dds_time_t tw_int = 0, tw_gen = 0;
+  for (int i = 0; i < niter; i++)
+  {
+    const dds_time_t t0 = dds_time ();
+    marshal_write (&os_int, &msg_wr, &type_int, xcdr_version);
+    const dds_time_t t1 = dds_time ();
+    marshal_write (&os_gen, &msg_wr, &type_gen, xcdr_version);
+    const dds_time_t t2 = dds_time ();
+    tw_int += t1 - t0;
+    tw_gen += t2 - t1;
+    if (i < niter - 1)
+    {
+      dds_ostream_fini (&os_int);
+      dds_ostream_fini (&os_gen);
+    }
+  }
+  CU_ASSERT_FATAL (os_int.m_index == type_gen.marshal->m_xcdr1.m_size || xcdr_version != CDR_ENC_VERSION_1);
+  CU_ASSERT_FATAL (os_int.m_index == type_gen.marshal->m_xcdr2.m_size || xcdr_version != CDR_ENC_VERSION_2);
+  CU_ASSERT_FATAL (os_gen.m_index == os_int.m_index);
+  CU_ASSERT_FATAL (memcmp (os_gen.m_buffer, os_int.m_buffer, os_int.m_index) == 0);
+
+  /* Deserialize */
+  MarshalTypes_msg msg_rd_int, msg_rd_gen;
+  dds_time_t tr_int = 0, tr_gen = 0;
+  for (int i = 0; i < niter; i++)
+  {
+    dds_istream_t is;
+    memset (&msg_rd_int, 0, sizeof (msg_rd_int));
+    memset (&msg_rd_gen, 0, sizeof (msg_rd_gen));
+    const dds_time_t t0 = dds_time ();
+    dds_istream_init (&is, os_int.m_index, os_int.m_buffer, xcdr_version);
+    dds_stream_read_sample (&is, &msg_rd_int, &type_int);
+    const dds_time_t t1 = dds_time ();
+    CU_ASSERT_FATAL (is.m_index == os_int.m_index);
+    dds_istream_init (&is, os_int.m_index, os_int.m_buffer, xcdr_version);
+    dds_stream_read_sample (&is, &msg_rd_gen, &type_gen);
+    const dds_time_t t2 = dds_time ();
+    CU_ASSERT_FATAL (is.m_index == os_int.m_index);
+    tr_int += t1 - t0;
+    tr_gen += t2 - t1;
+  }
+  CU_ASSERT_FATAL (memcmp (&msg_rd_int, &msg_wr, sizeof (msg_wr)) == 0);
+  CU_ASSERT_FATAL (memcmp (&msg_rd_gen, &msg_wr, sizeof (msg_wr)) == 0);
+
+  /* Key from sample and key from serialized data, the latter always in XCDR2 */
+  dds_ostream_t ks_int, ks_gen;
+  dds_ostream_init (&ks_int, 0, xcdr_version);
+  dds_ostream_init (&ks_gen, 0, xcdr_version);
+  dds_stream_write_key (&ks_int, (const char *) &msg_wr, &type_int);
+  dds_stream_write_key (&ks_gen, (const char *) &msg_wr, &type_gen);
+  CU_ASSERT_FATAL (ks_gen.m_index == ks_int.m_index);
+  CU_ASSERT_FATAL (memcmp (ks_gen.m_buffer, ks_int.m_buffer, ks_int.m_index) == 0);
+  dds_ostream_fini (&ks_int);
+  dds_ostream_fini (&ks_gen);
+
+  dds_time_t tk_int = 0, tk_gen = 0;
+  for (int i = 0; i < niter; i++)
+  {
+    dds_istream_t is;
+    const dds_time_t t0 = dds_time ();
+    dds_istream_init (&is, os_int.m_index, os_int.m_buffer, xcdr_version);
+    dds_ostream_init (&ks_int, 0, CDR_ENC_VERSION_2);
+    dds_stream_extract_key_from_data (&is, &ks_int, &type_int);
+    const dds_time_t t1 = dds_time ();
+    dds_istream_init (&is, os_int.m_index, os_int.m_buffer, xcdr_version);
+    dds_ostream_init (&ks_gen, 0, CDR_ENC_VERSION_2);
+    dds_stream_extract_key_from_data (&is, &ks_gen, &type_gen);
+    const dds_time_t t2 = dds_time ();
+    tk_int += t1 - t0;
+    tk_gen += t2 - t1;
+    CU_ASSERT_FATAL (ks_gen.m_index == ks_int.m_index);
+    CU_ASSERT_FATAL (memcmp (ks_gen.m_buffer, ks_int.m_buffer, ks_int.m_index) == 0);
+    dds_ostream_fini (&ks_int);
+    dds_ostream_fini (&ks_gen);
+  }
+
+  printf ("generated_marshal xcdr%"PRIu32": %"PRIu32" bytes, interpreted/generated: write %.0f/%.0f ns, read %.0f/%.0f ns, extract key %.0f/%.0f ns\n",
+          xcdr_version == CDR_ENC_VERSION_1 ? 1u : 2u, os_int.m_index,
+          (double) tw_int / niter, (double) tw_gen / niter,
+          (double) tr_int / niter, (double) tr_gen / niter,
+          (double) tk_int / niter, (double) tk_gen / niter);
+
+  dds_ostream_fini (&os_int);
+  dds_ostream_fini (&os_gen);
+  ddsrt_free (type_int.type.keys.keys);
+  ddsrt_free (type_gen.type.keys.keys);
+}
@@ -25,11 +25,20 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <limits.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "dds/dds.h"
+#include "dds/ddsc/dds_statistics.h"
+#include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/misc.h"
 #include "dds/ddsrt/attributes.h"
+#include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/ddsi_filter_expr.h"
+#include "dds__reader.h"
+#include "dds__writer.h"
 
 #include "test_common.h"
 
@@ -769,3 +778,325 @@ CU_Test (ddsc_filter, sampleinfo)
   dds_delete (dp);
 }
 
+
+static const dds_filter_field_t type1_fields[] = {
+  { "long_1", offsetof (Space_Type1, long_1) },
+  { "long_2", offsetof (Space_Type1, long_2) },
+  { "long_3", offsetof (Space_Type1, long_3) }
+};
+
+CU_Test (ddsc_filter, expression)
+{
+  dds_entity_t dp, tp[2], rd[2], wr[2];
+  dds_return_t ret;
+  char topicname[100];
+  create_unique_topic_name ("ddsc_filter", topicname, sizeof (topicname));
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  dp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (dp > 0);
+  for (int i = 0; i < 2; i++)
+  {
+    tp[i] = dds_create_topic (dp, &Space_Type1_desc, topicname, qos, NULL);
+    CU_ASSERT_FATAL (tp[i] > 0);
+  }
+  const char *params[] = { "1" };
+  ret = dds_set_topic_filter_expression (tp[0], "long_2 = %0 OR (long_3 > 1 AND NOT long_2 BETWEEN 1 AND 5)", 3, type1_fields, 1, params);
+  CU_ASSERT_FATAL (ret == 0);
+  for (int i = 0; i < 2; i++)
+  {
+    rd[i] = dds_create_reader (dp, tp[i], qos, NULL);
+    CU_ASSERT_FATAL (rd[i] > 0);
+    wr[i] = dds_create_writer (dp, tp[i], qos, NULL);
+    CU_ASSERT_FATAL (wr[i] > 0);
+  }
+  dds_delete_qos (qos);
+
+  for (int i = 0; i < 2; i++)
+  {
+    const Space_Type1 xs[] = { {1,1,0}, {2,0,2}, {3,0,1}, {4,2,1} };
+    for (size_t k = 0; k < sizeof (xs) / sizeof (xs[0]); k++)
+    {
+      Space_Type1 x = xs[k];
+      x.long_1 += 10 * i;
+      ret = dds_write (wr[i], &x);
+      CU_ASSERT_FATAL (ret == 0);
+    }
+  }
+
+  // the filtering writer drops {3,0,1} and {4,2,1}, the filtering reader also
+  // drops those from the other writer
+  const struct exp exp[] = {
+    { .n = 4, .xs = (const Space_Type1[]) { {1,1,0}, {2,0,2}, {11,1,0}, {12,0,2} } },
+    { .n = 6, .xs = (const Space_Type1[]) { {1,1,0}, {2,0,2}, {11,1,0}, {12,0,2}, {13,0,1}, {14,2,1} } }
+  };
+  for (int i = 0; i < 2; i++)
+    checkdata (rd[i], &exp[i], "rd[%d]:", i);
+  dds_delete (dp);
+}
+
+/* returns prefix^n inner suffix^n */
+static char *filter_nested_expression (size_t n, const char *prefix, const char *inner, const char *suffix)
+{
+  const size_t lp = strlen (prefix), li = strlen (inner), ls = strlen (suffix);
+  char *s = ddsrt_malloc (n * (lp + ls) + li + 1), *q = s;
+  for (size_t i = 0; i < n; i++, q += lp)
+    memcpy (q, prefix, lp);
+  memcpy (q, inner, li);
+  q += li;
+  for (size_t i = 0; i < n; i++, q += ls)
+    memcpy (q, suffix, ls);
+  *q = 0;
+  return s;
+}
+
+CU_Test (ddsc_filter, expression_invalid)
+{
+  dds_entity_t dp, tp;
+  dds_return_t ret;
+  char topicname[100];
+  create_unique_topic_name ("ddsc_filter", topicname, sizeof (topicname));
+  dp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (dp > 0);
+  tp = dds_create_topic (dp, &Space_Type1_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (tp > 0);
+
+  const char *params[] = { "1", "'x'" };
+  static const char *invalid[] = {
+    "", "long_1", "long_1 = ", "long_1 = 1 AND", "(long_1 = 1", "long_1 = 1)",
+    "long_4 = 1", "long_1 = 'x'", "long_1 = %1", "long_1 = %2", "long_1 LIKE 'x'",
+    "long_1 NOT = 1", "long_1 BETWEEN 1", "long_1 = 'x", "long_1 = 1x"
+  };
+  for (size_t i = 0; i < sizeof (invalid) / sizeof (invalid[0]); i++)
+  {
+    ret = dds_set_topic_filter_expression (tp, invalid[i], 3, type1_fields, 2, params);
+    CU_ASSERT_FATAL (ret == DDS_RETCODE_BAD_PARAMETER);
+  }
+  ret = dds_set_topic_filter_expression (tp, "long_1 = %0 OR NOT (long_2 <> 3 AND long_3 >= -1.5)", 3, type1_fields, 2, params);
+  CU_ASSERT_FATAL (ret == 0);
+
+  /* nesting is limited to 64 levels of parentheses and NOT, long AND/OR chains are fine */
+  char *deep = filter_nested_expression (64, "(", "long_1 = 1", ")");
+  ret = dds_set_topic_filter_expression (tp, deep, 3, type1_fields, 0, NULL);
+  CU_ASSERT_FATAL (ret == 0);
+  ddsrt_free (deep);
+  deep = filter_nested_expression (65, "(", "long_1 = 1", ")");
+  ret = dds_set_topic_filter_expression (tp, deep, 3, type1_fields, 0, NULL);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_BAD_PARAMETER);
+  ddsrt_free (deep);
+  deep = filter_nested_expression (65000, "(", "long_1 = 1", ")");
+  ret = dds_set_topic_filter_expression (tp, deep, 3, type1_fields, 0, NULL);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_BAD_PARAMETER);
+  ddsrt_free (deep);
+  deep = filter_nested_expression (64, "NOT ", "long_1 = 1", "");
+  ret = dds_set_topic_filter_expression (tp, deep, 3, type1_fields, 0, NULL);
+  CU_ASSERT_FATAL (ret == 0);
+  ddsrt_free (deep);
+  deep = filter_nested_expression (65000, "NOT ", "long_1 = 1", "");
+  ret = dds_set_topic_filter_expression (tp, deep, 3, type1_fields, 0, NULL);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_BAD_PARAMETER);
+  ddsrt_free (deep);
+  deep = filter_nested_expression (20000, "long_1 = 1 AND ", "long_2 = 1", " OR long_3 = 1");
+  ret = dds_set_topic_filter_expression (tp, deep, 3, type1_fields, 0, NULL);
+  CU_ASSERT_FATAL (ret == 0);
+  ddsrt_free (deep);
+  ret = dds_set_topic_filter_expression (tp, NULL, 0, NULL, 0, NULL);
+  CU_ASSERT_FATAL (ret == 0);
+  ret = dds_set_topic_filter_expression (dp, "long_1 = 1", 3, type1_fields, 0, NULL);
+  CU_ASSERT_FATAL (ret == DDS_RETCODE_ILLEGAL_OPERATION);
+  dds_delete (dp);
+}
+
+CU_Test (ddsc_filter, expression_remote)
+{
+  /* a second domain with the same external domain id makes the writer see the reader as
+     a proxy reader, with the filter expression arriving through discovery */
+  const char *config = "<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>";
+  dds_entity_t dom[2], dp[2], tp[2], rd, wr;
+  dds_return_t ret;
+  char topicname[100];
+  create_unique_topic_name ("ddsc_filter", topicname, sizeof (topicname));
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  for (dds_domainid_t i = 0; i < 2; i++)
+  {
+    dom[i] = dds_create_domain (i, config);
+    CU_ASSERT_FATAL (dom[i] > 0);
+    dp[i] = dds_create_participant (i, NULL, NULL);
+    CU_ASSERT_FATAL (dp[i] > 0);
+    tp[i] = dds_create_topic (dp[i], &Space_Type1_desc, topicname, qos, NULL);
+    CU_ASSERT_FATAL (tp[i] > 0);
+  }
+  rd = dds_create_reader (dp[1], tp[1], qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  wr = dds_create_writer (dp[0], tp[0], qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  dds_delete_qos (qos);
+
+  // setting the filter after matching must still reach the remote writer
+  const char *params[] = { "2" };
+  ret = dds_set_topic_filter_expression (tp[1], "long_2 < %0", 3, type1_fields, 1, params);
+  CU_ASSERT_FATAL (ret == 0);
+
+  dds_publication_matched_status_t st;
+  dds_time_t tend = dds_time () + DDS_SECS (10);
+  do {
+    ret = dds_get_publication_matched_status (wr, &st);
+    CU_ASSERT_FATAL (ret == 0);
+    dds_sleepfor (DDS_MSECS (10));
+  } while (st.current_count == 0 && dds_time () < tend);
+  CU_ASSERT_FATAL (st.current_count == 1);
+  struct dds_statistics *stat = dds_create_statistics (wr);
+  const struct dds_stat_keyvalue *filtered_count = dds_lookup_statistic (stat, "filtered_count");
+  CU_ASSERT_FATAL (filtered_count != NULL);
+  tend = dds_time () + DDS_SECS (10);
+  do {
+    dds_sleepfor (DDS_MSECS (10));
+    ret = dds_write (wr, &(Space_Type1){ 0, 5, 0 });
+    CU_ASSERT_FATAL (ret == 0);
+    ret = dds_refresh_statistics (stat);
+    CU_ASSERT_FATAL (ret == 0);
+  } while (filtered_count->u.u32 == 0 && dds_time () < tend);
+  CU_ASSERT_FATAL (filtered_count->u.u32 > 0);
+  const uint32_t nfiltered = filtered_count->u.u32;
+
+  const Space_Type1 xs[] = { {1,1,0}, {2,2,2}, {3,0,1}, {4,3,1} };
+  for (size_t k = 0; k < sizeof (xs) / sizeof (xs[0]); k++)
+  {
+    ret = dds_write (wr, &xs[k]);
+    CU_ASSERT_FATAL (ret == 0);
+  }
+  // rejected samples are replaced by GAPs, so they don't stop the reader acknowledging
+  ret = dds_wait_for_acks (wr, DDS_SECS (5));
+  CU_ASSERT_FATAL (ret == 0);
+  ret = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (ret == 0);
+  CU_ASSERT_FATAL (filtered_count->u.u32 == nfiltered + 2);
+  dds_delete_statistics (stat);
+
+  // whatever made it through before the writer learnt of the filter got dropped
+  // by the reader, so only the accepted ones remain
+  const struct exp exp = {
+    .n = 2, .xs = (const Space_Type1[]) { {1,1,0}, {3,0,1} }
+  };
+  checkdata (rd, &exp, "rd:");
+  for (int i = 0; i < 2; i++)
+  {
+    ret = dds_delete (dom[i]);
+    CU_ASSERT_FATAL (ret == 0);
+  }
+}
+
+static uint32_t num_content_filtered_readers (dds_entity_t wr)
+{
+  dds_writer *wrent;
+  dds_return_t ret = dds_writer_lock (wr, &wrent);
+  CU_ASSERT_FATAL (ret == 0);
+  ddsrt_mutex_lock (&wrent->m_wr->e.lock);
+  const uint32_t n = wrent->m_wr->num_content_filtered_readers;
+  ddsrt_mutex_unlock (&wrent->m_wr->e.lock);
+  dds_writer_unlock (wrent);
+  return n;
+}
+
+static void wait_for_num_content_filtered_readers (dds_entity_t wr, uint32_t n)
+{
+  dds_time_t tend = dds_time () + DDS_SECS (10);
+  while (num_content_filtered_readers (wr) != n && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  CU_ASSERT_FATAL (num_content_filtered_readers (wr) == n);
+}
+
+CU_Test (ddsc_filter, expression_remote_too_deep)
+{
+  /* the nesting limit also protects against expressions arriving from remote readers:
+     a reader advertising one that is too deep still matches, with the filter ignored */
+  const char *config = "<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>";
+  dds_entity_t dom[2], dp[2], tp[2], rd, wr[2];
+  dds_return_t ret;
+  char topicname[100];
+  create_unique_topic_name ("ddsc_filter", topicname, sizeof (topicname));
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  for (dds_domainid_t i = 0; i < 2; i++)
+  {
+    dom[i] = dds_create_domain (i, config);
+    CU_ASSERT_FATAL (dom[i] > 0);
+    dp[i] = dds_create_participant (i, NULL, NULL);
+    CU_ASSERT_FATAL (dp[i] > 0);
+    tp[i] = dds_create_topic (dp[i], &Space_Type1_desc, topicname, qos, NULL);
+    CU_ASSERT_FATAL (tp[i] > 0);
+  }
+  const char *params[] = { "2" };
+  ret = dds_set_topic_filter_expression (tp[1], "long_2 < %0", 3, type1_fields, 1, params);
+  CU_ASSERT_FATAL (ret == 0);
+  wr[0] = dds_create_writer (dp[0], tp[0], qos, NULL);
+  CU_ASSERT_FATAL (wr[0] > 0);
+  rd = dds_create_reader (dp[1], tp[1], qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  wait_for_num_content_filtered_readers (wr[0], 1);
+
+  /* there is no way of setting an invalid expression through the API, so replace the
+     one published for the reader: this goes through discovery just like a malicious
+     peer's would, an update for the existing writer and a new match for the next one */
+  char *deep = filter_nested_expression (20000, "(", "1 < %0", ")");
+  char *deep_params[] = { "2" };
+  nn_content_filter_property_t prop = {
+    .cf_topic_name = topicname, .related_topic_name = topicname,
+    .filter_class_name = DDSI_FILTER_EXPR_CLASS_NAME, .filter_expression = deep,
+    .expression_parameters = { .n = 1, .strs = deep_params }
+  };
+  dds_reader *rdent;
+  ret = dds_reader_lock (rd, &rdent);
+  CU_ASSERT_FATAL (ret == 0);
+  thread_state_awake (lookup_thread_state (), &rdent->m_entity.m_domain->gv);
+  update_reader_content_filter (rdent->m_rd, &prop);
+  thread_state_asleep (lookup_thread_state ());
+  dds_reader_unlock (rdent);
+  ddsrt_free (deep);
+  wait_for_num_content_filtered_readers (wr[0], 0);
+
+  wr[1] = dds_create_writer (dp[0], tp[0], qos, NULL);
+  CU_ASSERT_FATAL (wr[1] > 0);
+  dds_delete_qos (qos);
+  dds_publication_matched_status_t st;
+  dds_time_t tend = dds_time () + DDS_SECS (10);
+  do {
+    ret = dds_get_publication_matched_status (wr[1], &st);
+    CU_ASSERT_FATAL (ret == 0);
+    dds_sleepfor (DDS_MSECS (10));
+  } while (st.current_count == 0 && dds_time () < tend);
+  CU_ASSERT_FATAL (st.current_count == 1);
+  CU_ASSERT_FATAL (num_content_filtered_readers (wr[1]) == 0);
+
+  /* without a filter on the writer side, everything gets sent and the reader
+     drops the rejected samples */
+  struct dds_statistics *stat = dds_create_statistics (wr[1]);
+  const struct dds_stat_keyvalue *filtered_count = dds_lookup_statistic (stat, "filtered_count");
+  CU_ASSERT_FATAL (filtered_count != NULL);
+  const Space_Type1 xs[] = { {1,1,0}, {2,2,2}, {3,0,1}, {4,3,1} };
+  for (size_t k = 0; k < sizeof (xs) / sizeof (xs[0]); k++)
+  {
+    ret = dds_write (wr[1], &xs[k]);
+    CU_ASSERT_FATAL (ret == 0);
+  }
+  ret = dds_wait_for_acks (wr[1], DDS_SECS (5));
+  CU_ASSERT_FATAL (ret == 0);
+  ret = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (ret == 0);
+  CU_ASSERT_FATAL (filtered_count->u.u32 == 0);
+  dds_delete_statistics (stat);
+
+  const struct exp exp = {
+    .n = 2, .xs = (const Space_Type1[]) { {1,1,0}, {3,0,1} }
+  };
+  checkdata (rd, &exp, "rd:");
+  for (int i = 0; i < 2; i++)
+  {
+    ret = dds_delete (dom[i]);
+    CU_ASSERT_FATAL (ret == 0);
+  }
+}
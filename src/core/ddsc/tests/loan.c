@@ -319,3 +319,95 @@ CU_Test (ddsc_loan, read_cleanup, .init = create_entities, .fini = delete_entiti
   result = dds_return_loan (reader, ptrs, n);
   CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
 }
+
+CU_Test (ddsc_loan, writer_without_shm)
+{
+  /* Without shared memory, loans are available for types of which the serialized
+     form is the in-memory representation: the loaned sample then is the payload */
+  char topicname[100];
+  dds_return_t result;
+  const dds_entity_t pp = dds_create_participant (DDS_DOMAIN_DEFAULT, NULL, NULL);
+  CU_ASSERT_FATAL (pp > 0);
+  create_unique_topic_name ("ddsc_writer_loan_test", topicname, sizeof topicname);
+  const dds_entity_t tp = dds_create_topic (pp, &Space_Type1_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (tp > 0);
+  create_unique_topic_name ("ddsc_writer_loan_test", topicname, sizeof topicname);
+  const dds_entity_t tp_str = dds_create_topic (pp, &Space_simpletypes_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (tp_str > 0);
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  const dds_entity_t wr = dds_create_writer (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  const dds_entity_t rd = dds_create_reader (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  const dds_entity_t wr_str = dds_create_writer (pp, tp_str, qos, NULL);
+  CU_ASSERT_FATAL (wr_str > 0);
+  dds_delete_qos (qos);
+
+  if (dds_is_shared_memory_available (wr))
+  {
+    dds_delete (pp);
+    return;
+  }
+
+  void *sample;
+  CU_ASSERT_FATAL (!dds_is_loan_available (wr_str));
+  result = dds_loan_sample (wr_str, &sample);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_UNSUPPORTED);
+  CU_ASSERT_FATAL (dds_is_loan_available (wr));
+
+  /* write loaned samples, including a dispose, which takes the key only */
+  for (int32_t i = 0; i < 3; i++)
+  {
+    result = dds_loan_sample (wr, &sample);
+    CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+    *(Space_Type1 *) sample = (Space_Type1) { i, 2 * i, 3 * i };
+    result = (i < 2) ? dds_write (wr, sample) : dds_dispose (wr, sample);
+    CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+  }
+  Space_Type1 rs[3];
+  void *ptrs[3] = { &rs[0], &rs[1], &rs[2] };
+  dds_sample_info_t si[3];
+  int32_t n = dds_take (rd, ptrs, si, 3, 3);
+  CU_ASSERT_FATAL (n == 3);
+  for (int32_t i = 0; i < n; i++)
+  {
+    CU_ASSERT_FATAL (rs[i].long_1 == i);
+    if (i < 2)
+    {
+      CU_ASSERT_FATAL (si[i].valid_data);
+      CU_ASSERT_FATAL (rs[i].long_2 == 2 * i && rs[i].long_3 == 3 * i);
+    }
+    else
+    {
+      CU_ASSERT_FATAL (!si[i].valid_data);
+      CU_ASSERT_FATAL (si[i].instance_state == DDS_NOT_ALIVE_DISPOSED_INSTANCE_STATE);
+    }
+  }
+
+  /* the number of outstanding loans is bounded, returning loans makes them available again */
+  void *loans[8];
+  for (size_t i = 0; i < sizeof (loans) / sizeof (loans[0]); i++)
+  {
+    result = dds_loan_sample (wr, &loans[i]);
+    CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+  }
+  result = dds_loan_sample (wr, &sample);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OUT_OF_RESOURCES);
+  result = dds_return_loan (wr, loans, 2);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (loans[0] == NULL && loans[1] == NULL);
+  result = dds_return_loan (wr, &loans[1], 1);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_BAD_PARAMETER);
+  Space_Type1 notloaned;
+  sample = &notloaned;
+  result = dds_return_loan (wr, &sample, 1);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_PRECONDITION_NOT_MET);
+  result = dds_loan_sample (wr, &sample);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+
+  /* outstanding loans are released when the writer is deleted */
+  result = dds_delete (pp);
+  CU_ASSERT_FATAL (result == DDS_RETCODE_OK);
+}
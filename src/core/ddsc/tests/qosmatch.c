@@ -497,3 +497,193 @@ CU_Test(ddsc_qosmatch, basic)
   rc = dds_delete (sub_dom);
   CU_ASSERT_FATAL (rc == 0);
 }
+
+static dds_entity_t qm_pp, qm_tp;
+
+static void qm_init (const char *name)
+{
+  char topicname[100];
+  qm_pp = dds_create_participant (DDS_DOMAIN_DEFAULT, NULL, NULL);
+  CU_ASSERT_FATAL (qm_pp > 0);
+  create_unique_topic_name (name, topicname, sizeof topicname);
+  qm_tp = dds_create_topic (qm_pp, &Space_Type1_desc, topicname, NULL, NULL);
+  CU_ASSERT_FATAL (qm_tp > 0);
+}
+
+static void qm_fini (void)
+{
+  dds_return_t rc = dds_delete (qm_pp);
+  CU_ASSERT_FATAL (rc == 0);
+}
+
+/* ps is a null-terminated list of partitions, or a null pointer for no partition QoS */
+static dds_entity_t qm_endpoint (bool isrd, const char **ps)
+{
+  dds_qos_t *qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  if (ps)
+  {
+    uint32_t n = 0;
+    while (ps[n])
+      n++;
+    dds_qset_partition (qos, n, ps);
+  }
+  const dds_entity_t pubsub = isrd ? dds_create_subscriber (qm_pp, qos, NULL) : dds_create_publisher (qm_pp, qos, NULL);
+  CU_ASSERT_FATAL (pubsub > 0);
+  dds_delete_qos (qos);
+  const dds_entity_t ep = isrd ? dds_create_reader (pubsub, qm_tp, NULL, NULL) : dds_create_writer (pubsub, qm_tp, NULL, NULL);
+  CU_ASSERT_FATAL (ep > 0);
+  return ep;
+}
+
+static uint32_t qm_matched (bool isrd, dds_entity_t ep)
+{
+  dds_return_t rc;
+  if (isrd)
+  {
+    dds_subscription_matched_status_t st;
+    rc = dds_get_subscription_matched_status (ep, &st);
+    CU_ASSERT_FATAL (rc == 0);
+    return st.current_count;
+  }
+  else
+  {
+    dds_publication_matched_status_t st;
+    rc = dds_get_publication_matched_status (ep, &st);
+    CU_ASSERT_FATAL (rc == 0);
+    return st.current_count;
+  }
+}
+
+static void qm_partitions (bool readers_first)
+{
+  static const char *p_empty[] = { "", NULL };
+  static const char *p_ab[] = { "a", "b", NULL };
+  static const char *p_xstar[] = { "x*", NULL };
+  static const char *p_xyz[] = { "xyz", NULL };
+  static const char *p_ba[] = { "b", "a", NULL };
+  static const char *p_abxyz[] = { "a", "b", "xyz", NULL };
+  static const char *p_xqz[] = { "x?z", NULL };
+  static const char *p_star[] = { "*", NULL };
+  static const char *p_aa[] = { "a", "a", NULL };
+  static const char *p_b[] = { "b", NULL };
+  static const char **wrps[] = { NULL, p_empty, p_ab, p_xstar, p_xyz };
+  static const char **rdps[] = { NULL, p_empty, p_ba, p_abxyz, p_xqz, p_star, p_aa };
+#define NWR (sizeof (wrps) / sizeof (wrps[0]))
+#define NRD (sizeof (rdps) / sizeof (rdps[0]))
+  /* - no partition and the one partition "" are the same thing
+     - readers and writers in more than one of the same partitions match only once
+     - wildcards match names, but not other wildcards
+     - "*" also matches the default partition */
+  static const uint32_t wrexp[NWR] = { 3, 3, 4, 1, 3 };
+  static const uint32_t rdexp[NRD] = { 2, 2, 1, 3, 1, 4, 1 };
+  dds_entity_t wrs[NWR], rds[NRD];
+
+  qm_init ("ddsc_qosmatch_partitions");
+  for (int pass = 0; pass < 2; pass++)
+  {
+    if (pass == (readers_first ? 0 : 1))
+      for (size_t i = 0; i < NRD; i++)
+        rds[i] = qm_endpoint (true, rdps[i]);
+    else
+      for (size_t i = 0; i < NWR; i++)
+        wrs[i] = qm_endpoint (false, wrps[i]);
+  }
+  for (size_t i = 0; i < NWR; i++)
+    CU_ASSERT (qm_matched (false, wrs[i]) == wrexp[i]);
+  for (size_t i = 0; i < NRD; i++)
+    CU_ASSERT (qm_matched (true, rds[i]) == rdexp[i]);
+
+  /* deleting the writer in "a" and "b" unmatches it everywhere */
+  dds_return_t rc = dds_delete (wrs[2]);
+  CU_ASSERT_FATAL (rc == 0);
+  CU_ASSERT (qm_matched (true, rds[2]) == 0);
+  CU_ASSERT (qm_matched (true, rds[3]) == 2);
+  CU_ASSERT (qm_matched (true, rds[5]) == 3);
+  CU_ASSERT (qm_matched (true, rds[6]) == 0);
+  /* a new writer in one of those partitions must still find the readers */
+  wrs[2] = qm_endpoint (false, p_b);
+  CU_ASSERT (qm_matched (false, wrs[2]) == 3);
+  CU_ASSERT (qm_matched (true, rds[2]) == 1);
+  CU_ASSERT (qm_matched (true, rds[3]) == 3);
+  CU_ASSERT (qm_matched (true, rds[6]) == 0);
+  /* likewise for the only reader matching the wildcard writer */
+  rc = dds_delete (rds[3]);
+  CU_ASSERT_FATAL (rc == 0);
+  CU_ASSERT (qm_matched (false, wrs[3]) == 0);
+  CU_ASSERT (qm_matched (false, wrs[4]) == 2);
+  rds[3] = qm_endpoint (true, p_xyz);
+  CU_ASSERT (qm_matched (false, wrs[3]) == 1);
+  CU_ASSERT (qm_matched (false, wrs[4]) == 3);
+  qm_fini ();
+#undef NRD
+#undef NWR
+}
+
+CU_Test(ddsc_qosmatch, partitions_writers_first)
+{
+  qm_partitions (false);
+}
+
+CU_Test(ddsc_qosmatch, partitions_readers_first)
+{
+  qm_partitions (true);
+}
+
+CU_Test(ddsc_qosmatch, verdict_cache_reset)
+{
+  /* Readers and writers that all have different QoS, such that the number of
+     pairs of QoS combinations exceeds the number of matching outcomes that
+     are cached (65536), forcing the cache to be emptied at some point. */
+#define NWR 256
+#define NRD 257
+  static dds_entity_t wrs[NWR];
+  dds_qos_t *qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_return_t rc;
+
+  qm_init ("ddsc_qosmatch_verdict_cache_reset");
+  for (int i = 0; i < NWR; i++)
+  {
+    dds_qset_latency_budget (qos, 1000 + i);
+    wrs[i] = dds_create_writer (qm_pp, qm_tp, qos, NULL);
+    CU_ASSERT_FATAL (wrs[i] > 0);
+  }
+  /* a reader's latency budget must be at least that of the writer: none match */
+  for (int i = 0; i < NRD; i++)
+  {
+    dds_requested_incompatible_qos_status_t st;
+    dds_qset_latency_budget (qos, i);
+    const dds_entity_t rd = dds_create_reader (qm_pp, qm_tp, qos, NULL);
+    CU_ASSERT_FATAL (rd > 0);
+    CU_ASSERT_FATAL (qm_matched (true, rd) == 0);
+    rc = dds_get_requested_incompatible_qos_status (rd, &st);
+    CU_ASSERT_FATAL (rc == 0);
+    CU_ASSERT_FATAL (st.total_count == NWR && st.last_policy_id == DDS_LATENCYBUDGET_QOS_POLICY_ID);
+  }
+  /* repeat with QoS for which the outcome was cached before it was emptied, and
+     one that matches everything */
+  for (int i = 0; i < 2; i++)
+  {
+    dds_requested_incompatible_qos_status_t st;
+    dds_qset_latency_budget (qos, (i == 0) ? 0 : 2000);
+    const dds_entity_t rd = dds_create_reader (qm_pp, qm_tp, qos, NULL);
+    CU_ASSERT_FATAL (rd > 0);
+    rc = dds_get_requested_incompatible_qos_status (rd, &st);
+    CU_ASSERT_FATAL (rc == 0);
+    CU_ASSERT (qm_matched (true, rd) == ((i == 0) ? 0 : NWR));
+    CU_ASSERT (st.total_count == ((i == 0) ? NWR : 0));
+  }
+  for (int i = 0; i < NWR; i++)
+  {
+    dds_offered_incompatible_qos_status_t st;
+    rc = dds_get_offered_incompatible_qos_status (wrs[i], &st);
+    CU_ASSERT_FATAL (rc == 0);
+    CU_ASSERT (st.total_count == NRD + 1);
+    CU_ASSERT (qm_matched (false, wrs[i]) == 1);
+  }
+  dds_delete_qos (qos);
+  qm_fini ();
+#undef NRD
+#undef NWR
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/io.h"
+
+#include "test_common.h"
+
+/* Two domains in a single process that talk to each other over the network,
+   with the receive threads reading datagrams in batches.  Without security
+   this exercises the "plain" path of the batch decoding, with security (if
+   enabled in the build) the topic is not protected and so it does the same. */
+static void recvbatch_roundtrip (const char *batchconf, uint32_t nsamples)
+{
+  char *config;
+  dds_entity_t pub_dom, sub_dom;
+  (void) ddsrt_asprintf (&config, "<Internal>%s</Internal>", batchconf);
+  create_domain_pair (config, NULL, &pub_dom, &sub_dom);
+  ddsrt_free (config);
+
+  const dds_entity_t pub_pp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pub_pp > 0);
+  const dds_entity_t sub_pp = dds_create_participant (1, NULL, NULL);
+  CU_ASSERT_FATAL (sub_pp > 0);
+
+  char tpname[100];
+  create_unique_topic_name ("ddsc_recvbatch", tpname, sizeof (tpname));
+  dds_qos_t * const qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  const dds_entity_t pub_tp = dds_create_topic (pub_pp, &Space_Type1_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (pub_tp > 0);
+  const dds_entity_t sub_tp = dds_create_topic (sub_pp, &Space_Type1_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (sub_tp > 0);
+  const dds_entity_t wr = dds_create_writer (pub_pp, pub_tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  const dds_entity_t rd = dds_create_reader (sub_pp, sub_tp, qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_delete_qos (qos);
+
+  dds_return_t rc;
+  wait_for_publication_matched (wr, 1, DDS_SECS (10));
+
+  /* Bursts of small samples without waiting in between is what makes multiple
+     datagrams be waiting in the socket buffer on the receiving side */
+  for (uint32_t i = 0; i < nsamples; i++)
+  {
+    rc = dds_write (wr, &(Space_Type1){ (int32_t) (i % 7), (int32_t) i, 0 });
+    CU_ASSERT_FATAL (rc == 0);
+  }
+  rc = dds_wait_for_acks (wr, DDS_SECS (10));
+  CU_ASSERT_FATAL (rc == 0);
+
+  /* KEEP_ALL and reliable, so every sample must arrive, and in order per instance */
+  int32_t last[7];
+  for (int i = 0; i < 7; i++)
+    last[i] = -1;
+  uint32_t nseen = 0;
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  while (nseen < nsamples && dds_time () < tend)
+  {
+    Space_Type1 s;
+    void *raw = &s;
+    dds_sample_info_t si;
+    if ((rc = dds_take (rd, &raw, &si, 1, 1)) == 0)
+      dds_sleepfor (DDS_MSECS (10));
+    else
+    {
+      CU_ASSERT_FATAL (rc == 1);
+      CU_ASSERT_FATAL (si.valid_data);
+      CU_ASSERT_FATAL (s.long_1 >= 0 && s.long_1 < 7);
+      CU_ASSERT_FATAL (s.long_2 > last[s.long_1]);
+      last[s.long_1] = s.long_2;
+      nseen++;
+    }
+  }
+  CU_ASSERT (nseen == nsamples);
+
+  rc = dds_delete (pub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_delete (sub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+}
+
+CU_Test (ddsc_recvbatch, plain)
+{
+  recvbatch_roundtrip ("<ReceiveBatchSize>16</ReceiveBatchSize>", 10000);
+}
+
+CU_Test (ddsc_recvbatch, single_thread)
+{
+  recvbatch_roundtrip ("<ReceiveBatchSize>64</ReceiveBatchSize><MultipleReceiveThreads>false</MultipleReceiveThreads>", 10000);
+}
@@ -0,0 +1,511 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/threads.h"
+
+#include "test_common.h"
+
+/* Readers with the default QoS (KEEP_LAST 1, BY_RECEPTION, SHARED, infinite
+   deadline) store plain writes from the single writer of an instance without
+   taking the RHC lock, and merge these into the history when it is accessed.
+   The trace shows when that happens, so these tests can check that they
+   really exercise that path. The domain is created with an explicit
+   configuration because enabling RHC checks disables the lock-free path. */
+
+#define MAXS 512
+
+static ddsrt_atomic_uint32_t n_merged = DDSRT_ATOMIC_UINT32_INIT (0);
+
+static void logsink (void *varg, const dds_log_data_t *msg)
+{
+  (void) varg;
+  if (strstr (msg->message, " merge pending:"))
+    ddsrt_atomic_inc32 (&n_merged);
+}
+
+static dds_entity_t dom, pp, tp;
+static Space_Type1 buf[MAXS];
+static void *ptrs[MAXS];
+static dds_sample_info_t si[MAXS];
+
+static void fastpath_init_common (const char *config)
+{
+  for (int i = 0; i < MAXS; i++)
+    ptrs[i] = &buf[i];
+  dom = dds_create_domain (0, config);
+  CU_ASSERT_FATAL (dom > 0);
+  pp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pp > 0);
+  char tpname[100];
+  create_unique_topic_name ("ddsc_rhc_fastpath", tpname, sizeof (tpname));
+  tp = dds_create_topic (pp, &Space_Type1_desc, tpname, NULL, NULL);
+  CU_ASSERT_FATAL (tp > 0);
+}
+
+static void fastpath_init (void)
+{
+  ddsrt_atomic_st32 (&n_merged, 0);
+  dds_set_trace_sink (logsink, NULL);
+  fastpath_init_common ("<Tracing><Category>rhc</Category><OutputFile>stderr</OutputFile></Tracing>");
+}
+
+static void fastpath_init_notrace (void)
+{
+  fastpath_init_common ("");
+}
+
+static void fastpath_fini (void)
+{
+  dds_return_t rc = dds_delete (dom);
+  CU_ASSERT_FATAL (rc == 0);
+  dds_set_trace_sink (NULL, NULL);
+}
+
+static void write_key (dds_entity_t wr, int32_t key, int32_t value)
+{
+  dds_return_t rc = dds_write (wr, &(Space_Type1){ key, value, 0 });
+  CU_ASSERT_FATAL (rc == 0);
+}
+
+/* reads or takes the single sample of instance "key" via reader or condition
+   "rdc" (of reader "rd") and checks its contents */
+static void check_one_cond (dds_entity_t rd, dds_entity_t rdc, bool take, int32_t key, int32_t value, dds_sample_state_t sst, dds_view_state_t vst, dds_instance_state_t ist)
+{
+  const dds_instance_handle_t ih = dds_lookup_instance (rd, &(Space_Type1){ key, 0, 0 });
+  CU_ASSERT_FATAL (ih != 0);
+  const dds_return_t n = take ? dds_take_instance (rdc, ptrs, si, MAXS, MAXS, ih) : dds_read_instance (rdc, ptrs, si, MAXS, MAXS, ih);
+  CU_ASSERT_FATAL (n == 1);
+  CU_ASSERT (si[0].valid_data);
+  CU_ASSERT (buf[0].long_1 == key && buf[0].long_2 == value);
+  CU_ASSERT (si[0].sample_state == sst);
+  CU_ASSERT (si[0].view_state == vst);
+  CU_ASSERT (si[0].instance_state == ist);
+}
+
+static void check_one (dds_entity_t rd, bool take, int32_t key, int32_t value, dds_sample_state_t sst, dds_view_state_t vst, dds_instance_state_t ist)
+{
+  check_one_cond (rd, rd, take, key, value, sst, vst, ist);
+}
+
+#define NINST 300 /* more than the direct-mapped cache of instances holds */
+
+CU_Test (ddsc_rhc_fastpath, store_read_take, .init = fastpath_init, .fini = fastpath_fini)
+{
+  const dds_entity_t wr = dds_create_writer (pp, tp, NULL, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  const dds_entity_t rd = dds_create_reader (pp, tp, NULL, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_return_t n;
+
+  for (int32_t v = 0; v < 3; v++)
+    for (int32_t k = 0; k < NINST; k++)
+      write_key (wr, k, v);
+  n = dds_read (rd, ptrs, si, MAXS, MAXS);
+  CU_ASSERT_FATAL (n == NINST);
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_merged) > 0);
+  for (int32_t i = 0; i < n; i++)
+  {
+    CU_ASSERT (si[i].valid_data && buf[i].long_2 == 2);
+    CU_ASSERT (si[i].sample_state == DDS_SST_NOT_READ && si[i].view_state == DDS_VST_NEW && si[i].instance_state == DDS_IST_ALIVE);
+  }
+
+  /* a new sample replaces the one already read */
+  const uint32_t n_merged_before = ddsrt_atomic_ld32 (&n_merged);
+  for (int32_t k = 0; k < NINST; k++)
+    write_key (wr, k, 3);
+  n = dds_read (rd, ptrs, si, MAXS, MAXS);
+  CU_ASSERT_FATAL (n == NINST);
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_merged) > n_merged_before);
+  for (int32_t i = 0; i < n; i++)
+    CU_ASSERT (buf[i].long_2 == 3 && si[i].sample_state == DDS_SST_NOT_READ && si[i].view_state == DDS_VST_OLD);
+  n = dds_read (rd, ptrs, si, MAXS, MAXS);
+  CU_ASSERT_FATAL (n == NINST);
+  for (int32_t i = 0; i < n; i++)
+    CU_ASSERT (buf[i].long_2 == 3 && si[i].sample_state == DDS_SST_READ);
+
+  n = dds_take (rd, ptrs, si, MAXS, MAXS);
+  CU_ASSERT_FATAL (n == NINST);
+  n = dds_take (rd, ptrs, si, MAXS, MAXS);
+  CU_ASSERT_FATAL (n == 0);
+
+  /* and storing into an empty instance works as well */
+  for (int32_t v = 4; v < 6; v++)
+    write_key (wr, 7, v);
+  check_one (rd, true, 7, 5, DDS_SST_NOT_READ, DDS_VST_OLD, DDS_IST_ALIVE);
+  n = dds_take (rd, ptrs, si, MAXS, MAXS);
+  CU_ASSERT_FATAL (n == 0);
+}
+
+static bool filter_even (const void *vs)
+{
+  const Space_Type1 *s = vs;
+  return (s->long_2 % 2) == 0;
+}
+
+static void data_available (dds_entity_t rd, void *varg)
+{
+  (void) rd;
+  ddsrt_atomic_inc32 (varg);
+}
+
+CU_Test (ddsc_rhc_fastpath, conditions, .init = fastpath_init, .fini = fastpath_fini)
+{
+  ddsrt_atomic_uint32_t n_data_available = DDSRT_ATOMIC_UINT32_INIT (0);
+  dds_listener_t * const list = dds_create_listener (&n_data_available);
+  CU_ASSERT_FATAL (list != NULL);
+  dds_lset_data_available (list, data_available);
+  const dds_entity_t wr = dds_create_writer (pp, tp, NULL, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  const dds_entity_t rd = dds_create_reader (pp, tp, NULL, list);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_delete_listener (list);
+  const dds_entity_t ws = dds_create_waitset (pp);
+  CU_ASSERT_FATAL (ws > 0);
+  dds_return_t rc;
+
+  /* the listener gets invoked for every sample, however it is stored */
+  for (int32_t v = 0; v < 10; v++)
+    write_key (wr, 0, v);
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_data_available) == 10);
+
+  /* adding a condition merges the pending sample first, so it triggers */
+  const dds_entity_t rdcond = dds_create_readcondition (rd, DDS_NOT_READ_SAMPLE_STATE);
+  CU_ASSERT_FATAL (rdcond > 0);
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_merged) > 0);
+  rc = dds_waitset_attach (ws, rdcond, rdcond);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_waitset_wait (ws, NULL, 0, 0);
+  CU_ASSERT (rc == 1);
+  check_one_cond (rd, rdcond, false, 0, 9, DDS_SST_NOT_READ, DDS_VST_NEW, DDS_IST_ALIVE);
+  rc = dds_waitset_wait (ws, NULL, 0, 0);
+  CU_ASSERT (rc == 0);
+
+  /* with a condition present every store must go through the locked path
+     and update the condition */
+  const uint32_t n_merged_before = ddsrt_atomic_ld32 (&n_merged);
+  for (int32_t v = 10; v < 20; v++)
+  {
+    write_key (wr, 0, v);
+    rc = dds_waitset_wait (ws, NULL, 0, 0);
+    CU_ASSERT_FATAL (rc == 1);
+    check_one_cond (rd, rdcond, false, 0, v, DDS_SST_NOT_READ, DDS_VST_OLD, DDS_IST_ALIVE);
+  }
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_merged) == n_merged_before);
+  rc = dds_delete (rdcond);
+  CU_ASSERT_FATAL (rc == 0);
+
+  /* without conditions the lock-free path gets used again, and a query
+     condition created afterwards sees the latest sample */
+  for (int32_t v = 20; v < 30; v++)
+    write_key (wr, 0, v);
+  const dds_entity_t qcond = dds_create_querycondition (rd, DDS_ANY_STATE, filter_even);
+  CU_ASSERT_FATAL (qcond > 0);
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_merged) > n_merged_before);
+  rc = dds_waitset_attach (ws, qcond, qcond);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_waitset_wait (ws, NULL, 0, 0);
+  CU_ASSERT (rc == 0);
+  write_key (wr, 0, 30);
+  rc = dds_waitset_wait (ws, NULL, 0, 0);
+  CU_ASSERT (rc == 1);
+  check_one_cond (rd, qcond, true, 0, 30, DDS_SST_NOT_READ, DDS_VST_OLD, DDS_IST_ALIVE);
+  rc = dds_delete (qcond);
+  CU_ASSERT_FATAL (rc == 0);
+
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_data_available) == 31);
+
+  /* a waitset on the data available status triggers for lock-free stores
+     (the listener would reset the status, so it needs to go) */
+  rc = dds_set_listener (rd, NULL);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_set_status_mask (rd, DDS_DATA_AVAILABLE_STATUS);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_waitset_attach (ws, rd, rd);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_waitset_wait (ws, NULL, 0, 0);
+  CU_ASSERT (rc == 0);
+  for (int32_t v = 31; v < 33; v++)
+    write_key (wr, 0, v);
+  rc = dds_waitset_wait (ws, NULL, 0, 0);
+  CU_ASSERT (rc == 1);
+  check_one (rd, true, 0, 32, DDS_SST_NOT_READ, DDS_VST_OLD, DDS_IST_ALIVE);
+}
+
+CU_Test (ddsc_rhc_fastpath, dispose_unregister, .init = fastpath_init, .fini = fastpath_fini)
+{
+  /* unregistering must not imply disposing for this test */
+  dds_qos_t * const qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_qset_writer_data_lifecycle (qos, false);
+  const dds_entity_t wr = dds_create_writer (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  dds_delete_qos (qos);
+  const dds_entity_t rd = dds_create_reader (pp, tp, NULL, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_return_t rc;
+
+  /* disposing keeps the last sample, whether it was pending or not */
+  for (int32_t v = 0; v < 3; v++)
+    write_key (wr, 0, v);
+  rc = dds_dispose (wr, &(Space_Type1){ 0, 0, 0 });
+  CU_ASSERT_FATAL (rc == 0);
+  check_one (rd, false, 0, 2, DDS_SST_NOT_READ, DDS_VST_NEW, DDS_IST_NOT_ALIVE_DISPOSED);
+
+  /* writing again makes it alive again, after which it becomes eligible for
+     lock-free stores again */
+  for (int32_t v = 3; v < 6; v++)
+    write_key (wr, 0, v);
+  check_one (rd, false, 0, 5, DDS_SST_NOT_READ, DDS_VST_NEW, DDS_IST_ALIVE);
+
+  /* same for unregistering */
+  for (int32_t v = 6; v < 9; v++)
+    write_key (wr, 0, v);
+  rc = dds_unregister_instance (wr, &(Space_Type1){ 0, 0, 0 });
+  CU_ASSERT_FATAL (rc == 0);
+  check_one (rd, false, 0, 8, DDS_SST_NOT_READ, DDS_VST_OLD, DDS_IST_NOT_ALIVE_NO_WRITERS);
+  for (int32_t v = 9; v < 12; v++)
+    write_key (wr, 0, v);
+  check_one (rd, false, 0, 11, DDS_SST_NOT_READ, DDS_VST_NEW, DDS_IST_ALIVE);
+
+  /* after taking the data and disposing, all that remains is an invalid sample */
+  for (int32_t v = 12; v < 15; v++)
+    write_key (wr, 0, v);
+  check_one (rd, true, 0, 14, DDS_SST_NOT_READ, DDS_VST_OLD, DDS_IST_ALIVE);
+  rc = dds_dispose (wr, &(Space_Type1){ 0, 0, 0 });
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_take (rd, ptrs, si, MAXS, MAXS);
+  CU_ASSERT_FATAL (rc == 1);
+  CU_ASSERT (!si[0].valid_data && si[0].instance_state == DDS_IST_NOT_ALIVE_DISPOSED);
+
+  /* deleting the writer unregisters all its instances */
+  for (int32_t v = 15; v < 18; v++)
+    write_key (wr, 1, v);
+  rc = dds_delete (wr);
+  CU_ASSERT_FATAL (rc == 0);
+  check_one (rd, false, 1, 17, DDS_SST_NOT_READ, DDS_VST_NEW, DDS_IST_NOT_ALIVE_NO_WRITERS);
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_merged) > 0);
+}
+
+CU_Test (ddsc_rhc_fastpath, switch_paths, .init = fastpath_init, .fini = fastpath_fini)
+{
+  dds_qos_t * const qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_qset_writer_data_lifecycle (qos, false);
+  const dds_entity_t wr1 = dds_create_writer (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (wr1 > 0);
+  const dds_entity_t wr2 = dds_create_writer (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (wr2 > 0);
+  const dds_entity_t rd = dds_create_reader (pp, tp, NULL, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_instance_handle_t wr1_ih, wr2_ih;
+  dds_return_t rc;
+  rc = dds_get_instance_handle (wr1, &wr1_ih);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_get_instance_handle (wr2, &wr2_ih);
+  CU_ASSERT_FATAL (rc == 0);
+
+  /* alternating between one and two writers for an instance switches
+     between lock-free and locked stores, the result must always be the
+     latest sample and its writer */
+  for (int32_t round = 0; round < 5; round++)
+  {
+    const int32_t v = 10 * round;
+    write_key (wr1, 0, v);
+    write_key (wr1, 0, v + 1);
+    check_one (rd, false, 0, v + 1, DDS_SST_NOT_READ, (round == 0) ? DDS_VST_NEW : DDS_VST_OLD, DDS_IST_ALIVE);
+    CU_ASSERT (si[0].publication_handle == wr1_ih);
+    write_key (wr1, 0, v + 2);
+    write_key (wr2, 0, v + 3);
+    check_one (rd, false, 0, v + 3, DDS_SST_NOT_READ, DDS_VST_OLD, DDS_IST_ALIVE);
+    CU_ASSERT (si[0].publication_handle == wr2_ih);
+    write_key (wr1, 0, v + 4);
+    write_key (wr1, 0, v + 5);
+    check_one (rd, false, 0, v + 5, DDS_SST_NOT_READ, DDS_VST_OLD, DDS_IST_ALIVE);
+    CU_ASSERT (si[0].publication_handle == wr1_ih);
+    rc = dds_unregister_instance (wr2, &(Space_Type1){ 0, 0, 0 });
+    CU_ASSERT_FATAL (rc == 0);
+  }
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_merged) > 0);
+
+  /* changing the history depth is not allowed, and so a reader that isn't
+     eligible for the lock-free path must behave the same */
+  dds_reset_qos (qos);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_LAST, 2);
+  const dds_entity_t rd2 = dds_create_reader (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (rd2 > 0);
+  dds_delete_qos (qos);
+  for (int32_t v = 100; v < 103; v++)
+    write_key (wr1, 1, v);
+  rc = dds_take (rd2, ptrs, si, MAXS, MAXS);
+  CU_ASSERT_FATAL (rc == 2);
+  CU_ASSERT (buf[0].long_2 == 101 && buf[1].long_2 == 102);
+  check_one (rd, true, 1, 102, DDS_SST_NOT_READ, DDS_VST_NEW, DDS_IST_ALIVE);
+}
+
+CU_Test (ddsc_rhc_fastpath, resource_limits, .init = fastpath_init, .fini = fastpath_fini)
+{
+  /* a sample for an instance of which the previous sample was taken adds a
+     sample and so may be rejected if the reader is at max_samples: that must
+     raise SAMPLE_REJECTED, and so readers with resource limits don't use the
+     lock-free path (best-effort because local delivery of reliable data
+     retries rejected samples) */
+  dds_qos_t * const qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_qset_reliability (qos, DDS_RELIABILITY_BEST_EFFORT, 0);
+  const dds_entity_t wr = dds_create_writer (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  dds_qset_resource_limits (qos, 1, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED);
+  const dds_entity_t rd = dds_create_reader (pp, tp, qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_delete_qos (qos);
+  dds_sample_rejected_status_t st;
+  dds_return_t rc;
+
+  write_key (wr, 0, 0);
+  write_key (wr, 0, 1);
+  check_one (rd, true, 0, 1, DDS_SST_NOT_READ, DDS_VST_NEW, DDS_IST_ALIVE);
+  write_key (wr, 1, 2);
+  write_key (wr, 0, 3);
+  rc = dds_get_sample_rejected_status (rd, &st);
+  CU_ASSERT_FATAL (rc == 0);
+  CU_ASSERT (st.total_count == 1 && st.last_reason == DDS_REJECTED_BY_SAMPLES_LIMIT);
+  rc = dds_take (rd, ptrs, si, MAXS, MAXS);
+  CU_ASSERT_FATAL (rc == 1);
+  CU_ASSERT (buf[0].long_1 == 1 && buf[0].long_2 == 2);
+
+  /* once there is room again, it gets stored */
+  write_key (wr, 0, 4);
+  check_one (rd, true, 0, 4, DDS_SST_NOT_READ, DDS_VST_OLD, DDS_IST_ALIVE);
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_merged) == 0);
+}
+
+#define STRESS_NWRITERS 3
+#define STRESS_NKEYS 50
+#define STRESS_NSAMPLES 20000
+
+struct stress_arg {
+  dds_entity_t wr;
+  dds_entity_t rd;
+  int32_t id;
+  ddsrt_atomic_uint32_t *stop;
+  ddsrt_atomic_uint32_t errors;
+};
+
+static uint32_t stress_writer (void *varg)
+{
+  struct stress_arg * const arg = varg;
+  for (int32_t i = 0; i < STRESS_NSAMPLES; i++)
+  {
+    const int32_t key = arg->id * STRESS_NKEYS + (i % STRESS_NKEYS);
+    if (dds_write (arg->wr, &(Space_Type1){ key, i, arg->id }) != 0)
+      ddsrt_atomic_inc32 (&arg->errors);
+  }
+  return 0;
+}
+
+static uint32_t stress_toggler (void *varg)
+{
+  /* creating and deleting a read condition switches all instances between
+     the lock-free and the locked path */
+  struct stress_arg * const arg = varg;
+  while (!ddsrt_atomic_ld32 (arg->stop))
+  {
+    const dds_entity_t rdcond = dds_create_readcondition (arg->rd, DDS_ANY_STATE);
+    if (rdcond < 0 || dds_delete (rdcond) != 0)
+      ddsrt_atomic_inc32 (&arg->errors);
+    dds_sleepfor (DDS_USECS (100));
+  }
+  return 0;
+}
+
+static int32_t stress_last[STRESS_NWRITERS * STRESS_NKEYS];
+
+static bool stress_take (dds_entity_t rd)
+{
+  /* per key, the values must only ever go up */
+  const dds_return_t n = dds_take (rd, ptrs, si, MAXS, MAXS);
+  if (n < 0)
+    return false;
+  for (int32_t i = 0; i < n; i++)
+  {
+    if (!si[i].valid_data)
+      continue;
+    const int32_t key = buf[i].long_1;
+    if (key < 0 || key >= STRESS_NWRITERS * STRESS_NKEYS || buf[i].long_3 != key / STRESS_NKEYS)
+      return false;
+    if (buf[i].long_2 <= stress_last[key] || buf[i].long_2 % STRESS_NKEYS != key % STRESS_NKEYS)
+      return false;
+    stress_last[key] = buf[i].long_2;
+  }
+  return true;
+}
+
+CU_Test (ddsc_rhc_fastpath, stress, .init = fastpath_init_notrace, .fini = fastpath_fini)
+{
+  ddsrt_atomic_uint32_t stop = DDSRT_ATOMIC_UINT32_INIT (0);
+  struct stress_arg args[STRESS_NWRITERS + 1];
+  ddsrt_thread_t tids[STRESS_NWRITERS + 1];
+  ddsrt_threadattr_t tattr;
+  dds_return_t rc;
+
+  const dds_entity_t rd = dds_create_reader (pp, tp, NULL, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  for (int32_t k = 0; k < STRESS_NWRITERS * STRESS_NKEYS; k++)
+    stress_last[k] = -1;
+  ddsrt_threadattr_init (&tattr);
+  for (int32_t i = 0; i <= STRESS_NWRITERS; i++)
+  {
+    args[i].wr = (i < STRESS_NWRITERS) ? dds_create_writer (pp, tp, NULL, NULL) : 0;
+    CU_ASSERT_FATAL (i == STRESS_NWRITERS || args[i].wr > 0);
+    args[i].rd = rd;
+    args[i].id = i;
+    args[i].stop = &stop;
+    ddsrt_atomic_st32 (&args[i].errors, 0);
+  }
+  for (int32_t i = 0; i <= STRESS_NWRITERS; i++)
+  {
+    rc = ddsrt_thread_create (&tids[i], (i < STRESS_NWRITERS) ? "stress_wr" : "stress_toggle", &tattr, (i < STRESS_NWRITERS) ? stress_writer : stress_toggler, &args[i]);
+    CU_ASSERT_FATAL (rc == 0);
+  }
+
+  /* the main thread is the reader, until it has seen the last sample for
+     every key, which is the only one >= STRESS_NSAMPLES - STRESS_NKEYS */
+  const dds_time_t tend = dds_time () + DDS_SECS (60);
+  bool ok = true, done;
+  do {
+    ok = stress_take (rd);
+    done = true;
+    for (int32_t k = 0; k < STRESS_NWRITERS * STRESS_NKEYS && done; k++)
+      done = (stress_last[k] >= STRESS_NSAMPLES - STRESS_NKEYS);
+  } while (ok && !done && dds_time () < tend);
+  ddsrt_atomic_st32 (&stop, 1);
+  for (int32_t i = 0; i <= STRESS_NWRITERS; i++)
+  {
+    rc = ddsrt_thread_join (tids[i], NULL);
+    CU_ASSERT_FATAL (rc == 0);
+    CU_ASSERT (ddsrt_atomic_ld32 (&args[i].errors) == 0);
+  }
+  CU_ASSERT_FATAL (ok);
+
+  /* the final value written for each key must have been seen, and there must
+     not be anything left */
+  CU_ASSERT_FATAL (stress_take (rd));
+  for (int32_t k = 0; k < STRESS_NWRITERS * STRESS_NKEYS; k++)
+    CU_ASSERT (stress_last[k] == STRESS_NSAMPLES - STRESS_NKEYS + k % STRESS_NKEYS);
+  rc = dds_take (rd, ptrs, si, MAXS, MAXS);
+  CU_ASSERT (rc == 0);
+}
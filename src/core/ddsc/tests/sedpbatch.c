@@ -0,0 +1,241 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/environ.h"
+#include "dds/ddsrt/atomics.h"
+
+#include "test_common.h"
+
+/* Matching of proxy endpoints discovered via SEDP is deferred to the end of
+   the batch of discovery data being processed. The tests here make sure the
+   outcome is still correct, using the trace to check that batches with more
+   than one endpoint actually occur. */
+
+static ddsrt_atomic_uint32_t max_batch_size = DDSRT_ATOMIC_UINT32_INIT (0);
+
+static void logsink (void *varg, const dds_log_data_t *msg)
+{
+  (void) varg;
+  uint32_t n, old;
+  if (sscanf (msg->message, "match batch: %"SCNu32" proxy endpoints", &n) != 1)
+    return;
+  do {
+    old = ddsrt_atomic_ld32 (&max_batch_size);
+  } while (n > old && !ddsrt_atomic_cas32 (&max_batch_size, old, n));
+}
+
+static dds_entity_t pub_dom, sub_dom, pub_pp, sub_pp, pub_tp, sub_tp;
+
+static void sedpbatch_init (void)
+{
+  const char *config = "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}\
+<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>\
+<Tracing><Category>discovery</Category><OutputFile>stderr</OutputFile></Tracing>";
+  ddsrt_atomic_st32 (&max_batch_size, 0);
+  dds_set_trace_sink (logsink, NULL);
+  char *conf_pub = ddsrt_expand_envvars (config, 0);
+  char *conf_sub = ddsrt_expand_envvars (config, 1);
+  pub_dom = dds_create_domain (0, conf_pub);
+  CU_ASSERT_FATAL (pub_dom > 0);
+  sub_dom = dds_create_domain (1, conf_sub);
+  CU_ASSERT_FATAL (sub_dom > 0);
+  ddsrt_free (conf_pub);
+  ddsrt_free (conf_sub);
+
+  char tpname[100];
+  create_unique_topic_name ("ddsc_sedpbatch", tpname, sizeof (tpname));
+  dds_qos_t * const qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  pub_pp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pub_pp > 0);
+  sub_pp = dds_create_participant (1, NULL, NULL);
+  CU_ASSERT_FATAL (sub_pp > 0);
+  pub_tp = dds_create_topic (pub_pp, &Space_Type1_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (pub_tp > 0);
+  sub_tp = dds_create_topic (sub_pp, &Space_Type1_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (sub_tp > 0);
+  dds_delete_qos (qos);
+}
+
+static void sedpbatch_fini (void)
+{
+  dds_return_t rc;
+  rc = dds_delete (pub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_delete (sub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+  dds_set_trace_sink (NULL, NULL);
+}
+
+static void wait_for_pub_matched (dds_entity_t wr, uint32_t n)
+{
+  dds_publication_matched_status_t st;
+  dds_time_t tend = dds_time () + DDS_SECS (10);
+  do {
+    dds_return_t rc = dds_get_publication_matched_status (wr, &st);
+    CU_ASSERT_FATAL (rc == 0);
+    if (st.current_count != n)
+      dds_sleepfor (DDS_MSECS (10));
+  } while (st.current_count != n && dds_time () < tend);
+  CU_ASSERT_FATAL (st.current_count == n);
+}
+
+static void wait_for_sub_matched (dds_entity_t rd, uint32_t n)
+{
+  dds_subscription_matched_status_t st;
+  dds_time_t tend = dds_time () + DDS_SECS (10);
+  do {
+    dds_return_t rc = dds_get_subscription_matched_status (rd, &st);
+    CU_ASSERT_FATAL (rc == 0);
+    if (st.current_count != n)
+      dds_sleepfor (DDS_MSECS (10));
+  } while (st.current_count != n && dds_time () < tend);
+  CU_ASSERT_FATAL (st.current_count == n);
+}
+
+static bool take_one (dds_entity_t rd, Space_Type1 *s)
+{
+  void *raw = s;
+  dds_sample_info_t si;
+  dds_time_t tend = dds_time () + DDS_SECS (10);
+  dds_return_t rc;
+  while ((rc = dds_take (rd, &raw, &si, 1, 1)) == 0 && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  return rc == 1 && si.valid_data;
+}
+
+#define NEPS 8
+
+CU_Test (ddsc_sedpbatch, match, .init = sedpbatch_init, .fini = sedpbatch_fini)
+{
+  /* The remote endpoints exist before the local ones do, so the remote ones
+     get discovered together when the remote participant is */
+  dds_entity_t rds[NEPS], wrs[NEPS];
+  for (int i = 0; i < NEPS; i++)
+  {
+    rds[i] = dds_create_reader (sub_pp, sub_tp, NULL, NULL);
+    CU_ASSERT_FATAL (rds[i] > 0);
+    wrs[i] = dds_create_writer (sub_pp, sub_tp, NULL, NULL);
+    CU_ASSERT_FATAL (wrs[i] > 0);
+  }
+  const dds_entity_t wr = dds_create_writer (pub_pp, pub_tp, NULL, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  const dds_entity_t rd = dds_create_reader (pub_pp, pub_tp, NULL, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  /* the local reader and writer match each other as well */
+  wait_for_pub_matched (wr, NEPS + 1);
+  wait_for_sub_matched (rd, NEPS + 1);
+  CU_ASSERT (ddsrt_atomic_ld32 (&max_batch_size) > 1);
+
+  /* the writer must have all readers in its address set and the reliable
+     protocol must be running for each of them */
+  dds_return_t rc;
+  rc = dds_write (wr, &(Space_Type1){ 1, 0, 0 });
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_wait_for_acks (wr, DDS_SECS (10));
+  CU_ASSERT_FATAL (rc == 0);
+  for (int i = 0; i < NEPS; i++)
+  {
+    Space_Type1 s;
+    CU_ASSERT_FATAL (take_one (rds[i], &s));
+    CU_ASSERT (s.long_1 == 1);
+  }
+
+  /* and the reader must have matched all writers */
+  for (int i = 0; i < NEPS; i++)
+  {
+    rc = dds_write (wrs[i], &(Space_Type1){ 2, i, 0 });
+    CU_ASSERT_FATAL (rc == 0);
+  }
+  uint32_t seen = 0;
+  for (int i = 0; i < NEPS + 1; i++)
+  {
+    Space_Type1 s;
+    CU_ASSERT_FATAL (take_one (rd, &s));
+    if (s.long_1 == 1)
+      seen |= 1u << NEPS;
+    else
+    {
+      CU_ASSERT_FATAL (s.long_1 == 2 && s.long_2 >= 0 && s.long_2 < NEPS);
+      seen |= 1u << s.long_2;
+    }
+  }
+  CU_ASSERT (seen == (1u << (NEPS + 1)) - 1);
+}
+
+CU_Test (ddsc_sedpbatch, delete_in_batch, .init = sedpbatch_init, .fini = sedpbatch_fini)
+{
+  /* Creating and deleting an endpoint in quick succession tends to put its
+     discovery and its disposal in the same batch on the remote side: the
+     disposed one must not get matched, the others must */
+  const dds_entity_t wr = dds_create_writer (pub_pp, pub_tp, NULL, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  const dds_entity_t rd = dds_create_reader (pub_pp, pub_tp, NULL, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  const dds_entity_t wr0 = dds_create_writer (sub_pp, sub_tp, NULL, NULL);
+  CU_ASSERT_FATAL (wr0 > 0);
+  wait_for_sub_matched (rd, 2);
+
+  dds_return_t rc;
+  dds_entity_t rds[NEPS], wrs[NEPS];
+  for (int i = 0; i < NEPS; i++)
+  {
+    const dds_entity_t xrd = dds_create_reader (sub_pp, sub_tp, NULL, NULL);
+    CU_ASSERT_FATAL (xrd > 0);
+    rds[i] = dds_create_reader (sub_pp, sub_tp, NULL, NULL);
+    CU_ASSERT_FATAL (rds[i] > 0);
+    const dds_entity_t xwr = dds_create_writer (sub_pp, sub_tp, NULL, NULL);
+    CU_ASSERT_FATAL (xwr > 0);
+    wrs[i] = dds_create_writer (sub_pp, sub_tp, NULL, NULL);
+    CU_ASSERT_FATAL (wrs[i] > 0);
+    rc = dds_delete (xrd);
+    CU_ASSERT_FATAL (rc == 0);
+    rc = dds_delete (xwr);
+    CU_ASSERT_FATAL (rc == 0);
+  }
+  wait_for_pub_matched (wr, NEPS + 1);
+  wait_for_sub_matched (rd, NEPS + 2);
+
+  /* nothing stale left behind after things settle down */
+  dds_sleepfor (DDS_MSECS (100));
+  dds_publication_matched_status_t pm;
+  rc = dds_get_publication_matched_status (wr, &pm);
+  CU_ASSERT_FATAL (rc == 0);
+  CU_ASSERT (pm.current_count == NEPS + 1);
+  dds_subscription_matched_status_t sm;
+  rc = dds_get_subscription_matched_status (rd, &sm);
+  CU_ASSERT_FATAL (rc == 0);
+  CU_ASSERT (sm.current_count == NEPS + 2);
+
+  rc = dds_write (wr, &(Space_Type1){ 1, 0, 0 });
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_wait_for_acks (wr, DDS_SECS (10));
+  CU_ASSERT_FATAL (rc == 0);
+  for (int i = 0; i < NEPS; i++)
+  {
+    Space_Type1 s;
+    CU_ASSERT_FATAL (take_one (rds[i], &s));
+    rc = dds_write (wrs[i], &(Space_Type1){ 2, i, 0 });
+    CU_ASSERT_FATAL (rc == 0);
+  }
+  for (int i = 0; i < NEPS + 1; i++)
+  {
+    Space_Type1 s;
+    CU_ASSERT_FATAL (take_one (rd, &s));
+  }
+}
@@ -0,0 +1,396 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "dds/dds.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_tran.h"
+#include "dds/ddsi/ddsi_shmring.h"
+#include "dds/ddsi/q_addrset.h"
+#include "dds/ddsi/q_entity.h"
+#include "dds__entity.h"
+#include "dds__writer.h"
+
+#include "test_common.h"
+
+/* Layout of the segment as defined in ddsi_shmring.c: a header of four cache
+   lines (the "alive" flag in the first, "head" in the second) followed by the
+   data area, records start with the length followed by the source port */
+#define SHMRING_HDR_SIZE 256
+#define SHMRING_ALIVE_OFFSET 8
+#define SHMRING_HEAD_OFFSET 64
+#define SHMRING_PAD 0x80000000u
+#define SHMRING_RESERVED 0x40000000u
+
+static dds_entity_t ring_dom;
+static struct ddsi_domaingv *ring_gv;
+static ddsi_tran_conn_t ring_conn;
+static ddsi_locator_t ring_loc;
+
+static void ring_init (void)
+{
+  /* shmring isn't enabled in the domain, so a ring created by the test is not
+     read by any receive thread and the test can push and pop at will */
+  ring_dom = dds_create_domain (0, "<ShmRing><RingSize>256kB</RingSize></ShmRing>");
+  CU_ASSERT_FATAL (ring_dom > 0);
+  dds_entity *x;
+  dds_return_t rc = dds_entity_pin (ring_dom, &x);
+  CU_ASSERT_FATAL (rc == 0);
+  ring_gv = &((struct dds_domain *) x)->gv;
+  dds_entity_unpin (x);
+  CU_ASSERT_FATAL (ddsi_shmring_init (ring_gv, &ring_loc) == 0);
+  ddsi_tran_factory_t fact = ddsi_factory_find (ring_gv, "shmring");
+  CU_ASSERT_FATAL (fact != NULL);
+  struct ddsi_tran_qos qos = { .m_purpose = DDSI_TRAN_QOS_RECV_UC, .m_diffserv = 0, .m_interface = NULL };
+  rc = ddsi_factory_create_conn (&ring_conn, fact, 0, &qos);
+  CU_ASSERT_FATAL (rc == 0);
+}
+
+static void ring_fini (void)
+{
+  ddsi_conn_free (ring_conn);
+  dds_return_t rc = dds_delete (ring_dom);
+  CU_ASSERT_FATAL (rc == 0);
+}
+
+static ssize_t ring_write (uint32_t seq, size_t len)
+{
+  unsigned char buf[65537];
+  for (size_t i = 0; i < len; i++)
+    buf[i] = (unsigned char) (seq + i);
+  /* split over two iovecs to check they get concatenated */
+  const size_t len0 = len / 3;
+  ddsrt_iovec_t iov[2] = {
+    { .iov_base = buf, .iov_len = (ddsrt_iov_len_t) len0 },
+    { .iov_base = buf + len0, .iov_len = (ddsrt_iov_len_t) (len - len0) }
+  };
+  return ddsi_conn_write (ring_conn, &ring_loc, 2, iov, 0);
+}
+
+static void ring_read_check (uint32_t seq, size_t len)
+{
+  unsigned char buf[65536];
+  ddsi_locator_t srcloc;
+  const ssize_t n = ddsi_conn_read (ring_conn, buf, sizeof (buf), false, &srcloc);
+  CU_ASSERT_FATAL (n == (ssize_t) len);
+  CU_ASSERT_FATAL (srcloc.kind == NN_LOCATOR_KIND_SHMRING && srcloc.port == ring_loc.port);
+  for (size_t i = 0; i < len; i++)
+    CU_ASSERT_FATAL (buf[i] == (unsigned char) (seq + i));
+}
+
+static unsigned char *ring_map (uint32_t port, size_t *size)
+{
+  char name[64];
+  struct stat st;
+  CU_ASSERT_FATAL (stat ("/proc/self/ns/pid", &st) == 0);
+  (void) snprintf (name, sizeof (name), "/cdds-shmring-%08"PRIx32"-%"PRIu32, (uint32_t) st.st_ino, port);
+  const int fd = shm_open (name, O_RDWR, 0);
+  CU_ASSERT_FATAL (fd != -1);
+  CU_ASSERT_FATAL (fstat (fd, &st) == 0);
+  /* not accessible to others unless configured otherwise */
+  CU_ASSERT ((st.st_mode & 0777) == 0600);
+  void *p = mmap (NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  CU_ASSERT_FATAL (p != MAP_FAILED);
+  (void) close (fd);
+  *size = (size_t) st.st_size;
+  return p;
+}
+
+CU_Test (ddsc_shmring, push_pop)
+{
+  ring_init ();
+  /* Sizes that are not a multiple of 8 and don't divide the ring size, with a
+     few messages in flight at any time, for 12 times the size of the ring:
+     that makes records wrap around with all kinds of padding at the end */
+  uint32_t wseq = 0, rseq = 0;
+  size_t total = 0;
+  while (total < 12 * 256 * 1024)
+  {
+    for (int i = 0; i < 5; i++, wseq++)
+    {
+      const size_t len = 1 + (wseq * 7919) % 20000;
+      CU_ASSERT_FATAL (ring_write (wseq, len) == (ssize_t) len);
+      total += len;
+    }
+    for (int i = 0; i < 5; i++, rseq++)
+      ring_read_check (rseq, 1 + (rseq * 7919) % 20000);
+  }
+  ring_fini ();
+}
+
+CU_Test (ddsc_shmring, full)
+{
+  ring_init ();
+  CU_ASSERT (ring_write (0, 65537) < 0);
+  /* a 256kB ring holds three messages of the maximum size, the fourth doesn't fit */
+  uint32_t n = 0;
+  while (ring_write (n, 65536) == 65536)
+    n++;
+  CU_ASSERT_FATAL (n == 3);
+  for (uint32_t i = 0; i < n; i++)
+    ring_read_check (i, 65536);
+  /* after which it is usable again, and that requires skipping the end */
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    CU_ASSERT_FATAL (ring_write (10 + i, 65536) == 65536);
+    ring_read_check (10 + i, 65536);
+  }
+  ring_fini ();
+}
+
+static void ring_corrupt (uint32_t len)
+{
+  ring_init ();
+  size_t size;
+  unsigned char *seg = ring_map (ring_loc.port, &size);
+  CU_ASSERT_FATAL (ring_write (0, 100) == 100);
+  ring_read_check (0, 100);
+  CU_ASSERT_FATAL (ring_write (1, 100) == 100);
+  /* second record follows the first one (8 byte header + 100 bytes rounded up) */
+  uint32_t * const reclen = (uint32_t *) (seg + SHMRING_HDR_SIZE + 8 + 104);
+  CU_ASSERT_FATAL (*reclen == 100);
+  *reclen = len;
+  unsigned char buf[65536];
+  CU_ASSERT (ddsi_conn_read (ring_conn, buf, sizeof (buf), false, NULL) < 0);
+  /* the reader gave up on it, so peers can no longer write into it */
+  CU_ASSERT (ring_write (2, 100) < 0);
+  (void) munmap (seg, size);
+  ring_fini ();
+}
+
+CU_Test (ddsc_shmring, corrupt_length)
+{
+  ring_corrupt (0x7ffffff8);
+}
+
+CU_Test (ddsc_shmring, corrupt_too_long)
+{
+  /* valid message size, but extends past the end of the ring */
+  ring_corrupt (65536);
+}
+
+CU_Test (ddsc_shmring, corrupt_padding)
+{
+  /* padding must extend to the end of the ring */
+  ring_corrupt (SHMRING_PAD | 8);
+}
+
+CU_Test (ddsc_shmring, abandoned_reservation)
+{
+  ring_init ();
+  size_t size;
+  unsigned char *seg = ring_map (ring_loc.port, &size);
+  const pid_t pid = fork ();
+  CU_ASSERT_FATAL (pid != -1);
+  if (pid == 0)
+    _exit (0);
+  CU_ASSERT_FATAL (waitpid (pid, NULL, 0) == pid);
+
+  /* reserve space for a 100-byte message at the start of the ring the way a
+     writer does, but never publish it; followed by a regular message */
+  uint32_t * const reclen = (uint32_t *) (seg + SHMRING_HDR_SIZE);
+  uint32_t * const recsrc = reclen + 1;
+  *recsrc = ((uint32_t) getpid () << 8) | 1;
+  *reclen = SHMRING_RESERVED | 100;
+  *(uint32_t *) (seg + SHMRING_HEAD_OFFSET) = 8 + 104;
+  CU_ASSERT_FATAL (ring_write (1, 100) == 100);
+
+  /* the reader waits for it while the process that reserved it exists ... */
+  unsigned char buf[65536];
+  CU_ASSERT (ddsi_conn_read (ring_conn, buf, sizeof (buf), false, NULL) == 0);
+  /* ... and skips it once that process is gone */
+  *recsrc = ((uint32_t) pid << 8) | 1;
+  ring_read_check (1, 100);
+
+  /* the skipped space must be reusable */
+  for (uint32_t i = 0; i < 40; i++)
+  {
+    CU_ASSERT_FATAL (ring_write (2 + i, 20000) == 20000);
+    ring_read_check (2 + i, 20000);
+  }
+  (void) munmap (seg, size);
+  ring_fini ();
+}
+
+struct has_shmring_arg {
+  bool found;
+};
+
+static void has_shmring_locator (const ddsi_xlocator_t *loc, void *varg)
+{
+  struct has_shmring_arg * const arg = varg;
+  if (loc->c.kind == NN_LOCATOR_KIND_SHMRING)
+    arg->found = true;
+}
+
+static bool writer_has_shmring_locator (dds_entity_t wr)
+{
+  struct has_shmring_arg arg = { .found = false };
+  dds_writer *wrent;
+  dds_return_t rc = dds_writer_lock (wr, &wrent);
+  CU_ASSERT_FATAL (rc == 0);
+  ddsrt_mutex_lock (&wrent->m_wr->e.lock);
+  addrset_forall (wrent->m_wr->as, has_shmring_locator, &arg);
+  ddsrt_mutex_unlock (&wrent->m_wr->e.lock);
+  dds_writer_unlock (wrent);
+  return arg.found;
+}
+
+CU_Test (ddsc_shmring, delivery)
+{
+  dds_entity_t pub_dom, sub_dom;
+  create_domain_pair ("<ShmRing><Enable>true</Enable><RingSize>256kB</RingSize></ShmRing>", NULL, &pub_dom, &sub_dom);
+
+  const dds_entity_t pub_pp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pub_pp > 0);
+  const dds_entity_t sub_pp = dds_create_participant (1, NULL, NULL);
+  CU_ASSERT_FATAL (sub_pp > 0);
+  char tpname[100];
+  create_unique_topic_name ("ddsc_shmring", tpname, sizeof (tpname));
+  dds_qos_t * const qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  const dds_entity_t pub_tp = dds_create_topic (pub_pp, &Space_Type1_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (pub_tp > 0);
+  const dds_entity_t sub_tp = dds_create_topic (sub_pp, &Space_Type1_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (sub_tp > 0);
+  const dds_entity_t wr = dds_create_writer (pub_pp, pub_tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  const dds_entity_t rd = dds_create_reader (sub_pp, sub_tp, qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_delete_qos (qos);
+
+  dds_return_t rc;
+  wait_for_publication_matched (wr, 1, DDS_SECS (10));
+
+  /* the reader is on the same machine, so the writer should send to its ring */
+  CU_ASSERT_FATAL (writer_has_shmring_locator (wr));
+
+  /* more data than fits in the ring, so it has to wrap around */
+  const uint32_t nsamples = 20000;
+  for (uint32_t i = 0; i < nsamples; i++)
+  {
+    rc = dds_write (wr, &(Space_Type1){ 0, (int32_t) i, 0 });
+    CU_ASSERT_FATAL (rc == 0);
+  }
+  rc = dds_wait_for_acks (wr, DDS_SECS (10));
+  CU_ASSERT_FATAL (rc == 0);
+
+  uint32_t nseen = 0;
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  while (nseen < nsamples && dds_time () < tend)
+  {
+    Space_Type1 s;
+    void *raw = &s;
+    dds_sample_info_t si;
+    if ((rc = dds_take (rd, &raw, &si, 1, 1)) == 0)
+      dds_sleepfor (DDS_MSECS (10));
+    else
+    {
+      CU_ASSERT_FATAL (rc == 1);
+      CU_ASSERT_FATAL (s.long_2 == (int32_t) nseen);
+      nseen++;
+    }
+  }
+  CU_ASSERT (nseen == nsamples);
+
+  rc = dds_delete (pub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_delete (sub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+}
+
+CU_Test (ddsc_shmring, dead_ring_fallback)
+{
+  dds_entity_t pub_dom, sub_dom;
+  create_domain_pair ("<ShmRing><Enable>true</Enable><RingSize>256kB</RingSize></ShmRing>", NULL, &pub_dom, &sub_dom);
+
+  const dds_entity_t pub_pp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pub_pp > 0);
+  const dds_entity_t sub_pp = dds_create_participant (1, NULL, NULL);
+  CU_ASSERT_FATAL (sub_pp > 0);
+  char tpname[100];
+  create_unique_topic_name ("ddsc_shmring", tpname, sizeof (tpname));
+  dds_qos_t * const qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  const dds_entity_t pub_tp = dds_create_topic (pub_pp, &Space_Type1_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (pub_tp > 0);
+  const dds_entity_t sub_tp = dds_create_topic (sub_pp, &Space_Type1_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (sub_tp > 0);
+  const dds_entity_t wr = dds_create_writer (pub_pp, pub_tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  const dds_entity_t rd = dds_create_reader (sub_pp, sub_tp, qos, NULL);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_delete_qos (qos);
+
+  dds_return_t rc;
+  wait_for_publication_matched (wr, 1, DDS_SECS (10));
+  CU_ASSERT_FATAL (writer_has_shmring_locator (wr));
+
+  /* kill the reader's ring the way its owner does when it finds garbage in it */
+  dds_entity *x;
+  rc = dds_entity_pin (sub_dom, &x);
+  CU_ASSERT_FATAL (rc == 0);
+  const uint32_t sub_port = ((struct dds_domain *) x)->gv.loc_shmring.port;
+  dds_entity_unpin (x);
+  size_t size;
+  unsigned char *seg = ring_map (sub_port, &size);
+  *(uint32_t *) (seg + SHMRING_ALIVE_OFFSET) = 0;
+  (void) munmap (seg, size);
+
+  /* the first sample is lost in trying to push it into the ring, the writer
+     then drops its locator and continues over UDP */
+  const uint32_t nsamples = 100;
+  for (uint32_t i = 0; i < nsamples; i++)
+  {
+    rc = dds_write (wr, &(Space_Type1){ 0, (int32_t) i, 0 });
+    CU_ASSERT_FATAL (rc == 0);
+  }
+  dds_time_t tend = dds_time () + DDS_SECS (10);
+  while (writer_has_shmring_locator (wr) && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  CU_ASSERT_FATAL (!writer_has_shmring_locator (wr));
+  rc = dds_wait_for_acks (wr, DDS_SECS (10));
+  CU_ASSERT_FATAL (rc == 0);
+
+  uint32_t nseen = 0;
+  tend = dds_time () + DDS_SECS (10);
+  while (nseen < nsamples && dds_time () < tend)
+  {
+    Space_Type1 s;
+    void *raw = &s;
+    dds_sample_info_t si;
+    if ((rc = dds_take (rd, &raw, &si, 1, 1)) == 0)
+      dds_sleepfor (DDS_MSECS (10));
+    else
+    {
+      CU_ASSERT_FATAL (rc == 1);
+      CU_ASSERT_FATAL (s.long_2 == (int32_t) nseen);
+      nseen++;
+    }
+  }
+  CU_ASSERT (nseen == nsamples);
+
+  rc = dds_delete (pub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_delete (sub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/sockets.h"
+#include "dds/ddsrt/io.h"
+
+#include "test_common.h"
+
+/* Sizes chosen such that the data written while the receiving side is stalled
+   exceeds by far what the kernel buffers of a loopback TCP connection hold */
+#define NSAMPLES 300
+#define PAYLOAD_SIZE 65536
+#define STALL DDS_SECS (1)
+
+static ddsrt_atomic_uint32_t n_partial = DDSRT_ATOMIC_UINT32_INIT (0);
+static ddsrt_atomic_uint32_t n_dropped = DDSRT_ATOMIC_UINT32_INIT (0);
+
+static void logsink (void *varg, const dds_log_data_t *msg)
+{
+  (void) varg;
+  if (strncmp (msg->message, "tcp write: ", 11) != 0)
+    return;
+  if (strstr (msg->message, "partial write"))
+    ddsrt_atomic_inc32 (&n_partial);
+  else if (strstr (msg->message, "queue full"))
+    ddsrt_atomic_inc32 (&n_dropped);
+}
+
+static uint32_t free_tcp_port (void)
+{
+  /* there is a race here, but it is only a test */
+  ddsrt_socket_t sock;
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof (addr);
+  dds_return_t rc = ddsrt_socket (&sock, AF_INET, SOCK_STREAM, 0);
+  CU_ASSERT_FATAL (rc == 0);
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  rc = ddsrt_bind (sock, (struct sockaddr *) &addr, sizeof (addr));
+  CU_ASSERT_FATAL (rc == 0);
+  rc = ddsrt_getsockname (sock, (struct sockaddr *) &addr, &addrlen);
+  CU_ASSERT_FATAL (rc == 0);
+  (void) ddsrt_close (sock);
+  return ntohs (addr.sin_port);
+}
+
+static ddsrt_atomic_uint32_t stalled = DDSRT_ATOMIC_UINT32_INIT (0);
+
+static void data_available (dds_entity_t rd, void *varg)
+{
+  /* Reliable data is delivered synchronously from the receive thread, so
+     sleeping here stops it from reading from the socket */
+  (void) rd; (void) varg;
+  if (ddsrt_atomic_cas32 (&stalled, 0, 1))
+    dds_sleepfor (STALL);
+}
+
+CU_Test (ddsc_tcp, send_queue)
+{
+  const uint32_t port = free_tcp_port ();
+  const char *config = "\
+<General><Transport>tcp</Transport><NetworkInterfaceAddress>127.0.0.1</NetworkInterfaceAddress></General>\
+<Discovery><ParticipantIndex>none</ParticipantIndex><Peers><Peer address=\"127.0.0.1:%"PRIu32"\"/></Peers></Discovery>\
+<TCP><Port>%d</Port><SendQueueSize>64kB</SendQueueSize><WriteTimeout>10s</WriteTimeout></TCP>\
+<Internal><Watermarks><WhcHigh>50MB</WhcHigh></Watermarks></Internal>\
+<Tracing><Category>tcp</Category><OutputFile>stderr</OutputFile></Tracing>";
+  char *conf_pub, *conf_sub;
+  (void) ddsrt_asprintf (&conf_pub, config, port, 0);
+  (void) ddsrt_asprintf (&conf_sub, config, port, (int) port);
+  dds_set_trace_sink (logsink, NULL);
+  dds_entity_t pub_dom, sub_dom;
+  create_domain_pair (conf_pub, conf_sub, &pub_dom, &sub_dom);
+  ddsrt_free (conf_pub);
+  ddsrt_free (conf_sub);
+
+  const dds_entity_t pub_pp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pub_pp > 0);
+  const dds_entity_t sub_pp = dds_create_participant (1, NULL, NULL);
+  CU_ASSERT_FATAL (sub_pp > 0);
+  char tpname[100];
+  create_unique_topic_name ("ddsc_tcp", tpname, sizeof (tpname));
+  dds_qos_t * const qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_ALL, 0);
+  const dds_entity_t pub_tp = dds_create_topic (pub_pp, &RoundTripModule_DataType_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (pub_tp > 0);
+  const dds_entity_t sub_tp = dds_create_topic (sub_pp, &RoundTripModule_DataType_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (sub_tp > 0);
+  const dds_entity_t wr = dds_create_writer (pub_pp, pub_tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  dds_listener_t * const list = dds_create_listener (NULL);
+  CU_ASSERT_FATAL (list != NULL);
+  dds_lset_data_available (list, data_available);
+  const dds_entity_t rd = dds_create_reader (sub_pp, sub_tp, qos, list);
+  CU_ASSERT_FATAL (rd > 0);
+  dds_delete_listener (list);
+  dds_delete_qos (qos);
+
+  dds_return_t rc;
+  wait_for_publication_matched (wr, 1, DDS_SECS (10));
+
+  /* The first sample stalls the receiver, the remainder fills the socket
+     buffers, then the send queue, and some of it gets dropped */
+  RoundTripModule_DataType sample;
+  memset (&sample, 0, sizeof (sample));
+  sample.payload._length = sample.payload._maximum = PAYLOAD_SIZE;
+  sample.payload._buffer = ddsrt_malloc (PAYLOAD_SIZE);
+  for (uint32_t i = 0; i < NSAMPLES; i++)
+  {
+    memset (sample.payload._buffer, (int) (i & 0xff), PAYLOAD_SIZE);
+    memcpy (sample.payload._buffer, &i, sizeof (i));
+    rc = dds_write (wr, &sample);
+    CU_ASSERT_FATAL (rc == 0);
+  }
+  ddsrt_free (sample.payload._buffer);
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_partial) > 0);
+  CU_ASSERT (ddsrt_atomic_ld32 (&n_dropped) > 0);
+
+  /* The stream must still be intact, so everything arrives eventually and
+     in order */
+  rc = dds_wait_for_acks (wr, DDS_SECS (30));
+  CU_ASSERT_FATAL (rc == 0);
+  uint32_t nseen = 0;
+  const dds_time_t tend = dds_time () + DDS_SECS (10);
+  while (nseen < NSAMPLES && dds_time () < tend)
+  {
+    void *raw = NULL;
+    dds_sample_info_t si;
+    if ((rc = dds_take (rd, &raw, &si, 1, 1)) == 0)
+      dds_sleepfor (DDS_MSECS (10));
+    else
+    {
+      CU_ASSERT_FATAL (rc == 1);
+      const RoundTripModule_DataType *s = raw;
+      uint32_t seq;
+      CU_ASSERT_FATAL (si.valid_data && s->payload._length == PAYLOAD_SIZE);
+      memcpy (&seq, s->payload._buffer, sizeof (seq));
+      CU_ASSERT_FATAL (seq == nseen);
+      CU_ASSERT_FATAL (s->payload._buffer[PAYLOAD_SIZE - 1] == (uint8_t) (seq & 0xff));
+      nseen++;
+      rc = dds_return_loan (rd, &raw, 1);
+      CU_ASSERT_FATAL (rc == 0);
+    }
+  }
+  CU_ASSERT (nseen == NSAMPLES);
+
+  rc = dds_delete (pub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_delete (sub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+  dds_set_trace_sink (NULL, NULL);
+}
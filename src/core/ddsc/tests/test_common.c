@@ -11,6 +11,9 @@
  */
 #include "dds/dds.h"
 #include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/environ.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/io.h"
 #include "dds/ddsrt/process.h"
 #include "dds/ddsrt/threads.h"
 #include "test_common.h"
@@ -68,3 +71,32 @@ void no_sync_reader_writer (dds_entity_t participant_rd, dds_entity_t reader, dd
 {
   sync_reader_writer_impl (participant_rd, reader, participant_wr, writer, false, timeout);
 }
+
+static dds_entity_t create_domain_with_config (dds_domainid_t domainid, const char *config)
+{
+  char *xconfig, *expanded;
+  (void) ddsrt_asprintf (&xconfig, "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Discovery><ExternalDomainId>0</ExternalDomainId></Discovery>,%s", config);
+  expanded = ddsrt_expand_envvars (xconfig, domainid);
+  ddsrt_free (xconfig);
+  const dds_entity_t dom = dds_create_domain (domainid, expanded);
+  CU_ASSERT_FATAL (dom > 0);
+  ddsrt_free (expanded);
+  return dom;
+}
+
+void create_domain_pair (const char *config_pub, const char *config_sub, dds_entity_t *pub_dom, dds_entity_t *sub_dom)
+{
+  *sub_dom = create_domain_with_config (1, config_sub ? config_sub : config_pub);
+  *pub_dom = create_domain_with_config (0, config_pub);
+}
+
+void wait_for_publication_matched (dds_entity_t writer, uint32_t nreaders, dds_duration_t timeout)
+{
+  dds_publication_matched_status_t pm;
+  const dds_time_t tend = dds_time () + timeout;
+  dds_return_t rc;
+  while ((rc = dds_get_publication_matched_status (writer, &pm)) == 0 && pm.current_count != nreaders && dds_time () < tend)
+    dds_sleepfor (DDS_MSECS (10));
+  CU_ASSERT_FATAL (rc == 0);
+  CU_ASSERT_FATAL (pm.current_count == nreaders);
+}
@@ -24,5 +24,12 @@ void sync_reader_writer (dds_entity_t participant_rd, dds_entity_t reader, dds_e
 /* Try to sync the reader to the writer and writer to reader, expect to fail */
 void no_sync_reader_writer (dds_entity_t participant_rd, dds_entity_t reader, dds_entity_t participant_wr, dds_entity_t writer, dds_duration_t timeout);
 
+/* Create domains 0 and 1 in this process such that they discover each other over the
+   network as if they were in different processes.  "config_pub" (or "config_sub" for
+   domain 1, if not null) is appended to ${CYCLONEDDS_URI}; domain 1 is created first. */
+void create_domain_pair (const char *config_pub, const char *config_sub, dds_entity_t *pub_dom, dds_entity_t *sub_dom);
+
+/* Wait until the writer matches exactly "nreaders" readers, fail after "timeout" */
+void wait_for_publication_matched (dds_entity_t writer, uint32_t nreaders, dds_duration_t timeout);
 
 #endif /* _TEST_UTIL_H_ */
@@ -11,11 +11,20 @@
  */
 #include <assert.h>
 #include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 #include "dds/dds.h"
 #include "dds/ddsrt/process.h"
 #include "dds/ddsrt/threads.h"
 #include "dds/ddsrt/environ.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/io.h"
 #include "dds/ddsi/ddsi_entity_index.h"
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/q_whc.h"
@@ -297,3 +306,259 @@ CU_Test(ddsc_whc, check_end_state, .init=whc_init, .fini=whc_fini, .timeout=30)
 #undef BE
 #undef KA
 #undef KL
+
+#if !defined _WIN32
+struct store_restore_sample {
+  int32_t key, value;
+  bool valid;
+  dds_instance_state_t istate;
+};
+
+struct store_restore_result {
+  int32_t n;
+  struct store_restore_sample s[3 * SAMPLE_COUNT];
+};
+
+static int store_restore_sample_cmp (const void *va, const void *vb)
+{
+  const struct store_restore_sample *a = va, *b = vb;
+  return (a->key == b->key) ? 0 : (a->key < b->key) ? -1 : 1;
+}
+
+static dds_entity_t store_restore_reader (dds_entity_t participant, dds_entity_t topic, const dds_qos_t *qos)
+{
+  dds_qos_t *rqos = dds_create_qos ();
+  dds_copy_qos (rqos, qos);
+  dds_qset_history (rqos, DDS_HISTORY_KEEP_ALL, 0);
+  const dds_entity_t reader = dds_create_reader (participant, topic, rqos, NULL);
+  CU_ASSERT_FATAL (reader > 0);
+  dds_delete_qos (rqos);
+  return reader;
+}
+
+static void store_restore_take_all (dds_entity_t reader, struct store_restore_result *res)
+{
+  Space_Type1 samples[3 * SAMPLE_COUNT];
+  void *raw[3 * SAMPLE_COUNT];
+  dds_sample_info_t si[3 * SAMPLE_COUNT];
+  for (int i = 0; i < 3 * SAMPLE_COUNT; i++)
+    raw[i] = &samples[i];
+  res->n = dds_take (reader, raw, si, 3 * SAMPLE_COUNT, 3 * SAMPLE_COUNT);
+  CU_ASSERT_FATAL (res->n >= 0);
+  for (int32_t i = 0; i < res->n; i++)
+  {
+    res->s[i].key = samples[i].long_1;
+    res->s[i].value = si[i].valid_data ? samples[i].long_2 : -1;
+    res->s[i].valid = si[i].valid_data;
+    res->s[i].istate = si[i].instance_state;
+  }
+  /* instance handles differ between incarnations, so order on key (there is
+     at most one sample per instance) */
+  qsort (res->s, (size_t) res->n, sizeof (res->s[0]), store_restore_sample_cmp);
+}
+
+static void store_restore_rmdir (const char *dir)
+{
+  DIR *d = opendir (dir);
+  struct dirent *ent;
+  CU_ASSERT_FATAL (d != NULL);
+  while ((ent = readdir (d)) != NULL)
+  {
+    char *path;
+    if (strcmp (ent->d_name, ".") == 0 || strcmp (ent->d_name, "..") == 0)
+      continue;
+    (void) ddsrt_asprintf (&path, "%s/%s", dir, ent->d_name);
+    CU_ASSERT_EQUAL (unlink (path), 0);
+    ddsrt_free (path);
+  }
+  closedir (d);
+  CU_ASSERT_EQUAL (rmdir (dir), 0);
+}
+
+CU_Test(ddsc_whc, store_restore, .timeout=30)
+{
+  /* Writer history of a transient writer kept in a file: exactly the data
+     that the writer retains in one incarnation of the domain must be
+     republished when the writer is recreated in the next, not what it had
+     already released (overwritten samples, unregistered instances) */
+  char dir[64];
+  (void) snprintf (dir, sizeof (dir), "ddsc_whc_store_restore_%d", (int) ddsrt_getpid ());
+  CU_ASSERT_EQUAL_FATAL (mkdir (dir, 0700), 0);
+  char *config;
+  (void) ddsrt_asprintf (&config, "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Internal><WhcStoreDirectory>%s</WhcStoreDirectory></Internal>", dir);
+  char *conf = ddsrt_expand_envvars (config, DDS_DOMAINID_PUB);
+  ddsrt_free (config);
+  char topicname[100];
+  dds_return_t ret;
+  create_unique_topic_name ("ddsc_whc_store_restore", topicname, sizeof (topicname));
+
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_durability (qos, DDS_DURABILITY_TRANSIENT);
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_LAST, 1);
+  dds_qset_durability_service (qos, 0, DDS_HISTORY_KEEP_LAST, 1, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED);
+
+  struct store_restore_result expected, res;
+  for (int incarnation = 0; incarnation < 3; incarnation++)
+  {
+    const dds_entity_t domain = dds_create_domain (DDS_DOMAINID_PUB, conf);
+    CU_ASSERT_FATAL (domain > 0);
+    const dds_entity_t participant = dds_create_participant (DDS_DOMAINID_PUB, NULL, NULL);
+    CU_ASSERT_FATAL (participant > 0);
+    const dds_entity_t topic = dds_create_topic (participant, &Space_Type1_desc, topicname, qos, NULL);
+    CU_ASSERT_FATAL (topic > 0);
+    /* a KEEP_ALL reader that exists before the writer receives everything the
+       writer republishes when it is created */
+    const dds_entity_t reader = (incarnation > 0) ? store_restore_reader (participant, topic, qos) : 0;
+    const dds_entity_t writer = dds_create_writer (participant, topic, qos, NULL);
+    CU_ASSERT_FATAL (writer > 0);
+    if (incarnation == 0)
+    {
+      /* 4 instances, each updated SAMPLE_COUNT times, then instance 2 is
+         disposed and instance 3 unregistered */
+      for (int32_t i = 0; i < 4 * SAMPLE_COUNT; i++)
+      {
+        Space_Type1 sample = { i % 4, i, 0 };
+        ret = dds_write (writer, &sample);
+        CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+      }
+      ret = dds_dispose (writer, &(Space_Type1){ 2, 0, 0 });
+      CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+      ret = dds_unregister_instance (writer, &(Space_Type1){ 3, 0, 0 });
+      CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+
+      /* what a late-joining KEEP_ALL reader gets from this incarnation: the
+         latest sample of instances 0 and 1 and the disposal of instance 2 */
+      store_restore_take_all (store_restore_reader (participant, topic, qos), &expected);
+      CU_ASSERT_EQUAL_FATAL (expected.n, 3);
+      for (int32_t k = 0; k < 2; k++)
+      {
+        CU_ASSERT_FATAL (expected.s[k].key == k && expected.s[k].valid);
+        CU_ASSERT_EQUAL_FATAL (expected.s[k].value, 4 * (SAMPLE_COUNT - 1) + k);
+        CU_ASSERT_EQUAL_FATAL (expected.s[k].istate, DDS_IST_ALIVE);
+      }
+      CU_ASSERT_FATAL (expected.s[2].key == 2 && expected.s[2].istate == DDS_IST_NOT_ALIVE_DISPOSED);
+    }
+    else
+    {
+      /* the next incarnations, including the one after a restored writer,
+         republish exactly that */
+      store_restore_take_all (reader, &res);
+      CU_ASSERT_EQUAL_FATAL (res.n, expected.n);
+      for (int32_t i = 0; i < res.n; i++)
+      {
+        CU_ASSERT_EQUAL_FATAL (res.s[i].key, expected.s[i].key);
+        CU_ASSERT_EQUAL_FATAL (res.s[i].valid, expected.s[i].valid);
+        CU_ASSERT_EQUAL_FATAL (res.s[i].value, expected.s[i].value);
+        CU_ASSERT_EQUAL_FATAL (res.s[i].istate, expected.s[i].istate);
+      }
+    }
+    ret = dds_delete (domain);
+    CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  }
+  dds_delete_qos (qos);
+  dds_free (conf);
+  store_restore_rmdir (dir);
+}
+
+static int store_count_files (const char *dir)
+{
+  DIR *d = opendir (dir);
+  struct dirent *ent;
+  int n = 0;
+  CU_ASSERT_FATAL (d != NULL);
+  while ((ent = readdir (d)) != NULL)
+    n += (strcmp (ent->d_name, ".") != 0 && strcmp (ent->d_name, "..") != 0);
+  closedir (d);
+  return n;
+}
+
+static dds_entity_t store_key_writer (dds_entity_t participant, dds_entity_t topic, const dds_qos_t *qos, const char *partition)
+{
+  dds_qos_t *pqos = dds_create_qos ();
+  dds_qset_partition1 (pqos, partition);
+  const dds_entity_t publisher = dds_create_publisher (participant, pqos, NULL);
+  CU_ASSERT_FATAL (publisher > 0);
+  dds_delete_qos (pqos);
+  const dds_entity_t writer = dds_create_writer (publisher, topic, qos, NULL);
+  CU_ASSERT_FATAL (writer > 0);
+  return writer;
+}
+
+CU_Test(ddsc_whc, store_key, .timeout=30)
+{
+  /* Writers for the same topic in different partitions or domains each have
+     a store of their own and only republish their own samples */
+  char dir[64];
+  (void) snprintf (dir, sizeof (dir), "ddsc_whc_store_key_%d", (int) ddsrt_getpid ());
+  CU_ASSERT_EQUAL_FATAL (mkdir (dir, 0700), 0);
+  char *config;
+  (void) ddsrt_asprintf (&config, "${CYCLONEDDS_URI}${CYCLONEDDS_URI:+,}<Internal><WhcStoreDirectory>%s</WhcStoreDirectory></Internal>", dir);
+  char *conf_pub = ddsrt_expand_envvars (config, DDS_DOMAINID_PUB);
+  char *conf_sub = ddsrt_expand_envvars (config, DDS_DOMAINID_SUB);
+  ddsrt_free (config);
+  char topicname[100];
+  dds_return_t ret;
+  create_unique_topic_name ("ddsc_whc_store_key", topicname, sizeof (topicname));
+
+  dds_qos_t *qos = dds_create_qos ();
+  dds_qset_durability (qos, DDS_DURABILITY_TRANSIENT);
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  dds_qset_history (qos, DDS_HISTORY_KEEP_LAST, 1);
+  dds_qset_durability_service (qos, 0, DDS_HISTORY_KEEP_LAST, 1, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED, DDS_LENGTH_UNLIMITED);
+
+  const dds_entity_t domain_sub = dds_create_domain (DDS_DOMAINID_SUB, conf_sub);
+  CU_ASSERT_FATAL (domain_sub > 0);
+  const dds_entity_t participant_sub = dds_create_participant (DDS_DOMAINID_SUB, NULL, NULL);
+  CU_ASSERT_FATAL (participant_sub > 0);
+  const dds_entity_t topic_sub = dds_create_topic (participant_sub, &Space_Type1_desc, topicname, qos, NULL);
+  CU_ASSERT_FATAL (topic_sub > 0);
+  const dds_entity_t writer_sub = store_key_writer (participant_sub, topic_sub, qos, "a");
+  ret = dds_write (writer_sub, &(Space_Type1){ 3, 3, 0 });
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+
+  for (int incarnation = 0; incarnation < 2; incarnation++)
+  {
+    const dds_entity_t domain = dds_create_domain (DDS_DOMAINID_PUB, conf_pub);
+    CU_ASSERT_FATAL (domain > 0);
+    const dds_entity_t participant = dds_create_participant (DDS_DOMAINID_PUB, NULL, NULL);
+    CU_ASSERT_FATAL (participant > 0);
+    const dds_entity_t topic = dds_create_topic (participant, &Space_Type1_desc, topicname, qos, NULL);
+    CU_ASSERT_FATAL (topic > 0);
+    if (incarnation == 0)
+    {
+      const dds_entity_t writer_a = store_key_writer (participant, topic, qos, "a");
+      const dds_entity_t writer_b = store_key_writer (participant, topic, qos, "b");
+      ret = dds_write (writer_a, &(Space_Type1){ 1, 1, 0 });
+      CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+      ret = dds_write (writer_b, &(Space_Type1){ 2, 2, 0 });
+      CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+      CU_ASSERT_EQUAL (store_count_files (dir), 3);
+    }
+    else
+    {
+      /* only the writer in partition "a" gets recreated, it must republish its
+         own sample and nothing of the others */
+      dds_qos_t *sqos = dds_create_qos ();
+      dds_qset_partition1 (sqos, "*");
+      const dds_entity_t subscriber = dds_create_subscriber (participant, sqos, NULL);
+      CU_ASSERT_FATAL (subscriber > 0);
+      dds_delete_qos (sqos);
+      const dds_entity_t reader = store_restore_reader (subscriber, topic, qos);
+      (void) store_key_writer (participant, topic, qos, "a");
+      struct store_restore_result res;
+      store_restore_take_all (reader, &res);
+      CU_ASSERT_EQUAL_FATAL (res.n, 1);
+      CU_ASSERT_FATAL (res.s[0].key == 1 && res.s[0].valid && res.s[0].value == 1);
+    }
+    ret = dds_delete (domain);
+    CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  }
+  ret = dds_delete (domain_sub);
+  CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  dds_delete_qos (qos);
+  dds_free (conf_pub);
+  dds_free (conf_sub);
+  store_restore_rmdir (dir);
+}
+#endif
@@ -0,0 +1,134 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "dds/dds.h"
+#include "dds/ddsc/dds_statistics.h"
+#include "dds/ddsi/q_addrset.h"
+#include "dds/ddsi/q_entity.h"
+#include "dds__entity.h"
+#include "dds__writer.h"
+
+#include "test_common.h"
+
+#define NREADERS 3
+
+static void count_locator (const ddsi_xlocator_t *loc, void *varg)
+{
+  uint32_t * const n = varg;
+  (void) loc;
+  (*n)++;
+}
+
+static uint32_t writer_addrset_size (dds_entity_t wr)
+{
+  uint32_t n = 0;
+  dds_writer *wrent;
+  dds_return_t rc = dds_writer_lock (wr, &wrent);
+  CU_ASSERT_FATAL (rc == 0);
+  ddsrt_mutex_lock (&wrent->m_wr->e.lock);
+  addrset_forall (wrent->m_wr->as, count_locator, &n);
+  ddsrt_mutex_unlock (&wrent->m_wr->e.lock);
+  dds_writer_unlock (wrent);
+  return n;
+}
+
+static void wait_for_rebuild (struct dds_statistics *stat, const struct dds_stat_keyvalue *rebuild_count, uint32_t prev)
+{
+  dds_time_t tend = dds_time () + DDS_SECS (10);
+  do {
+    dds_sleepfor (DDS_MSECS (10));
+    dds_return_t rc = dds_refresh_statistics (stat);
+    CU_ASSERT_FATAL (rc == 0);
+  } while (rebuild_count->u.u32 == prev && dds_time () < tend);
+  CU_ASSERT_FATAL (rebuild_count->u.u32 > prev);
+}
+
+CU_Test (ddsc_wraddrset, deferred_rebuild)
+{
+  /* Every reader participant has a socket of its own and the data is sent
+     using unicast only, so the writer's address set has one locator for
+     each remote participant it needs to reach, if it is optimal */
+  const char *config = "\
+<General><AllowMulticast>spdp</AllowMulticast></General>\
+<Compatibility><ManySocketsMode>many</ManySocketsMode></Compatibility>\
+<Internal><WriterAddressSetRebuildDelay>1s</WriterAddressSetRebuildDelay></Internal>";
+  dds_entity_t pub_dom, sub_dom;
+  create_domain_pair (config, NULL, &pub_dom, &sub_dom);
+
+  char tpname[100];
+  create_unique_topic_name ("ddsc_wraddrset", tpname, sizeof (tpname));
+  dds_qos_t * const qos = dds_create_qos ();
+  CU_ASSERT_FATAL (qos != NULL);
+  dds_qset_reliability (qos, DDS_RELIABILITY_RELIABLE, DDS_INFINITY);
+  const dds_entity_t pub_pp = dds_create_participant (0, NULL, NULL);
+  CU_ASSERT_FATAL (pub_pp > 0);
+  const dds_entity_t pub_tp = dds_create_topic (pub_pp, &Space_Type1_desc, tpname, qos, NULL);
+  CU_ASSERT_FATAL (pub_tp > 0);
+  const dds_entity_t wr = dds_create_writer (pub_pp, pub_tp, qos, NULL);
+  CU_ASSERT_FATAL (wr > 0);
+  struct dds_statistics *stat = dds_create_statistics (wr);
+  CU_ASSERT_FATAL (stat != NULL);
+  const struct dds_stat_keyvalue *rebuild_count = dds_lookup_statistic (stat, "addrset_rebuild_count");
+  CU_ASSERT_FATAL (rebuild_count != NULL);
+  dds_return_t rc = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (rc == 0);
+  uint32_t nrebuilds = rebuild_count->u.u32;
+
+  dds_entity_t sub_pp[NREADERS];
+  for (int i = 0; i < NREADERS; i++)
+  {
+    sub_pp[i] = dds_create_participant (1, NULL, NULL);
+    CU_ASSERT_FATAL (sub_pp[i] > 0);
+    const dds_entity_t sub_tp = dds_create_topic (sub_pp[i], &Space_Type1_desc, tpname, qos, NULL);
+    CU_ASSERT_FATAL (sub_tp > 0);
+    const dds_entity_t rd = dds_create_reader (sub_pp[i], sub_tp, qos, NULL);
+    CU_ASSERT_FATAL (rd > 0);
+  }
+  dds_delete_qos (qos);
+
+  /* adding readers extends the address set to cover all of them without
+     rebuilding it from scratch */
+  wait_for_publication_matched (wr, NREADERS, DDS_SECS (10));
+  CU_ASSERT (writer_addrset_size (wr) == NREADERS);
+  rc = dds_refresh_statistics (stat);
+  CU_ASSERT_FATAL (rc == 0);
+  CU_ASSERT (rebuild_count->u.u32 == nrebuilds);
+
+  /* the rebuild when the event fires doesn't change a thing because adding
+     each of these readers requires a locator of its own */
+  wait_for_rebuild (stat, rebuild_count, nrebuilds);
+  CU_ASSERT (writer_addrset_size (wr) == NREADERS);
+  nrebuilds = rebuild_count->u.u32;
+
+  /* removing a reader leaves the address set untouched until the event fires,
+     it just sends a bit more than necessary until then */
+  rc = dds_delete (sub_pp[0]);
+  CU_ASSERT_FATAL (rc == 0);
+  wait_for_publication_matched (wr, NREADERS - 1, DDS_SECS (10));
+  CU_ASSERT (writer_addrset_size (wr) == NREADERS);
+  wait_for_rebuild (stat, rebuild_count, nrebuilds);
+  CU_ASSERT (writer_addrset_size (wr) == NREADERS - 1);
+
+  /* data still arrives at the remaining readers */
+  rc = dds_write (wr, &(Space_Type1){ 1, 2, 3 });
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_wait_for_acks (wr, DDS_SECS (10));
+  CU_ASSERT_FATAL (rc == 0);
+
+  dds_delete_statistics (stat);
+  rc = dds_delete (pub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+  rc = dds_delete (sub_dom);
+  CU_ASSERT_FATAL (rc == 0);
+}
@@ -88,6 +88,36 @@ DDS_EXPORT size_t dds_stream_print_sample (dds_istream_t * __restrict is, const
 
 DDS_EXPORT uint16_t dds_stream_minimum_xcdr_version (const uint32_t * __restrict ops);
 
+/* Maximum nesting depth of a member referenced by a struct dds_stream_member_path */
+#define DDS_STREAM_MEMBER_MAX_DEPTH 8
+
+/* Member of a primitive, enumerated or string type, possibly in a nested struct, as
+   the sequence of ADR instructions leading to it from the top-level type, and the
+   position of each of those instructions in the members of the enclosing struct (a
+   representation that doesn't depend on the in-memory layout) */
+struct dds_stream_member_path {
+  uint32_t depth;
+  const uint32_t *ops[DDS_STREAM_MEMBER_MAX_DEPTH];
+  uint32_t index[DDS_STREAM_MEMBER_MAX_DEPTH];
+};
+
+/* Looks up the member at byte offset "offset" in the in-memory representation of the
+   type described by "ops", returning BAD_PARAMETER if there is no such member and
+   UNSUPPORTED if the type can't be handled by dds_stream_locate_members (mutable types
+   and types with optional members) */
+DDS_EXPORT dds_return_t dds_stream_member_path_from_offset (const uint32_t * __restrict ops, uint32_t offset, struct dds_stream_member_path * __restrict path);
+
+/* Looks up the member identified by index[0 .. depth-1] (as in the index field of
+   struct dds_stream_member_path), with the same return values as
+   dds_stream_member_path_from_offset */
+DDS_EXPORT dds_return_t dds_stream_member_path_from_index (const uint32_t * __restrict ops, uint32_t depth, const uint32_t * __restrict index, struct dds_stream_member_path * __restrict path);
+
+/* Sets offs[i] to the index in is->m_buffer of the (aligned) value of member paths[i]
+   for i < n <= 64, or to UINT32_MAX if the member is not present in the data.  Skips
+   over all other members and stops as soon as all n have been found, leaving is in an
+   undefined state. */
+DDS_EXPORT void dds_stream_locate_members (dds_istream_t * __restrict is, const uint32_t * __restrict ops, uint32_t n, const struct dds_stream_member_path * __restrict paths, uint32_t * __restrict offs);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -1008,6 +1008,20 @@ static struct cfgelem multiple_recv_threads_attrs[] = {
       "but to eliminate all risks, it will retry as many times as specified "
       "by this attribute before aborting.</p>"
     )),
+  INT("unicastdatathreads", NULL, 1, "1",
+    MEMBER(recv_uc_data_threads),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This attribute sets the number of receive threads dedicated to "
+      "unicast data when ManySocketsMode is set to single. Values greater "
+      "than 1 cause that many UDP sockets to be bound to the unicast data "
+      "port with SO_REUSEPORT, each with its own receive thread and receive "
+      "buffer pool. The kernel distributes the incoming packets over these "
+      "sockets by hashing the source and destination addresses, so all "
+      "packets from a single writer are handled by the same thread. "
+      "Spreading the load over the threads in this way depends on the "
+      "SO_REUSEPORT semantics of Linux. The number is limited to 32.</p>"
+    )),
   END_MARKER
 };
 
@@ -1066,6 +1080,17 @@ static struct cfgelem internal_cfgelems[] = {
       "expressed in samples. Once a delivery queue is full, incoming samples "
       "destined for that queue are dropped until space becomes available "
       "again.</p>")),
+  INT("DeliveryQueueThreads", NULL, 1, "1",
+    MEMBER(delivery_queue_threads),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the number of delivery queues (each with its own "
+      "thread) used for application data received from the network. Each "
+      "remote writer is assigned to one of the queues based on its GUID, so "
+      "that the samples of any one writer are still delivered in order, while "
+      "a slow reader or listener only delays the writers that share its "
+      "queue. It has no effect if network channels are used, as each channel "
+      "already has a delivery queue of its own.</p>")),
   INT("PrimaryReorderMaxSamples", NULL, 1, "128",
     MEMBER(primary_reorder_maxsamples),
     FUNCTIONS(0, uf_uint, 0, pf_uint),
@@ -1231,6 +1256,21 @@ static struct cfgelem internal_cfgelems[] = {
       "deletion of a reliable writer with unacknowledged data in its history "
       "will be postponed to provide proper reliable transmission.<p>"),
     UNIT("duration")),
+  STRING("WriterAddressSetRebuildDelay", NULL, 1, "0 s",
+    MEMBER(writer_addrset_rebuild_delay),
+    FUNCTIONS(0, uf_duration_ms_1hr, 0, pf_duration),
+    DESCRIPTION(
+      "<p>This setting controls how a writer updates the set of addresses it "
+      "sends data to when remote readers are matched or unmatched. With the "
+      "default of 0, it is recomputed from scratch for every change, which "
+      "costs time proportional to the number of matched readers and thus "
+      "becomes expensive when many readers are discovered at once. With a "
+      "positive value, a newly matched reader is covered by adding addresses "
+      "to the current set if necessary and an unmatched one leaves the set "
+      "as is, and the full recomputation of the optimal set happens once the "
+      "matched readers have not changed for this long (but at most 10 times "
+      "this long after the first change).</p>"),
+    UNIT("duration")),
   MOVED("MinimumSocketReceiveBufferSize", "CycloneDDS/Domain/Internal/SocketReceiveBufferSize[@min]"),
   MOVED("MinimumSocketSendBufferSize", "CycloneDDS/Domain/Internal/SocketSendBufferSize[@min]"),
   GROUP("SocketReceiveBufferSize", NULL, sock_rcvbuf_size_attrs, 1,
@@ -1300,6 +1340,48 @@ static struct cfgelem internal_cfgelems[] = {
       "scheduled exactly, whereas a value of 10ms would mean that events are "
       "rounded up to the nearest 10 milliseconds.</p>"),
     UNIT("duration")),
+  ENUM("TimedEventQueue", NULL, 1, "heap",
+    MEMBER(timed_event_queue),
+    FUNCTIONS(0, uf_timed_event_queue, 0, pf_timed_event_queue),
+    DESCRIPTION(
+      "<p>This element selects the data structure used for ordering the "
+      "timed events (heartbeats, acknowledgements, participant "
+      "announcements, &c.) of the event queues. Possible values are:</p>\n"
+      "<ul><li><i>heap</i>: a Fibonacci heap, scheduling events exactly;</li>\n"
+      "<li><i>wheel</i>: a hierarchical timing wheel with constant-time "
+      "insertion and rescheduling, which is cheaper when many events are "
+      "rescheduled frequently. The resolution of the wheel is "
+      "Internal/ScheduleTimeRounding, but at least 1ms.</li></ul>\n"
+      "<p>The default is <i>heap</i>.</p>"),
+    VALUES("heap","wheel")),
+  ENUM("WhcSequenceIndex", NULL, 1, "hash",
+    MEMBER(whc_seq_index),
+    FUNCTIONS(0, uf_whc_seq_index, 0, pf_whc_seq_index),
+    DESCRIPTION(
+      "<p>This element selects how the writer history caches locate samples "
+      "by sequence number. Possible values are:</p>\n"
+      "<ul><li><i>hash</i>: a hash table;</li>\n"
+      "<li><i>ring</i>: an array of slots indexed by sequence number covering "
+      "the most recent samples, with a hash table for older samples that fall "
+      "outside it. This is faster for writers retaining a large number of "
+      "samples, such as KEEP_ALL transient-local writers, at the cost of one "
+      "pointer per sequence number in the range covered.</li></ul>\n"
+      "<p>The default is <i>hash</i>.</p>"),
+    VALUES("hash","ring")),
+  STRING("WhcStoreDirectory", NULL, 1, "",
+    MEMBER(whc_store_dir),
+    FUNCTIONS(0, uf_string, ff_free, pf_string),
+    DESCRIPTION(
+      "<p>This element specifies a directory in which the writer history "
+      "caches of writers with TRANSIENT or PERSISTENT durability store their "
+      "samples, in an append-only memory-mapped file per domain, topic, type "
+      "and set of partitions. The history is then kept out of the heap, and "
+      "when such a writer is created again after a restart, the samples in "
+      "the file are published again so that late-joining readers receive "
+      "them. A file can only be used by one writer at a time, any other "
+      "writer keeps its history in memory.</p>\n"
+      "<p>If empty (the default), such writers keep their history in memory "
+      "just like TRANSIENT_LOCAL writers.</p>")),
 #ifdef DDS_HAS_BANDWIDTH_LIMITING
   STRING("AuxiliaryBandwidthLimit", NULL, 1, "inf",
     MEMBER(auxiliary_bandwidth_limit),
@@ -1448,6 +1530,49 @@ static struct cfgelem internal_cfgelems[] = {
     "transport (e.g., UDP) and ManySocketsMode not set to single (the "
     "default).</p>"),
     VALUES("false","true","default")),
+  INT("ReceiveBatchSize", NULL, 1, "1",
+    MEMBER(recv_batch_size),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the maximum number of datagrams a receive thread "
+      "reads from a socket in a single system call. Values greater than 1 "
+      "reduce the number of system calls when many small packets arrive, at "
+      "the cost of copying each datagram once into the receive buffer and of "
+      "a staging buffer of up to 64 kB per datagram per receive thread. It is "
+      "only supported for UDP on platforms providing recvmmsg (e.g., Linux) "
+      "and for raw Ethernet with a receive ring, and is limited to 64.</p>")),
+  STRING("RawEthReceiveRingSize", NULL, 1, "1 MiB",
+    MEMBER(raweth_rx_ring_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element sets the size of the memory-mapped ring into which the "
+      "kernel stores the frames received by each raw Ethernet socket "
+      "(PACKET_RX_RING). Frames are then taken from the ring without a "
+      "system call per frame, and a full ring drops frames just like a full "
+      "socket receive buffer. Each slot in the ring is large enough for a "
+      "frame of MaxMessageSize bytes. Setting it to 0 makes the raw Ethernet "
+      "transport use regular socket reads instead.</p>"),
+    UNIT("memsize")),
+  INT("SecureDecodeThreads", NULL, 1, "0",
+    MEMBER(secure_decode_threads),
+    FUNCTIONS(0, uf_uint, 0, pf_uint),
+    DESCRIPTION(
+      "<p>This element sets the number of additional threads used for "
+      "decoding the messages with RTPS-level protection (DDS Security) that "
+      "a receive thread reads in a single batch, so that the decryption can "
+      "use multiple cores. The messages are still processed in the order in "
+      "which they were received. With the default of 0 the receive threads "
+      "decode the messages themselves. It only has an effect if "
+      "ReceiveBatchSize is greater than 1.</p>")),
+  BOOL("TransmitBatching", NULL, 1, "false",
+    MEMBER(xmit_batching),
+    FUNCTIONS(0, uf_boolean, 0, pf_boolean),
+    DESCRIPTION(
+      "<p>This element controls whether a message that is to be sent to "
+      "multiple unicast addresses over the same socket is sent to all of them "
+      "using a single system call. It is only supported for UDP on platforms "
+      "providing sendmmsg (e.g., Linux) and is not used for messages that "
+      "require RTPS-level encoding for DDS Security.</p>")),
   GROUP("ControlTopic", control_topic_cfgelems, control_topic_cfgattrs, 1,
     NOMEMBER,
     NOFUNCTIONS,
@@ -1611,6 +1736,60 @@ static struct cfgelem tcp_cfgelems[] = {
       "used instead. This may help work around incorrectly advertised "
       "addresses when using TCP.</p>"
     )),
+  STRING("SendQueueSize", NULL, 1, "0 B",
+    MEMBER(tcp_send_queue_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the maximum number of bytes that may be "
+      "queued for a single TCP connection when the socket can't accept "
+      "them immediately. With a non-zero value, messages that can't be "
+      "sent immediately are queued and sent in the background, so that a "
+      "slow peer doesn't delay the delivery of data to other peers; "
+      "messages that don't fit in the queue are dropped and recovered "
+      "by the usual retransmit mechanism. The default of 0 disables the "
+      "queueing and makes writes to the socket block for up to "
+      "WriteTimeout. Queueing is not supported in combination with "
+      "SSL.</p>"),
+    UNIT("memsize")),
+  END_MARKER
+};
+
+static struct cfgelem shmring_cfgelems[] = {
+  BOOL("AllowOtherUsers", NULL, 1, "false",
+    MEMBER(shmring_allow_other_users),
+    FUNCTIONS(0, uf_boolean, 0, pf_boolean),
+    DESCRIPTION(
+      "<p>This element specifies whether processes of other users may send "
+      "data into the ring buffer. By default the shared memory segment is "
+      "only accessible to the user that created it, and peers running as "
+      "another user communicate using the regular transport instead. Any "
+      "process that has access to the ring can disrupt the communication "
+      "through it.</p>"
+    )),
+  BOOL("Enable", NULL, 1, "false",
+    MEMBER(shmring_enable),
+    FUNCTIONS(0, uf_boolean, 0, pf_boolean),
+    DESCRIPTION(
+      "<p>This element enables the shared-memory ring transport for "
+      "communicating with other Cyclone DDS processes on the same machine. "
+      "Each domain instance then creates a ring buffer in POSIX shared "
+      "memory and advertises it as an additional unicast locator for data "
+      "in its discovery information; peers on the same machine that have it "
+      "enabled as well send data by copying it directly into this ring "
+      "instead of passing through the network stack. Discovery traffic "
+      "continues to use the regular transport. Only supported on Linux.</p>"
+    )),
+  STRING("RingSize", NULL, 1, "4 MiB",
+    MEMBER(shmring_size),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This element specifies the size of the ring buffer in which the "
+      "messages from all peers on the same machine are received. It is "
+      "rounded up to a power of two of at least 256 kB. Messages that do "
+      "not fit because the receiving process is not keeping up are "
+      "dropped, just like they would be by a full socket receive "
+      "buffer.</p>"),
+    UNIT("memsize")),
   END_MARKER
 };
 
@@ -1955,6 +2134,30 @@ static struct cfgelem tracing_cfgelems[] = {
       "existing log file. The default is to create a new log file each time, "
       "which is generally the best option if a detailed log is generated.</p>"
     )),
+  ENUM("OutputFormat", NULL, 1, "text",
+    MEMBER(trace_output_format),
+    FUNCTIONS(0, uf_trace_output_format, 0, pf_trace_output_format),
+    DESCRIPTION(
+      "<p>This option specifies the format of the tracing output:</p>\n"
+      "<ul><li><i>text</i>: each message is formatted when it is generated "
+      "and written to the file immediately;</li>\n"
+      "<li><i>binary</i>: the arguments of each message are stored in a "
+      "per-thread buffer and a background thread writes them to the file "
+      "in a compact binary format, the decode-trace tool converts it back "
+      "to text.</li></ul>\n"
+      "<p>The binary format greatly reduces the cost of tracing, but "
+      "messages are dropped if a buffer fills up faster than it is emptied "
+      "(see Tracing/BinaryBufferSize). Messages written to the log are always "
+      "formatted as text, and so is the tracing output if Tracing/OutputFile "
+      "is <i>stdout</i> or <i>stderr</i>.</p>"),
+    VALUES("text","binary")),
+  STRING("BinaryBufferSize", NULL, 1, "256 kB",
+    MEMBER(trace_binary_bufsize),
+    FUNCTIONS(0, uf_memsize, 0, pf_memsize),
+    DESCRIPTION(
+      "<p>This option specifies the size of the per-thread buffers used for "
+      "binary tracing, see Tracing/OutputFormat.</p>"),
+    UNIT("memsize")),
   STRING("PacketCaptureFile", NULL, 1, "",
     MEMBER(pcap_file),
     FUNCTIONS(0, uf_string, ff_free, pf_string),
@@ -2076,6 +2279,14 @@ static struct cfgelem domain_cfgelems[] = {
       "<p>The TCP element allows specifying various parameters related to "
       "running DDSI over TCP.</p>"
     )),
+  GROUP("ShmRing", shmring_cfgelems, NULL, 1,
+    NOMEMBER,
+    NOFUNCTIONS,
+    DESCRIPTION(
+      "<p>The ShmRing element allows specifying various parameters related "
+      "to the shared-memory ring transport for communicating with other "
+      "processes on the same machine.</p>"
+    )),
 #ifdef DDS_HAS_SSL
   GROUP("SSL", ssl_cfgelems, NULL, 1,
     NOMEMBER,
@@ -17,6 +17,7 @@
 #include "dds/export.h"
 #include "dds/features.h"
 #include "dds/ddsrt/sched.h"
+#include "dds/ddsrt/log_binary.h"
 #include "dds/ddsi/ddsi_portmapping.h"
 #include "dds/ddsi/ddsi_locator.h"
 
@@ -186,6 +187,21 @@ enum ddsi_many_sockets_mode {
   DDSI_MSM_MANY_UNICAST
 };
 
+enum ddsi_trace_output_format {
+  DDSI_TRACE_TEXT,
+  DDSI_TRACE_BINARY
+};
+
+enum ddsi_timed_event_queue {
+  DDSI_TEVQ_HEAP,
+  DDSI_TEVQ_WHEEL
+};
+
+enum ddsi_whc_seq_index {
+  DDSI_WHC_SEQIDX_HASH,
+  DDSI_WHC_SEQIDX_RING
+};
+
 #ifdef DDS_HAS_SECURITY
 struct ddsi_plugin_library_properties {
   char *library_path;
@@ -253,6 +269,9 @@ struct ddsi_config
   FILE *tracefp;
   char *tracefile;
   int tracingAppendToFile;
+  enum ddsi_trace_output_format trace_output_format;
+  uint32_t trace_binary_bufsize;
+  struct ddsrt_log_binary *tracebin;
   uint32_t allowMulticast;
   int prefer_multicast;
   enum ddsi_transport_selector transport_selector;
@@ -284,11 +303,17 @@ struct ddsi_config
   int prioritize_retransmit;
   enum ddsi_boolean_default multiple_recv_threads;
   unsigned recv_thread_stop_maxretries;
+  uint32_t recv_uc_data_threads;
+  uint32_t recv_batch_size;
+  uint32_t raweth_rx_ring_size;
+  uint32_t secure_decode_threads;
+  int xmit_batching;
 
   unsigned primary_reorder_maxsamples;
   unsigned secondary_reorder_maxsamples;
 
   unsigned delivery_queue_maxsamples;
+  uint32_t delivery_queue_threads;
 
   uint16_t fragment_size;
   uint32_t max_msg_size;
@@ -309,6 +334,12 @@ struct ddsi_config
   int64_t tcp_read_timeout;
   int64_t tcp_write_timeout;
   int tcp_use_peeraddr_for_unicast;
+  uint32_t tcp_send_queue_size;
+
+  /* Shared-memory ring transport configuration */
+  int shmring_enable;
+  int shmring_allow_other_users;
+  uint32_t shmring_size;
 
 #ifdef DDS_HAS_SSL
   /* SSL support for TCP */
@@ -354,6 +385,8 @@ struct ddsi_config
   uint32_t whc_highwater_mark;
   struct ddsi_config_maybe_uint32 whc_init_highwater_mark;
   int whc_adaptive;
+  enum ddsi_whc_seq_index whc_seq_index;
+  char *whc_store_dir;
 
   unsigned defrag_unreliable_maxsamples;
   unsigned defrag_reliable_maxsamples;
@@ -361,6 +394,7 @@ struct ddsi_config
   int64_t responsiveness_timeout;
   uint32_t max_participants;
   int64_t writer_linger_duration;
+  int64_t writer_addrset_rebuild_delay;
   int multicast_ttl;
   struct ddsi_config_socket_buf_size socket_rcvbuf_size;
   struct ddsi_config_socket_buf_size socket_sndbuf_size;
@@ -368,6 +402,7 @@ struct ddsi_config
   int64_t nack_delay;
   int64_t preemptive_ack_delay;
   int64_t schedule_time_rounding;
+  enum ddsi_timed_event_queue timed_event_queue;
   int64_t auto_resched_nack_delay;
   int64_t ds_grace_period;
 #ifdef DDS_HAS_BANDWIDTH_LIMITING
@@ -27,6 +27,7 @@
 #include "dds/ddsi/q_protocol.h"
 #include "dds/ddsi/q_sockwaitset.h"
 #include "dds/ddsi/q_config.h"
+#include "dds/ddsi/q_lease.h"
 
 #if defined (__cplusplus)
 extern "C" {
@@ -50,6 +51,7 @@ struct ddsi_tkmap;
 struct dds_security_context;
 struct dds_security_match_index;
 struct ddsi_hsadmin;
+struct rtps_decode_pool;
 
 typedef struct config_in_addr_node {
    ddsi_locator_t loc;
@@ -106,9 +108,10 @@ struct ddsi_domaingv {
   /* Queue for garbage collection requests */
   struct gcreq_queue *gcreq_queue;
 
-  /* Lease junk */
-  ddsrt_mutex_t leaseheap_lock;
-  ddsrt_fibheap_t leaseheap;
+  /* Lease junk; leaseheap_tcheck is (a lower bound of) the time at which
+     the expiry of the leases will be checked next, really an ddsrt_etime_t */
+  struct lease_shard leaseheap[LEASEHEAP_NSHARDS];
+  ddsrt_atomic_uint64_t leaseheap_tcheck;
 
   /* Transport factories & selected factory */
   struct ddsi_tran_factory *ddsi_tran_factories;
@@ -124,6 +127,14 @@ struct ddsi_domaingv {
   struct ddsi_tran_conn * disc_conn_uc;
   struct ddsi_tran_conn * data_conn_uc;
 
+  /* Additional sockets bound to the same port as data_conn_uc when the
+     reception of unicast data is sharded over multiple receive threads
+     using SO_REUSEPORT (MultipleReceiveThreads[@unicastdatathreads]);
+     data_conn_uc is then itself one of the sharing sockets. */
+#define MAX_UC_DATA_RECV_THREADS 32
+  uint32_t n_data_conn_uc_extra;
+  struct ddsi_tran_conn * data_conn_uc_extra[MAX_UC_DATA_RECV_THREADS - 1];
+
   /* Connection used for all output (for connectionless transports), this
      used to simply be data_conn_uc, but:
 
@@ -151,6 +162,9 @@ struct ddsi_domaingv {
   struct ddsi_tran_conn * xmit_conns[MAX_XMIT_CONNS];
   ddsi_xlocator_t intf_xlocators[MAX_XMIT_CONNS];
 
+  /* Receiving connection for the shared-memory ring transport, NULL if not enabled */
+  struct ddsi_tran_conn * shmring_conn;
+
   /* TCP listener */
   struct ddsi_tran_listener * listener;
 
@@ -204,6 +218,7 @@ struct ddsi_domaingv {
 #ifdef DDS_HAS_SHM
   ddsi_locator_t loc_iceoryx_addr;
 #endif
+  ddsi_locator_t loc_shmring;
 
   /*
     Initial discovery address set, and the current discovery address
@@ -219,10 +234,10 @@ struct ddsi_domaingv {
      trigger socket.) Receive buffer pool is per receive thread,
      it is only a global variable because it needs to be freed way later
      than the receive thread itself terminates */
-#define MAX_RECV_THREADS 3
+#define MAX_RECV_THREADS (3 + MAX_UC_DATA_RECV_THREADS)
   uint32_t n_recv_threads;
   struct recv_thread {
-    const char *name;
+    char name[24];
     struct thread_state1 *ts;
     struct recv_thread_arg arg;
   } recv_threads[MAX_RECV_THREADS];
@@ -275,8 +290,10 @@ struct ddsi_domaingv {
   uint32_t networkQueueId;
   struct thread_state1 *channel_reader_ts;
 
-  /* Application data gets its own delivery queue */
-  struct nn_dqueue *user_dqueue;
+  /* Application data gets its own delivery queues, proxy writers are
+     assigned to one of them based on their GUIDs */
+  uint32_t n_user_dqueues;
+  struct nn_dqueue **user_dqueues;
 #endif
 
   /* Transmit side: pools for the serializer & transmit messages and a
@@ -341,6 +358,7 @@ struct ddsi_domaingv {
   struct dds_security_context *security_context;
   struct ddsi_hsadmin *hsadmin;
   bool handshake_include_optional;
+  struct rtps_decode_pool *rtps_decode_pool;
 #endif
 
 };
@@ -143,6 +143,30 @@ void entidx_enum_proxy_reader_fini (struct entidx_enum_proxy_reader *st) ddsrt_n
 void entidx_enum_participant_fini (struct entidx_enum_participant *st) ddsrt_nonnull_all;
 void entidx_enum_proxy_participant_fini (struct entidx_enum_proxy_participant *st) ddsrt_nonnull_all;
 
+/* Enumerates the endpoints of the given kind that are candidates for matching with
+   endpoint "e", which must be in the index: those with the same topic and type name
+   that share a partition with "e" (allowing for wildcards).  The QoS still needs to
+   be checked by the caller, and "next" may return endpoints that have since been
+   removed from the index. */
+struct entidx_enum_match
+{
+  uint32_t n, size, i;
+  struct entity_common **eps;
+#ifndef NDEBUG
+  vtime_t vtime;
+#endif
+};
+
+void entidx_enum_match_init (struct entidx_enum_match *st, const struct entity_index *ei, enum entity_kind kind, const struct entity_common *e) ddsrt_nonnull_all;
+void *entidx_enum_match_next (struct entidx_enum_match *st) ddsrt_nonnull_all;
+void entidx_enum_match_fini (struct entidx_enum_match *st) ddsrt_nonnull_all;
+
+/* Cache of QoS matching outcomes for reader/writer pairs with the same match-relevant
+   QoS (topic, type, partition, RxO QoS).  Lookup returns false if the outcome is not
+   known.  Only outcomes that don't depend on anything but the QoS may be stored. */
+bool entidx_match_verdict_lookup (struct entity_index *ei, const struct entity_common *rd, const struct entity_common *wr, bool *match, dds_qos_policy_id_t *reason) ddsrt_nonnull_all;
+void entidx_match_verdict_store (struct entity_index *ei, const struct entity_common *rd, const struct entity_common *wr, bool match, dds_qos_policy_id_t reason) ddsrt_nonnull_all;
+
 #ifdef DDS_HAS_TOPIC_DISCOVERY
 void entidx_insert_topic_guid (struct entity_index *ei, struct topic *tp) ddsrt_nonnull_all;
 void entidx_remove_topic_guid (struct entity_index *ei, struct topic *tp) ddsrt_nonnull_all;
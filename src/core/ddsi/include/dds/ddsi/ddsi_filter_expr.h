@@ -0,0 +1,62 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef DDSI_FILTER_EXPR_H
+#define DDSI_FILTER_EXPR_H
+
+#include "dds/dds.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+struct ddsi_sertype;
+struct ddsi_serdata;
+struct nn_content_filter_property;
+
+/* Filter class name in the content filter property of readers with a filter expression:
+   the expression refers to members by index (_i for the i'th member, _i._j for the j'th
+   member of the nested struct that is the i'th member), so any writer of a type with
+   the same layout can evaluate it without knowing the member names */
+#define DDSI_FILTER_EXPR_CLASS_NAME "DDSCYCLONE_INDEXED_SQL"
+
+/* Filter expression compiled against the instructions of a default sertype, so that it
+   can be evaluated on the CDR of a serdata as well as on an in-memory sample */
+struct ddsi_filter_expr;
+
+/* Compiles expression (see dds_set_topic_filter_expression for the syntax), with field
+   names bound to members by fields and parameters %0 .. %(nparams-1) replaced by the
+   literals in params */
+dds_return_t ddsi_filter_expr_new (struct ddsi_filter_expr **fx, const struct ddsi_sertype *type, const char *expression, uint32_t nfields, const dds_filter_field_t *fields, uint32_t nparams, const char * const *params);
+
+/* Compiles the expression in a content filter property as generated by
+   ddsi_filter_expr_get_property; UNSUPPORTED if the property uses a different
+   filter class or type can't be handled */
+dds_return_t ddsi_filter_expr_new_from_property (struct ddsi_filter_expr **fx, const struct ddsi_sertype *type, const struct nn_content_filter_property *prop);
+
+void ddsi_filter_expr_free (struct ddsi_filter_expr *fx);
+
+/* Sets prop to the representation of fx for use in discovery, aliasing fx and topic_name */
+void ddsi_filter_expr_get_property (const struct ddsi_filter_expr *fx, const char *topic_name, struct nn_content_filter_property *prop);
+
+/* Evaluates the filter on an in-memory sample */
+bool ddsi_filter_expr_eval_sample (const struct ddsi_filter_expr *fx, const void *sample);
+
+/* Evaluates the filter on the serialized representation of a sample, reading only the
+   members referenced by the expression; samples that are not of kind SDK_DATA (i.e.,
+   only contain the key) always pass */
+bool ddsi_filter_expr_eval_serdata (const struct ddsi_filter_expr *fx, const struct ddsi_serdata *sd);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSI_FILTER_EXPR_H */
@@ -41,6 +41,15 @@ typedef enum {
   NN_RTPS_MSG_STATE_ENCODED
 } nn_rtps_msg_state_t;
 
+/* A received RTPS message to be decoded by decode_rtps_messages */
+struct nn_rtps_decode_job {
+  unsigned char *buf;         /* in: message, header already checked and GUID prefix in host order */
+  size_t sz;                  /* in: size of message */
+  nn_rtps_msg_state_t state;  /* out */
+  unsigned char *dstbuf;      /* out: decoded message if state is ENCODED, to be freed by caller */
+  size_t dstlen;              /* out: size of decoded message */
+};
+
 #ifdef DDS_HAS_SECURITY
 
 struct ddsi_hsadmin;
@@ -1069,6 +1078,40 @@ decode_SecPrefix(
  */
 nn_rtps_msg_state_t decode_rtps_message(struct thread_state1 * const ts1, struct ddsi_domaingv *gv, struct nn_rmsg **rmsg, Header_t **hdr, unsigned char **buff, ssize_t *sz, struct nn_rbufpool *rbpool, bool isstream);
 
+/**
+ * @brief Decode a batch of received RTPS messages.
+ *
+ * Decodes the RTPS-level protected messages among the datagrams in jobs,
+ * using the decoding threads configured with Internal/SecureDecodeThreads
+ * (if any) in addition to the calling thread. The decoded messages are
+ * returned in new buffers, the original ones are not modified, and the
+ * order in which the messages are processed afterwards is up to the caller.
+ *
+ * @param[in]     ts1         Thread information.
+ * @param[in]     gv          Global information.
+ * @param[in]     n           Number of messages.
+ * @param[in,out] jobs        Messages to decode.
+ */
+void decode_rtps_messages(struct thread_state1 * const ts1, struct ddsi_domaingv *gv, uint32_t n, struct nn_rtps_decode_job *jobs);
+
+/**
+ * @brief Start the threads for decoding RTPS messages in parallel, if configured.
+ *
+ * @param[in]     gv          Global information.
+ *
+ * @returns dds_return_t
+ * @retval DDS_RETCODE_OK     Threads started or none configured.
+ * @retval DDS_RETCODE_ERROR  Starting the threads failed.
+ */
+dds_return_t rtps_decode_threads_start(struct ddsi_domaingv *gv);
+
+/**
+ * @brief Stop the threads started by rtps_decode_threads_start.
+ *
+ * @param[in]     gv          Global information.
+ */
+void rtps_decode_threads_stop(struct ddsi_domaingv *gv);
+
 /**
  * @brief Send the RTPS message securely.
  *
@@ -1423,6 +1466,30 @@ decode_rtps_message(
   return NN_RTPS_MSG_STATE_PLAIN;
 }
 
+DDS_INLINE_EXPORT inline void
+decode_rtps_messages(
+  UNUSED_ARG(struct thread_state1 * const ts1),
+  UNUSED_ARG(struct ddsi_domaingv *gv),
+  uint32_t n,
+  struct nn_rtps_decode_job *jobs)
+{
+  for (uint32_t i = 0; i < n; i++)
+  {
+    jobs[i].state = NN_RTPS_MSG_STATE_PLAIN;
+    jobs[i].dstbuf = NULL;
+    jobs[i].dstlen = 0;
+  }
+}
+
+DDS_INLINE_EXPORT inline dds_return_t rtps_decode_threads_start(UNUSED_ARG(struct ddsi_domaingv *gv))
+{
+  return DDS_RETCODE_OK;
+}
+
+DDS_INLINE_EXPORT inline void rtps_decode_threads_stop(UNUSED_ARG(struct ddsi_domaingv *gv))
+{
+}
+
 DDS_INLINE_EXPORT inline dds_return_t q_omg_security_load( UNUSED_ARG( struct dds_security_context *security_context ), UNUSED_ARG( const dds_qos_t *property_seq), UNUSED_ARG ( struct ddsi_domaingv *gv ) )
 {
   return DDS_RETCODE_ERROR;
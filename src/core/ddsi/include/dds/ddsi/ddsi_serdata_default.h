@@ -137,6 +137,7 @@ struct ddsi_sertype_default {
   struct serdatapool *serpool;
   struct ddsi_sertype_default_desc type;
   size_t opt_size;
+  const dds_topic_marshal_t *marshal; /* generated (de)serializers, NULL if not available */
 };
 
 struct ddsi_plist_sample {
@@ -163,6 +164,18 @@ extern DDS_EXPORT const struct ddsi_serdata_ops ddsi_serdata_ops_xcdr2_nokey;
 struct serdatapool * ddsi_serdatapool_new (void);
 void ddsi_serdatapool_free (struct serdatapool * pool);
 
+/* Writer loans without shared memory: for types where the serialized form
+   is identical to the in-memory representation, the application can write
+   the sample directly into the payload of a serdata.
+
+   - ddsi_serdata_default_loan_new returns a new serdata and sets *sample to its
+     payload, or returns NULL if the type does not allow this;
+   - ddsi_serdata_default_loan_fini turns it into a valid SDK_DATA serdata once
+     the application has filled in the sample, consuming the reference. */
+DDS_EXPORT bool ddsi_serdata_default_loan_supported (const struct ddsi_sertype *type);
+DDS_EXPORT struct ddsi_serdata *ddsi_serdata_default_loan_new (const struct ddsi_sertype *type, void **sample);
+DDS_EXPORT struct ddsi_serdata *ddsi_serdata_default_loan_fini (struct ddsi_serdata *dcmn);
+
 #if defined (__cplusplus)
 }
 #endif
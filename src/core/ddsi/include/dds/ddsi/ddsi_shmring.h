@@ -0,0 +1,37 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#ifndef DDSI_SHMRING_H
+#define DDSI_SHMRING_H
+
+#include <stdbool.h>
+#include "dds/ddsi/ddsi_locator.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/* Creates the shared-memory ring transport and the ring in which this domain
+   instance receives data, returning the locator of that ring in loc.  Fails if
+   the platform doesn't support it. */
+DDS_EXPORT int ddsi_shmring_init (struct ddsi_domaingv *gv, ddsi_locator_t *loc);
+
+struct ddsi_tran_factory;
+
+/* Whether the ring addressed by loc (which may be the own one) can still be
+   written into: false once its owner is gone or has given up on it. */
+DDS_EXPORT bool ddsi_shmring_locator_usable (struct ddsi_tran_factory *fact, const ddsi_locator_t *loc);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif
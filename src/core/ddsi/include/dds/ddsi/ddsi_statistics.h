@@ -21,7 +21,7 @@ extern "C" {
 struct reader;
 struct writer;
 
-void ddsi_get_writer_stats (struct writer *wr, uint64_t * __restrict rexmit_bytes, uint32_t * __restrict throttle_count, uint64_t * __restrict time_throttled, uint64_t * __restrict time_retransmit);
+void ddsi_get_writer_stats (struct writer *wr, uint64_t * __restrict rexmit_bytes, uint32_t * __restrict throttle_count, uint64_t * __restrict time_throttled, uint64_t * __restrict time_retransmit, uint32_t * __restrict addrset_rebuild_count, uint64_t * __restrict time_addrset_rebuild, uint32_t * __restrict filtered_count);
 void ddsi_get_reader_stats (struct reader *rd, uint64_t * __restrict discarded_bytes);
 
 #if defined (__cplusplus)
@@ -43,10 +43,22 @@ typedef struct ddsi_tran_listener * ddsi_tran_listener_t;
 typedef struct ddsi_tran_factory * ddsi_tran_factory_t;
 typedef struct ddsi_tran_qos ddsi_tran_qos_t;
 
+/* Buffer descriptor for batched reads: buf and len are provided by the
+   caller, size and srcloc are filled in by the transport */
+
+struct ddsi_tran_recvbuf {
+  unsigned char *buf;
+  size_t len;
+  ssize_t size;
+  ddsi_locator_t srcloc;
+};
+
 /* Function pointer types */
 
 typedef ssize_t (*ddsi_tran_read_fn_t) (ddsi_tran_conn_t, unsigned char *, size_t, bool, ddsi_locator_t *);
+typedef ssize_t (*ddsi_tran_read_multi_fn_t) (ddsi_tran_conn_t, size_t, struct ddsi_tran_recvbuf *);
 typedef ssize_t (*ddsi_tran_write_fn_t) (ddsi_tran_conn_t, const ddsi_locator_t *, size_t, const ddsrt_iovec_t *, uint32_t);
+typedef ssize_t (*ddsi_tran_write_multi_fn_t) (ddsi_tran_conn_t, size_t, const ddsi_locator_t *, size_t, const ddsrt_iovec_t *, uint32_t);
 typedef int (*ddsi_tran_locator_fn_t) (ddsi_tran_factory_t, ddsi_tran_base_t, ddsi_locator_t *);
 typedef bool (*ddsi_tran_supports_fn_t) (const struct ddsi_tran_factory *, int32_t);
 typedef ddsrt_socket_t (*ddsi_tran_handle_fn_t) (ddsi_tran_base_t);
@@ -113,7 +125,9 @@ struct ddsi_tran_conn
   /* Functions */
 
   ddsi_tran_read_fn_t m_read_fn;
+  ddsi_tran_read_multi_fn_t m_read_multi_fn; /* optional, only for datagram transports */
   ddsi_tran_write_fn_t m_write_fn;
+  ddsi_tran_write_multi_fn_t m_write_multi_fn; /* optional, only for datagram transports */
   ddsi_tran_peer_locator_fn_t m_peer_locator_fn;
   ddsi_tran_disable_multiplexing_fn_t m_disable_multiplexing_fn;
   ddsi_tran_locator_fn_t m_locator_fn;
@@ -225,6 +239,7 @@ struct ddsi_tran_qos
   enum ddsi_tran_qos_purpose m_purpose;
   int m_diffserv;
   struct nn_interface *m_interface; // only for purpose = XMIT
+  bool m_shared_port; // only for purpose = RECV_UC: one of several sockets bound to the same port
 };
 
 void ddsi_tran_factories_fini (struct ddsi_domaingv *gv);
@@ -280,10 +295,24 @@ DDS_INLINE_EXPORT inline ssize_t ddsi_conn_write (ddsi_tran_conn_t conn, const d
 DDS_INLINE_EXPORT inline ssize_t ddsi_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc) {
   return conn->m_closed ? -1 : conn->m_read_fn (conn, buf, len, allow_spurious, srcloc);
 }
+DDS_INLINE_EXPORT inline bool ddsi_conn_supports_read_multi (const struct ddsi_tran_conn *conn) {
+  return conn->m_read_multi_fn != 0;
+}
+DDS_INLINE_EXPORT inline ssize_t ddsi_conn_read_multi (ddsi_tran_conn_t conn, size_t nbufs, struct ddsi_tran_recvbuf *bufs) {
+  return conn->m_closed ? -1 : conn->m_read_multi_fn (conn, nbufs, bufs);
+}
+DDS_INLINE_EXPORT inline bool ddsi_conn_supports_write_multi (const struct ddsi_tran_conn *conn) {
+  return conn->m_write_multi_fn != 0;
+}
+/* Sends the same message to ndst destinations, returns the total number of bytes sent or -1 if
+   nothing could be sent at all */
+DDS_INLINE_EXPORT inline ssize_t ddsi_conn_write_multi (ddsi_tran_conn_t conn, size_t ndst, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags) {
+  return conn->m_closed ? -1 : conn->m_write_multi_fn (conn, ndst, dst, niov, iov, flags);
+}
 bool ddsi_conn_peer_locator (ddsi_tran_conn_t conn, ddsi_locator_t * loc);
 void ddsi_conn_disable_multiplexing (ddsi_tran_conn_t conn);
 void ddsi_conn_add_ref (ddsi_tran_conn_t conn);
-void ddsi_conn_free (ddsi_tran_conn_t conn);
+DDS_EXPORT void ddsi_conn_free (ddsi_tran_conn_t conn);
 int ddsi_conn_join_mc (ddsi_tran_conn_t conn, const ddsi_locator_t *srcip, const ddsi_locator_t *mcip, const struct nn_interface *interf);
 int ddsi_conn_leave_mc (ddsi_tran_conn_t conn, const ddsi_locator_t *srcip, const ddsi_locator_t *mcip, const struct nn_interface *interf);
 void ddsi_conn_transfer_group_membership (ddsi_tran_conn_t conn, ddsi_tran_conn_t newconn);
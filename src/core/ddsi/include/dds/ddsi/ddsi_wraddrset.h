@@ -21,9 +21,16 @@ extern "C" {
 
 struct addrset;
 struct writer;
+struct proxy_reader;
 
 struct addrset *compute_writer_addrset (const struct writer *wr);
 
+/* Returns an address set that extends the writer's current one to also cover
+   proxy reader prd, without reconsidering the choices made for the readers
+   already covered; returns NULL if that fails, in which case the full address
+   set needs to be computed with compute_writer_addrset */
+struct addrset *compute_writer_addrset_add_reader (const struct writer *wr, const struct proxy_reader *prd);
+
 #if defined (__cplusplus)
 }
 #endif
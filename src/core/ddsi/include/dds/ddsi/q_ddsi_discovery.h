@@ -44,6 +44,7 @@ int sedp_dispose_unregister_writer (struct writer *wr);
 int sedp_dispose_unregister_reader (struct reader *rd);
 
 int builtins_dqueue_handler (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const ddsi_guid_t *rdguid, void *qarg);
+void builtins_dqueue_batch_handler (void *qarg);
 
 #if defined (__cplusplus)
 }
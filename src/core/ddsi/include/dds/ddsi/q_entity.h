@@ -48,6 +48,8 @@ struct ddsi_sertype;
 struct whc;
 struct dds_qos;
 struct ddsi_plist;
+struct ddsi_filter_expr;
+struct entidx_match_class;
 struct lease;
 struct participant_sec_attributes;
 struct proxy_participant_sec_attributes;
@@ -144,6 +146,7 @@ struct wr_prd_match {
   ddsrt_wctime_t hb_to_ack_latency_tlastlog;
   uint32_t non_responsive_count;
   uint32_t rexmit_requests;
+  struct ddsi_filter_expr *filter; /* content filter of the proxy reader compiled for the writer's type, NULL if none */
 #ifdef DDS_HAS_SECURITY
   int64_t crypto_handle;
 #endif
@@ -208,6 +211,7 @@ struct entity_common {
   bool onlylocal;
   struct ddsi_domaingv *gv;
   ddsrt_avl_node_t all_entities_avlnode;
+  struct entidx_match_class *match_class; /* matching-relevant QoS, owned by the entity index; NULL if not an endpoint */
 
   /* QoS changes always lock the entity itself, and additionally
      (and within the scope of the entity lock) acquire qos_lock
@@ -347,6 +351,7 @@ struct writer
   uint32_t num_readers; /* total number of matching PROXY readers */
   uint32_t num_reliable_readers; /* number of matching reliable PROXY readers */
   uint32_t num_readers_requesting_keyhash; /* also +1 for protected keys and config override for generating keyhash */
+  uint32_t num_content_filtered_readers; /* number of matching PROXY readers with a content filter (wr_prd_match::filter != NULL) */
   ddsrt_avl_tree_t readers; /* all matching PROXY readers, see struct wr_prd_match */
   ddsrt_avl_tree_t local_readers; /* all matching LOCAL readers, see struct wr_rd_match */
 #ifdef DDS_HAS_NETWORK_PARTITIONS
@@ -361,6 +366,13 @@ struct writer
   uint64_t rexmit_bytes; /* cum bytes queued for retransmit */
   uint64_t time_throttled; /* cum time in throttled state */
   uint64_t time_retransmit; /* cum time in retransmitting state */
+  uint32_t addrset_rebuild_count; /* cum full recomputations of the address set */
+  uint64_t time_addrset_rebuild; /* cum time spent on full recomputations of the address set */
+  uint32_t filtered_count; /* cum samples not transmitted because the content filters of all matching PROXY readers rejected them */
+  uint32_t min_receive_buffer_size; /* smallest receive buffer size of matching PROXY readers, basis for the burst size limits */
+  ddsrt_mtime_t t_as_changed_first; /* first change in matching PROXY readers since address set was last fully computed, NEVER if none */
+  ddsrt_mtime_t t_as_changed_last; /* last change in matching PROXY readers since address set was last fully computed, NEVER if none */
+  struct xevent *as_rebuild_xevent; /* deferred full recomputation of the address set, NULL until needed */
   struct xeventq *evq; /* timed event queue to be used by this writer */
   struct local_reader_ary rdary; /* LOCAL readers for fast-pathing; if not fast-pathed, fall back to scanning local_readers */
   struct lease *lease; /* for liveliness administration (writer can only become inactive when using manual liveliness) */
@@ -406,6 +418,7 @@ struct reader
   ddsrt_avl_tree_t local_writers; /* all matching LOCAL writers, see struct rd_wr_match */
   ddsi2direct_directread_cb_t ddsi2direct_cb;
   void *ddsi2direct_cbarg;
+  nn_content_filter_property_t *content_filter; /* filter advertised in discovery, NULL if none */
 #ifdef DDS_HAS_SECURITY
   struct reader_sec_attributes *sec_attr;
 #endif
@@ -554,6 +567,7 @@ struct proxy_reader {
   ddsrt_avl_tree_t writers; /* matching LOCAL writers */
   uint32_t receive_buffer_size; /* assumed receive buffer size inherited from proxypp */
   filter_fn_t filter;
+  nn_content_filter_property_t *content_filter; /* content filter advertised by the reader, NULL if none */
 };
 
 DDS_EXPORT extern const ddsrt_avl_treedef_t wr_readers_treedef;
@@ -732,6 +746,10 @@ dds_return_t new_writer (struct writer **wr_out, struct ddsi_guid *wrguid, const
 dds_return_t new_reader (struct reader **rd_out, struct ddsi_guid *rdguid, const struct ddsi_guid *group_guid, struct participant *pp, const char *topic_name, const struct ddsi_sertype *type, const struct dds_qos *xqos, struct ddsi_rhc * rhc, status_cb_t status_cb, void *status_cb_arg);
 
 void update_reader_qos (struct reader *rd, const struct dds_qos *xqos);
+
+/* Sets the content filter advertised in discovery, so that matching remote writers can
+   avoid sending data the reader would discard anyway; NULL for none */
+void update_reader_content_filter (struct reader *rd, const nn_content_filter_property_t *content_filter);
 void update_writer_qos (struct writer *wr, const struct dds_qos *xqos);
 
 struct whc_node;
@@ -821,7 +839,7 @@ int new_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
 int delete_proxy_writer (struct ddsi_domaingv *gv, const struct ddsi_guid *guid, ddsrt_wctime_t timestamp, int isimplicit);
 int delete_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *guid, ddsrt_wctime_t timestamp, int isimplicit);
 
-void update_proxy_reader (struct proxy_reader *prd, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, ddsrt_wctime_t timestamp);
+void update_proxy_reader (struct proxy_reader *prd, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, const nn_content_filter_property_t *content_filter, ddsrt_wctime_t timestamp);
 void update_proxy_writer (struct proxy_writer *pwr, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, ddsrt_wctime_t timestamp);
 
 void proxy_writer_set_alive_may_unlock (struct proxy_writer *pwr, bool notify);
@@ -836,6 +854,13 @@ void delete_proxy_group (struct entity_index *entidx, const struct ddsi_guid *gu
    rebuild them all (which only makes sense after previously having emptied them all). */
 void rebuild_or_clear_writer_addrsets(struct ddsi_domaingv *gv, int rebuild);
 
+/* Between begin and end, matching of (non-builtin) proxy endpoints created by the
+   calling thread is deferred until the end, and a local writer matching any number
+   of the new proxy readers rebuilds its address set only once.  Meant for processing
+   a batch of SEDP samples; end is a no-op if no batch is in progress. */
+void proxy_endpoint_match_batch_begin (struct ddsi_domaingv *gv);
+void proxy_endpoint_match_batch_end (struct ddsi_domaingv *gv);
+
 void local_reader_ary_setfastpath_ok (struct local_reader_ary *x, bool fastpath_ok);
 
 void connect_writer_with_proxy_reader_secure(struct writer *wr, struct proxy_reader *prd, ddsrt_mtime_t tnow, int64_t crypto_handle);
@@ -12,6 +12,7 @@
 #ifndef NN_FREELIST_H
 #define NN_FREELIST_H
 
+#include "dds/export.h"
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/sync.h"
 
@@ -54,11 +55,17 @@ struct nn_freelist {
 #define NN_FREELIST_NPAR_LG2 2
 #define NN_FREELIST_MAGSIZE 256
 
+/* Maximum number of freelists for which a thread keeps a private magazine;
+   operations on any further freelists go through the shared magazines */
+#define NN_FREELIST_NTCACHE 4
+
 struct nn_freelistM {
   void *x[NN_FREELIST_MAGSIZE];
   void *next;
 };
 
+struct nn_freelist_tcache;
+
 struct nn_freelist1 {
   ddsrt_mutex_t lock;
   uint32_t count;
@@ -74,15 +81,17 @@ struct nn_freelist {
   uint32_t count;
   uint32_t max;
   size_t linkoff;
+  struct nn_freelist_tcache *tcaches; /* per-thread magazines, protected by a global lock */
 };
 
 #endif
 
-void nn_freelist_init (struct nn_freelist *fl, uint32_t max, size_t linkoff);
-void nn_freelist_fini (struct nn_freelist *fl, void (*free) (void *elem));
-bool nn_freelist_push (struct nn_freelist *fl, void *elem);
-void *nn_freelist_pushmany (struct nn_freelist *fl, void *first, void *last, uint32_t n);
-void *nn_freelist_pop (struct nn_freelist *fl);
+DDS_EXPORT void nn_freelist_init (struct nn_freelist *fl, uint32_t max, size_t linkoff);
+/* Must not be called concurrently with any other operation on fl */
+DDS_EXPORT void nn_freelist_fini (struct nn_freelist *fl, void (*free) (void *elem));
+DDS_EXPORT bool nn_freelist_push (struct nn_freelist *fl, void *elem);
+DDS_EXPORT void *nn_freelist_pushmany (struct nn_freelist *fl, void *first, void *last, uint32_t n);
+DDS_EXPORT void *nn_freelist_pop (struct nn_freelist *fl);
 
 #if defined (__cplusplus)
 }
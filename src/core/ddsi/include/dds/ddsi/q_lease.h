@@ -14,6 +14,7 @@
 
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/fibheap.h"
+#include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/time.h"
 
 #if defined (__cplusplus)
@@ -25,13 +26,24 @@ struct participant;
 struct entity_common;
 struct ddsi_domaingv; /* FIXME: make a special for the lease admin */
 
+/* Leases are spread over a number of heaps, each with its own lock, based on
+   the GUID of the entity to which they belong, so that updating the leases
+   of unrelated entities doesn't contend for a single lock */
+#define LEASEHEAP_NSHARDS 16u
+
+struct lease_shard {
+  ddsrt_mutex_t lock;
+  ddsrt_fibheap_t heap;
+};
+
 struct lease {
   ddsrt_fibheap_node_t heapnode;
   ddsrt_fibheap_node_t pp_heapnode;
-  ddsrt_etime_t tsched;         /* access guarded by leaseheap_lock */
+  ddsrt_etime_t tsched;         /* access guarded by lock of leaseheap[shard] */
   ddsrt_atomic_uint64_t tend;   /* really an ddsrt_etime_t */
   dds_duration_t tdur;          /* constant (renew depends on it) */
   struct entity_common *entity; /* constant */
+  uint32_t shard;               /* constant */
 };
 
 int compare_lease_tsched (const void *va, const void *vb);
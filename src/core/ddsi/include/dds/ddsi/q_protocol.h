@@ -109,6 +109,7 @@ typedef uint32_t nn_count_t;
 #define NN_LOCATOR_KIND_TCPv6 8
 #define NN_LOCATOR_KIND_SHEM 16
 #define NN_LOCATOR_KIND_RAWETH 0x8000 /* proposed vendor-specific */
+#define NN_LOCATOR_KIND_SHMRING 0x8001 /* vendor-specific */
 #define NN_LOCATOR_KIND_UDPv4MCGEN 0x4fff0000
 #define NN_LOCATOR_PORT_INVALID 0
 
@@ -19,8 +19,16 @@ extern "C" {
 
 struct dds_qos;
 
+int is_wildcard_partition (const char *str);
+
+/* pat may be a wildcard expression, name must not be */
+int partition_patmatch_p (const char *pat, const char *name);
+
 int partitions_match_p (const struct dds_qos *a, const struct dds_qos *b);
 
+/* all QoS settings that qos_match_mask_p can look at */
+#define QOS_MATCH_MASK (QP_TOPIC_NAME | QP_TYPE_NAME | QP_PARTITION | QP_RXO_MASK | QP_TYPE_CONSISTENCY_ENFORCEMENT)
+
 /* perform reader/writer QoS (and topic name, type name, partition) matching;
    mask can be used to exclude some of these (including topic name and type
    name, so be careful!)
@@ -44,6 +44,7 @@ struct nn_fragment_number_set;
 struct nn_sequence_number_set;
 
 typedef int (*nn_dqueue_handler_t) (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, const struct ddsi_guid *rdguid, void *qarg);
+typedef void (*nn_dqueue_batch_handler_t) (void *qarg);
 
 struct nn_rmsg_chunk {
   struct nn_rbuf *rbuf;
@@ -258,7 +259,14 @@ unsigned nn_reorder_nackmap (const struct nn_reorder *reorder, seqno_t base, seq
 seqno_t nn_reorder_next_seq (const struct nn_reorder *reorder);
 void nn_reorder_set_next_seq (struct nn_reorder *reorder, seqno_t seq);
 
+struct nn_dqueue_stats {
+  uint32_t nof_samples;     /* current queue depth */
+  uint32_t max_nof_samples; /* maximum queue depth observed */
+  uint64_t nof_enqueued;    /* total number of samples enqueued */
+};
+
 struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *gv, uint32_t max_samples, nn_dqueue_handler_t handler, void *arg);
+void nn_dqueue_set_batch_handler (struct nn_dqueue *q, nn_dqueue_batch_handler_t batch_handler);
 bool nn_dqueue_start (struct nn_dqueue *q);
 void nn_dqueue_free (struct nn_dqueue *q);
 bool nn_dqueue_enqueue_deferred_wakeup (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reorder_result_t rres);
@@ -268,6 +276,8 @@ void nn_dqueue_enqueue1 (struct nn_dqueue *q, const ddsi_guid_t *rdguid, struct
 void nn_dqueue_enqueue_callback (struct nn_dqueue *q, nn_dqueue_callback_t cb, void *arg);
 int  nn_dqueue_is_full (struct nn_dqueue *q);
 void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q);
+const char *nn_dqueue_name (const struct nn_dqueue *q);
+void nn_dqueue_get_stats (struct nn_dqueue *q, struct nn_dqueue_stats *st);
 
 void nn_defrag_stats (struct nn_defrag *defrag, uint64_t *discarded_bytes);
 void nn_reorder_stats (struct nn_reorder *reorder, uint64_t *discarded_bytes);
@@ -75,13 +75,15 @@
 #define dds_stream_write_keyBO_impl                   NAME2_BYTE_ORDER(dds_stream_write_key, _impl)
 #define dds_cdr_alignto_clear_and_resizeBO            NAME_BYTE_ORDER(dds_cdr_alignto_clear_and_resize)
 #define dds_stream_swap_if_needed_insituBO            NAME_BYTE_ORDER(dds_stream_swap_if_needed_insitu)
-#define dds_stream_to_BO_insitu                       NAME2_BYTE_ORDER(dds_stream_to_, _insitu)
+#define dds_os_put_prim_arrayBO                       NAME_BYTE_ORDER(dds_os_put_prim_array)
 #define dds_stream_extract_keyBO_from_data            NAME2_BYTE_ORDER(dds_stream_extract_key, _from_data)
 #define dds_stream_extract_keyBO_from_data1           NAME2_BYTE_ORDER(dds_stream_extract_key, _from_data1)
 #define dds_stream_extract_keyBO_from_key_prim_op     NAME2_BYTE_ORDER(dds_stream_extract_key, _from_key_prim_op)
 #define dds_stream_extract_keyBO_from_data_delimited  NAME2_BYTE_ORDER(dds_stream_extract_key, _from_data_delimited)
 #define dds_stream_extract_keyBO_from_data_pl         NAME2_BYTE_ORDER(dds_stream_extract_key, _from_data_pl)
 #define dds_stream_extract_keyBO_from_key             NAME2_BYTE_ORDER(dds_stream_extract_key, _from_key)
+#define dds_stream_write_key_generatedBO              NAME_BYTE_ORDER(dds_stream_write_key_generated)
+#define dds_stream_extract_key_from_data_generatedBO  NAME_BYTE_ORDER(dds_stream_extract_key_from_data_generated)
 
 // Type used by ddsi_cdrstream_keys.part.c to temporarily store key field positions in CDR
 // and the instructions needed for handling it
@@ -240,7 +242,7 @@ static uint64_t dds_is_get8 (dds_istream_t * __restrict s)
 
 static void dds_is_get_bytes (dds_istream_t * __restrict s, void * __restrict b, uint32_t num, uint32_t elem_size)
 {
-  dds_cdr_alignto (s, elem_size);
+  dds_cdr_alignto (s, (elem_size == 8 && s->m_xcdr_version == CDR_ENC_VERSION_2) ? 4 : elem_size);
   memcpy (b, s->m_buffer + s->m_index, num * elem_size);
   s->m_index += num * elem_size;
 }
@@ -308,29 +310,8 @@ static uint32_t dds_os_reserve8BE (dds_ostreamBE_t * __restrict s) { return dds_
 static void dds_stream_swap (void * __restrict vbuf, uint32_t size, uint32_t num)
 {
   assert (size == 1 || size == 2 || size == 4 || size == 8);
-  switch (size)
-  {
-    case 1:
-      break;
-    case 2: {
-      uint16_t *buf = vbuf;
-      for (uint32_t i = 0; i < num; i++)
-        buf[i] = ddsrt_bswap2u (buf[i]);
-      break;
-    }
-    case 4: {
-      uint32_t *buf = vbuf;
-      for (uint32_t i = 0; i < num; i++)
-        buf[i] = ddsrt_bswap4u (buf[i]);
-      break;
-    }
-    case 8: {
-      uint64_t *buf = vbuf;
-      for (uint32_t i = 0; i < num; i++)
-        buf[i] = ddsrt_bswap8u (buf[i]);
-      break;
-    }
-  }
+  if (size > 1)
+    ddsrt_bswap_copy (vbuf, vbuf, size, num);
 }
 
 static void dds_os_put_bytes (dds_ostream_t * __restrict s, const void * __restrict b, uint32_t l)
@@ -350,6 +331,14 @@ static void dds_os_put_bytes_aligned (dds_ostream_t * __restrict os, const void
   os->m_index += sz;
 }
 
+static void dds_os_put_bytes_aligned_swapped (dds_ostream_t * __restrict os, const void * __restrict data, uint32_t num, uint32_t elem_sz, uint32_t align)
+{
+  const uint32_t sz = num * elem_sz;
+  dds_cdr_alignto_clear_and_resize (os, align, sz);
+  ddsrt_bswap_copy (os->m_buffer + os->m_index, data, elem_sz, num);
+  os->m_index += sz;
+}
+
 static uint32_t get_type_size (enum dds_stream_typecode type)
 {
   DDSRT_STATIC_ASSERT (DDS_OP_VAL_1BY == 1 && DDS_OP_VAL_2BY == 2 && DDS_OP_VAL_4BY == 3 && DDS_OP_VAL_8BY == 4);
@@ -1091,30 +1080,49 @@ static bool is_member_present (const char * __restrict data, const uint32_t * __
   abort ();
 }
 
+/* Writing arrays of primitive types: a memcpy in native endianness, else a
+   combined copy-and-swap in a single pass over the data */
 #if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN
-static inline void dds_stream_to_BE_insitu (void * __restrict vbuf, uint32_t size, uint32_t num)
+static inline void dds_os_put_prim_arrayBE (dds_ostreamBE_t * __restrict os, const void * __restrict data, uint32_t num, uint32_t elem_sz, uint32_t align)
 {
-  dds_stream_swap (vbuf, size, num);
+  dds_os_put_bytes_aligned_swapped (&os->x, data, num, elem_sz, align);
 }
-static inline void dds_stream_to_LE_insitu (void * __restrict vbuf, uint32_t size, uint32_t num)
+static inline void dds_os_put_prim_arrayLE (dds_ostreamLE_t * __restrict os, const void * __restrict data, uint32_t num, uint32_t elem_sz, uint32_t align)
 {
-  (void) vbuf;
-  (void) size;
-  (void) num;
+  dds_os_put_bytes_aligned (&os->x, data, num, elem_sz, align, NULL);
 }
 #else /* if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN */
-static inline void dds_stream_to_BE_insitu (void * __restrict vbuf, uint32_t size, uint32_t num)
+static inline void dds_os_put_prim_arrayBE (dds_ostreamBE_t * __restrict os, const void * __restrict data, uint32_t num, uint32_t elem_sz, uint32_t align)
 {
-  (void) vbuf;
-  (void) size;
-  (void) num;
+  dds_os_put_bytes_aligned (&os->x, data, num, elem_sz, align, NULL);
 }
-static inline void dds_stream_to_LE_insitu (void * __restrict vbuf, uint32_t size, uint32_t num)
+static inline void dds_os_put_prim_arrayLE (dds_ostreamLE_t * __restrict os, const void * __restrict data, uint32_t num, uint32_t elem_sz, uint32_t align)
 {
-  dds_stream_swap (vbuf, size, num);
+  dds_os_put_bytes_aligned_swapped (&os->x, data, num, elem_sz, align);
 }
 #endif /* if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN */
 
+/* Generated marshalling functions (see dds_topic_marshal_t) operate on native-endian data
+   at constant offsets from a position that is a multiple of 8, these return false if they
+   can't be used so that the caller can fall back to interpreting the ops. */
+static const dds_topic_marshal_xcdr_t *dds_stream_marshal_xcdr (const struct ddsi_sertype_default * __restrict type, uint32_t xcdr_version)
+{
+  if (type->marshal == NULL)
+    return NULL;
+  return (xcdr_version == CDR_ENC_VERSION_2) ? &type->marshal->m_xcdr2 : &type->marshal->m_xcdr1;
+}
+
+static bool dds_stream_write_sample_generated (dds_ostream_t * __restrict os, const void * __restrict data, const struct ddsi_sertype_default * __restrict type)
+{
+  const dds_topic_marshal_xcdr_t *m = dds_stream_marshal_xcdr (type, os->m_xcdr_version);
+  if (m == NULL || m->m_write == NULL || (os->m_index % 8) != 0)
+    return false;
+  dds_cdr_resize (os, m->m_size);
+  m->m_write (os->m_buffer + os->m_index, data);
+  os->m_index += m->m_size;
+  return true;
+}
+
 // Little-endian
 #define NAME_BYTE_ORDER_EXT LE
 #include "ddsi_cdrstream_write.part.c"
@@ -1148,7 +1156,7 @@ void dds_stream_write_sampleLE (dds_ostreamLE_t * __restrict os, const void * __
   const struct ddsi_sertype_default_desc *desc = &type->type;
   if (type->opt_size && desc->align && (((struct dds_ostream *)os)->m_index % desc->align) == 0)
     dds_os_put_bytes ((struct dds_ostream *)os, data, (uint32_t) type->opt_size);
-  else
+  else if (!dds_stream_write_sample_generated ((struct dds_ostream *)os, data, type))
     (void) dds_stream_writeLE (os, data, desc->ops.ops);
 }
 
@@ -1186,7 +1194,7 @@ void dds_stream_write_sampleBE (dds_ostreamBE_t * __restrict os, const void * __
   const struct ddsi_sertype_default_desc *desc = &type->type;
   if (type->opt_size && desc->align && (((struct dds_ostream *)os)->m_index % desc->align) == 0)
     dds_os_put_bytes ((struct dds_ostream *)os, data, (uint32_t) type->opt_size);
-  else
+  else if (!dds_stream_write_sample_generated ((struct dds_ostream *)os, data, type))
     (void) dds_stream_writeBE (os, data, desc->ops.ops);
 }
 
@@ -1831,11 +1839,7 @@ static bool normalize_primarray (char * __restrict data, uint32_t * __restrict o
       if ((*off = check_align_prim_many (*off, size, 1, num)) == UINT32_MAX)
         return false;
       if (bswap)
-      {
-        uint16_t *xs = (uint16_t *) (data + *off);
-        for (uint32_t i = 0; i < num; i++)
-          xs[i] = ddsrt_bswap2u (xs[i]);
-      }
+        ddsrt_bswap_copy (data + *off, data + *off, 2, num);
       *off += 2 * num;
       return true;
     case DDS_OP_VAL_4BY:
@@ -1843,26 +1847,14 @@ static bool normalize_primarray (char * __restrict data, uint32_t * __restrict o
       if ((*off = check_align_prim_many (*off, size, 2, num)) == UINT32_MAX)
         return false;
       if (bswap)
-      {
-        uint32_t *xs = (uint32_t *) (data + *off);
-        for (uint32_t i = 0; i < num; i++)
-          xs[i] = ddsrt_bswap4u (xs[i]);
-      }
+        ddsrt_bswap_copy (data + *off, data + *off, 4, num);
       *off += 4 * num;
       return true;
     case DDS_OP_VAL_8BY:
       if ((*off = check_align_prim_many (*off, size, xcdr_version == CDR_ENC_VERSION_2 ? 2 : 3, num)) == UINT32_MAX)
         return false;
       if (bswap)
-      {
-        uint64_t *xs = (uint64_t *) (data + *off);
-        for (uint32_t i = 0; i < num; i++)
-        {
-          uint32_t x = ddsrt_bswap4u (* (uint32_t *) &xs[i]);
-          *(uint32_t *) &xs[i] = ddsrt_bswap4u (* (((uint32_t *) &xs[i]) + 1));
-          *(((uint32_t *) &xs[i]) + 1) = x;
-        }
-      }
+        ddsrt_bswap_copy (data + *off, data + *off, 8, num);
       *off += 8 * num;
       return true;
     default:
@@ -2600,42 +2592,6 @@ static void dds_stream_extract_key_from_key_prim_op (dds_istream_t * __restrict
   }
 }
 
-#if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN
-static void dds_stream_swap_copy (void * __restrict vdst, const void * __restrict vsrc, uint32_t size, uint32_t num)
-{
-  assert (size == 1 || size == 2 || size == 4 || size == 8);
-  switch (size)
-  {
-    case 1:
-      memcpy (vdst, vsrc, num);
-      break;
-    case 2: {
-      const uint16_t *src = vsrc;
-      uint16_t *dst = vdst;
-      for (uint32_t i = 0; i < num; i++)
-        dst[i] = ddsrt_bswap2u (src[i]);
-      break;
-    }
-    case 4: {
-      const uint32_t *src = vsrc;
-      uint32_t *dst = vdst;
-      for (uint32_t i = 0; i < num; i++)
-        dst[i] = ddsrt_bswap4u (src[i]);
-      break;
-    }
-    case 8: {
-      const uint64_t *src = vsrc;
-      uint64_t *dst = vdst;
-      for (uint32_t i = 0; i < num; i++)
-      {
-        *(uint32_t *) &dst[i] = ddsrt_bswap4u (* (((uint32_t *) &src[i]) + 1));
-        *(((uint32_t *) &dst[i]) + 1) = ddsrt_bswap4u (* (uint32_t *) &src[i]);
-      }
-      break;
-    }
-  }
-}
-#endif
 
 static void dds_stream_extract_keyBE_from_key_prim_op (dds_istream_t * __restrict is, dds_ostreamBE_t * __restrict os, const uint32_t * __restrict op, uint16_t key_offset_count, const uint32_t * key_offset_insn)
 {
@@ -2663,7 +2619,7 @@ static void dds_stream_extract_keyBE_from_key_prim_op (dds_istream_t * __restric
       void const * const src = is->m_buffer + is->m_index;
       void * const dst = os->x.m_buffer + os->x.m_index;
 #if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN
-      dds_stream_swap_copy (dst, src, align, num);
+      ddsrt_bswap_copy (dst, src, align, num);
 #else
       memcpy (dst, src, num * align);
 #endif
@@ -2801,6 +2757,16 @@ static const uint32_t *dds_stream_extract_key_from_data_skip_adr (dds_istream_t
  **
  *******************************************************************************************/
 
+static bool dds_stream_read_sample_generated (dds_istream_t * __restrict is, void * __restrict data, const struct ddsi_sertype_default * __restrict type)
+{
+  const dds_topic_marshal_xcdr_t *m = dds_stream_marshal_xcdr (type, is->m_xcdr_version);
+  if (m == NULL || m->m_read == NULL || (is->m_index % 8) != 0 || is->m_size - is->m_index < m->m_size)
+    return false;
+  m->m_read (data, is->m_buffer + is->m_index);
+  is->m_index += m->m_size;
+  return true;
+}
+
 void dds_stream_read_sample (dds_istream_t * __restrict is, void * __restrict data, const struct ddsi_sertype_default * __restrict type)
 {
   const struct ddsi_sertype_default_desc *desc = &type->type;
@@ -2811,7 +2777,7 @@ void dds_stream_read_sample (dds_istream_t * __restrict is, void * __restrict da
        potential out-of-bounds read */
     dds_is_get_bytes (is, data, (uint32_t) type->opt_size, 1);
   }
-  else
+  else if (!dds_stream_read_sample_generated (is, data, type))
   {
     if (desc->flagset & DDS_TOPIC_CONTAINS_UNION)
     {
@@ -2885,6 +2851,31 @@ static inline void dds_stream_swap_if_needed_insitu (void * __restrict vbuf, uin
   (void) num;
 }
 
+static bool dds_stream_write_key_generated (dds_ostream_t * __restrict os, const char * __restrict sample, const struct ddsi_sertype_default * __restrict type)
+{
+  const dds_topic_marshal_xcdr_t *m = dds_stream_marshal_xcdr (type, os->m_xcdr_version);
+  if (m == NULL || m->m_write_key == NULL || (os->m_index % 8) != 0)
+    return false;
+  dds_cdr_resize (os, m->m_keysize);
+  m->m_write_key (os->m_buffer + os->m_index, sample);
+  os->m_index += m->m_keysize;
+  return true;
+}
+
+static bool dds_stream_extract_key_from_data_generated (dds_istream_t * __restrict is, dds_ostream_t * __restrict os, const struct ddsi_sertype_default * __restrict type)
+{
+  const dds_topic_marshal_xcdr_t *m = dds_stream_marshal_xcdr (type, is->m_xcdr_version);
+  if (m == NULL || m->m_extract_key == NULL || os->m_xcdr_version != CDR_ENC_VERSION_2 ||
+      (is->m_index % 8) != 0 || (os->m_index % 8) != 0 || is->m_size - is->m_index < m->m_size)
+    return false;
+  const uint32_t keysize = type->marshal->m_xcdr2.m_keysize;
+  dds_cdr_resize (os, keysize);
+  m->m_extract_key (os->m_buffer + os->m_index, is->m_buffer + is->m_index);
+  os->m_index += keysize;
+  is->m_index += m->m_size;
+  return true;
+}
+
 // Native endianness
 #define NAME_BYTE_ORDER_EXT
 #include "ddsi_cdrstream_keys.part.c"
@@ -2897,6 +2888,19 @@ static void dds_stream_swap_if_needed_insituBE (void * __restrict vbuf, uint32_t
   dds_stream_swap (vbuf, size, num);
 }
 
+/* Generated marshalling functions only exist for native endianness */
+static bool dds_stream_write_key_generatedBE (dds_ostreamBE_t * __restrict os, const char * __restrict sample, const struct ddsi_sertype_default * __restrict type)
+{
+  (void) os; (void) sample; (void) type;
+  return false;
+}
+
+static bool dds_stream_extract_key_from_data_generatedBE (dds_istream_t * __restrict is, dds_ostreamBE_t * __restrict os, const struct ddsi_sertype_default * __restrict type)
+{
+  (void) is; (void) os; (void) type;
+  return false;
+}
+
 // Big-endian implementation
 #define NAME_BYTE_ORDER_EXT BE
 #include "ddsi_cdrstream_keys.part.c"
@@ -2911,6 +2915,286 @@ void dds_stream_write_keyBE (dds_ostreamBE_t * __restrict os, const char * __res
 
 #endif /* if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN */
 
+/*******************************************************************************************
+ **
+ **  Locating members in CDR, e.g., for evaluating filters without deserializing
+ **
+ *******************************************************************************************/
+
+static dds_return_t dds_stream_member_path_from_offset1 (const uint32_t * __restrict ops, uint32_t base, uint32_t offset, uint32_t depth, uint32_t * __restrict index, struct dds_stream_member_path * __restrict path)
+{
+  uint32_t insn;
+  while ((insn = *ops) != DDS_OP_RTS)
+  {
+    switch (DDS_OP (insn))
+    {
+      case DDS_OP_ADR: {
+        const uint32_t type = DDS_OP_TYPE (insn);
+        /* optional members are preceded by a presence flag that the skip functions don't handle */
+        if (op_type_optional (insn))
+          return DDS_RETCODE_UNSUPPORTED;
+        if (type == DDS_OP_VAL_EXT)
+        {
+          const uint32_t *jsr_ops = ops + DDS_OP_ADR_JSR (ops[2]);
+          if (op_type_base (insn) && jsr_ops[0] == DDS_OP_DLC)
+            jsr_ops++;
+          /* external members live elsewhere in memory and members of mutable types can't be
+             located without interpreting the parameter list: neither can be referenced, but
+             both can be skipped */
+          if (!op_type_external (insn) && jsr_ops[0] != DDS_OP_PLC && depth + 1 < DDS_STREAM_MEMBER_MAX_DEPTH && path->depth == 0)
+          {
+            dds_return_t ret;
+            uint32_t jsr_index = 0;
+            if ((ret = dds_stream_member_path_from_offset1 (jsr_ops, base + ops[1], offset, depth + 1, &jsr_index, path)) != DDS_RETCODE_OK)
+              return ret;
+            if (path->depth > 0)
+            {
+              path->ops[depth] = ops;
+              path->index[depth] = *index;
+            }
+          }
+        }
+        else if (path->depth == 0 && base + ops[1] == offset)
+        {
+          switch (type)
+          {
+            case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
+            case DDS_OP_VAL_STR: case DDS_OP_VAL_BST: case DDS_OP_VAL_ENU:
+              path->ops[depth] = ops;
+              path->index[depth] = *index;
+              path->depth = depth + 1;
+              break;
+            case DDS_OP_VAL_SEQ: case DDS_OP_VAL_ARR: case DDS_OP_VAL_UNI: case DDS_OP_VAL_STU: case DDS_OP_VAL_EXT:
+              break;
+          }
+        }
+        (*index)++;
+        ops = dds_stream_skip_adr (insn, ops);
+        break;
+      }
+      case DDS_OP_JSR: {
+        dds_return_t ret;
+        if ((ret = dds_stream_member_path_from_offset1 (ops + DDS_OP_JUMP (insn), base, offset, depth, index, path)) != DDS_RETCODE_OK)
+          return ret;
+        ops++;
+        break;
+      }
+      case DDS_OP_DLC: {
+        ops++;
+        break;
+      }
+      case DDS_OP_PLC: {
+        return DDS_RETCODE_UNSUPPORTED;
+      }
+      case DDS_OP_RTS: case DDS_OP_JEQ: case DDS_OP_JEQ4: case DDS_OP_KOF: case DDS_OP_PLM: {
+        abort ();
+        break;
+      }
+    }
+  }
+  return DDS_RETCODE_OK;
+}
+
+dds_return_t dds_stream_member_path_from_offset (const uint32_t * __restrict ops, uint32_t offset, struct dds_stream_member_path * __restrict path)
+{
+  dds_return_t ret;
+  uint32_t index = 0;
+  path->depth = 0;
+  if ((ret = dds_stream_member_path_from_offset1 (ops, 0, offset, 0, &index, path)) != DDS_RETCODE_OK)
+    return ret;
+  return (path->depth > 0) ? DDS_RETCODE_OK : DDS_RETCODE_BAD_PARAMETER;
+}
+
+static const uint32_t *dds_stream_member_from_index1 (const uint32_t * __restrict ops, uint32_t index, uint32_t * __restrict count)
+{
+  uint32_t insn;
+  while ((insn = *ops) != DDS_OP_RTS)
+  {
+    switch (DDS_OP (insn))
+    {
+      case DDS_OP_ADR: {
+        if ((*count)++ == index)
+          return ops;
+        ops = dds_stream_skip_adr (insn, ops);
+        break;
+      }
+      case DDS_OP_JSR: {
+        const uint32_t *adr;
+        if ((adr = dds_stream_member_from_index1 (ops + DDS_OP_JUMP (insn), index, count)) != NULL)
+          return adr;
+        ops++;
+        break;
+      }
+      case DDS_OP_DLC: {
+        ops++;
+        break;
+      }
+      case DDS_OP_PLC: {
+        return NULL;
+      }
+      case DDS_OP_RTS: case DDS_OP_JEQ: case DDS_OP_JEQ4: case DDS_OP_KOF: case DDS_OP_PLM: {
+        abort ();
+        break;
+      }
+    }
+  }
+  return NULL;
+}
+
+dds_return_t dds_stream_member_path_from_index (const uint32_t * __restrict ops, uint32_t depth, const uint32_t * __restrict index, struct dds_stream_member_path * __restrict path)
+{
+  if (depth == 0 || depth > DDS_STREAM_MEMBER_MAX_DEPTH)
+    return DDS_RETCODE_BAD_PARAMETER;
+  path->depth = 0;
+  for (uint32_t d = 0; d < depth; d++)
+  {
+    uint32_t count = 0;
+    const uint32_t *adr;
+    if (ops[0] == DDS_OP_PLC)
+      return DDS_RETCODE_UNSUPPORTED;
+    if ((adr = dds_stream_member_from_index1 (ops, index[d], &count)) == NULL)
+      return DDS_RETCODE_BAD_PARAMETER;
+    const uint32_t insn = adr[0];
+    if (op_type_optional (insn))
+      return DDS_RETCODE_UNSUPPORTED;
+    path->ops[d] = adr;
+    path->index[d] = index[d];
+    if (d + 1 < depth)
+    {
+      if (DDS_OP_TYPE (insn) != DDS_OP_VAL_EXT || op_type_external (insn))
+        return DDS_RETCODE_BAD_PARAMETER;
+      ops = adr + DDS_OP_ADR_JSR (adr[2]);
+      if (op_type_base (insn) && ops[0] == DDS_OP_DLC)
+        ops++;
+    }
+    else
+    {
+      switch (DDS_OP_TYPE (insn))
+      {
+        case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
+        case DDS_OP_VAL_STR: case DDS_OP_VAL_BST: case DDS_OP_VAL_ENU:
+          break;
+        case DDS_OP_VAL_SEQ: case DDS_OP_VAL_ARR: case DDS_OP_VAL_UNI: case DDS_OP_VAL_STU: case DDS_OP_VAL_EXT:
+          return DDS_RETCODE_BAD_PARAMETER;
+      }
+    }
+  }
+  path->depth = depth;
+  return DDS_RETCODE_OK;
+}
+
+struct member_locator {
+  uint32_t n;
+  const struct dds_stream_member_path *paths;
+  uint32_t *offs;
+  uint32_t remaining;
+};
+
+static void dds_stream_skip_ext_from_data (dds_istream_t * __restrict is, const uint32_t * __restrict jsr_ops)
+{
+  uint32_t remain = UINT32_MAX;
+  (void) dds_stream_extract_key_from_data1 (is, NULL, jsr_ops, remain, &remain, NULL, NULL);
+}
+
+static uint32_t dds_stream_member_value_offset (dds_istream_t * __restrict is, uint32_t type)
+{
+  switch (type)
+  {
+    case DDS_OP_VAL_1BY: break;
+    case DDS_OP_VAL_2BY: dds_cdr_alignto (is, 2); break;
+    case DDS_OP_VAL_8BY: dds_cdr_alignto (is, is->m_xcdr_version == CDR_ENC_VERSION_2 ? 4 : 8); break;
+    default: dds_cdr_alignto (is, 4); break;
+  }
+  return is->m_index;
+}
+
+static void dds_stream_locate_members1 (dds_istream_t * __restrict is, const uint32_t * __restrict ops, uint32_t depth, uint64_t active, struct member_locator * __restrict ml)
+{
+  uint32_t insn, end = UINT32_MAX;
+  if (*ops == DDS_OP_DLC)
+  {
+    /* appendable type: members beyond the DHEADER's size are not present in the data */
+    const uint32_t sz = dds_is_get4 (is);
+    end = is->m_index + sz;
+    ops++;
+  }
+  while ((insn = *ops) != DDS_OP_RTS)
+  {
+    switch (DDS_OP (insn))
+    {
+      case DDS_OP_ADR: {
+        const uint32_t type = DDS_OP_TYPE (insn);
+        uint64_t here = 0;
+        if (is->m_index >= end)
+        {
+          ops = dds_stream_skip_adr (insn, ops);
+          break;
+        }
+        for (uint32_t i = 0; i < ml->n; i++)
+          if ((active & (UINT64_C (1) << i)) && ml->paths[i].ops[depth] == ops)
+            here |= UINT64_C (1) << i;
+        if (type == DDS_OP_VAL_EXT)
+        {
+          const uint32_t *jsr_ops = ops + DDS_OP_ADR_JSR (ops[2]);
+          const uint32_t jmp = DDS_OP_ADR_JMP (ops[2]);
+          if (op_type_base (insn) && jsr_ops[0] == DDS_OP_DLC)
+            jsr_ops++;
+          if (here == 0)
+            dds_stream_skip_ext_from_data (is, jsr_ops);
+          else
+          {
+            dds_stream_locate_members1 (is, jsr_ops, depth + 1, here, ml);
+            if (ml->remaining == 0)
+              return;
+          }
+          ops += jmp ? jmp : 3;
+        }
+        else
+        {
+          if (here != 0)
+          {
+            const uint32_t off = dds_stream_member_value_offset (is, type);
+            for (uint32_t i = 0; i < ml->n; i++)
+            {
+              if (here & (UINT64_C (1) << i))
+              {
+                ml->offs[i] = off;
+                if (--ml->remaining == 0)
+                  return;
+              }
+            }
+          }
+          ops = dds_stream_extract_key_from_data_skip_adr (is, ops, type);
+        }
+        break;
+      }
+      case DDS_OP_JSR: {
+        dds_stream_locate_members1 (is, ops + DDS_OP_JUMP (insn), depth, active, ml);
+        if (ml->remaining == 0)
+          return;
+        ops++;
+        break;
+      }
+      case DDS_OP_RTS: case DDS_OP_JEQ: case DDS_OP_JEQ4: case DDS_OP_KOF: case DDS_OP_DLC: case DDS_OP_PLC: case DDS_OP_PLM: {
+        abort ();
+        break;
+      }
+    }
+  }
+  if (end != UINT32_MAX && is->m_index < end)
+    is->m_index = end;
+}
+
+void dds_stream_locate_members (dds_istream_t * __restrict is, const uint32_t * __restrict ops, uint32_t n, const struct dds_stream_member_path * __restrict paths, uint32_t * __restrict offs)
+{
+  struct member_locator ml = { .n = n, .paths = paths, .offs = offs, .remaining = n };
+  assert (n <= 64);
+  for (uint32_t i = 0; i < n; i++)
+    offs[i] = UINT32_MAX;
+  if (n > 0)
+    dds_stream_locate_members1 (is, ops, 0, (n == 64) ? UINT64_MAX : (UINT64_C (1) << n) - 1, &ml);
+}
+
 /*******************************************************************************************
  **
  **  Pretty-printing
@@ -49,6 +49,8 @@ static void dds_stream_write_keyBO_impl (DDS_OSTREAM_T * __restrict os, const ui
 void dds_stream_write_keyBO (DDS_OSTREAM_T * __restrict os, const char * __restrict sample, const struct ddsi_sertype_default * __restrict type)
 {
   const struct ddsi_sertype_default_desc *desc = &type->type;
+  if (dds_stream_write_key_generatedBO (os, sample, type))
+    return;
   for (uint32_t i = 0; i < desc->keys.nkeys; i++)
   {
     const uint32_t *insnp = desc->ops.ops + desc->keys.keys[i].ops_offs;
@@ -239,6 +241,8 @@ void dds_stream_extract_keyBO_from_data (dds_istream_t * __restrict is, DDS_OSTR
   uint32_t keys_remaining = desc->keys.nkeys;
   if (keys_remaining == 0)
     return;
+  if (dds_stream_extract_key_from_data_generatedBO (is, os, type))
+    return;
 
 #define MAX_ST_KEYS 16
   struct key_off_info st_key_offs[MAX_ST_KEYS];
@@ -54,13 +54,7 @@ static const uint32_t *dds_stream_write_seqBO (DDS_OSTREAM_T * __restrict os, co
       case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: {
         const uint32_t elem_size = get_type_size (subtype);
         const uint32_t align = is_xcdr2 && subtype == DDS_OP_VAL_8BY ? 4 : elem_size;
-        void * dst;
-        /* Combining put bytes and swap into a single step would improve the performance
-           of writing data in non-native endianess. But in most cases the data will
-           be written in native endianess, and in that case the swap is a no-op (for writing
-           keys a separate function is used). */
-        dds_os_put_bytes_aligned ((struct dds_ostream *)os, seq->_buffer, num, elem_size, align, &dst);
-        dds_stream_to_BO_insitu (dst, elem_size, num);
+        dds_os_put_prim_arrayBO (os, seq->_buffer, num, elem_size, align);
         ops += 2;
         break;
       }
@@ -124,10 +118,7 @@ static const uint32_t *dds_stream_write_arrBO (DDS_OSTREAM_T * __restrict os, co
     case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: {
       const uint32_t elem_size = get_type_size (subtype);
       const uint32_t align = is_xcdr2 && subtype == DDS_OP_VAL_8BY ? 4 : elem_size;
-      void * dst;
-      /* See comment for stream_write_seq, swap is a no-op in most cases */
-      dds_os_put_bytes_aligned ((struct dds_ostream *)os, addr, num, elem_size, align, &dst);
-      dds_stream_to_BO_insitu (dst, elem_size, num);
+      dds_os_put_prim_arrayBO (os, addr, num, elem_size, align);
       ops += 3;
       break;
     }
@@ -15,6 +15,8 @@
 
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/misc.h"
+#include "dds/ddsrt/mh3.h"
+#include "dds/ddsrt/string.h"
 
 #include "dds/ddsrt/hopscotch.h"
 #include "dds/ddsrt/avl.h"
@@ -25,11 +27,67 @@
 #include "dds/ddsi/q_gc.h"
 #include "dds/ddsi/q_rtps.h" /* guid_t */
 #include "dds/ddsi/q_thread.h" /* for assert(thread is awake) */
+#include "dds/ddsi/q_qosmatch.h"
+
+/* Upper bound on the number of cached QoS matching verdicts, the cache is simply
+   emptied when it is reached */
+#define MATCH_VERDICTS_MAX 65536
+
+/* The QoS that determines whether a reader and a writer match never changes during
+   the lifetime of an endpoint, and typically there are only a handful of different
+   combinations in a system.  Endpoints share a "match class" representing these
+   (the type identifier and all QoS that qos_match_mask_p looks at) so that the
+   outcome of the matching can be cached for each pair of classes. */
+#define MATCH_CLASS_QOS_MASK QOS_MATCH_MASK
+
+struct entidx_match_class {
+  uint64_t id; /* unique for the lifetime of the entity index, key in the verdict cache */
+  uint32_t refc;
+  uint32_t hash;
+  bool has_wildcard_partition; /* at least one of the partitions is a wildcard expression */
+  dds_qos_t qos;
+#ifdef DDS_HAS_TYPE_DISCOVERY
+  type_identifier_t type_id;
+#endif
+};
+
+/* All endpoints of a given kind with the same topic and type name.  Only these can
+   possibly match.  Endpoints for which all partitions are simple names are indexed
+   on those names, the ones with a wildcard partition are all candidates for any
+   endpoint in the group. */
+struct match_group {
+  enum entity_kind kind;
+  char *topic_name;
+  char *type_name;
+  uint32_t n; /* number of endpoints in the group */
+  struct ddsrt_hh *partitions; /* struct match_partition */
+  struct ddsrt_hh *wildcard; /* struct entity_common */
+};
+
+struct match_partition {
+  char *name;
+  uint32_t n; /* number of endpoints in eps */
+  struct ddsrt_hh *eps; /* struct entity_common */
+};
+
+struct match_verdict {
+  uint64_t rd_class_id;
+  uint64_t wr_class_id;
+  bool match;
+  dds_qos_policy_id_t reason;
+};
 
 struct entity_index {
+  struct ddsi_domaingv *gv;
   struct ddsrt_chh *guid_hash;
   ddsrt_mutex_t all_entities_lock;
   ddsrt_avl_tree_t all_entities;
+  struct ddsrt_hh *match_groups; /* struct match_group, protected by all_entities_lock */
+  ddsrt_mutex_t match_class_lock;
+  struct ddsrt_hh *match_classes; /* struct entidx_match_class, protected by match_class_lock */
+  uint64_t match_class_id; /* last assigned match class id */
+  struct ddsrt_ehh *match_verdicts; /* struct match_verdict, protected by match_class_lock */
+  uint32_t n_match_verdicts;
 };
 
 static const uint64_t unihashconsts[] = {
@@ -229,10 +287,341 @@ static void gc_buckets (void *bs, void *varg)
   gcreq_enqueue (gcreq);
 }
 
+/* Matching index */
+
+static bool is_endpoint_kind (enum entity_kind kind)
+{
+  return kind == EK_WRITER || kind == EK_READER || kind == EK_PROXY_WRITER || kind == EK_PROXY_READER;
+}
+
+static const dds_qos_t *endpoint_xqos (const struct entity_common *e)
+{
+  switch (e->kind)
+  {
+    case EK_WRITER:
+      return ((const struct writer *) e)->xqos;
+    case EK_READER:
+      return ((const struct reader *) e)->xqos;
+    case EK_PROXY_WRITER:
+    case EK_PROXY_READER:
+      return ((const struct generic_proxy_endpoint *) e)->c.xqos;
+    default:
+      assert (0);
+      return NULL;
+  }
+}
+
+#ifdef DDS_HAS_TYPE_DISCOVERY
+static const type_identifier_t *endpoint_type_id (const struct entity_common *e)
+{
+  switch (e->kind)
+  {
+    case EK_WRITER:
+      return &((const struct writer *) e)->c.type_id;
+    case EK_READER:
+      return &((const struct reader *) e)->c.type_id;
+    case EK_PROXY_WRITER:
+    case EK_PROXY_READER:
+      return &((const struct generic_proxy_endpoint *) e)->c.type_id;
+    default:
+      assert (0);
+      return NULL;
+  }
+}
+#endif
+
+static uint32_t endpoint_partitions (const dds_qos_t *xqos, const char * const **ps)
+{
+  /* no partitions means the default partition, which behaves as "" for matching */
+  static const char * const default_partition[] = { "" };
+  if (!(xqos->present & QP_PARTITION) || xqos->partition.n == 0)
+  {
+    *ps = default_partition;
+    return 1;
+  }
+  *ps = (const char * const *) xqos->partition.strs;
+  return xqos->partition.n;
+}
+
+static uint32_t match_class_hash_rxo (const dds_qos_t *q, uint32_t h)
+{
+  /* hopscotch hashing can't deal with more than a handful of entries with the
+     same hash, and it is quite possible to have many endpoints with the same
+     topic, type and partitions that differ only in, e.g., the deadline, so all
+     QoS that go into the equality test must be included in the hash */
+  const uint64_t present = q->present & MATCH_CLASS_QOS_MASK;
+  h = ddsrt_mh3 (&present, sizeof (present), h);
+  if (present & QP_DURABILITY)
+    h = ddsrt_mh3 (&q->durability.kind, sizeof (q->durability.kind), h);
+  if (present & QP_PRESENTATION)
+  {
+    h = ddsrt_mh3 (&q->presentation.access_scope, sizeof (q->presentation.access_scope), h);
+    h = ddsrt_mh3 (&q->presentation.coherent_access, sizeof (q->presentation.coherent_access), h);
+    h = ddsrt_mh3 (&q->presentation.ordered_access, sizeof (q->presentation.ordered_access), h);
+  }
+  if (present & QP_DEADLINE)
+    h = ddsrt_mh3 (&q->deadline.deadline, sizeof (q->deadline.deadline), h);
+  if (present & QP_LATENCY_BUDGET)
+    h = ddsrt_mh3 (&q->latency_budget.duration, sizeof (q->latency_budget.duration), h);
+  if (present & QP_OWNERSHIP)
+    h = ddsrt_mh3 (&q->ownership.kind, sizeof (q->ownership.kind), h);
+  if (present & QP_LIVELINESS)
+  {
+    h = ddsrt_mh3 (&q->liveliness.kind, sizeof (q->liveliness.kind), h);
+    h = ddsrt_mh3 (&q->liveliness.lease_duration, sizeof (q->liveliness.lease_duration), h);
+  }
+  if (present & QP_RELIABILITY)
+  {
+    h = ddsrt_mh3 (&q->reliability.kind, sizeof (q->reliability.kind), h);
+    h = ddsrt_mh3 (&q->reliability.max_blocking_time, sizeof (q->reliability.max_blocking_time), h);
+  }
+  if (present & QP_DESTINATION_ORDER)
+    h = ddsrt_mh3 (&q->destination_order.kind, sizeof (q->destination_order.kind), h);
+  if ((present & QP_DATA_REPRESENTATION) && q->data_representation.value.n > 0)
+    h = ddsrt_mh3 (q->data_representation.value.ids, q->data_representation.value.n * sizeof (*q->data_representation.value.ids), h);
+  if (present & QP_TYPE_CONSISTENCY_ENFORCEMENT)
+  {
+    const dds_type_consistency_enforcement_qospolicy_t *tce = &q->type_consistency;
+    const unsigned char flags[] = {
+      tce->ignore_sequence_bounds, tce->ignore_string_bounds, tce->ignore_member_names,
+      tce->prevent_type_widening, tce->force_type_validation
+    };
+    h = ddsrt_mh3 (&tce->kind, sizeof (tce->kind), h);
+    h = ddsrt_mh3 (flags, sizeof (flags), h);
+  }
+  return h;
+}
+
+static uint32_t match_class_hash (const struct entidx_match_class *mc)
+{
+  const char * const *ps;
+  const uint32_t nps = endpoint_partitions (&mc->qos, &ps);
+  uint32_t h = ddsrt_mh3 (mc->qos.topic_name, strlen (mc->qos.topic_name) + 1, 0);
+  h = ddsrt_mh3 (mc->qos.type_name, strlen (mc->qos.type_name) + 1, h);
+  for (uint32_t i = 0; i < nps; i++)
+    h = ddsrt_mh3 (ps[i], strlen (ps[i]) + 1, h);
+  h = match_class_hash_rxo (&mc->qos, h);
+#ifdef DDS_HAS_TYPE_DISCOVERY
+  h = ddsrt_mh3 (mc->type_id.hash, sizeof (mc->type_id.hash), h);
+#endif
+  return h;
+}
+
+static uint32_t match_class_hash_wrapper (const void *vmc)
+{
+  const struct entidx_match_class *mc = vmc;
+  return mc->hash;
+}
+
+static int match_class_equal (const void *va, const void *vb)
+{
+  const struct entidx_match_class *a = va;
+  const struct entidx_match_class *b = vb;
+  if (a->hash != b->hash)
+    return 0;
+#ifdef DDS_HAS_TYPE_DISCOVERY
+  if (!ddsi_typeid_equal (&a->type_id, &b->type_id))
+    return 0;
+#endif
+  return ddsi_xqos_delta (&a->qos, &b->qos, MATCH_CLASS_QOS_MASK) == 0;
+}
+
+static uint32_t match_group_hash (const void *vg)
+{
+  const struct match_group *g = vg;
+  uint32_t h = ddsrt_mh3 (&g->kind, sizeof (g->kind), 0);
+  h = ddsrt_mh3 (g->topic_name, strlen (g->topic_name) + 1, h);
+  return ddsrt_mh3 (g->type_name, strlen (g->type_name) + 1, h);
+}
+
+static int match_group_equal (const void *va, const void *vb)
+{
+  const struct match_group *a = va;
+  const struct match_group *b = vb;
+  return a->kind == b->kind && strcmp (a->topic_name, b->topic_name) == 0 && strcmp (a->type_name, b->type_name) == 0;
+}
+
+static uint32_t match_partition_hash (const void *vp)
+{
+  const struct match_partition *p = vp;
+  return ddsrt_mh3 (p->name, strlen (p->name), 0);
+}
+
+static int match_partition_equal (const void *va, const void *vb)
+{
+  const struct match_partition *a = va;
+  const struct match_partition *b = vb;
+  return strcmp (a->name, b->name) == 0;
+}
+
+static uint32_t match_verdict_hash (const void *vv)
+{
+  const struct match_verdict *v = vv;
+  const uint64_t ids[] = { v->rd_class_id, v->wr_class_id };
+  return ddsrt_mh3 (ids, sizeof (ids), 0);
+}
+
+static int match_verdict_equal (const void *va, const void *vb)
+{
+  const struct match_verdict *a = va;
+  const struct match_verdict *b = vb;
+  return a->rd_class_id == b->rd_class_id && a->wr_class_id == b->wr_class_id;
+}
+
+static struct entidx_match_class *match_class_ref (struct entity_index *ei, const struct entity_common *e)
+{
+  const dds_qos_t *xqos = endpoint_xqos (e);
+  struct entidx_match_class template, *mc;
+  assert ((xqos->present & QP_TOPIC_NAME) && (xqos->present & QP_TYPE_NAME));
+  ddsi_xqos_init_empty (&template.qos);
+  ddsi_xqos_mergein_missing (&template.qos, xqos, MATCH_CLASS_QOS_MASK);
+#ifdef DDS_HAS_TYPE_DISCOVERY
+  template.type_id = *endpoint_type_id (e);
+#endif
+  template.hash = match_class_hash (&template);
+  ddsrt_mutex_lock (&ei->match_class_lock);
+  if ((mc = ddsrt_hh_lookup (ei->match_classes, &template)) != NULL)
+  {
+    mc->refc++;
+    ddsrt_mutex_unlock (&ei->match_class_lock);
+    ddsi_xqos_fini (&template.qos);
+    return mc;
+  }
+  mc = ddsrt_malloc (sizeof (*mc));
+  *mc = template;
+  mc->id = ++ei->match_class_id;
+  mc->refc = 1;
+  const char * const *ps;
+  const uint32_t nps = endpoint_partitions (&mc->qos, &ps);
+  mc->has_wildcard_partition = false;
+  for (uint32_t i = 0; i < nps && !mc->has_wildcard_partition; i++)
+    mc->has_wildcard_partition = is_wildcard_partition (ps[i]);
+  ddsrt_hh_add_absent (ei->match_classes, mc);
+  ddsrt_mutex_unlock (&ei->match_class_lock);
+  return mc;
+}
+
+static void match_class_free (struct entidx_match_class *mc)
+{
+  ddsi_xqos_fini (&mc->qos);
+  ddsrt_free (mc);
+}
+
+static void gc_match_class_cb (struct gcreq *gcreq)
+{
+  struct entidx_match_class *mc = gcreq->arg;
+  gcreq_free (gcreq);
+  match_class_free (mc);
+}
+
+static void match_class_unref (struct entity_index *ei, struct entidx_match_class *mc)
+{
+  ddsrt_mutex_lock (&ei->match_class_lock);
+  if (--mc->refc > 0)
+    mc = NULL;
+  else
+    ddsrt_hh_remove_present (ei->match_classes, mc);
+  ddsrt_mutex_unlock (&ei->match_class_lock);
+  if (mc != NULL)
+  {
+    /* other threads may still be matching the endpoint it belonged to, those are
+       guaranteed to be done once the garbage collector gets to it; any cached
+       verdicts for the class simply become unreachable */
+    struct gcreq *gcreq = gcreq_new (ei->gv->gcreq_queue, gc_match_class_cb);
+    gcreq->arg = mc;
+    gcreq_enqueue (gcreq);
+  }
+}
+
+static void match_group_free (struct match_group *g)
+{
+  assert (g->n == 0);
+  ddsrt_hh_free (g->partitions);
+  ddsrt_hh_free (g->wildcard);
+  ddsrt_free (g->topic_name);
+  ddsrt_free (g->type_name);
+  ddsrt_free (g);
+}
+
+static void match_index_add (struct entity_index *ei, struct entity_common *e)
+{
+  const struct entidx_match_class *mc = e->match_class;
+  struct match_group template = { .kind = e->kind, .topic_name = mc->qos.topic_name, .type_name = mc->qos.type_name }, *g;
+  if ((g = ddsrt_hh_lookup (ei->match_groups, &template)) == NULL)
+  {
+    g = ddsrt_malloc (sizeof (*g));
+    g->kind = e->kind;
+    g->topic_name = ddsrt_strdup (mc->qos.topic_name);
+    g->type_name = ddsrt_strdup (mc->qos.type_name);
+    g->n = 0;
+    g->partitions = ddsrt_hh_new (1, match_partition_hash, match_partition_equal);
+    g->wildcard = ddsrt_hh_new (1, hash_entity_guid_wrapper, entity_guid_eq_wrapper);
+    ddsrt_hh_add_absent (ei->match_groups, g);
+  }
+  g->n++;
+  if (mc->has_wildcard_partition)
+    ddsrt_hh_add_absent (g->wildcard, e);
+  else
+  {
+    const char * const *ps;
+    const uint32_t nps = endpoint_partitions (&mc->qos, &ps);
+    for (uint32_t i = 0; i < nps; i++)
+    {
+      struct match_partition ptemplate = { .name = (char *) ps[i] }, *p;
+      if ((p = ddsrt_hh_lookup (g->partitions, &ptemplate)) == NULL)
+      {
+        p = ddsrt_malloc (sizeof (*p));
+        p->name = ddsrt_strdup (ps[i]);
+        p->n = 0;
+        p->eps = ddsrt_hh_new (1, hash_entity_guid_wrapper, entity_guid_eq_wrapper);
+        ddsrt_hh_add_absent (g->partitions, p);
+      }
+      /* partitions may be listed more than once */
+      if (ddsrt_hh_add (p->eps, e))
+        p->n++;
+    }
+  }
+}
+
+static void match_index_remove (struct entity_index *ei, struct entity_common *e)
+{
+  const struct entidx_match_class *mc = e->match_class;
+  struct match_group template = { .kind = e->kind, .topic_name = mc->qos.topic_name, .type_name = mc->qos.type_name }, *g;
+  g = ddsrt_hh_lookup (ei->match_groups, &template);
+  assert (g != NULL);
+  if (mc->has_wildcard_partition)
+    ddsrt_hh_remove_present (g->wildcard, e);
+  else
+  {
+    const char * const *ps;
+    const uint32_t nps = endpoint_partitions (&mc->qos, &ps);
+    for (uint32_t i = 0; i < nps; i++)
+    {
+      struct match_partition ptemplate = { .name = (char *) ps[i] }, *p;
+      if ((p = ddsrt_hh_lookup (g->partitions, &ptemplate)) != NULL && ddsrt_hh_remove (p->eps, e))
+      {
+        if (--p->n == 0)
+        {
+          ddsrt_hh_remove_present (g->partitions, p);
+          ddsrt_hh_free (p->eps);
+          ddsrt_free (p->name);
+          ddsrt_free (p);
+        }
+      }
+    }
+  }
+  if (--g->n == 0)
+  {
+    ddsrt_hh_remove_present (ei->match_groups, g);
+    match_group_free (g);
+  }
+}
+
 struct entity_index *entity_index_new (struct ddsi_domaingv *gv)
 {
   struct entity_index *entidx;
   entidx = ddsrt_malloc (sizeof (*entidx));
+  entidx->gv = gv;
   entidx->guid_hash = ddsrt_chh_new (32, hash_entity_guid_wrapper, entity_guid_eq_wrapper, gc_buckets, gv);
   if (entidx->guid_hash == NULL) {
     ddsrt_free (entidx);
@@ -240,12 +629,27 @@ struct entity_index *entity_index_new (struct ddsi_domaingv *gv)
   } else {
     ddsrt_mutex_init (&entidx->all_entities_lock);
     ddsrt_avl_init (&all_entities_treedef, &entidx->all_entities);
+    entidx->match_groups = ddsrt_hh_new (32, match_group_hash, match_group_equal);
+    ddsrt_mutex_init (&entidx->match_class_lock);
+    entidx->match_classes = ddsrt_hh_new (32, match_class_hash_wrapper, match_class_equal);
+    entidx->match_class_id = 0;
+    entidx->match_verdicts = ddsrt_ehh_new (sizeof (struct match_verdict), 32, match_verdict_hash, match_verdict_equal);
+    entidx->n_match_verdicts = 0;
     return entidx;
   }
 }
 
 void entity_index_free (struct entity_index *entidx)
 {
+  struct ddsrt_hh_iter it;
+  /* all endpoints have been removed by now, and with that all match groups and classes */
+  assert (ddsrt_hh_iter_first (entidx->match_groups, &it) == NULL);
+  assert (ddsrt_hh_iter_first (entidx->match_classes, &it) == NULL);
+  (void) it;
+  ddsrt_hh_free (entidx->match_groups);
+  ddsrt_ehh_free (entidx->match_verdicts);
+  ddsrt_hh_free (entidx->match_classes);
+  ddsrt_mutex_destroy (&entidx->match_class_lock);
   ddsrt_avl_free (&all_entities_treedef, &entidx->all_entities, 0);
   ddsrt_mutex_destroy (&entidx->all_entities_lock);
   ddsrt_chh_free (entidx->guid_hash);
@@ -258,6 +662,8 @@ static void add_to_all_entities (struct entity_index *ei, struct entity_common *
   ddsrt_mutex_lock (&ei->all_entities_lock);
   assert (ddsrt_avl_lookup (&all_entities_treedef, &ei->all_entities, e) == NULL);
   ddsrt_avl_insert (&all_entities_treedef, &ei->all_entities, e);
+  if (e->match_class)
+    match_index_add (ei, e);
   ddsrt_mutex_unlock (&ei->all_entities_lock);
 }
 
@@ -266,12 +672,17 @@ static void remove_from_all_entities (struct entity_index *ei, struct entity_com
   ddsrt_mutex_lock (&ei->all_entities_lock);
   assert (ddsrt_avl_lookup (&all_entities_treedef, &ei->all_entities, e) != NULL);
   ddsrt_avl_delete (&all_entities_treedef, &ei->all_entities, e);
+  if (e->match_class)
+    match_index_remove (ei, e);
   ddsrt_mutex_unlock (&ei->all_entities_lock);
 }
 
 static void entity_index_insert (struct entity_index *ei, struct entity_common *e)
 {
   int x;
+  /* built-in proxy endpoints don't have a type name, but those are matched on GUID anyway */
+  if (is_endpoint_kind (e->kind) && (endpoint_xqos (e)->present & (QP_TOPIC_NAME | QP_TYPE_NAME)) == (QP_TOPIC_NAME | QP_TYPE_NAME))
+    e->match_class = match_class_ref (ei, e);
   x = ddsrt_chh_add (ei->guid_hash, e);
   (void)x;
   assert (x);
@@ -285,6 +696,8 @@ static void entity_index_remove (struct entity_index *ei, struct entity_common *
   x = ddsrt_chh_remove (ei->guid_hash, e);
   (void)x;
   assert (x);
+  if (e->match_class)
+    match_class_unref (ei, e->match_class);
 }
 
 void *entidx_lookup_guid_untyped (const struct entity_index *ei, const struct ddsi_guid *guid)
@@ -592,6 +1005,140 @@ void entidx_enum_proxy_participant_fini (struct entidx_enum_proxy_participant *s
   entidx_enum_fini (&st->st);
 }
 
+/* Matching */
+
+static bool match_enum_add (struct entidx_enum_match *st, struct ddsrt_hh *eps)
+{
+  struct ddsrt_hh_iter it;
+  const uint32_t n0 = st->n;
+  for (struct entity_common *e = ddsrt_hh_iter_first (eps, &it); e; e = ddsrt_hh_iter_next (&it))
+  {
+    if (st->n == st->size)
+    {
+      st->size = (st->size == 0) ? 8 : 2 * st->size;
+      st->eps = ddsrt_realloc (st->eps, st->size * sizeof (*st->eps));
+    }
+    st->eps[st->n++] = e;
+  }
+  return st->n > n0;
+}
+
+static int compare_entity_ptr (const void *va, const void *vb)
+{
+  const uintptr_t a = (uintptr_t) *((struct entity_common * const *) va);
+  const uintptr_t b = (uintptr_t) *((struct entity_common * const *) vb);
+  return (a == b) ? 0 : (a < b) ? -1 : 1;
+}
+
+void entidx_enum_match_init (struct entidx_enum_match *st, const struct entity_index *ei, enum entity_kind kind, const struct entity_common *e)
+{
+  /* Candidates are the endpoints of the requested kind with the same topic and type
+     name and that have a partition in common (or that have a wildcard partition).
+     QoS matching is still required, this just avoids looking at those that can't
+     possibly match.
+
+     Same rules as for the other enumerators: the entities remain valid for as long
+     as the thread stays awake, but they may have been removed from the index. */
+  const struct entidx_match_class *mc = e->match_class;
+  struct match_group template, *g;
+  uint32_t nbuckets = 0;
+  assert (is_endpoint_kind (kind));
+#ifndef NDEBUG
+  assert (thread_is_awake ());
+  st->vtime = ddsrt_atomic_ld32 (&lookup_thread_state ()->vtime);
+#endif
+  st->n = st->size = st->i = 0;
+  st->eps = NULL;
+  if (mc == NULL)
+    return;
+  template.kind = kind;
+  template.topic_name = mc->qos.topic_name;
+  template.type_name = mc->qos.type_name;
+  ddsrt_mutex_lock ((ddsrt_mutex_t *) &ei->all_entities_lock);
+  if ((g = ddsrt_hh_lookup (ei->match_groups, &template)) != NULL)
+  {
+    const char * const *ps;
+    const uint32_t nps = endpoint_partitions (&mc->qos, &ps);
+    for (uint32_t i = 0; i < nps; i++)
+    {
+      if (!is_wildcard_partition (ps[i]))
+      {
+        struct match_partition ptemplate = { .name = (char *) ps[i] }, *p;
+        if ((p = ddsrt_hh_lookup (g->partitions, &ptemplate)) != NULL)
+          nbuckets += match_enum_add (st, p->eps);
+      }
+      else
+      {
+        /* one pattern match per distinct partition name, rather than per endpoint */
+        struct ddsrt_hh_iter it;
+        for (struct match_partition *p = ddsrt_hh_iter_first (g->partitions, &it); p; p = ddsrt_hh_iter_next (&it))
+          if (partition_patmatch_p (ps[i], p->name))
+            nbuckets += match_enum_add (st, p->eps);
+      }
+    }
+    (void) match_enum_add (st, g->wildcard);
+  }
+  ddsrt_mutex_unlock ((ddsrt_mutex_t *) &ei->all_entities_lock);
+
+  if (nbuckets > 1)
+  {
+    /* endpoints with several partitions in common got added more than once */
+    uint32_t i, j;
+    qsort (st->eps, st->n, sizeof (*st->eps), compare_entity_ptr);
+    for (i = 1, j = 0; i < st->n; i++)
+      if (st->eps[i] != st->eps[j])
+        st->eps[++j] = st->eps[i];
+    st->n = j + 1;
+  }
+}
+
+void *entidx_enum_match_next (struct entidx_enum_match *st)
+{
+  assert (ddsrt_atomic_ld32 (&lookup_thread_state ()->vtime) == st->vtime);
+  return (st->i < st->n) ? st->eps[st->i++] : NULL;
+}
+
+void entidx_enum_match_fini (struct entidx_enum_match *st)
+{
+  assert (ddsrt_atomic_ld32 (&lookup_thread_state ()->vtime) == st->vtime);
+  ddsrt_free (st->eps);
+}
+
+bool entidx_match_verdict_lookup (struct entity_index *ei, const struct entity_common *rd, const struct entity_common *wr, bool *match, dds_qos_policy_id_t *reason)
+{
+  if (rd->match_class == NULL || wr->match_class == NULL)
+    return false;
+  const struct match_verdict template = { .rd_class_id = rd->match_class->id, .wr_class_id = wr->match_class->id };
+  const struct match_verdict *v;
+  ddsrt_mutex_lock (&ei->match_class_lock);
+  if ((v = ddsrt_ehh_lookup (ei->match_verdicts, &template)) != NULL)
+  {
+    *match = v->match;
+    *reason = v->reason;
+  }
+  ddsrt_mutex_unlock (&ei->match_class_lock);
+  return v != NULL;
+}
+
+void entidx_match_verdict_store (struct entity_index *ei, const struct entity_common *rd, const struct entity_common *wr, bool match, dds_qos_policy_id_t reason)
+{
+  if (rd->match_class == NULL || wr->match_class == NULL)
+    return;
+  const struct match_verdict v = { .rd_class_id = rd->match_class->id, .wr_class_id = wr->match_class->id, .match = match, .reason = reason };
+  ddsrt_mutex_lock (&ei->match_class_lock);
+  if (ei->n_match_verdicts == MATCH_VERDICTS_MAX)
+  {
+    /* verdicts for classes that no longer exist are never looked up again, starting
+       afresh once in a while is the simplest way of getting rid of those */
+    ddsrt_ehh_free (ei->match_verdicts);
+    ei->match_verdicts = ddsrt_ehh_new (sizeof (struct match_verdict), 32, match_verdict_hash, match_verdict_equal);
+    ei->n_match_verdicts = 0;
+  }
+  if (ddsrt_ehh_add (ei->match_verdicts, &v))
+    ei->n_match_verdicts++;
+  ddsrt_mutex_unlock (&ei->match_class_lock);
+}
+
 #ifdef DDS_HAS_TOPIC_DISCOVERY
 
 void entidx_insert_topic_guid (struct entity_index *ei, struct topic *tp)
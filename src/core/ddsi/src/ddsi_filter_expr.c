@@ -0,0 +1,885 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <ctype.h>
+#include <string.h>
+
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/strtod.h"
+#include "dds/ddsrt/strtol.h"
+#include "dds/ddsi/ddsi_serdata_default.h"
+#include "dds/ddsi/ddsi_cdrstream.h"
+#include "dds/ddsi/ddsi_plist.h"
+#ifdef DDS_HAS_SHM
+#include "dds/ddsi/ddsi_shm_transport.h"
+#endif
+#include "dds/ddsi/ddsi_filter_expr.h"
+
+/* Limit imposed by dds_stream_locate_members */
+#define FX_MAX_FIELDS 64
+
+/* Maximum nesting of parentheses and NOT, bounding the recursion in the parser
+   and in the evaluator; expressions may come from remote peers */
+#define FX_MAX_DEPTH 64
+
+enum fx_vtype { FXV_INT, FXV_UINT, FXV_DBL, FXV_STR };
+
+struct fx_value {
+  enum fx_vtype t;
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+    struct { const char *s; uint32_t n; } s;
+  } u;
+};
+
+struct fx_operand {
+  bool is_field;
+  uint32_t field;        /* index in fields if is_field */
+  struct fx_value lit;   /* value if !is_field */
+};
+
+enum fx_node_kind { FXN_AND, FXN_OR, FXN_NOT, FXN_CMP, FXN_BETWEEN, FXN_LIKE };
+enum fx_cmp { FXC_EQ, FXC_NE, FXC_LT, FXC_LE, FXC_GT, FXC_GE };
+
+struct fx_node {
+  enum fx_node_kind kind;
+  enum fx_cmp cmp;       /* FXN_CMP */
+  uint32_t lhs, rhs;     /* FXN_AND, FXN_OR (both), FXN_NOT (lhs) */
+  struct fx_operand x[3];  /* x[0] cmp x[1], x[0] BETWEEN x[1] AND x[2], x[0] LIKE x[1] */
+};
+
+struct fx_field {
+  uint32_t offset;       /* in the in-memory representation */
+  uint32_t insn;         /* ADR instruction of the member */
+};
+
+struct ddsi_filter_expr {
+  const uint32_t *ops;
+  uint32_t nfields;
+  struct fx_field *fields;
+  struct dds_stream_member_path *paths;
+  uint32_t nnodes, maxnodes;
+  struct fx_node *nodes;
+  uint32_t root;
+  uint32_t nstrings;
+  char **strings;
+  char *canonical;       /* expression with member-index field names */
+  uint32_t nparams;
+  char **params;
+};
+
+/*******************************************************************************************
+ **
+ **  Parsing & compiling
+ **
+ *******************************************************************************************/
+
+enum fx_tok {
+  FXT_END, FXT_ERROR, FXT_IDENT, FXT_NUMBER, FXT_STRING, FXT_PARAM,
+  FXT_LPAREN, FXT_RPAREN, FXT_EQ, FXT_NE, FXT_LT, FXT_LE, FXT_GT, FXT_GE,
+  FXT_AND, FXT_OR, FXT_NOT, FXT_BETWEEN, FXT_LIKE, FXT_TRUE, FXT_FALSE
+};
+
+struct fx_token {
+  enum fx_tok kind;
+  const char *s;         /* start of token in input */
+  size_t n;              /* length of token */
+  struct fx_value num;   /* FXT_NUMBER */
+  uint32_t param;        /* FXT_PARAM */
+};
+
+struct fx_parser {
+  const char *p;
+  struct fx_token tok;
+  struct ddsi_filter_expr *fx;
+  bool canonical_names;  /* field names are member indices, fields is ignored */
+  uint32_t nfields;
+  const dds_filter_field_t *fields;
+  uint32_t nparams;
+  const char * const *params;
+  uint32_t depth;        /* current nesting of parentheses and NOT */
+  dds_return_t err;
+  const char *copied;    /* input up to here has been appended to canonical */
+  size_t canonical_len;
+};
+
+static bool fx_isident (int c, bool first)
+{
+  return c == '_' || isalpha (c) || (!first && isdigit (c));
+}
+
+static bool fx_lex_number (const char *s, const char **end, struct fx_value *v)
+{
+  const char *p = s;
+  bool neg = false, hex = false, dbl = false;
+  char buf[64];
+  if (*p == '+' || *p == '-')
+    neg = (*p++ == '-');
+  if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && isxdigit ((unsigned char) p[2]))
+  {
+    hex = true;
+    for (p += 2; isxdigit ((unsigned char) *p); p++)
+      ;
+  }
+  else
+  {
+    while (isdigit ((unsigned char) *p))
+      p++;
+    if (*p == '.')
+    {
+      dbl = true;
+      for (p++; isdigit ((unsigned char) *p); p++)
+        ;
+    }
+    if ((*p == 'e' || *p == 'E') && (isdigit ((unsigned char) p[1]) || ((p[1] == '+' || p[1] == '-') && isdigit ((unsigned char) p[2]))))
+    {
+      dbl = true;
+      for (p += 2; isdigit ((unsigned char) *p); p++)
+        ;
+    }
+  }
+  *end = p;
+  if ((size_t) (p - s) >= sizeof (buf) || fx_isident ((unsigned char) *p, false))
+    return false;
+  memcpy (buf, s, (size_t) (p - s));
+  buf[p - s] = 0;
+  if (dbl)
+  {
+    v->t = FXV_DBL;
+    return ddsrt_strtod (buf, NULL, &v->u.d) == DDS_RETCODE_OK;
+  }
+  else if (neg)
+  {
+    long long x;
+    if (ddsrt_strtoll (buf, NULL, hex ? 0 : 10, &x) != DDS_RETCODE_OK)
+      return false;
+    v->t = FXV_INT;
+    v->u.i = (int64_t) x;
+    return true;
+  }
+  else
+  {
+    unsigned long long x;
+    if (ddsrt_strtoull (buf, NULL, hex ? 0 : 10, &x) != DDS_RETCODE_OK)
+      return false;
+    v->t = FXV_UINT;
+    v->u.u = (uint64_t) x;
+    return true;
+  }
+}
+
+static const char *fx_lex (const char *p, struct fx_token *t)
+{
+  static const struct { const char *kw; enum fx_tok kind; } keywords[] = {
+    { "and", FXT_AND }, { "or", FXT_OR }, { "not", FXT_NOT }, { "between", FXT_BETWEEN },
+    { "like", FXT_LIKE }, { "true", FXT_TRUE }, { "false", FXT_FALSE }
+  };
+  while (isspace ((unsigned char) *p))
+    p++;
+  t->s = p;
+  t->kind = FXT_ERROR;
+  const char *q = p + 1;
+  switch (*p)
+  {
+    case 0: t->kind = FXT_END; q = p; break;
+    case '(': t->kind = FXT_LPAREN; break;
+    case ')': t->kind = FXT_RPAREN; break;
+    case '=': t->kind = FXT_EQ; break;
+    case '<':
+      if (p[1] == '=') { t->kind = FXT_LE; q++; }
+      else if (p[1] == '>') { t->kind = FXT_NE; q++; }
+      else { t->kind = FXT_LT; }
+      break;
+    case '>':
+      if (p[1] == '=') { t->kind = FXT_GE; q++; }
+      else { t->kind = FXT_GT; }
+      break;
+    case '!':
+      if (p[1] == '=') { t->kind = FXT_NE; q++; }
+      break;
+    case '\'':
+      /* a quote in a string is written as two quotes, the token includes the quotes */
+      while (*q && !(q[0] == '\'' && q[1] != '\''))
+        q += (q[0] == '\'') ? 2 : 1;
+      if (*q == '\'')
+      {
+        t->kind = FXT_STRING;
+        q++;
+      }
+      break;
+    case '%':
+      if (isdigit ((unsigned char) *q))
+      {
+        uint32_t n = 0;
+        for (; isdigit ((unsigned char) *q) && n < 100; q++)
+          n = 10 * n + (uint32_t) (*q - '0');
+        if (n < 100)
+        {
+          t->kind = FXT_PARAM;
+          t->param = n;
+        }
+      }
+      break;
+    default:
+      if (isdigit ((unsigned char) p[0]) || (p[0] == '.' && isdigit ((unsigned char) p[1])) ||
+          ((p[0] == '-' || p[0] == '+') && (isdigit ((unsigned char) p[1]) || (p[1] == '.' && isdigit ((unsigned char) p[2])))))
+      {
+        if (fx_lex_number (p, &q, &t->num))
+          t->kind = FXT_NUMBER;
+      }
+      else if (fx_isident ((unsigned char) p[0], true))
+      {
+        /* field names may refer to members of nested structs: a.b.c */
+        bool dotted = false;
+        for (q = p; fx_isident ((unsigned char) *q, q == p || q[-1] == '.') || (*q == '.' && fx_isident ((unsigned char) q[1], true)); q++)
+          dotted = dotted || (*q == '.');
+        t->kind = FXT_IDENT;
+        for (size_t i = 0; !dotted && i < sizeof (keywords) / sizeof (keywords[0]); i++)
+        {
+          if (strlen (keywords[i].kw) == (size_t) (q - p) && ddsrt_strncasecmp (p, keywords[i].kw, (size_t) (q - p)) == 0)
+            t->kind = keywords[i].kind;
+        }
+      }
+      break;
+  }
+  t->n = (size_t) (q - p);
+  return q;
+}
+
+static void fx_next (struct fx_parser *p)
+{
+  p->p = fx_lex (p->p, &p->tok);
+}
+
+static uint32_t fx_error (struct fx_parser *p, dds_return_t err)
+{
+  if (p->err == DDS_RETCODE_OK)
+    p->err = err;
+  return UINT32_MAX;
+}
+
+static const char *fx_intern_string (struct ddsi_filter_expr *fx, char *s)
+{
+  fx->strings = ddsrt_realloc (fx->strings, (fx->nstrings + 1) * sizeof (*fx->strings));
+  fx->strings[fx->nstrings++] = s;
+  return s;
+}
+
+static void fx_string_value (struct ddsi_filter_expr *fx, const char *s, size_t n, struct fx_value *v)
+{
+  char *str = ddsrt_malloc (n + 1);
+  memcpy (str, s, n);
+  str[n] = 0;
+  v->t = FXV_STR;
+  v->u.s.s = fx_intern_string (fx, str);
+  v->u.s.n = (uint32_t) n;
+}
+
+static void fx_quoted_string_value (struct ddsi_filter_expr *fx, const struct fx_token *t, struct fx_value *v)
+{
+  assert (t->kind == FXT_STRING && t->n >= 2);
+  char *str = ddsrt_malloc (t->n - 1);
+  size_t n = 0;
+  for (size_t i = 1; i < t->n - 1; i++)
+  {
+    str[n++] = t->s[i];
+    if (t->s[i] == '\'')
+      i++;
+  }
+  str[n] = 0;
+  v->t = FXV_STR;
+  v->u.s.s = fx_intern_string (fx, str);
+  v->u.s.n = (uint32_t) n;
+}
+
+static bool fx_literal_value (struct ddsi_filter_expr *fx, const struct fx_token *t, struct fx_value *v)
+{
+  switch (t->kind)
+  {
+    case FXT_NUMBER: *v = t->num; return true;
+    case FXT_STRING: fx_quoted_string_value (fx, t, v); return true;
+    case FXT_TRUE: case FXT_FALSE: v->t = FXV_UINT; v->u.u = (t->kind == FXT_TRUE); return true;
+    default: return false;
+  }
+}
+
+static dds_return_t fx_param_value (struct fx_parser *p, uint32_t param, struct fx_value *v)
+{
+  if (param >= p->nparams || p->params[param] == NULL)
+    return DDS_RETCODE_BAD_PARAMETER;
+  /* a parameter is a single literal; anything else is taken to be an unquoted string */
+  const char *s = p->params[param];
+  struct fx_token t, t_end;
+  (void) fx_lex (fx_lex (s, &t), &t_end);
+  if (t_end.kind != FXT_END || !fx_literal_value (p->fx, &t, v))
+    fx_string_value (p->fx, s, strlen (s), v);
+  return DDS_RETCODE_OK;
+}
+
+static void fx_canonical_append (struct fx_parser *p, const char *s, size_t n)
+{
+  struct ddsi_filter_expr * const fx = p->fx;
+  fx->canonical = ddsrt_realloc (fx->canonical, p->canonical_len + n + 1);
+  memcpy (fx->canonical + p->canonical_len, s, n);
+  p->canonical_len += n;
+  fx->canonical[p->canonical_len] = 0;
+}
+
+static dds_return_t fx_member_path_from_canonical_name (const uint32_t *ops, const char *name, size_t n, struct dds_stream_member_path *path)
+{
+  /* _i0._i1 ... _ik, with ij the index of the member in the j'th level struct */
+  uint32_t index[DDS_STREAM_MEMBER_MAX_DEPTH], depth = 0;
+  size_t i = 0;
+  while (i < n)
+  {
+    if (depth == DDS_STREAM_MEMBER_MAX_DEPTH || name[i] != '_' || i + 1 == n || !isdigit ((unsigned char) name[i + 1]))
+      return DDS_RETCODE_BAD_PARAMETER;
+    uint32_t x = 0;
+    for (i++; i < n && isdigit ((unsigned char) name[i]); i++)
+    {
+      if (x >= UINT32_MAX / 10)
+        return DDS_RETCODE_BAD_PARAMETER;
+      x = 10 * x + (uint32_t) (name[i] - '0');
+    }
+    index[depth++] = x;
+    if (i < n && name[i++] != '.')
+      return DDS_RETCODE_BAD_PARAMETER;
+  }
+  return dds_stream_member_path_from_index (ops, depth, index, path);
+}
+
+static dds_return_t fx_member_path_from_name (const struct fx_parser *p, const char *name, size_t n, struct dds_stream_member_path *path)
+{
+  if (p->canonical_names)
+    return fx_member_path_from_canonical_name (p->fx->ops, name, n, path);
+  for (uint32_t i = 0; i < p->nfields; i++)
+    if (p->fields[i].name && strlen (p->fields[i].name) == n && memcmp (p->fields[i].name, name, n) == 0)
+      return dds_stream_member_path_from_offset (p->fx->ops, p->fields[i].offset, path);
+  return DDS_RETCODE_BAD_PARAMETER;
+}
+
+static dds_return_t fx_field_ref (struct fx_parser *p, const char *name, size_t n, uint32_t *field)
+{
+  struct ddsi_filter_expr * const fx = p->fx;
+  struct dds_stream_member_path path;
+  dds_return_t ret;
+  if ((ret = fx_member_path_from_name (p, name, n, &path)) != DDS_RETCODE_OK)
+    return ret;
+
+  char buf[DDS_STREAM_MEMBER_MAX_DEPTH * 12];
+  size_t pos = 0;
+  for (uint32_t d = 0; d < path.depth; d++)
+    pos += (size_t) snprintf (buf + pos, sizeof (buf) - pos, "%s_%"PRIu32, (d == 0) ? "" : ".", path.index[d]);
+  fx_canonical_append (p, p->copied, (size_t) (name - p->copied));
+  fx_canonical_append (p, buf, pos);
+  p->copied = name + n;
+
+  uint32_t i;
+  for (i = 0; i < fx->nfields; i++)
+    if (fx->paths[i].depth == path.depth && memcmp (fx->paths[i].ops, path.ops, path.depth * sizeof (path.ops[0])) == 0)
+      break;
+  if (i == fx->nfields)
+  {
+    if (fx->nfields == FX_MAX_FIELDS)
+      return DDS_RETCODE_OUT_OF_RESOURCES;
+    fx->fields = ddsrt_realloc (fx->fields, (fx->nfields + 1) * sizeof (*fx->fields));
+    fx->paths = ddsrt_realloc (fx->paths, (fx->nfields + 1) * sizeof (*fx->paths));
+    fx->paths[i] = path;
+    /* offsets of members of nested structs are relative to the start of the nested struct */
+    fx->fields[i].offset = 0;
+    for (uint32_t d = 0; d < path.depth; d++)
+      fx->fields[i].offset += path.ops[d][1];
+    fx->fields[i].insn = path.ops[path.depth - 1][0];
+    fx->nfields++;
+  }
+  *field = i;
+  return DDS_RETCODE_OK;
+}
+
+static bool fx_parse_operand (struct fx_parser *p, struct fx_operand *x)
+{
+  dds_return_t ret = DDS_RETCODE_OK;
+  x->is_field = false;
+  switch (p->tok.kind)
+  {
+    case FXT_IDENT:
+      x->is_field = true;
+      ret = fx_field_ref (p, p->tok.s, p->tok.n, &x->field);
+      break;
+    case FXT_PARAM:
+      ret = fx_param_value (p, p->tok.param, &x->lit);
+      break;
+    default:
+      if (!fx_literal_value (p->fx, &p->tok, &x->lit))
+        ret = DDS_RETCODE_BAD_PARAMETER;
+      break;
+  }
+  if (ret != DDS_RETCODE_OK)
+  {
+    (void) fx_error (p, ret);
+    return false;
+  }
+  fx_next (p);
+  return true;
+}
+
+static bool fx_operand_is_string (const struct ddsi_filter_expr *fx, const struct fx_operand *x)
+{
+  if (!x->is_field)
+    return x->lit.t == FXV_STR;
+  const enum dds_stream_typecode type = DDS_OP_TYPE (fx->fields[x->field].insn);
+  return type == DDS_OP_VAL_STR || type == DDS_OP_VAL_BST;
+}
+
+static uint32_t fx_add_node (struct fx_parser *p, const struct fx_node *n)
+{
+  struct ddsi_filter_expr * const fx = p->fx;
+  if (fx->nnodes == fx->maxnodes)
+  {
+    fx->maxnodes = fx->maxnodes ? 2 * fx->maxnodes : 8;
+    fx->nodes = ddsrt_realloc (fx->nodes, fx->maxnodes * sizeof (*fx->nodes));
+  }
+  fx->nodes[fx->nnodes] = *n;
+  return fx->nnodes++;
+}
+
+static uint32_t fx_add_logical (struct fx_parser *p, enum fx_node_kind kind, uint32_t lhs, uint32_t rhs)
+{
+  struct fx_node n;
+  memset (&n, 0, sizeof (n));
+  n.kind = kind;
+  n.lhs = lhs;
+  n.rhs = rhs;
+  return fx_add_node (p, &n);
+}
+
+static uint32_t fx_parse_or (struct fx_parser *p);
+
+static uint32_t fx_parse_predicate (struct fx_parser *p)
+{
+  struct fx_node n;
+  bool negate = false;
+  uint32_t nx;
+
+  if (p->tok.kind == FXT_LPAREN)
+  {
+    if (++p->depth > FX_MAX_DEPTH)
+      return fx_error (p, DDS_RETCODE_BAD_PARAMETER);
+    fx_next (p);
+    const uint32_t idx = fx_parse_or (p);
+    if (idx == UINT32_MAX)
+      return idx;
+    if (p->tok.kind != FXT_RPAREN)
+      return fx_error (p, DDS_RETCODE_BAD_PARAMETER);
+    fx_next (p);
+    p->depth--;
+    return idx;
+  }
+
+  memset (&n, 0, sizeof (n));
+  if (!fx_parse_operand (p, &n.x[0]))
+    return UINT32_MAX;
+  if (p->tok.kind == FXT_NOT)
+  {
+    negate = true;
+    fx_next (p);
+    if (p->tok.kind != FXT_BETWEEN && p->tok.kind != FXT_LIKE)
+      return fx_error (p, DDS_RETCODE_BAD_PARAMETER);
+  }
+  switch (p->tok.kind)
+  {
+    case FXT_EQ: n.cmp = FXC_EQ; break;
+    case FXT_NE: n.cmp = FXC_NE; break;
+    case FXT_LT: n.cmp = FXC_LT; break;
+    case FXT_LE: n.cmp = FXC_LE; break;
+    case FXT_GT: n.cmp = FXC_GT; break;
+    case FXT_GE: n.cmp = FXC_GE; break;
+    case FXT_BETWEEN: case FXT_LIKE: break;
+    default: return fx_error (p, DDS_RETCODE_BAD_PARAMETER);
+  }
+  n.kind = (p->tok.kind == FXT_BETWEEN) ? FXN_BETWEEN : (p->tok.kind == FXT_LIKE) ? FXN_LIKE : FXN_CMP;
+  nx = (n.kind == FXN_BETWEEN) ? 3 : 2;
+  fx_next (p);
+  if (!fx_parse_operand (p, &n.x[1]))
+    return UINT32_MAX;
+  if (n.kind == FXN_BETWEEN)
+  {
+    if (p->tok.kind != FXT_AND)
+      return fx_error (p, DDS_RETCODE_BAD_PARAMETER);
+    fx_next (p);
+    if (!fx_parse_operand (p, &n.x[2]))
+      return UINT32_MAX;
+  }
+
+  /* operands must be all strings or all numbers, LIKE requires strings */
+  const bool str = fx_operand_is_string (p->fx, &n.x[0]);
+  for (uint32_t i = 1; i < nx; i++)
+    if (fx_operand_is_string (p->fx, &n.x[i]) != str)
+      return fx_error (p, DDS_RETCODE_BAD_PARAMETER);
+  if (n.kind == FXN_LIKE && !str)
+    return fx_error (p, DDS_RETCODE_BAD_PARAMETER);
+
+  const uint32_t idx = fx_add_node (p, &n);
+  return negate ? fx_add_logical (p, FXN_NOT, idx, 0) : idx;
+}
+
+static uint32_t fx_parse_not (struct fx_parser *p)
+{
+  if (p->tok.kind != FXT_NOT)
+    return fx_parse_predicate (p);
+  if (++p->depth > FX_MAX_DEPTH)
+    return fx_error (p, DDS_RETCODE_BAD_PARAMETER);
+  fx_next (p);
+  const uint32_t idx = fx_parse_not (p);
+  p->depth--;
+  return (idx == UINT32_MAX) ? idx : fx_add_logical (p, FXN_NOT, idx, 0);
+}
+
+/* Chains of AND/OR are built leaning to the right, "a AND b AND c" becoming
+   "a AND (b AND c)", so that the evaluator can walk them iteratively and the
+   length of a chain doesn't affect the stack depth */
+static uint32_t fx_parse_chain (struct fx_parser *p, enum fx_tok op, enum fx_node_kind kind, uint32_t (*parse_operand) (struct fx_parser *p))
+{
+  const uint32_t first = parse_operand (p);
+  uint32_t root = first, tail = UINT32_MAX;
+  while (root != UINT32_MAX && p->tok.kind == op)
+  {
+    fx_next (p);
+    const uint32_t rhs = parse_operand (p);
+    if (rhs == UINT32_MAX)
+      return rhs;
+    if (tail == UINT32_MAX)
+      root = tail = fx_add_logical (p, kind, first, rhs);
+    else
+    {
+      const uint32_t idx = fx_add_logical (p, kind, p->fx->nodes[tail].rhs, rhs);
+      p->fx->nodes[tail].rhs = idx;
+      tail = idx;
+    }
+  }
+  return root;
+}
+
+static uint32_t fx_parse_and (struct fx_parser *p)
+{
+  return fx_parse_chain (p, FXT_AND, FXN_AND, fx_parse_not);
+}
+
+static uint32_t fx_parse_or (struct fx_parser *p)
+{
+  return fx_parse_chain (p, FXT_OR, FXN_OR, fx_parse_and);
+}
+
+static dds_return_t fx_new (struct ddsi_filter_expr **fx, const struct ddsi_sertype *type, const char *expression, bool canonical_names, uint32_t nfields, const dds_filter_field_t *fields, uint32_t nparams, const char * const *params)
+{
+  /* evaluating the expression on serialized data requires the type's instructions */
+  if (type->ops != &ddsi_sertype_ops_default)
+    return DDS_RETCODE_UNSUPPORTED;
+
+  struct fx_parser p = {
+    .p = expression, .fx = ddsrt_calloc (1, sizeof (**fx)), .canonical_names = canonical_names,
+    .nfields = nfields, .fields = fields, .nparams = nparams, .params = params,
+    .depth = 0, .err = DDS_RETCODE_OK, .copied = expression, .canonical_len = 0
+  };
+  p.fx->ops = ((const struct ddsi_sertype_default *) type)->type.ops.ops;
+  fx_next (&p);
+  p.fx->root = fx_parse_or (&p);
+  if (p.fx->root != UINT32_MAX && p.tok.kind != FXT_END)
+    (void) fx_error (&p, DDS_RETCODE_BAD_PARAMETER);
+  if (p.err != DDS_RETCODE_OK)
+  {
+    ddsi_filter_expr_free (p.fx);
+    return p.err;
+  }
+  fx_canonical_append (&p, p.copied, strlen (p.copied));
+  /* parameters are retained for the benefit of remote writers */
+  p.fx->nparams = nparams;
+  p.fx->params = ddsrt_malloc ((nparams > 0 ? nparams : 1) * sizeof (*p.fx->params));
+  for (uint32_t i = 0; i < nparams; i++)
+    p.fx->params[i] = ddsrt_strdup (params[i] ? params[i] : "");
+  *fx = p.fx;
+  return DDS_RETCODE_OK;
+}
+
+dds_return_t ddsi_filter_expr_new (struct ddsi_filter_expr **fx, const struct ddsi_sertype *type, const char *expression, uint32_t nfields, const dds_filter_field_t *fields, uint32_t nparams, const char * const *params)
+{
+  return fx_new (fx, type, expression, false, nfields, fields, nparams, params);
+}
+
+dds_return_t ddsi_filter_expr_new_from_property (struct ddsi_filter_expr **fx, const struct ddsi_sertype *type, const struct nn_content_filter_property *prop)
+{
+  if (strcmp (prop->filter_class_name, DDSI_FILTER_EXPR_CLASS_NAME) != 0)
+    return DDS_RETCODE_UNSUPPORTED;
+  return fx_new (fx, type, prop->filter_expression, true, 0, NULL, prop->expression_parameters.n, (const char * const *) prop->expression_parameters.strs);
+}
+
+void ddsi_filter_expr_get_property (const struct ddsi_filter_expr *fx, const char *topic_name, struct nn_content_filter_property *prop)
+{
+  /* there are no content-filtered topic entities: the filter is set on the topic itself */
+  prop->cf_topic_name = (char *) topic_name;
+  prop->related_topic_name = (char *) topic_name;
+  prop->filter_class_name = (char *) DDSI_FILTER_EXPR_CLASS_NAME;
+  prop->filter_expression = fx->canonical;
+  prop->expression_parameters.n = fx->nparams;
+  prop->expression_parameters.strs = fx->params;
+}
+
+void ddsi_filter_expr_free (struct ddsi_filter_expr *fx)
+{
+  for (uint32_t i = 0; i < fx->nstrings; i++)
+    ddsrt_free (fx->strings[i]);
+  ddsrt_free (fx->strings);
+  ddsrt_free (fx->nodes);
+  ddsrt_free (fx->paths);
+  ddsrt_free (fx->fields);
+  for (uint32_t i = 0; i < fx->nparams; i++)
+    ddsrt_free (fx->params[i]);
+  ddsrt_free (fx->params);
+  ddsrt_free (fx->canonical);
+  ddsrt_free (fx);
+}
+
+/*******************************************************************************************
+ **
+ **  Evaluation
+ **
+ *******************************************************************************************/
+
+struct fx_eval {
+  const struct ddsi_filter_expr *fx;
+  const unsigned char *cdr;   /* if non-null, field i is at cdr + offs[i] */
+  const uint32_t *offs;
+  const char *sample;         /* otherwise, field i is at sample + fields[i].offset */
+};
+
+static void fx_field_value (const struct fx_eval *ev, uint32_t i, struct fx_value *v)
+{
+  const struct fx_field *f = &ev->fx->fields[i];
+  const uint32_t flags = DDS_OP_FLAGS (f->insn);
+  const bool sgn = (flags & DDS_OP_FLAG_SGN), fp = (flags & DDS_OP_FLAG_FP);
+  const char *addr;
+  /* members absent from the data (an appendable type's later members) have default values */
+  static const char zeros[8] = { 0 };
+  if (ev->cdr == NULL)
+    addr = ev->sample + f->offset;
+  else if (ev->offs[i] == UINT32_MAX)
+    addr = zeros;
+  else
+    addr = (const char *) ev->cdr + ev->offs[i];
+
+  switch (DDS_OP_TYPE (f->insn))
+  {
+    case DDS_OP_VAL_1BY: {
+      uint8_t x;
+      memcpy (&x, addr, sizeof (x));
+      if (sgn) { v->t = FXV_INT; v->u.i = (int8_t) x; } else { v->t = FXV_UINT; v->u.u = x; }
+      break;
+    }
+    case DDS_OP_VAL_2BY: {
+      uint16_t x;
+      memcpy (&x, addr, sizeof (x));
+      if (sgn) { v->t = FXV_INT; v->u.i = (int16_t) x; } else { v->t = FXV_UINT; v->u.u = x; }
+      break;
+    }
+    case DDS_OP_VAL_4BY: case DDS_OP_VAL_ENU: {
+      uint32_t x;
+      memcpy (&x, addr, sizeof (x));
+      if (fp) { float y; memcpy (&y, &x, sizeof (y)); v->t = FXV_DBL; v->u.d = y; }
+      else if (sgn) { v->t = FXV_INT; v->u.i = (int32_t) x; }
+      else { v->t = FXV_UINT; v->u.u = x; }
+      break;
+    }
+    case DDS_OP_VAL_8BY: {
+      uint64_t x;
+      memcpy (&x, addr, sizeof (x));
+      if (fp) { v->t = FXV_DBL; memcpy (&v->u.d, &x, sizeof (v->u.d)); }
+      else if (sgn) { v->t = FXV_INT; v->u.i = (int64_t) x; }
+      else { v->t = FXV_UINT; v->u.u = x; }
+      break;
+    }
+    case DDS_OP_VAL_STR: case DDS_OP_VAL_BST: {
+      v->t = FXV_STR;
+      if (ev->cdr != NULL)
+      {
+        /* length includes the terminating 0 */
+        uint32_t len;
+        memcpy (&len, addr, sizeof (len));
+        v->u.s.s = (len > 0) ? addr + 4 : "";
+        v->u.s.n = (len > 0) ? len - 1 : 0;
+      }
+      else
+      {
+        const char *s = (DDS_OP_TYPE (f->insn) == DDS_OP_VAL_STR) ? *(const char * const *) addr : addr;
+        v->u.s.s = s ? s : "";
+        v->u.s.n = (uint32_t) strlen (v->u.s.s);
+      }
+      break;
+    }
+    case DDS_OP_VAL_SEQ: case DDS_OP_VAL_ARR: case DDS_OP_VAL_UNI: case DDS_OP_VAL_STU: case DDS_OP_VAL_EXT:
+      abort ();
+      break;
+  }
+}
+
+static void fx_operand_value (const struct fx_eval *ev, const struct fx_operand *x, struct fx_value *v)
+{
+  if (x->is_field)
+    fx_field_value (ev, x->field, v);
+  else
+    *v = x->lit;
+}
+
+/* -1, 0, 1 for less, equal, greater; 2 if unordered (NaN) */
+static int fx_compare (const struct fx_value *a, const struct fx_value *b)
+{
+  if (a->t == FXV_STR)
+  {
+    assert (b->t == FXV_STR);
+    const int c = memcmp (a->u.s.s, b->u.s.s, (a->u.s.n < b->u.s.n) ? a->u.s.n : b->u.s.n);
+    if (c != 0)
+      return (c < 0) ? -1 : 1;
+    return (a->u.s.n < b->u.s.n) ? -1 : (a->u.s.n > b->u.s.n) ? 1 : 0;
+  }
+  else if (a->t == FXV_DBL || b->t == FXV_DBL)
+  {
+    const double x = (a->t == FXV_DBL) ? a->u.d : (a->t == FXV_INT) ? (double) a->u.i : (double) a->u.u;
+    const double y = (b->t == FXV_DBL) ? b->u.d : (b->t == FXV_INT) ? (double) b->u.i : (double) b->u.u;
+    return (x < y) ? -1 : (x > y) ? 1 : (x == y) ? 0 : 2;
+  }
+  else if (a->t == FXV_INT && b->t == FXV_INT)
+    return (a->u.i < b->u.i) ? -1 : (a->u.i > b->u.i);
+  else if (a->t == FXV_INT && a->u.i < 0)
+    return -1;
+  else if (b->t == FXV_INT && b->u.i < 0)
+    return 1;
+  else
+  {
+    /* both non-negative, representation of non-negative int64_t equals that of uint64_t */
+    return (a->u.u < b->u.u) ? -1 : (a->u.u > b->u.u);
+  }
+}
+
+static bool fx_compare_op (enum fx_cmp op, int c)
+{
+  switch (op)
+  {
+    case FXC_EQ: return c == 0;
+    case FXC_NE: return c != 0;
+    case FXC_LT: return c == -1;
+    case FXC_LE: return c == -1 || c == 0;
+    case FXC_GT: return c == 1;
+    case FXC_GE: return c == 1 || c == 0;
+  }
+  return false;
+}
+
+/* SQL LIKE: % matches any sequence of characters, _ matches a single character */
+static bool fx_like (const char *s, uint32_t n, const char *pat, uint32_t m)
+{
+  uint32_t i = 0, j = 0, star_i = 0, star_j = UINT32_MAX;
+  while (i < n)
+  {
+    if (j < m && pat[j] == '%')
+    {
+      star_j = j++;
+      star_i = i;
+    }
+    else if (j < m && (pat[j] == '_' || pat[j] == s[i]))
+    {
+      i++;
+      j++;
+    }
+    else if (star_j != UINT32_MAX)
+    {
+      j = star_j + 1;
+      i = ++star_i;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  while (j < m && pat[j] == '%')
+    j++;
+  return j == m;
+}
+
+static bool fx_eval_node (const struct fx_eval *ev, uint32_t idx)
+{
+  const struct fx_node *n = &ev->fx->nodes[idx];
+  struct fx_value a, b, c;
+  /* AND/OR chains lean to the right (see fx_parse_chain), recursing only
+     for the left operand keeps the depth within the nesting limit */
+  while (n->kind == FXN_AND || n->kind == FXN_OR)
+  {
+    if (fx_eval_node (ev, n->lhs) != (n->kind == FXN_AND))
+      return n->kind == FXN_OR;
+    n = &ev->fx->nodes[n->rhs];
+  }
+  switch (n->kind)
+  {
+    case FXN_AND:
+    case FXN_OR:
+      assert (0);
+      return false;
+    case FXN_NOT:
+      return !fx_eval_node (ev, n->lhs);
+    case FXN_CMP:
+      fx_operand_value (ev, &n->x[0], &a);
+      fx_operand_value (ev, &n->x[1], &b);
+      return fx_compare_op (n->cmp, fx_compare (&a, &b));
+    case FXN_BETWEEN:
+      fx_operand_value (ev, &n->x[0], &a);
+      fx_operand_value (ev, &n->x[1], &b);
+      fx_operand_value (ev, &n->x[2], &c);
+      return fx_compare_op (FXC_GE, fx_compare (&a, &b)) && fx_compare_op (FXC_LE, fx_compare (&a, &c));
+    case FXN_LIKE:
+      fx_operand_value (ev, &n->x[0], &a);
+      fx_operand_value (ev, &n->x[1], &b);
+      return fx_like (a.u.s.s, a.u.s.n, b.u.s.s, b.u.s.n);
+  }
+  return false;
+}
+
+bool ddsi_filter_expr_eval_sample (const struct ddsi_filter_expr *fx, const void *sample)
+{
+  const struct fx_eval ev = { .fx = fx, .cdr = NULL, .offs = NULL, .sample = sample };
+  return fx_eval_node (&ev, fx->root);
+}
+
+bool ddsi_filter_expr_eval_serdata (const struct ddsi_filter_expr *fx, const struct ddsi_serdata *sd)
+{
+  const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *) sd;
+  uint32_t offs[FX_MAX_FIELDS];
+  dds_istream_t is;
+  if (sd->kind != SDK_DATA)
+    return true;
+#ifdef DDS_HAS_SHM
+  if (sd->iox_chunk != NULL)
+  {
+    const iceoryx_header_t *hdr = iceoryx_header_from_chunk (sd->iox_chunk);
+    if (hdr->shm_data_state != IOX_CHUNK_CONTAINS_SERIALIZED_DATA)
+      return ddsi_filter_expr_eval_sample (fx, sd->iox_chunk);
+    dds_istream_init (&is, hdr->data_size, sd->iox_chunk, get_xcdr_version (d->hdr.identifier));
+  }
+  else
+#endif
+  {
+    dds_istream_from_serdata_default (&is, d);
+  }
+  dds_stream_locate_members (&is, fx->ops, fx->nfields, fx->paths, offs);
+  const struct fx_eval ev = { .fx = fx, .cdr = is.m_buffer, .offs = offs, .sample = NULL };
+  return fx_eval_node (&ev, fx->root);
+}
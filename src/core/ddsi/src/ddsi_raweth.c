@@ -25,16 +25,40 @@
 #if defined(__linux) && !LWIP_SOCKET
 #include <linux/if_packet.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <ifaddrs.h>
+#include <poll.h>
+#include <unistd.h>
 #include <string.h>
+#include <inttypes.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <errno.h>
 
+#define DDSI_RAWETH_MAX_WRITE_MULTI 64
+
+/* TPACKET_ALIGN without the signed/unsigned mix */
+#define DDSI_RAWETH_TPACKET_ALIGN(x) (((x) + TPACKET_ALIGNMENT - 1) & ~((size_t) TPACKET_ALIGNMENT - 1))
+
+/* Receive ring shared with the kernel (PACKET_RX_RING, TPACKET_V2): the
+   kernel stores each frame in the next free slot and passes ownership to us
+   by setting TP_STATUS_USER, we hand it back by resetting it to
+   TP_STATUS_KERNEL once the frame has been copied out.  V2 rather than V3
+   because V3 only makes frames available once a block is full or its retire
+   timer expires, which costs milliseconds of latency for sparse traffic. */
+struct ddsi_raweth_rxring {
+  unsigned char *base;
+  size_t size;
+  uint32_t frame_size;
+  uint32_t frame_nr;
+  uint32_t next;
+};
+
 typedef struct ddsi_raweth_conn {
   struct ddsi_tran_conn m_base;
   ddsrt_socket_t m_sock;
   int m_ifindex;
+  struct ddsi_raweth_rxring m_rxring; /* base = NULL if not in use */
 } *ddsi_raweth_conn_t;
 
 static char *ddsi_raweth_to_string (char *dst, size_t sizeof_dst, const ddsi_locator_t *loc, ddsi_tran_conn_t conn, int with_port)
@@ -51,6 +75,83 @@ static char *ddsi_raweth_to_string (char *dst, size_t sizeof_dst, const ddsi_loc
   return dst;
 }
 
+static void ddsi_raweth_srcloc_from_sockaddr (ddsi_locator_t *srcloc, const struct sockaddr_ll *src)
+{
+  srcloc->kind = NN_LOCATOR_KIND_RAWETH;
+  srcloc->port = ntohs (src->sll_protocol);
+  memset(srcloc->address, 0, 10);
+  memcpy(srcloc->address + 10, src->sll_addr, 6);
+}
+
+static void ddsi_raweth_warn_truncated (ddsi_tran_conn_t conn, const struct sockaddr_ll *src, size_t size, size_t len)
+{
+  char addrbuf[DDSI_LOCSTRLEN];
+  (void) snprintf(addrbuf, sizeof(addrbuf), "[%02x:%02x:%02x:%02x:%02x:%02x]:%u",
+                  src->sll_addr[0], src->sll_addr[1], src->sll_addr[2],
+                  src->sll_addr[3], src->sll_addr[4], src->sll_addr[5], ntohs(src->sll_protocol));
+  DDS_CWARNING(&conn->m_base.gv->logconfig, "%s => %d truncated to %d\n", addrbuf, (int)size, (int)len);
+}
+
+static struct tpacket2_hdr *ddsi_raweth_rxring_frame (const struct ddsi_raweth_rxring *ring, uint32_t idx)
+{
+  return (struct tpacket2_hdr *) (ring->base + (size_t) idx * ring->frame_size);
+}
+
+/* Copies the next frame in the receive ring to buf, returning its size, or 0
+   if the kernel hasn't stored one there yet */
+static ssize_t ddsi_raweth_rxring_take (ddsi_raweth_conn_t uc, unsigned char *buf, size_t len, ddsi_locator_t *srcloc)
+{
+  struct ddsi_raweth_rxring * const ring = &uc->m_rxring;
+  struct tpacket2_hdr * const hdr = ddsi_raweth_rxring_frame (ring, ring->next);
+  if (!(*(volatile uint32_t *) &hdr->tp_status & TP_STATUS_USER))
+    return 0;
+  ddsrt_atomic_fence_acq ();
+
+  const struct sockaddr_ll *src = (const struct sockaddr_ll *) ((unsigned char *) hdr + DDSI_RAWETH_TPACKET_ALIGN (sizeof (*hdr)));
+  size_t size = hdr->tp_snaplen;
+  if (size > len)
+    size = len;
+  memcpy (buf, (unsigned char *) hdr + hdr->tp_mac, size);
+  if (srcloc)
+    ddsi_raweth_srcloc_from_sockaddr (srcloc, src);
+  if (size < hdr->tp_len)
+    ddsi_raweth_warn_truncated (&uc->m_base, src, hdr->tp_len, size);
+
+  ddsrt_atomic_fence_rel ();
+  *(volatile uint32_t *) &hdr->tp_status = TP_STATUS_KERNEL;
+  if (++ring->next == ring->frame_nr)
+    ring->next = 0;
+  return (ssize_t) size;
+}
+
+static ssize_t ddsi_raweth_conn_read_rxring (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc)
+{
+  ddsi_raweth_conn_t uc = (ddsi_raweth_conn_t) conn;
+  ssize_t ret;
+  while ((ret = ddsi_raweth_rxring_take (uc, buf, len, srcloc)) == 0 && !allow_spurious)
+  {
+    struct pollfd pfd = { .fd = uc->m_sock, .events = POLLIN, .revents = 0 };
+    if (poll (&pfd, 1, -1) < 0 && errno != EINTR)
+    {
+      DDS_CERROR(&conn->m_base.gv->logconfig, "raweth poll sock %d: errno %d\n", (int) uc->m_sock, errno);
+      return -1;
+    }
+  }
+  return ret;
+}
+
+/* The receive thread only calls this once the socket is readable, so there is
+   no need to block when the ring turns out to be empty */
+static ssize_t ddsi_raweth_conn_read_multi (ddsi_tran_conn_t conn, size_t nbufs, struct ddsi_tran_recvbuf *bufs)
+{
+  ddsi_raweth_conn_t uc = (ddsi_raweth_conn_t) conn;
+  size_t n = 0;
+  ssize_t sz;
+  while (n < nbufs && (sz = ddsi_raweth_rxring_take (uc, bufs[n].buf, bufs[n].len, &bufs[n].srcloc)) > 0)
+    bufs[n++].size = sz;
+  return (ssize_t) n;
+}
+
 static ssize_t ddsi_raweth_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc)
 {
   dds_return_t rc;
@@ -78,12 +179,7 @@ static ssize_t ddsi_raweth_conn_read (ddsi_tran_conn_t conn, unsigned char * buf
   if (ret > 0)
   {
     if (srcloc)
-    {
-      srcloc->kind = NN_LOCATOR_KIND_RAWETH;
-      srcloc->port = ntohs (src.sll_protocol);
-      memset(srcloc->address, 0, 10);
-      memcpy(srcloc->address + 10, src.sll_addr, 6);
-    }
+      ddsi_raweth_srcloc_from_sockaddr (srcloc, &src);
 
     /* Check for udp packet truncation */
     if ((((size_t) ret) > len)
@@ -92,11 +188,7 @@ static ssize_t ddsi_raweth_conn_read (ddsi_tran_conn_t conn, unsigned char * buf
 #endif
         )
     {
-      char addrbuf[DDSI_LOCSTRLEN];
-      (void) snprintf(addrbuf, sizeof(addrbuf), "[%02x:%02x:%02x:%02x:%02x:%02x]:%u",
-                      src.sll_addr[0], src.sll_addr[1], src.sll_addr[2],
-                      src.sll_addr[3], src.sll_addr[4], src.sll_addr[5], ntohs(src.sll_protocol));
-      DDS_CWARNING(&conn->m_base.gv->logconfig, "%s => %d truncated to %d\n", addrbuf, (int)ret, (int)len);
+      ddsi_raweth_warn_truncated (conn, &src, (size_t) ret, len);
     }
   }
   else if (rc != DDS_RETCODE_OK &&
@@ -108,6 +200,16 @@ static ssize_t ddsi_raweth_conn_read (ddsi_tran_conn_t conn, unsigned char * buf
   return ret;
 }
 
+static void ddsi_raweth_sockaddr_from_loc (struct sockaddr_ll *dstaddr, const ddsi_locator_t *dst, int ifindex)
+{
+  memset (dstaddr, 0, sizeof (*dstaddr));
+  dstaddr->sll_family = AF_PACKET;
+  dstaddr->sll_protocol = htons ((uint16_t) dst->port);
+  dstaddr->sll_ifindex = ifindex;
+  dstaddr->sll_halen = 6;
+  memcpy(dstaddr->sll_addr, dst->address + 10, 6);
+}
+
 static ssize_t ddsi_raweth_conn_write (ddsi_tran_conn_t conn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
 {
   ddsi_raweth_conn_t uc = (ddsi_raweth_conn_t) conn;
@@ -118,12 +220,7 @@ static ssize_t ddsi_raweth_conn_write (ddsi_tran_conn_t conn, const ddsi_locator
   struct msghdr msg;
   struct sockaddr_ll dstaddr;
   assert(niov <= INT_MAX);
-  memset (&dstaddr, 0, sizeof (dstaddr));
-  dstaddr.sll_family = AF_PACKET;
-  dstaddr.sll_protocol = htons ((uint16_t) dst->port);
-  dstaddr.sll_ifindex = uc->m_ifindex;
-  dstaddr.sll_halen = 6;
-  memcpy(dstaddr.sll_addr, dst->address + 10, 6);
+  ddsi_raweth_sockaddr_from_loc (&dstaddr, dst, uc->m_ifindex);
   memset(&msg, 0, sizeof(msg));
   msg.msg_name = &dstaddr;
   msg.msg_namelen = sizeof(dstaddr);
@@ -148,6 +245,63 @@ static ssize_t ddsi_raweth_conn_write (ddsi_tran_conn_t conn, const ddsi_locator
   return (rc == DDS_RETCODE_OK ? ret : -1);
 }
 
+/* Sends the same message to multiple destinations with a single sendmmsg call
+   per DDSI_RAWETH_MAX_WRITE_MULTI destinations */
+static ssize_t ddsi_raweth_conn_write_multi (ddsi_tran_conn_t conn, size_t ndst, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  ddsi_raweth_conn_t uc = (ddsi_raweth_conn_t) conn;
+  struct msghdr msgs[DDSI_RAWETH_MAX_WRITE_MULTI];
+  struct sockaddr_ll dstaddrs[DDSI_RAWETH_MAX_WRITE_MULTI];
+  ssize_t sent[DDSI_RAWETH_MAX_WRITE_MULTI];
+  ssize_t total = 0;
+  bool any_sent = false;
+  int sendflags = 0;
+  assert(niov <= INT_MAX);
+#ifdef MSG_NOSIGNAL
+  sendflags |= MSG_NOSIGNAL;
+#endif
+  while (ndst > 0)
+  {
+    const size_t n = (ndst < DDSI_RAWETH_MAX_WRITE_MULTI) ? ndst : DDSI_RAWETH_MAX_WRITE_MULTI;
+    size_t off = 0;
+    unsigned retry = 2;
+    for (size_t i = 0; i < n; i++)
+    {
+      ddsi_raweth_sockaddr_from_loc (&dstaddrs[i], &dst[i], uc->m_ifindex);
+      memset (&msgs[i], 0, sizeof (msgs[i]));
+      msgs[i].msg_name = &dstaddrs[i];
+      msgs[i].msg_namelen = sizeof (dstaddrs[i]);
+      msgs[i].msg_flags = (int) flags;
+      msgs[i].msg_iov = (ddsrt_iovec_t *) iov;
+      msgs[i].msg_iovlen = niov;
+    }
+    while (off < n)
+    {
+      size_t nsent;
+      dds_return_t rc = ddsrt_sendmmsg (uc->m_sock, msgs + off, sent + off, n - off, sendflags, &nsent);
+      for (size_t i = off; i < off + nsent; i++)
+        total += sent[i];
+      any_sent = any_sent || (nsent > 0);
+      off += nsent;
+      if (rc == DDS_RETCODE_OK || rc == DDS_RETCODE_INTERRUPTED || rc == DDS_RETCODE_TRY_AGAIN)
+        continue;
+      else if (rc == DDS_RETCODE_NOT_ALLOWED && retry-- > 0)
+        continue;
+      else
+      {
+        /* skip the destination that failed, same error handling as for a single write */
+        if (rc != DDS_RETCODE_NOT_ALLOWED && rc != DDS_RETCODE_NO_CONNECTION)
+          DDS_CERROR(&conn->m_base.gv->logconfig, "ddsi_raweth_conn_write_multi failed with retcode %d\n", rc);
+        off++;
+        retry = 2;
+      }
+    }
+    dst += n;
+    ndst -= n;
+  }
+  return any_sent ? total : -1;
+}
+
 static ddsrt_socket_t ddsi_raweth_conn_handle (ddsi_tran_base_t base)
 {
   return ((ddsi_raweth_conn_t) base)->m_sock;
@@ -174,6 +328,57 @@ static int ddsi_raweth_conn_locator (ddsi_tran_factory_t fact, ddsi_tran_base_t
   return ret;
 }
 
+static uint32_t next_power_of_two (uint32_t x)
+{
+  uint32_t p = 1;
+  while (p < x)
+    p <<= 1;
+  return p;
+}
+
+/* Sets up a receive ring of (approximately) ringsize bytes, with a slot for
+   each frame of up to maxframe bytes */
+static bool ddsi_raweth_rxring_init (struct ddsi_raweth_rxring *ring, ddsrt_socket_t sock, uint32_t ringsize, uint32_t maxframe, const struct ddsrt_log_cfg *logcfg)
+{
+  const uint32_t pagesize = (uint32_t) sysconf (_SC_PAGESIZE);
+  const int version = TPACKET_V2;
+  struct tpacket_req req;
+
+  /* the kernel puts the header and the source address before the payload,
+     with the payload aligned as if there were a link-layer header of at
+     least 16 bytes */
+  const uint32_t frame_size = next_power_of_two ((uint32_t) DDSI_RAWETH_TPACKET_ALIGN (DDSI_RAWETH_TPACKET_ALIGN (sizeof (struct tpacket2_hdr)) + sizeof (struct sockaddr_ll) + 16) + maxframe);
+  const uint32_t block_size = (frame_size > pagesize) ? frame_size : pagesize;
+  req.tp_block_size = block_size;
+  req.tp_block_nr = (ringsize > block_size) ? ringsize / block_size : 1;
+  req.tp_frame_size = frame_size;
+  req.tp_frame_nr = (block_size / frame_size) * req.tp_block_nr;
+
+  if (setsockopt (sock, SOL_PACKET, PACKET_VERSION, &version, sizeof (version)) < 0 ||
+      setsockopt (sock, SOL_PACKET, PACKET_RX_RING, &req, sizeof (req)) < 0)
+  {
+    DDS_CLOG (DDS_LC_CONFIG, logcfg, "raweth: receive ring not supported (errno %d), using regular reads\n", errno);
+    return false;
+  }
+  const size_t size = (size_t) req.tp_block_size * req.tp_block_nr;
+  void *base = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, sock, 0);
+  if (base == MAP_FAILED)
+  {
+    DDS_CLOG (DDS_LC_CONFIG, logcfg, "raweth: mapping receive ring failed (errno %d), using regular reads\n", errno);
+    /* removing the ring requires a request with 0 blocks */
+    memset (&req, 0, sizeof (req));
+    (void) setsockopt (sock, SOL_PACKET, PACKET_RX_RING, &req, sizeof (req));
+    return false;
+  }
+  ring->base = base;
+  ring->size = size;
+  ring->frame_size = frame_size;
+  ring->frame_nr = req.tp_frame_nr;
+  ring->next = 0;
+  DDS_CLOG (DDS_LC_CONFIG, logcfg, "raweth: receive ring of %"PRIu32" frames of %"PRIu32" bytes\n", ring->frame_nr, ring->frame_size);
+  return true;
+}
+
 static dds_return_t ddsi_raweth_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_factory_t fact, uint32_t port, const struct ddsi_tran_qos *qos)
 {
   ddsrt_socket_t sock;
@@ -229,7 +434,14 @@ static dds_return_t ddsi_raweth_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tr
   uc->m_base.m_locator_fn = ddsi_raweth_conn_locator;
   uc->m_base.m_read_fn = ddsi_raweth_conn_read;
   uc->m_base.m_write_fn = ddsi_raweth_conn_write;
+  uc->m_base.m_write_multi_fn = ddsi_raweth_conn_write_multi;
   uc->m_base.m_disable_multiplexing_fn = 0;
+  if (gv->config.raweth_rx_ring_size > 0 &&
+      ddsi_raweth_rxring_init (&uc->m_rxring, sock, gv->config.raweth_rx_ring_size, gv->config.max_msg_size, &gv->logconfig))
+  {
+    uc->m_base.m_read_fn = ddsi_raweth_conn_read_rxring;
+    uc->m_base.m_read_multi_fn = ddsi_raweth_conn_read_multi;
+  }
 
   DDS_CTRACE (&fact->gv->logconfig, "ddsi_raweth_create_conn %s socket %d port %u\n", mcast ? "multicast" : "unicast", uc->m_sock, uc->m_base.m_base.m_port);
   *conn_out = &uc->m_base;
@@ -289,6 +501,8 @@ static void ddsi_raweth_release_conn (ddsi_tran_conn_t conn)
               conn->m_base.m_multicast ? "multicast" : "unicast",
               uc->m_sock,
               uc->m_base.m_base.m_port);
+  if (uc->m_rxring.base)
+    munmap (uc->m_rxring.base, uc->m_rxring.size);
   ddsrt_close (uc->m_sock);
   ddsrt_free (conn);
 }
@@ -43,6 +43,7 @@
 
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/q_xevent.h"
+#include "dds/ddsi/q_thread.h"
 #include "dds/ddsi/ddsi_plist.h"
 #include "dds/ddsi/sysdeps.h"
 
@@ -3289,7 +3290,11 @@ static bool q_omg_security_decode_rtps_message (struct proxy_participant *proxyp
   struct dds_security_context *sc;
   DDS_Security_OctetSeq encoded_buffer;
   DDS_Security_OctetSeq plain_buffer = {0, 0, NULL};
+  DDS_Security_ParticipantCryptoHandle pp_crypto_handles_stk[8], *pp_crypto_handles = pp_crypto_handles_stk;
+  uint32_t n_pp_crypto_handles = 0, max_pp_crypto_handles = (uint32_t) (sizeof (pp_crypto_handles_stk) / sizeof (pp_crypto_handles_stk[0]));
+  DDS_Security_ParticipantCryptoHandle proxypp_crypto_handle;
   ddsrt_avl_iter_t it;
+  bool result = false;
 
   assert (proxypp);
   assert (src_buf);
@@ -3306,12 +3311,33 @@ static bool q_omg_security_decode_rtps_message (struct proxy_participant *proxyp
   encoded_buffer._length = (uint32_t) src_len;
   encoded_buffer._maximum = (uint32_t) src_len;
 
+  /* Only hold the lock while collecting the handles of the matching local participants: the
+     decoding itself may take a while and this way messages from the same participant can be
+     decoded in parallel */
   ddsrt_mutex_lock (&proxypp->sec_attr->lock);
   for (struct proxypp_pp_match *pm = ddsrt_avl_iter_first (&proxypp_pp_treedef, &proxypp->sec_attr->participants, &it); pm; pm = ddsrt_avl_iter_next (&it))
   {
-    sc = q_omg_security_get_secure_context_from_proxypp(proxypp);
-    assert (sc);
-    if (!sc->crypto_context->crypto_transform->decode_rtps_message (sc->crypto_context->crypto_transform, &plain_buffer, &encoded_buffer, pm->pp_crypto_handle, proxypp->sec_attr->crypto_handle, &ex))
+    if (n_pp_crypto_handles == max_pp_crypto_handles)
+    {
+      max_pp_crypto_handles *= 2;
+      if (pp_crypto_handles != pp_crypto_handles_stk)
+        pp_crypto_handles = ddsrt_realloc (pp_crypto_handles, max_pp_crypto_handles * sizeof (*pp_crypto_handles));
+      else
+      {
+        pp_crypto_handles = ddsrt_malloc (max_pp_crypto_handles * sizeof (*pp_crypto_handles));
+        memcpy (pp_crypto_handles, pp_crypto_handles_stk, sizeof (pp_crypto_handles_stk));
+      }
+    }
+    pp_crypto_handles[n_pp_crypto_handles++] = pm->pp_crypto_handle;
+  }
+  proxypp_crypto_handle = proxypp->sec_attr->crypto_handle;
+  ddsrt_mutex_unlock (&proxypp->sec_attr->lock);
+
+  sc = q_omg_security_get_secure_context_from_proxypp(proxypp);
+  assert (sc || n_pp_crypto_handles == 0);
+  for (uint32_t i = 0; i < n_pp_crypto_handles; i++)
+  {
+    if (!sc->crypto_context->crypto_transform->decode_rtps_message (sc->crypto_context->crypto_transform, &plain_buffer, &encoded_buffer, pp_crypto_handles[i], proxypp_crypto_handle, &ex))
     {
       if (ex.code == DDS_SECURITY_ERR_INVALID_CRYPTO_RECEIVER_SIGN_CODE)
       {
@@ -3320,20 +3346,21 @@ static bool q_omg_security_decode_rtps_message (struct proxy_participant *proxyp
       }
       GVTRACE ("decoding rtps message from remote participant "PGUIDFMT" failed: %s\n", PGUID (proxypp->e.guid), ex.message ? ex.message : "Unknown error");
       DDS_Security_Exception_reset (&ex);
-      ddsrt_mutex_unlock (&proxypp->sec_attr->lock);
-      return false;
+      goto done;
     }
     *dst_buf = plain_buffer._buffer;
     *dst_len = plain_buffer._length;
+    break;
   }
-  ddsrt_mutex_unlock (&proxypp->sec_attr->lock);
   if (*dst_buf == NULL)
-  {
     GVTRACE ("No match found for remote participant "PGUIDFMT" for decoding rtps message\n", PGUID (proxypp->e.guid));
-    return false;
-  }
+  else
+    result = true;
 
-  return true;
+done:
+  if (pp_crypto_handles != pp_crypto_handles_stk)
+    ddsrt_free (pp_crypto_handles);
+  return result;
 }
 
 bool q_omg_reader_is_submessage_protected(const struct reader *rd)
@@ -3771,6 +3798,208 @@ decode_rtps_message (
   return ret;
 }
 
+/* Decoding of RTPS messages received in a batch, optionally in parallel by a number of
+   dedicated threads.  A thread submitting a batch queues it, wakes up the decoding threads
+   and then helps decoding it until all jobs have been claimed, after which it waits for the
+   remaining ones to complete.  The messages themselves are handled in order by the
+   submitter afterwards. */
+struct rtps_decode_batch {
+  struct rtps_decode_batch *next;
+  struct nn_rtps_decode_job *jobs;
+  uint32_t n;        /* number of jobs */
+  uint32_t claimed;  /* jobs [0,claimed) have been taken by some thread */
+  uint32_t pending;  /* number of jobs not yet completed */
+};
+
+struct rtps_decode_pool {
+  struct ddsi_domaingv *gv;
+  ddsrt_mutex_t lock;
+  ddsrt_cond_t work_cond;
+  ddsrt_cond_t done_cond;
+  struct rtps_decode_batch *first, *last; /* batches with unclaimed jobs */
+  bool terminate;
+  uint32_t nthreads;
+  struct thread_state1 **threads;
+};
+
+static bool rtps_message_maybe_protected (const struct nn_rtps_decode_job *job)
+{
+  if (job->sz < RTPS_MESSAGE_HEADER_SIZE + sizeof (SubmessageHeader_t))
+    return false;
+  const SubmessageHeader_t *submsg = (const SubmessageHeader_t *) (job->buf + RTPS_MESSAGE_HEADER_SIZE);
+  return submsg->submessageId == SMID_SRTPS_PREFIX;
+}
+
+static void decode_rtps_job (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, struct nn_rtps_decode_job *job)
+{
+  struct proxy_participant *proxypp;
+  job->dstbuf = NULL;
+  job->dstlen = 0;
+  if (!rtps_message_maybe_protected (job))
+  {
+    job->state = NN_RTPS_MSG_STATE_PLAIN;
+    return;
+  }
+  thread_state_awake_fixed_domain (ts1);
+  job->state = check_rtps_message_is_secure (gv, (Header_t *) job->buf, job->buf, false, &proxypp);
+  if (job->state == NN_RTPS_MSG_STATE_ENCODED)
+  {
+    if (!q_omg_security_decode_rtps_message (proxypp, job->buf, job->sz, &job->dstbuf, &job->dstlen))
+      job->state = NN_RTPS_MSG_STATE_ERROR;
+    else
+    {
+      assert (job->dstlen >= RTPS_MESSAGE_HEADER_SIZE && job->dstlen <= UINT32_MAX);
+      Header_t * const hdr = (Header_t *) job->dstbuf;
+      hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
+    }
+  }
+  thread_state_asleep (ts1);
+}
+
+static bool rtps_decode_claim_locked (struct rtps_decode_pool *pool, struct rtps_decode_batch *b, uint32_t *idx)
+{
+  if (b->claimed == b->n)
+    return false;
+  *idx = b->claimed++;
+  if (b->claimed == b->n)
+  {
+    /* no more work in this batch, remove it from the queue */
+    struct rtps_decode_batch *prev = NULL, *cur = pool->first;
+    while (cur != b)
+    {
+      prev = cur;
+      cur = cur->next;
+    }
+    if (prev)
+      prev->next = b->next;
+    else
+      pool->first = b->next;
+    if (pool->last == b)
+      pool->last = prev;
+  }
+  return true;
+}
+
+static uint32_t rtps_decode_thread (void *varg)
+{
+  struct rtps_decode_pool * const pool = varg;
+  struct thread_state1 * const ts1 = lookup_thread_state ();
+  ddsrt_mutex_lock (&pool->lock);
+  while (!pool->terminate)
+  {
+    struct rtps_decode_batch * const b = pool->first;
+    uint32_t idx;
+    if (b == NULL || !rtps_decode_claim_locked (pool, b, &idx))
+      ddsrt_cond_wait (&pool->work_cond, &pool->lock);
+    else
+    {
+      ddsrt_mutex_unlock (&pool->lock);
+      decode_rtps_job (ts1, pool->gv, &b->jobs[idx]);
+      ddsrt_mutex_lock (&pool->lock);
+      /* b may be gone as soon as pending drops to 0 */
+      if (--b->pending == 0)
+        ddsrt_cond_broadcast (&pool->done_cond);
+    }
+  }
+  ddsrt_mutex_unlock (&pool->lock);
+  return 0;
+}
+
+void decode_rtps_messages (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, uint32_t n, struct nn_rtps_decode_job *jobs)
+{
+  struct rtps_decode_pool * const pool = gv->rtps_decode_pool;
+  uint32_t nprotected = 0;
+  if (pool != NULL)
+  {
+    for (uint32_t i = 0; i < n && nprotected < 2; i++)
+      if (rtps_message_maybe_protected (&jobs[i]))
+        nprotected++;
+  }
+  if (nprotected < 2)
+  {
+    for (uint32_t i = 0; i < n; i++)
+      decode_rtps_job (ts1, gv, &jobs[i]);
+    return;
+  }
+
+  struct rtps_decode_batch b = { .next = NULL, .jobs = jobs, .n = n, .claimed = 0, .pending = n };
+  uint32_t idx;
+  ddsrt_mutex_lock (&pool->lock);
+  if (pool->last)
+    pool->last->next = &b;
+  else
+    pool->first = &b;
+  pool->last = &b;
+  ddsrt_cond_broadcast (&pool->work_cond);
+  while (rtps_decode_claim_locked (pool, &b, &idx))
+  {
+    ddsrt_mutex_unlock (&pool->lock);
+    decode_rtps_job (ts1, gv, &jobs[idx]);
+    ddsrt_mutex_lock (&pool->lock);
+    b.pending--;
+  }
+  while (b.pending > 0)
+    ddsrt_cond_wait (&pool->done_cond, &pool->lock);
+  ddsrt_mutex_unlock (&pool->lock);
+}
+
+static void rtps_decode_pool_free (struct rtps_decode_pool *pool)
+{
+  ddsrt_mutex_lock (&pool->lock);
+  pool->terminate = true;
+  ddsrt_cond_broadcast (&pool->work_cond);
+  ddsrt_mutex_unlock (&pool->lock);
+  for (uint32_t i = 0; i < pool->nthreads; i++)
+    join_thread (pool->threads[i]);
+  assert (pool->first == NULL);
+  ddsrt_cond_destroy (&pool->done_cond);
+  ddsrt_cond_destroy (&pool->work_cond);
+  ddsrt_mutex_destroy (&pool->lock);
+  ddsrt_free (pool->threads);
+  ddsrt_free (pool);
+}
+
+dds_return_t rtps_decode_threads_start (struct ddsi_domaingv *gv)
+{
+  gv->rtps_decode_pool = NULL;
+  /* only batches of received messages are decoded in parallel */
+  if (gv->config.secure_decode_threads == 0 || gv->config.recv_batch_size <= 1)
+    return DDS_RETCODE_OK;
+
+  struct rtps_decode_pool *pool = ddsrt_malloc (sizeof (*pool));
+  pool->gv = gv;
+  ddsrt_mutex_init (&pool->lock);
+  ddsrt_cond_init (&pool->work_cond);
+  ddsrt_cond_init (&pool->done_cond);
+  pool->first = pool->last = NULL;
+  pool->terminate = false;
+  pool->nthreads = 0;
+  pool->threads = ddsrt_malloc (gv->config.secure_decode_threads * sizeof (*pool->threads));
+  for (uint32_t i = 0; i < gv->config.secure_decode_threads; i++)
+  {
+    char name[32];
+    (void) snprintf (name, sizeof (name), "rtpsdec%"PRIu32, i);
+    if (create_thread (&pool->threads[i], gv, name, rtps_decode_thread, pool) != DDS_RETCODE_OK)
+    {
+      GVERROR ("rtps_init: failed to start thread %s\n", name);
+      rtps_decode_pool_free (pool);
+      return DDS_RETCODE_ERROR;
+    }
+    pool->nthreads++;
+  }
+  gv->rtps_decode_pool = pool;
+  return DDS_RETCODE_OK;
+}
+
+void rtps_decode_threads_stop (struct ddsi_domaingv *gv)
+{
+  if (gv->rtps_decode_pool)
+  {
+    rtps_decode_pool_free (gv->rtps_decode_pool);
+    gv->rtps_decode_pool = NULL;
+  }
+}
+
 ssize_t
 secure_conn_write(
     const struct ddsi_domaingv *gv,
@@ -4036,6 +4265,16 @@ DDS_EXPORT extern inline nn_rtps_msg_state_t decode_rtps_message(
   UNUSED_ARG(struct nn_rbufpool *rbpool),
   UNUSED_ARG(bool isstream));
 
+DDS_EXPORT extern inline void decode_rtps_messages(
+  UNUSED_ARG(struct thread_state1 * const ts1),
+  UNUSED_ARG(struct ddsi_domaingv *gv),
+  uint32_t n,
+  struct nn_rtps_decode_job *jobs);
+
+DDS_EXPORT extern inline dds_return_t rtps_decode_threads_start(UNUSED_ARG(struct ddsi_domaingv *gv));
+
+DDS_EXPORT extern inline void rtps_decode_threads_stop(UNUSED_ARG(struct ddsi_domaingv *gv));
+
 DDS_EXPORT extern inline int64_t q_omg_security_get_remote_participant_handle(UNUSED_ARG(struct proxy_participant *proxypp));
 
 DDS_EXPORT extern inline bool q_omg_reader_is_discovery_protected(UNUSED_ARG(const struct reader *rd));
@@ -597,6 +597,49 @@ static struct ddsi_serdata *serdata_default_from_sample_xcdr2_nokey (const struc
 }
 
 
+bool ddsi_serdata_default_loan_supported (const struct ddsi_sertype *type)
+{
+  if (type->ops != &ddsi_sertype_ops_default)
+    return false;
+  const struct ddsi_sertype_default *tp = (const struct ddsi_sertype_default *) type;
+  // the same condition under which dds_stream_write_sample copies the sample
+  return type->fixed_size && tp->opt_size > 0 && tp->type.align > 0;
+}
+
+struct ddsi_serdata *ddsi_serdata_default_loan_new (const struct ddsi_sertype *type, void **sample)
+{
+  if (!ddsi_serdata_default_loan_supported (type))
+    return NULL;
+  const struct ddsi_sertype_default *tp = (const struct ddsi_sertype_default *) type;
+  const uint32_t xcdr_version =
+    (type->serdata_ops == &ddsi_serdata_ops_cdr || type->serdata_ops == &ddsi_serdata_ops_cdr_nokey) ? CDR_ENC_VERSION_1 : CDR_ENC_VERSION_2;
+  // the application may write the full C struct, including trailing padding
+  const size_t size = alignup_size (tp->opt_size > tp->type.size ? tp->opt_size : tp->type.size, 4);
+  struct ddsi_serdata_default *d;
+  if ((d = serdata_default_new_size (tp, SDK_DATA, (uint32_t) size, xcdr_version)) == NULL)
+    return NULL;
+  (void) serdata_default_append (&d, size);
+  d->pos = 0;
+  *sample = d->data;
+  return &d->c;
+}
+
+struct ddsi_serdata *ddsi_serdata_default_loan_fini (struct ddsi_serdata *dcmn)
+{
+  struct ddsi_serdata_default *d = (struct ddsi_serdata_default *) dcmn;
+  const struct ddsi_sertype_default *tp = (const struct ddsi_sertype_default *) d->c.type;
+  const uint32_t pad = (uint32_t) (alignup_size (tp->opt_size, 4) - tp->opt_size);
+  assert (d->c.kind == SDK_DATA && d->pos == 0);
+  memset (d->data + tp->opt_size, 0, pad);
+  d->pos = (uint32_t) tp->opt_size + pad;
+  d->hdr.options = ddsrt_toBE2u ((uint16_t) pad);
+  gen_serdata_key_from_sample (tp, &d->key, d->data);
+  if (tp->c.typekind_no_key)
+    return fix_serdata_default_nokey (d, tp->c.serdata_basehash);
+  else
+    return fix_serdata_default (d, tp->c.serdata_basehash);
+}
+
 static struct ddsi_serdata *serdata_default_to_untyped (const struct ddsi_serdata *serdata_common)
 {
   const struct ddsi_serdata_default *d = (const struct ddsi_serdata_default *)serdata_common;
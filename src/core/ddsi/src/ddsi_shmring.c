@@ -0,0 +1,902 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include "dds/ddsi/ddsi_tran.h"
+#include "dds/ddsi/ddsi_shmring.h"
+#include "dds/ddsi/q_config.h"
+#include "dds/ddsi/q_log.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_unused.h"
+#include "dds/ddsi/q_xevent.h"
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/log.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/sync.h"
+
+#if defined(__linux) && !LWIP_SOCKET
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+/* Shared-memory ring transport: every domain instance creates one ring in a
+   POSIX shared memory segment, into which all other processes on the same
+   machine copy the RTPS messages destined for it.  The ring is a multiple
+   producer, single consumer ring of variable-length records: writers reserve
+   space by advancing "head" with a CAS, mark the record as reserved by their
+   process, copy the message and then publish it by setting the length in the
+   record header; the (single) receive thread
+   consumes records in order, clears them and advances "tail".  A sleeping
+   reader is woken up via a futex on "waiting".
+
+   The locator contains an identifier of the host (including the shared
+   memory and pid namespaces) as address, and the process id and an index to
+   distinguish the domain instances within the process as port.  The segment
+   name is derived from the port and the pid namespace.
+
+   Messages are dropped when the ring is full, just like a full socket
+   receive buffer drops datagrams.  The reader skips records that are still
+   marked as reserved once the process that reserved them no longer exists,
+   so that a writer crashing while copying a message doesn't block the ring.
+   (Only a crash in the few instructions between advancing head and marking
+   the record still does.)  Segments left behind by crashed processes are
+   removed when a new ring is created.
+
+   A ring that is dead, because its owner has gone or because the reader
+   found garbage in it, is no longer used: writers that find out rebuild
+   their address sets without its locator, falling back to the other
+   locators of the readers, and the owner stops advertising it.
+
+   Everything in the segment can be modified by any process that has access
+   to it, so nothing read from it is trusted: the size and (for the reader)
+   the tail are kept in private memory and records that don't fit in the
+   ring cause the reader to give up on it.  By default the segment is only
+   accessible to the user that created it, and then the user id is part of
+   the host identifier so that processes of other users don't even try to
+   use it. */
+
+#define SHMRING_VERSION 2u
+#define SHMRING_CACHELINE 64
+#define SHMRING_MIN_SIZE (256u * 1024u)
+#define SHMRING_MAX_SIZE (1u << 30)
+#define SHMRING_MAX_MSG 65536u
+#define SHMRING_PAD 0x80000000u
+#define SHMRING_RESERVED 0x40000000u
+#define SHMRING_NAME_PREFIX "cdds-shmring-"
+#define SHMRING_WAIT_TIMEOUT_S 1
+
+struct shmring_hdr {
+  uint32_t version;
+  uint32_t size; /* of data area, power of 2 */
+  ddsrt_atomic_uint32_t alive; /* 1 once initialized, 0 once the owner is gone */
+  char pad0[SHMRING_CACHELINE - 12];
+  ddsrt_atomic_uint32_t head; /* reserved by writers */
+  char pad1[SHMRING_CACHELINE - 4];
+  ddsrt_atomic_uint32_t tail; /* consumed by the reader */
+  char pad2[SHMRING_CACHELINE - 4];
+  ddsrt_atomic_uint32_t waiting; /* futex word: 1 if the reader is (about to go to) sleep */
+  char pad3[SHMRING_CACHELINE - 4];
+};
+
+/* Record header, the message follows it; records are 8-byte aligned.  A zero
+   length means the record hasn't been reserved yet, a length with
+   SHMRING_RESERVED set that it hasn't been published yet by the process in
+   srcport, and a length with SHMRING_PAD set means the remainder of the ring
+   must be skipped. */
+struct shmring_rec {
+  ddsrt_atomic_uint32_t len;
+  uint32_t srcport;
+};
+
+#define SHMRING_REC_SIZE(len) ((uint32_t) sizeof (struct shmring_rec) + (((len) + 7u) & ~7u))
+
+struct shmring {
+  struct shmring_hdr *hdr;
+  unsigned char *data;
+  size_t mapsize;
+  ino_t ino;
+  uint32_t size; /* copy of hdr->size as checked when mapping it */
+  uint32_t tail; /* copy of hdr->tail, only used by the reader */
+  bool corrupt; /* set by the reader once it found garbage in the ring */
+};
+
+struct shmring_peer {
+  uint32_t port;
+  uint32_t refc;
+  bool dead;
+  struct shmring ring;
+};
+
+enum shmring_push_result {
+  SRPR_OK,
+  SRPR_FULL,
+  SRPR_DEAD
+};
+
+typedef struct ddsi_shmring_conn {
+  struct ddsi_tran_conn m_base;
+} *ddsi_shmring_conn_t;
+
+typedef struct ddsi_shmring_tran_factory {
+  struct ddsi_tran_factory m_base;
+  uint32_t m_nsid;
+  ddsi_locator_t m_loc;
+  struct shmring m_own;
+  ddsrt_mutex_t m_lock;
+  struct ddsrt_hh *m_peers;
+} *ddsi_shmring_tran_factory_t;
+
+/* Indices of the rings in use by this process, index 0 is never used */
+static ddsrt_atomic_uint32_t shmring_idx_inuse[256 / 32];
+
+static uint32_t shmring_claim_idx (void)
+{
+  for (uint32_t i = 1; i < 256; i++)
+  {
+    const uint32_t bit = 1u << (i % 32);
+    if (!(ddsrt_atomic_or32_ov (&shmring_idx_inuse[i / 32], bit) & bit))
+      return i;
+  }
+  return 0;
+}
+
+static void shmring_release_idx (uint32_t idx)
+{
+  ddsrt_atomic_and32 (&shmring_idx_inuse[idx / 32], ~(1u << (idx % 32)));
+}
+
+static bool shmring_owner_gone (uint32_t port)
+{
+  return kill ((pid_t) (port >> 8), 0) == -1 && errno == ESRCH;
+}
+
+static void shmring_name (char *dst, size_t sizeof_dst, uint32_t nsid, uint32_t port)
+{
+  (void) snprintf (dst, sizeof_dst, "/" SHMRING_NAME_PREFIX "%08"PRIx32"-%"PRIu32, nsid, port);
+}
+
+static void shmring_host_id (unsigned char id[16], uint32_t *nsid, bool per_user)
+{
+  /* Processes can only communicate if they are on the same machine (boot id), share
+     the same /dev/shm (its device) and agree on process ids (pid namespace); unless
+     other users are allowed access, they also need to run as the same user */
+  struct stat st;
+  FILE *fp;
+  memset (id, 0, 16);
+  if ((fp = fopen ("/proc/sys/kernel/random/boot_id", "r")) != NULL)
+  {
+    int c, n = 0;
+    while (n < 16 && (c = fgetc (fp)) != EOF)
+    {
+      const int v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+      if (v >= 0)
+      {
+        id[n / 2] = (unsigned char) ((id[n / 2] << 4) | v);
+        n++;
+      }
+    }
+    fclose (fp);
+  }
+  if (stat ("/dev/shm", &st) == 0)
+  {
+    uint32_t dev = (uint32_t) st.st_dev;
+    if (per_user)
+      dev ^= ((uint32_t) getuid () + 1) * 0x9e3779b1u;
+    memcpy (id + 8, &dev, sizeof (dev));
+  }
+  *nsid = 0;
+  if (stat ("/proc/self/ns/pid", &st) == 0)
+    *nsid = (uint32_t) st.st_ino;
+  memcpy (id + 12, nsid, sizeof (*nsid));
+}
+
+static void shmring_remove_stale (const struct ddsi_domaingv *gv, uint32_t nsid)
+{
+  char prefix[sizeof (SHMRING_NAME_PREFIX) + 9];
+  DIR *dir;
+  struct dirent *de;
+  if ((dir = opendir ("/dev/shm")) == NULL)
+    return;
+  (void) snprintf (prefix, sizeof (prefix), SHMRING_NAME_PREFIX "%08"PRIx32"-", nsid);
+  const size_t prefixlen = strlen (prefix);
+  while ((de = readdir (dir)) != NULL)
+  {
+    uint32_t port;
+    char name[NAME_MAX + 2];
+    if (strncmp (de->d_name, prefix, prefixlen) != 0 || sscanf (de->d_name + prefixlen, "%"SCNu32, &port) != 1)
+      continue;
+    if (shmring_owner_gone (port))
+    {
+      (void) snprintf (name, sizeof (name), "/%s", de->d_name);
+      if (shm_unlink (name) == 0)
+        GVLOG (DDS_LC_CONFIG, "shmring: removed stale segment %s\n", name);
+    }
+  }
+  closedir (dir);
+}
+
+static bool shmring_map (struct shmring *r, int fd, size_t mapsize)
+{
+  void *p = mmap (NULL, mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED)
+    return false;
+  r->hdr = p;
+  r->data = (unsigned char *) p + sizeof (struct shmring_hdr);
+  r->mapsize = mapsize;
+  return true;
+}
+
+static void shmring_unmap (struct shmring *r)
+{
+  (void) munmap (r->hdr, r->mapsize);
+}
+
+static int shmring_create (const struct ddsi_domaingv *gv, struct shmring *r, uint32_t nsid, uint32_t port, uint32_t size)
+{
+  char name[64];
+  struct stat st;
+  int fd;
+  shmring_name (name, sizeof (name), nsid, port);
+  /* the index is not in use in this process, so any existing segment with this
+     name was left behind by a previous process with the same pid */
+  (void) shm_unlink (name);
+  if ((fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0600)) == -1)
+  {
+    GVERROR ("shmring: can't create %s: %s\n", name, strerror (errno));
+    return -1;
+  }
+  /* the mode requested in shm_open is subject to the umask */
+  if (gv->config.shmring_allow_other_users)
+    (void) fchmod (fd, 0666);
+  const size_t mapsize = sizeof (struct shmring_hdr) + size;
+  if (ftruncate (fd, (off_t) mapsize) == -1 || fstat (fd, &st) == -1 || !shmring_map (r, fd, mapsize))
+  {
+    GVERROR ("shmring: can't map %s: %s\n", name, strerror (errno));
+    (void) close (fd);
+    (void) shm_unlink (name);
+    return -1;
+  }
+  (void) close (fd);
+  r->ino = st.st_ino;
+  r->size = size;
+  r->tail = 0;
+  r->corrupt = false;
+  r->hdr->version = SHMRING_VERSION;
+  r->hdr->size = size;
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&r->hdr->alive, 1);
+  return 0;
+}
+
+static bool shmring_open (struct shmring *r, const char *name)
+{
+  struct stat st;
+  bool ok = false;
+  int fd;
+  if ((fd = shm_open (name, O_RDWR, 0)) == -1)
+    return false;
+  if (fstat (fd, &st) == 0 && (size_t) st.st_size > sizeof (struct shmring_hdr) && shmring_map (r, fd, (size_t) st.st_size))
+  {
+    const struct shmring_hdr *hdr = r->hdr;
+    r->ino = st.st_ino;
+    if (ddsrt_atomic_ld32 (&hdr->alive))
+    {
+      ddsrt_atomic_fence_acq ();
+      r->size = hdr->size;
+      r->tail = 0;
+      r->corrupt = false;
+      ok = (hdr->version == SHMRING_VERSION && r->size >= SHMRING_MIN_SIZE && r->size == r->mapsize - sizeof (*hdr) && (r->size & (r->size - 1)) == 0);
+    }
+    if (!ok)
+      shmring_unmap (r);
+  }
+  (void) close (fd);
+  return ok;
+}
+
+static bool shmring_is_current (uint32_t nsid, uint32_t port, const struct shmring *r)
+{
+  /* a full ring may be one of a crashed process whose pid got reused */
+  char name[64];
+  struct stat st;
+  bool current = false;
+  int fd;
+  shmring_name (name, sizeof (name), nsid, port);
+  if ((fd = shm_open (name, O_RDONLY, 0)) != -1)
+  {
+    current = (fstat (fd, &st) == 0 && st.st_ino == r->ino);
+    (void) close (fd);
+  }
+  return current && kill ((pid_t) (port >> 8), 0) == 0;
+}
+
+static void shmring_futex_wake (ddsrt_atomic_uint32_t *addr)
+{
+  (void) syscall (SYS_futex, (uint32_t *) addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static void shmring_futex_wait (ddsrt_atomic_uint32_t *addr, uint32_t val)
+{
+  const struct timespec timeout = { .tv_sec = SHMRING_WAIT_TIMEOUT_S, .tv_nsec = 0 };
+  (void) syscall (SYS_futex, (uint32_t *) addr, FUTEX_WAIT, val, &timeout, NULL, 0);
+}
+
+static enum shmring_push_result shmring_push (struct shmring *r, uint32_t srcport, uint32_t len, size_t niov, const ddsrt_iovec_t *iov)
+{
+  struct shmring_hdr * const hdr = r->hdr;
+  const uint32_t size = r->size;
+  const uint32_t need = SHMRING_REC_SIZE (len);
+  uint32_t h, off, skip;
+  if (!ddsrt_atomic_ld32 (&hdr->alive))
+    return SRPR_DEAD;
+  while (true)
+  {
+    h = ddsrt_atomic_ld32 (&hdr->head);
+    const uint32_t t = ddsrt_atomic_ld32 (&hdr->tail);
+    /* a misaligned head means someone scribbled over the header */
+    if (h & 7)
+      return SRPR_DEAD;
+    off = h & (size - 1);
+    /* records never wrap around, instead the end of the ring is skipped */
+    skip = (size - off < need) ? size - off : 0;
+    /* tail can only pass the head we read if head has since moved on */
+    if ((int32_t) (h - t) < 0)
+    {
+      if (ddsrt_atomic_ld32 (&hdr->head) == h)
+        return SRPR_DEAD;
+      continue;
+    }
+    if (h - t + skip + need > size)
+      return SRPR_FULL;
+    if (ddsrt_atomic_cas32 (&hdr->head, h, h + skip + need))
+      break;
+  }
+
+  if (skip > 0)
+  {
+    struct shmring_rec * const pad = (struct shmring_rec *) (r->data + off);
+    pad->srcport = 0;
+    ddsrt_atomic_st32 (&pad->len, SHMRING_PAD | skip);
+    off = 0;
+  }
+  /* claim the record before copying, so the reader can tell whose it is */
+  struct shmring_rec * const rec = (struct shmring_rec *) (r->data + off);
+  unsigned char *dst = (unsigned char *) (rec + 1);
+  rec->srcport = srcport;
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&rec->len, SHMRING_RESERVED | len);
+  for (size_t i = 0; i < niov; i++)
+  {
+    memcpy (dst, iov[i].iov_base, iov[i].iov_len);
+    dst += iov[i].iov_len;
+  }
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&rec->len, len);
+
+  /* pairs with the fence in shmring_wait: either the reader sees the new record
+     or we see that it is waiting */
+  ddsrt_atomic_fence ();
+  if (ddsrt_atomic_ld32 (&hdr->waiting) && ddsrt_atomic_cas32 (&hdr->waiting, 1, 0))
+    shmring_futex_wake (&hdr->waiting);
+  return SRPR_OK;
+}
+
+static ssize_t shmring_pop (struct shmring *r, unsigned char *buf, size_t len, uint32_t *srcport)
+{
+  struct shmring_hdr * const hdr = r->hdr;
+  const uint32_t size = r->size;
+  if (r->corrupt)
+    return 0;
+  while (true)
+  {
+    const uint32_t t = r->tail;
+    const uint32_t off = t & (size - 1);
+    struct shmring_rec * const rec = (struct shmring_rec *) (r->data + off);
+    const uint32_t l = ddsrt_atomic_ld32 (&rec->len);
+    const uint32_t msglen = l & ~SHMRING_RESERVED;
+    uint32_t recsize;
+    size_t n = 0;
+    if (l == 0)
+      return 0;
+    ddsrt_atomic_fence_acq ();
+    /* a published record lies entirely between tail and head and never wraps
+       around, padding always extends to the end of the ring */
+    bool valid;
+    if (l & SHMRING_PAD)
+    {
+      recsize = l & ~SHMRING_PAD;
+      valid = (recsize == size - off);
+    }
+    else
+    {
+      recsize = SHMRING_REC_SIZE (msglen);
+      valid = (msglen > 0 && msglen <= SHMRING_MAX_MSG && recsize <= size - off);
+    }
+    if (!valid || recsize > ddsrt_atomic_ld32 (&hdr->head) - t)
+    {
+      /* there is no way of telling where the next record starts, nor whether
+         any following records are any good: stop using the ring */
+      r->corrupt = true;
+      ddsrt_atomic_st32 (&hdr->alive, 0);
+      return -1;
+    }
+    if (l & SHMRING_RESERVED)
+    {
+      /* being written, unless the writer died in the process */
+      if (!shmring_owner_gone (rec->srcport))
+        return 0;
+    }
+    else if (!(l & SHMRING_PAD))
+    {
+      n = (l < len) ? l : len;
+      memcpy (buf, rec + 1, n);
+      *srcport = rec->srcport;
+    }
+    /* writers rely on free space being all zero */
+    memset (rec, 0, recsize);
+    r->tail = t + recsize;
+    ddsrt_atomic_fence_rel ();
+    ddsrt_atomic_st32 (&hdr->tail, r->tail);
+    if (!(l & (SHMRING_PAD | SHMRING_RESERVED)))
+      return (ssize_t) n;
+  }
+}
+
+static void shmring_wait (struct shmring *r)
+{
+  struct shmring_hdr * const hdr = r->hdr;
+  const struct shmring_rec *rec;
+  ddsrt_atomic_st32 (&hdr->waiting, 1);
+  ddsrt_atomic_fence ();
+  rec = (const struct shmring_rec *) (r->data + (r->tail & (r->size - 1)));
+  /* a corrupt ring never has data, sleeping prevents the receive thread from
+     spinning; the writer of a reserved record wakes us once it publishes it,
+     if it dies instead, the timeout ensures we eventually skip it */
+  const uint32_t l = r->corrupt ? 0 : ddsrt_atomic_ld32 (&rec->len);
+  if (l == 0 || (l & SHMRING_RESERVED))
+    shmring_futex_wait (&hdr->waiting, 1);
+  ddsrt_atomic_st32 (&hdr->waiting, 0);
+}
+
+static uint32_t shmring_peer_hash (const void *vp)
+{
+  const struct shmring_peer *p = vp;
+  return p->port * 0x9e3779b1u;
+}
+
+static int shmring_peer_equal (const void *va, const void *vb)
+{
+  const struct shmring_peer *a = va;
+  const struct shmring_peer *b = vb;
+  return a->port == b->port;
+}
+
+static struct shmring_peer *shmring_peer_ref (struct ddsi_shmring_tran_factory *fact, uint32_t port)
+{
+  const struct shmring_peer template = { .port = port };
+  struct shmring_peer *p;
+  ddsrt_mutex_lock (&fact->m_lock);
+  if ((p = ddsrt_hh_lookup (fact->m_peers, &template)) == NULL)
+  {
+    char name[64];
+    shmring_name (name, sizeof (name), fact->m_nsid, port);
+    p = ddsrt_malloc (sizeof (*p));
+    if (!shmring_open (&p->ring, name))
+    {
+      ddsrt_free (p);
+      p = NULL;
+    }
+    else
+    {
+      p->port = port;
+      p->refc = 0;
+      p->dead = false;
+      ddsrt_hh_add_absent (fact->m_peers, p);
+    }
+  }
+  if (p)
+    p->refc++;
+  ddsrt_mutex_unlock (&fact->m_lock);
+  return p;
+}
+
+static bool shmring_peer_unref (struct ddsi_shmring_tran_factory *fact, struct shmring_peer *p, bool dead)
+{
+  /* returns true if this marked the peer as dead */
+  bool newly_dead = false;
+  ddsrt_mutex_lock (&fact->m_lock);
+  if (dead && !p->dead)
+  {
+    p->dead = true;
+    newly_dead = true;
+    ddsrt_hh_remove_present (fact->m_peers, p);
+  }
+  if (--p->refc == 0 && p->dead)
+  {
+    shmring_unmap (&p->ring);
+    ddsrt_free (p);
+  }
+  ddsrt_mutex_unlock (&fact->m_lock);
+  return newly_dead;
+}
+
+static void shmring_rebuild_writer_addrsets (struct xevent *xev, void *varg, UNUSED_ARG (ddsrt_mtime_t tnow))
+{
+  struct ddsi_domaingv * const gv = varg;
+  rebuild_or_clear_writer_addrsets (gv, 1);
+  delete_xevent (xev);
+}
+
+static char *ddsi_shmring_to_string (char *dst, size_t sizeof_dst, const ddsi_locator_t *loc, ddsi_tran_conn_t conn, int with_port)
+{
+  (void) conn;
+  int pos = 0;
+  for (size_t i = 0; i < sizeof (loc->address) && pos >= 0 && (size_t) pos < sizeof_dst; i++)
+    pos += snprintf (dst + pos, sizeof_dst - (size_t) pos, "%02x", loc->address[i]);
+  if (with_port && pos >= 0 && (size_t) pos < sizeof_dst)
+    (void) snprintf (dst + pos, sizeof_dst - (size_t) pos, ":%"PRIu32, loc->port);
+  return dst;
+}
+
+static void shmring_log_corrupt (const struct ddsi_shmring_tran_factory *fact)
+{
+  char buf[DDSI_LOCSTRLEN];
+  DDS_CERROR (&fact->m_base.gv->logconfig, "shmring: ring %s contains an invalid record, no longer receiving through it\n",
+              ddsi_shmring_to_string (buf, sizeof (buf), &fact->m_loc, NULL, 1));
+}
+
+static ssize_t ddsi_shmring_conn_read (ddsi_tran_conn_t conn, unsigned char *buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc)
+{
+  struct ddsi_shmring_tran_factory * const fact = (struct ddsi_shmring_tran_factory *) conn->m_factory;
+  uint32_t srcport = 0;
+  ssize_t n;
+  (void) allow_spurious;
+  if ((n = shmring_pop (&fact->m_own, buf, len, &srcport)) == 0)
+  {
+    shmring_wait (&fact->m_own);
+    n = shmring_pop (&fact->m_own, buf, len, &srcport);
+  }
+  if (n < 0)
+    shmring_log_corrupt (fact);
+  if (n > 0 && srcloc)
+  {
+    *srcloc = fact->m_loc;
+    srcloc->port = srcport;
+  }
+  return n;
+}
+
+static ssize_t ddsi_shmring_conn_read_multi (ddsi_tran_conn_t conn, size_t nbufs, struct ddsi_tran_recvbuf *bufs)
+{
+  struct ddsi_shmring_tran_factory * const fact = (struct ddsi_shmring_tran_factory *) conn->m_factory;
+  size_t n = 0;
+  while (n < nbufs)
+  {
+    uint32_t srcport = 0;
+    ssize_t sz;
+    if ((sz = shmring_pop (&fact->m_own, bufs[n].buf, bufs[n].len, &srcport)) == 0)
+    {
+      if (n > 0)
+        break;
+      shmring_wait (&fact->m_own);
+      if ((sz = shmring_pop (&fact->m_own, bufs[n].buf, bufs[n].len, &srcport)) == 0)
+        break;
+    }
+    if (sz < 0)
+    {
+      shmring_log_corrupt (fact);
+      return (n > 0) ? (ssize_t) n : -1;
+    }
+    bufs[n].size = sz;
+    bufs[n].srcloc = fact->m_loc;
+    bufs[n].srcloc.port = srcport;
+    n++;
+  }
+  return (ssize_t) n;
+}
+
+static ssize_t ddsi_shmring_conn_write (ddsi_tran_conn_t conn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  struct ddsi_shmring_tran_factory * const fact = (struct ddsi_shmring_tran_factory *) conn->m_factory;
+  struct shmring_peer *p;
+  size_t len = 0;
+  ssize_t ret = -1;
+  bool dead = false;
+  (void) flags;
+  for (size_t i = 0; i < niov; i++)
+    len += iov[i].iov_len;
+  if (len == 0 || len > SHMRING_MAX_MSG)
+    return -1;
+  if ((p = shmring_peer_ref (fact, dst->port)) == NULL)
+    return -1;
+  switch (shmring_push (&p->ring, fact->m_loc.port, (uint32_t) len, niov, iov))
+  {
+    case SRPR_OK:
+      ret = (ssize_t) len;
+      break;
+    case SRPR_FULL:
+      dead = !shmring_is_current (fact->m_nsid, p->port, &p->ring);
+      break;
+    case SRPR_DEAD:
+      dead = true;
+      break;
+  }
+  if (shmring_peer_unref (fact, p, dead))
+  {
+    /* stop selecting its locator, this happens in the event thread because
+       we may well be holding a writer lock here */
+    struct ddsi_domaingv * const gv = fact->m_base.gv;
+    char buf[DDSI_LOCSTRLEN];
+    GVLOG (DDS_LC_DISCOVERY, "shmring: ring %s is dead, rebuilding writer address sets\n", ddsi_locator_to_string (buf, sizeof (buf), dst));
+    qxev_callback (gv->xevents, ddsrt_time_monotonic (), shmring_rebuild_writer_addrsets, gv);
+  }
+  return ret;
+}
+
+bool ddsi_shmring_locator_usable (struct ddsi_tran_factory *fact_cmn, const ddsi_locator_t *loc)
+{
+  struct ddsi_shmring_tran_factory * const fact = (struct ddsi_shmring_tran_factory *) fact_cmn;
+  struct shmring_peer *p;
+  if (memcmp (loc->address, fact->m_loc.address, sizeof (loc->address)) != 0 || shmring_owner_gone (loc->port))
+    return false;
+  if ((p = shmring_peer_ref (fact, loc->port)) == NULL)
+    return false;
+  const bool alive = (ddsrt_atomic_ld32 (&p->ring.hdr->alive) != 0);
+  (void) shmring_peer_unref (fact, p, !alive);
+  return alive;
+}
+
+static bool ddsi_shmring_supports (const struct ddsi_tran_factory *fact, int32_t kind)
+{
+  (void) fact;
+  return (kind == NN_LOCATOR_KIND_SHMRING);
+}
+
+static ddsrt_socket_t ddsi_shmring_conn_handle (ddsi_tran_base_t conn)
+{
+  (void) conn;
+  return DDSRT_INVALID_SOCKET;
+}
+
+static int ddsi_shmring_conn_locator (ddsi_tran_factory_t fact_cmn, ddsi_tran_base_t base, ddsi_locator_t *loc)
+{
+  struct ddsi_shmring_tran_factory const * const fact = (const struct ddsi_shmring_tran_factory *) fact_cmn;
+  (void) base;
+  *loc = fact->m_loc;
+  return 0;
+}
+
+static dds_return_t ddsi_shmring_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_factory_t fact_cmn, uint32_t port, const struct ddsi_tran_qos *qos)
+{
+  struct ddsi_shmring_tran_factory * const fact = (struct ddsi_shmring_tran_factory *) fact_cmn;
+  (void) port;
+  if (qos->m_purpose == DDSI_TRAN_QOS_RECV_MC)
+    return DDS_RETCODE_BAD_PARAMETER;
+
+  struct ddsi_shmring_conn *x = ddsrt_malloc (sizeof (*x));
+  memset (x, 0, sizeof (*x));
+  ddsi_factory_conn_init (&fact->m_base, qos->m_interface, &x->m_base);
+  x->m_base.m_base.m_port = fact->m_loc.port;
+  x->m_base.m_base.m_trantype = DDSI_TRAN_CONN;
+  x->m_base.m_base.m_multicast = false;
+  x->m_base.m_base.m_handle_fn = ddsi_shmring_conn_handle;
+  x->m_base.m_locator_fn = ddsi_shmring_conn_locator;
+  x->m_base.m_read_fn = ddsi_shmring_conn_read;
+  x->m_base.m_read_multi_fn = ddsi_shmring_conn_read_multi;
+  x->m_base.m_write_fn = ddsi_shmring_conn_write;
+  x->m_base.m_disable_multiplexing_fn = 0;
+
+  DDS_CTRACE (&fact->m_base.gv->logconfig, "ddsi_shmring_create_conn %s port %"PRIu32"\n",
+              (qos->m_purpose == DDSI_TRAN_QOS_RECV_UC) ? "receive" : "transmit", fact->m_loc.port);
+  *conn_out = &x->m_base;
+  return DDS_RETCODE_OK;
+}
+
+static void ddsi_shmring_release_conn (ddsi_tran_conn_t conn)
+{
+  DDS_CTRACE (&conn->m_base.gv->logconfig, "ddsi_shmring_release_conn port %"PRIu32"\n", conn->m_base.m_port);
+  ddsrt_free (conn);
+}
+
+static int ddsi_shmring_is_not (const struct ddsi_tran_factory *tran, const ddsi_locator_t *loc)
+{
+  (void) tran;
+  (void) loc;
+  return 0;
+}
+
+static enum ddsi_nearby_address_result ddsi_shmring_is_nearby_address (const ddsi_locator_t *loc, size_t ninterf, const struct nn_interface interf[], size_t *interf_idx)
+{
+  for (size_t i = 0; i < ninterf; i++)
+  {
+    if (interf[i].loc.kind == loc->kind && memcmp (interf[i].loc.address, loc->address, sizeof (loc->address)) == 0)
+    {
+      if (interf_idx)
+        *interf_idx = i;
+      return DNAR_LOCAL;
+    }
+  }
+  return DNAR_DISTANT;
+}
+
+static enum ddsi_locator_from_string_result ddsi_shmring_address_from_string (const struct ddsi_tran_factory *tran, ddsi_locator_t *loc, const char *str)
+{
+  (void) tran;
+  loc->kind = NN_LOCATOR_KIND_SHMRING;
+  loc->port = NN_LOCATOR_PORT_INVALID;
+  memset (loc->address, 0, sizeof (loc->address));
+  for (size_t i = 0; i < sizeof (loc->address); i++)
+  {
+    unsigned o;
+    int p;
+    if (sscanf (str, "%2x%n", &o, &p) != 1 || p != 2)
+      return AFSR_INVALID;
+    loc->address[i] = (unsigned char) o;
+    str += p;
+  }
+  if (*str == ':')
+  {
+    unsigned long port;
+    char *end;
+    port = strtoul (str + 1, &end, 10);
+    if (end == str + 1 || port > UINT32_MAX)
+      return AFSR_INVALID;
+    loc->port = (uint32_t) port;
+    str = end;
+  }
+  return (*str == 0) ? AFSR_OK : AFSR_INVALID;
+}
+
+static int ddsi_shmring_enumerate_interfaces (ddsi_tran_factory_t fact, enum ddsi_transport_selector transport_selector, ddsrt_ifaddrs_t **ifs)
+{
+  (void) fact; (void) transport_selector;
+  *ifs = NULL;
+  return DDS_RETCODE_UNSUPPORTED;
+}
+
+static int ddsi_shmring_is_valid_port (const struct ddsi_tran_factory *fact, uint32_t port)
+{
+  (void) fact; (void) port;
+  return 1;
+}
+
+static uint32_t ddsi_shmring_receive_buffer_size (const struct ddsi_tran_factory *fact_cmn)
+{
+  struct ddsi_shmring_tran_factory const * const fact = (const struct ddsi_shmring_tran_factory *) fact_cmn;
+  return fact->m_own.size;
+}
+
+static int ddsi_shmring_locator_from_sockaddr (const struct ddsi_tran_factory *tran, ddsi_locator_t *loc, const struct sockaddr *sockaddr)
+{
+  (void) tran; (void) loc; (void) sockaddr;
+  return -1;
+}
+
+static void ddsi_shmring_free_peer (void *vp, void *varg)
+{
+  struct shmring_peer *p = vp;
+  (void) varg;
+  assert (p->refc == 0);
+  shmring_unmap (&p->ring);
+  ddsrt_free (p);
+}
+
+static void ddsi_shmring_deinit (ddsi_tran_factory_t fact_cmn)
+{
+  struct ddsi_shmring_tran_factory * const fact = (struct ddsi_shmring_tran_factory *) fact_cmn;
+  char name[64];
+  shmring_name (name, sizeof (name), fact->m_nsid, fact->m_loc.port);
+  ddsrt_atomic_st32 (&fact->m_own.hdr->alive, 0);
+  (void) shm_unlink (name);
+  shmring_unmap (&fact->m_own);
+  shmring_release_idx (fact->m_loc.port & 0xff);
+  ddsrt_hh_enum (fact->m_peers, ddsi_shmring_free_peer, NULL);
+  ddsrt_hh_free (fact->m_peers);
+  ddsrt_mutex_destroy (&fact->m_lock);
+  DDS_CLOG (DDS_LC_CONFIG, &fact->m_base.gv->logconfig, "shmring de-initialized\n");
+  ddsrt_free (fact);
+}
+
+int ddsi_shmring_init (struct ddsi_domaingv *gv, ddsi_locator_t *loc)
+{
+  struct ddsi_shmring_tran_factory *fact;
+  uint32_t idx, nsid, size;
+  unsigned char hostid[16];
+
+  if ((uint32_t) getpid () >= (1u << 24))
+  {
+    GVERROR ("shmring: process id too large\n");
+    return -1;
+  }
+  if ((idx = shmring_claim_idx ()) == 0)
+  {
+    GVERROR ("shmring: too many domains in this process\n");
+    return -1;
+  }
+  size = SHMRING_MIN_SIZE;
+  while (size < gv->config.shmring_size && size < SHMRING_MAX_SIZE)
+    size *= 2;
+
+  shmring_host_id (hostid, &nsid, !gv->config.shmring_allow_other_users);
+  shmring_remove_stale (gv, nsid);
+
+  fact = ddsrt_malloc (sizeof (*fact));
+  memset (fact, 0, sizeof (*fact));
+  fact->m_nsid = nsid;
+  fact->m_loc.kind = NN_LOCATOR_KIND_SHMRING;
+  fact->m_loc.port = ((uint32_t) getpid () << 8) | idx;
+  memcpy (fact->m_loc.address, hostid, sizeof (fact->m_loc.address));
+  if (shmring_create (gv, &fact->m_own, nsid, fact->m_loc.port, size) < 0)
+  {
+    shmring_release_idx (idx);
+    ddsrt_free (fact);
+    return -1;
+  }
+  ddsrt_mutex_init (&fact->m_lock);
+  fact->m_peers = ddsrt_hh_new (1, shmring_peer_hash, shmring_peer_equal);
+
+  fact->m_base.gv = gv;
+  fact->m_base.m_free_fn = ddsi_shmring_deinit;
+  fact->m_base.m_typename = "shmring";
+  fact->m_base.m_default_spdp_address = NULL;
+  fact->m_base.m_connless = 1;
+  fact->m_base.m_enable_spdp = 0;
+  fact->m_base.m_supports_fn = ddsi_shmring_supports;
+  fact->m_base.m_create_conn_fn = ddsi_shmring_create_conn;
+  fact->m_base.m_release_conn_fn = ddsi_shmring_release_conn;
+  fact->m_base.m_join_mc_fn = 0;
+  fact->m_base.m_leave_mc_fn = 0;
+  fact->m_base.m_is_loopbackaddr_fn = ddsi_shmring_is_not;
+  fact->m_base.m_is_mcaddr_fn = ddsi_shmring_is_not;
+  fact->m_base.m_is_ssm_mcaddr_fn = ddsi_shmring_is_not;
+  fact->m_base.m_is_nearby_address_fn = ddsi_shmring_is_nearby_address;
+  fact->m_base.m_locator_from_string_fn = ddsi_shmring_address_from_string;
+  fact->m_base.m_locator_to_string_fn = ddsi_shmring_to_string;
+  fact->m_base.m_enumerate_interfaces_fn = ddsi_shmring_enumerate_interfaces;
+  fact->m_base.m_is_valid_port_fn = ddsi_shmring_is_valid_port;
+  fact->m_base.m_receive_buffer_size_fn = ddsi_shmring_receive_buffer_size;
+  fact->m_base.m_locator_from_sockaddr_fn = ddsi_shmring_locator_from_sockaddr;
+  ddsi_factory_add (gv, &fact->m_base);
+  *loc = fact->m_loc;
+  GVLOG (DDS_LC_CONFIG, "shmring initialized, ring size %"PRIu32"\n", size);
+  return 0;
+}
+
+#else
+
+int ddsi_shmring_init (struct ddsi_domaingv *gv, ddsi_locator_t *loc)
+{
+  (void) loc;
+  GVERROR ("shmring: not supported on this platform\n");
+  return -1;
+}
+
+bool ddsi_shmring_locator_usable (struct ddsi_tran_factory *fact, const ddsi_locator_t *loc)
+{
+  (void) fact;
+  (void) loc;
+  return false;
+}
+
+#endif /* defined __linux */
@@ -17,13 +17,16 @@
 #include "dds/ddsi/q_entity.h"
 #include "dds/ddsi/q_radmin.h"
 
-void ddsi_get_writer_stats (struct writer *wr, uint64_t * __restrict rexmit_bytes, uint32_t * __restrict throttle_count, uint64_t * __restrict time_throttled, uint64_t * __restrict time_retransmit)
+void ddsi_get_writer_stats (struct writer *wr, uint64_t * __restrict rexmit_bytes, uint32_t * __restrict throttle_count, uint64_t * __restrict time_throttled, uint64_t * __restrict time_retransmit, uint32_t * __restrict addrset_rebuild_count, uint64_t * __restrict time_addrset_rebuild, uint32_t * __restrict filtered_count)
 {
   ddsrt_mutex_lock (&wr->e.lock);
   *rexmit_bytes = wr->rexmit_bytes;
   *throttle_count = wr->throttle_count;
   *time_throttled = wr->time_throttled;
   *time_retransmit = wr->time_retransmit;
+  *addrset_rebuild_count = wr->addrset_rebuild_count;
+  *time_addrset_rebuild = wr->time_addrset_rebuild;
+  *filtered_count = wr->filtered_count;
   ddsrt_mutex_unlock (&wr->e.lock);
 }
 
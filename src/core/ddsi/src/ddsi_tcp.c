@@ -16,6 +16,8 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
 #include "dds/ddsrt/sockets.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/time.h"
 #include "ddsi_eth.h"
 #include "dds/ddsi/ddsi_tran.h"
 #include "dds/ddsi/ddsi_tcp.h"
@@ -24,6 +26,7 @@
 #include "dds/ddsi/q_config.h"
 #include "dds/ddsi/q_log.h"
 #include "dds/ddsi/q_entity.h"
+#include "dds/ddsi/q_thread.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_ssl.h"
 
@@ -38,8 +41,25 @@
   is not removed from cache but simply flagged as failed (may be subsequently
   replaced). Similarly server side sockets are not closed as are also used in socket
   wait set that manages their lifecycle.
+
+  With TCP/SendQueueSize set, whatever can't be written to the socket
+  immediately is appended to a per-connection queue of bounded size, and
+  connections with queued data are drained by a single "tcpsend" thread that
+  waits for the sockets to become writable.  That way a slow peer no longer
+  blocks the writes to all other peers.  Messages that don't fit are
+  dropped in their entirety, leaving recovery to the DDSI protocol.
 */
 
+#define SENDQ_MAX_IOV 64
+#define SENDQ_POLL_INTERVAL DDS_MSECS (10)
+
+struct ddsi_tcp_sendq_elem {
+  struct ddsi_tcp_sendq_elem *next;
+  size_t len;
+  size_t off; /* bytes already written */
+  unsigned char data[];
+};
+
 union addr {
   struct sockaddr a;
   struct sockaddr_in a4;
@@ -57,6 +77,15 @@ typedef struct ddsi_tcp_conn {
 #ifdef DDS_HAS_SSL
   SSL * m_ssl;
 #endif
+  /* Send queue, protected by m_mutex; m_sendq_listed is set while on the
+     factory's list of connections with queued data (which holds a
+     reference), m_sendq_failed once the tcpsend thread gave up */
+  struct ddsi_tcp_sendq_elem *m_sendq_first, *m_sendq_last;
+  size_t m_sendq_bytes;
+  ddsrt_mtime_t m_sendq_tprogress;
+  bool m_sendq_listed;
+  bool m_sendq_failed;
+  struct ddsi_tcp_conn *m_sendq_next;
 } *ddsi_tcp_conn_t;
 
 typedef struct ddsi_tcp_listener {
@@ -76,6 +105,16 @@ struct ddsi_tran_factory_tcp {
 #ifdef DDS_HAS_SSL
   struct ddsi_ssl_plugins ddsi_tcp_ssl_plugin;
 #endif
+  /* Asynchronous sending: limit per connection (0 if disabled), list of
+     connections with queued data and the thread draining them, created on
+     first use; sendq_nothread is set if creating it failed */
+  size_t sendq_max;
+  ddsrt_mutex_t sendq_lock;
+  ddsrt_cond_t sendq_cond;
+  struct ddsi_tcp_conn *sendq_conns;
+  struct thread_state1 *sendq_ts;
+  bool sendq_nothread;
+  bool sendq_stop;
 };
 
 static int ddsi_tcp_cmp_conn (const struct ddsi_tcp_conn *c1, const struct ddsi_tcp_conn *c2)
@@ -601,6 +640,286 @@ static void set_msghdr_iov (ddsrt_msghdr_t *mhdr, ddsrt_iovec_t *iov, size_t iov
   mhdr->msg_iovlen = (ddsrt_msg_iovlen_t)iovlen;
 }
 
+static dds_return_t ddsi_tcp_sendmsg_nonblocking (ddsi_tcp_conn_t conn, const ddsrt_msghdr_t *msg, ssize_t *sent)
+{
+  int sendflags = 0;
+  dds_return_t rc;
+#ifdef MSG_NOSIGNAL
+  sendflags |= MSG_NOSIGNAL;
+#endif
+  do {
+    rc = ddsrt_sendmsg (conn->m_sock, msg, sendflags, sent);
+  } while (rc == DDS_RETCODE_INTERRUPTED);
+  return rc;
+}
+
+static void ddsi_tcp_conn_unref (ddsi_tcp_conn_t conn)
+{
+  if (ddsrt_atomic_dec32_ov (&conn->m_base.m_count) == 1)
+    (conn->m_base.m_factory->m_release_conn_fn) (&conn->m_base);
+}
+
+static void ddsi_tcp_sendq_free (ddsi_tcp_conn_t conn)
+{
+  struct ddsi_tcp_sendq_elem *e;
+  while ((e = conn->m_sendq_first) != NULL)
+  {
+    conn->m_sendq_first = e->next;
+    ddsrt_free (e);
+  }
+  conn->m_sendq_last = NULL;
+  conn->m_sendq_bytes = 0;
+}
+
+static void ddsi_tcp_sendq_wait (ddsi_tcp_conn_t const *conns, size_t nconns)
+{
+  fd_set fds;
+  ddsrt_socket_t maxsock = 0;
+  int32_t ready;
+
+  FD_ZERO (&fds);
+  for (size_t i = 0; i < nconns; i++)
+  {
+#if LWIP_SOCKET == 1
+    DDSRT_WARNING_GNUC_OFF(sign-conversion)
+#endif
+    FD_SET (conns[i]->m_sock, &fds);
+#if LWIP_SOCKET == 1
+    DDSRT_WARNING_GNUC_ON(sign-conversion)
+#endif
+    if (conns[i]->m_sock > maxsock)
+      maxsock = conns[i]->m_sock;
+  }
+  /* Not waiting for new connections to be added: those are congested anyway
+     and get picked up after at most the poll interval */
+  (void) ddsrt_select (maxsock + 1, NULL, &fds, NULL, SENDQ_POLL_INTERVAL, &ready);
+}
+
+static void ddsi_tcp_sendq_drain (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn)
+{
+  struct ddsi_domaingv const * const gv = fact->fact.gv;
+  ddsrt_iovec_t iov[SENDQ_MAX_IOV];
+  ddsrt_msghdr_t msg;
+  dds_return_t rc = DDS_RETCODE_OK;
+  bool unlisted = false;
+
+  ddsrt_mutex_lock (&conn->m_mutex);
+  while (conn->m_sendq_first != NULL)
+  {
+    size_t niov = 0;
+    ssize_t sent;
+    for (struct ddsi_tcp_sendq_elem *e = conn->m_sendq_first; e != NULL && niov < SENDQ_MAX_IOV; e = e->next, niov++)
+    {
+      iov[niov].iov_base = e->data + e->off;
+      iov[niov].iov_len = (ddsrt_iov_len_t) (e->len - e->off);
+    }
+    memset (&msg, 0, sizeof (msg));
+    set_msghdr_iov (&msg, iov, niov);
+    if ((rc = ddsi_tcp_sendmsg_nonblocking (conn, &msg, &sent)) != DDS_RETCODE_OK)
+      break;
+    conn->m_sendq_tprogress = ddsrt_time_monotonic ();
+    conn->m_sendq_bytes -= (size_t) sent;
+    while (sent > 0)
+    {
+      struct ddsi_tcp_sendq_elem * const e = conn->m_sendq_first;
+      const size_t n = e->len - e->off;
+      if ((size_t) sent < n)
+      {
+        e->off += (size_t) sent;
+        break;
+      }
+      sent -= (ssize_t) n;
+      if ((conn->m_sendq_first = e->next) == NULL)
+        conn->m_sendq_last = NULL;
+      ddsrt_free (e);
+    }
+  }
+
+  if (rc == DDS_RETCODE_TRY_AGAIN)
+  {
+    const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+    if (tnow.v - conn->m_sendq_tprogress.v > gv->config.tcp_write_timeout)
+    {
+      GVWARNING ("tcp abandoning write on blocking socket %"PRIdSOCK" with %"PRIuSIZE" bytes queued\n", conn->m_sock, conn->m_sendq_bytes);
+      conn->m_sendq_failed = true;
+    }
+  }
+  else if (rc != DDS_RETCODE_OK)
+  {
+    GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" error %"PRId32"\n", conn->m_sock, rc);
+    conn->m_sendq_failed = true;
+  }
+  if (conn->m_sendq_failed)
+  {
+    /* The stream is broken if a message got cut short; shutting it down
+       makes the reader notice it and the next write removes it from the
+       cache, exactly as if a blocking write had failed */
+    ddsi_tcp_sendq_free (conn);
+    (void) shutdown (conn->m_sock, 2);
+  }
+  if (conn->m_sendq_first == NULL)
+  {
+    ddsi_tcp_conn_t *pconn;
+    ddsrt_mutex_lock (&fact->sendq_lock);
+    for (pconn = &fact->sendq_conns; *pconn != conn; pconn = &(*pconn)->m_sendq_next)
+      assert (*pconn != NULL);
+    *pconn = conn->m_sendq_next;
+    ddsrt_mutex_unlock (&fact->sendq_lock);
+    conn->m_sendq_listed = false;
+    unlisted = true;
+  }
+  ddsrt_mutex_unlock (&conn->m_mutex);
+  if (unlisted)
+    ddsi_tcp_conn_unref (conn);
+}
+
+static uint32_t ddsi_tcp_sendq_thread (void *varg)
+{
+  struct ddsi_tran_factory_tcp * const fact = varg;
+  ddsi_tcp_conn_t *conns = NULL;
+  size_t maxconns = 0;
+
+  ddsrt_mutex_lock (&fact->sendq_lock);
+  while (!fact->sendq_stop)
+  {
+    if (fact->sendq_conns == NULL)
+    {
+      ddsrt_cond_wait (&fact->sendq_cond, &fact->sendq_lock);
+      continue;
+    }
+    /* Only this thread removes connections from the list, so the snapshot
+       remains valid after releasing the lock */
+    size_t nconns = 0;
+    for (ddsi_tcp_conn_t c = fact->sendq_conns; c != NULL; c = c->m_sendq_next)
+    {
+      if (nconns == maxconns)
+      {
+        maxconns = (maxconns == 0) ? 8 : 2 * maxconns;
+        conns = ddsrt_realloc (conns, maxconns * sizeof (*conns));
+      }
+      conns[nconns++] = c;
+    }
+    ddsrt_mutex_unlock (&fact->sendq_lock);
+    ddsi_tcp_sendq_wait (conns, nconns);
+    for (size_t i = 0; i < nconns; i++)
+      ddsi_tcp_sendq_drain (fact, conns[i]);
+    ddsrt_mutex_lock (&fact->sendq_lock);
+  }
+  ddsrt_mutex_unlock (&fact->sendq_lock);
+  ddsrt_free (conns);
+  return 0;
+}
+
+static bool ddsi_tcp_sendq_start (struct ddsi_tran_factory_tcp *fact)
+{
+  struct ddsi_domaingv * const gv = fact->fact.gv;
+  bool running;
+  ddsrt_mutex_lock (&fact->sendq_lock);
+  if (fact->sendq_ts == NULL && !fact->sendq_nothread)
+  {
+    if (create_thread (&fact->sendq_ts, gv, "tcpsend", ddsi_tcp_sendq_thread, fact) != DDS_RETCODE_OK)
+    {
+      GVWARNING ("tcp: failed to create send thread, writes will block instead of being queued\n");
+      fact->sendq_ts = NULL;
+      fact->sendq_nothread = true;
+    }
+  }
+  running = (fact->sendq_ts != NULL);
+  ddsrt_mutex_unlock (&fact->sendq_lock);
+  return running;
+}
+
+enum ddsi_tcp_queued_write_result {
+  DTQW_OK,
+  DTQW_DROPPED,
+  DTQW_FAILED,
+  DTQW_NOTHREAD /* nothing queued, *sent bytes written, caller must write the rest */
+};
+
+static enum ddsi_tcp_queued_write_result ddsi_tcp_conn_write_queued (struct ddsi_tran_factory_tcp *fact, ddsi_tcp_conn_t conn, const ddsrt_msghdr_t *msg, size_t len, size_t *sent_out)
+{
+  struct ddsi_domaingv * const gv = fact->fact.gv;
+  size_t sent = 0;
+
+  if (conn->m_sendq_failed)
+    return DTQW_FAILED;
+
+  /* Queued data must go first, else usually the socket accepts it all */
+  if (conn->m_sendq_first == NULL)
+  {
+    dds_return_t rc;
+    ssize_t n;
+    if ((rc = ddsi_tcp_sendmsg_nonblocking (conn, msg, &n)) == DDS_RETCODE_OK)
+    {
+      if ((size_t) n == len)
+        return DTQW_OK;
+      sent = (size_t) n;
+    }
+    else if (rc != DDS_RETCODE_TRY_AGAIN)
+    {
+      GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" error %"PRId32"\n", conn->m_sock, rc);
+      return DTQW_FAILED;
+    }
+  }
+
+  /* Only a started send thread ever drains the queue, so without it the
+     queue is necessarily empty and the write can block instead */
+  if (!ddsi_tcp_sendq_start (fact))
+  {
+    *sent_out = sent;
+    return DTQW_NOTHREAD;
+  }
+
+  /* The remainder of a partially written message must be queued regardless
+     of the limit, or the framing would be lost */
+  const size_t rest = len - sent;
+  if (sent == 0 && conn->m_sendq_bytes + rest > fact->sendq_max)
+  {
+    GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" queue full, dropping %"PRIuSIZE" bytes\n", conn->m_sock, len);
+    return DTQW_DROPPED;
+  }
+
+  if (sent > 0)
+    GVLOG (DDS_LC_TCP, "tcp write: sock %"PRIdSOCK" partial write, queueing %"PRIuSIZE" of %"PRIuSIZE" bytes\n", conn->m_sock, rest, len);
+  struct ddsi_tcp_sendq_elem *e = ddsrt_malloc (sizeof (*e) + rest);
+  e->next = NULL;
+  e->len = rest;
+  e->off = 0;
+  size_t pos = 0, skip = sent;
+  for (size_t i = 0; i < (size_t) msg->msg_iovlen; i++)
+  {
+    const size_t n = msg->msg_iov[i].iov_len;
+    if (skip >= n)
+      skip -= n;
+    else
+    {
+      memcpy (e->data + pos, (const char *) msg->msg_iov[i].iov_base + skip, n - skip);
+      pos += n - skip;
+      skip = 0;
+    }
+  }
+  assert (pos == rest);
+  if (conn->m_sendq_last)
+    conn->m_sendq_last->next = e;
+  else
+    conn->m_sendq_first = e;
+  conn->m_sendq_last = e;
+  conn->m_sendq_bytes += rest;
+
+  if (!conn->m_sendq_listed)
+  {
+    conn->m_sendq_listed = true;
+    conn->m_sendq_tprogress = ddsrt_time_monotonic ();
+    ddsi_conn_add_ref (&conn->m_base);
+    ddsrt_mutex_lock (&fact->sendq_lock);
+    conn->m_sendq_next = fact->sendq_conns;
+    fact->sendq_conns = conn;
+    ddsrt_cond_signal (&fact->sendq_cond);
+    ddsrt_mutex_unlock (&fact->sendq_lock);
+  }
+  return DTQW_OK;
+}
+
 static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
 {
   struct ddsi_tran_factory_tcp * const fact = (struct ddsi_tran_factory_tcp *) base->m_factory;
@@ -662,6 +981,24 @@ static ssize_t ddsi_tcp_conn_write (ddsi_tran_conn_t base, const ddsi_locator_t
     return (ssize_t) len;
   }
 
+  if (fact->sendq_max > 0)
+  {
+    size_t sent = 0;
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    const enum ddsi_tcp_queued_write_result res = ddsi_tcp_conn_write_queued (fact, conn, &msg, len, &sent);
+    if (res != DTQW_NOTHREAD)
+    {
+      ddsrt_mutex_unlock (&conn->m_mutex);
+      if (res == DTQW_FAILED)
+        ddsi_tcp_cache_remove (conn);
+      return (res == DTQW_OK) ? (ssize_t) len : -1;
+    }
+    /* no send thread, so write the remainder blocking */
+    piecewise = 1;
+    ret = (ssize_t) sent;
+  }
+  else
 #ifdef DDS_HAS_SSL
   if (gv->config.ssl_enable)
   {
@@ -1014,6 +1351,8 @@ static void ddsi_tcp_conn_delete (ddsi_tcp_conn_t conn)
   {
     ddsi_tcp_sock_free (gv, conn->m_sock, "connection");
   }
+  assert (!conn->m_sendq_listed);
+  ddsi_tcp_sendq_free (conn);
   ddsrt_mutex_destroy (&conn->m_mutex);
   ddsrt_free (conn);
 }
@@ -1114,6 +1453,23 @@ static void ddsi_tcp_release_factory (struct ddsi_tran_factory *fact_cmn)
 {
   struct ddsi_tran_factory_tcp * const fact = (struct ddsi_tran_factory_tcp *) fact_cmn;
   struct ddsi_domaingv const * const gv = fact->fact.gv;
+  struct thread_state1 *sendq_ts;
+  ddsrt_mutex_lock (&fact->sendq_lock);
+  fact->sendq_stop = true;
+  ddsrt_cond_signal (&fact->sendq_cond);
+  sendq_ts = fact->sendq_ts;
+  ddsrt_mutex_unlock (&fact->sendq_lock);
+  if (sendq_ts)
+    join_thread (sendq_ts);
+  while (fact->sendq_conns)
+  {
+    ddsi_tcp_conn_t conn = fact->sendq_conns;
+    fact->sendq_conns = conn->m_sendq_next;
+    conn->m_sendq_listed = false;
+    ddsi_tcp_conn_unref (conn);
+  }
+  ddsrt_cond_destroy (&fact->sendq_cond);
+  ddsrt_mutex_destroy (&fact->sendq_lock);
   ddsrt_avl_free (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g, ddsi_tcp_node_free);
   ddsrt_mutex_destroy (&fact->ddsi_tcp_cache_lock_g);
 #ifdef DDS_HAS_SSL
@@ -1265,6 +1621,17 @@ int ddsi_tcp_init (struct ddsi_domaingv *gv)
 
   ddsrt_avl_init (&ddsi_tcp_treedef, &fact->ddsi_tcp_cache_g);
   ddsrt_mutex_init (&fact->ddsi_tcp_cache_lock_g);
+  ddsrt_mutex_init (&fact->sendq_lock);
+  ddsrt_cond_init (&fact->sendq_cond);
+  if (gv->config.tcp_send_queue_size > 0)
+  {
+#ifdef DDS_HAS_SSL
+    if (gv->config.ssl_enable)
+      GVLOG (DDS_LC_CONFIG, "tcp SendQueueSize ignored because SSL is enabled\n");
+    else
+#endif
+      fact->sendq_max = gv->config.tcp_send_queue_size;
+  }
 
   GVLOG (DDS_LC_CONFIG, "tcp initialized\n");
   return 0;
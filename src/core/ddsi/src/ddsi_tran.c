@@ -37,6 +37,10 @@ DDS_EXPORT extern inline int ddsi_listener_locator (ddsi_tran_listener_t listene
 DDS_EXPORT extern inline int ddsi_listener_listen (ddsi_tran_listener_t listener);
 DDS_EXPORT extern inline ddsi_tran_conn_t ddsi_listener_accept (ddsi_tran_listener_t listener);
 DDS_EXPORT extern inline ssize_t ddsi_conn_read (ddsi_tran_conn_t conn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc);
+DDS_EXPORT extern inline bool ddsi_conn_supports_read_multi (const struct ddsi_tran_conn *conn);
+DDS_EXPORT extern inline ssize_t ddsi_conn_read_multi (ddsi_tran_conn_t conn, size_t nbufs, struct ddsi_tran_recvbuf *bufs);
+DDS_EXPORT extern inline bool ddsi_conn_supports_write_multi (const struct ddsi_tran_conn *conn);
+DDS_EXPORT extern inline ssize_t ddsi_conn_write_multi (ddsi_tran_conn_t conn, size_t ndst, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags);
 DDS_EXPORT extern inline ssize_t ddsi_conn_write (ddsi_tran_conn_t conn, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags);
 
 void ddsi_factory_add (struct ddsi_domaingv *gv, ddsi_tran_factory_t factory)
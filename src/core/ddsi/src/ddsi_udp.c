@@ -61,6 +61,53 @@ static void addr_to_loc (const struct ddsi_tran_factory *tran, ddsi_locator_t *d
   ddsi_ipaddr_to_loc (dst, &src->a, (src->a.sa_family == AF_INET) ? NN_LOCATOR_KIND_UDPv4 : NN_LOCATOR_KIND_UDPv6);
 }
 
+static void ddsi_udp_conn_init_recv_msghdr (ddsrt_msghdr_t *msghdr, union addr *src, ddsrt_iovec_t *msg_iov, unsigned char *buf, size_t len)
+{
+  msg_iov->iov_base = (void *) buf;
+  msg_iov->iov_len = (ddsrt_iov_len_t) len; /* Windows uses unsigned, POSIX (except Linux) int */
+
+  msghdr->msg_name = &src->x;
+  msghdr->msg_namelen = (socklen_t) sizeof (*src);
+  msghdr->msg_iov = msg_iov;
+  msghdr->msg_iovlen = 1;
+#if defined(__sun) && !defined(_XPG4_2)
+  msghdr->msg_accrights = NULL;
+  msghdr->msg_accrightslen = 0;
+#else
+  msghdr->msg_control = NULL;
+  msghdr->msg_controllen = 0;
+#endif
+}
+
+static void ddsi_udp_conn_check_received (ddsi_udp_conn_t conn, const ddsrt_msghdr_t *msghdr, const union addr *src, unsigned char *buf, size_t len, ssize_t ret)
+{
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  if (gv->pcap_fp)
+  {
+    union addr dest;
+    socklen_t dest_len = sizeof (dest);
+    if (ddsrt_getsockname (conn->m_sock, &dest.a, &dest_len) != DDS_RETCODE_OK)
+      memset (&dest, 0, sizeof (dest));
+    write_pcap_received (gv, ddsrt_time_wallclock (), &src->x, &dest.x, buf, (size_t) ret);
+  }
+
+  /* Check for udp packet truncation */
+#if DDSRT_MSGHDR_FLAGS
+  const bool trunc_flag = (msghdr->msg_flags & MSG_TRUNC) != 0;
+#else
+  const bool trunc_flag = false;
+  (void) msghdr;
+#endif
+  if ((size_t) ret > len || trunc_flag)
+  {
+    char addrbuf[DDSI_LOCSTRLEN];
+    ddsi_locator_t tmp;
+    addr_to_loc (conn->m_base.m_factory, &tmp, src);
+    ddsi_locator_to_string (addrbuf, sizeof (addrbuf), &tmp);
+    GVWARNING ("%s => %d truncated to %d\n", addrbuf, (int) ret, (int) len);
+  }
+}
+
 static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * buf, size_t len, bool allow_spurious, ddsi_locator_t *srcloc)
 {
   ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
@@ -70,23 +117,9 @@ static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * bu
   ddsrt_msghdr_t msghdr;
   union addr src;
   ddsrt_iovec_t msg_iov;
-  socklen_t srclen = (socklen_t) sizeof (src);
   (void) allow_spurious;
 
-  msg_iov.iov_base = (void *) buf;
-  msg_iov.iov_len = (ddsrt_iov_len_t) len; /* Windows uses unsigned, POSIX (except Linux) int */
-
-  msghdr.msg_name = &src.x;
-  msghdr.msg_namelen = srclen;
-  msghdr.msg_iov = &msg_iov;
-  msghdr.msg_iovlen = 1;
-#if defined(__sun) && !defined(_XPG4_2)
-  msghdr.msg_accrights = NULL;
-  msghdr.msg_accrightslen = 0;
-#else
-  msghdr.msg_control = NULL;
-  msghdr.msg_controllen = 0;
-#endif
+  ddsi_udp_conn_init_recv_msghdr (&msghdr, &src, &msg_iov, buf, len);
 
   do {
     rc = ddsrt_recvmsg (conn->m_sock, &msghdr, 0, &ret);
@@ -96,32 +129,9 @@ static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * bu
   {
     if (srcloc)
       addr_to_loc (conn->m_base.m_factory, srcloc, &src);
-
-    if (gv->pcap_fp)
-    {
-      union addr dest;
-      socklen_t dest_len = sizeof (dest);
-      if (ddsrt_getsockname (conn->m_sock, &dest.a, &dest_len) != DDS_RETCODE_OK)
-        memset (&dest, 0, sizeof (dest));
-      write_pcap_received (gv, ddsrt_time_wallclock (), &src.x, &dest.x, buf, (size_t) ret);
-    }
-
-    /* Check for udp packet truncation */
-#if DDSRT_MSGHDR_FLAGS
-    const bool trunc_flag = (msghdr.msg_flags & MSG_TRUNC) != 0;
-#else
-    const bool trunc_flag = false;
-#endif
-    if ((size_t) ret > len || trunc_flag)
-    {
-      char addrbuf[DDSI_LOCSTRLEN];
-      ddsi_locator_t tmp;
-      addr_to_loc (conn->m_base.m_factory, &tmp, &src);
-      ddsi_locator_to_string (addrbuf, sizeof (addrbuf), &tmp);
-      GVWARNING ("%s => %d truncated to %d\n", addrbuf, (int) ret, (int) len);
-    }
+    ddsi_udp_conn_check_received (conn, &msghdr, &src, buf, len, ret);
   }
-  else if (rc != DDS_RETCODE_BAD_PARAMETER && rc != DDS_RETCODE_NO_CONNECTION)
+  else if (rc != DDS_RETCODE_BAD_PARAMETER && rc != DDS_RETCODE_NO_CONNECTION && rc != DDS_RETCODE_TRY_AGAIN)
   {
     GVERROR ("UDP recvmsg sock %d: ret %d retcode %"PRId32"\n", (int) conn->m_sock, (int) ret, rc);
     ret = -1;
@@ -129,6 +139,51 @@ static ssize_t ddsi_udp_conn_read (ddsi_tran_conn_t conn_cmn, unsigned char * bu
   return ret;
 }
 
+#define DDSI_UDP_MAX_READ_MULTI 64
+
+static ssize_t ddsi_udp_conn_read_multi (ddsi_tran_conn_t conn_cmn, size_t nbufs, struct ddsi_tran_recvbuf *bufs)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  ddsrt_msghdr_t msghdrs[DDSI_UDP_MAX_READ_MULTI];
+  union addr srcs[DDSI_UDP_MAX_READ_MULTI];
+  ddsrt_iovec_t msg_iovs[DDSI_UDP_MAX_READ_MULTI];
+  ssize_t rcvd[DDSI_UDP_MAX_READ_MULTI];
+  size_t nrcvd = 0;
+  dds_return_t rc;
+
+  assert (nbufs > 0);
+  if (nbufs > DDSI_UDP_MAX_READ_MULTI)
+    nbufs = DDSI_UDP_MAX_READ_MULTI;
+  for (size_t i = 0; i < nbufs; i++)
+    ddsi_udp_conn_init_recv_msghdr (&msghdrs[i], &srcs[i], &msg_iovs[i], bufs[i].buf, bufs[i].len);
+
+  do {
+    rc = ddsrt_recvmmsg (conn->m_sock, msghdrs, rcvd, nbufs, 0, &nrcvd);
+  } while (rc == DDS_RETCODE_INTERRUPTED);
+
+  if (rc != DDS_RETCODE_OK)
+  {
+    if (rc == DDS_RETCODE_BAD_PARAMETER || rc == DDS_RETCODE_NO_CONNECTION || rc == DDS_RETCODE_TRY_AGAIN)
+      return 0;
+    GVERROR ("UDP recvmmsg sock %d: retcode %"PRId32"\n", (int) conn->m_sock, rc);
+    return -1;
+  }
+
+  /* Empty datagrams (e.g., the ones used for waking up the receive thread)
+     are returned with size 0 and left for the caller to skip */
+  for (size_t i = 0; i < nrcvd; i++)
+  {
+    bufs[i].size = rcvd[i];
+    if (rcvd[i] > 0)
+    {
+      addr_to_loc (conn->m_base.m_factory, &bufs[i].srcloc, &srcs[i]);
+      ddsi_udp_conn_check_received (conn, &msghdrs[i], &srcs[i], bufs[i].buf, bufs[i].len, rcvd[i]);
+    }
+  }
+  return (ssize_t) nrcvd;
+}
+
 static void set_msghdr_iov (ddsrt_msghdr_t *mhdr, const ddsrt_iovec_t *iov, size_t iovlen)
 {
   mhdr->msg_iov = (ddsrt_iovec_t *) iov;
@@ -192,6 +247,79 @@ static ssize_t ddsi_udp_conn_write (ddsi_tran_conn_t conn_cmn, const ddsi_locato
   return (rc == DDS_RETCODE_OK) ? ret : -1;
 }
 
+#if DDSRT_HAVE_SENDMMSG
+#define DDSI_UDP_MAX_WRITE_MULTI 64
+
+static ssize_t ddsi_udp_conn_write_multi (ddsi_tran_conn_t conn_cmn, size_t ndst, const ddsi_locator_t *dst, size_t niov, const ddsrt_iovec_t *iov, uint32_t flags)
+{
+  ddsi_udp_conn_t conn = (ddsi_udp_conn_t) conn_cmn;
+  struct ddsi_domaingv * const gv = conn->m_base.m_base.gv;
+  ddsrt_msghdr_t msgs[DDSI_UDP_MAX_WRITE_MULTI];
+  union addr dstaddrs[DDSI_UDP_MAX_WRITE_MULTI];
+  ssize_t sent[DDSI_UDP_MAX_WRITE_MULTI];
+  ssize_t total = 0;
+  bool any_sent = false;
+  int sendflags = 0;
+  assert (niov <= INT_MAX);
+#if MSG_NOSIGNAL && !LWIP_SOCKET
+  sendflags |= MSG_NOSIGNAL;
+#endif
+  while (ndst > 0)
+  {
+    const size_t n = (ndst < DDSI_UDP_MAX_WRITE_MULTI) ? ndst : DDSI_UDP_MAX_WRITE_MULTI;
+    size_t off = 0;
+    unsigned retry = 2;
+    for (size_t i = 0; i < n; i++)
+    {
+      ddsi_ipaddr_from_loc (&dstaddrs[i].x, &dst[i]);
+      set_msghdr_iov (&msgs[i], iov, niov);
+      msgs[i].msg_name = &dstaddrs[i].x;
+      msgs[i].msg_namelen = (socklen_t) ddsrt_sockaddr_get_size (&dstaddrs[i].a);
+      msgs[i].msg_control = NULL;
+      msgs[i].msg_controllen = 0;
+      msgs[i].msg_flags = (int) flags;
+    }
+    while (off < n)
+    {
+      size_t nsent;
+      dds_return_t rc = ddsrt_sendmmsg (conn->m_sock, msgs + off, sent + off, n - off, sendflags, &nsent);
+      for (size_t i = off; i < off + nsent; i++)
+      {
+        total += sent[i];
+        if (gv->pcap_fp)
+        {
+          union addr sa;
+          socklen_t alen = sizeof (sa);
+          if (ddsrt_getsockname (conn->m_sock, &sa.a, &alen) != DDS_RETCODE_OK)
+            memset (&sa, 0, sizeof (sa));
+          write_pcap_sent (gv, ddsrt_time_wallclock (), &sa.x, &msgs[i], (size_t) sent[i]);
+        }
+      }
+      any_sent = any_sent || (nsent > 0);
+      off += nsent;
+      if (rc == DDS_RETCODE_OK || rc == DDS_RETCODE_INTERRUPTED || rc == DDS_RETCODE_TRY_AGAIN)
+        continue;
+      else if (rc == DDS_RETCODE_NOT_ALLOWED && retry-- > 0)
+        continue;
+      else
+      {
+        /* skip the destination that failed, same error handling as for a single write */
+        if (rc != DDS_RETCODE_NOT_ALLOWED && rc != DDS_RETCODE_NO_CONNECTION)
+        {
+          char locbuf[DDSI_LOCSTRLEN];
+          GVERROR ("ddsi_udp_conn_write_multi to %s failed with retcode %"PRId32"\n", ddsi_locator_to_string (locbuf, sizeof (locbuf), &dst[off]), rc);
+        }
+        off++;
+        retry = 2;
+      }
+    }
+    dst += n;
+    ndst -= n;
+  }
+  return any_sent ? total : -1;
+}
+#endif
+
 static void ddsi_udp_disable_multiplexing (ddsi_tran_conn_t conn_cmn)
 {
 #if defined _WIN32 && !defined WINCE
@@ -414,6 +542,23 @@ static dds_return_t set_mc_options_transmit_ipv4 (struct ddsi_domaingv const * c
   return DDS_RETCODE_OK;
 }
 
+static dds_return_t set_shared_port_rcvtimeo (struct ddsi_domaingv const * const gv, ddsrt_socket_t sock)
+{
+  /* The kernel picks the socket that receives a packet from the sockets sharing a
+     port by hashing the addresses, so sending a packet to the port is not a reliable
+     way of waking up all receive threads at termination.  A receive timeout ensures
+     they all notice the termination within a reasonable time regardless. */
+#if defined _WIN32 && !defined WINCE
+  const DWORD tmo = 100;
+#else
+  const struct timeval tmo = { .tv_sec = 0, .tv_usec = 100000 };
+#endif
+  dds_return_t rc;
+  if ((rc = ddsrt_setsockopt (sock, SOL_SOCKET, SO_RCVTIMEO, &tmo, sizeof (tmo))) != DDS_RETCODE_OK)
+    GVERROR ("ddsi_udp_create_conn: set SO_RCVTIMEO failed: %s\n", dds_strretcode (rc));
+  return rc;
+}
+
 static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_factory_t fact_cmn, uint32_t port, const ddsi_tran_qos_t *qos)
 {
   struct ddsi_udp_tran_factory *fact = (struct ddsi_udp_tran_factory *) fact_cmn;
@@ -440,7 +585,7 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
       purpose_str = "transmit(uc/mc)";
       break;
     case DDSI_TRAN_QOS_RECV_UC:
-      reuse_addr = false;
+      reuse_addr = qos->m_shared_port;
       bind_to_any = true;
       set_mc_xmit_options = false;
       purpose_str = "unicast";
@@ -498,6 +643,9 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
     }
   }
 
+  if (qos->m_shared_port && (rc = set_shared_port_rcvtimeo (gv, sock)) != DDS_RETCODE_OK)
+    goto fail_w_socket;
+
   if ((rc = set_rcvbuf (gv, sock, &gv->config.socket_rcvbuf_size)) < 0)
     goto fail_w_socket;
   if (rc > 0) {
@@ -519,7 +667,7 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
   {
     /* PRECONDITION_NOT_MET (= EADDRINUSE) is expected if reuse_addr isn't set, should be handled at
        a higher level and therefore needs to return a specific error message */
-    if (!reuse_addr && rc == DDS_RETCODE_PRECONDITION_NOT_MET)
+    if ((!reuse_addr || qos->m_shared_port) && rc == DDS_RETCODE_PRECONDITION_NOT_MET)
       goto fail_addrinuse;
 
     char buf[DDSI_LOCSTRLEN];
@@ -567,7 +715,11 @@ static dds_return_t ddsi_udp_create_conn (ddsi_tran_conn_t *conn_out, ddsi_tran_
   conn->m_base.m_base.m_handle_fn = ddsi_udp_conn_handle;
 
   conn->m_base.m_read_fn = ddsi_udp_conn_read;
+  conn->m_base.m_read_multi_fn = ddsi_udp_conn_read_multi;
   conn->m_base.m_write_fn = ddsi_udp_conn_write;
+#if DDSRT_HAVE_SENDMMSG
+  conn->m_base.m_write_multi_fn = ddsi_udp_conn_write_multi;
+#endif
   conn->m_base.m_disable_multiplexing_fn = ddsi_udp_disable_multiplexing;
   conn->m_base.m_locator_fn = ddsi_udp_conn_locator;
 
@@ -22,6 +22,7 @@
 #include "dds/ddsi/ddsi_entity_index.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/ddsi/ddsi_wraddrset.h"
+#include "dds/ddsi/ddsi_shmring.h"
 
 #include "dds/ddsi/ddsi_udp.h" /* nn_mc4gen_address_t */
 
@@ -187,19 +188,51 @@ static void locset_free (struct locset *ls)
   ddsrt_free (ls);
 }
 
-static struct addrset *wras_collect_all_locs (const struct writer *wr)
+// Iterating over the readers for which the address set is computed: either all
+// matched proxy readers of the writer, or (if only != NULL) just that one
+struct wras_reader_iter {
+  const struct writer *wr;
+  const struct proxy_reader *only;
+  bool done;
+  ddsrt_avl_iter_t it;
+};
+
+static const struct proxy_reader *wras_reader_iter_next (struct wras_reader_iter *it)
 {
-  struct entity_index * const gh = wr->e.gv->entity_index;
-  struct addrset *all_addrs = new_addrset ();
+  struct entity_index * const gh = it->wr->e.gv->entity_index;
   struct wr_prd_match *m;
-  ddsrt_avl_iter_t it;
-  for (m = ddsrt_avl_iter_first (&wr_readers_treedef, &wr->readers, &it); m; m = ddsrt_avl_iter_next (&it))
+  if (it->only)
+  {
+    const struct proxy_reader *prd = it->done ? NULL : it->only;
+    it->done = true;
+    return prd;
+  }
+  m = it->done ? ddsrt_avl_iter_next (&it->it) : ddsrt_avl_iter_first (&wr_readers_treedef, &it->wr->readers, &it->it);
+  it->done = true;
+  for (; m; m = ddsrt_avl_iter_next (&it->it))
   {
     struct proxy_reader *prd;
-    if ((prd = entidx_lookup_proxy_reader_guid (gh, &m->prd_guid)) == NULL)
-      continue;
-    copy_addrset_into_addrset (wr->e.gv, all_addrs, prd->c.as);
+    if ((prd = entidx_lookup_proxy_reader_guid (gh, &m->prd_guid)) != NULL)
+      return prd;
   }
+  return NULL;
+}
+
+static void wras_reader_iter_init (struct wras_reader_iter *it, const struct writer *wr, const struct proxy_reader *only)
+{
+  it->wr = wr;
+  it->only = only;
+  it->done = false;
+}
+
+static struct addrset *wras_collect_all_locs (const struct writer *wr, const struct proxy_reader *only)
+{
+  struct addrset *all_addrs = new_addrset ();
+  struct wras_reader_iter it;
+  const struct proxy_reader *prd;
+  wras_reader_iter_init (&it, wr, only);
+  while ((prd = wras_reader_iter_next (&it)) != NULL)
+    copy_addrset_into_addrset (wr->e.gv, all_addrs, prd->c.as);
   if (!addrset_empty (all_addrs))
   {
 #ifdef DDS_HAS_SSM
@@ -323,9 +356,10 @@ static cost_t sat_cost_add (cost_t x, int32_t a)
     return (x < INT32_MIN - a) ? INT32_MIN : x + a;
 }
 
-static readercount_cost_t calc_locator_cost (const struct cover *c, int lidx, bool prefer_multicast, dds_locator_mask_t ignore)
+static readercount_cost_t calc_locator_cost (const struct cover *c, const ddsi_xlocator_t *l, int lidx, bool prefer_multicast, dds_locator_mask_t ignore)
 {
   const int32_t cost_uc  = prefer_multicast ? 1000000 : 2;
+  const int32_t cost_shmring = cost_uc - 1; // same-host unicast without the network stack beats loopback
   const int32_t cost_mc  = prefer_multicast ? 1 : 3;
   const int32_t cost_ssm = prefer_multicast ? 0 : 2;
   const int32_t cost_non_loopback = 2;
@@ -354,6 +388,13 @@ static readercount_cost_t calc_locator_cost (const struct cover *c, int lidx, bo
     else
       goto no_readers;
   }
+  else if (l->c.kind == NN_LOCATOR_KIND_SHMRING)
+  {
+    // a dead ring drops messages, the readers have other locators as well
+    if (!ddsi_shmring_locator_usable (l->conn->m_factory, &l->c))
+      goto no_readers;
+    x.cost += cost_shmring;
+  }
   else if ((ci & CI_MULTICAST_MASK) == 0)
     x.cost += cost_uc;
   else if (((ci & CI_MULTICAST_MASK) >> CI_MULTICAST_SHIFT) == CI_MULTICAST_SSM)
@@ -496,27 +537,25 @@ static bool wras_cover_locatorset (struct ddsi_domaingv const * const gv, struct
   return true;
 }
 
-static bool wras_calc_cover (const struct writer *wr, const struct locset *locs, struct cover **pcov) ddsrt_attribute_warn_unused_result;
+static bool wras_calc_cover (const struct writer *wr, const struct proxy_reader *only, const struct locset *locs, struct cover **pcov) ddsrt_attribute_warn_unused_result;
 
-static bool wras_calc_cover (const struct writer *wr, const struct locset *locs, struct cover **pcov)
+static bool wras_calc_cover (const struct writer *wr, const struct proxy_reader *only, const struct locset *locs, struct cover **pcov)
 {
   struct ddsi_domaingv * const gv = wr->e.gv;
-  struct entity_index * const gh = gv->entity_index;
-  ddsrt_avl_iter_t it;
+  struct wras_reader_iter it;
   const bool want_rdnames = true;
   // allocate cover matrix, it needs to be grow if there are readers requesting redundant delivery
   // (but that's rare enough to be ok with reallocating it for now)
-  struct cover *cov = cover_new ((int) wr->num_readers, locs->nlocs, want_rdnames);
+  struct cover *cov = cover_new (only ? 1 : (int) wr->num_readers, locs->nlocs, want_rdnames);
   struct locset *work_locs = locset_new (locs->nlocs);
   int rdidx = 0;
   char rdletter = 'a', rddigit = '0';
-  for (struct wr_prd_match *m = ddsrt_avl_iter_first (&wr_readers_treedef, &wr->readers, &it); m; m = ddsrt_avl_iter_next (&it))
+  const struct proxy_reader *prd;
+  wras_reader_iter_init (&it, wr, only);
+  while ((prd = wras_reader_iter_next (&it)) != NULL)
   {
-    struct proxy_reader *prd;
     struct addrset *ass[] = { NULL, NULL, NULL };
     bool increment_rdidx = true;
-    if ((prd = entidx_lookup_proxy_reader_guid (gh, &m->prd_guid)) == NULL)
-      continue;
     ass[0] = prd->c.as;
 #ifdef DDS_HAS_SSM
     if (prd->favours_ssm && wr->supports_ssm)
@@ -599,12 +638,13 @@ addrset_changed:
   return false;
 }
 
-static struct costmap *wras_calc_costmap (const struct cover *covered, bool prefer_multicast, dds_locator_mask_t ignore)
+static struct costmap *wras_calc_costmap (const struct cover *covered, const struct locset *locs, bool prefer_multicast, dds_locator_mask_t ignore)
 {
   const int nlocs = cover_get_nlocs (covered);
   struct costmap *wm = costmap_new (nlocs);
+  assert (nlocs == locs->nlocs);
   for (int i = 0; i < nlocs; i++)
-    costmap_set (wm, i, calc_locator_cost (covered, i, prefer_multicast, ignore));
+    costmap_set (wm, i, calc_locator_cost (covered, &locs->locs[i], i, prefer_multicast, ignore));
   return wm;
 }
 
@@ -758,7 +798,7 @@ static void wras_drop_covered_readers (int locidx, struct costmap *wm, struct co
 #endif
 }
 
-struct addrset *compute_writer_addrset (const struct writer *wr)
+static struct addrset *wras_compute (const struct writer *wr, const struct proxy_reader *only)
 {
   struct ddsi_domaingv * const gv = wr->e.gv;
   const bool prefer_multicast = gv->config.prefer_multicast;
@@ -769,7 +809,7 @@ struct addrset *compute_writer_addrset (const struct writer *wr)
   // Gather all addresses, using an addrset means no need to worry about
   // duplicates. If no addresses found it is trivial.
   {
-    struct addrset *all_addrs = wras_collect_all_locs (wr);
+    struct addrset *all_addrs = wras_collect_all_locs (wr, only);
     if (addrset_empty (all_addrs))
       return all_addrs;
     nn_log_addrset (gv, DDS_LC_DISCOVERY, "setcover: all_addrs", all_addrs);
@@ -778,7 +818,7 @@ struct addrset *compute_writer_addrset (const struct writer *wr)
     unref_addrset (all_addrs);
   }
 
-  if (!wras_calc_cover (wr, locs, &covered))
+  if (!wras_calc_cover (wr, only, locs, &covered))
   {
     // Addrset computation fails when some proxy reader's address can't be found in all_addrs,
     // which means its address set changed while we were working.  In that case, the change
@@ -786,6 +826,12 @@ struct addrset *compute_writer_addrset (const struct writer *wr)
     //
     // FIXME: copying it is a bit excessive (a little rework and refcount manipulation suffices)
     newas = ref_addrset (wr->as);
+    if (only)
+    {
+      // ... but that doesn't cover the new reader, so a full recalculation is required
+      unref_addrset (newas);
+      newas = NULL;
+    }
   }
   else if (covered == NULL)
   {
@@ -795,7 +841,7 @@ struct addrset *compute_writer_addrset (const struct writer *wr)
   else
   {
     assert(wr->xqos->present & QP_LOCATOR_MASK);
-    struct costmap *wm = wras_calc_costmap (covered, prefer_multicast, wr->xqos->ignore_locator_type);
+    struct costmap *wm = wras_calc_costmap (covered, locs, prefer_multicast, wr->xqos->ignore_locator_type);
     int best;
     newas = new_addrset ();
     while ((best = wras_choose_locator (locs, wm)) >= 0)
@@ -811,3 +857,39 @@ struct addrset *compute_writer_addrset (const struct writer *wr)
   locset_free (locs);
   return newas;
 }
+
+struct addrset *compute_writer_addrset (const struct writer *wr)
+{
+  return wras_compute (wr, NULL);
+}
+
+static ssize_t wras_in_writer_addrset (const ddsi_xlocator_t *loc, void *varg)
+{
+  const struct addrset *as = varg;
+  return addrset_contains (as, loc);
+}
+
+struct addrset *compute_writer_addrset_add_reader (const struct writer *wr, const struct proxy_reader *prd)
+{
+  // A reader that can be reached via an address already in the set needs
+  // nothing more, except when it requests delivery over all its interfaces
+  // or prefers SSM (and these are rare enough not to bother optimising)
+  bool redundant_or_ssm = prd->redundant_networking;
+#ifdef DDS_HAS_SSM
+  redundant_or_ssm = redundant_or_ssm || (prd->favours_ssm && wr->supports_ssm);
+#endif
+  if (!redundant_or_ssm && addrset_forone (prd->c.as, wras_in_writer_addrset, wr->as) == 0)
+    return ref_addrset (wr->as);
+
+  // Otherwise add the addresses that would be selected for this reader alone,
+  // that may be a sub-optimal choice given the other readers, but it doesn't
+  // require looking at them
+  struct addrset *rdas, *newas;
+  if ((rdas = wras_compute (wr, prd)) == NULL)
+    return NULL;
+  newas = new_addrset ();
+  copy_addrset_into_addrset (wr->e.gv, newas, wr->as);
+  copy_addrset_into_addrset (wr->e.gv, newas, rdas);
+  unref_addrset (rdas);
+  return newas;
+}
@@ -370,6 +370,16 @@ void remove_from_addrset (const struct ddsi_domaingv *gv, struct addrset *as, co
   UNLOCK (as);
 }
 
+int addrset_contains (const struct addrset *as, const ddsi_xlocator_t *loc)
+{
+  int found;
+  LOCK (as);
+  found = (ddsrt_avl_clookup (&addrset_treedef, &as->ucaddrs, loc) != NULL ||
+           ddsrt_avl_clookup (&addrset_treedef, &as->mcaddrs, loc) != NULL);
+  UNLOCK (as);
+  return found;
+}
+
 void copy_addrset_into_addrset_uc (const struct ddsi_domaingv *gv, struct addrset *as, const struct addrset *asadd)
 {
   struct addrset_node *n;
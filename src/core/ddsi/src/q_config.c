@@ -20,6 +20,7 @@
 
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
+#include "dds/ddsrt/log_binary.h"
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/strtod.h"
 #include "dds/ddsrt/misc.h"
@@ -183,6 +184,9 @@ DUPF(bandwidth);
 DUPF(domainId);
 DUPF(transport_selector);
 DUPF(many_sockets_mode);
+DUPF(trace_output_format);
+DUPF(timed_event_queue);
+DUPF(whc_seq_index);
 DU(deaf_mute);
 #ifdef DDS_HAS_SSL
 DUPF(min_tls_version);
@@ -973,6 +977,18 @@ static const enum ddsi_many_sockets_mode en_many_sockets_mode_ms[] = {
   DDSI_MSM_SINGLE_UNICAST, DDSI_MSM_NO_UNICAST, DDSI_MSM_MANY_UNICAST, DDSI_MSM_SINGLE_UNICAST, DDSI_MSM_MANY_UNICAST, 0 };
 GENERIC_ENUM_CTYPE (many_sockets_mode, enum ddsi_many_sockets_mode)
 
+static const char *en_trace_output_format_vs[] = { "text", "binary", NULL };
+static const enum ddsi_trace_output_format en_trace_output_format_ms[] = { DDSI_TRACE_TEXT, DDSI_TRACE_BINARY, 0 };
+GENERIC_ENUM_CTYPE (trace_output_format, enum ddsi_trace_output_format)
+
+static const char *en_timed_event_queue_vs[] = { "heap", "wheel", NULL };
+static const enum ddsi_timed_event_queue en_timed_event_queue_ms[] = { DDSI_TEVQ_HEAP, DDSI_TEVQ_WHEEL, 0 };
+GENERIC_ENUM_CTYPE (timed_event_queue, enum ddsi_timed_event_queue)
+
+static const char *en_whc_seq_index_vs[] = { "hash", "ring", NULL };
+static const enum ddsi_whc_seq_index en_whc_seq_index_ms[] = { DDSI_WHC_SEQIDX_HASH, DDSI_WHC_SEQIDX_RING, 0 };
+GENERIC_ENUM_CTYPE (whc_seq_index, enum ddsi_whc_seq_index)
+
 static const char *en_standards_conformance_vs[] = { "pedantic", "strict", "lax", NULL };
 static const enum ddsi_standards_conformance en_standards_conformance_ms[] = { DDSI_SC_PEDANTIC, DDSI_SC_STRICT, DDSI_SC_LAX, 0 };
 GENERIC_ENUM_CTYPE (standards_conformance, enum ddsi_standards_conformance)
@@ -2475,6 +2491,8 @@ void config_fini (struct cfgst *cfgst)
   free_all_elements (cfgst, cfgst->cfg, root_cfgelems);
   dds_set_log_file (stderr);
   dds_set_trace_file (stderr);
+  /* binary tracing gets stopped by rtps_fini */
+  assert (cfgst->cfg->tracebin == NULL);
   if (cfgst->cfg->tracefp && cfgst->cfg->tracefp != stdout && cfgst->cfg->tracefp != stderr) {
     fclose(cfgst->cfg->tracefp);
   }
@@ -22,6 +22,7 @@
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/avl.h"
 #include "dds/ddsrt/string.h"
+#include "dds/ddsrt/mh3.h"
 #include "dds/ddsi/q_protocol.h"
 #include "dds/ddsi/q_rtps.h"
 #include "dds/ddsi/q_misc.h"
@@ -46,6 +47,7 @@
 #include "dds/ddsi/q_feature_check.h"
 #include "dds/ddsi/ddsi_security_omg.h"
 #include "dds/ddsi/ddsi_pmd.h"
+#include "dds/ddsi/ddsi_shmring.h"
 #ifdef DDS_HAS_SECURITY
 #include "dds/ddsi/ddsi_security_exchange.h"
 #endif
@@ -430,6 +432,10 @@ void get_participant_builtin_topic_data (const struct participant *pp, ddsi_plis
       locators_add_one (&def_uni, &pp->e.gv->interfaces[i].extloc, data_port);
       locators_add_one (&meta_uni, &pp->e.gv->interfaces[i].extloc, meta_port);
     }
+    // the shared-memory ring is only for data, and peers on other machines will ignore it;
+    // once it is dead it is no longer advertised
+    if (pp->e.gv->shmring_conn && ddsi_shmring_locator_usable (pp->e.gv->shmring_conn->m_factory, &pp->e.gv->loc_shmring))
+      locators_add_one (&def_uni, &pp->e.gv->loc_shmring, NN_LOCATOR_PORT_INVALID);
     if (pp->e.gv->config.publish_uc_locators)
     {
       dst->present |= PP_DEFAULT_UNICAST_LOCATOR | PP_METATRAFFIC_UNICAST_LOCATOR;
@@ -1158,6 +1164,15 @@ static int sedp_write_endpoint_impl
         ps.present |= PP_CYCLONE_REQUESTS_KEYHASH;
         ps.cyclone_requests_keyhash = 1u;
       }
+      if (rd->content_filter)
+      {
+        ps.present |= PP_CONTENT_FILTER_PROPERTY;
+        ps.aliased |= PP_CONTENT_FILTER_PROPERTY;
+        ps.content_filter_property = *rd->content_filter;
+        /* the sequence buffer is always owned by the plist, only the strings are aliased */
+        ps.content_filter_property.expression_parameters.strs =
+          ddsrt_memdup (rd->content_filter->expression_parameters.strs, rd->content_filter->expression_parameters.n * sizeof (char *));
+      }
     }
 
 #ifdef DDS_HAS_SSM
@@ -1535,6 +1550,17 @@ static void addrset_from_locatorlists_collect_interfaces (const ddsi_xlocator_t
   }
 }
 
+#ifndef DDS_HAS_NETWORK_CHANNELS
+static struct nn_dqueue *user_dqueue_for_proxy_writer (const struct ddsi_domaingv *gv, const ddsi_guid_t *guid)
+{
+  /* all samples of a proxy writer go through the same queue to preserve their order */
+  if (gv->n_user_dqueues == 1)
+    return gv->user_dqueues[0];
+  const uint32_t h = ddsrt_mh3 (guid, sizeof (*guid), 0);
+  return gv->user_dqueues[h % gv->n_user_dqueues];
+}
+#endif
+
 static void handle_sedp_alive_endpoint (const struct receiver_state *rst, seqno_t seq, ddsi_plist_t *datap /* note: potentially modifies datap */, ddsi_sedp_kind_t sedp_kind, const ddsi_guid_prefix_t *src_guid_prefix, nn_vendorid_t vendorid, ddsrt_wctime_t timestamp)
 {
 #define E(msg, lbl) do { GVLOGDISC (msg); goto lbl; } while (0)
@@ -1700,14 +1726,14 @@ static void handle_sedp_alive_endpoint (const struct receiver_state *rst, seqno_
           new_proxy_writer (gv, &ppguid, &datap->endpoint_guid, as, datap, channel->dqueue, channel->evq ? channel->evq : gv->xevents, timestamp, seq);
         }
 #else
-        new_proxy_writer (gv, &ppguid, &datap->endpoint_guid, as, datap, gv->user_dqueue, gv->xevents, timestamp, seq);
+        new_proxy_writer (gv, &ppguid, &datap->endpoint_guid, as, datap, user_dqueue_for_proxy_writer (gv, &datap->endpoint_guid), gv->xevents, timestamp, seq);
 #endif
       }
     }
     else
     {
       if (prd)
-        update_proxy_reader (prd, seq, as, xqos, timestamp);
+        update_proxy_reader (prd, seq, as, xqos, (datap->present & PP_CONTENT_FILTER_PROPERTY) ? &datap->content_filter_property : NULL, timestamp);
       else
       {
 #ifdef DDS_HAS_SSM
@@ -1829,6 +1855,9 @@ static void handle_sedp (const struct receiver_state *rst, seqno_t seq, struct d
   {
     struct ddsi_domaingv * const gv = rst->gv;
     GVLOGDISC ("SEDP ST%"PRIx32, serdata->statusinfo);
+    /* matching new proxy endpoints is done once all pending samples have been
+       processed, see builtins_dqueue_batch_handler */
+    proxy_endpoint_match_batch_begin (gv);
     switch (serdata->statusinfo & (NN_STATUSINFO_DISPOSE | NN_STATUSINFO_UNREGISTER))
     {
       case 0:
@@ -1873,6 +1902,12 @@ static void handle_typelookup (const struct receiver_state *rst, ddsi_entityid_t
 /******************************************************************************
  *****************************************************************************/
 
+void builtins_dqueue_batch_handler (void *qarg)
+{
+  struct ddsi_domaingv * const gv = qarg;
+  proxy_endpoint_match_batch_end (gv);
+}
+
 int builtins_dqueue_handler (const struct nn_rsample_info *sampleinfo, const struct nn_rdata *fragchain, UNUSED_ARG (const ddsi_guid_t *rdguid), UNUSED_ARG (void *qarg))
 {
   struct ddsi_domaingv * const gv = sampleinfo->rst->gv;
@@ -10,6 +10,7 @@
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
 
@@ -19,6 +20,7 @@
 #include "dds/ddsrt/sockets.h"
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/threads.h"
 #include "dds/ddsrt/misc.h"
 #include "dds/ddsrt/md5.h"
 
@@ -46,6 +48,7 @@
 #include "dds/ddsi/ddsi_udp.h" /* nn_mc4gen_address_t */
 #include "dds/ddsi/ddsi_rhc.h"
 #include "dds/ddsi/ddsi_wraddrset.h"
+#include "dds/ddsi/ddsi_filter_expr.h"
 
 #include "dds/ddsi/sysdeps.h"
 #include "dds__whc.h"
@@ -309,6 +312,7 @@ static void entity_common_init (struct entity_common *e, struct ddsi_domaingv *g
   e->name = ddsrt_strdup (name ? name : "");
   e->onlylocal = onlylocal;
   e->gv = gv;
+  e->match_class = NULL;
   ddsrt_mutex_init (&e->lock);
   ddsrt_mutex_init (&e->qos_lock);
   if (builtintopic_is_visible (gv->builtin_topic_interface, guid, vendorid))
@@ -1595,22 +1599,8 @@ static uint32_t get_min_receive_buffer_size (struct writer *wr)
   return min_receive_buffer_size;
 }
 
-static void rebuild_writer_addrset (struct writer *wr)
+static void writer_set_burst_size_limits (struct writer *wr)
 {
-  /* FIXME: way too inefficient in this form:
-     - it gets computed for every change
-     - in many cases the set of addresses from the readers
-       is identical, so we could cache the results */
-
-  /* only one operation at a time */
-  ASSERT_MUTEX_HELD (&wr->e.lock);
-
-  /* swap in new address set; this simple procedure is ok as long as
-     wr->as is never accessed without the wr->e.lock held */
-  struct addrset * const oldas = wr->as;
-  wr->as = compute_writer_addrset (wr);
-  unref_addrset (oldas);
-
   /* Computing burst size limit here is a bit of a hack; but anyway ...
      try to limit bursts of retransmits to 67% of the smallest receive
      buffer, and those of initial transmissions to that + overshoot%.
@@ -1621,7 +1611,7 @@ static void rebuild_writer_addrset (struct writer *wr)
      - the way things are now: the retransmits will be sent unicast,
        so if there are multiple receivers, that'll blow up things by
        a non-trivial amount */
-  const uint32_t min_receive_buffer_size = get_min_receive_buffer_size (wr);
+  const uint32_t min_receive_buffer_size = wr->min_receive_buffer_size;
   wr->rexmit_burst_size_limit = min_receive_buffer_size - min_receive_buffer_size / 3;
   if (wr->rexmit_burst_size_limit < 1024)
     wr->rexmit_burst_size_limit = 1024;
@@ -1637,12 +1627,154 @@ static void rebuild_writer_addrset (struct writer *wr)
     wr->init_burst_size_limit = wr->rexmit_burst_size_limit;
   else
     wr->init_burst_size_limit = (uint32_t) limit64;
+}
+
+static void rebuild_writer_addrset (struct writer *wr)
+{
+  /* only one operation at a time */
+  ASSERT_MUTEX_HELD (&wr->e.lock);
+
+  /* swap in new address set; this simple procedure is ok as long as
+     wr->as is never accessed without the wr->e.lock held */
+  const ddsrt_mtime_t tstart = ddsrt_time_monotonic ();
+  struct addrset * const oldas = wr->as;
+  wr->as = compute_writer_addrset (wr);
+  unref_addrset (oldas);
+  wr->min_receive_buffer_size = get_min_receive_buffer_size (wr);
+  writer_set_burst_size_limits (wr);
+  wr->t_as_changed_first = wr->t_as_changed_last = DDSRT_MTIME_NEVER;
+  const int64_t tcost = ddsrt_time_monotonic ().v - tstart.v;
+  wr->addrset_rebuild_count++;
+  wr->time_addrset_rebuild += (uint64_t) tcost;
 
   ELOGDISC (wr, "rebuild_writer_addrset("PGUIDFMT"):", PGUID (wr->e.guid));
   nn_log_addrset(wr->e.gv, DDS_LC_DISCOVERY, "", wr->as);
+  ELOGDISC (wr, " (burst size %"PRIu32" rexmit %"PRIu32", took %"PRId64"ns)\n", wr->init_burst_size_limit, wr->rexmit_burst_size_limit, tcost);
+}
+
+/* Upper bound on the postponement of a deferred rebuild of the address set
+   while matching readers keep coming and going, as a multiple of the delay */
+#define WRITER_ADDRSET_REBUILD_MAX_DEFER 10
+
+static void writer_addrset_rebuild_cb (struct xevent *xev, void *varg, ddsrt_mtime_t tnow)
+{
+  struct writer * const wr = varg;
+  const dds_duration_t delay = wr->e.gv->config.writer_addrset_rebuild_delay;
+  ddsrt_mutex_lock (&wr->e.lock);
+  if (wr->t_as_changed_first.v != DDS_NEVER)
+  {
+    /* rebuild once nothing changed for the configured delay, but don't let
+       continuous changes postpone it indefinitely */
+    const dds_duration_t maxdefer =
+      (delay > DDS_INFINITY / WRITER_ADDRSET_REBUILD_MAX_DEFER) ? DDS_INFINITY : WRITER_ADDRSET_REBUILD_MAX_DEFER * delay;
+    ddsrt_mtime_t tdue = ddsrt_mtime_add_duration (wr->t_as_changed_last, delay);
+    const ddsrt_mtime_t tmax = ddsrt_mtime_add_duration (wr->t_as_changed_first, maxdefer);
+    if (tmax.v < tdue.v)
+      tdue = tmax;
+    if (tnow.v < tdue.v)
+      (void) resched_xevent_if_earlier (xev, tdue);
+    else
+      rebuild_writer_addrset (wr);
+  }
+  ddsrt_mutex_unlock (&wr->e.lock);
+}
+
+static void writer_addrset_defer_rebuild (struct writer *wr)
+{
+  const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+  if (wr->t_as_changed_first.v == DDS_NEVER)
+    wr->t_as_changed_first = tnow;
+  wr->t_as_changed_last = tnow;
+  if (wr->as_rebuild_xevent == NULL)
+    wr->as_rebuild_xevent = qxev_callback (wr->evq, DDSRT_MTIME_NEVER, writer_addrset_rebuild_cb, wr);
+  (void) resched_xevent_if_earlier (wr->as_rebuild_xevent, ddsrt_mtime_add_duration (tnow, wr->e.gv->config.writer_addrset_rebuild_delay));
+}
+
+struct guid_vec {
+  uint32_t n, size;
+  ddsi_guid_t *guids;
+};
+
+/* Matching of proxy endpoints discovered while the builtins delivery queue
+   processes a batch of SEDP samples is deferred to the end of that batch.
+   Local writers that match new proxy readers then get their address set
+   extended cheaply, and fully rebuilt only once at the end of the batch.
+   The state is per-thread so that other threads creating endpoints (and
+   thereby matching) concurrently are unaffected. */
+struct proxy_endpoint_match_batch {
+  struct ddsi_domaingv *gv; /* non-NULL iff a batch is in progress on this thread */
+  struct guid_vec eps; /* new proxy endpoints awaiting matching */
+  struct guid_vec wrs; /* local writers awaiting an address set rebuild, may contain duplicates */
+};
+
+static ddsrt_thread_local struct proxy_endpoint_match_batch match_batch;
+
+static void guid_vec_append (struct guid_vec *v, const ddsi_guid_t *guid)
+{
+  if (v->n == v->size)
+  {
+    v->size = (v->size == 0) ? 32 : 2 * v->size;
+    v->guids = ddsrt_realloc (v->guids, v->size * sizeof (*v->guids));
+  }
+  v->guids[v->n++] = *guid;
+}
+
+static void guid_vec_fini (struct guid_vec *v)
+{
+  ddsrt_free (v->guids);
+  v->n = v->size = 0;
+  v->guids = NULL;
+}
+
+static struct proxy_endpoint_match_batch *get_match_batch (const struct ddsi_domaingv *gv)
+{
+  return (match_batch.gv == gv) ? &match_batch : NULL;
+}
+
+static void writer_addrset_add_reader (struct writer *wr, const struct proxy_reader *prd)
+{
+  /* Extending the address set to cover one more reader is cheap, the
+     full optimisation over all readers is deferred until discovery has
+     settled down (if so configured) or else until the batch of discovery
+     data being processed by this thread is done */
+  ASSERT_MUTEX_HELD (&wr->e.lock);
+  const dds_duration_t delay = wr->e.gv->config.writer_addrset_rebuild_delay;
+  struct proxy_endpoint_match_batch * const batch = (delay == 0) ? get_match_batch (wr->e.gv) : NULL;
+  struct addrset *newas;
+  if ((delay == 0 && batch == NULL) || (newas = compute_writer_addrset_add_reader (wr, prd)) == NULL)
+  {
+    rebuild_writer_addrset (wr);
+    return;
+  }
+  struct addrset * const oldas = wr->as;
+  wr->as = newas;
+  unref_addrset (oldas);
+  if (prd->receive_buffer_size < wr->min_receive_buffer_size)
+  {
+    wr->min_receive_buffer_size = prd->receive_buffer_size;
+    writer_set_burst_size_limits (wr);
+  }
+  if (batch)
+    guid_vec_append (&batch->wrs, &wr->e.guid);
+  else
+    writer_addrset_defer_rebuild (wr);
+
+  ELOGDISC (wr, "writer_addrset_add_reader("PGUIDFMT" prd "PGUIDFMT"):", PGUID (wr->e.guid), PGUID (prd->e.guid));
+  nn_log_addrset(wr->e.gv, DDS_LC_DISCOVERY, "", wr->as);
   ELOGDISC (wr, " (burst size %"PRIu32" rexmit %"PRIu32")\n", wr->init_burst_size_limit, wr->rexmit_burst_size_limit);
 }
 
+static void writer_addrset_remove_reader (struct writer *wr)
+{
+  /* The address set still covers the remaining readers after removing
+     one, it just may be larger than necessary until it is rebuilt */
+  ASSERT_MUTEX_HELD (&wr->e.lock);
+  if (wr->e.gv->config.writer_addrset_rebuild_delay == 0 || wr->num_readers == 0)
+    rebuild_writer_addrset (wr);
+  else
+    writer_addrset_defer_rebuild (wr);
+}
+
 void rebuild_or_clear_writer_addrsets (struct ddsi_domaingv *gv, int rebuild)
 {
   struct entidx_enum_writer est;
@@ -1652,6 +1784,10 @@ void rebuild_or_clear_writer_addrsets (struct ddsi_domaingv *gv, int rebuild)
   entidx_enum_writer_init (&est, gv->entity_index);
   while ((wr = entidx_enum_writer_next (&est)) != NULL)
   {
+    /* the writers of the local built-in topics don't send anything, and
+       have the same entity id as the SPDP writers */
+    if (is_local_orphan_endpoint (&wr->e))
+      continue;
     ddsrt_mutex_lock (&wr->e.lock);
     if (wr->e.guid.entityid.u != NN_ENTITYID_SPDP_BUILTIN_PARTICIPANT_WRITER)
     {
@@ -1678,6 +1814,74 @@ void rebuild_or_clear_writer_addrsets (struct ddsi_domaingv *gv, int rebuild)
   GVLOGDISC ("rebuild_or_delete_writer_addrsets(%d) done\n", rebuild);
 }
 
+static nn_content_filter_property_t *content_filter_property_dup (const nn_content_filter_property_t *src)
+{
+  if (src == NULL)
+    return NULL;
+  nn_content_filter_property_t *dst = ddsrt_malloc (sizeof (*dst));
+  dst->cf_topic_name = ddsrt_strdup (src->cf_topic_name);
+  dst->related_topic_name = ddsrt_strdup (src->related_topic_name);
+  dst->filter_class_name = ddsrt_strdup (src->filter_class_name);
+  dst->filter_expression = ddsrt_strdup (src->filter_expression);
+  dst->expression_parameters.n = src->expression_parameters.n;
+  dst->expression_parameters.strs = ddsrt_malloc ((src->expression_parameters.n > 0 ? src->expression_parameters.n : 1) * sizeof (*dst->expression_parameters.strs));
+  for (uint32_t i = 0; i < src->expression_parameters.n; i++)
+    dst->expression_parameters.strs[i] = ddsrt_strdup (src->expression_parameters.strs[i]);
+  return dst;
+}
+
+static void content_filter_property_free (nn_content_filter_property_t *cf)
+{
+  if (cf == NULL)
+    return;
+  for (uint32_t i = 0; i < cf->expression_parameters.n; i++)
+    ddsrt_free (cf->expression_parameters.strs[i]);
+  ddsrt_free (cf->expression_parameters.strs);
+  ddsrt_free (cf->filter_expression);
+  ddsrt_free (cf->filter_class_name);
+  ddsrt_free (cf->related_topic_name);
+  ddsrt_free (cf->cf_topic_name);
+  ddsrt_free (cf);
+}
+
+static bool content_filter_property_equal (const nn_content_filter_property_t *a, const nn_content_filter_property_t *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+  if (strcmp (a->cf_topic_name, b->cf_topic_name) != 0 ||
+      strcmp (a->related_topic_name, b->related_topic_name) != 0 ||
+      strcmp (a->filter_class_name, b->filter_class_name) != 0 ||
+      strcmp (a->filter_expression, b->filter_expression) != 0 ||
+      a->expression_parameters.n != b->expression_parameters.n)
+    return false;
+  for (uint32_t i = 0; i < a->expression_parameters.n; i++)
+    if (strcmp (a->expression_parameters.strs[i], b->expression_parameters.strs[i]) != 0)
+      return false;
+  return true;
+}
+
+static struct ddsi_filter_expr *writer_compile_content_filter (const struct writer *wr, const struct proxy_reader *prd, const nn_content_filter_property_t *cf)
+{
+  /* The expression refers to members by position, which only makes sense if the writer
+     uses the reader's type.  Any filter the writer can't handle is simply ignored: the
+     reader always filters the data it receives. */
+  struct ddsi_filter_expr *fx;
+  dds_return_t ret;
+  if (cf == NULL || !(prd->c.xqos->present & QP_TYPE_NAME) || strcmp (prd->c.xqos->type_name, wr->type->type_name) != 0)
+    return NULL;
+#ifdef DDS_HAS_TYPE_DISCOVERY
+  if (!ddsi_typeid_none (&prd->c.type_id) && !ddsi_typeid_equal (&prd->c.type_id, &wr->c.type_id))
+    return NULL;
+#endif
+  if ((ret = ddsi_filter_expr_new_from_property (&fx, wr->type, cf)) != DDS_RETCODE_OK)
+  {
+    ELOGDISC (wr, "  writer "PGUIDFMT" ignoring content filter of proxy reader "PGUIDFMT" (%s, %s): %s\n",
+              PGUID (wr->e.guid), PGUID (prd->e.guid), cf->filter_class_name, cf->filter_expression, dds_strretcode (ret));
+    return NULL;
+  }
+  return fx;
+}
+
 static void free_wr_prd_match (const struct ddsi_domaingv *gv, const ddsi_guid_t *wr_guid, struct wr_prd_match *m)
 {
   if (m)
@@ -1688,6 +1892,8 @@ static void free_wr_prd_match (const struct ddsi_domaingv *gv, const ddsi_guid_t
     (void) gv;
     (void) wr_guid;
 #endif
+    if (m->filter)
+      ddsi_filter_expr_free (m->filter);
     nn_lat_estim_fini (&m->hb_to_ack_latency);
     ddsrt_free (m);
   }
@@ -1785,7 +1991,8 @@ static void writer_drop_connection (const struct ddsi_guid *wr_guid, const struc
       wr->num_readers--;
       wr->num_reliable_readers -= m->is_reliable;
       wr->num_readers_requesting_keyhash -= prd->requests_keyhash ? 1 : 0;
-      rebuild_writer_addrset (wr);
+      wr->num_content_filtered_readers -= (m->filter != NULL);
+      writer_addrset_remove_reader (wr);
       remove_acked_messages (wr, &whcst, &deferred_free_list);
     }
 
@@ -2131,6 +2338,7 @@ static void writer_add_connection (struct writer *wr, struct proxy_reader *prd,
   {
     pretend_everything_acked = 0;
   }
+  m->filter = writer_compile_content_filter (wr, prd, prd->content_filter);
   ddsrt_mutex_unlock (&prd->e.lock);
   m->prev_acknack = 0;
   m->prev_nackfrag = 0;
@@ -2154,6 +2362,8 @@ static void writer_add_connection (struct writer *wr, struct proxy_reader *prd,
     ELOGDISC (wr, "  writer_add_connection(wr "PGUIDFMT" prd "PGUIDFMT") - already connected\n",
               PGUID (wr->e.guid), PGUID (prd->e.guid));
     ddsrt_mutex_unlock (&wr->e.lock);
+    if (m->filter)
+      ddsi_filter_expr_free (m->filter);
     nn_lat_estim_fini (&m->hb_to_ack_latency);
     ddsrt_free (m);
   }
@@ -2165,7 +2375,8 @@ static void writer_add_connection (struct writer *wr, struct proxy_reader *prd,
     wr->num_readers++;
     wr->num_reliable_readers += m->is_reliable;
     wr->num_readers_requesting_keyhash += prd->requests_keyhash ? 1 : 0;
-    rebuild_writer_addrset (wr);
+    wr->num_content_filtered_readers += (m->filter != NULL);
+    writer_addrset_add_reader (wr, prd);
     ddsrt_mutex_unlock (&wr->e.lock);
 
     if (wr->status_cb)
@@ -2730,15 +2941,21 @@ static bool topickind_qos_match_p_lock (
     *reason = DDS_INVALID_QOS_POLICY_ID;
     return false;
   }
+  /* The QoS relevant for matching can't be changed once an endpoint exists, so the
+     outcome is the same for all pairs of endpoints sharing that part of their QoS */
+  bool ret;
+  if (entidx_match_verdict_lookup (gv->entity_index, rd, wr, &ret, reason))
+    return ret;
+
   ddsrt_mutex_t * const locks[] = { &rd->qos_lock, &wr->qos_lock, &rd->qos_lock };
   const int shift = (uintptr_t) rd > (uintptr_t) wr;
   for (int i = 0; i < 2; i++)
     ddsrt_mutex_lock (locks[i + shift]);
 #ifdef DDS_HAS_TYPE_DISCOVERY
   bool rd_type_lookup, wr_type_lookup;
-  bool ret = qos_match_p (gv, rdqos, wrqos, reason, rd_typeid, wr_typeid, &rd_type_lookup, &wr_type_lookup);
+  ret = qos_match_p (gv, rdqos, wrqos, reason, rd_typeid, wr_typeid, &rd_type_lookup, &wr_type_lookup);
 #else
-  bool ret = qos_match_p (gv, rdqos, wrqos, reason);
+  ret = qos_match_p (gv, rdqos, wrqos, reason);
 #endif
   for (int i = 0; i < 2; i++)
     ddsrt_mutex_unlock (locks[i + shift]);
@@ -2748,12 +2965,14 @@ static bool topickind_qos_match_p_lock (
   {
     /* In case qos_match_p returns false, one of rd_type_look and wr_type_lookup could
        be set to indicate that type information is missing. At this point, we know this
-       is the case so pass either rd_type_id or wr_typeid to the tl_request_type function. */
+       is the case so pass either rd_type_id or wr_typeid to the tl_request_type function.
+       The outcome will be different once the type is known, so it can't be cached. */
     (void) ddsi_tl_request_type (gv, rd_type_lookup ? rd_typeid : wr_typeid);
     return false;
   }
 #endif
 
+  entidx_match_verdict_store (gv->entity_index, rd, wr, ret, *reason);
   return ret;
 }
 
@@ -3058,22 +3277,20 @@ static void generic_do_match (struct entity_common *e, ddsrt_mtime_t tnow, bool
     /* Non-builtins need matching on topics, the local orphan endpoints
        are a bit weird because they reuse the builtin entityids but
        otherwise need to be treated as normal readers */
-    struct match_entities_range_key max;
+    struct entidx_enum_match mit;
     const char *tp = entity_topic_name (e);
-    EELOGDISC (e, "match_%s_with_%ss(%s "PGUIDFMT") scanning all %ss%s%s\n",
+    /* Note: we visit all candidates that existed when we called init
+       (with the -- possible -- exception of ones that were deleted
+       between our calling init and our reaching it while enumerating) */
+    entidx_enum_match_init (&mit, entidx, mkind, e);
+    EELOGDISC (e, "match_%s_with_%ss(%s "PGUIDFMT") scanning %"PRIu32" candidate %ss%s%s\n",
                kindstr[e->kind].full_us, kindstr[mkind].full_us,
                kindstr[e->kind].abbrev, PGUID (e->guid),
-               kindstr[mkind].abbrev,
+               mit.n, kindstr[mkind].abbrev,
                tp ? " of topic " : "", tp ? tp : "");
-    /* Note: we visit at least all proxies that existed when we called
-       init (with the -- possible -- exception of ones that were
-       deleted between our calling init and our reaching it while
-       enumerating), but we may visit a single proxy reader multiple
-       times. */
-    entidx_enum_init_topic (&it, entidx, mkind, tp, &max);
-    while ((em = entidx_enum_next_max (&it, &max)) != NULL)
+    while ((em = entidx_enum_match_next (&mit)) != NULL)
       generic_do_match_connect (e, em, tnow, local);
-    entidx_enum_fini (&it);
+    entidx_enum_match_fini (&mit);
   }
   else if (!local)
   {
@@ -3133,6 +3350,66 @@ static void match_proxy_reader_with_writers (struct proxy_reader *prd, ddsrt_mti
   generic_do_match(&prd->e, tnow, false);
 }
 
+void proxy_endpoint_match_batch_begin (struct ddsi_domaingv *gv)
+{
+  assert (match_batch.gv == NULL || match_batch.gv == gv);
+  match_batch.gv = gv;
+}
+
+void proxy_endpoint_match_batch_end (struct ddsi_domaingv *gv)
+{
+  struct proxy_endpoint_match_batch * const batch = get_match_batch (gv);
+  if (batch == NULL)
+    return;
+  if (batch->eps.n > 0)
+  {
+    /* matching may add writers to the batch, so it must still be in progress */
+    const ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
+    GVLOGDISC ("match batch: %"PRIu32" proxy endpoints\n", batch->eps.n);
+    for (uint32_t i = 0; i < batch->eps.n; i++)
+    {
+      const ddsi_guid_t *guid = &batch->eps.guids[i];
+      struct proxy_writer *pwr;
+      struct proxy_reader *prd;
+      /* the endpoint may have been deleted again in the meantime */
+      if (is_writer_entityid (guid->entityid))
+      {
+        if ((pwr = entidx_lookup_proxy_writer_guid (gv->entity_index, guid)) != NULL)
+        {
+          match_proxy_writer_with_readers (pwr, tnow);
+          ddsrt_mutex_lock (&pwr->e.lock);
+          pwr->local_matching_inprogress = 0;
+          ddsrt_mutex_unlock (&pwr->e.lock);
+        }
+      }
+      else
+      {
+        if ((prd = entidx_lookup_proxy_reader_guid (gv->entity_index, guid)) != NULL)
+          match_proxy_reader_with_writers (prd, tnow);
+      }
+    }
+  }
+  if (batch->wrs.n > 0)
+  {
+    qsort (batch->wrs.guids, batch->wrs.n, sizeof (*batch->wrs.guids), compare_guid);
+    for (uint32_t i = 0; i < batch->wrs.n; i++)
+    {
+      struct writer *wr;
+      if (i > 0 && compare_guid (&batch->wrs.guids[i-1], &batch->wrs.guids[i]) == 0)
+        continue;
+      if ((wr = entidx_lookup_writer_guid (gv->entity_index, &batch->wrs.guids[i])) != NULL)
+      {
+        ddsrt_mutex_lock (&wr->e.lock);
+        rebuild_writer_addrset (wr);
+        ddsrt_mutex_unlock (&wr->e.lock);
+      }
+    }
+  }
+  guid_vec_fini (&batch->eps);
+  guid_vec_fini (&batch->wrs);
+  batch->gv = NULL;
+}
+
 #ifdef DDS_HAS_SECURITY
 
 static void match_volatile_secure_endpoints (struct participant *pp, struct proxy_participant *proxypp)
@@ -3228,18 +3505,16 @@ static void update_proxy_participant_endpoint_matching (struct proxy_participant
     mkind = generic_do_match_mkind (e->kind, false);
     if (!is_builtin_entityid (e->guid.entityid, NN_VENDORID_ECLIPSE))
     {
-      struct entidx_enum it;
+      struct entidx_enum_match it;
       struct entity_common *em;
-      struct match_entities_range_key max;
-      const char *tp = entity_topic_name (e);
 
-      entidx_enum_init_topic(&it, entidx, mkind, tp, &max);
-      while ((em = entidx_enum_next_max (&it, &max)) != NULL)
+      entidx_enum_match_init (&it, entidx, mkind, e);
+      while ((em = entidx_enum_match_next (&it)) != NULL)
       {
         if (&pp->e == get_entity_parent(em))
           generic_do_match_connect (e, em, tnow, false);
       }
-      entidx_enum_fini (&it);
+      entidx_enum_match_fini (&it);
     }
     else
     {
@@ -3265,19 +3540,17 @@ void update_proxy_endpoint_matching (const struct ddsi_domaingv *gv, struct gene
   GVLOGDISC ("update_proxy_endpoint_matching (proxy ep "PGUIDFMT")\n", PGUID (proxy_ep->e.guid));
   enum entity_kind mkind = generic_do_match_mkind (proxy_ep->e.kind, false);
   assert (!is_builtin_entityid (proxy_ep->e.guid.entityid, NN_VENDORID_ECLIPSE));
-  struct entidx_enum it;
+  struct entidx_enum_match it;
   struct entity_common *em;
-  struct match_entities_range_key max;
-  const char *tp = entity_topic_name (&proxy_ep->e);
   ddsrt_mtime_t tnow = ddsrt_time_monotonic ();
 
-  entidx_enum_init_topic (&it, gv->entity_index, mkind, tp, &max);
-  while ((em = entidx_enum_next_max (&it, &max)) != NULL)
+  entidx_enum_match_init (&it, gv->entity_index, mkind, &proxy_ep->e);
+  while ((em = entidx_enum_match_next (&it)) != NULL)
   {
     GVLOGDISC ("match proxy ep "PGUIDFMT" with "PGUIDFMT"\n", PGUID (proxy_ep->e.guid), PGUID (em->guid));
     generic_do_match_connect (&proxy_ep->e, em, tnow, false);
   }
-  entidx_enum_fini (&it);
+  entidx_enum_match_fini (&it);
 }
 
 /* ENDPOINT --------------------------------------------------------- */
@@ -3685,6 +3958,7 @@ static void new_writer_guid_common_init (struct writer *wr, const char *topic_na
   wr->num_readers = 0;
   wr->num_reliable_readers = 0;
   wr->num_readers_requesting_keyhash = 0;
+  wr->num_content_filtered_readers = 0;
   wr->num_acks_received = 0;
   wr->num_nacks_received = 0;
   wr->throttle_count = 0;
@@ -3694,6 +3968,12 @@ static void new_writer_guid_common_init (struct writer *wr, const char *topic_na
   wr->rexmit_bytes = 0;
   wr->time_throttled = 0;
   wr->time_retransmit = 0;
+  wr->addrset_rebuild_count = 0;
+  wr->filtered_count = 0;
+  wr->time_addrset_rebuild = 0;
+  wr->min_receive_buffer_size = UINT32_MAX;
+  wr->t_as_changed_first = wr->t_as_changed_last = DDSRT_MTIME_NEVER;
+  wr->as_rebuild_xevent = NULL;
   wr->force_md5_keyhash = 0;
   wr->alive = 1;
   wr->test_ignore_acknack = 0;
@@ -3739,7 +4019,8 @@ static void new_writer_guid_common_init (struct writer *wr, const char *topic_na
     assert ((wr->xqos->durability.kind == DDS_DURABILITY_TRANSIENT_LOCAL) ||
             (wr->e.guid.entityid.u == NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_STATELESS_MESSAGE_WRITER));
   }
-  wr->handle_as_transient_local = (wr->xqos->durability.kind == DDS_DURABILITY_TRANSIENT_LOCAL);
+  /* TRANSIENT and PERSISTENT include TRANSIENT_LOCAL behaviour */
+  wr->handle_as_transient_local = (wr->xqos->durability.kind != DDS_DURABILITY_VOLATILE);
   wr->num_readers_requesting_keyhash +=
     wr->e.gv->config.generate_keyhash &&
     ((wr->e.guid.entityid.u & NN_ENTITYID_KIND_MASK) == NN_ENTITYID_KIND_WRITER_WITH_KEY);
@@ -4020,6 +4301,8 @@ static void gc_delete_writer (struct gcreq *gcreq)
     wr->hbcontrol.tsched = DDSRT_MTIME_NEVER;
     delete_xevent (wr->heartbeat_xevent);
   }
+  if (wr->as_rebuild_xevent)
+    delete_xevent_callback (wr->as_rebuild_xevent);
 
   /* Tear down connections -- no proxy reader can be adding/removing
       us now, because we can't be found via entity_index anymore.  We
@@ -4373,7 +4656,7 @@ static dds_return_t new_reader_guid
    * used for this reader and reader specific out-of-order list must be used which is
    * used for handling transient local data.
    */
-  rd->handle_as_transient_local = (rd->xqos->durability.kind == DDS_DURABILITY_TRANSIENT_LOCAL) ||
+  rd->handle_as_transient_local = (rd->xqos->durability.kind != DDS_DURABILITY_VOLATILE) ||
                                   (rd->e.guid.entityid.u == NN_ENTITYID_P2P_BUILTIN_PARTICIPANT_VOLATILE_SECURE_READER);
   rd->type = ddsi_sertype_ref (type);
   rd->request_keyhash = rd->type->request_keyhash;
@@ -4456,6 +4739,7 @@ static dds_return_t new_reader_guid
   }
 #endif
 
+  rd->content_filter = NULL;
   ddsrt_avl_init (&rd_writers_treedef, &rd->writers);
   ddsrt_avl_init (&rd_local_writers_treedef, &rd->local_writers);
 
@@ -4539,6 +4823,7 @@ static void gc_delete_reader (struct gcreq *gcreq)
   }
   ddsi_sertype_unref ((struct ddsi_sertype *) rd->type);
 
+  content_filter_property_free (rd->content_filter);
   ddsi_xqos_fini (rd->xqos);
   ddsrt_free (rd->xqos);
   endpoint_common_fini (&rd->e, &rd->c);
@@ -4569,6 +4854,19 @@ void update_reader_qos (struct reader *rd, const dds_qos_t *xqos)
   ddsrt_mutex_unlock (&rd->e.lock);
 }
 
+void update_reader_content_filter (struct reader *rd, const nn_content_filter_property_t *content_filter)
+{
+  ddsrt_mutex_lock (&rd->e.lock);
+  if (!content_filter_property_equal (rd->content_filter, content_filter))
+  {
+    ELOGDISC (rd, "update_reader_content_filter "PGUIDFMT" %s\n", PGUID (rd->e.guid), content_filter ? content_filter->filter_expression : "(none)");
+    content_filter_property_free (rd->content_filter);
+    rd->content_filter = content_filter_property_dup (content_filter);
+    sedp_write_reader (rd);
+  }
+  ddsrt_mutex_unlock (&rd->e.lock);
+}
+
 
 /* TOPIC ------------------------------------------------ */
 
@@ -6129,6 +6427,14 @@ int new_proxy_writer (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
   builtintopic_write_endpoint (gv->builtin_topic_interface, &pwr->e, timestamp, true);
   ddsrt_mutex_unlock (&pwr->e.lock);
 
+  struct proxy_endpoint_match_batch * const batch = get_match_batch (gv);
+  if (batch && !is_builtin_entityid (pwr->e.guid.entityid, pwr->c.vendor))
+  {
+    /* local_matching_inprogress remains set until the batch ends */
+    guid_vec_append (&batch->eps, &pwr->e.guid);
+    return 0;
+  }
+
   match_proxy_writer_with_readers (pwr, tnow);
 
   ddsrt_mutex_lock (&pwr->e.lock);
@@ -6175,10 +6481,46 @@ void update_proxy_writer (struct proxy_writer *pwr, seqno_t seq, struct addrset
   ddsrt_mutex_unlock (&pwr->e.lock);
 }
 
-void update_proxy_reader (struct proxy_reader *prd, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, ddsrt_wctime_t timestamp)
+static void proxy_reader_update_content_filters (struct proxy_reader *prd, const nn_content_filter_property_t *content_filter)
+{
+  /* Writers matched after the update compile the new filter in writer_add_connection,
+     writers already in prd->writers get it here; a writer still in the process of being
+     connected is either already in wr->readers or will see the new filter */
+  struct prd_wr_match *m;
+  ddsi_guid_t wrguid;
+  memset (&wrguid, 0, sizeof (wrguid));
+  ddsrt_mutex_lock (&prd->e.lock);
+  while ((m = ddsrt_avl_lookup_succ (&prd_writers_treedef, &prd->writers, &wrguid)) != NULL)
+  {
+    struct writer *wr;
+    wrguid = m->wr_guid;
+    ddsrt_mutex_unlock (&prd->e.lock);
+    if ((wr = entidx_lookup_writer_guid (prd->e.gv->entity_index, &wrguid)) != NULL)
+    {
+      struct ddsi_filter_expr *fx = writer_compile_content_filter (wr, prd, content_filter);
+      struct wr_prd_match *m_wr;
+      ddsrt_mutex_lock (&wr->e.lock);
+      if ((m_wr = ddsrt_avl_lookup (&wr_readers_treedef, &wr->readers, &prd->e.guid)) != NULL)
+      {
+        struct ddsi_filter_expr * const old_fx = m_wr->filter;
+        wr->num_content_filtered_readers += (uint32_t) (fx != NULL) - (uint32_t) (old_fx != NULL);
+        m_wr->filter = fx;
+        fx = old_fx;
+      }
+      ddsrt_mutex_unlock (&wr->e.lock);
+      if (fx)
+        ddsi_filter_expr_free (fx);
+    }
+    ddsrt_mutex_lock (&prd->e.lock);
+  }
+  ddsrt_mutex_unlock (&prd->e.lock);
+}
+
+void update_proxy_reader (struct proxy_reader *prd, seqno_t seq, struct addrset *as, const struct dds_qos *xqos, const nn_content_filter_property_t *content_filter, ddsrt_wctime_t timestamp)
 {
   struct prd_wr_match * m;
   ddsi_guid_t wrguid;
+  bool content_filter_changed = false;
 
   memset (&wrguid, 0, sizeof (wrguid));
 
@@ -6229,8 +6571,18 @@ void update_proxy_reader (struct proxy_reader *prd, seqno_t seq, struct addrset
     }
 
     (void) update_qos_locked (&prd->e, prd->c.xqos, xqos, timestamp);
+
+    if (!content_filter_property_equal (prd->content_filter, content_filter))
+    {
+      content_filter_property_free (prd->content_filter);
+      prd->content_filter = content_filter_property_dup (content_filter);
+      content_filter_changed = true;
+    }
   }
   ddsrt_mutex_unlock (&prd->e.lock);
+
+  if (content_filter_changed)
+    proxy_reader_update_content_filters (prd, content_filter);
 }
 
 static void gc_delete_proxy_writer (struct gcreq *gcreq)
@@ -6413,6 +6765,7 @@ int new_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
   prd->is_fict_trans_reader = 0;
   prd->receive_buffer_size = proxypp->receive_buffer_size;
   prd->requests_keyhash = (plist->present & PP_CYCLONE_REQUESTS_KEYHASH) && plist->cyclone_requests_keyhash;
+  prd->content_filter = content_filter_property_dup ((plist->present & PP_CONTENT_FILTER_PROPERTY) ? &plist->content_filter_property : NULL);
   if (plist->present & PP_CYCLONE_REDUNDANT_NETWORKING)
     prd->redundant_networking = (plist->cyclone_redundant_networking != 0);
   else
@@ -6435,7 +6788,11 @@ int new_proxy_reader (struct ddsi_domaingv *gv, const struct ddsi_guid *ppguid,
   builtintopic_write_endpoint (gv->builtin_topic_interface, &prd->e, timestamp, true);
   ddsrt_mutex_unlock (&prd->e.lock);
 
-  match_proxy_reader_with_writers (prd, tnow);
+  struct proxy_endpoint_match_batch * const batch = get_match_batch (gv);
+  if (batch && !is_builtin_entityid (prd->e.guid.entityid, prd->c.vendor))
+    guid_vec_append (&batch->eps, &prd->e.guid);
+  else
+    match_proxy_reader_with_writers (prd, tnow);
   return DDS_RETCODE_OK;
 }
 
@@ -6503,6 +6860,7 @@ static void gc_delete_proxy_reader (struct gcreq *gcreq)
 #ifdef DDS_HAS_SECURITY
   q_omg_security_deregister_remote_reader(prd);
 #endif
+  content_filter_property_free (prd->content_filter);
   proxy_endpoint_common_fini (&prd->e, &prd->c);
   ddsrt_free (prd);
 }
@@ -102,7 +102,36 @@ void *nn_freelist_pop (struct nn_freelist *fl)
 
 #elif FREELIST_TYPE == FREELIST_DOUBLE
 
+/* Each thread has a private magazine for up to NN_FREELIST_NTCACHE
+   freelists, so that in steady state push and pop only touch memory
+   owned by the calling thread.  Full and empty magazines are exchanged
+   with the freelist's depot (mlist/emlist) under fl->lock, which bounds
+   the number of cached elements per thread to NN_FREELIST_MAGSIZE.
+
+   The magazines are linked into the freelist so nn_freelist_fini can
+   free their contents, and a terminating thread returns its elements to
+   the freelist.  Both happen while holding tcache_lock, which is what
+   guarantees the freelist still exists when the thread does so.  If the
+   freelist is full, the remainder stays behind in an orphaned magazine
+   that is freed by nn_freelist_fini. */
+struct nn_freelist_tcache {
+  ddsrt_atomic_voidp_t fl; /* NULL if not in use */
+  struct nn_freelist_tcache *next, *prev;
+  bool orphan;
+  uint32_t count;
+  struct nn_freelistM *m;
+};
+
 static ddsrt_thread_local int freelist_inner_idx = -1;
+static ddsrt_thread_local struct nn_freelist_tcache *freelist_tcache[NN_FREELIST_NTCACHE];
+static ddsrt_thread_local bool freelist_tcache_cleanup_registered;
+static ddsrt_once_t freelist_tcache_once = DDSRT_ONCE_INIT;
+static ddsrt_mutex_t freelist_tcache_lock;
+
+static void freelist_tcache_init (void)
+{
+  ddsrt_mutex_init (&freelist_tcache_lock);
+}
 
 void nn_freelist_init (struct nn_freelist *fl, uint32_t max, size_t linkoff)
 {
@@ -120,6 +149,7 @@ void nn_freelist_init (struct nn_freelist *fl, uint32_t max, size_t linkoff)
   fl->count = 0;
   fl->max = (max == UINT32_MAX) ? max-1 : max;
   fl->linkoff = linkoff;
+  fl->tcaches = NULL;
 }
 
 static void *get_next (const struct nn_freelist *fl, const void *e)
@@ -132,6 +162,27 @@ void nn_freelist_fini (struct nn_freelist *fl, void (*xfree) (void *))
   int i;
   uint32_t j;
   struct nn_freelistM *m;
+  struct nn_freelist_tcache *tc;
+  ddsrt_once (&freelist_tcache_once, freelist_tcache_init);
+  ddsrt_mutex_lock (&freelist_tcache_lock);
+  while ((tc = fl->tcaches) != NULL)
+  {
+    fl->tcaches = tc->next;
+    for (j = 0; j < tc->count; j++)
+      xfree (tc->m->x[j]);
+    tc->count = 0;
+    if (tc->orphan)
+    {
+      ddsrt_free (tc->m);
+      ddsrt_free (tc);
+    }
+    else
+    {
+      /* owning thread is still alive and may reuse it for another freelist */
+      ddsrt_atomic_stvoidp (&tc->fl, NULL);
+    }
+  }
+  ddsrt_mutex_unlock (&freelist_tcache_lock);
   ddsrt_mutex_destroy (&fl->lock);
   for (i = 0; i < NN_FREELIST_NPAR; i++)
   {
@@ -191,7 +242,7 @@ static int lock_inner (struct nn_freelist *fl)
   return k;
 }
 
-bool nn_freelist_push (struct nn_freelist *fl, void *elem)
+static bool push_shared (struct nn_freelist *fl, void *elem)
 {
   int k = lock_inner (fl);
   if (fl->inner[k].count < NN_FREELIST_MAGSIZE)
@@ -245,7 +296,7 @@ void *nn_freelist_pushmany (struct nn_freelist *fl, void *first, void *last, uin
   return NULL;
 }
 
-void *nn_freelist_pop (struct nn_freelist *fl)
+static void *pop_shared (struct nn_freelist *fl)
 {
   int k = lock_inner (fl);
   if (fl->inner[k].count > 0)
@@ -280,4 +331,137 @@ void *nn_freelist_pop (struct nn_freelist *fl)
   }
 }
 
+static void freelist_tcache_cleanup (void *arg)
+{
+  (void) arg;
+  ddsrt_mutex_lock (&freelist_tcache_lock);
+  for (int i = 0; i < NN_FREELIST_NTCACHE; i++)
+  {
+    struct nn_freelist_tcache * const tc = freelist_tcache[i];
+    struct nn_freelist *fl;
+    if (tc == NULL)
+      continue;
+    freelist_tcache[i] = NULL;
+    if ((fl = ddsrt_atomic_ldvoidp (&tc->fl)) != NULL)
+    {
+      while (tc->count > 0 && push_shared (fl, tc->m->x[tc->count - 1]))
+        tc->count--;
+      if (tc->count > 0)
+      {
+        tc->orphan = true;
+        continue;
+      }
+      if (tc->next)
+        tc->next->prev = tc->prev;
+      if (tc->prev)
+        tc->prev->next = tc->next;
+      else
+        fl->tcaches = tc->next;
+    }
+    ddsrt_free (tc->m);
+    ddsrt_free (tc);
+  }
+  ddsrt_mutex_unlock (&freelist_tcache_lock);
+  freelist_tcache_cleanup_registered = false;
+}
+
+static struct nn_freelist_tcache *attach_tcache (struct nn_freelist *fl, int i)
+{
+  struct nn_freelist_tcache *tc;
+  if (!freelist_tcache_cleanup_registered)
+  {
+    if (ddsrt_thread_cleanup_push (&freelist_tcache_cleanup, NULL) != DDS_RETCODE_OK)
+      return NULL;
+    freelist_tcache_cleanup_registered = true;
+  }
+  if ((tc = freelist_tcache[i]) == NULL)
+  {
+    tc = ddsrt_malloc (sizeof (*tc));
+    tc->m = ddsrt_malloc (sizeof (*tc->m));
+    tc->orphan = false;
+    ddsrt_atomic_stvoidp (&tc->fl, NULL);
+    freelist_tcache[i] = tc;
+  }
+  ddsrt_once (&freelist_tcache_once, freelist_tcache_init);
+  ddsrt_mutex_lock (&freelist_tcache_lock);
+  tc->count = 0;
+  tc->prev = NULL;
+  tc->next = fl->tcaches;
+  if (tc->next)
+    tc->next->prev = tc;
+  fl->tcaches = tc;
+  ddsrt_atomic_stvoidp (&tc->fl, fl);
+  ddsrt_mutex_unlock (&freelist_tcache_lock);
+  return tc;
+}
+
+static struct nn_freelist_tcache *get_tcache (struct nn_freelist *fl)
+{
+  int avail = -1;
+  for (int i = 0; i < NN_FREELIST_NTCACHE; i++)
+  {
+    struct nn_freelist_tcache * const tc = freelist_tcache[i];
+    const void *tcfl = tc ? ddsrt_atomic_ldvoidp (&tc->fl) : NULL;
+    if (tcfl == fl)
+      return tc;
+    else if (tcfl == NULL && avail < 0)
+      avail = i;
+  }
+  return (avail < 0) ? NULL : attach_tcache (fl, avail);
+}
+
+bool nn_freelist_push (struct nn_freelist *fl, void *elem)
+{
+  struct nn_freelist_tcache * const tc = get_tcache (fl);
+  if (tc == NULL)
+    return push_shared (fl, elem);
+  if (tc->count == NN_FREELIST_MAGSIZE)
+  {
+    ddsrt_mutex_lock (&fl->lock);
+    if (fl->count + NN_FREELIST_MAGSIZE >= fl->max)
+    {
+      ddsrt_mutex_unlock (&fl->lock);
+      return push_shared (fl, elem);
+    }
+    tc->m->next = fl->mlist;
+    fl->mlist = tc->m;
+    fl->count += NN_FREELIST_MAGSIZE;
+    if (fl->emlist == NULL)
+      tc->m = ddsrt_malloc (sizeof (*tc->m));
+    else
+    {
+      tc->m = fl->emlist;
+      fl->emlist = fl->emlist->next;
+    }
+    ddsrt_mutex_unlock (&fl->lock);
+    tc->count = 0;
+  }
+  tc->m->x[tc->count++] = elem;
+  return true;
+}
+
+void *nn_freelist_pop (struct nn_freelist *fl)
+{
+  struct nn_freelist_tcache * const tc = get_tcache (fl);
+  if (tc == NULL)
+    return pop_shared (fl);
+  if (tc->count == 0)
+  {
+    ddsrt_mutex_lock (&fl->lock);
+    if (fl->mlist == NULL)
+    {
+      ddsrt_mutex_unlock (&fl->lock);
+      return pop_shared (fl);
+    }
+    tc->m->next = fl->emlist;
+    fl->emlist = tc->m;
+    tc->m = fl->mlist;
+    fl->mlist = fl->mlist->next;
+    fl->count -= NN_FREELIST_MAGSIZE;
+    ddsrt_mutex_unlock (&fl->lock);
+    tc->count = NN_FREELIST_MAGSIZE;
+  }
+  return tc->m->x[--tc->count];
+}
+
 #endif
@@ -18,6 +18,7 @@
 #include "dds/ddsrt/time.h"
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/log_binary.h"
 
 #include "dds/ddsrt/avl.h"
 
@@ -57,6 +58,7 @@
 #include "dds/ddsi/ddsi_tcp.h"
 #include "dds/ddsi/ddsi_raweth.h"
 #include "dds/ddsi/ddsi_vnet.h"
+#include "dds/ddsi/ddsi_shmring.h"
 #include "dds/ddsi/ddsi_mcgroup.h"
 #include "dds/ddsi/ddsi_serdata_default.h"
 #include "dds/ddsi/ddsi_serdata_pserop.h"
@@ -91,6 +93,59 @@ enum make_uc_sockets_ret {
   MUSRET_ERROR          /* generic error, no use continuing */
 };
 
+static bool use_multiple_receive_threads (const struct ddsi_config *cfg);
+
+static uint32_t num_uc_data_recv_threads (const struct ddsi_domaingv *gv)
+{
+  /* Sharding the unicast data over multiple sockets relies on SO_REUSEPORT and is
+     only meaningful if there is a dedicated receive thread for unicast data in the
+     first place (see setup_and_start_recv_threads) */
+  if (gv->config.recv_uc_data_threads <= 1)
+    return 1;
+  if (gv->config.transport_selector != DDSI_TRANS_UDP && gv->config.transport_selector != DDSI_TRANS_UDP6)
+    return 1;
+  if (gv->config.many_sockets_mode != DDSI_MSM_SINGLE_UNICAST || !use_multiple_receive_threads (&gv->config))
+    return 1;
+  return (gv->config.recv_uc_data_threads > MAX_UC_DATA_RECV_THREADS) ? MAX_UC_DATA_RECV_THREADS : gv->config.recv_uc_data_threads;
+}
+
+static void free_uc_data_shared_conns (struct ddsi_domaingv *gv)
+{
+  while (gv->n_data_conn_uc_extra > 0)
+    ddsi_conn_free (gv->data_conn_uc_extra[--gv->n_data_conn_uc_extra]);
+}
+
+static dds_return_t make_uc_data_shared_conns (struct ddsi_domaingv *gv, uint32_t port)
+{
+  const uint32_t n = num_uc_data_recv_threads (gv);
+  const ddsi_tran_qos_t qos = { .m_purpose = DDSI_TRAN_QOS_RECV_UC, .m_diffserv = 0, .m_interface = NULL, .m_shared_port = true };
+  dds_return_t rc;
+  if (n <= 1)
+    return DDS_RETCODE_OK;
+
+  /* Successfully binding the exclusive socket proves no-one else is using the port,
+     a socket with SO_REUSEPORT set could silently share it with another process */
+  ddsi_conn_free (gv->data_conn_uc);
+  if ((rc = ddsi_factory_create_conn (&gv->data_conn_uc, gv->m_factory, port, &qos)) != DDS_RETCODE_OK)
+  {
+    gv->data_conn_uc = NULL;
+    return rc;
+  }
+  while (gv->n_data_conn_uc_extra < n - 1)
+  {
+    if ((rc = ddsi_factory_create_conn (&gv->data_conn_uc_extra[gv->n_data_conn_uc_extra], gv->m_factory, port, &qos)) != DDS_RETCODE_OK)
+    {
+      free_uc_data_shared_conns (gv);
+      ddsi_conn_free (gv->data_conn_uc);
+      gv->data_conn_uc = NULL;
+      return rc;
+    }
+    gv->n_data_conn_uc_extra++;
+  }
+  GVLOG (DDS_LC_CONFIG, "Unicast data port %"PRIu32" shared by %"PRIu32" sockets\n", port, n);
+  return DDS_RETCODE_OK;
+}
+
 static enum make_uc_sockets_ret make_uc_sockets (struct ddsi_domaingv *gv, uint32_t * pdisc, uint32_t * pdata, int ppid)
 {
   dds_return_t rc;
@@ -117,13 +172,18 @@ static enum make_uc_sockets_ret make_uc_sockets (struct ddsi_domaingv *gv, uint3
   if (rc != DDS_RETCODE_OK)
     goto fail_disc;
 
-  if (*pdata == 0 || *pdata == *pdisc)
+  /* Without a participant index both ports are 0 and discovery and data normally share
+     a socket, but sharding requires a separate socket (on another ephemeral port) for data */
+  if (*pdata == 0 ? (num_uc_data_recv_threads (gv) <= 1) : (*pdata == *pdisc))
     gv->data_conn_uc = gv->disc_conn_uc;
   else
   {
     rc = ddsi_factory_create_conn (&gv->data_conn_uc, gv->m_factory, *pdata, &qos);
     if (rc != DDS_RETCODE_OK)
       goto fail_data;
+    rc = make_uc_data_shared_conns (gv, ddsi_conn_port (gv->data_conn_uc));
+    if (rc != DDS_RETCODE_OK)
+      goto fail_data;
   }
   ddsi_conn_locator (gv->disc_conn_uc, &gv->loc_meta_uc);
   ddsi_conn_locator (gv->data_conn_uc, &gv->loc_default_uc);
@@ -489,6 +549,18 @@ int rtps_config_open_trace (struct ddsi_domaingv *gv)
     gv->config.tracefp = stderr;
     status = 1;
   }
+  else if (gv->config.trace_output_format == DDSI_TRACE_BINARY)
+  {
+    if ((gv->config.tracefp = fopen (gv->config.tracefile, gv->config.tracingAppendToFile ? "ab" : "wb")) == NULL)
+    {
+      DDS_ILOG (DDS_LC_ERROR, gv->config.domainId, "%s: cannot open for writing\n", gv->config.tracefile);
+      status = 0;
+    }
+    else
+    {
+      status = 1;
+    }
+  }
   else if ((gv->config.tracefp = fopen (gv->config.tracefile, gv->config.tracingAppendToFile ? "a" : "w")) == NULL)
   {
     DDS_ILOG (DDS_LC_ERROR, gv->config.domainId, "%s: cannot open for writing\n", gv->config.tracefile);
@@ -500,10 +572,32 @@ int rtps_config_open_trace (struct ddsi_domaingv *gv)
   }
 
   dds_log_cfg_init (&gv->logconfig, gv->config.domainId, gv->config.tracemask, stderr, gv->config.tracefp);
+  if (status && gv->config.tracefp && gv->config.trace_output_format == DDSI_TRACE_BINARY)
+  {
+    if ((gv->config.tracebin = ddsrt_log_binary_new (gv->config.tracefp, gv->config.trace_binary_bufsize)) == NULL)
+    {
+      DDS_ILOG (DDS_LC_ERROR, gv->config.domainId, "%s: cannot start binary tracing\n", gv->config.tracefile);
+      status = 0;
+    }
+    dds_log_cfg_set_binary (&gv->logconfig, gv->config.tracebin);
+  }
   return status;
   DDSRT_WARNING_MSVC_ON(4996);
 }
 
+static void rtps_config_stop_binary_trace (struct ddsi_domaingv *gv)
+{
+  /* the binary trace writer is owned by the domain, not by the configuration:
+     a domain created from a raw configuration has no parsing state to clean it
+     up; the trace file itself remains open until the configuration is freed */
+  if (gv->config.tracebin)
+  {
+    dds_log_cfg_set_binary (&gv->logconfig, NULL);
+    ddsrt_log_binary_free (gv->config.tracebin);
+    gv->config.tracebin = NULL;
+  }
+}
+
 int rtps_config_prep (struct ddsi_domaingv *gv, struct cfgst *cfgst)
 {
 #ifdef DDS_HAS_NETWORK_CHANNELS
@@ -960,6 +1054,7 @@ static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
 
   for (uint32_t i = 0; i < MAX_RECV_THREADS; i++)
   {
+    gv->recv_threads[i].name[0] = 0;
     gv->recv_threads[i].ts = NULL;
     gv->recv_threads[i].arg.mode = RTM_SINGLE;
     gv->recv_threads[i].arg.rbpool = NULL;
@@ -970,14 +1065,14 @@ static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
 
   /* First thread always uses a waitset and gobbles up all sockets not handled by dedicated threads - FIXME: DDSI_MSM_NO_UNICAST mode with UDP probably doesn't even need this one to use a waitset */
   gv->n_recv_threads = 1;
-  gv->recv_threads[0].name = "recv";
+  (void) ddsrt_strlcpy (gv->recv_threads[0].name, "recv", sizeof (gv->recv_threads[0].name));
   gv->recv_threads[0].arg.mode = RTM_MANY;
   if (gv->m_factory->m_connless && gv->config.many_sockets_mode != DDSI_MSM_NO_UNICAST && multi_recv_thr)
   {
     if (ddsi_is_mcaddr (gv, &gv->loc_default_mc) && !ddsi_is_ssm_mcaddr (gv, &gv->loc_default_mc) && (gv->config.allowMulticast & DDSI_AMC_ASM))
     {
       /* Multicast enabled, but it isn't an SSM address => handle data multicasts on a separate thread (the trouble with SSM addresses is that we only join matching writers, which our own sockets typically would not be) */
-      gv->recv_threads[gv->n_recv_threads].name = "recvMC";
+      (void) ddsrt_strlcpy (gv->recv_threads[gv->n_recv_threads].name, "recvMC", sizeof (gv->recv_threads[0].name));
       gv->recv_threads[gv->n_recv_threads].arg.mode = RTM_SINGLE;
       gv->recv_threads[gv->n_recv_threads].arg.u.single.conn = gv->data_conn_mc;
       gv->recv_threads[gv->n_recv_threads].arg.u.single.loc = &gv->loc_default_mc;
@@ -986,17 +1081,38 @@ static int setup_and_start_recv_threads (struct ddsi_domaingv *gv)
     }
     if (gv->config.many_sockets_mode == DDSI_MSM_SINGLE_UNICAST)
     {
-      /* No per-participant sockets => handle data unicasts on a separate thread as well */
-      gv->recv_threads[gv->n_recv_threads].name = "recvUC";
-      gv->recv_threads[gv->n_recv_threads].arg.mode = RTM_SINGLE;
-      gv->recv_threads[gv->n_recv_threads].arg.u.single.conn = gv->data_conn_uc;
-      gv->recv_threads[gv->n_recv_threads].arg.u.single.loc = &gv->loc_default_uc;
-      ddsi_conn_disable_multiplexing (gv->data_conn_uc);
-      gv->n_recv_threads++;
+      /* No per-participant sockets => handle data unicasts on a separate thread as well,
+         or on one thread per socket if the data port is shared by multiple sockets */
+      for (uint32_t i = 0; i <= gv->n_data_conn_uc_extra; i++)
+      {
+        struct ddsi_tran_conn * const conn = (i == 0) ? gv->data_conn_uc : gv->data_conn_uc_extra[i - 1];
+        if (i == 0)
+          (void) ddsrt_strlcpy (gv->recv_threads[gv->n_recv_threads].name, "recvUC", sizeof (gv->recv_threads[0].name));
+        else
+          (void) snprintf (gv->recv_threads[gv->n_recv_threads].name, sizeof (gv->recv_threads[0].name), "recvUC%"PRIu32, i);
+        gv->recv_threads[gv->n_recv_threads].arg.mode = RTM_SINGLE;
+        gv->recv_threads[gv->n_recv_threads].arg.u.single.conn = conn;
+        gv->recv_threads[gv->n_recv_threads].arg.u.single.loc = &gv->loc_default_uc;
+        ddsi_conn_disable_multiplexing (conn);
+        gv->n_recv_threads++;
+      }
     }
   }
+  if (gv->shmring_conn)
+  {
+    (void) ddsrt_strlcpy (gv->recv_threads[gv->n_recv_threads].name, "recvSHM", sizeof (gv->recv_threads[0].name));
+    gv->recv_threads[gv->n_recv_threads].arg.mode = RTM_SINGLE;
+    gv->recv_threads[gv->n_recv_threads].arg.u.single.conn = gv->shmring_conn;
+    gv->recv_threads[gv->n_recv_threads].arg.u.single.loc = &gv->loc_shmring;
+    gv->n_recv_threads++;
+  }
   assert (gv->n_recv_threads <= MAX_RECV_THREADS);
 
+  /* Threads for decoding messages received in batches, these must exist before any
+     receive thread can use them */
+  if (rtps_decode_threads_start (gv) != DDS_RETCODE_OK)
+    return -1;
+
   /* For each thread, create rbufpool and waitset if needed, then start it */
   for (uint32_t i = 0; i < gv->n_recv_threads; i++)
   {
@@ -1028,6 +1144,7 @@ fail:
   /* to trigger any threads we already started to stop - xevent thread has already been started */
   rtps_term_prep (gv);
   wait_for_receive_threads (gv);
+  rtps_decode_threads_stop (gv);
   for (uint32_t i = 0; i < gv->n_recv_threads; i++)
   {
     if (gv->recv_threads[i].arg.mode == RTM_MANY && gv->recv_threads[i].arg.u.many.ws)
@@ -1097,9 +1214,11 @@ static void free_conns (struct ddsi_domaingv *gv)
 {
   // Depending on settings, various "conn"s can alias others, this makes sure we free each one only once
   // FIXME: perhaps store them in a table instead?
-  ddsi_tran_conn_t cs[4 + MAX_XMIT_CONNS] = { gv->disc_conn_mc, gv->data_conn_mc, gv->disc_conn_uc, gv->data_conn_uc };
+  ddsi_tran_conn_t cs[5 + MAX_XMIT_CONNS] = { gv->disc_conn_mc, gv->data_conn_mc, gv->disc_conn_uc, gv->data_conn_uc, gv->shmring_conn };
   for (size_t i = 0; i < MAX_XMIT_CONNS; i++)
-    cs[4 + i] = gv->xmit_conns[i];
+    cs[5 + i] = gv->xmit_conns[i];
+  // the extra data sockets sharing the port are never aliased
+  free_uc_data_shared_conns (gv);
   for (size_t i = 0; i < sizeof (cs) / sizeof (cs[0]); i++)
   {
     if (cs[i] == NULL)
@@ -1208,6 +1327,51 @@ static int iceoryx_init (struct ddsi_domaingv *gv)
 }
 #endif
 
+static int shmring_init (struct ddsi_domaingv *gv)
+{
+  if (gv->config.many_sockets_mode == DDSI_MSM_NO_UNICAST)
+  {
+    GVERROR ("shared-memory ring transport requires unicast sockets\n");
+    return -1;
+  }
+  if (gv->n_interfaces == MAX_XMIT_CONNS)
+  {
+    GVERROR ("maximum number of interfaces reached, can't add virtual one for shmring\n");
+    return -1;
+  }
+  if (ddsi_shmring_init (gv, &gv->loc_shmring) < 0)
+    return -1;
+  ddsi_factory_find (gv, "shmring")->m_enable = true;
+
+  {
+    char buf[DDSI_LOCSTRLEN];
+    GVLOG (DDS_LC_CONFIG, "My shmring address: %s\n", ddsi_locator_to_string (buf, sizeof (buf), &gv->loc_shmring));
+  }
+
+  // Same trick as for iceoryx: a virtual interface gets a transmit conn of the
+  // shmring transport and makes any locator for this machine "nearby".  It is
+  // marked as loopback because it can't reach anything beyond this machine.
+  struct nn_interface *intf = &gv->interfaces[gv->n_interfaces];
+  intf->if_index = 1000;
+  for (int i = 0; i < gv->n_interfaces; i++)
+    if (gv->interfaces[i].if_index >= intf->if_index)
+      intf->if_index = gv->interfaces[i].if_index + 1;
+  intf->link_local = true;
+  intf->loc = gv->loc_shmring;
+  intf->loc.port = NN_LOCATOR_PORT_INVALID;
+  intf->extloc = intf->loc;
+  intf->loopback = true;
+  intf->mc_capable = true; // not really, but it avoids disabling multicast altogether
+  intf->mc_flaky = false;
+  intf->name = ddsrt_strdup ("shmring");
+  intf->point_to_point = false;
+  intf->netmask.kind = NN_LOCATOR_KIND_INVALID;
+  intf->netmask.port = NN_LOCATOR_PORT_INVALID;
+  memset (intf->netmask.address, 0, sizeof (intf->netmask.address));
+  gv->n_interfaces++;
+  return 0;
+}
+
 static void free_config_networkpartition_addresses (struct ddsi_config_networkpartition_listelem *np)
 {
   struct networkpartition_address **ps[] = {
@@ -1326,10 +1490,12 @@ int rtps_init (struct ddsi_domaingv *gv)
 
   gv->disc_conn_uc = NULL;
   gv->data_conn_uc = NULL;
+  gv->n_data_conn_uc_extra = 0;
   gv->disc_conn_mc = NULL;
   gv->data_conn_mc = NULL;
   for (size_t i = 0; i < MAX_XMIT_CONNS; i++)
     gv->xmit_conns[i] = NULL;
+  gv->shmring_conn = NULL;
   gv->listener = NULL;
   gv->debmon = NULL;
 
@@ -1402,6 +1568,12 @@ int rtps_init (struct ddsi_domaingv *gv)
   }
 #endif
 
+  if (gv->config.shmring_enable)
+  {
+    if (shmring_init (gv) < 0)
+      goto err_shmring;
+  }
+
   if (gv->config.allowMulticast)
   {
     for (int i = 0; i < gv->n_interfaces; i++)
@@ -1664,6 +1836,14 @@ int rtps_init (struct ddsi_domaingv *gv)
     }
   }
 
+  /* Receive side of the shared-memory ring transport, it always gets a thread of its own */
+  if (gv->config.shmring_enable)
+  {
+    const ddsi_tran_qos_t qos = { .m_purpose = DDSI_TRAN_QOS_RECV_UC, .m_diffserv = 0, .m_interface = NULL };
+    if (ddsi_factory_create_conn (&gv->shmring_conn, ddsi_factory_find_supported_kind (gv, NN_LOCATOR_KIND_SHMRING), 0, &qos) != DDS_RETCODE_OK)
+      goto err_mc_conn;
+  }
+
 #ifdef DDS_HAS_NETWORK_PARTITIONS
   /* Convert address sets in partition mappings from string to address sets now that we have
      xmit_conns filled in */
@@ -1685,6 +1865,12 @@ int rtps_init (struct ddsi_domaingv *gv)
       {
         gv->data_conn_uc = gv->data_conn_mc;
         gv->disc_conn_uc = gv->disc_conn_mc;
+        ddsi_conn_locator (gv->disc_conn_uc, &gv->loc_meta_uc);
+        ddsi_conn_locator (gv->data_conn_uc, &gv->loc_default_uc);
+        /* the transmit connection was set before the unicast ones existed */
+        gv->xmit_conns[0] = gv->data_conn_uc;
+        gv->intf_xlocators[0].conn = gv->xmit_conns[0];
+        gv->intf_xlocators[0].c = gv->interfaces[0].loc;
       }
 
       /* Set multicast locators */
@@ -1844,12 +2030,23 @@ int rtps_init (struct ddsi_domaingv *gv)
   gv->sendq_running = false;
   ddsrt_mutex_init (&gv->sendq_running_lock);
 
-  gv->builtins_dqueue = nn_dqueue_new ("builtins", gv, gv->config.delivery_queue_maxsamples, builtins_dqueue_handler, NULL);
+  gv->builtins_dqueue = nn_dqueue_new ("builtins", gv, gv->config.delivery_queue_maxsamples, builtins_dqueue_handler, gv);
+  nn_dqueue_set_batch_handler (gv->builtins_dqueue, builtins_dqueue_batch_handler);
 #ifdef DDS_HAS_NETWORK_CHANNELS
   for (struct ddsi_config_channel_listelem *chptr = gv->config.channels; chptr; chptr = chptr->next)
     chptr->dqueue = nn_dqueue_new (chptr->name, &gv->config, gv->config.delivery_queue_maxsamples, user_dqueue_handler, NULL);
 #else
-  gv->user_dqueue = nn_dqueue_new ("user", gv, gv->config.delivery_queue_maxsamples, user_dqueue_handler, NULL);
+  gv->n_user_dqueues = (gv->config.delivery_queue_threads == 0) ? 1 : gv->config.delivery_queue_threads;
+  gv->user_dqueues = ddsrt_malloc (gv->n_user_dqueues * sizeof (*gv->user_dqueues));
+  for (uint32_t i = 0; i < gv->n_user_dqueues; i++)
+  {
+    char name[16];
+    if (i == 0)
+      (void) ddsrt_strlcpy (name, "user", sizeof (name));
+    else
+      (void) snprintf (name, sizeof (name), "user%"PRIu32, i);
+    gv->user_dqueues[i] = nn_dqueue_new (name, gv, gv->config.delivery_queue_maxsamples, user_dqueue_handler, NULL);
+  }
 #endif
 
   if (reset_deaf_mute_time.v < DDS_NEVER)
@@ -1934,6 +2131,7 @@ err_set_ext_address:
     ddsrt_free (n);
   }
 err_set_recvips:
+err_shmring:
 #ifdef DDS_HAS_SHM
 err_iceoryx:
 #endif
@@ -1942,6 +2140,7 @@ err_find_own_ip:
     ddsrt_free (gv->interfaces[i].name);
   ddsi_tran_factories_fini (gv);
 err_udp_tcp_init:
+  rtps_config_stop_binary_trace (gv);
   return -1;
 }
 
@@ -1963,7 +2162,8 @@ int rtps_start (struct ddsi_domaingv *gv)
   for (struct ddsi_config_channel_listelem *chptr = gv->config.channels; chptr; chptr = chptr->next)
     nn_dqueue_start (chptr->dqueue);
 #else
-  nn_dqueue_start (gv->user_dqueue);
+  for (uint32_t i = 0; i < gv->n_user_dqueues; i++)
+    nn_dqueue_start (gv->user_dqueues[i]);
 #endif
 
   if (xeventq_start (gv->xevents, NULL) < 0)
@@ -2047,6 +2247,7 @@ void rtps_stop (struct ddsi_domaingv *gv)
   /* Stop all I/O */
   rtps_term_prep (gv);
   wait_for_receive_threads (gv);
+  rtps_decode_threads_stop (gv);
 
   if (gv->listener)
   {
@@ -2194,7 +2395,9 @@ void rtps_fini (struct ddsi_domaingv *gv)
     chptr = chptr->next;
   }
 #else
-  nn_dqueue_free (gv->user_dqueue);
+  for (uint32_t i = 0; i < gv->n_user_dqueues; i++)
+    nn_dqueue_free (gv->user_dqueues[i]);
+  ddsrt_free (gv->user_dqueues);
 #endif
 
 #ifdef DDS_HAS_SECURITY
@@ -2330,4 +2533,5 @@ void rtps_fini (struct ddsi_domaingv *gv)
   ddsi_serdatapool_free (gv->serpool);
   nn_xmsgpool_free (gv->xmsgpool);
   GVLOG (DDS_LC_CONFIG, "Finis.\n");
+  rtps_config_stop_binary_trace (gv);
 }
@@ -15,6 +15,7 @@
 
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/mh3.h"
 
 #include "dds/ddsrt/fibheap.h"
 
@@ -50,6 +51,21 @@ static void force_lease_check (struct gcreq_queue *gcreq_queue)
   gcreq_enqueue (gcreq_new (gcreq_queue, gcreq_free));
 }
 
+static void force_lease_check_if_earlier (struct ddsi_domaingv *gv, ddsrt_etime_t tsched)
+{
+  /* Lowers leaseheap_tcheck to tsched and only wakes up the GC thread if that
+     changed anything.  If check_and_handle_lease_expiration is running
+     concurrently, it may overwrite it with a later time that doesn't account
+     for this lease, but then the request forces another check. */
+  uint64_t tcheck;
+  do {
+    tcheck = ddsrt_atomic_ld64 (&gv->leaseheap_tcheck);
+    if (tsched.v >= (int64_t) tcheck)
+      return;
+  } while (!ddsrt_atomic_cas64 (&gv->leaseheap_tcheck, tcheck, (uint64_t) tsched.v));
+  force_lease_check (gv->gcreq_queue);
+}
+
 int compare_lease_tsched (const void *va, const void *vb)
 {
   const struct lease *a = va;
@@ -66,14 +82,21 @@ int compare_lease_tdur (const void *va, const void *vb)
 
 void lease_management_init (struct ddsi_domaingv *gv)
 {
-  ddsrt_mutex_init (&gv->leaseheap_lock);
-  ddsrt_fibheap_init (&lease_fhdef, &gv->leaseheap);
+  for (uint32_t i = 0; i < LEASEHEAP_NSHARDS; i++)
+  {
+    ddsrt_mutex_init (&gv->leaseheap[i].lock);
+    ddsrt_fibheap_init (&lease_fhdef, &gv->leaseheap[i].heap);
+  }
+  ddsrt_atomic_st64 (&gv->leaseheap_tcheck, (uint64_t) DDS_NEVER);
 }
 
 void lease_management_term (struct ddsi_domaingv *gv)
 {
-  assert (ddsrt_fibheap_min (&lease_fhdef, &gv->leaseheap) == NULL);
-  ddsrt_mutex_destroy (&gv->leaseheap_lock);
+  for (uint32_t i = 0; i < LEASEHEAP_NSHARDS; i++)
+  {
+    assert (ddsrt_fibheap_min (&lease_fhdef, &gv->leaseheap[i].heap) == NULL);
+    ddsrt_mutex_destroy (&gv->leaseheap[i].lock);
+  }
 }
 
 struct lease *lease_new (ddsrt_etime_t texpire, dds_duration_t tdur, struct entity_common *e)
@@ -86,6 +109,7 @@ struct lease *lease_new (ddsrt_etime_t texpire, dds_duration_t tdur, struct enti
   ddsrt_atomic_st64 (&l->tend, (uint64_t) texpire.v);
   l->tsched.v = TSCHED_NOT_ON_HEAP;
   l->entity = e;
+  l->shard = ddsrt_mh3 (&e->guid, sizeof (e->guid), 0) % LEASEHEAP_NSHARDS;
   return l;
 }
 
@@ -106,16 +130,17 @@ struct lease *lease_clone (const struct lease *l)
 void lease_register (struct lease *l) /* FIXME: make lease admin struct */
 {
   struct ddsi_domaingv * const gv = l->entity->gv;
+  struct lease_shard * const sh = &gv->leaseheap[l->shard];
   GVTRACE ("lease_register(l %p guid "PGUIDFMT")\n", (void *) l, PGUID (l->entity->guid));
-  ddsrt_mutex_lock (&gv->leaseheap_lock);
+  ddsrt_mutex_lock (&sh->lock);
   assert (l->tsched.v == TSCHED_NOT_ON_HEAP);
   int64_t tend = (int64_t) ddsrt_atomic_ld64 (&l->tend);
   if (tend != DDS_NEVER)
   {
     l->tsched.v = tend;
-    ddsrt_fibheap_insert (&lease_fhdef, &gv->leaseheap, l);
+    ddsrt_fibheap_insert (&lease_fhdef, &sh->heap, l);
   }
-  ddsrt_mutex_unlock (&gv->leaseheap_lock);
+  ddsrt_mutex_unlock (&sh->lock);
 
   /* check_and_handle_lease_expiration runs on GC thread and the only way to be sure that it wakes up in time is by forcing re-evaluation (strictly speaking only needed if this is the first lease to expire, but this operation is quite rare anyway) */
   force_lease_check (gv->gcreq_queue);
@@ -124,14 +149,15 @@ void lease_register (struct lease *l) /* FIXME: make lease admin struct */
 void lease_unregister (struct lease *l)
 {
   struct ddsi_domaingv * const gv = l->entity->gv;
+  struct lease_shard * const sh = &gv->leaseheap[l->shard];
   GVTRACE ("lease_unregister(l %p guid "PGUIDFMT")\n", (void *) l, PGUID (l->entity->guid));
-  ddsrt_mutex_lock (&gv->leaseheap_lock);
+  ddsrt_mutex_lock (&sh->lock);
   if (l->tsched.v != TSCHED_NOT_ON_HEAP)
   {
-    ddsrt_fibheap_delete (&lease_fhdef, &gv->leaseheap, l);
+    ddsrt_fibheap_delete (&lease_fhdef, &sh->heap, l);
     l->tsched.v = TSCHED_NOT_ON_HEAP;
   }
-  ddsrt_mutex_unlock (&gv->leaseheap_lock);
+  ddsrt_mutex_unlock (&sh->lock);
 
   /* see lease_register() */
   force_lease_check (gv->gcreq_queue);
@@ -182,18 +208,19 @@ void lease_renew (struct lease *l, ddsrt_etime_t tnowE)
 void lease_set_expiry (struct lease *l, ddsrt_etime_t when)
 {
   struct ddsi_domaingv * const gv = l->entity->gv;
+  struct lease_shard * const sh = &gv->leaseheap[l->shard];
   bool trigger = false;
   assert (when.v >= 0);
-  ddsrt_mutex_lock (&gv->leaseheap_lock);
+  ddsrt_mutex_lock (&sh->lock);
   /* only possible concurrent action is to move tend into the future (renew_lease),
-    all other operations occur with leaseheap_lock held */
+    all other operations occur with the shard's lock held */
   ddsrt_atomic_st64 (&l->tend, (uint64_t) when.v);
   if (when.v < l->tsched.v)
   {
     /* moved forward and currently scheduled (by virtue of
        TSCHED_NOT_ON_HEAP == INT64_MIN) */
     l->tsched = when;
-    ddsrt_fibheap_decrease_key (&lease_fhdef, &gv->leaseheap, l);
+    ddsrt_fibheap_decrease_key (&lease_fhdef, &sh->heap, l);
     trace_lease_renew (l, "earlier ", when);
     trigger = true;
   }
@@ -201,31 +228,34 @@ void lease_set_expiry (struct lease *l, ddsrt_etime_t when)
   {
     /* not currently scheduled, with a finite new expiry time */
     l->tsched = when;
-    ddsrt_fibheap_insert (&lease_fhdef, &gv->leaseheap, l);
+    ddsrt_fibheap_insert (&lease_fhdef, &sh->heap, l);
     trace_lease_renew (l, "insert ", when);
     trigger = true;
   }
-  ddsrt_mutex_unlock (&gv->leaseheap_lock);
+  ddsrt_mutex_unlock (&sh->lock);
 
-  /* see lease_register() */
+  /* see lease_register(), but here it is worth avoiding the request if the
+     GC thread will wake up in time anyway, as this is done every time
+     a writer with manual liveliness asserts its liveliness after having
+     lost it */
   if (trigger)
-    force_lease_check (gv->gcreq_queue);
+    force_lease_check_if_earlier (gv, when);
 }
 
-int64_t check_and_handle_lease_expiration (struct ddsi_domaingv *gv, ddsrt_etime_t tnowE)
+static int64_t check_and_handle_lease_expiration_shard (struct ddsi_domaingv *gv, struct lease_shard *sh, ddsrt_etime_t tnowE)
 {
   struct lease *l;
-  int64_t delay;
-  ddsrt_mutex_lock (&gv->leaseheap_lock);
-  while ((l = ddsrt_fibheap_min (&lease_fhdef, &gv->leaseheap)) != NULL && l->tsched.v <= tnowE.v)
+  int64_t tnext;
+  ddsrt_mutex_lock (&sh->lock);
+  while ((l = ddsrt_fibheap_min (&lease_fhdef, &sh->heap)) != NULL && l->tsched.v <= tnowE.v)
   {
     ddsi_guid_t g = l->entity->guid;
     enum entity_kind k = l->entity->kind;
 
     assert (l->tsched.v != TSCHED_NOT_ON_HEAP);
-    ddsrt_fibheap_extract_min (&lease_fhdef, &gv->leaseheap);
+    ddsrt_fibheap_extract_min (&lease_fhdef, &sh->heap);
     /* only possible concurrent action is to move tend into the future (renew_lease),
-       all other operations occur with leaseheap_lock held */
+       all other operations occur with the shard's lock held */
     int64_t tend = (int64_t) ddsrt_atomic_ld64 (&l->tend);
     if (tnowE.v < tend)
     {
@@ -234,7 +264,7 @@ int64_t check_and_handle_lease_expiration (struct ddsi_domaingv *gv, ddsrt_etime
         l->tsched.v = TSCHED_NOT_ON_HEAP;
       } else {
         l->tsched.v = tend;
-        ddsrt_fibheap_insert (&lease_fhdef, &gv->leaseheap, l);
+        ddsrt_fibheap_insert (&lease_fhdef, &sh->heap, l);
       }
       continue;
     }
@@ -274,13 +304,13 @@ int64_t check_and_handle_lease_expiration (struct ddsi_domaingv *gv, ddsrt_etime
       {
         GVLOGDISC ("but postponing because privileged pp "PGUIDFMT" is still live\n", PGUID (proxypp->privileged_pp_guid));
         l->tsched = ddsrt_etime_add_duration (tnowE, DDS_MSECS (200));
-        ddsrt_fibheap_insert (&lease_fhdef, &gv->leaseheap, l);
+        ddsrt_fibheap_insert (&lease_fhdef, &sh->heap, l);
         continue;
       }
     }
 
     l->tsched.v = TSCHED_NOT_ON_HEAP;
-    ddsrt_mutex_unlock (&gv->leaseheap_lock);
+    ddsrt_mutex_unlock (&sh->lock);
 
     switch (k)
     {
@@ -300,11 +330,29 @@ int64_t check_and_handle_lease_expiration (struct ddsi_domaingv *gv, ddsrt_etime
         assert (false);
         break;
     }
-    ddsrt_mutex_lock (&gv->leaseheap_lock);
+    ddsrt_mutex_lock (&sh->lock);
   }
 
-  delay = (l == NULL) ? DDS_INFINITY : (l->tsched.v - tnowE.v);
-  ddsrt_mutex_unlock (&gv->leaseheap_lock);
-  return delay;
+  tnext = (l == NULL) ? DDS_NEVER : l->tsched.v;
+  ddsrt_mutex_unlock (&sh->lock);
+  return tnext;
+}
+
+int64_t check_and_handle_lease_expiration (struct ddsi_domaingv *gv, ddsrt_etime_t tnowE)
+{
+  /* Any lease that is moved forward while the shards are being checked
+     needs to trigger a new check, which it does by finding that the next
+     check is not scheduled (see force_lease_check_if_earlier).  The next
+     check is then due when the earliest lease of any shard expires. */
+  int64_t tnext = DDS_NEVER;
+  ddsrt_atomic_st64 (&gv->leaseheap_tcheck, (uint64_t) DDS_NEVER);
+  for (uint32_t i = 0; i < LEASEHEAP_NSHARDS; i++)
+  {
+    const int64_t t = check_and_handle_lease_expiration_shard (gv, &gv->leaseheap[i], tnowE);
+    if (t < tnext)
+      tnext = t;
+  }
+  ddsrt_atomic_st64 (&gv->leaseheap_tcheck, (uint64_t) tnext);
+  return (tnext == DDS_NEVER) ? DDS_INFINITY : (tnext - tnowE.v);
 }
 
@@ -19,12 +19,12 @@
 #include "dds/ddsi/q_misc.h"
 #include "dds/ddsi/q_qosmatch.h"
 
-static int is_wildcard_partition (const char *str)
+int is_wildcard_partition (const char *str)
 {
   return strchr (str, '*') || strchr (str, '?');
 }
 
-static int partition_patmatch_p (const char *pat, const char *name)
+int partition_patmatch_p (const char *pat, const char *name)
 {
   /* pat may be a wildcard expression, name must not be */
   if (!is_wildcard_partition (pat))
@@ -166,6 +166,12 @@ bool qos_match_mask_p (
     *wr_typeid_req_lookup = false;
 #endif
 
+#ifdef DDS_HAS_TYPE_DISCOVERY
+  /* type consistency enforcement is a reader-only policy */
+  const bool force_type_validation =
+    (mask & rd_qos->present & QP_TYPE_CONSISTENCY_ENFORCEMENT) && rd_qos->type_consistency.force_type_validation;
+#endif
+
   mask &= rd_qos->present & wr_qos->present;
   *reason = DDS_INVALID_QOS_POLICY_ID;
   if ((mask & QP_TOPIC_NAME) && strcmp (rd_qos->topic_name, wr_qos->topic_name) != 0)
@@ -179,7 +185,7 @@ bool qos_match_mask_p (
     // Type id missing on either or both: automatic failure if "force type validation"
     // is set.  If it is missing for one, there is no point in requesting it for the
     // other (it wouldn't be inspected anyway).
-    if (rd_qos->type_consistency.force_type_validation)
+    if (force_type_validation)
     {
       *reason = DDS_TYPE_CONSISTENCY_ENFORCEMENT_QOS_POLICY_ID;
       return false;
@@ -2461,6 +2461,7 @@ struct nn_dqueue {
   ddsrt_mutex_t lock;
   ddsrt_cond_t cond;
   nn_dqueue_handler_t handler;
+  nn_dqueue_batch_handler_t batch_handler;
   void *handler_arg;
 
   struct nn_rsample_chain sc;
@@ -2470,6 +2471,10 @@ struct nn_dqueue {
   char *name;
   uint32_t max_samples;
   ddsrt_atomic_uint32_t nof_samples;
+
+  /* statistics, protected by lock */
+  uint32_t max_nof_samples;
+  uint64_t nof_enqueued;
 };
 
 enum dqueue_elem_kind {
@@ -2598,6 +2603,11 @@ static uint32_t dqueue_thread (struct nn_dqueue *q)
       }
     }
 
+    /* everything that was pending has been processed, allow the handler
+       to complete work it deferred while processing the batch */
+    if (q->batch_handler)
+      q->batch_handler (q->handler_arg);
+
     thread_state_asleep (ts1);
     ddsrt_mutex_lock (&q->lock);
   }
@@ -2615,7 +2625,10 @@ struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *g
     goto fail_name;
   q->max_samples = max_samples;
   ddsrt_atomic_st32 (&q->nof_samples, 0);
+  q->max_nof_samples = 0;
+  q->nof_enqueued = 0;
   q->handler = handler;
+  q->batch_handler = NULL;
   q->handler_arg = arg;
   q->sc.first = q->sc.last = NULL;
   q->gv = (struct ddsi_domaingv *) gv;
@@ -2631,6 +2644,13 @@ struct nn_dqueue *nn_dqueue_new (const char *name, const struct ddsi_domaingv *g
   return NULL;
 }
 
+void nn_dqueue_set_batch_handler (struct nn_dqueue *q, nn_dqueue_batch_handler_t batch_handler)
+{
+  /* must be set before starting the thread */
+  assert (q->ts == NULL);
+  q->batch_handler = batch_handler;
+}
+
 bool nn_dqueue_start (struct nn_dqueue *q)
 {
   char *thrname;
@@ -2644,6 +2664,14 @@ bool nn_dqueue_start (struct nn_dqueue *q)
   return ret == DDS_RETCODE_OK;
 }
 
+static void nn_dqueue_add_samples_locked (struct nn_dqueue *q, uint32_t n)
+{
+  const uint32_t count = ddsrt_atomic_add32_nv (&q->nof_samples, n);
+  if (count > q->max_nof_samples)
+    q->max_nof_samples = count;
+  q->nof_enqueued += n;
+}
+
 static int nn_dqueue_enqueue_locked (struct nn_dqueue *q, struct nn_rsample_chain *sc)
 {
   int must_signal;
@@ -2668,7 +2696,7 @@ bool nn_dqueue_enqueue_deferred_wakeup (struct nn_dqueue *q, struct nn_rsample_c
   assert (sc->first);
   assert (sc->last->next == NULL);
   ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, (uint32_t) rres);
+  nn_dqueue_add_samples_locked (q, (uint32_t) rres);
   signal = nn_dqueue_enqueue_locked (q, sc);
   ddsrt_mutex_unlock (&q->lock);
   return signal;
@@ -2687,7 +2715,7 @@ void nn_dqueue_enqueue (struct nn_dqueue *q, struct nn_rsample_chain *sc, nn_reo
   assert (sc->first);
   assert (sc->last->next == NULL);
   ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, (uint32_t) rres);
+  nn_dqueue_add_samples_locked (q, (uint32_t) rres);
   if (nn_dqueue_enqueue_locked (q, sc))
     ddsrt_cond_broadcast (&q->cond);
   ddsrt_mutex_unlock (&q->lock);
@@ -2706,7 +2734,7 @@ static int nn_dqueue_enqueue_bubble_locked (struct nn_dqueue *q, struct nn_dqueu
 static void nn_dqueue_enqueue_bubble (struct nn_dqueue *q, struct nn_dqueue_bubble *b)
 {
   ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_inc32 (&q->nof_samples);
+  nn_dqueue_add_samples_locked (q, 1);
   if (nn_dqueue_enqueue_bubble_locked (q, b))
     ddsrt_cond_broadcast (&q->cond);
   ddsrt_mutex_unlock (&q->lock);
@@ -2736,7 +2764,7 @@ void nn_dqueue_enqueue1 (struct nn_dqueue *q, const ddsi_guid_t *rdguid, struct
   assert (sc->first);
   assert (sc->last->next == NULL);
   ddsrt_mutex_lock (&q->lock);
-  ddsrt_atomic_add32 (&q->nof_samples, 1 + (uint32_t) rres);
+  nn_dqueue_add_samples_locked (q, 1 + (uint32_t) rres);
   if (nn_dqueue_enqueue_bubble_locked (q, b))
     ddsrt_cond_broadcast (&q->cond);
   (void) nn_dqueue_enqueue_locked (q, sc);
@@ -2770,6 +2798,20 @@ void nn_dqueue_wait_until_empty_if_full (struct nn_dqueue *q)
   }
 }
 
+const char *nn_dqueue_name (const struct nn_dqueue *q)
+{
+  return q->name;
+}
+
+void nn_dqueue_get_stats (struct nn_dqueue *q, struct nn_dqueue_stats *st)
+{
+  ddsrt_mutex_lock (&q->lock);
+  st->nof_samples = ddsrt_atomic_ld32 (&q->nof_samples);
+  st->max_nof_samples = q->max_nof_samples;
+  st->nof_enqueued = q->nof_enqueued;
+  ddsrt_mutex_unlock (&q->lock);
+}
+
 void nn_dqueue_free (struct nn_dqueue *q)
 {
   /* There must not be any thread enqueueing things anymore at this
@@ -56,6 +56,7 @@
 #include "dds/ddsi/ddsi_serdata_default.h" /* FIXME: get rid of this */
 #include "dds/ddsi/ddsi_security_omg.h"
 #include "dds/ddsi/ddsi_acknack.h"
+#include "dds/ddsi/ddsi_filter_expr.h"
 
 #include "dds/ddsi/sysdeps.h"
 #include "dds__whc.h"
@@ -953,7 +954,7 @@ static int handle_AckNack (struct receiver_state *rst, ddsrt_etime_t tnow, const
         if (!wr->retransmitting && sample.unacked)
           writer_set_retransmitting (wr);
 
-        if (rst->gv->config.retransmit_merging != DDSI_REXMIT_MERGE_NEVER && rn->assumed_in_sync && !prd->filter)
+        if (rst->gv->config.retransmit_merging != DDSI_REXMIT_MERGE_NEVER && rn->assumed_in_sync && !prd->filter && !rn->filter)
         {
           /* send retransmit to all receivers, but skip if recently done */
           ddsrt_mtime_t tstamp = ddsrt_time_monotonic ();
@@ -983,9 +984,10 @@ static int handle_AckNack (struct receiver_state *rst, ddsrt_etime_t tnow, const
         }
         else
         {
-          /* Is this a volatile reader with a filter?
+          /* Is this a volatile reader with a filter or a reader with a content filter?
            * If so, call the filter to see if we should re-arrange the sequence gap when needed. */
-          if (prd->filter && !prd->filter (wr, prd, sample.serdata))
+          if ((prd->filter && !prd->filter (wr, prd, sample.serdata)) ||
+              (rn->filter && !ddsi_filter_expr_eval_serdata (rn->filter, sample.serdata)))
             nn_gap_info_update (rst->gv, &gi, seqbase + i);
           else
           {
@@ -3159,11 +3161,187 @@ malformed:
   return -1;
 }
 
-static bool do_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool)
+static bool accept_rtps_header (struct ddsi_domaingv *gv, unsigned char *buff, ssize_t sz, const ddsi_locator_t *srcloc)
+{
+  Header_t *hdr = (Header_t *) buff;
+  if ((size_t)sz < RTPS_MESSAGE_HEADER_SIZE || *(uint32_t *)buff != NN_PROTOCOLID_AS_UINT32)
+  {
+    /* discard packets that are really too small or don't have magic cookie */
+    return false;
+  }
+  else if (hdr->version.major != RTPS_MAJOR || (hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+  {
+    if ((hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
+      GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu\n, version mismatch: %d.%d\n",
+               PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, hdr->version.major, hdr->version.minor);
+    if (DDSI_SC_PEDANTIC_P (gv->config))
+      malformed_packet_received_nosubmsg (gv, buff, sz, "header", hdr->vendorid);
+    return false;
+  }
+  else
+  {
+    hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
+    if (gv->logconfig.c.mask & DDS_LC_TRACE)
+    {
+      char addrstr[DDSI_LOCSTRLEN];
+      ddsi_locator_to_string(addrstr, sizeof(addrstr), srcloc);
+      GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu from %s\n",
+               PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, addrstr);
+    }
+    return true;
+  }
+}
+
+static bool handle_rtps_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool, struct nn_rmsg *rmsg, ssize_t sz, const ddsi_locator_t *srcloc)
+{
+  unsigned char *buff = (unsigned char *) NN_RMSG_PAYLOAD (rmsg);
+  Header_t *hdr = (Header_t *) buff;
+
+  if (sz > 0 && !gv->deaf)
+  {
+    nn_rmsg_setsize (rmsg, (uint32_t) sz);
+    assert (thread_is_asleep ());
+
+    if (accept_rtps_header (gv, buff, sz, srcloc))
+    {
+      nn_rtps_msg_state_t res = decode_rtps_message (ts1, gv, &rmsg, &hdr, &buff, &sz, rbpool, conn->m_stream);
+      if (res != NN_RTPS_MSG_STATE_ERROR)
+      {
+        handle_submsg_sequence (ts1, gv, conn, srcloc, ddsrt_time_wallclock (), ddsrt_time_elapsed (), &hdr->guid_prefix, guidprefix, buff, (size_t) sz, buff + RTPS_MESSAGE_HEADER_SIZE, rmsg, res == NN_RTPS_MSG_STATE_ENCODED);
+      }
+      else
+      {
+        /* drop message */
+        sz = 1;
+      }
+    }
+  }
+  nn_rmsg_commit (rmsg);
+  return (sz > 0);
+}
+
+struct recv_batch {
+  uint32_t nbufs;
+  unsigned char *storage;
+  struct ddsi_tran_recvbuf *bufs;
+  struct nn_rtps_decode_job *jobs;
+  uint32_t *jobidx; /* index in bufs of each job */
+};
+
+static size_t max_packet_size (const struct ddsi_domaingv *gv)
 {
   /* UDP max packet size is 64kB */
+  return gv->config.rmsg_chunk_size < 65536 ? gv->config.rmsg_chunk_size : 65536;
+}
+
+static struct recv_batch *recv_batch_new (const struct ddsi_domaingv *gv)
+{
+#if DDSRT_HAVE_RECVMMSG
+  /* Batching means datagrams are received into a staging area first and then copied into
+     an rmsg: the rbufpool only allows a single uncommitted rmsg at a time and processing a
+     message can extend it.  The copy is cheap compared to a system call for small packets. */
+  const uint32_t nbufs = (gv->config.recv_batch_size > 64) ? 64 : gv->config.recv_batch_size;
+  if (nbufs <= 1)
+    return NULL;
+  const size_t maxsz = max_packet_size (gv);
+  struct recv_batch *batch = ddsrt_malloc (sizeof (*batch));
+  batch->nbufs = nbufs;
+  batch->storage = ddsrt_malloc (nbufs * maxsz);
+  batch->bufs = ddsrt_malloc (nbufs * sizeof (*batch->bufs));
+  batch->jobs = ddsrt_malloc (nbufs * sizeof (*batch->jobs));
+  batch->jobidx = ddsrt_malloc (nbufs * sizeof (*batch->jobidx));
+  for (uint32_t i = 0; i < nbufs; i++)
+  {
+    batch->bufs[i].buf = batch->storage + i * maxsz;
+    batch->bufs[i].len = maxsz;
+    batch->bufs[i].size = 0;
+  }
+  return batch;
+#else
+  (void) gv;
+  return NULL;
+#endif
+}
+
+static void recv_batch_free (struct recv_batch *batch)
+{
+  if (batch)
+  {
+    ddsrt_free (batch->jobidx);
+    ddsrt_free (batch->jobs);
+    ddsrt_free (batch->bufs);
+    ddsrt_free (batch->storage);
+    ddsrt_free (batch);
+  }
+}
+
+static bool do_packet_batch (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool, struct recv_batch *batch)
+{
+  const ssize_t n = ddsi_conn_read_multi (conn, batch->nbufs, batch->bufs);
+  if (n <= 0 || gv->deaf)
+    return (n > 0);
 
-  const size_t maxsz = gv->config.rmsg_chunk_size < 65536 ? gv->config.rmsg_chunk_size : 65536;
+  /* Check the headers and decode all messages with RTPS-level protection in one go, so that
+     the decoding can be spread over multiple threads.  The messages are then handled in the
+     order in which they were received. */
+  uint32_t njobs = 0;
+  for (ssize_t i = 0; i < n; i++)
+  {
+    struct ddsi_tran_recvbuf *rb = &batch->bufs[i];
+    if (rb->size > 0 && accept_rtps_header (gv, rb->buf, rb->size, &rb->srcloc))
+    {
+      batch->jobs[njobs].buf = rb->buf;
+      batch->jobs[njobs].sz = (size_t) rb->size;
+      batch->jobs[njobs].dstbuf = NULL;
+      batch->jobs[njobs].dstlen = 0;
+      batch->jobidx[njobs] = (uint32_t) i;
+      njobs++;
+    }
+  }
+  decode_rtps_messages (ts1, gv, njobs, batch->jobs);
+
+  for (uint32_t j = 0; j < njobs; j++)
+  {
+    struct nn_rtps_decode_job *job = &batch->jobs[j];
+    const struct ddsi_tran_recvbuf *rb = &batch->bufs[batch->jobidx[j]];
+    struct nn_rmsg *rmsg;
+    if (job->state == NN_RTPS_MSG_STATE_ERROR)
+    {
+      /* the keys needed for decoding it may have arrived in a preceding message of the batch */
+      decode_rtps_messages (ts1, gv, 1, job);
+    }
+    if ((rmsg = nn_rmsg_new (rbpool)) == NULL)
+    {
+      for (; j < njobs; j++)
+      {
+        ddsrt_free (batch->jobs[j].dstbuf);
+        batch->jobs[j].dstbuf = NULL;
+      }
+      return false;
+    }
+    const unsigned char *src = (job->state == NN_RTPS_MSG_STATE_ENCODED) ? job->dstbuf : job->buf;
+    const size_t sz = (job->state == NN_RTPS_MSG_STATE_ENCODED) ? job->dstlen : job->sz;
+    unsigned char * const buff = (unsigned char *) NN_RMSG_PAYLOAD (rmsg);
+    memcpy (buff, src, sz);
+    ddsrt_free (job->dstbuf);
+    job->dstbuf = NULL;
+    nn_rmsg_setsize (rmsg, (uint32_t) sz);
+    if (job->state != NN_RTPS_MSG_STATE_ERROR)
+    {
+      const Header_t *hdr = (const Header_t *) buff;
+      handle_submsg_sequence (ts1, gv, conn, &rb->srcloc, ddsrt_time_wallclock (), ddsrt_time_elapsed (), &hdr->guid_prefix, guidprefix, buff, sz, buff + RTPS_MESSAGE_HEADER_SIZE, rmsg, job->state == NN_RTPS_MSG_STATE_ENCODED);
+    }
+    nn_rmsg_commit (rmsg);
+  }
+  return true;
+}
+
+static bool do_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *gv, ddsi_tran_conn_t conn, const ddsi_guid_prefix_t *guidprefix, struct nn_rbufpool *rbpool, struct recv_batch *batch)
+{
+  if (batch && !conn->m_stream && ddsi_conn_supports_read_multi (conn))
+    return do_packet_batch (ts1, gv, conn, guidprefix, rbpool, batch);
+
+  const size_t maxsz = max_packet_size (gv);
   const size_t ddsi_msg_len_size = 8;
   const size_t stream_hdr_size = RTPS_MESSAGE_HEADER_SIZE + ddsi_msg_len_size;
   ssize_t sz;
@@ -3244,48 +3422,7 @@ static bool do_packet (struct thread_state1 * const ts1, struct ddsi_domaingv *g
     sz = ddsi_conn_read (conn, buff, buff_len, true, &srcloc);
   }
 
-  if (sz > 0 && !gv->deaf)
-  {
-    nn_rmsg_setsize (rmsg, (uint32_t) sz);
-    assert (thread_is_asleep ());
-
-    if ((size_t)sz < RTPS_MESSAGE_HEADER_SIZE || *(uint32_t *)buff != NN_PROTOCOLID_AS_UINT32)
-    {
-      /* discard packets that are really too small or don't have magic cookie */
-    }
-    else if (hdr->version.major != RTPS_MAJOR || (hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
-    {
-      if ((hdr->version.major == RTPS_MAJOR && hdr->version.minor < RTPS_MINOR_MINIMUM))
-        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu\n, version mismatch: %d.%d\n",
-                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, hdr->version.major, hdr->version.minor);
-      if (DDSI_SC_PEDANTIC_P (gv->config))
-        malformed_packet_received_nosubmsg (gv, buff, sz, "header", hdr->vendorid);
-    }
-    else
-    {
-      hdr->guid_prefix = nn_ntoh_guid_prefix (hdr->guid_prefix);
-
-      if (gv->logconfig.c.mask & DDS_LC_TRACE)
-      {
-        char addrstr[DDSI_LOCSTRLEN];
-        ddsi_locator_to_string(addrstr, sizeof(addrstr), &srcloc);
-        GVTRACE ("HDR(%"PRIx32":%"PRIx32":%"PRIx32" vendor %d.%d) len %lu from %s\n",
-                 PGUIDPREFIX (hdr->guid_prefix), hdr->vendorid.id[0], hdr->vendorid.id[1], (unsigned long) sz, addrstr);
-      }
-      nn_rtps_msg_state_t res = decode_rtps_message (ts1, gv, &rmsg, &hdr, &buff, &sz, rbpool, conn->m_stream);
-      if (res != NN_RTPS_MSG_STATE_ERROR)
-      {
-        handle_submsg_sequence (ts1, gv, conn, &srcloc, ddsrt_time_wallclock (), ddsrt_time_elapsed (), &hdr->guid_prefix, guidprefix, buff, (size_t) sz, buff + RTPS_MESSAGE_HEADER_SIZE, rmsg, res == NN_RTPS_MSG_STATE_ENCODED);
-      }
-      else
-      {
-        /* drop message */
-        sz = 1;
-      }
-    }
-  }
-  nn_rmsg_commit (rmsg);
-  return (sz > 0);
+  return handle_rtps_packet (ts1, gv, conn, guidprefix, rbpool, rmsg, sz, &srcloc);
 }
 
 struct local_participant_desc
@@ -3461,8 +3598,18 @@ void trigger_recv_threads (const struct ddsi_domaingv *gv)
         iov.iov_base = &dummy;
         iov.iov_len = 1;
         GVTRACE ("trigger_recv_threads: %"PRIu32" single %s\n", i, ddsi_locator_to_string (buf, sizeof (buf), dst));
-        // all sockets listen on at least the interfaces used for transmitting (at least for now)
-        ddsi_conn_write (gv->xmit_conns[0], dst, 1, &iov, 0);
+        // all sockets listen on at least the interfaces used for transmitting (at least for now),
+        // but the transmit conn has to be one for the kind of locator
+        ddsi_tran_conn_t conn = gv->xmit_conns[0];
+        for (int k = 0; k < gv->n_interfaces; k++)
+        {
+          if (gv->xmit_conns[k] && ddsi_factory_supports (gv->xmit_conns[k]->m_factory, dst->kind))
+          {
+            conn = gv->xmit_conns[k];
+            break;
+          }
+        }
+        ddsi_conn_write (conn, dst, 1, &iov, 0);
         break;
       }
       case RTM_MANY: {
@@ -3482,6 +3629,7 @@ uint32_t recv_thread (void *vrecv_thread_arg)
   struct nn_rbufpool *rbpool = recv_thread_arg->rbpool;
   os_sockWaitset waitset = recv_thread_arg->mode == RTM_MANY ? recv_thread_arg->u.many.ws : NULL;
   ddsrt_mtime_t next_thread_cputime = { 0 };
+  struct recv_batch *batch = recv_batch_new (gv);
 
   nn_rbufpool_setowner (rbpool, ddsrt_thread_self ());
   if (waitset == NULL)
@@ -3490,7 +3638,7 @@ uint32_t recv_thread (void *vrecv_thread_arg)
     while (ddsrt_atomic_ld32 (&gv->rtps_keepgoing))
     {
       LOG_THREAD_CPUTIME (&gv->logconfig, next_thread_cputime);
-      (void) do_packet (ts1, gv, conn, NULL, rbpool);
+      (void) do_packet (ts1, gv, conn, NULL, rbpool, batch);
     }
   }
   else
@@ -3568,7 +3716,7 @@ uint32_t recv_thread (void *vrecv_thread_arg)
           else
             guid_prefix = &lps.ps[(unsigned)idx - num_fixed].guid_prefix;
           /* Process message and clean out connection if failed or closed */
-          if (!do_packet (ts1, gv, conn, guid_prefix, rbpool) && !conn->m_connless)
+          if (!do_packet (ts1, gv, conn, guid_prefix, rbpool, batch) && !conn->m_connless)
             ddsi_conn_free (conn);
         }
       }
@@ -3576,6 +3724,7 @@ uint32_t recv_thread (void *vrecv_thread_arg)
     local_participant_set_fini (&lps);
   }
 
+  recv_batch_free (batch);
   GVTRACE ("done\n");
   return 0;
 }
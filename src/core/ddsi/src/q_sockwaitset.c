@@ -27,9 +27,12 @@
 #define MODE_KQUEUE 1
 #define MODE_SELECT 2
 #define MODE_WFMEVS 3
+#define MODE_EPOLL 4
 
 #if defined __APPLE__
 #define MODE_SEL MODE_KQUEUE
+#elif defined __linux__ && !LWIP_SOCKET
+#define MODE_SEL MODE_EPOLL
 #elif defined WINCE
 #define MODE_SEL MODE_WFMEVS
 #else
@@ -283,6 +286,261 @@ int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, ddsi_tran_conn_t *conn)
   return -1;
 }
 
+#elif MODE_SEL == MODE_EPOLL
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/* Level-triggered epoll: the receive thread reads a single message for each event, so
+   edge-triggering would require draining the socket first.  The event data holds the
+   slot in the entries array and the file descriptor, so that stale events for slots
+   that were removed (or reused) in the meantime can be recognised and skipped. */
+
+struct os_sockWaitsetCtx
+{
+  os_sockWaitset ws;
+  struct epoll_event *evs;
+  uint32_t nevs;
+  uint32_t evs_sz;
+  uint32_t index; /* cursor for enumerating */
+};
+
+struct entry {
+  uint32_t index;
+  int fd;
+  ddsi_tran_conn_t conn;
+};
+
+struct os_sockWaitset
+{
+  int epoll;
+  int evfd; /* eventfd used for triggering */
+  ddsrt_atomic_uint32_t sz;
+  struct entry *entries;
+  struct os_sockWaitsetCtx ctx; /* set of descriptors being handled */
+  ddsrt_mutex_t lock; /* for add/delete */
+};
+
+static uint64_t epoll_data_from_entry (uint32_t slot, int fd)
+{
+  return ((uint64_t) slot << 32) | (uint32_t) fd;
+}
+
+static int epoll_add_entry (int epfd, uint32_t slot, int fd)
+{
+  struct epoll_event ev;
+  memset (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ev.data.u64 = epoll_data_from_entry (slot, fd);
+  return epoll_ctl (epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static int add_entry_locked (os_sockWaitset ws, ddsi_tran_conn_t conn, int fd)
+{
+  uint32_t idx, fidx, sz, n;
+  assert (fd >= 0);
+  sz = ddsrt_atomic_ld32 (&ws->sz);
+  for (idx = 0, fidx = UINT32_MAX, n = 0; idx < sz; idx++)
+  {
+    if (ws->entries[idx].fd == -1)
+      fidx = (idx < fidx) ? idx : fidx;
+    else if (ws->entries[idx].conn == conn)
+      return 0;
+    else
+      n++;
+  }
+
+  if (fidx == UINT32_MAX)
+  {
+    const uint32_t newsz = sz + WAITSET_DELTA;
+    ws->entries = ddsrt_realloc (ws->entries, newsz * sizeof (*ws->entries));
+    for (idx = sz; idx < newsz; idx++)
+      ws->entries[idx].fd = -1;
+    ddsrt_atomic_st32 (&ws->sz, newsz);
+    fidx = sz;
+  }
+  if (epoll_add_entry (ws->epoll, fidx, fd) == -1)
+    return -1;
+  ws->entries[fidx].conn = conn;
+  ws->entries[fidx].fd = fd;
+  ws->entries[fidx].index = n;
+  return 1;
+}
+
+os_sockWaitset os_sockWaitsetNew (void)
+{
+  const uint32_t sz = WAITSET_DELTA;
+  os_sockWaitset ws;
+  uint32_t i;
+  if ((ws = ddsrt_malloc (sizeof (*ws))) == NULL)
+    goto fail_waitset;
+  ddsrt_atomic_st32 (&ws->sz, sz);
+  if ((ws->entries = ddsrt_malloc (sz * sizeof (*ws->entries))) == NULL)
+    goto fail_entries;
+  for (i = 0; i < sz; i++)
+    ws->entries[i].fd = -1;
+  ws->ctx.ws = ws;
+  ws->ctx.nevs = 0;
+  ws->ctx.index = 0;
+  ws->ctx.evs_sz = sz;
+  if ((ws->ctx.evs = ddsrt_malloc (ws->ctx.evs_sz * sizeof (*ws->ctx.evs))) == NULL)
+    goto fail_ctx_evs;
+  if ((ws->epoll = epoll_create1 (EPOLL_CLOEXEC)) == -1)
+    goto fail_epoll;
+  if ((ws->evfd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1)
+    goto fail_eventfd;
+  if (add_entry_locked (ws, NULL, ws->evfd) < 0)
+    goto fail_add_trigger;
+  assert (ws->entries[0].fd == ws->evfd);
+  ddsrt_mutex_init (&ws->lock);
+  return ws;
+
+fail_add_trigger:
+  close (ws->evfd);
+fail_eventfd:
+  close (ws->epoll);
+fail_epoll:
+  ddsrt_free (ws->ctx.evs);
+fail_ctx_evs:
+  ddsrt_free (ws->entries);
+fail_entries:
+  ddsrt_free (ws);
+fail_waitset:
+  return NULL;
+}
+
+void os_sockWaitsetFree (os_sockWaitset ws)
+{
+  ddsrt_mutex_destroy (&ws->lock);
+  close (ws->evfd);
+  close (ws->epoll);
+  ddsrt_free (ws->entries);
+  ddsrt_free (ws->ctx.evs);
+  ddsrt_free (ws);
+}
+
+void os_sockWaitsetTrigger (os_sockWaitset ws)
+{
+  const uint64_t one = 1;
+  if (write (ws->evfd, &one, sizeof (one)) != (ssize_t) sizeof (one))
+  {
+    DDS_WARNING("os_sockWaitsetTrigger: write failed on trigger eventfd, errno = %d\n", errno);
+  }
+}
+
+int os_sockWaitsetAdd (os_sockWaitset ws, ddsi_tran_conn_t conn)
+{
+  int ret;
+  ddsrt_mutex_lock (&ws->lock);
+  ret = add_entry_locked (ws, conn, ddsi_conn_handle (conn));
+  ddsrt_mutex_unlock (&ws->lock);
+  return ret;
+}
+
+void os_sockWaitsetPurge (os_sockWaitset ws, unsigned index)
+{
+  /* Sockets may have been closed by the time Purge is called, in which case the kernel
+     has already dropped them from the epoll set and the file descriptors may have been
+     reused.  Replacing the epoll instance is therefore safer than deleting entries */
+  uint32_t i, sz;
+  ddsrt_mutex_lock (&ws->lock);
+  sz = ddsrt_atomic_ld32 (&ws->sz);
+  close (ws->epoll);
+  if ((ws->epoll = epoll_create1 (EPOLL_CLOEXEC)) == -1)
+    abort (); /* FIXME */
+  for (i = 0; i <= index; i++)
+  {
+    assert (ws->entries[i].fd >= 0);
+    if (epoll_add_entry (ws->epoll, i, ws->entries[i].fd) == -1)
+      abort (); /* FIXME */
+  }
+  for (; i < sz; i++)
+  {
+    ws->entries[i].conn = NULL;
+    ws->entries[i].fd = -1;
+  }
+  ddsrt_mutex_unlock (&ws->lock);
+}
+
+void os_sockWaitsetRemove (os_sockWaitset ws, ddsi_tran_conn_t conn)
+{
+  const int fd = ddsi_conn_handle (conn);
+  uint32_t i, sz;
+  assert (fd >= 0);
+  ddsrt_mutex_lock (&ws->lock);
+  sz = ddsrt_atomic_ld32 (&ws->sz);
+  for (i = 1; i < sz; i++)
+    if (ws->entries[i].fd == fd)
+      break;
+  if (i < sz)
+  {
+    /* closing the socket removes it from the set as well, so failure is not an error */
+    (void) epoll_ctl (ws->epoll, EPOLL_CTL_DEL, fd, NULL);
+    ws->entries[i].conn = NULL;
+    ws->entries[i].fd = -1;
+  }
+  ddsrt_mutex_unlock (&ws->lock);
+}
+
+os_sockWaitsetCtx os_sockWaitsetWait (os_sockWaitset ws)
+{
+  /* if the array of events is smaller than the number of file descriptors in the
+     set, things will still work fine, as the kernel will just return what can
+     be stored, and the set will be grown on the next call */
+  uint32_t ws_sz = ddsrt_atomic_ld32 (&ws->sz);
+  int nevs;
+  if (ws->ctx.evs_sz < ws_sz)
+  {
+    ws->ctx.evs_sz = ws_sz;
+    ws->ctx.evs = ddsrt_realloc (ws->ctx.evs, ws_sz * sizeof(*ws->ctx.evs));
+  }
+  nevs = epoll_wait (ws->epoll, ws->ctx.evs, (int) ws->ctx.evs_sz, -1);
+  if (nevs < 0)
+  {
+    if (errno == EINTR)
+      nevs = 0;
+    else
+    {
+      DDS_WARNING("os_sockWaitsetWait: epoll_wait failed, errno = %d\n", errno);
+      return NULL;
+    }
+  }
+  ws->ctx.nevs = (uint32_t) nevs;
+  ws->ctx.index = 0;
+  return &ws->ctx;
+}
+
+int os_sockWaitsetNextEvent (os_sockWaitsetCtx ctx, ddsi_tran_conn_t *conn)
+{
+  os_sockWaitset const ws = ctx->ws;
+  while (ctx->index < ctx->nevs)
+  {
+    const uint64_t data = ctx->evs[ctx->index++].data.u64;
+    const uint32_t slot = (uint32_t) (data >> 32);
+    const int fd = (int) (uint32_t) data;
+    if (slot == 0)
+    {
+      /* trigger eventfd, reset & try again */
+      uint64_t dummy;
+      (void) read (fd, &dummy, sizeof (dummy));
+      continue;
+    }
+    /* lock protects against concurrent growing of the entries array and removals */
+    ddsrt_mutex_lock (&ws->lock);
+    if (slot < ddsrt_atomic_ld32 (&ws->sz) && ws->entries[slot].fd == fd && ws->entries[slot].conn != NULL)
+    {
+      const uint32_t index = ws->entries[slot].index;
+      *conn = ws->entries[slot].conn;
+      ddsrt_mutex_unlock (&ws->lock);
+      return (int) (index - 1);
+    }
+    ddsrt_mutex_unlock (&ws->lock);
+  }
+  return -1;
+}
+
 #elif MODE_SEL == MODE_WFMEVS
 
 struct os_sockWaitsetCtx
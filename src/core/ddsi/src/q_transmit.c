@@ -33,6 +33,7 @@
 #include "dds/ddsi/q_unused.h"
 #include "dds/ddsi/q_hbcontrol.h"
 #include "dds/ddsi/q_receive.h"
+#include "dds/ddsi/ddsi_filter_expr.h"
 #include "dds/ddsi/q_lease.h"
 #include "dds/ddsi/ddsi_tkmap.h"
 #include "dds/ddsi/ddsi_serdata.h"
@@ -1173,6 +1174,46 @@ prd_is_deleting:
   return r;
 }
 
+static bool content_filters_reject_sample (const struct writer *wr, const struct ddsi_serdata *serdata)
+{
+  /* Skipping the transmission is only possible if every matching proxy reader would
+     discard the sample: otherwise it has to be sent anyway and the remaining readers
+     will filter it themselves */
+  if (wr->num_content_filtered_readers == 0 || wr->num_content_filtered_readers < wr->num_readers)
+    return false;
+  ddsrt_avl_iter_t it;
+  for (const struct wr_prd_match *m = ddsrt_avl_iter_first (&wr_readers_treedef, &wr->readers, &it); m; m = ddsrt_avl_iter_next (&it))
+  {
+    if (m->filter == NULL || ddsi_filter_expr_eval_serdata (m->filter, serdata))
+      return false;
+  }
+  return true;
+}
+
+static void send_content_filter_gaps (struct writer *wr, seqno_t seq)
+{
+  /* Reliable readers need to be told the sample is of no interest to them, or they would
+     not deliver subsequent samples until they requested a retransmit and got a GAP in
+     response */
+  struct ddsi_domaingv * const gv = wr->e.gv;
+  ddsrt_avl_iter_t it;
+  for (const struct wr_prd_match *m = ddsrt_avl_iter_first (&wr_readers_treedef, &wr->readers, &it); m; m = ddsrt_avl_iter_next (&it))
+  {
+    struct proxy_reader *prd;
+    if (!m->is_reliable || m->seq == MAX_SEQ_NUMBER)
+      continue;
+    if ((prd = entidx_lookup_proxy_reader_guid (gv->entity_index, &m->prd_guid)) != NULL)
+    {
+      struct nn_gap_info gi;
+      struct nn_xmsg *gap;
+      nn_gap_info_init (&gi);
+      nn_gap_info_update (gv, &gi, seq);
+      if ((gap = nn_gap_info_create_gap (wr, prd, &gi)) != NULL)
+        qxev_msg (wr->evq, gap);
+    }
+  }
+}
+
 static int write_sample_eot (struct thread_state1 * const ts1, struct nn_xpack *xp, struct writer *wr, struct ddsi_plist *plist, struct ddsi_serdata *serdata, struct ddsi_tkmap_instance *tk, int end_of_txn, int gc_allowed)
 {
   struct ddsi_domaingv const * const gv = wr->e.gv;
@@ -1286,6 +1327,23 @@ static int write_sample_eot (struct thread_state1 * const ts1, struct nn_xpack *
       ddsrt_free (plist);
     }
   }
+  else if (content_filters_reject_sample (wr, serdata))
+  {
+    /* Like "no network destination" below, except that the reliable readers have to be
+       told that they won't be getting this sample */
+    GVTRACE (" filtered");
+    wr->filtered_count++;
+    send_content_filter_gaps (wr, seq);
+    writer_update_seq_xmit (wr, seq);
+    if (wr->heartbeat_xevent)
+      writer_hbcontrol_note_asyncwrite (wr, tnow);
+    ddsrt_mutex_unlock (&wr->e.lock);
+    if (plist != NULL)
+    {
+      ddsi_plist_fini (plist);
+      ddsrt_free (plist);
+    }
+  }
   else if (addrset_empty (wr->as) && (wr->as_group == NULL || addrset_empty (wr->as_group)))
   {
     /* No network destination, so no point in doing all the work involved
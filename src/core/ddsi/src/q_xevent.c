@@ -63,9 +63,20 @@ enum xeventkind
   XEVK_CALLBACK
 };
 
+/* Timed events are stored either in a Fibonacci heap or in a hierarchical
+   timing wheel, selected by Internal/TimedEventQueue.  An event is only
+   ever in one of the two, so the linkage can share the storage. */
+struct xevent_wheelnode {
+  struct xevent *next, *prev;
+  uint32_t list;
+};
+
 struct xevent
 {
-  ddsrt_fibheap_node_t heapnode;
+  union {
+    ddsrt_fibheap_node_t heapnode;
+    struct xevent_wheelnode wheelnode;
+  } qnode;
   struct xeventq *evq;
   ddsrt_mtime_t tsched;
   enum xeventkind kind;
@@ -140,8 +151,33 @@ struct xevent_nt
   } u;
 };
 
+/* The timing wheel has XEVQ_WHEEL_LEVELS levels of XEVQ_WHEEL_SLOTS slots,
+   level 0 slots span a single tick, level 1 slots span XEVQ_WHEEL_SLOTS
+   ticks, &c.  An event is stored at the lowest level where its tick and the
+   current tick share the same slot in the next level up.  Anything beyond
+   the range of the wheel goes into the overflow list.  Events found to be
+   due are moved to the "due" list, from which they are taken in arbitrary
+   order (but never before they are due). */
+#define XEVQ_WHEEL_BITS 8
+#define XEVQ_WHEEL_SLOTS (1u << XEVQ_WHEEL_BITS)
+#define XEVQ_WHEEL_MASK (XEVQ_WHEEL_SLOTS - 1)
+#define XEVQ_WHEEL_LEVELS 4
+#define XEVQ_WHEEL_DUE (XEVQ_WHEEL_LEVELS * XEVQ_WHEEL_SLOTS)
+#define XEVQ_WHEEL_OVERFLOW (XEVQ_WHEEL_DUE + 1)
+#define XEVQ_WHEEL_NLISTS (XEVQ_WHEEL_OVERFLOW + 1)
+
+struct xevent_wheel {
+  int64_t tick;             /* duration of a tick in ns */
+  uint64_t now;             /* current tick, nothing at level 0 is earlier */
+  uint64_t occupied[XEVQ_WHEEL_DUE / 64]; /* non-empty slots */
+  struct xevent *lists[XEVQ_WHEEL_NLISTS];
+};
+
 struct xeventq {
+  enum ddsi_timed_event_queue kind;
   ddsrt_fibheap_t xevents;
+  struct xevent_wheel *wheel;
+  ddsrt_mtime_t twakeup; /* time for which the thread is sleeping, TSCHED_DELETE if it isn't */
   ddsrt_avl_tree_t msg_xevents;
   struct xevent_nt *non_timed_xmit_list_oldest;
   struct xevent_nt *non_timed_xmit_list_newest; /* undefined if ..._oldest == NULL */
@@ -167,7 +203,7 @@ static void handle_nontimed_xevent (struct xevent_nt *xev, struct nn_xpack *xp);
 
 static const ddsrt_avl_treedef_t msg_xevents_treedef = DDSRT_AVL_TREEDEF_INITIALIZER_INDKEY (offsetof (struct xevent_nt, u.msg_rexmit.msg_avlnode), offsetof (struct xevent_nt, u.msg_rexmit.msg), msg_xevents_cmp, 0);
 
-static const ddsrt_fibheap_def_t evq_xevents_fhdef = DDSRT_FIBHEAPDEF_INITIALIZER(offsetof (struct xevent, heapnode), compare_xevent_tsched);
+static const ddsrt_fibheap_def_t evq_xevents_fhdef = DDSRT_FIBHEAPDEF_INITIALIZER(offsetof (struct xevent, qnode.heapnode), compare_xevent_tsched);
 
 static int compare_xevent_tsched (const void *va, const void *vb)
 {
@@ -176,6 +212,273 @@ static int compare_xevent_tsched (const void *va, const void *vb)
   return (a->tsched.v == b->tsched.v) ? 0 : (a->tsched.v < b->tsched.v) ? -1 : 1;
 }
 
+/* TIMED EVENT STORE ***************************************************************/
+
+static uint64_t wheel_tick (const struct xevent_wheel *w, ddsrt_mtime_t t)
+{
+  /* TSCHED_DELETE maps to tick 0, which is always in the past */
+  return (t.v <= 0) ? 0 : (uint64_t) (t.v / w->tick);
+}
+
+static void wheel_link (struct xevent_wheel *w, uint32_t list, struct xevent *ev)
+{
+  struct xevent *head = w->lists[list];
+  ev->qnode.wheelnode.list = list;
+  ev->qnode.wheelnode.prev = NULL;
+  ev->qnode.wheelnode.next = head;
+  if (head)
+    head->qnode.wheelnode.prev = ev;
+  w->lists[list] = ev;
+  if (list < XEVQ_WHEEL_DUE)
+    w->occupied[list / 64] |= (uint64_t) 1 << (list % 64);
+}
+
+static void wheel_unlink (struct xevent_wheel *w, struct xevent *ev)
+{
+  struct xevent_wheelnode * const n = &ev->qnode.wheelnode;
+  if (n->next)
+    n->next->qnode.wheelnode.prev = n->prev;
+  if (n->prev)
+    n->prev->qnode.wheelnode.next = n->next;
+  else if ((w->lists[n->list] = n->next) == NULL && n->list < XEVQ_WHEEL_DUE)
+    w->occupied[n->list / 64] &= ~((uint64_t) 1 << (n->list % 64));
+}
+
+static void wheel_insert (struct xevent_wheel *w, struct xevent *ev)
+{
+  const uint64_t t = wheel_tick (w, ev->tsched);
+  uint32_t list;
+  if (t <= w->now)
+    list = (uint32_t) (w->now & XEVQ_WHEEL_MASK);
+  else
+  {
+    const uint64_t diff = t ^ w->now;
+    uint32_t level = 0;
+    while (level < XEVQ_WHEEL_LEVELS && (diff >> (XEVQ_WHEEL_BITS * (level + 1))) != 0)
+      level++;
+    if (level == XEVQ_WHEEL_LEVELS)
+      list = XEVQ_WHEEL_OVERFLOW;
+    else
+      list = level * XEVQ_WHEEL_SLOTS + (uint32_t) ((t >> (XEVQ_WHEEL_BITS * level)) & XEVQ_WHEEL_MASK);
+  }
+  wheel_link (w, list, ev);
+}
+
+static int32_t wheel_next_occupied (const struct xevent_wheel *w, uint32_t level, uint32_t from)
+{
+  /* index of first non-empty slot at or after "from" at the given level, -1 if none */
+  uint32_t i = from;
+  while (i < XEVQ_WHEEL_SLOTS)
+  {
+    const uint32_t list = level * XEVQ_WHEEL_SLOTS + i;
+    uint64_t bits = w->occupied[list / 64] >> (list % 64);
+    if (bits == 0)
+      i = (i + 64) & ~63u;
+    else
+    {
+      while (!(bits & 1))
+      {
+        bits >>= 1;
+        i++;
+      }
+      return (int32_t) i;
+    }
+  }
+  return -1;
+}
+
+static void wheel_redistribute (struct xevent_wheel *w, uint32_t list)
+{
+  struct xevent *ev = w->lists[list];
+  w->lists[list] = NULL;
+  if (list < XEVQ_WHEEL_DUE)
+    w->occupied[list / 64] &= ~((uint64_t) 1 << (list % 64));
+  while (ev)
+  {
+    struct xevent * const next = ev->qnode.wheelnode.next;
+    wheel_insert (w, ev);
+    ev = next;
+  }
+}
+
+static void wheel_cascade (struct xevent_wheel *w)
+{
+  /* w->now just entered a new level 0 cycle: move the events in the slots
+     of the higher levels that now cover the current tick down, highest level
+     first so that the lower levels pick them up */
+  if ((w->now & ((UINT64_C (1) << (XEVQ_WHEEL_BITS * XEVQ_WHEEL_LEVELS)) - 1)) == 0)
+    wheel_redistribute (w, XEVQ_WHEEL_OVERFLOW);
+  for (uint32_t level = XEVQ_WHEEL_LEVELS - 1; level > 0; level--)
+  {
+    if ((w->now & ((UINT64_C (1) << (XEVQ_WHEEL_BITS * level)) - 1)) == 0)
+      wheel_redistribute (w, level * XEVQ_WHEEL_SLOTS + (uint32_t) ((w->now >> (XEVQ_WHEEL_BITS * level)) & XEVQ_WHEEL_MASK));
+  }
+}
+
+static void wheel_advance (struct xevent_wheel *w, uint64_t target)
+{
+  while (w->now < target)
+  {
+    /* everything in the current slot is in the past once we move on */
+    const uint32_t cur = (uint32_t) (w->now & XEVQ_WHEEL_MASK);
+    struct xevent *ev;
+    int32_t idx;
+    uint64_t next;
+    while ((ev = w->lists[cur]) != NULL)
+    {
+      wheel_unlink (w, ev);
+      wheel_link (w, XEVQ_WHEEL_DUE, ev);
+    }
+    /* skip empty slots, stopping at the end of the cycle to cascade */
+    if ((idx = wheel_next_occupied (w, 0, cur + 1)) >= 0)
+      next = (w->now & ~(uint64_t) XEVQ_WHEEL_MASK) + (uint32_t) idx;
+    else
+      next = (w->now | XEVQ_WHEEL_MASK) + 1;
+    w->now = (next < target) ? next : target;
+    if ((w->now & XEVQ_WHEEL_MASK) == 0)
+      wheel_cascade (w);
+  }
+}
+
+static struct xevent *wheel_extract_due (struct xevent_wheel *w, ddsrt_mtime_t tnow)
+{
+  struct xevent *ev;
+  if (w->lists[XEVQ_WHEEL_DUE] == NULL)
+  {
+    /* the current slot can contain events due later in the same tick */
+    wheel_advance (w, wheel_tick (w, tnow));
+    ev = w->lists[w->now & XEVQ_WHEEL_MASK];
+    while (ev)
+    {
+      struct xevent * const next = ev->qnode.wheelnode.next;
+      if (ev->tsched.v <= tnow.v)
+      {
+        wheel_unlink (w, ev);
+        wheel_link (w, XEVQ_WHEEL_DUE, ev);
+      }
+      ev = next;
+    }
+  }
+  if ((ev = w->lists[XEVQ_WHEEL_DUE]) != NULL)
+    wheel_unlink (w, ev);
+  return ev;
+}
+
+static ddsrt_mtime_t wheel_min_in_list (const struct xevent_wheel *w, uint32_t list)
+{
+  ddsrt_mtime_t tmin = DDSRT_MTIME_NEVER;
+  for (const struct xevent *ev = w->lists[list]; ev; ev = ev->qnode.wheelnode.next)
+    if (ev->tsched.v < tmin.v)
+      tmin = ev->tsched;
+  return tmin;
+}
+
+static ddsrt_mtime_t wheel_earliest (const struct xevent_wheel *w)
+{
+  /* Exact if something is due or scheduled in the current tick, otherwise
+     the start of the first non-empty slot, which is a lower bound.  Waking
+     up early is harmless: the slot then becomes the current one. */
+  const uint32_t cur = (uint32_t) (w->now & XEVQ_WHEEL_MASK);
+  if (w->lists[XEVQ_WHEEL_DUE])
+    return w->lists[XEVQ_WHEEL_DUE]->tsched;
+  if (w->lists[cur])
+    return wheel_min_in_list (w, cur);
+  for (uint32_t level = 0; level < XEVQ_WHEEL_LEVELS; level++)
+  {
+    const uint32_t shift = XEVQ_WHEEL_BITS * level;
+    int32_t idx;
+    if ((idx = wheel_next_occupied (w, level, (uint32_t) ((w->now >> shift) & XEVQ_WHEEL_MASK) + 1)) >= 0)
+    {
+      const uint64_t t = ((w->now >> (shift + XEVQ_WHEEL_BITS)) << (shift + XEVQ_WHEEL_BITS)) | ((uint64_t) idx << shift);
+      return (ddsrt_mtime_t) { (int64_t) t * w->tick };
+    }
+  }
+  return wheel_min_in_list (w, XEVQ_WHEEL_OVERFLOW);
+}
+
+static void xevq_insert (struct xeventq *evq, struct xevent *ev)
+{
+  assert (ev->tsched.v != DDS_NEVER);
+  if (evq->kind == DDSI_TEVQ_HEAP)
+    ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
+  else
+    wheel_insert (evq->wheel, ev);
+}
+
+static void xevq_remove (struct xeventq *evq, struct xevent *ev)
+{
+  assert (ev->tsched.v != DDS_NEVER);
+  if (evq->kind == DDSI_TEVQ_HEAP)
+    ddsrt_fibheap_delete (&evq_xevents_fhdef, &evq->xevents, ev);
+  else
+    wheel_unlink (evq->wheel, ev);
+}
+
+static void xevq_set_earlier (struct xeventq *evq, struct xevent *ev, ddsrt_mtime_t tsched)
+{
+  /* (re)schedules ev at tsched, which must be earlier than the current time if it is scheduled */
+  assert (tsched.v < ev->tsched.v);
+  if (ev->tsched.v == DDS_NEVER)
+  {
+    ev->tsched = tsched;
+    xevq_insert (evq, ev);
+  }
+  else if (evq->kind == DDSI_TEVQ_HEAP)
+  {
+    ev->tsched = tsched;
+    ddsrt_fibheap_decrease_key (&evq_xevents_fhdef, &evq->xevents, ev);
+  }
+  else
+  {
+    wheel_unlink (evq->wheel, ev);
+    ev->tsched = tsched;
+    wheel_insert (evq->wheel, ev);
+  }
+}
+
+static struct xevent *xevq_extract_due (struct xeventq *evq, ddsrt_mtime_t tnow)
+{
+  if (evq->kind == DDSI_TEVQ_HEAP)
+  {
+    const struct xevent *min = ddsrt_fibheap_min (&evq_xevents_fhdef, &evq->xevents);
+    if (min == NULL || min->tsched.v > tnow.v)
+      return NULL;
+    return ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &evq->xevents);
+  }
+  else
+  {
+    return wheel_extract_due (evq->wheel, tnow);
+  }
+}
+
+static struct xevent *xevq_extract_any (struct xeventq *evq)
+{
+  if (evq->kind == DDSI_TEVQ_HEAP)
+    return ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &evq->xevents);
+  else
+  {
+    for (uint32_t list = 0; list < XEVQ_WHEEL_NLISTS; list++)
+    {
+      struct xevent *ev;
+      if ((ev = evq->wheel->lists[list]) != NULL)
+      {
+        wheel_unlink (evq->wheel, ev);
+        return ev;
+      }
+    }
+    return NULL;
+  }
+}
+
+static void wakeup_if_earlier (struct xeventq *evq, ddsrt_mtime_t tsched)
+{
+  /* the thread only needs a signal if it is sleeping past tsched, while it
+     is awake, it recomputes the time to wake up before going to sleep */
+  ASSERT_MUTEX_HELD (&evq->lock);
+  if (tsched.v < evq->twakeup.v)
+    ddsrt_cond_broadcast (&evq->cond);
+}
+
 static void update_rexmit_counts (struct xeventq *evq, struct xevent_nt *ev)
 {
 #if 0
@@ -335,6 +638,24 @@ static void free_xevent (struct xeventq *evq, struct xevent *ev)
   ddsrt_free (ev);
 }
 
+static ddsrt_mtime_t mtime_round_up (ddsrt_mtime_t t, int64_t round)
+{
+  /* This function rounds up t to the nearest next multiple of round.
+     t is nanoseconds, round is milliseconds.  Avoid functions from
+     maths libraries to keep code portable */
+  assert (t.v >= 0 && round >= 0);
+  if (round == 0 || t.v == DDS_INFINITY)
+    return t;
+  else
+  {
+    int64_t remainder = t.v % round;
+    if (remainder == 0)
+      return t;
+    else
+      return (ddsrt_mtime_t) { t.v + round - remainder };
+  }
+}
+
 void delete_xevent (struct xevent *ev)
 {
   struct xeventq *evq = ev->evq;
@@ -343,16 +664,7 @@ void delete_xevent (struct xevent *ev)
   /* Can delete it only once, no matter how we implement it internally */
   assert (ev->tsched.v != TSCHED_DELETE);
   assert (TSCHED_DELETE < ev->tsched.v);
-  if (ev->tsched.v != DDS_NEVER)
-  {
-    ev->tsched.v = TSCHED_DELETE;
-    ddsrt_fibheap_decrease_key (&evq_xevents_fhdef, &evq->xevents, ev);
-  }
-  else
-  {
-    ev->tsched.v = TSCHED_DELETE;
-    ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
-  }
+  xevq_set_earlier (evq, ev, (ddsrt_mtime_t) { TSCHED_DELETE });
   /* TSCHED_DELETE is absolute minimum time, so chances are we need to
      wake up the thread.  The superfluous signal is harmless. */
   ddsrt_cond_broadcast (&evq->cond);
@@ -370,7 +682,7 @@ void delete_xevent_callback (struct xevent *ev)
     if (ev->tsched.v != DDS_NEVER)
     {
       assert (ev->tsched.v != TSCHED_DELETE);
-      ddsrt_fibheap_delete (&evq_xevents_fhdef, &evq->xevents, ev);
+      xevq_remove (evq, ev);
       ev->tsched.v = DDS_NEVER;
     }
     if (ev->u.callback.executing)
@@ -394,47 +706,19 @@ int resched_xevent_if_earlier (struct xevent *ev, ddsrt_mtime_t tsched)
      but with TSCHED_DELETE = MIN_INT64, tsched >= ev->tsched is
      guaranteed to be false. */
   assert (tsched.v != TSCHED_DELETE);
+  tsched = mtime_round_up (tsched, evq->gv->config.schedule_time_rounding);
   if (tsched.v >= ev->tsched.v)
     is_resched = 0;
   else
   {
-    ddsrt_mtime_t tbefore = earliest_in_xeventq (evq);
-    if (ev->tsched.v != DDS_NEVER)
-    {
-      ev->tsched = tsched;
-      ddsrt_fibheap_decrease_key (&evq_xevents_fhdef, &evq->xevents, ev);
-    }
-    else
-    {
-      ev->tsched = tsched;
-      ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
-    }
+    xevq_set_earlier (evq, ev, tsched);
     is_resched = 1;
-    if (tsched.v < tbefore.v)
-      ddsrt_cond_broadcast (&evq->cond);
+    wakeup_if_earlier (evq, tsched);
   }
   ddsrt_mutex_unlock (&evq->lock);
   return is_resched;
 }
 
-static ddsrt_mtime_t mtime_round_up (ddsrt_mtime_t t, int64_t round)
-{
-  /* This function rounds up t to the nearest next multiple of round.
-     t is nanoseconds, round is milliseconds.  Avoid functions from
-     maths libraries to keep code portable */
-  assert (t.v >= 0 && round >= 0);
-  if (round == 0 || t.v == DDS_INFINITY)
-    return t;
-  else
-  {
-    int64_t remainder = t.v % round;
-    if (remainder == 0)
-      return t;
-    else
-      return (ddsrt_mtime_t) { t.v + round - remainder };
-  }
-}
-
 static struct xevent *qxev_common (struct xeventq *evq, ddsrt_mtime_t tsched, enum xeventkind kind)
 {
   /* qxev_common is the route by which all timed xevents are
@@ -469,9 +753,16 @@ static struct xevent_nt *qxev_common_nt (struct xeventq *evq, enum xeventkind_nt
 
 static ddsrt_mtime_t earliest_in_xeventq (struct xeventq *evq)
 {
-  struct xevent *min;
   ASSERT_MUTEX_HELD (&evq->lock);
-  return ((min = ddsrt_fibheap_min (&evq_xevents_fhdef, &evq->xevents)) != NULL) ? min->tsched : DDSRT_MTIME_NEVER;
+  if (evq->kind == DDSI_TEVQ_HEAP)
+  {
+    struct xevent *min;
+    return ((min = ddsrt_fibheap_min (&evq_xevents_fhdef, &evq->xevents)) != NULL) ? min->tsched : DDSRT_MTIME_NEVER;
+  }
+  else
+  {
+    return wheel_earliest (evq->wheel);
+  }
 }
 
 static void qxev_insert (struct xevent *ev)
@@ -482,10 +773,8 @@ static void qxev_insert (struct xevent *ev)
   ASSERT_MUTEX_HELD (&evq->lock);
   if (ev->tsched.v != DDS_NEVER)
   {
-    ddsrt_mtime_t tbefore = earliest_in_xeventq (evq);
-    ddsrt_fibheap_insert (&evq_xevents_fhdef, &evq->xevents, ev);
-    if (ev->tsched.v < tbefore.v)
-      ddsrt_cond_broadcast (&evq->cond);
+    xevq_insert (evq, ev);
+    wakeup_if_earlier (evq, ev->tsched);
   }
 }
 
@@ -509,7 +798,18 @@ struct xeventq * xeventq_new (struct ddsi_domaingv *gv, size_t max_queued_rexmit
   /* limit to 2GB to prevent overflow (4GB - 64kB should be ok, too) */
   if (max_queued_rexmit_bytes > 2147483648u)
     max_queued_rexmit_bytes = 2147483648u;
+  evq->kind = gv->config.timed_event_queue;
   ddsrt_fibheap_init (&evq_xevents_fhdef, &evq->xevents);
+  evq->wheel = NULL;
+  if (evq->kind == DDSI_TEVQ_WHEEL)
+  {
+    /* tick is the rounding of scheduled times, but no finer than 1ms */
+    evq->wheel = ddsrt_malloc (sizeof (*evq->wheel));
+    memset (evq->wheel, 0, sizeof (*evq->wheel));
+    evq->wheel->tick = (gv->config.schedule_time_rounding > DDS_MSECS (1)) ? gv->config.schedule_time_rounding : DDS_MSECS (1);
+    evq->wheel->now = wheel_tick (evq->wheel, ddsrt_time_monotonic ());
+  }
+  evq->twakeup.v = TSCHED_DELETE;
   ddsrt_avl_init (&msg_xevents_treedef, &evq->msg_xevents);
   evq->non_timed_xmit_list_oldest = NULL;
   evq->non_timed_xmit_list_newest = NULL;
@@ -566,8 +866,9 @@ void xeventq_free (struct xeventq *evq)
 {
   struct xevent *ev;
   assert (evq->ts == NULL);
-  while ((ev = ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &evq->xevents)) != NULL)
+  while ((ev = xevq_extract_any (evq)) != NULL)
     free_xevent (evq, ev);
+  ddsrt_free (evq->wheel);
 
   {
     struct nn_xpack *xp = nn_xpack_new (evq->gv, evq->auxiliary_bandwidth_limit, false);
@@ -1193,9 +1494,9 @@ static void handle_xevents (struct thread_state1 * const ts1, struct xeventq *xe
 
   while (xeventsToProcess)
   {
-    while (earliest_in_xeventq(xevq).v <= tnow.v)
+    struct xevent *xev;
+    while ((xev = xevq_extract_due (xevq, tnow)) != NULL)
     {
-      struct xevent *xev = ddsrt_fibheap_extract_min (&evq_xevents_fhdef, &xevq->xevents);
       if (xev->tsched.v == TSCHED_DELETE)
       {
         free_xevent (xevq, xev);
@@ -1203,7 +1504,7 @@ static void handle_xevents (struct thread_state1 * const ts1, struct xeventq *xe
       else
       {
         /* event rescheduling functions look at xev->tsched to
-           determine whether it is currently on the heap or not (i.e.,
+           determine whether it is currently in the queue or not (i.e.,
            scheduled or not), so set to TSCHED_NEVER to indicate it
            currently isn't. */
         xev->tsched.v = DDS_NEVER;
@@ -1265,6 +1566,7 @@ static uint32_t xevent_thread (struct xeventq * xevq)
       if (twakeup.v == DDS_NEVER)
       {
         /* no scheduled events nor any non-timed events */
+        xevq->twakeup = twakeup;
         ddsrt_cond_wait (&xevq->cond, &xevq->lock);
       }
       else
@@ -1276,10 +1578,12 @@ static uint32_t xevent_thread (struct xeventq * xevq)
         tnow = ddsrt_time_monotonic ();
         if (twakeup.v > tnow.v)
         {
+          xevq->twakeup = twakeup;
           twakeup.v -= tnow.v; /* ddsrt_cond_waitfor: relative timeout */
           ddsrt_cond_waitfor (&xevq->cond, &xevq->lock, twakeup.v);
         }
       }
+      xevq->twakeup.v = TSCHED_DELETE;
     }
   }
   ddsrt_mutex_unlock (&xevq->lock);
@@ -1277,6 +1277,71 @@ static void nn_xpack_send1v (const ddsi_xlocator_t *loc, void * varg)
   (void) nn_xpack_send1 (loc, varg);
 }
 
+#define NN_XPACK_DSTBATCH_MAX 64
+
+struct nn_xpack_dstbatch {
+  struct nn_xpack *xp;
+  ddsi_tran_conn_t conn;
+  size_t n;
+  ddsi_locator_t dst[NN_XPACK_DSTBATCH_MAX];
+};
+
+static bool nn_xpack_may_batch (const struct nn_xpack *xp)
+{
+  /* Batching applies only to the plain case: RTPS-level encoding is done per destination,
+     and lossiness/muting are handled per locator in nn_xpack_send1 */
+  struct ddsi_domaingv const * const gv = xp->gv;
+#ifdef DDS_HAS_SECURITY
+  if (xp->sec_info.use_rtps_encoding)
+    return false;
+#endif
+  return gv->config.xmit_batching && gv->config.xmit_lossiness == 0 && !gv->mute;
+}
+
+static void nn_xpack_dstbatch_flush (struct nn_xpack_dstbatch *batch)
+{
+  struct nn_xpack *xp = batch->xp;
+  if (batch->n == 0)
+    return;
+  ssize_t nbytes = ddsi_conn_write_multi (batch->conn, batch->n, batch->dst, xp->niov, xp->iov, xp->call_flags);
+  xp->call_flags = 0;
+  batch->n = 0;
+#ifdef DDS_HAS_BANDWIDTH_LIMITING
+  if (nbytes > 0)
+    nn_bw_limit_sleep_if_needed (xp->gv, &xp->limiter, nbytes);
+#else
+  (void) nbytes;
+#endif
+}
+
+static void nn_xpack_dstbatch_add (const ddsi_xlocator_t *loc, void * varg)
+{
+  struct nn_xpack_dstbatch *batch = varg;
+  struct nn_xpack *xp = batch->xp;
+  struct ddsi_domaingv const * const gv = xp->gv;
+#ifdef DDS_HAS_SHM
+  if (loc->c.kind == NN_LOCATOR_KIND_SHEM)
+  {
+    (void) nn_xpack_send1 (loc, xp);
+    return;
+  }
+#endif
+  if (!ddsi_conn_supports_write_multi (loc->conn))
+  {
+    (void) nn_xpack_send1 (loc, xp);
+    return;
+  }
+  if (gv->logconfig.c.mask & DDS_LC_TRACE)
+  {
+    char buf[DDSI_LOCSTRLEN];
+    GVTRACE (" %s", ddsi_xlocator_to_string (buf, sizeof(buf), loc));
+  }
+  if (batch->n > 0 && (batch->conn != loc->conn || batch->n == NN_XPACK_DSTBATCH_MAX))
+    nn_xpack_dstbatch_flush (batch);
+  batch->conn = loc->conn;
+  batch->dst[batch->n++] = loc->c;
+}
+
 static void nn_xpack_send_real (struct nn_xpack *xp)
 {
   struct ddsi_domaingv const * const gv = xp->gv;
@@ -1315,7 +1380,14 @@ static void nn_xpack_send_real (struct nn_xpack *xp)
     calls = 0;
     if (xp->dstaddr.all.as)
     {
-      calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_send1v, xp);
+      if (!nn_xpack_may_batch (xp))
+        calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_send1v, xp);
+      else
+      {
+        struct nn_xpack_dstbatch batch = { .xp = xp, .conn = NULL, .n = 0 };
+        calls = addrset_forall_count (xp->dstaddr.all.as, nn_xpack_dstbatch_add, &batch);
+        nn_xpack_dstbatch_flush (&batch);
+      }
       unref_addrset (xp->dstaddr.all.as);
     }
 
@@ -0,0 +1,205 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <stddef.h>
+#include <string.h>
+
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/threads.h"
+#include "dds/ddsi/q_freelist.h"
+#include "CUnit/Test.h"
+
+struct elem {
+  struct elem *next;
+  uint32_t owner;
+};
+
+static ddsrt_atomic_uint32_t nfreed;
+
+static void elem_free (void *velem)
+{
+  ddsrt_atomic_inc32 (&nfreed);
+  ddsrt_free (velem);
+}
+
+static struct elem *elem_new (void)
+{
+  struct elem *e = ddsrt_malloc (sizeof (*e));
+  e->next = NULL;
+  e->owner = 0;
+  return e;
+}
+
+struct push_arg {
+  struct nn_freelist *fl;
+  uint32_t n;
+};
+
+static uint32_t push_thread (void *varg)
+{
+  struct push_arg * const arg = varg;
+  for (uint32_t i = 0; i < arg->n; i++)
+    CU_ASSERT (nn_freelist_push (arg->fl, elem_new ()));
+  return 0;
+}
+
+CU_Test (ddsi_freelist, single_thread)
+{
+  struct nn_freelist fl;
+  struct elem *es[3 * NN_FREELIST_MAGSIZE];
+  const uint32_t n = (uint32_t) (sizeof (es) / sizeof (es[0]));
+  ddsrt_atomic_st32 (&nfreed, 0);
+  nn_freelist_init (&fl, UINT32_MAX, offsetof (struct elem, next));
+  for (uint32_t i = 0; i < n; i++)
+  {
+    es[i] = elem_new ();
+    CU_ASSERT_FATAL (nn_freelist_push (&fl, es[i]));
+  }
+  /* last in, first out, also across magazines */
+  for (uint32_t i = n; i > 0; i--)
+  {
+    struct elem *e = nn_freelist_pop (&fl);
+    CU_ASSERT_FATAL (e == es[i - 1]);
+  }
+  CU_ASSERT_FATAL (nn_freelist_pop (&fl) == NULL);
+  for (uint32_t i = 0; i < n; i++)
+    CU_ASSERT_FATAL (nn_freelist_push (&fl, es[i]));
+  nn_freelist_fini (&fl, elem_free);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&nfreed) == n);
+}
+
+CU_Test (ddsi_freelist, bounded)
+{
+  struct nn_freelist fl;
+  const uint32_t max = 2 * NN_FREELIST_MAGSIZE;
+  uint32_t npushed = 0, nrejected = 0;
+  ddsrt_atomic_st32 (&nfreed, 0);
+  nn_freelist_init (&fl, max, offsetof (struct elem, next));
+  for (uint32_t i = 0; i < 8 * NN_FREELIST_MAGSIZE; i++)
+  {
+    struct elem *e = elem_new ();
+    if (nn_freelist_push (&fl, e))
+      npushed++;
+    else
+    {
+      ddsrt_free (e);
+      nrejected++;
+    }
+  }
+  CU_ASSERT_FATAL (nrejected > 0);
+  /* depot, one thread-private magazine and one shared magazine */
+  CU_ASSERT_FATAL (npushed <= max + 2 * NN_FREELIST_MAGSIZE);
+  nn_freelist_fini (&fl, elem_free);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&nfreed) == npushed);
+}
+
+CU_Test (ddsi_freelist, thread_exit)
+{
+  /* Elements cached by a thread that terminates must be returned to the
+     freelist and freed by nn_freelist_fini, including those that no
+     longer fit */
+  struct nn_freelist fl;
+  ddsrt_thread_t tid;
+  ddsrt_threadattr_t tattr;
+  struct push_arg arg = { .fl = &fl, .n = NN_FREELIST_MAGSIZE + 10 };
+  ddsrt_atomic_st32 (&nfreed, 0);
+  nn_freelist_init (&fl, NN_FREELIST_MAGSIZE, offsetof (struct elem, next));
+  ddsrt_threadattr_init (&tattr);
+  CU_ASSERT_FATAL (ddsrt_thread_create (&tid, "push", &tattr, push_thread, &arg) == DDS_RETCODE_OK);
+  CU_ASSERT_FATAL (ddsrt_thread_join (tid, NULL) == DDS_RETCODE_OK);
+  nn_freelist_fini (&fl, elem_free);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&nfreed) == arg.n);
+}
+
+#define STRESS_NTHREADS 8
+#define STRESS_NELEMS 1000
+
+struct stress_arg {
+  struct nn_freelist *fl;
+  uint32_t id;
+  ddsrt_atomic_uint32_t *nelems;
+  bool ok;
+};
+
+static uint32_t stress_thread (void *varg)
+{
+  struct stress_arg * const arg = varg;
+  struct elem *held[STRESS_NELEMS];
+  uint32_t nheld = 0;
+  arg->ok = true;
+  for (uint32_t i = 0; i < 100000; i++)
+  {
+    if (nheld < STRESS_NELEMS && (nheld == 0 || (ddsrt_random () % 2) == 0))
+    {
+      struct elem *e;
+      if ((e = nn_freelist_pop (arg->fl)) == NULL)
+      {
+        e = elem_new ();
+        ddsrt_atomic_inc32 (arg->nelems);
+      }
+      else if (e->owner != 0)
+      {
+        arg->ok = false;
+      }
+      e->owner = arg->id;
+      held[nheld++] = e;
+    }
+    else
+    {
+      struct elem *e = held[--nheld];
+      if (e->owner != arg->id)
+        arg->ok = false;
+      e->owner = 0;
+      if (!nn_freelist_push (arg->fl, e))
+      {
+        ddsrt_free (e);
+        ddsrt_atomic_dec32 (arg->nelems);
+      }
+    }
+  }
+  while (nheld > 0)
+  {
+    struct elem *e = held[--nheld];
+    e->owner = 0;
+    if (!nn_freelist_push (arg->fl, e))
+    {
+      ddsrt_free (e);
+      ddsrt_atomic_dec32 (arg->nelems);
+    }
+  }
+  return 0;
+}
+
+CU_Test (ddsi_freelist, stress, .timeout = 60)
+{
+  struct nn_freelist fl;
+  ddsrt_thread_t tids[STRESS_NTHREADS];
+  struct stress_arg args[STRESS_NTHREADS];
+  ddsrt_threadattr_t tattr;
+  ddsrt_atomic_uint32_t nelems = DDSRT_ATOMIC_UINT32_INIT (0);
+  ddsrt_atomic_st32 (&nfreed, 0);
+  nn_freelist_init (&fl, 4 * NN_FREELIST_MAGSIZE, offsetof (struct elem, next));
+  ddsrt_threadattr_init (&tattr);
+  for (uint32_t i = 0; i < STRESS_NTHREADS; i++)
+  {
+    args[i] = (struct stress_arg) { .fl = &fl, .id = i + 1, .nelems = &nelems, .ok = false };
+    CU_ASSERT_FATAL (ddsrt_thread_create (&tids[i], "stress", &tattr, stress_thread, &args[i]) == DDS_RETCODE_OK);
+  }
+  for (uint32_t i = 0; i < STRESS_NTHREADS; i++)
+  {
+    CU_ASSERT_FATAL (ddsrt_thread_join (tids[i], NULL) == DDS_RETCODE_OK);
+    CU_ASSERT (args[i].ok);
+  }
+  nn_freelist_fini (&fl, elem_free);
+  CU_ASSERT_FATAL (ddsrt_atomic_ld32 (&nfreed) == ddsrt_atomic_ld32 (&nelems));
+}
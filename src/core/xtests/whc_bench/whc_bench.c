@@ -0,0 +1,193 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+
+/* Benchmark for the sequence number index of the writer history cache:
+   fills a WHC with a given number of samples, then looks them up in order
+   (as when a reader catches up) and at random (as for retransmit requests),
+   and finally acknowledges them in batches, for a reliable volatile writer
+   and for a transient-local one, both with KEEP_ALL history.  It reports the
+   cost per sample for the selected index implementation(s), for depths
+   going up by factors of 10, and fails if a lookup returns the wrong sample.
+
+   Usage: whc_bench {hash|ring|both} MIN-DEPTH MAX-DEPTH */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/time.h"
+#include "dds__entity.h"
+#include "dds__topic.h"
+#include "dds__whc.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/ddsi_serdata.h"
+#include "dds/ddsi/ddsi_tkmap.h"
+#include "dds/ddsi/q_thread.h"
+#include "dds/ddsi/q_whc.h"
+#include "WhcBenchTypes.h"
+
+#define ACK_BATCH 1000
+
+static double tdiff (ddsrt_mtime_t t0, ddsrt_mtime_t t1, uint32_t n)
+{
+  return (double) (t1.v - t0.v) / (double) n;
+}
+
+static struct ddsi_domaingv *get_gv (dds_entity_t e)
+{
+  struct ddsi_domaingv *gv;
+  dds_entity *x;
+  if (dds_entity_pin (e, &x) < 0)
+    abort ();
+  gv = &x->m_domain->gv;
+  dds_entity_unpin (x);
+  return gv;
+}
+
+static struct ddsi_serdata *make_serdata (dds_entity_t topic)
+{
+  const WhcBenchTypes_T sample = { .k = 0, .x = 0 };
+  struct dds_topic *tp;
+  struct ddsi_serdata *sd;
+  if (dds_topic_pin (topic, &tp) < 0)
+    abort ();
+  sd = ddsi_serdata_from_sample (tp->m_stype, SDK_DATA, &sample);
+  dds_topic_unpin (tp);
+  return sd;
+}
+
+static bool check_borrow (struct whc *whc, seqno_t seq)
+{
+  struct whc_borrowed_sample sample;
+  if (!whc_borrow_sample (whc, seq, &sample))
+    return false;
+  const bool ok = (sample.seq == seq);
+  whc_return_sample (whc, &sample, false);
+  return ok;
+}
+
+static bool run_one (struct ddsi_domaingv *gv, struct ddsi_serdata *sd, struct ddsi_tkmap_instance *tk, const char *kind, bool transient_local, uint32_t depth)
+{
+  dds_qos_t qos;
+  struct whc_state whcst;
+  struct whc_node *deferred_free_list;
+  ddsrt_prng_t prng;
+  bool ok = true;
+
+  ddsi_xqos_init_empty (&qos);
+  qos.present |= QP_HISTORY | QP_DURABILITY | QP_DURABILITY_SERVICE;
+  qos.history.kind = DDS_HISTORY_KEEP_ALL;
+  qos.durability.kind = transient_local ? DDS_DURABILITY_TRANSIENT_LOCAL : DDS_DURABILITY_VOLATILE;
+  ddsi_xqos_mergein_missing (&qos, &ddsi_default_qos_writer, ~(uint64_t)0);
+  qos.durability_service.history.kind = DDS_HISTORY_KEEP_ALL;
+  struct whc_writer_info *wrinfo = whc_make_wrinfo (NULL, &qos);
+  struct whc *whc = whc_new (gv, wrinfo);
+  whc_free_wrinfo (wrinfo);
+  ddsi_xqos_fini (&qos);
+
+  const ddsrt_mtime_t t0 = ddsrt_time_monotonic ();
+  for (seqno_t seq = 1; seq <= depth; seq++)
+    whc_insert (whc, 0, seq, DDSRT_MTIME_NEVER, NULL, sd, tk);
+
+  const ddsrt_mtime_t t1 = ddsrt_time_monotonic ();
+  uint32_t n = 0;
+  for (seqno_t seq = whc_next_seq (whc, 0); seq != MAX_SEQ_NUMBER; seq = whc_next_seq (whc, seq), n++)
+    ok = check_borrow (whc, seq) && ok;
+  ok = (n == depth) && ok;
+
+  const ddsrt_mtime_t t2 = ddsrt_time_monotonic ();
+  ddsrt_prng_init_simple (&prng, depth);
+  for (uint32_t i = 0; i < depth; i++)
+    ok = check_borrow (whc, 1 + ddsrt_prng_random (&prng) % depth) && ok;
+
+  const ddsrt_mtime_t t3 = ddsrt_time_monotonic ();
+  for (seqno_t seq = ACK_BATCH; seq < depth + ACK_BATCH; seq += ACK_BATCH)
+  {
+    (void) whc_remove_acked_messages (whc, (seq < depth) ? seq : depth, &whcst, &deferred_free_list);
+    whc_free_deferred_free_list (whc, deferred_free_list);
+  }
+  whc_get_state (whc, &whcst);
+  ok = (whcst.unacked_bytes == 0) && ok;
+
+  /* transient-local data is retained after acknowledgement */
+  const ddsrt_mtime_t t4 = ddsrt_time_monotonic ();
+  ok = (check_borrow (whc, depth) == transient_local) && ok;
+  whc_free (whc);
+  const ddsrt_mtime_t t5 = ddsrt_time_monotonic ();
+
+  printf ("%-4s %-9s %8"PRIu32": insert %6.1fns next+borrow %6.1fns random borrow %6.1fns ack %6.1fns free %6.1fns%s\n",
+          kind, transient_local ? "tlocal" : "volatile", depth,
+          tdiff (t0, t1, depth), tdiff (t1, t2, depth), tdiff (t2, t3, depth), tdiff (t3, t4, depth), tdiff (t4, t5, depth),
+          ok ? "" : " FAILED");
+  return ok;
+}
+
+static bool run (const char *kind, uint32_t mindepth, uint32_t maxdepth)
+{
+  char config[200];
+  (void) snprintf (config, sizeof (config), "<Internal><WhcSequenceIndex>%s</WhcSequenceIndex></Internal>", kind);
+  const dds_entity_t dom = dds_create_domain (0, config);
+  const dds_entity_t pp = dds_create_participant (0, NULL, NULL);
+  const dds_entity_t tp = dds_create_topic (pp, &WhcBenchTypes_T_desc, "whc_bench", NULL, NULL);
+  if (dom < 0 || pp < 0 || tp < 0)
+  {
+    fprintf (stderr, "%s: failed to create domain, participant or topic\n", kind);
+    return false;
+  }
+  struct ddsi_domaingv * const gv = get_gv (pp);
+  struct ddsi_serdata * const sd = make_serdata (tp);
+  thread_state_awake (lookup_thread_state (), gv);
+  struct ddsi_tkmap_instance * const tk = ddsi_tkmap_lookup_instance_ref (gv->m_tkmap, sd);
+  thread_state_asleep (lookup_thread_state ());
+
+  bool ok = true;
+  for (uint32_t depth = mindepth; depth <= maxdepth; depth *= 10)
+  {
+    ok = run_one (gv, sd, tk, kind, false, depth) && ok;
+    ok = run_one (gv, sd, tk, kind, true, depth) && ok;
+    if (depth > UINT32_MAX / 10)
+      break;
+  }
+
+  thread_state_awake (lookup_thread_state (), gv);
+  ddsi_tkmap_instance_unref (gv->m_tkmap, tk);
+  thread_state_asleep (lookup_thread_state ());
+  ddsi_serdata_unref (sd);
+  dds_delete (dom);
+  return ok;
+}
+
+int main (int argc, char **argv)
+{
+  if (argc != 4 || (strcmp (argv[1], "hash") != 0 && strcmp (argv[1], "ring") != 0 && strcmp (argv[1], "both") != 0))
+  {
+    fprintf (stderr, "usage: %s {hash|ring|both} MIN-DEPTH MAX-DEPTH\n", argv[0]);
+    return 2;
+  }
+  const uint32_t mindepth = (uint32_t) atoi (argv[2]);
+  const uint32_t maxdepth = (uint32_t) atoi (argv[3]);
+  if (mindepth == 0 || maxdepth < mindepth)
+  {
+    fprintf (stderr, "%s: invalid arguments\n", argv[0]);
+    return 2;
+  }
+
+  bool ok = true;
+  if (strcmp (argv[1], "ring") != 0)
+    ok = run ("hash", mindepth, maxdepth) && ok;
+  if (strcmp (argv[1], "hash") != 0)
+    ok = run ("ring", mindepth, maxdepth) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+
+/* Stress test/benchmark for the timed event queue: creates a large number of
+   callback events and reschedules them at random from the main thread, while
+   the callbacks reschedule themselves, mimicking what happens with
+   heartbeats and acknowledgements of many writers and readers.  It reports
+   the cost of rescheduling for the selected queue implementation(s) and
+   fails if an event fires before it is due.
+
+   Usage: xevent_stress {heap|wheel|both} NEVENTS DURATION-S ROUNDING-MS */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "dds/dds.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/random.h"
+#include "dds/ddsrt/time.h"
+#include "dds__entity.h"
+#include "dds/ddsi/ddsi_domaingv.h"
+#include "dds/ddsi/q_xevent.h"
+
+struct evarg {
+  struct xevent *ev;
+  ddsrt_mtime_t tcur; /* time it is currently scheduled for */
+  ddsrt_mtime_t tmin; /* earliest time it was scheduled for since it last fired */
+};
+
+struct stats {
+  ddsrt_mutex_t lock;
+  ddsrt_prng_t prng;
+  uint64_t fires;
+  uint64_t early;
+  int64_t lateness;
+};
+
+static struct stats stats;
+
+static struct ddsi_domaingv *get_gv (dds_entity_t e)
+{
+  struct ddsi_domaingv *gv;
+  dds_entity *x;
+  if (dds_entity_pin (e, &x) < 0)
+    abort ();
+  gv = &x->m_domain->gv;
+  dds_entity_unpin (x);
+  return gv;
+}
+
+static dds_duration_t random_delay (dds_duration_t min, dds_duration_t max)
+{
+  return min + (dds_duration_t) (ddsrt_prng_random (&stats.prng) % (uint32_t) ((max - min) / DDS_USECS (1))) * DDS_USECS (1);
+}
+
+static void callback (struct xevent *ev, void *varg, ddsrt_mtime_t tnow)
+{
+  struct evarg * const arg = varg;
+  ddsrt_mutex_lock (&stats.lock);
+  stats.fires++;
+  if (tnow.v < arg->tmin.v)
+    stats.early++;
+  else
+    stats.lateness += tnow.v - arg->tmin.v;
+  /* the main thread may have rescheduled it between it being taken from the
+     queue and the callback getting the lock */
+  const ddsrt_mtime_t tnext = ddsrt_mtime_add_duration (tnow, random_delay (DDS_MSECS (10), DDS_SECS (1)));
+  if (resched_xevent_if_earlier (ev, tnext))
+    arg->tcur = tnext;
+  arg->tmin = arg->tcur;
+  ddsrt_mutex_unlock (&stats.lock);
+}
+
+static bool run (const char *kind, uint32_t nevents, double duration, int rounding)
+{
+  char config[200];
+  (void) snprintf (config, sizeof (config), "<Internal><TimedEventQueue>%s</TimedEventQueue><ScheduleTimeRounding>%d ms</ScheduleTimeRounding></Internal>", kind, rounding);
+  const dds_entity_t dom = dds_create_domain (0, config);
+  const dds_entity_t pp = dds_create_participant (0, NULL, NULL);
+  if (dom < 0 || pp < 0)
+  {
+    fprintf (stderr, "%s: failed to create domain or participant\n", kind);
+    return false;
+  }
+  struct ddsi_domaingv * const gv = get_gv (pp);
+  struct evarg *args = ddsrt_malloc (nevents * sizeof (*args));
+
+  stats.fires = stats.early = 0;
+  stats.lateness = 0;
+  ddsrt_mutex_lock (&stats.lock);
+  const ddsrt_mtime_t tstart = ddsrt_time_monotonic ();
+  for (uint32_t i = 0; i < nevents; i++)
+  {
+    args[i].tcur = args[i].tmin = ddsrt_mtime_add_duration (tstart, random_delay (DDS_SECS (1), DDS_SECS (2)));
+    args[i].ev = qxev_callback (gv->xevents, args[i].tcur, callback, &args[i]);
+  }
+  ddsrt_mutex_unlock (&stats.lock);
+
+  /* resched_xevent_if_earlier only ever moves an event forward, the way
+     a writer pulls its next heartbeat forward, so a fair fraction of these
+     calls ends up not changing anything */
+  const ddsrt_mtime_t tend = ddsrt_mtime_add_duration (tstart, (dds_duration_t) (duration * 1e9));
+  uint64_t nops = 0, nresched = 0;
+  ddsrt_mtime_t tnow = tstart;
+  while (tnow.v < tend.v)
+  {
+    ddsrt_mutex_lock (&stats.lock);
+    for (int k = 0; k < 1000; k++)
+    {
+      struct evarg * const arg = &args[ddsrt_prng_random (&stats.prng) % nevents];
+      const ddsrt_mtime_t t = ddsrt_mtime_add_duration (tnow, random_delay (DDS_MSECS (1), DDS_SECS (1)));
+      if (resched_xevent_if_earlier (arg->ev, t))
+      {
+        arg->tcur = t;
+        if (t.v < arg->tmin.v)
+          arg->tmin = t;
+        nresched++;
+      }
+      nops++;
+    }
+    ddsrt_mutex_unlock (&stats.lock);
+    tnow = ddsrt_time_monotonic ();
+  }
+  const double elapsed = (double) (tnow.v - tstart.v) / 1e9;
+
+  for (uint32_t i = 0; i < nevents; i++)
+    delete_xevent_callback (args[i].ev);
+  ddsrt_free (args);
+  dds_delete (dom);
+
+  printf ("%-5s %"PRIu32" events %.2fs: %.0f resched/s (%"PRIu64" of %"PRIu64" earlier) %"PRIu64" fired, mean lateness %.0fus, %"PRIu64" early\n",
+          kind, nevents, elapsed, (double) nops / elapsed, nresched, nops,
+          stats.fires, (stats.fires > 0) ? (double) stats.lateness / (double) stats.fires / 1e3 : 0.0, stats.early);
+  return stats.early == 0;
+}
+
+int main (int argc, char **argv)
+{
+  if (argc != 5 || (strcmp (argv[1], "heap") != 0 && strcmp (argv[1], "wheel") != 0 && strcmp (argv[1], "both") != 0))
+  {
+    fprintf (stderr, "usage: %s {heap|wheel|both} NEVENTS DURATION-S ROUNDING-MS\n", argv[0]);
+    return 2;
+  }
+  const uint32_t nevents = (uint32_t) atoi (argv[2]);
+  const double duration = atof (argv[3]);
+  const int rounding = atoi (argv[4]);
+  if (nevents == 0 || duration <= 0 || rounding < 0)
+  {
+    fprintf (stderr, "%s: invalid arguments\n", argv[0]);
+    return 2;
+  }
+
+  bool ok = true;
+  ddsrt_mutex_init (&stats.lock);
+  ddsrt_prng_init_simple (&stats.prng, 314159265);
+  if (strcmp (argv[1], "wheel") != 0)
+    ok = run ("heap", nevents, duration, rounding) && ok;
+  if (strcmp (argv[1], "heap") != 0)
+    ok = run ("wheel", nevents, duration, rounding) && ok;
+  ddsrt_mutex_destroy (&stats.lock);
+  return ok ? 0 : 1;
+}
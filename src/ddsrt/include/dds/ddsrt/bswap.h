@@ -60,6 +60,22 @@ DDS_INLINE_EXPORT inline int64_t ddsrt_bswap8 (int64_t x)
   return (int64_t) ddsrt_bswap8u ((uint64_t) x);
 }
 
+/**
+ * @brief Copy an array of 1, 2, 4 or 8-byte integers, swapping the byte order
+ *        of each element.
+ *
+ * Uses SIMD instructions where the compiler targets them (AVX2, SSSE3, SSE2
+ * or NEON), falling back to a plain loop otherwise.  Neither @dst nor @src
+ * need to be aligned to the element size.
+ *
+ * @param[out] dst   Destination, may be the same as @src but must otherwise
+ *                   not overlap with it.
+ * @param[in]  src   Source.
+ * @param[in]  size  Size of an element in bytes, 1, 2, 4 or 8.
+ * @param[in]  num   Number of elements.
+ */
+DDS_EXPORT void ddsrt_bswap_copy (void *dst, const void *src, uint32_t size, uint32_t num);
+
 #if DDSRT_ENDIAN == DDSRT_LITTLE_ENDIAN
 #define ddsrt_toBE2(x) ddsrt_bswap2 (x)
 #define ddsrt_toBE2u(x) ddsrt_bswap2u (x)
@@ -0,0 +1,108 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+
+/** @file
+ *
+ * @brief Binary tracing
+ *
+ * Binary tracing is an alternative to formatting trace messages as text at
+ * the time they are generated.  Instead, the calling thread copies the format
+ * string's arguments into a thread-private ring buffer of fixed-size records
+ * without taking any locks, and a background thread writes the contents of
+ * these ring buffers to a file in a compact binary format.  The format strings
+ * themselves are written to the file only once.
+ *
+ * The text can be reconstructed off-line using the "decode-trace" script,
+ * which produces exactly the same lines as text-based tracing would have.
+ *
+ * When a ring buffer is full, the message is dropped, and the number of
+ * dropped messages is recorded in the file.
+ */
+#ifndef DDSRT_LOG_BINARY_H
+#define DDSRT_LOG_BINARY_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "dds/export.h"
+#include "dds/ddsrt/attributes.h"
+#include "dds/ddsrt/log.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+struct ddsrt_log_binary;
+
+/**
+ * @brief Create a binary trace writer
+ *
+ * Writes the file header to fp and starts the background thread that writes
+ * traced messages to it.  The file is not closed by #ddsrt_log_binary_free.
+ *
+ * @param[in]  fp        File to write to, should be opened in binary mode.
+ * @param[in]  bufsize   Size of the per-thread ring buffers in bytes.
+ *
+ * @returns a binary trace writer or NULL if it could not be created.
+ */
+DDS_EXPORT struct ddsrt_log_binary *
+ddsrt_log_binary_new(
+    FILE *fp,
+    uint32_t bufsize);
+
+/**
+ * @brief Stop the background thread, write any remaining messages and free
+ * the binary trace writer.
+ *
+ * Must not be called while other threads may still be using it in
+ * a logging configuration.
+ */
+DDS_EXPORT void
+ddsrt_log_binary_free(
+    struct ddsrt_log_binary *bt);
+
+/**
+ * @brief Record a message in the calling thread's ring buffer
+ *
+ * For use by the logging code. All arguments referenced by the format string
+ * are copied (strings included) so they need not remain valid.
+ */
+DDS_EXPORT void
+ddsrt_log_binary_vlog(
+    struct ddsrt_log_binary *bt,
+    uint32_t cat,
+    uint32_t domid,
+    const char *fmt,
+    va_list ap);
+
+/**
+ * @brief Direct trace output for a logging configuration to a binary trace
+ * writer
+ *
+ * Messages matching the trace mask that would otherwise be written to the
+ * trace sink are written to bt instead, messages for the log sink are still
+ * written to that sink as text.
+ *
+ * @param[in,out] cfg  Logging configuration initialized by #dds_log_cfg_init.
+ * @param[in]     bt   Binary trace writer or NULL to revert to text.
+ */
+DDS_EXPORT void
+dds_log_cfg_set_binary(
+    struct ddsrt_log_cfg *cfg,
+    struct ddsrt_log_binary *bt);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif /* DDSRT_LOG_BINARY_H */
@@ -94,6 +94,34 @@ ddsrt_sendmsg(
   int flags,
   ssize_t *sent);
 
+/**
+ * @brief Send a batch of datagrams in a single operation.
+ *
+ * Sends the messages in order, stopping at the first one that fails. On
+ * platforms without native support (DDSRT_HAVE_SENDMMSG = 0) this is
+ * equivalent to calling @ddsrt_sendmsg for each message in turn.
+ *
+ * @param[in]  sock    Socket to send on.
+ * @param[in]  msgs    Array of message headers to send.
+ * @param[out] sent    Array of sent sizes, one for each message header.
+ * @param[in]  nmsgs   Number of entries in @msgs and @sent.
+ * @param[in]  flags   Flags passed to the underlying send call.
+ * @param[out] nsent   Number of messages sent.
+ *
+ * @returns A dds_return_t indicating success or failure, with the same
+ *          interpretation as for @ddsrt_sendmsg. If some messages were sent
+ *          before an error occurred, the return code reflects the error and
+ *          @nsent the number of messages successfully sent.
+ */
+DDS_EXPORT dds_return_t
+ddsrt_sendmmsg(
+  ddsrt_socket_t sock,
+  const ddsrt_msghdr_t *msgs,
+  ssize_t *sent,
+  size_t nmsgs,
+  int flags,
+  size_t *nsent);
+
 DDS_EXPORT dds_return_t
 ddsrt_recv(
   ddsrt_socket_t sock,
@@ -109,6 +137,34 @@ ddsrt_recvmsg(
   int flags,
   ssize_t *rcvd);
 
+/**
+ * @brief Receive a batch of datagrams in a single operation.
+ *
+ * Blocks until at least one datagram is available (unless the socket is
+ * non-blocking), then receives as many of the immediately available
+ * datagrams as fit in @msgs without blocking. On platforms without native
+ * support (DDSRT_HAVE_RECVMMSG = 0) this receives at most one datagram.
+ *
+ * @param[in]     sock    Socket to receive from.
+ * @param[in,out] msgs    Array of message headers to receive into, msg_namelen
+ *                        and msg_flags are updated for each received datagram.
+ * @param[out]    rcvd    Array of received sizes, one for each message header.
+ * @param[in]     nmsgs   Number of entries in @msgs and @rcvd.
+ * @param[in]     flags   Flags passed to the underlying receive call.
+ * @param[out]    nrcvd   Number of datagrams received.
+ *
+ * @returns A dds_return_t indicating success or failure, with the same
+ *          interpretation as for @ddsrt_recvmsg.
+ */
+DDS_EXPORT dds_return_t
+ddsrt_recvmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_msghdr_t *msgs,
+  ssize_t *rcvd,
+  size_t nmsgs,
+  int flags,
+  size_t *nrcvd);
+
 DDS_EXPORT dds_return_t
 ddsrt_getsockopt(
   ddsrt_socket_t sock,
@@ -76,6 +76,14 @@ typedef struct msghdr ddsrt_msghdr_t;
 # define DDSRT_MSGHDR_FLAGS 1
 #endif
 
+#if defined(__linux__) && !LWIP_SOCKET
+# define DDSRT_HAVE_RECVMMSG 1
+# define DDSRT_HAVE_SENDMMSG 1
+#else
+# define DDSRT_HAVE_RECVMMSG 0
+# define DDSRT_HAVE_SENDMMSG 0
+#endif
+
 #if defined(__cplusplus)
 }
 #endif
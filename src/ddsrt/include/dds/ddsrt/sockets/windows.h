@@ -49,6 +49,8 @@ typedef struct ddsrt_msghdr {
 } ddsrt_msghdr_t;
 
 #define DDSRT_MSGHDR_FLAGS 1
+#define DDSRT_HAVE_RECVMMSG 0
+#define DDSRT_HAVE_SENDMMSG 0
 
 #if defined(__cplusplus)
 }
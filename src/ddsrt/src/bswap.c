@@ -18,3 +18,132 @@ DDS_EXPORT extern inline uint64_t ddsrt_bswap8u (uint64_t x);
 DDS_EXPORT extern inline int16_t ddsrt_bswap2 (int16_t x);
 DDS_EXPORT extern inline int32_t ddsrt_bswap4 (int32_t x);
 DDS_EXPORT extern inline int64_t ddsrt_bswap8 (int64_t x);
+
+#include <assert.h>
+#include <string.h>
+
+#if defined (__AVX2__)
+#include <immintrin.h>
+#define BSWAP_VEC_SIZE 32
+typedef __m256i bswap_vec_t;
+static inline bswap_vec_t bswap_vec_load (const unsigned char *p) { return _mm256_loadu_si256 ((const __m256i *) p); }
+static inline void bswap_vec_store (unsigned char *p, bswap_vec_t x) { _mm256_storeu_si256 ((__m256i *) p, x); }
+static inline bswap_vec_t bswap_vec_2 (bswap_vec_t x) {
+  return _mm256_shuffle_epi8 (x, _mm256_setr_epi8 (1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14, 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14));
+}
+static inline bswap_vec_t bswap_vec_4 (bswap_vec_t x) {
+  return _mm256_shuffle_epi8 (x, _mm256_setr_epi8 (3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12, 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12));
+}
+static inline bswap_vec_t bswap_vec_8 (bswap_vec_t x) {
+  return _mm256_shuffle_epi8 (x, _mm256_setr_epi8 (7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8, 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8));
+}
+#elif defined (__SSSE3__)
+#include <tmmintrin.h>
+#define BSWAP_VEC_SIZE 16
+typedef __m128i bswap_vec_t;
+static inline bswap_vec_t bswap_vec_load (const unsigned char *p) { return _mm_loadu_si128 ((const __m128i *) p); }
+static inline void bswap_vec_store (unsigned char *p, bswap_vec_t x) { _mm_storeu_si128 ((__m128i *) p, x); }
+static inline bswap_vec_t bswap_vec_2 (bswap_vec_t x) { return _mm_shuffle_epi8 (x, _mm_setr_epi8 (1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14)); }
+static inline bswap_vec_t bswap_vec_4 (bswap_vec_t x) { return _mm_shuffle_epi8 (x, _mm_setr_epi8 (3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12)); }
+static inline bswap_vec_t bswap_vec_8 (bswap_vec_t x) { return _mm_shuffle_epi8 (x, _mm_setr_epi8 (7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8)); }
+#elif defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BSWAP_VEC_SIZE 16
+typedef __m128i bswap_vec_t;
+static inline bswap_vec_t bswap_vec_load (const unsigned char *p) { return _mm_loadu_si128 ((const __m128i *) p); }
+static inline void bswap_vec_store (unsigned char *p, bswap_vec_t x) { _mm_storeu_si128 ((__m128i *) p, x); }
+/* no byte shuffle in SSE2: swap 16-bit words using the word shuffles, then bytes using shifts */
+static inline bswap_vec_t bswap_vec_2 (bswap_vec_t x) { return _mm_or_si128 (_mm_slli_epi16 (x, 8), _mm_srli_epi16 (x, 8)); }
+static inline bswap_vec_t bswap_vec_4 (bswap_vec_t x) {
+  return bswap_vec_2 (_mm_shufflehi_epi16 (_mm_shufflelo_epi16 (x, _MM_SHUFFLE (2, 3, 0, 1)), _MM_SHUFFLE (2, 3, 0, 1)));
+}
+static inline bswap_vec_t bswap_vec_8 (bswap_vec_t x) {
+  return bswap_vec_2 (_mm_shufflehi_epi16 (_mm_shufflelo_epi16 (x, _MM_SHUFFLE (0, 1, 2, 3)), _MM_SHUFFLE (0, 1, 2, 3)));
+}
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#include <arm_neon.h>
+#define BSWAP_VEC_SIZE 16
+typedef uint8x16_t bswap_vec_t;
+static inline bswap_vec_t bswap_vec_load (const unsigned char *p) { return vld1q_u8 (p); }
+static inline void bswap_vec_store (unsigned char *p, bswap_vec_t x) { vst1q_u8 (p, x); }
+static inline bswap_vec_t bswap_vec_2 (bswap_vec_t x) { return vrev16q_u8 (x); }
+static inline bswap_vec_t bswap_vec_4 (bswap_vec_t x) { return vrev32q_u8 (x); }
+static inline bswap_vec_t bswap_vec_8 (bswap_vec_t x) { return vrev64q_u8 (x); }
+#else
+#define BSWAP_VEC_SIZE 0
+#endif
+
+/* Elements are loaded and stored using memcpy because CDR only guarantees 4-byte
+   alignment for 8-byte integers in XCDR2 and the source may be in an arbitrary
+   location in a receive buffer; for all platforms that matter this compiles to
+   plain (unaligned) loads and stores. */
+#if BSWAP_VEC_SIZE > 0
+#define BSWAP_COPY_VEC(n) do { \
+    for (; i + BSWAP_VEC_SIZE / (n) <= num; i += BSWAP_VEC_SIZE / (n)) \
+      bswap_vec_store (dst + (n) * i, bswap_vec_##n (bswap_vec_load (src + (n) * i))); \
+  } while (0)
+#else
+#define BSWAP_COPY_VEC(n) do { } while (0)
+#endif
+
+static void bswap_copy2 (unsigned char *dst, const unsigned char *src, uint32_t num)
+{
+  uint32_t i = 0;
+  BSWAP_COPY_VEC (2);
+  for (; i < num; i++)
+  {
+    uint16_t x;
+    memcpy (&x, src + 2 * i, sizeof (x));
+    x = ddsrt_bswap2u (x);
+    memcpy (dst + 2 * i, &x, sizeof (x));
+  }
+}
+
+static void bswap_copy4 (unsigned char *dst, const unsigned char *src, uint32_t num)
+{
+  uint32_t i = 0;
+  BSWAP_COPY_VEC (4);
+  for (; i < num; i++)
+  {
+    uint32_t x;
+    memcpy (&x, src + 4 * i, sizeof (x));
+    x = ddsrt_bswap4u (x);
+    memcpy (dst + 4 * i, &x, sizeof (x));
+  }
+}
+
+static void bswap_copy8 (unsigned char *dst, const unsigned char *src, uint32_t num)
+{
+  uint32_t i = 0;
+  BSWAP_COPY_VEC (8);
+  for (; i < num; i++)
+  {
+    uint64_t x;
+    memcpy (&x, src + 8 * i, sizeof (x));
+    x = ddsrt_bswap8u (x);
+    memcpy (dst + 8 * i, &x, sizeof (x));
+  }
+}
+
+#undef BSWAP_COPY_VEC
+
+void ddsrt_bswap_copy (void *dst, const void *src, uint32_t size, uint32_t num)
+{
+  assert (size == 1 || size == 2 || size == 4 || size == 8);
+  switch (size)
+  {
+    case 1:
+      if (dst != src)
+        memcpy (dst, src, num);
+      break;
+    case 2:
+      bswap_copy2 (dst, src, num);
+      break;
+    case 4:
+      bswap_copy4 (dst, src, num);
+      break;
+    case 8:
+      bswap_copy8 (dst, src, num);
+      break;
+  }
+}
@@ -16,6 +16,7 @@
 #include <string.h>
 
 #include "dds/ddsrt/log.h"
+#include "dds/ddsrt/log_binary.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/threads.h"
 #include "dds/ddsrt/static_assert.h"
@@ -46,6 +47,7 @@ static ddsrt_rwlock_t lock;
 struct ddsrt_log_cfg_impl {
   struct ddsrt_log_cfg_common c;
   FILE *sink_fps[2];
+  struct ddsrt_log_binary *binary;
 };
 
 DDSRT_STATIC_ASSERT (sizeof (struct ddsrt_log_cfg_impl) <= sizeof (struct ddsrt_log_cfg));
@@ -168,6 +170,12 @@ void dds_log_cfg_init (struct ddsrt_log_cfg *cfg, uint32_t domid, uint32_t trace
   cfgimpl->sink_fps[TRACE] = trace_fp;
 }
 
+void dds_log_cfg_set_binary (struct ddsrt_log_cfg *cfg, struct ddsrt_log_binary *bt)
+{
+  struct ddsrt_log_cfg_impl *cfgimpl = (struct ddsrt_log_cfg_impl *) cfg;
+  cfgimpl->binary = bt;
+}
+
 static size_t print_header (char *str, uint32_t id)
 {
   int cnt, off;
@@ -278,8 +286,9 @@ static void vlog1 (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, uint32_t
     }
     /* if tracing is enabled, then print to trace if it matches the
        trace flags or if it got written to the log
-       (mask == (tracemask | DDS_LOG_MASK)) */
-    if (cfg->c.tracemask && (cat & cfg->c.mask))
+       (mask == (tracemask | DDS_LOG_MASK)), unless it has been written
+       to the binary trace already */
+    if (cfg->c.tracemask && (cat & cfg->c.mask) && cfg->binary == NULL)
     {
       dds_log_write_fn_t const g = sinks[TRACE].func;
       void * const g_arg = (g == default_sink) ? cfg->sink_fps[TRACE] : sinks[TRACE].ptr;
@@ -295,6 +304,18 @@ static void vlog1 (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, uint32_t
 
 static void vlog (const struct ddsrt_log_cfg_impl *cfg, uint32_t cat, uint32_t domid, const char *file, uint32_t line, const char *func, const char *fmt, va_list ap)
 {
+  /* binary tracing doesn't need the lock: the binary trace writer can't
+     change while it is in use, and messages that only go to the trace
+     don't need formatting */
+  if (cfg->binary && cfg->c.tracemask && (cat & cfg->c.mask))
+  {
+    va_list ap1;
+    va_copy (ap1, ap);
+    ddsrt_log_binary_vlog (cfg->binary, cat, domid, fmt, ap1);
+    va_end (ap1);
+    if (!(cat & DDS_LOG_MASK))
+      return;
+  }
   lock_sink (RDLOCK);
   vlog1 (cfg, cat, domid, file, line, func, fmt, ap);
   unlock_sink ();
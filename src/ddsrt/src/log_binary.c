@@ -0,0 +1,724 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dds/ddsrt/atomics.h"
+#include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/hopscotch.h"
+#include "dds/ddsrt/log_binary.h"
+#include "dds/ddsrt/static_assert.h"
+#include "dds/ddsrt/string.h"
+#include "dds/ddsrt/sync.h"
+#include "dds/ddsrt/threads.h"
+#include "dds/ddsrt/time.h"
+
+/* Each thread has a private single-producer/single-consumer ring of
+   fixed-size slots for up to LOG_BINARY_NRINGS binary trace writers.  A
+   record occupies one or more consecutive slots, starting with a header;
+   if it doesn't fit in the remainder of the ring, that remainder is filled
+   with a padding record and the record starts at the beginning.
+
+   Format strings are identified by a hash of their contents, computed while
+   parsing the format to collect the arguments.  The first time a ring sees
+   a format it stores a copy of it in the ring, so the writer never needs to
+   dereference a format pointer (and hence it need not be a literal).
+
+   Rings are linked into the trace writer, and both attaching a ring and
+   detaching it on thread termination happen while holding log_binary_lock.
+   The writer holds it while draining the rings, a terminating thread
+   therefore only marks the ring as dead for the writer to free it after
+   having written its contents.  The rings of threads that are still alive
+   when the writer is freed get detached and are reused or freed by their
+   owners.
+
+   The output file starts with LOG_BINARY_MAGIC followed by a 32-bit
+   0x01020304 to indicate the byte order, followed by records each
+   starting with a byte indicating its kind:
+
+   - LOG_BINARY_FILE_FMT: u64 id, u32 len, format string (len bytes)
+   - LOG_BINARY_FILE_THREAD: u32 thread, u32 len, thread name (len bytes)
+   - LOG_BINARY_FILE_EVENT: u32 thread, u64 id, i64 time, u32 cat,
+     u32 domid, u8 flags, u32 len, arguments (len bytes)
+   - LOG_BINARY_FILE_DROPPED: u32 thread, u32 number of dropped messages
+
+   Arguments are stored in the order of the conversions in the format
+   string: 8 bytes for integers (sign- or zero-extended), floating-point
+   numbers (as a double) and pointers, or a 16-bit length followed by the
+   characters for strings.  The magic may occur again if the file was
+   appended to. */
+
+#define LOG_BINARY_NRINGS 4
+#define LOG_BINARY_SLOTSIZE 64u
+#define LOG_BINARY_MAXRECSIZE 2048u
+#define LOG_BINARY_MINSLOTS 128u
+#define LOG_BINARY_FMTCACHE 256u
+#define LOG_BINARY_INTERVAL DDS_MSECS (10)
+
+#define LOG_BINARY_MAGIC "\177CDDSBT1"
+#define LOG_BINARY_FILE_FMT 1
+#define LOG_BINARY_FILE_THREAD 2
+#define LOG_BINARY_FILE_EVENT 3
+#define LOG_BINARY_FILE_DROPPED 4
+
+#define LOG_BINARY_FLAG_TRUNC 1u
+
+enum log_binary_reckind {
+  LBR_PAD,
+  LBR_FMT,
+  LBR_EVENT
+};
+
+struct log_binary_rechdr {
+  uint16_t nslots;
+  uint8_t kind;
+  uint8_t flags;
+  uint32_t size;
+  uint64_t id;
+  int64_t tstamp;
+  uint32_t cat;
+  uint32_t domid;
+};
+
+DDSRT_STATIC_ASSERT (sizeof (struct log_binary_rechdr) <= LOG_BINARY_SLOTSIZE);
+
+struct log_binary_slot {
+  unsigned char x[LOG_BINARY_SLOTSIZE];
+};
+
+struct log_binary_ring {
+  ddsrt_atomic_voidp_t bt; /* NULL if not in use */
+  struct log_binary_ring *next, *prev;
+  ddsrt_atomic_uint32_t head; /* written by owner */
+  ddsrt_atomic_uint32_t tail; /* written by trace writer */
+  ddsrt_atomic_uint32_t dropped;
+  ddsrt_atomic_uint32_t dead;
+  uint32_t size; /* in slots, power of 2 */
+  struct log_binary_slot *slots;
+  uint64_t fmtcache[LOG_BINARY_FMTCACHE];
+  /* only accessed by the trace writer */
+  uint32_t id;
+  bool announced;
+  uint32_t dropped_reported;
+  uint32_t drain_head, drain_tail;
+  uint32_t drain_dead;
+  char name[32];
+};
+
+struct ddsrt_log_binary {
+  FILE *fp;
+  uint32_t ringsize;
+  uint32_t next_ring_id;
+  struct log_binary_ring *rings; /* protected by log_binary_lock */
+  struct ddsrt_ehh *fmts;
+  ddsrt_thread_t tid;
+  ddsrt_mutex_t lock;
+  ddsrt_cond_t cond;
+  bool stop;
+  bool wakeup;
+  size_t opos;
+  unsigned char obuf[65536];
+};
+
+static ddsrt_thread_local struct log_binary_ring *log_binary_rings[LOG_BINARY_NRINGS];
+static ddsrt_thread_local bool log_binary_cleanup_registered;
+static ddsrt_thread_local unsigned char log_binary_buf[LOG_BINARY_MAXRECSIZE];
+static ddsrt_once_t log_binary_once = DDSRT_ONCE_INIT;
+static ddsrt_mutex_t log_binary_lock;
+
+static void log_binary_init (void)
+{
+  ddsrt_mutex_init (&log_binary_lock);
+}
+
+static void free_ring (struct log_binary_ring *r)
+{
+  ddsrt_free (r->slots);
+  ddsrt_free (r);
+}
+
+static void unlink_ring (struct ddsrt_log_binary *bt, struct log_binary_ring *r)
+{
+  if (r->next)
+    r->next->prev = r->prev;
+  if (r->prev)
+    r->prev->next = r->next;
+  else
+    bt->rings = r->next;
+}
+
+static void log_binary_cleanup (void *arg)
+{
+  (void) arg;
+  ddsrt_mutex_lock (&log_binary_lock);
+  for (int i = 0; i < LOG_BINARY_NRINGS; i++)
+  {
+    struct log_binary_ring * const r = log_binary_rings[i];
+    if (r == NULL)
+      continue;
+    log_binary_rings[i] = NULL;
+    if (ddsrt_atomic_ldvoidp (&r->bt) != NULL)
+      ddsrt_atomic_st32 (&r->dead, 1);
+    else
+      free_ring (r);
+  }
+  ddsrt_mutex_unlock (&log_binary_lock);
+  log_binary_cleanup_registered = false;
+}
+
+static struct log_binary_ring *attach_ring (struct ddsrt_log_binary *bt, int i)
+{
+  struct log_binary_ring *r;
+  if (!log_binary_cleanup_registered)
+  {
+    if (ddsrt_thread_cleanup_push (&log_binary_cleanup, NULL) != DDS_RETCODE_OK)
+      return NULL;
+    log_binary_cleanup_registered = true;
+  }
+  if ((r = log_binary_rings[i]) == NULL)
+  {
+    r = ddsrt_malloc (sizeof (*r));
+    r->size = 0;
+    r->slots = NULL;
+    ddsrt_atomic_stvoidp (&r->bt, NULL);
+    log_binary_rings[i] = r;
+  }
+  if (r->size != bt->ringsize)
+  {
+    ddsrt_free (r->slots);
+    r->size = bt->ringsize;
+    r->slots = ddsrt_malloc (r->size * sizeof (*r->slots));
+  }
+  ddsrt_atomic_st32 (&r->head, 0);
+  ddsrt_atomic_st32 (&r->tail, 0);
+  ddsrt_atomic_st32 (&r->dropped, 0);
+  ddsrt_atomic_st32 (&r->dead, 0);
+  /* a hash of 0 can only ever be cached in entry 0, so initializing that
+     one to 1 means no format is mistaken for one that has been sent */
+  memset (r->fmtcache, 0, sizeof (r->fmtcache));
+  r->fmtcache[0] = 1;
+  r->announced = false;
+  r->dropped_reported = 0;
+  (void) ddsrt_thread_getname (r->name, sizeof (r->name));
+  if (r->name[0] == 0)
+    (void) ddsrt_strlcpy (r->name, "(anon)", sizeof (r->name));
+
+  ddsrt_once (&log_binary_once, log_binary_init);
+  ddsrt_mutex_lock (&log_binary_lock);
+  r->id = bt->next_ring_id++;
+  r->prev = NULL;
+  r->next = bt->rings;
+  if (r->next)
+    r->next->prev = r;
+  bt->rings = r;
+  ddsrt_atomic_stvoidp (&r->bt, bt);
+  ddsrt_mutex_unlock (&log_binary_lock);
+  return r;
+}
+
+static struct log_binary_ring *get_ring (struct ddsrt_log_binary *bt)
+{
+  int avail = -1;
+  for (int i = 0; i < LOG_BINARY_NRINGS; i++)
+  {
+    struct log_binary_ring * const r = log_binary_rings[i];
+    const void *rbt = r ? ddsrt_atomic_ldvoidp (&r->bt) : NULL;
+    if (rbt == bt)
+      return r;
+    else if (rbt == NULL && avail < 0)
+      avail = i;
+  }
+  return (avail < 0) ? NULL : attach_ring (bt, avail);
+}
+
+static void wakeup_writer (struct ddsrt_log_binary *bt)
+{
+  ddsrt_mutex_lock (&bt->lock);
+  bt->wakeup = true;
+  ddsrt_cond_broadcast (&bt->cond);
+  ddsrt_mutex_unlock (&bt->lock);
+}
+
+static bool ring_put (struct ddsrt_log_binary *bt, struct log_binary_ring *r, struct log_binary_rechdr *hdr, const void *payload)
+{
+  const uint32_t nslots = (uint32_t) (sizeof (*hdr) + hdr->size + LOG_BINARY_SLOTSIZE - 1) / LOG_BINARY_SLOTSIZE;
+  const uint32_t head = ddsrt_atomic_ld32 (&r->head);
+  const uint32_t tail = ddsrt_atomic_ld32 (&r->tail);
+  uint32_t pos = head & (r->size - 1);
+  const uint32_t pad = (pos + nslots > r->size) ? r->size - pos : 0;
+  if (nslots > r->size / 2 || (head - tail) + pad + nslots > r->size)
+    return false;
+  /* slots freed by the trace writer may be reused only after it is done
+     reading them */
+  ddsrt_atomic_fence_acq ();
+  if (pad > 0)
+  {
+    struct log_binary_rechdr padhdr;
+    memset (&padhdr, 0, sizeof (padhdr));
+    padhdr.nslots = (uint16_t) pad;
+    padhdr.kind = LBR_PAD;
+    memcpy (&r->slots[pos], &padhdr, sizeof (padhdr));
+    pos = 0;
+  }
+  hdr->nslots = (uint16_t) nslots;
+  memcpy (&r->slots[pos], hdr, sizeof (*hdr));
+  memcpy (r->slots[pos].x + sizeof (*hdr), payload, hdr->size);
+  ddsrt_atomic_fence_rel ();
+  ddsrt_atomic_st32 (&r->head, head + pad + nslots);
+  /* polling is fine for the average thread, but one producing messages at
+     a high rate gets the writer's attention when its ring is half full */
+  if ((head - tail) < r->size / 2 && (head - tail) + pad + nslots >= r->size / 2)
+    wakeup_writer (bt);
+  return true;
+}
+
+static bool put_u64 (unsigned char *buf, uint32_t *pos, uint32_t bufsize, uint64_t v)
+{
+  if (bufsize - *pos < sizeof (v))
+    return false;
+  memcpy (buf + *pos, &v, sizeof (v));
+  *pos += (uint32_t) sizeof (v);
+  return true;
+}
+
+static bool put_double (unsigned char *buf, uint32_t *pos, uint32_t bufsize, double v)
+{
+  if (bufsize - *pos < sizeof (v))
+    return false;
+  memcpy (buf + *pos, &v, sizeof (v));
+  *pos += (uint32_t) sizeof (v);
+  return true;
+}
+
+static bool put_string (unsigned char *buf, uint32_t *pos, uint32_t bufsize, const char *s, int prec, uint8_t *flags)
+{
+  uint16_t len = 0;
+  size_t n = 0;
+  if (s == NULL)
+    s = "(null)";
+  while ((prec < 0 || n < (size_t) prec) && s[n])
+    n++;
+  if (bufsize - *pos < sizeof (len))
+    return false;
+  if (n > bufsize - *pos - sizeof (len))
+  {
+    n = bufsize - *pos - sizeof (len);
+    *flags |= LOG_BINARY_FLAG_TRUNC;
+  }
+  len = (uint16_t) n;
+  memcpy (buf + *pos, &len, sizeof (len));
+  memcpy (buf + *pos + sizeof (len), s, n);
+  *pos += (uint32_t) (sizeof (len) + n);
+  return true;
+}
+
+enum log_binary_lenmod { LM_NONE, LM_HH, LM_H, LM_L, LM_LL, LM_J, LM_Z, LM_T, LM_BIGL };
+
+/* Collects the arguments for fmt in buf, returns the number of bytes used
+   and sets *id and *fmtlen to the hash and length of fmt */
+static uint32_t encode_args (unsigned char *buf, uint32_t bufsize, const char *fmt, va_list ap, uint64_t *id, uint32_t *fmtlen, uint8_t *flags)
+{
+  uint64_t h = UINT64_C (14695981039346656037);
+  uint32_t pos = 0;
+  bool ok = true;
+  const char *p = fmt, *spec;
+#define HASH_UPTO(end) do { \
+    for (; spec < (end); spec++) \
+      h = (h ^ (unsigned char) *spec) * UINT64_C (1099511628211); \
+  } while (0)
+  while (*p)
+  {
+    spec = p;
+    if (*p++ != '%' || !ok)
+    {
+      HASH_UPTO (p);
+      continue;
+    }
+    int prec = -1;
+    while (*p && strchr ("-+ #0'", *p))
+      p++;
+    if (*p == '*')
+    {
+      ok = ok && put_u64 (buf, &pos, bufsize, (uint64_t) (int64_t) va_arg (ap, int));
+      p++;
+    }
+    else
+    {
+      while (*p >= '0' && *p <= '9')
+        p++;
+    }
+    if (*p == '.')
+    {
+      p++;
+      if (*p == '*')
+      {
+        prec = va_arg (ap, int);
+        ok = ok && put_u64 (buf, &pos, bufsize, (uint64_t) (int64_t) prec);
+        p++;
+      }
+      else
+      {
+        prec = 0;
+        while (*p >= '0' && *p <= '9')
+          prec = 10 * prec + (*p++ - '0');
+      }
+    }
+    enum log_binary_lenmod lm = LM_NONE;
+    switch (*p)
+    {
+      case 'h': p++; if (*p == 'h') { lm = LM_HH; p++; } else { lm = LM_H; } break;
+      case 'l': p++; if (*p == 'l') { lm = LM_LL; p++; } else { lm = LM_L; } break;
+      case 'q': p++; lm = LM_LL; break;
+      case 'j': p++; lm = LM_J; break;
+      case 'z': p++; lm = LM_Z; break;
+      case 't': p++; lm = LM_T; break;
+      case 'L': p++; lm = LM_BIGL; break;
+    }
+    switch (*p)
+    {
+      case 'd': case 'i': {
+        int64_t v;
+        switch (lm)
+        {
+          case LM_HH: v = (signed char) va_arg (ap, int); break;
+          case LM_H: v = (short) va_arg (ap, int); break;
+          case LM_L: v = va_arg (ap, long); break;
+          case LM_LL: case LM_BIGL: v = va_arg (ap, long long); break;
+          case LM_J: v = va_arg (ap, intmax_t); break;
+          case LM_Z: v = (int64_t) va_arg (ap, size_t); break;
+          case LM_T: v = va_arg (ap, ptrdiff_t); break;
+          default: v = va_arg (ap, int); break;
+        }
+        ok = ok && put_u64 (buf, &pos, bufsize, (uint64_t) v);
+        break;
+      }
+      case 'u': case 'o': case 'x': case 'X': {
+        uint64_t v;
+        switch (lm)
+        {
+          case LM_HH: v = (unsigned char) va_arg (ap, unsigned); break;
+          case LM_H: v = (unsigned short) va_arg (ap, unsigned); break;
+          case LM_L: v = va_arg (ap, unsigned long); break;
+          case LM_LL: case LM_BIGL: v = va_arg (ap, unsigned long long); break;
+          case LM_J: v = va_arg (ap, uintmax_t); break;
+          case LM_Z: v = va_arg (ap, size_t); break;
+          case LM_T: v = (uint64_t) va_arg (ap, ptrdiff_t); break;
+          default: v = va_arg (ap, unsigned); break;
+        }
+        ok = ok && put_u64 (buf, &pos, bufsize, v);
+        break;
+      }
+      case 'c':
+        ok = ok && put_u64 (buf, &pos, bufsize, (unsigned char) va_arg (ap, int));
+        break;
+      case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A': {
+        double v;
+        if (lm == LM_BIGL)
+          v = (double) va_arg (ap, long double);
+        else
+          v = va_arg (ap, double);
+        ok = ok && put_double (buf, &pos, bufsize, v);
+        break;
+      }
+      case 's':
+        ok = ok && put_string (buf, &pos, bufsize, va_arg (ap, const char *), prec, flags);
+        break;
+      case 'p':
+        ok = ok && put_u64 (buf, &pos, bufsize, (uint64_t) (uintptr_t) va_arg (ap, void *));
+        break;
+      case 'n':
+        (void) va_arg (ap, void *);
+        break;
+      case '%':
+        break;
+      default:
+        /* unknown conversion: can't know how to get the next argument */
+        ok = false;
+        break;
+    }
+    if (*p)
+      p++;
+    HASH_UPTO (p);
+  }
+#undef HASH_UPTO
+  if (!ok)
+    *flags |= LOG_BINARY_FLAG_TRUNC;
+  *id = h;
+  *fmtlen = (uint32_t) (p - fmt);
+  return pos;
+}
+
+void ddsrt_log_binary_vlog (struct ddsrt_log_binary *bt, uint32_t cat, uint32_t domid, const char *fmt, va_list ap)
+{
+  struct log_binary_ring *r;
+  struct log_binary_rechdr hdr;
+  uint32_t fmtlen;
+  if ((r = get_ring (bt)) == NULL)
+    return;
+  memset (&hdr, 0, sizeof (hdr));
+  hdr.size = encode_args (log_binary_buf, sizeof (log_binary_buf) - sizeof (hdr), fmt, ap, &hdr.id, &fmtlen, &hdr.flags);
+  uint64_t * const cached = &r->fmtcache[hdr.id % LOG_BINARY_FMTCACHE];
+  if (*cached != hdr.id)
+  {
+    struct log_binary_rechdr fmthdr;
+    memset (&fmthdr, 0, sizeof (fmthdr));
+    fmthdr.kind = LBR_FMT;
+    fmthdr.id = hdr.id;
+    fmthdr.size = fmtlen;
+    if (!ring_put (bt, r, &fmthdr, fmt))
+    {
+      ddsrt_atomic_inc32 (&r->dropped);
+      return;
+    }
+    *cached = hdr.id;
+  }
+  hdr.kind = LBR_EVENT;
+  hdr.tstamp = dds_time ();
+  hdr.cat = cat;
+  hdr.domid = domid;
+  if (!ring_put (bt, r, &hdr, log_binary_buf))
+    ddsrt_atomic_inc32 (&r->dropped);
+}
+
+static void flush_out (struct ddsrt_log_binary *bt)
+{
+  if (bt->opos > 0)
+  {
+    (void) fwrite (bt->obuf, 1, bt->opos, bt->fp);
+    bt->opos = 0;
+  }
+  fflush (bt->fp);
+}
+
+static void out (struct ddsrt_log_binary *bt, const void *data, size_t size)
+{
+  if (size > sizeof (bt->obuf) - bt->opos)
+  {
+    (void) fwrite (bt->obuf, 1, bt->opos, bt->fp);
+    bt->opos = 0;
+    if (size > sizeof (bt->obuf))
+    {
+      (void) fwrite (data, 1, size, bt->fp);
+      return;
+    }
+  }
+  memcpy (bt->obuf + bt->opos, data, size);
+  bt->opos += size;
+}
+
+static void out_u8 (struct ddsrt_log_binary *bt, uint8_t x) { out (bt, &x, sizeof (x)); }
+static void out_u32 (struct ddsrt_log_binary *bt, uint32_t x) { out (bt, &x, sizeof (x)); }
+static void out_u64 (struct ddsrt_log_binary *bt, uint64_t x) { out (bt, &x, sizeof (x)); }
+
+static const struct log_binary_rechdr *ring_peek (const struct log_binary_ring *r, struct log_binary_rechdr *hdr)
+{
+  memcpy (hdr, &r->slots[r->drain_tail & (r->size - 1)], sizeof (*hdr));
+  return hdr;
+}
+
+static const unsigned char *ring_payload (const struct log_binary_ring *r)
+{
+  return r->slots[r->drain_tail & (r->size - 1)].x + sizeof (struct log_binary_rechdr);
+}
+
+static void write_fmt (struct ddsrt_log_binary *bt, const struct log_binary_ring *r, const struct log_binary_rechdr *hdr)
+{
+  if (ddsrt_ehh_lookup (bt->fmts, &hdr->id) == NULL)
+  {
+    (void) ddsrt_ehh_add (bt->fmts, &hdr->id);
+    out_u8 (bt, LOG_BINARY_FILE_FMT);
+    out_u64 (bt, hdr->id);
+    out_u32 (bt, hdr->size);
+    out (bt, ring_payload (r), hdr->size);
+  }
+}
+
+static void write_event (struct ddsrt_log_binary *bt, const struct log_binary_ring *r, const struct log_binary_rechdr *hdr)
+{
+  out_u8 (bt, LOG_BINARY_FILE_EVENT);
+  out_u32 (bt, r->id);
+  out_u64 (bt, hdr->id);
+  out_u64 (bt, (uint64_t) hdr->tstamp);
+  out_u32 (bt, hdr->cat);
+  out_u32 (bt, hdr->domid);
+  out_u8 (bt, hdr->flags);
+  out_u32 (bt, hdr->size);
+  out (bt, ring_payload (r), hdr->size);
+}
+
+/* Writes the contents of all rings, merging the events from the various
+   threads in order of their timestamps, and frees the rings of threads that
+   have terminated; must be called with log_binary_lock held */
+static bool drain_rings (struct ddsrt_log_binary *bt)
+{
+  struct log_binary_ring *r, *rnext;
+  bool wrote = false;
+  for (r = bt->rings; r; r = r->next)
+  {
+    r->drain_dead = ddsrt_atomic_ld32 (&r->dead);
+    r->drain_head = ddsrt_atomic_ld32 (&r->head);
+    r->drain_tail = ddsrt_atomic_ld32 (&r->tail);
+    if (!r->announced && r->drain_head != r->drain_tail)
+    {
+      const uint32_t len = (uint32_t) strlen (r->name);
+      out_u8 (bt, LOG_BINARY_FILE_THREAD);
+      out_u32 (bt, r->id);
+      out_u32 (bt, len);
+      out (bt, r->name, len);
+      r->announced = true;
+    }
+  }
+  ddsrt_atomic_fence_acq ();
+  while (true)
+  {
+    struct log_binary_ring *rmin = NULL;
+    struct log_binary_rechdr hdr, hdrmin;
+    for (r = bt->rings; r; r = r->next)
+    {
+      while (r->drain_tail != r->drain_head && ring_peek (r, &hdr)->kind != LBR_EVENT)
+      {
+        if (hdr.kind == LBR_FMT)
+          write_fmt (bt, r, &hdr);
+        r->drain_tail += hdr.nslots;
+      }
+      if (r->drain_tail != r->drain_head && (rmin == NULL || hdr.tstamp < hdrmin.tstamp))
+      {
+        rmin = r;
+        hdrmin = hdr;
+      }
+    }
+    if (rmin == NULL)
+      break;
+    write_event (bt, rmin, &hdrmin);
+    rmin->drain_tail += hdrmin.nslots;
+    wrote = true;
+  }
+  ddsrt_atomic_fence_rel ();
+  for (r = bt->rings; r; r = rnext)
+  {
+    const uint32_t dropped = ddsrt_atomic_ld32 (&r->dropped);
+    rnext = r->next;
+    ddsrt_atomic_st32 (&r->tail, r->drain_tail);
+    if (dropped != r->dropped_reported)
+    {
+      out_u8 (bt, LOG_BINARY_FILE_DROPPED);
+      out_u32 (bt, r->id);
+      out_u32 (bt, dropped - r->dropped_reported);
+      r->dropped_reported = dropped;
+      wrote = true;
+    }
+    if (r->drain_dead)
+    {
+      unlink_ring (bt, r);
+      free_ring (r);
+    }
+  }
+  return wrote;
+}
+
+static uint32_t log_binary_writer (void *vbt)
+{
+  struct ddsrt_log_binary * const bt = vbt;
+  ddsrt_mutex_lock (&bt->lock);
+  while (!bt->stop)
+  {
+    bool wrote;
+    ddsrt_mutex_unlock (&bt->lock);
+    ddsrt_mutex_lock (&log_binary_lock);
+    wrote = drain_rings (bt);
+    ddsrt_mutex_unlock (&log_binary_lock);
+    if (wrote)
+      flush_out (bt);
+    ddsrt_mutex_lock (&bt->lock);
+    if (!bt->stop && !bt->wakeup)
+      (void) ddsrt_cond_waitfor (&bt->cond, &bt->lock, LOG_BINARY_INTERVAL);
+    bt->wakeup = false;
+  }
+  ddsrt_mutex_unlock (&bt->lock);
+  return 0;
+}
+
+static uint32_t fmt_hash (const void *va)
+{
+  const uint64_t *a = va;
+  return (uint32_t) (*a ^ (*a >> 32));
+}
+
+static int fmt_equals (const void *va, const void *vb)
+{
+  const uint64_t *a = va, *b = vb;
+  return *a == *b;
+}
+
+struct ddsrt_log_binary *ddsrt_log_binary_new (FILE *fp, uint32_t bufsize)
+{
+  struct ddsrt_log_binary *bt;
+  ddsrt_threadattr_t tattr;
+  const uint32_t bom = 0x01020304;
+  uint32_t ringsize = LOG_BINARY_MINSLOTS;
+  while (ringsize <= bufsize / LOG_BINARY_SLOTSIZE / 2)
+    ringsize *= 2;
+
+  ddsrt_once (&log_binary_once, log_binary_init);
+  bt = ddsrt_malloc (sizeof (*bt));
+  bt->fp = fp;
+  bt->ringsize = ringsize;
+  bt->next_ring_id = 0;
+  bt->rings = NULL;
+  bt->fmts = ddsrt_ehh_new (sizeof (uint64_t), 256, fmt_hash, fmt_equals);
+  bt->stop = false;
+  bt->wakeup = false;
+  bt->opos = 0;
+  ddsrt_mutex_init (&bt->lock);
+  ddsrt_cond_init (&bt->cond);
+  out (bt, LOG_BINARY_MAGIC, sizeof (LOG_BINARY_MAGIC) - 1);
+  out_u32 (bt, bom);
+  flush_out (bt);
+  ddsrt_threadattr_init (&tattr);
+  if (ddsrt_thread_create (&bt->tid, "bintrace", &tattr, log_binary_writer, bt) != DDS_RETCODE_OK)
+  {
+    ddsrt_cond_destroy (&bt->cond);
+    ddsrt_mutex_destroy (&bt->lock);
+    ddsrt_ehh_free (bt->fmts);
+    ddsrt_free (bt);
+    return NULL;
+  }
+  return bt;
+}
+
+void ddsrt_log_binary_free (struct ddsrt_log_binary *bt)
+{
+  struct log_binary_ring *r, *rnext;
+  ddsrt_mutex_lock (&bt->lock);
+  bt->stop = true;
+  ddsrt_cond_broadcast (&bt->cond);
+  ddsrt_mutex_unlock (&bt->lock);
+  (void) ddsrt_thread_join (bt->tid, NULL);
+
+  ddsrt_mutex_lock (&log_binary_lock);
+  (void) drain_rings (bt);
+  for (r = bt->rings; r; r = rnext)
+  {
+    rnext = r->next;
+    ddsrt_atomic_stvoidp (&r->bt, NULL);
+  }
+  ddsrt_mutex_unlock (&log_binary_lock);
+  flush_out (bt);
+
+  ddsrt_cond_destroy (&bt->cond);
+  ddsrt_mutex_destroy (&bt->lock);
+  ddsrt_ehh_free (bt->fmts);
+  ddsrt_free (bt);
+}
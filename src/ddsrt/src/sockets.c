@@ -447,3 +447,46 @@ ddsrt_setsockreuse(ddsrt_socket_t sock, bool reuse)
 #endif
   return ddsrt_setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, &flags, sizeof (flags));
 }
+
+#if !DDSRT_HAVE_RECVMMSG
+dds_return_t
+ddsrt_recvmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_msghdr_t *msgs,
+  ssize_t *rcvd,
+  size_t nmsgs,
+  int flags,
+  size_t *nrcvd)
+{
+  dds_return_t rc;
+  assert(nmsgs > 0);
+  (void)nmsgs;
+  if ((rc = ddsrt_recvmsg(sock, &msgs[0], flags, &rcvd[0])) == DDS_RETCODE_OK)
+    *nrcvd = 1;
+  else
+    *nrcvd = 0;
+  return rc;
+}
+#endif
+
+#if !DDSRT_HAVE_SENDMMSG
+dds_return_t
+ddsrt_sendmmsg(
+  ddsrt_socket_t sock,
+  const ddsrt_msghdr_t *msgs,
+  ssize_t *sent,
+  size_t nmsgs,
+  int flags,
+  size_t *nsent)
+{
+  dds_return_t rc = DDS_RETCODE_OK;
+  size_t i;
+  for (i = 0; i < nmsgs; i++)
+  {
+    if ((rc = ddsrt_sendmsg(sock, &msgs[i], flags, &sent[i])) != DDS_RETCODE_OK)
+      break;
+  }
+  *nsent = i;
+  return rc;
+}
+#endif
@@ -9,6 +9,8 @@
  *
  * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
  */
+#define _GNU_SOURCE /* Required for recvmmsg, sendmmsg and MSG_WAITFORONE. */
+
 #include <assert.h>
 #include <string.h>
 #include <unistd.h>
@@ -434,6 +436,43 @@ ddsrt_recvmsg(
   return recv_error_to_retcode(errno);
 }
 
+#if DDSRT_HAVE_RECVMMSG
+#define RECVMMSG_MAX 64
+
+dds_return_t
+ddsrt_recvmmsg(
+  ddsrt_socket_t sock,
+  ddsrt_msghdr_t *msgs,
+  ssize_t *rcvd,
+  size_t nmsgs,
+  int flags,
+  size_t *nrcvd)
+{
+  struct mmsghdr mmsgs[RECVMMSG_MAX];
+  unsigned int vlen = (nmsgs < RECVMMSG_MAX) ? (unsigned int) nmsgs : RECVMMSG_MAX;
+  int n;
+
+  assert(nmsgs > 0);
+  for (unsigned int i = 0; i < vlen; i++) {
+    mmsgs[i].msg_hdr = msgs[i];
+    mmsgs[i].msg_len = 0;
+  }
+  if ((n = recvmmsg(sock, mmsgs, vlen, flags | MSG_WAITFORONE, NULL)) != -1) {
+    assert(n >= 0);
+    for (int i = 0; i < n; i++) {
+      msgs[i].msg_namelen = mmsgs[i].msg_hdr.msg_namelen;
+      msgs[i].msg_flags = mmsgs[i].msg_hdr.msg_flags;
+      rcvd[i] = (ssize_t) mmsgs[i].msg_len;
+    }
+    *nrcvd = (size_t) n;
+    return DDS_RETCODE_OK;
+  }
+
+  *nrcvd = 0;
+  return recv_error_to_retcode(errno);
+}
+#endif /* DDSRT_HAVE_RECVMMSG */
+
 static inline dds_return_t
 send_error_to_retcode(int errnum)
 {
@@ -514,6 +553,41 @@ ddsrt_sendmsg(
   return send_error_to_retcode(errno);
 }
 
+#if DDSRT_HAVE_SENDMMSG
+#define SENDMMSG_MAX 64
+
+dds_return_t
+ddsrt_sendmmsg(
+  ddsrt_socket_t sock,
+  const ddsrt_msghdr_t *msgs,
+  ssize_t *sent,
+  size_t nmsgs,
+  int flags,
+  size_t *nsent)
+{
+  struct mmsghdr mmsgs[SENDMMSG_MAX];
+  size_t off = 0;
+
+  while (off < nmsgs) {
+    unsigned int vlen = (nmsgs - off < SENDMMSG_MAX) ? (unsigned int) (nmsgs - off) : SENDMMSG_MAX;
+    int n;
+    for (unsigned int i = 0; i < vlen; i++) {
+      mmsgs[i].msg_hdr = msgs[off + i];
+      mmsgs[i].msg_len = 0;
+    }
+    if ((n = sendmmsg(sock, mmsgs, vlen, flags)) == -1) {
+      *nsent = off;
+      return send_error_to_retcode(errno);
+    }
+    for (int i = 0; i < n; i++)
+      sent[off + (size_t) i] = (ssize_t) mmsgs[i].msg_len;
+    off += (size_t) n;
+  }
+  *nsent = off;
+  return DDS_RETCODE_OK;
+}
+#endif /* DDSRT_HAVE_SENDMMSG */
+
 dds_return_t
 ddsrt_select(
   int32_t nfds,
@@ -23,6 +23,7 @@
 #include "CUnit/Theory.h"
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/log.h"
+#include "dds/ddsrt/log_binary.h"
 #include "dds/ddsrt/misc.h"
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/sync.h"
@@ -508,3 +509,81 @@ CU_Theory((bool local, int mode, bool expect_in_trace), dds_log, fatal_aborts)
   (void) expect_in_trace;
 #endif
 }
+
+/* Binary tracing: the messages must end up in the file as a format string
+   and its arguments, and messages for the log must still go to the log. */
+#if HAVE_FMEMOPEN
+static bool binary_trace_find (const unsigned char *buf, size_t size, uint8_t kind, size_t *pos, uint32_t *len)
+{
+  while (*pos < size)
+  {
+    const uint8_t k = buf[(*pos)++];
+    size_t skip = 0;
+    switch (k)
+    {
+      case 1: skip = 8; break;  /* fmt: id, len, string */
+      case 2: skip = 4; break;  /* thread: id, len, name */
+      case 3: skip = 29; break; /* event: thread, id, time, cat, domid, flags, len, args */
+      case 4: *pos += 8; continue;
+      default: return false;
+    }
+    memcpy (len, buf + *pos + skip, sizeof (*len));
+    *pos += skip + sizeof (*len);
+    if (k == kind)
+      return true;
+    *pos += *len;
+  }
+  return false;
+}
+#endif
+
+CU_Test(dds_log, binary_trace, .fini=reset)
+{
+#if HAVE_FMEMOPEN
+  static const char magic[] = "\177CDDSBT1";
+  ddsrt_log_cfg_t logconfig;
+  struct ddsrt_log_binary *bt;
+  unsigned char buf[1024];
+  size_t nbytes, pos;
+  uint32_t len, bom;
+  int64_t arg;
+  char *msg = NULL;
+  FILE *fp;
+
+  fp = tmpfile ();
+  CU_ASSERT_PTR_NOT_NULL_FATAL (fp);
+  bt = ddsrt_log_binary_new (fp, 4096);
+  CU_ASSERT_PTR_NOT_NULL_FATAL (bt);
+  dds_set_log_sink (&copy, &msg);
+  dds_log_cfg_init (&logconfig, 0, DDS_LC_DISCOVERY, NULL, NULL);
+  dds_log_cfg_set_binary (&logconfig, bt);
+  DDS_CLOG (DDS_LC_DISCOVERY, &logconfig, "binary %d %s\n", -3, "foo");
+  DDS_CLOG (DDS_LC_ERROR, &logconfig, "error %d\n", 4);
+  CU_ASSERT_PTR_NOT_NULL_FATAL (msg);
+  CU_ASSERT (strcmp (msg, "error 4\n") == 0);
+  ddsrt_free (msg);
+  ddsrt_log_binary_free (bt);
+
+  (void) fseek (fp, 0L, SEEK_SET);
+  nbytes = fread (buf, 1, sizeof (buf), fp);
+  (void) fclose (fp);
+  CU_ASSERT_FATAL (nbytes > sizeof (magic) - 1 + sizeof (bom));
+  CU_ASSERT_FATAL (memcmp (buf, magic, sizeof (magic) - 1) == 0);
+  memcpy (&bom, buf + sizeof (magic) - 1, sizeof (bom));
+  CU_ASSERT_FATAL (bom == 0x01020304);
+  pos = sizeof (magic) - 1 + sizeof (bom);
+  CU_ASSERT_FATAL (binary_trace_find (buf, nbytes, 1, &pos, &len));
+  CU_ASSERT_FATAL (len == strlen ("binary %d %s\n") && pos + len <= nbytes);
+  CU_ASSERT (memcmp (buf + pos, "binary %d %s\n", len) == 0);
+  pos = sizeof (magic) - 1 + sizeof (bom);
+  CU_ASSERT_FATAL (binary_trace_find (buf, nbytes, 3, &pos, &len));
+  CU_ASSERT_FATAL (len == 8 + 2 + 3 && pos + len <= nbytes);
+  memcpy (&arg, buf + pos, sizeof (arg));
+  CU_ASSERT (arg == -3);
+  CU_ASSERT (memcmp (buf + pos + 8 + 2, "foo", 3) == 0);
+  /* the error is also traced */
+  pos += len;
+  CU_ASSERT_FATAL (binary_trace_find (buf, nbytes, 3, &pos, &len));
+  CU_ASSERT_FATAL (len == 8);
+#endif
+}
@@ -11,6 +11,7 @@
  */
 #include <assert.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/types.h"
@@ -55,8 +56,52 @@ static bool trusted_check_buffer_sizes (const size_t num, const trusted_crypto_d
 }
 #endif
 
-bool crypto_cipher_encrypt_data (const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+void crypto_cipher_ctx_init (struct crypto_cipher_ctx *ctx)
+{
+  ctx->evp = NULL;
+  ctx->key_size = 0;
+  memset (ctx->key.data, 0, sizeof (ctx->key.data));
+}
+
+void crypto_cipher_ctx_fini (struct crypto_cipher_ctx *ctx)
 {
+  if (ctx->evp)
+    EVP_CIPHER_CTX_free (ctx->evp);
+  ctx->evp = NULL;
+  ctx->key_size = 0;
+  memset (ctx->key.data, 0, sizeof (ctx->key.data));
+}
+
+static bool crypto_cipher_ctx_prepare (struct crypto_cipher_ctx *ctx, const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, DDS_Security_SecurityException *ex)
+{
+  const size_t key_bytes = key_size / 8;
+  if (ctx->evp && ctx->key_size == key_size && memcmp (ctx->key.data, session_key->data, key_bytes) == 0)
+  {
+    /* same key: the expanded key is still in the context, only the IV changes */
+    if (!EVP_EncryptInit_ex (ctx->evp, NULL, NULL, NULL, iv->u))
+      SSLERROR (fail, "EVP_EncryptInit_ex to set IV");
+    return true;
+  }
+
+  EVP_CIPHER const * const evp = (key_size != 256) ? EVP_aes_128_gcm () : EVP_aes_256_gcm ();
+  if (ctx->evp == NULL && (ctx->evp = EVP_CIPHER_CTX_new ()) == NULL)
+    SSLERROR (fail, "EVP_CIPHER_CTX_new");
+  if (!EVP_EncryptInit_ex (ctx->evp, evp, NULL, NULL, NULL))
+    SSLERROR (fail, "EVP_EncryptInit_ex to set aes_128_gcm/aes_256_gcm");
+  if (!EVP_EncryptInit_ex (ctx->evp, NULL, NULL, session_key->data, iv->u))
+    SSLERROR (fail, "EVP_EncryptInit_ex to set key and IV");
+  ctx->key_size = key_size;
+  memcpy (ctx->key.data, session_key->data, key_bytes);
+  return true;
+
+fail:
+  crypto_cipher_ctx_fini (ctx);
+  return false;
+}
+
+bool crypto_cipher_encrypt_data_ctx (struct crypto_cipher_ctx *cctx, const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+{
+  assert (cctx);
   assert (session_key);
   assert (iv);
   assert (num_inp > 0);
@@ -64,16 +109,12 @@ bool crypto_cipher_encrypt_data (const crypto_session_key_t *session_key, uint32
   assert (key_size == 128 || key_size == 256);
   assert (trusted_check_buffer_sizes (num_inp, inpdata, outpdata));
 
-  EVP_CIPHER const * const evp = (key_size != 256) ? EVP_aes_128_gcm () : EVP_aes_256_gcm ();
-  EVP_CIPHER_CTX *ctx;
   unsigned char *ptr = outpdata ? outpdata->x.base : NULL;
+  EVP_CIPHER_CTX *ctx;
 
-  if ((ctx = EVP_CIPHER_CTX_new ()) == NULL)
-    SSLERROR (fail_context_new, "EVP_CIPHER_CTX_new");
-  if (!EVP_EncryptInit_ex (ctx, evp, NULL, NULL, NULL))
-    SSLERROR (fail_encrypt, "EVP_EncryptInit_ex to set aes_128_gcm/aes_256_gcm");
-  if (!EVP_EncryptInit_ex (ctx, NULL, NULL, session_key->data, iv->u))
-    SSLERROR (fail_encrypt, "EVP_EncryptInit_ex to set key and IV");
+  if (!crypto_cipher_ctx_prepare (cctx, session_key, key_size, iv, ex))
+    return false;
+  ctx = cctx->evp;
 
   for (size_t i = 0; i < num_inp; i++)
   {
@@ -105,16 +146,23 @@ bool crypto_cipher_encrypt_data (const crypto_session_key_t *session_key, uint32
   /* get the tag */
   if (!EVP_CIPHER_CTX_ctrl (ctx, EVP_CTRL_GCM_GET_TAG, CRYPTO_HMAC_SIZE, tag->data))
     SSLERROR (fail_encrypt, "EVP_CIPHER_CTX_ctrl to get the tag");
-
-  EVP_CIPHER_CTX_free (ctx);
   return true;
 
 fail_encrypt:
-  EVP_CIPHER_CTX_free (ctx);
-fail_context_new:
+  /* state of the context is unknown, start afresh next time */
+  crypto_cipher_ctx_fini (cctx);
   return false;
 }
 
+bool crypto_cipher_encrypt_data (const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+{
+  struct crypto_cipher_ctx ctx;
+  crypto_cipher_ctx_init (&ctx);
+  const bool ok = crypto_cipher_encrypt_data_ctx (&ctx, session_key, key_size, iv, num_inp, inpdata, outpdata, tag, ex);
+  crypto_cipher_ctx_fini (&ctx);
+  return ok;
+}
+
 bool crypto_cipher_calc_hmac (const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const tainted_crypto_data_t *inpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
 {
   const trusted_crypto_data_t inpdata_wrapper = { *inpdata };
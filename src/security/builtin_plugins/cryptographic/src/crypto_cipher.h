@@ -45,6 +45,43 @@
 bool crypto_cipher_encrypt_data(const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
   ddsrt_nonnull((1, 3, 5, 7, 8)) ddsrt_attribute_warn_unused_result;
 
+/**
+ * @brief Initializes a cipher context for use with crypto_cipher_encrypt_data_ctx
+ *
+ * @param[out]    ctx           The cipher context
+ */
+void crypto_cipher_ctx_init (struct crypto_cipher_ctx *ctx)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Releases the OpenSSL resources held by the cipher context
+ *
+ * @param[in,out] ctx           The cipher context
+ */
+void crypto_cipher_ctx_fini (struct crypto_cipher_ctx *ctx)
+  ddsrt_nonnull_all;
+
+/**
+ * @brief Variant of crypto_cipher_encrypt_data that retains the OpenSSL context
+ *
+ * Equivalent to crypto_cipher_encrypt_data, but reuses the context in ctx when
+ * it was last used with the same session key, avoiding the allocation of an
+ * OpenSSL context and the key expansion. The caller must ensure ctx is not
+ * used concurrently.
+ *
+ * @param[in,out] ctx           The cipher context
+ * @param[in]     session_key   The session key used to encode the provided data
+ * @param[in]     key_size      The size of the session key (128 or 256 bit)
+ * @param[in]     iv            The init vector used by the encoding
+ * @param[in]     num_inp       The number of input data segments
+ * @param[in]     inpdata       The input data segments
+ * @param[in,out] outpdata      The output data segment (optional)
+ * @param[in,out] tag           Contains on return the mac value calculated over the provided data
+ * @param[in,out] ex            Security exception
+ */
+bool crypto_cipher_encrypt_data_ctx(struct crypto_cipher_ctx *ctx, const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+  ddsrt_nonnull((1, 2, 4, 6, 8, 9)) ddsrt_attribute_warn_unused_result;
+
 bool crypto_cipher_calc_hmac (const crypto_session_key_t *session_key, uint32_t key_size, const struct init_vector *iv, const tainted_crypto_data_t *inpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
   ddsrt_nonnull((1, 3, 4, 5, 6)) ddsrt_attribute_warn_unused_result;
 
@@ -74,6 +74,9 @@ crypto_token_copy(
       memcpy(dst->master_receiver_specific_key, src->master_receiver_specific_key._buffer, key_bytes);
   }
   dst->transformation_kind = src_transform_kind;
+  ddsrt_mutex_lock (&dst->receiver_specific_lock);
+  dst->receiver_specific_key_valid = false;
+  ddsrt_mutex_unlock (&dst->receiver_specific_lock);
 };
 
 /* Compute KeyMaterial_AES_GCM_GMAC as described in DDS Security spec v1.1 section 9.5.2.1.2 (table 67 and table 68) */
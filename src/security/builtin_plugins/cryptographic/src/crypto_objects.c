@@ -17,6 +17,7 @@
 #include "dds/ddsrt/types.h"
 #include "crypto_objects.h"
 #include "crypto_utils.h"
+#include "crypto_cipher.h"
 
 static int compare_participant_handle(const void *va, const void *vb);
 static int compare_endpoint_relation (const void *va, const void *vb);
@@ -255,6 +256,8 @@ static void master_key_material__free(CryptoObject *obj)
       ddsrt_free (keymat->master_sender_key);
       ddsrt_free (keymat->master_receiver_specific_key);
     }
+    crypto_cipher_ctx_fini (&keymat->receiver_specific_cipher);
+    ddsrt_mutex_destroy (&keymat->receiver_specific_lock);
     crypto_object_deinit ((CryptoObject *)keymat);
     memset (keymat, 0, sizeof (*keymat));
     ddsrt_free (keymat);
@@ -265,6 +268,9 @@ master_key_material * crypto_master_key_material_new(DDS_Security_CryptoTransfor
 {
   master_key_material *keymat = ddsrt_calloc (1, sizeof(*keymat));
   crypto_object_init((CryptoObject *)keymat, CRYPTO_OBJECT_KIND_KEY_MATERIAL, master_key_material__free);
+  ddsrt_mutex_init (&keymat->receiver_specific_lock);
+  keymat->receiver_specific_key_valid = false;
+  crypto_cipher_ctx_init (&keymat->receiver_specific_cipher);
   keymat->transformation_kind = transform_kind;
   if (CRYPTO_TRANSFORM_HAS_KEYS(transform_kind))
   {
@@ -300,6 +306,9 @@ void crypto_master_key_material_set(master_key_material *dst, const master_key_m
     dst->receiver_specific_key_id = 0;
   }
   dst->transformation_kind = src->transformation_kind;
+  ddsrt_mutex_lock (&dst->receiver_specific_lock);
+  dst->receiver_specific_key_valid = false;
+  ddsrt_mutex_unlock (&dst->receiver_specific_lock);
 }
 
 static bool generate_session_key(session_key_material *session, DDS_Security_SecurityException *ex)
@@ -316,6 +325,8 @@ static void session_key_material__free(CryptoObject *obj)
   {
     CHECK_CRYPTO_OBJECT_KIND(obj, CRYPTO_OBJECT_KIND_SESSION_KEY_MATERIAL);
     CRYPTO_OBJECT_RELEASE(session->master_key_material);
+    crypto_cipher_ctx_fini (&session->cipher);
+    ddsrt_mutex_destroy (&session->cipher_lock);
     crypto_object_deinit((CryptoObject *)session);
     memset (session, 0, sizeof (*session));
     ddsrt_free(session);
@@ -334,6 +345,8 @@ session_key_material * crypto_session_key_material_new(master_key_material *mast
   session->max_blocks_per_session = INT64_MAX; /* FIXME: should be a config parameter */
   session->block_counter = session->max_blocks_per_session;
   session->master_key_material = CRYPTO_OBJECT_KEEP(master_key);
+  ddsrt_mutex_init (&session->cipher_lock);
+  crypto_cipher_ctx_init (&session->cipher);
 
   return session;
 }
@@ -13,6 +13,7 @@
 #define CRYPTO_OBJECTS_H
 
 #include <openssl/rand.h>
+#include <openssl/evp.h>
 #include "dds/ddsrt/atomics.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/types.h"
@@ -70,6 +71,16 @@ struct CryptoObject
   CryptoObjectDestructor destructor;
 };
 
+/* AES-GCM context retained across calls so that encrypting another message
+   with the same key only costs setting the IV, rather than allocating a new
+   context and expanding the key each time */
+struct crypto_cipher_ctx
+{
+  EVP_CIPHER_CTX *evp; /* NULL until first use */
+  uint32_t key_size;
+  crypto_session_key_t key;
+};
+
 struct local_datawriter_crypto;
 struct local_datareader_crypto;
 struct remote_datawriter_crypto;
@@ -84,6 +95,14 @@ typedef struct master_key_material
   unsigned char *master_sender_key;
   uint32_t receiver_specific_key_id;
   unsigned char *master_receiver_specific_key;
+  /* receiver-specific key derived for the last session seen and cipher
+     context for it, so that adding receiver-specific MACs doesn't require
+     deriving the key for every message */
+  ddsrt_mutex_t receiver_specific_lock;
+  bool receiver_specific_key_valid;
+  uint32_t receiver_specific_session_id;
+  crypto_session_key_t receiver_specific_session_key;
+  struct crypto_cipher_ctx receiver_specific_cipher;
 } master_key_material;
 
 typedef struct session_key_material
@@ -97,6 +116,8 @@ typedef struct session_key_material
   uint64_t max_blocks_per_session;
   uint64_t init_vector_suffix;
   master_key_material *master_key_material;
+  ddsrt_mutex_t cipher_lock; /* protects cipher */
+  struct crypto_cipher_ctx cipher;
 } session_key_material;
 
 typedef struct remote_session_info
@@ -584,6 +584,14 @@ static bool split_encoded_rtps_message(const tainted_crypto_data_t *data, struct
  * Function implementations
  */
 
+static bool session_encrypt_data (session_key_material *session, const struct init_vector *iv, const size_t num_inp, const trusted_crypto_data_t *inpdata, trusted_crypto_data_t *outpdata, crypto_hmac_t *tag, DDS_Security_SecurityException *ex)
+{
+  ddsrt_mutex_lock (&session->cipher_lock);
+  const bool result = crypto_cipher_encrypt_data_ctx (&session->cipher, &session->key, session->key_size, iv, num_inp, inpdata, outpdata, tag, ex);
+  ddsrt_mutex_unlock (&session->cipher_lock);
+  return result;
+}
+
 static DDS_Security_boolean
 encode_serialized_payload(
     dds_security_crypto_transform *instance,
@@ -677,14 +685,14 @@ encode_serialized_payload(
     encrypted_data.x.base = content->data;
     encrypted_data.x.length = plain_buffer->_length;
 
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &prefix->iv, 1, &plain_data, &encrypted_data, &hmac, ex))
+    if (!session_encrypt_data(session, &prefix->iv, 1, &plain_data, &encrypted_data, &hmac, ex))
       goto fail_encrypt;
     content->length = ddsrt_toBE4u((uint32_t)encrypted_data.x.length);
   }
   else if (is_authentication_required(transform_kind))
   {
     /* the transformation_kind indicates only indicates authentication the determine HMAC */
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &prefix->iv, 1, &plain_data, NULL, &hmac, ex))
+    if (!session_encrypt_data(session, &prefix->iv, 1, &plain_data, NULL, &hmac, ex))
       goto fail_encrypt;
     unsigned char *ptr = trusted_crypto_buffer_append(&buffer,  plain_buffer->_length);
     memcpy(ptr, plain_buffer->_buffer, plain_buffer->_length);
@@ -758,13 +766,22 @@ add_specific_mac(
   {
     struct trusted_crypto_header const * const h = (struct trusted_crypto_header const *) (buffer->contents + header_offset);
     struct trusted_crypto_footer const * const f = (struct trusted_crypto_footer const *) (buffer->contents + footer_offset);
-    crypto_session_key_t key;
     const trusted_crypto_data_t data = { {
       .base = (unsigned char *) f->postfix.common_mac.data,
       .length = CRYPTO_HMAC_SIZE
     } };
-    if (!crypto_calculate_receiver_specific_key (&key, session->id, keymat->master_salt, keymat->master_receiver_specific_key, keymat->transformation_kind, ex) ||
-        !crypto_cipher_encrypt_data (&key, session->key_size, &h->prefix.iv, 1, &data, NULL, &hmac, ex))
+    bool ok = true;
+    ddsrt_mutex_lock (&keymat->receiver_specific_lock);
+    if (!keymat->receiver_specific_key_valid || keymat->receiver_specific_session_id != session->id)
+    {
+      ok = crypto_calculate_receiver_specific_key (&keymat->receiver_specific_session_key, session->id, keymat->master_salt, keymat->master_receiver_specific_key, keymat->transformation_kind, ex);
+      keymat->receiver_specific_key_valid = ok;
+      keymat->receiver_specific_session_id = session->id;
+    }
+    if (ok)
+      ok = crypto_cipher_encrypt_data_ctx (&keymat->receiver_specific_cipher, &keymat->receiver_specific_session_key, session->key_size, &h->prefix.iv, 1, &data, NULL, &hmac, ex);
+    ddsrt_mutex_unlock (&keymat->receiver_specific_lock);
+    if (!ok)
       return false;
   }
 
@@ -948,7 +965,7 @@ encode_submmessage_encrypt(
     trusted_crypto_data_t encrypted_data = {{ .base = body->content.data, .length = plain_submsg->_length }};
 
     /* encrypt submessage */
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &header->prefix.iv, 1, &plain_data, &encrypted_data, &hmac, ex))
+    if (!session_encrypt_data(session, &header->prefix.iv, 1, &plain_data, &encrypted_data, &hmac, ex))
       goto enc_submsg_fail;
 
     /* adjust the length of the body submessage when needed */
@@ -964,7 +981,7 @@ encode_submmessage_encrypt(
   {
     unsigned char *ptr = trusted_crypto_buffer_append(&buffer, plain_submsg->_length);
     /* the transformation_kind indicates only indicates authentication the determine HMAC */
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &header->prefix.iv, 1, &plain_data, NULL, &hmac, ex))
+    if (!session_encrypt_data(session, &header->prefix.iv, 1, &plain_data, NULL, &hmac, ex))
       goto enc_submsg_fail;
 
     /* copy submessage */
@@ -1292,7 +1309,7 @@ static DDS_Security_boolean encode_rtps_message_encrypt (
     encrypted_data.x.length = secure_body_plain_size;
 
     /* encrypt message */
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &header->prefix.iv, num_segs, plain_data, &encrypted_data, &hmac, ex))
+    if (!session_encrypt_data(session, &header->prefix.iv, num_segs, plain_data, &encrypted_data, &hmac, ex))
       goto enc_rtps_fail_data;
 
     body->content.length = ddsrt_toBE4u((uint32_t)encrypted_data.x.length);
@@ -1307,7 +1324,7 @@ static DDS_Security_boolean encode_rtps_message_encrypt (
   {
     unsigned char *ptr = trusted_crypto_buffer_append(&buffer, secure_body_plain_size);
     /* the transformation_kind indicates only indicates authentication the determine HMAC */
-    if (!crypto_cipher_encrypt_data(&session->key, session->key_size, &header->prefix.iv, num_segs, plain_data, NULL, &hmac, ex))
+    if (!session_encrypt_data(session, &header->prefix.iv, num_segs, plain_data, NULL, &hmac, ex))
       goto enc_rtps_fail_data;
 
     /* copy submessage */
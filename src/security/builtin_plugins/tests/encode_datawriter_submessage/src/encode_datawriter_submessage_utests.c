@@ -17,6 +17,7 @@
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/types.h"
 #include "dds/ddsrt/environ.h"
+#include "dds/ddsrt/time.h"
 #include "dds/security/dds_security_api.h"
 #include "dds/security/core/dds_security_serialize.h"
 #include "dds/security/core/dds_security_utils.h"
@@ -1085,6 +1086,103 @@ CU_Test(ddssec_builtin_encode_datawriter_submessage, no_encode_sign_128, .init =
   encode_datawriter_submessage_sign(CRYPTO_TRANSFORMATION_KIND_AES128_GMAC);
 }
 
+/* Encodes a submessage for a number of readers with origin authentication
+   repeatedly, reporting the time it takes per submessage, and verifies the
+   receiver-specific MACs of the last one. */
+static void encode_datawriter_submessage_throughput(DDS_Security_CryptoTransformKind_Enum transformation_kind)
+{
+  const uint32_t READERS_CNT = 4u;
+  const uint32_t ROUNDS = 10000u;
+  DDS_Security_boolean result = true;
+  DDS_Security_DatawriterCryptoHandle writer_crypto;
+  DDS_Security_DatareaderCryptoHandleSeq reader_list;
+  int32_t index;
+  DDS_Security_SecurityException exception = {NULL, 0, 0};
+  DDS_Security_OctetSeq plain_buffer;
+  DDS_Security_OctetSeq encoded_buffer;
+  DDS_Security_OctetSeq data;
+  session_key_material *session_keys;
+  struct crypto_header *header = NULL;
+  struct crypto_footer *footer = NULL;
+  DDS_Security_PropertySeq datawriter_properties;
+  DDS_Security_EndpointSecurityAttributes datawriter_security_attributes;
+  const bool is_encrypted = (transformation_kind == CRYPTO_TRANSFORMATION_KIND_AES128_GCM || transformation_kind == CRYPTO_TRANSFORMATION_KIND_AES256_GCM);
+
+  CU_ASSERT_FATAL(crypto != NULL);
+  assert(crypto != NULL);
+  CU_ASSERT_FATAL(crypto->crypto_transform != NULL);
+  assert(crypto->crypto_transform != NULL);
+
+  prepare_endpoint_security_attributes_and_properties(&datawriter_security_attributes, &datawriter_properties, transformation_kind, true);
+  initialize_data_submessage(&plain_buffer, DDSRT_BOSEL_NATIVE);
+
+  writer_crypto = register_local_datawriter(&datawriter_security_attributes, &datawriter_properties);
+  CU_ASSERT_FATAL(writer_crypto != 0);
+  assert(writer_crypto != 0); // for Clang's static analyzer
+  session_keys = get_datawriter_session(writer_crypto);
+
+  reader_list._length = reader_list._maximum = READERS_CNT;
+  reader_list._buffer = DDS_Security_DatareaderCryptoHandleSeq_allocbuf(READERS_CNT);
+  for (uint32_t i = 0; i < READERS_CNT; i++)
+  {
+    reader_list._buffer[i] = register_remote_datareader(writer_crypto);
+    CU_ASSERT_FATAL(reader_list._buffer[i] != 0);
+  }
+
+  memset(&encoded_buffer, 0, sizeof(encoded_buffer));
+  const dds_time_t tstart = dds_time();
+  for (uint32_t r = 0; r < ROUNDS && result; r++)
+  {
+    DDS_Security_OctetSeq *buffer = &plain_buffer;
+    DDS_Security_OctetSeq_deinit(&encoded_buffer);
+    index = 0;
+    while (index != (int32_t)READERS_CNT && result)
+    {
+      result = crypto->crypto_transform->encode_datawriter_submessage(
+          crypto->crypto_transform, &encoded_buffer, buffer, writer_crypto, &reader_list, &index, &exception);
+      buffer = NULL;
+    }
+  }
+  const dds_time_t tend = dds_time();
+  if (!result)
+  {
+    printf("encode_datawriter_submessage: %s\n", exception.message ? exception.message : "Error message missing");
+  }
+  CU_ASSERT_FATAL(result);
+  reset_exception(&exception);
+
+  printf("encode_datawriter_submessage %s, %u readers: %.0f ns/submessage\n",
+         is_encrypted ? "encrypt" : "sign", READERS_CNT, (double)(tend - tstart) / ROUNDS);
+
+  result = check_encoded_data(&encoded_buffer, is_encrypted, &header, &footer, &data);
+  CU_ASSERT_FATAL(result);
+  assert(result); // for Clang's static analyzer
+  CU_ASSERT(check_reader_signing(&reader_list, footer, ddsrt_bswap4u(*(uint32_t *)header->session_id), header->session_id, session_keys->key_size));
+
+  for (uint32_t i = 0; i < READERS_CNT; i++)
+    unregister_datareader(reader_list._buffer[i]);
+  unregister_datawriter(writer_crypto);
+
+  DDS_Security_OctetSeq_deinit((&plain_buffer));
+  DDS_Security_OctetSeq_deinit((&encoded_buffer));
+  DDS_Security_DatareaderCryptoHandleSeq_deinit(&reader_list);
+  ddsrt_free(datawriter_properties._buffer[0].name);
+  ddsrt_free(datawriter_properties._buffer[0].value);
+  ddsrt_free(datawriter_properties._buffer);
+  ddsrt_free(footer);
+  ddsrt_free(header);
+}
+
+CU_Test(ddssec_builtin_encode_datawriter_submessage, throughput_encrypt_256, .init = suite_encode_datawriter_submessage_init, .fini = suite_encode_datawriter_submessage_fini)
+{
+  encode_datawriter_submessage_throughput(CRYPTO_TRANSFORMATION_KIND_AES256_GCM);
+}
+
+CU_Test(ddssec_builtin_encode_datawriter_submessage, throughput_sign_128, .init = suite_encode_datawriter_submessage_init, .fini = suite_encode_datawriter_submessage_fini)
+{
+  encode_datawriter_submessage_throughput(CRYPTO_TRANSFORMATION_KIND_AES128_GMAC);
+}
+
 CU_Test(ddssec_builtin_encode_datawriter_submessage, invalid_args, .init = suite_encode_datawriter_submessage_init, .fini = suite_encode_datawriter_submessage_fini)
 {
   DDS_Security_boolean result;
@@ -17,6 +17,7 @@
 #include "dds/ddsrt/heap.h"
 #include "dds/ddsrt/sync.h"
 #include "dds/ddsrt/string.h"
+#include "dds/ddsrt/threads.h"
 #include "dds/ddsi/ddsi_domaingv.h"
 #include "dds/security/dds_security_api.h"
 #include "dds/security/dds_security_api_defs.h"
@@ -27,6 +28,8 @@
 int32_t init_crypto(const char *argument, void **context, struct ddsi_domaingv *gv);
 int32_t finalize_crypto(void *context);
 
+#define RTPS_DECODE_MAX_FAILED 8
+
 enum crypto_plugin_mode {
   PLUGIN_MODE_ALL_OK,
   PLUGIN_MODE_MISSING_FUNC,
@@ -75,6 +78,13 @@ struct dds_security_cryptography_impl {
   struct ddsrt_circlist token_data_list;
   ddsrt_mutex_t encode_decode_log_lock;
   struct ddsrt_circlist encode_decode_log;
+  ddsrt_mutex_t rtps_decode_lock;
+  uint32_t rtps_decode_fail_every;
+  uint32_t rtps_decode_count;
+  uint32_t rtps_decode_by_pool;
+  uint32_t rtps_decode_retried;
+  uint32_t n_rtps_decode_failed;
+  DDS_Security_OctetSeq rtps_decode_failed[RTPS_DECODE_MAX_FAILED];
   bool force_plain_rtps;
   bool force_plain_submsg;
   bool force_plain_payload;
@@ -305,6 +315,57 @@ static void log_encode_decode (struct dds_security_cryptography_impl * impl, enu
   ddsrt_mutex_unlock (&impl->encode_decode_log_lock);
 }
 
+void set_rtps_decode_fail_every (struct dds_security_cryptography_impl * impl, uint32_t every_nth)
+{
+  assert(impl);
+  ddsrt_mutex_lock (&impl->rtps_decode_lock);
+  impl->rtps_decode_fail_every = every_nth;
+  ddsrt_mutex_unlock (&impl->rtps_decode_lock);
+}
+
+void get_rtps_decode_stats (struct dds_security_cryptography_impl * impl, uint32_t *n_decoded_by_pool, uint32_t *n_retried)
+{
+  assert(impl);
+  ddsrt_mutex_lock (&impl->rtps_decode_lock);
+  *n_decoded_by_pool = impl->rtps_decode_by_pool;
+  *n_retried = impl->rtps_decode_retried;
+  ddsrt_mutex_unlock (&impl->rtps_decode_lock);
+}
+
+static bool rtps_decode_inject_failure (struct dds_security_cryptography_impl * impl, const DDS_Security_OctetSeq *encoded_buffer, DDS_Security_SecurityException *ex)
+{
+  char name[32];
+  bool fail = false;
+  ddsrt_thread_getname (name, sizeof (name));
+  ddsrt_mutex_lock (&impl->rtps_decode_lock);
+  if (strncmp (name, "rtpsdec", 7) == 0)
+    impl->rtps_decode_by_pool++;
+  /* a message for which decoding failed before is a retry, and that one is let through */
+  for (uint32_t i = 0; i < impl->n_rtps_decode_failed; i++)
+  {
+    DDS_Security_OctetSeq *failed = &impl->rtps_decode_failed[i];
+    if (failed->_length == encoded_buffer->_length && memcmp (failed->_buffer, encoded_buffer->_buffer, failed->_length) == 0)
+    {
+      ddsrt_free (failed->_buffer);
+      *failed = impl->rtps_decode_failed[--impl->n_rtps_decode_failed];
+      impl->rtps_decode_retried++;
+      ddsrt_mutex_unlock (&impl->rtps_decode_lock);
+      return false;
+    }
+  }
+  if (impl->rtps_decode_fail_every > 0 && ++impl->rtps_decode_count % impl->rtps_decode_fail_every == 0 && impl->n_rtps_decode_failed < RTPS_DECODE_MAX_FAILED)
+  {
+    DDS_Security_OctetSeq *failed = &impl->rtps_decode_failed[impl->n_rtps_decode_failed++];
+    failed->_length = failed->_maximum = encoded_buffer->_length;
+    failed->_buffer = ddsrt_memdup (encoded_buffer->_buffer, encoded_buffer->_length);
+    ex->code = 1;
+    ex->message = ddsrt_strdup ("Injected RTPS message decoding failure");
+    fail = true;
+  }
+  ddsrt_mutex_unlock (&impl->rtps_decode_lock);
+  return fail;
+}
+
 struct crypto_encode_decode_data * get_encode_decode_log (struct dds_security_cryptography_impl * impl, enum crypto_encode_decode_fn function, DDS_Security_long_long handle)
 {
   ddsrt_mutex_lock (&impl->encode_decode_log_lock);
@@ -946,6 +1007,9 @@ static DDS_Security_boolean decode_rtps_message(
   switch (impl->parent->mode)
   {
     case PLUGIN_MODE_WRAPPED:
+      if (rtps_decode_inject_failure (impl->parent, encoded_buffer, ex))
+        return false;
+      /* fall through */
     case PLUGIN_MODE_TOKEN_LOG:
     case PLUGIN_MODE_PLAIN_DATA:
       return impl->instance->decode_rtps_message (impl->instance, plain_buffer, encoded_buffer,
@@ -1151,6 +1215,7 @@ static void init_encode_decode_log(struct dds_security_cryptography_impl *impl)
 {
   ddsrt_mutex_init (&impl->encode_decode_log_lock);
   ddsrt_circlist_init (&impl->encode_decode_log);
+  ddsrt_mutex_init (&impl->rtps_decode_lock);
 }
 
 static void fini_encode_decode_log(struct dds_security_cryptography_impl *impl)
@@ -1164,6 +1229,9 @@ static void fini_encode_decode_log(struct dds_security_cryptography_impl *impl)
   }
   ddsrt_mutex_unlock (&impl->encode_decode_log_lock);
   ddsrt_mutex_destroy (&impl->encode_decode_log_lock);
+  for (uint32_t i = 0; i < impl->n_rtps_decode_failed; i++)
+    ddsrt_free (impl->rtps_decode_failed[i]._buffer);
+  ddsrt_mutex_destroy (&impl->rtps_decode_lock);
 }
 
 int init_test_cryptography_wrapped(const char *argument, void **context, struct ddsi_domaingv *gv)
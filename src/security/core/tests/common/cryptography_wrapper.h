@@ -69,6 +69,10 @@ SECURITY_EXPORT void set_disc_protection_kinds(
   DDS_Security_ProtectionKind liveliness_protection_kind);
 SECURITY_EXPORT void set_entity_data_secret(struct dds_security_cryptography_impl * impl, const char * pp_secret, const char * groupdata_secret, const char * ep_secret);
 SECURITY_EXPORT void set_force_plain_data(struct dds_security_cryptography_impl * impl, DDS_Security_DatawriterCryptoHandle wr_handle, bool plain_rtps, bool plain_submsg, bool plain_payload);
+/* Make the first attempt at decoding every n-th RTPS message fail (0 disables), decoding
+   the same message again succeeds; only in wrapped mode */
+SECURITY_EXPORT void set_rtps_decode_fail_every(struct dds_security_cryptography_impl * impl, uint32_t every_nth);
+SECURITY_EXPORT void get_rtps_decode_stats(struct dds_security_cryptography_impl * impl, uint32_t *n_decoded_by_pool, uint32_t *n_retried);
 
 SECURITY_EXPORT const char *get_crypto_token_type_str (enum crypto_tokens_type type);
 SECURITY_EXPORT struct ddsrt_circlist * get_crypto_tokens (struct dds_security_cryptography_impl * impl);
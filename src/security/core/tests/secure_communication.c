@@ -20,6 +20,7 @@
 #include "dds/ddsrt/cdtors.h"
 #include "dds/ddsrt/environ.h"
 #include "dds/ddsrt/heap.h"
+#include "dds/ddsrt/io.h"
 #include "dds/ddsrt/string.h"
 #include "dds/ddsrt/threads.h"
 #include "dds/ddsrt/process.h"
@@ -152,7 +153,7 @@ static void create_dom_pp_pubsub(dds_domainid_t domain_id_base, const char * dom
   }
 }
 
-static void test_init(const struct domain_sec_config * domain_config, size_t n_sub_domains, size_t n_sub_participants, size_t n_pub_domains, size_t n_pub_participants, set_crypto_params_fn set_crypto_params)
+static void test_init(const struct domain_sec_config * domain_config, const char * extra_config, size_t n_sub_domains, size_t n_sub_participants, size_t n_pub_domains, size_t n_pub_participants, set_crypto_params_fn set_crypto_params)
 {
   assert (n_sub_domains < MAX_DOMAINS);
   assert (n_sub_participants < MAX_PARTICIPANTS);
@@ -167,16 +168,23 @@ static void test_init(const struct domain_sec_config * domain_config, size_t n_s
     { NULL, NULL, 0 }
   };
 
-  char *conf_pub = ddsrt_expand_vars_sh (config, &expand_lookup_vars_env, config_vars);
+  char *domain_conf;
+  if (extra_config == NULL)
+    domain_conf = ddsrt_strdup (config);
+  else
+    (void) ddsrt_asprintf (&domain_conf, "%s,%s", config, extra_config);
+
+  char *conf_pub = ddsrt_expand_vars_sh (domain_conf, &expand_lookup_vars_env, config_vars);
   create_dom_pp_pubsub (DDS_DOMAINID_PUB, conf_pub, domain_config, n_pub_domains, n_pub_participants,
       g_pub_domains, g_pub_participants, g_pub_publishers, &dds_create_publisher, set_crypto_params);
   dds_free (conf_pub);
 
-  char *conf_sub = ddsrt_expand_vars_sh (config, &expand_lookup_vars_env, config_vars);
+  char *conf_sub = ddsrt_expand_vars_sh (domain_conf, &expand_lookup_vars_env, config_vars);
   create_dom_pp_pubsub (DDS_DOMAINID_SUB, conf_sub, domain_config, n_sub_domains, n_sub_participants,
       g_sub_domains, g_sub_participants, g_sub_subscribers, &dds_create_subscriber, set_crypto_params);
   dds_free (conf_sub);
 
+  ddsrt_free (domain_conf);
   dds_free (gov_config_signed);
   dds_free (gov_topic_rule);
 }
@@ -243,7 +251,7 @@ static void test_write_read(struct domain_sec_config *domain_config,
 
   printf("Testing: %"PRIuSIZE" subscriber domains, %"PRIuSIZE" pp per domain, %"PRIuSIZE" rd per pp; %"PRIuSIZE" publishing domains, %"PRIuSIZE" pp per domain, %"PRIuSIZE" wr per pp\n",
       n_sub_domains, n_sub_participants, n_readers, n_pub_domains, n_pub_participants, n_writers);
-  test_init(domain_config, n_sub_domains, n_sub_participants, n_pub_domains, n_pub_participants, set_crypto_params);
+  test_init(domain_config, NULL, n_sub_domains, n_sub_participants, n_pub_domains, n_pub_participants, set_crypto_params);
 
   create_topic_name("ddssec_secure_communication_", g_topic_nr++, name, sizeof name);
 
@@ -365,7 +373,7 @@ static void test_payload_secret(DDS_Security_ProtectionKind rtps_pk, DDS_Securit
     memcpy (sample.text + n * strlen (secret), secret, strlen (secret));
   sample.text[payload_sz - 1] = '\0';
 
-  test_init (&domain_config, 1, 1, 1, 1, set_encryption_parameters_secret);
+  test_init (&domain_config, NULL, 1, 1, 1, 1, set_encryption_parameters_secret);
   create_topic_name ("ddssec_secure_communication_", g_topic_nr++, name, sizeof name);
   qos = get_qos ();
   create_eps (&writers, &writer_topics, 1, 1, 1, name, &SecurityCoreTests_Type2_desc, g_pub_participants, qos, &dds_create_writer, DDS_PUBLICATION_MATCHED_STATUS);
@@ -393,6 +401,76 @@ static void test_payload_secret(DDS_Security_ProtectionKind rtps_pk, DDS_Securit
   ddsrt_free (sample.text);
 }
 
+static void test_batched_decode(uint32_t n_samples)
+{
+  /* receiving in batches with decoding threads makes the RTPS message decoding happen in
+     parallel, and then one in every few messages fails to decode on the first attempt so
+     that the retry after the batch has been decoded gets exercised as well */
+  static const char *batch_config =
+    "<Domain id=\"any\">"
+    "  <Internal>"
+    "    <ReceiveBatchSize>16</ReceiveBatchSize>"
+    "    <SecureDecodeThreads>2</SecureDecodeThreads>"
+    "  </Internal>"
+    "</Domain>";
+  dds_entity_t *writers, *readers, *writer_topics, *reader_topics;
+  dds_qos_t *qos;
+  SecurityCoreTests_Type1 sample = { 0, 0 };
+  SecurityCoreTests_Type1 rd_sample;
+  void * samples[] = { &rd_sample };
+  dds_sample_info_t info[1];
+  dds_return_t ret;
+  char name[100];
+  struct domain_sec_config domain_config = { PK_N, PK_N, PK_E, PK_N, BPK_N, NULL };
+
+  test_init (&domain_config, batch_config, 1, 1, 1, 1, set_encryption_parameters_basic);
+  create_topic_name ("ddssec_secure_communication_", g_topic_nr++, name, sizeof name);
+  qos = get_qos ();
+  create_eps (&writers, &writer_topics, 1, 1, 1, name, &SecurityCoreTests_Type1_desc, g_pub_participants, qos, &dds_create_writer, DDS_PUBLICATION_MATCHED_STATUS);
+  create_eps (&readers, &reader_topics, 1, 1, 1, name, &SecurityCoreTests_Type1_desc, g_sub_participants, qos, &dds_create_reader, DDS_DATA_AVAILABLE_STATUS);
+  dds_delete_qos (qos);
+  sync_writer_to_readers (g_pub_participants[0], writers[0], 1, dds_time() + DDS_SECS(5));
+
+  struct dds_security_cryptography_impl * crypto_context = get_cryptography_context (g_sub_participants[0]);
+  CU_ASSERT_FATAL (crypto_context != NULL);
+  set_rtps_decode_fail_every (crypto_context, 7);
+
+  /* a single instance, so that the samples must arrive in the order they were written */
+  for (uint32_t n = 0; n < n_samples; n++)
+  {
+    sample.value = (int32_t) n;
+    ret = dds_write (writers[0], &sample);
+    CU_ASSERT_EQUAL_FATAL (ret, DDS_RETCODE_OK);
+  }
+
+  uint32_t n_received = 0;
+  const dds_time_t abstimeout = dds_time () + DDS_SECS(30);
+  while (n_received < n_samples && dds_time () < abstimeout)
+  {
+    if ((ret = dds_take (readers[0], samples, info, 1, 1)) == 0)
+    {
+      reader_wait_for_data (g_sub_participants[0], readers[0], DDS_SECS(5));
+      continue;
+    }
+    CU_ASSERT_EQUAL_FATAL (ret, 1);
+    CU_ASSERT_FATAL (info[0].valid_data);
+    CU_ASSERT_EQUAL_FATAL (rd_sample.id, 0);
+    CU_ASSERT_EQUAL_FATAL (rd_sample.value, (int32_t) n_received);
+    n_received++;
+  }
+  CU_ASSERT_EQUAL_FATAL (n_received, n_samples);
+
+  uint32_t n_decoded_by_pool, n_retried;
+  get_rtps_decode_stats (crypto_context, &n_decoded_by_pool, &n_retried);
+  printf ("decoded by pool: %"PRIu32", retried: %"PRIu32"\n", n_decoded_by_pool, n_retried);
+  CU_ASSERT_FATAL (n_decoded_by_pool > 0);
+  CU_ASSERT_FATAL (n_retried > 0);
+
+  test_fini (1, 1);
+  free_eps (readers, reader_topics);
+  free_eps (writers, writer_topics);
+}
+
 /* Test communication between 2 nodes for all combinations of RTPS, metadata (submsg)
    and payload protection kinds using a single reader and writer */
 CU_Test(ddssec_secure_communication, protection_kinds, .timeout = 120)
@@ -483,3 +561,11 @@ CU_Theory((size_t n_rd_dom, size_t n_rd, size_t n_wr_dom, size_t n_wr), ddssec_s
     test_multiple_writers (n_rd_dom, n_rd, n_wr_dom, n_wr, metadata_pk[metadata]);
   }
 }
+
+/* Test that RTPS-protected messages received in batches and decoded by the decoding
+   threads are delivered in order and unchanged, including those that failed to decode
+   in the parallel step */
+CU_Test(ddssec_secure_communication, batched_decode, .timeout = 60)
+{
+  test_batched_decode (2000);
+}
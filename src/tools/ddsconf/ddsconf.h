@@ -51,6 +51,9 @@ void gendef_pf_retransmit_merging (FILE *fp, void *parent, struct cfgelem const
 void gendef_pf_sched_class (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_transport_selector (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_many_sockets_mode (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
+void gendef_pf_trace_output_format (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
+void gendef_pf_timed_event_queue (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
+void gendef_pf_whc_seq_index (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_standards_conformance (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 void gendef_pf_shm_loglevel (FILE *fp, void *parent, struct cfgelem const * const cfgelem);
 
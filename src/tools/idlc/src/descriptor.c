@@ -619,7 +619,7 @@ static uint32_t typecode(const idl_type_spec_t *type_spec, uint32_t shift, bool
   return 0u;
 }
 
-static struct constructed_type *
+struct constructed_type *
 find_ctype(const struct descriptor *descriptor, const void *node)
 {
   struct constructed_type *ctype = descriptor->constructed_types;
@@ -2132,6 +2132,8 @@ static int print_flags(FILE *fp, struct descriptor *descriptor)
     vec[len++] = "DDS_TOPIC_FIXED_KEY";
   if (descriptor->flags & DDS_TOPIC_FIXED_KEY_XCDR2)
     vec[len++] = "DDS_TOPIC_FIXED_KEY_XCDR2";
+  if (descriptor->flags & DDS_TOPIC_MARSHAL)
+    vec[len++] = "DDS_TOPIC_MARSHAL";
 
   bool fixed_size = true;
   for (struct constructed_type *ctype = descriptor->constructed_types; ctype && fixed_size; ctype = ctype->next) {
@@ -2200,6 +2202,10 @@ static int print_descriptor(
   if (idl_fprintf(fp, fmt, descriptor->n_opcodes, type) < 0)
     return -1;
 
+  /* generated marshalling functions */
+  if ((descriptor->flags & DDS_TOPIC_MARSHAL) && idl_fprintf(fp, ",\n  .m_marshal = &%1$s_marshal", type) < 0)
+    return -1;
+
   if (idl_fprintf(fp, "\n};\n\n") < 0)
     return -1;
 
@@ -2374,6 +2380,8 @@ generate_descriptor(
     { ret = IDL_RETCODE_NO_MEMORY; goto err_print; }
   if (print_keys(generator->source.handle, &descriptor, inst_count) < 0)
     { ret = IDL_RETCODE_NO_MEMORY; goto err_print; }
+  if (generator->marshal && (ret = generate_marshal(pstate, generator, &descriptor)) < 0)
+    goto err_print;
   if (print_descriptor(generator->source.handle, &descriptor) < 0)
     { ret = IDL_RETCODE_NO_MEMORY; goto err_print; }
 
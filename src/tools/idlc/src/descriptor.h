@@ -157,6 +157,11 @@ key_print_meta_free(
   struct key_print_meta *keys,
   uint32_t n_keys);
 
+struct constructed_type *
+find_ctype(
+  const struct descriptor *descriptor,
+  const void *node);
+
 idl_retcode_t
 descriptor_fini(
   struct descriptor *descriptor);
@@ -167,6 +172,14 @@ generate_descriptor_impl(
   const idl_node_t *topic_node,
   struct descriptor *descriptor);
 
+struct generator;
+
+idl_retcode_t
+generate_marshal(
+  const idl_pstate_t *pstate,
+  struct generator *generator,
+  struct descriptor *descriptor);
+
 idl_retcode_t
 emit_topic_descriptor(
   const idl_pstate_t *pstate,
@@ -28,6 +28,7 @@
 #include "idlc/generator.h"
 
 const char *export_macro = NULL;
+static int generate_marshal_functions = 0;
 
 static int print_base_type(
   char *str, size_t size, const void *node, void *user_data)
@@ -330,6 +331,8 @@ generate_nosetup(const idl_pstate_t *pstate, struct generator *generator)
       sep = ptr+1;
   if (idl_fprintf(generator->source.handle, "#include \"%s\"\n\n", sep) < 0)
     return IDL_RETCODE_NO_MEMORY;
+  if (generator->marshal && fputs("#include <string.h>\n\n", generator->source.handle) < 0)
+    return IDL_RETCODE_NO_MEMORY;
   if ((ret = generate_types(pstate, generator)))
     return ret;
   if (fputs("#ifdef __cplusplus\n}\n#endif\n\n", generator->header.handle) < 0)
@@ -344,6 +347,11 @@ static const idlc_option_t *opts[] = {
   &(idlc_option_t){
     IDLC_STRING, { .string = &export_macro }, 'e', "", "<export macro>",
     "Add export macro before topic descriptors." },
+  &(idlc_option_t){
+    IDLC_FLAG, { .flag = &generate_marshal_functions }, 'f', "marshal", "",
+    "Generate straight-line serialization, deserialization and key extraction "
+    "functions for types with a fixed layout, used instead of interpreting the "
+    "type's op-codes." },
   NULL
 };
 
@@ -406,6 +414,7 @@ idlc_generate(const idl_pstate_t *pstate)
   } else {
     generator.export_macro = NULL;
   }
+  generator.marshal = (generate_marshal_functions != 0);
   ret = generate_nosetup(pstate, &generator);
 
 err_options:
@@ -31,6 +31,7 @@ struct generator {
     char *path;
   } source;
   char *export_macro;
+  bool marshal;
 };
 
 int print_type(char *str, size_t len, const void *ptr, void *user_data);
@@ -0,0 +1,542 @@
+/*
+ * Copyright(c) 2021 ADLINK Technology Limited and others
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v. 2.0 which is available at
+ * http://www.eclipse.org/legal/epl-2.0, or the Eclipse Distribution License
+ * v. 1.0 which is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ * SPDX-License-Identifier: EPL-2.0 OR BSD-3-Clause
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "idl/print.h"
+#include "idl/processor.h"
+#include "idl/stream.h"
+#include "idl/string.h"
+
+#include "generator.h"
+#include "descriptor.h"
+#include "dds/ddsc/dds_opcodes.h"
+
+/* Straight-line (de)serializers for fixed-layout types (-f marshal).
+
+   The functions are derived from the instructions of the descriptor rather
+   than from the syntax tree, so that they cannot disagree with the op-code
+   interpreter in ddsi_cdrstream.c about the serialized form. Only final types
+   consisting of primitive members, arrays of primitives, nested structs and
+   arrays of nested structs are supported. For those, the position of every
+   member in the serialized data follows from the position the data starts at
+   modulo 8, and the generated code reduces to copies at constant offsets.
+   Arrays of structs become a loop as soon as the elements have the same
+   layout. */
+
+enum marshal_mode { MARSHAL_WRITE, MARSHAL_READ };
+
+struct marshal_key {
+  uint32_t n_ops;
+  uint32_t ops[MAX_KEY_OFFS]; /**< instruction index of key (path) in each type */
+  uint32_t leaf;              /**< opcode of key field */
+  uint32_t count;             /**< number of elements if key field is an array, 0 otherwise */
+  char *sample;               /**< expression for address of key field in sample */
+  uint32_t pos;               /**< position of key field in serialized sample */
+  bool found;
+};
+
+struct marshal {
+  const struct descriptor *descriptor;
+  FILE *fp;                   /**< NULL if only computing layout */
+  enum marshal_mode mode;
+  bool xcdr2;
+  uint32_t pos;               /**< position in serialized data */
+  uint32_t depth;             /**< loop nesting level */
+  uint32_t in_array;          /**< keys can't be in arrays, no need to track */
+  uint32_t n_path;
+  uint32_t path[MAX_KEY_OFFS];
+  uint32_t n_keys;
+  struct marshal_key *keys;
+};
+
+static uint32_t align_of(bool xcdr2, uint32_t size)
+{
+  return (xcdr2 && size == 8) ? 4 : size;
+}
+
+static uint32_t prim_size(uint32_t typecode)
+{
+  switch (typecode) {
+    case DDS_OP_VAL_1BY: return 1;
+    case DDS_OP_VAL_2BY: return 2;
+    case DDS_OP_VAL_4BY: return 4;
+    case DDS_OP_VAL_8BY: return 8;
+    default: return 0;
+  }
+}
+
+static bool is_fixed_layout_op(const struct descriptor *descriptor, const struct instructions *instructions, uint32_t *op)
+{
+  const struct instruction *inst = &instructions->table[*op];
+  const uint32_t code = inst->data.opcode.code;
+  if (inst->type != OPCODE || DDS_OP(code) != DDS_OP_ADR)
+    return false;
+  if (code & (DDS_OP_FLAG_EXT | DDS_OP_FLAG_OPT | DDS_OP_FLAG_BASE))
+    return false;
+  switch (DDS_OP_TYPE(code)) {
+    case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY:
+      *op += 2;
+      return true;
+    case DDS_OP_VAL_EXT:
+      *op += 3;
+      return true;
+    case DDS_OP_VAL_ARR:
+      if (prim_size(DDS_OP_SUBTYPE(code))) {
+        *op += 3;
+        return true;
+      } else if (DDS_OP_SUBTYPE(code) == DDS_OP_VAL_STU) {
+        assert(instructions->table[*op + 3].type == ELEM_OFFSET);
+        if (!find_ctype(descriptor, instructions->table[*op + 3].data.inst_offset.node))
+          return false;
+        *op += 5;
+        return true;
+      }
+      return false;
+    default:
+      return false;
+  }
+}
+
+static bool is_fixed_layout(const struct descriptor *descriptor)
+{
+  if (!idl_is_struct(descriptor->topic))
+    return false;
+  for (const struct constructed_type *ctype = descriptor->constructed_types; ctype; ctype = ctype->next) {
+    if (!idl_is_struct(ctype->node))
+      return false;
+    for (uint32_t op = 0; op < ctype->instructions.count; ) {
+      const struct instruction *inst = &ctype->instructions.table[op];
+      if (inst->type == OPCODE && DDS_OP(inst->data.opcode.code) == DDS_OP_RTS)
+        break;
+      if (!is_fixed_layout_op(descriptor, &ctype->instructions, &op))
+        return false;
+    }
+  }
+  return true;
+}
+
+static char *offset_expr(const struct instruction *inst)
+{
+  char *str = NULL;
+  assert(inst->type == OFFSET);
+  if (!inst->data.offset.type)
+    return idl_strdup("0");
+  if (idl_asprintf(&str, "offsetof (%s, %s)", inst->data.offset.type, inst->data.offset.member) < 0)
+    return NULL;
+  return str;
+}
+
+static const char *indent(const struct marshal *m)
+{
+  static const char spaces[] = "                                ";
+  uint32_t n = 2 + 2 * m->depth;
+  return spaces + (sizeof(spaces) - 1 - (n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1));
+}
+
+static int emit_align(struct marshal *m, uint32_t align, const char *cdr, uint32_t cdr_pos)
+{
+  const uint32_t pad = (align - m->pos % align) % align;
+  if (pad && m->fp && m->mode == MARSHAL_WRITE) {
+    const char *fmt = "%smemset (%s + %"PRIu32"u, 0, %"PRIu32"u);\n";
+    if (idl_fprintf(m->fp, fmt, indent(m), cdr, m->pos - cdr_pos, pad) < 0)
+      return -1;
+  }
+  m->pos += pad;
+  return 0;
+}
+
+static int emit_copy(struct marshal *m, const char *sample, const char *cdr, uint32_t cdr_pos, uint32_t size)
+{
+  if (m->fp) {
+    const char *fmt = (m->mode == MARSHAL_WRITE)
+      ? "%1$smemcpy (%3$s + %4$"PRIu32"u, %2$s, %5$"PRIu32"u);\n"
+      : "%1$smemcpy (%2$s, %3$s + %4$"PRIu32"u, %5$"PRIu32"u);\n";
+    if (idl_fprintf(m->fp, fmt, indent(m), sample, cdr, m->pos - cdr_pos, size) < 0)
+      return -1;
+  }
+  m->pos += size;
+  return 0;
+}
+
+static void record_key(struct marshal *m)
+{
+  if (m->in_array)
+    return;
+  for (uint32_t k = 0; k < m->n_keys; k++) {
+    struct marshal_key *key = &m->keys[k];
+    if (key->n_ops == m->n_path && memcmp(key->ops, m->path, m->n_path * sizeof(*m->path)) == 0) {
+      key->pos = m->pos;
+      key->found = true;
+    }
+  }
+}
+
+static int emit_ctype(struct marshal *m, const struct constructed_type *ctype, const char *sample, const char *cdr, uint32_t cdr_pos);
+
+static uint32_t layout_end(const struct marshal *m, const struct constructed_type *ctype, uint32_t pos)
+{
+  struct marshal m1 = *m;
+  m1.fp = NULL;
+  m1.pos = pos;
+  m1.in_array++;
+  (void)emit_ctype(&m1, ctype, "", "", pos);
+  return m1.pos;
+}
+
+static int emit_struct_array(struct marshal *m, const struct constructed_type *ctype, uint32_t op, const char *member, const char *cdr, uint32_t cdr_pos)
+{
+  const struct instruction *table = ctype->instructions.table;
+  const struct constructed_type *elem = find_ctype(m->descriptor, table[op + 3].data.inst_offset.node);
+  const uint32_t count = table[op + 2].data.single;
+  const char *elem_type = table[op + 4].data.size.type;
+  uint32_t hdr_pos = 0, first, stride = 0;
+  char *sample1 = NULL, *cdr1 = NULL;
+  int ret = -1;
+
+  assert(elem);
+  if (m->xcdr2) {
+    /* arrays of non-primitive types have a DHEADER in XCDR2 */
+    if (emit_align(m, 4, cdr, cdr_pos) < 0)
+      return -1;
+    hdr_pos = m->pos;
+    m->pos += 4;
+  }
+
+  /* the layout of an element depends only on its position modulo the maximum
+     alignment, once two consecutive elements start at the same position all
+     remaining elements are the same */
+  {
+    const uint32_t mod = m->xcdr2 ? 4 : 8;
+    const uint32_t p0 = m->pos, p1 = layout_end(m, elem, p0);
+    const uint32_t p2 = layout_end(m, elem, p1);
+    if (count == 1) {
+      first = 1;
+    } else if (p0 % mod == p1 % mod) {
+      first = 0; stride = p1 - p0;
+    } else if (p1 % mod == p2 % mod) {
+      first = 1; stride = p2 - p1;
+    } else {
+      first = count;
+    }
+  }
+
+  m->in_array++;
+  for (uint32_t i = 0; i < first && i < count; i++) {
+    if (idl_asprintf(&sample1, "%s + %"PRIu32"u * sizeof (%s)", member, i, elem_type) < 0)
+      goto err;
+    if (emit_ctype(m, elem, sample1, cdr, cdr_pos) < 0)
+      goto err;
+    free(sample1);
+    sample1 = NULL;
+  }
+  if (first < count) {
+    const uint32_t loop_pos = m->pos;
+    const char *fmt;
+    if (idl_asprintf(&sample1, "%s + i%"PRIu32" * sizeof (%s)", member, m->depth, elem_type) < 0)
+      goto err;
+    if (first == 0)
+      fmt = "%1$s + %2$"PRIu32"u + i%3$"PRIu32" * %5$"PRIu32"u";
+    else
+      fmt = "%1$s + %2$"PRIu32"u + (i%3$"PRIu32" - %4$"PRIu32"u) * %5$"PRIu32"u";
+    if (idl_asprintf(&cdr1, fmt, cdr, loop_pos - cdr_pos, m->depth, first, stride) < 0)
+      goto err;
+    fmt = "%1$sfor (uint32_t i%2$"PRIu32" = %3$"PRIu32"u; i%2$"PRIu32" < %4$"PRIu32"u; i%2$"PRIu32"++)\n"
+          "%1$s{\n";
+    if (m->fp && idl_fprintf(m->fp, fmt, indent(m), m->depth, first, count) < 0)
+      goto err;
+    m->depth++;
+    if (emit_ctype(m, elem, sample1, cdr1, loop_pos) < 0)
+      goto err;
+    m->depth--;
+    if (m->fp && idl_fprintf(m->fp, "%s}\n", indent(m)) < 0)
+      goto err;
+    m->pos = loop_pos + (count - first) * stride;
+  }
+  m->in_array--;
+
+  if (m->xcdr2 && m->fp && m->mode == MARSHAL_WRITE) {
+    const char *fmt = "%smemcpy (%s + %"PRIu32"u, &(uint32_t){ %"PRIu32"u }, 4u);\n";
+    if (idl_fprintf(m->fp, fmt, indent(m), cdr, hdr_pos - cdr_pos, m->pos - (hdr_pos + 4)) < 0)
+      goto err;
+  }
+  ret = 0;
+err:
+  free(sample1);
+  free(cdr1);
+  return ret;
+}
+
+static int emit_ctype(struct marshal *m, const struct constructed_type *ctype, const char *sample, const char *cdr, uint32_t cdr_pos)
+{
+  const struct instruction *table = ctype->instructions.table;
+  char *offset = NULL, *member = NULL;
+  int ret = -1;
+
+  for (uint32_t op = 0, next; op < ctype->instructions.count; op = next) {
+    const uint32_t code = table[op].data.opcode.code;
+    assert(table[op].type == OPCODE);
+    if (DDS_OP(code) == DDS_OP_RTS)
+      break;
+    next = op;
+    (void)is_fixed_layout_op(m->descriptor, &ctype->instructions, &next);
+    if (!(offset = offset_expr(&table[op + 1])))
+      goto err;
+    if (idl_asprintf(&member, "%s + %s", sample, offset) < 0)
+      goto err;
+    assert(m->n_path < MAX_KEY_OFFS);
+    m->path[m->n_path++] = op;
+    switch (DDS_OP_TYPE(code)) {
+      case DDS_OP_VAL_1BY: case DDS_OP_VAL_2BY: case DDS_OP_VAL_4BY: case DDS_OP_VAL_8BY: {
+        const uint32_t size = prim_size(DDS_OP_TYPE(code));
+        if (emit_align(m, align_of(m->xcdr2, size), cdr, cdr_pos) < 0)
+          goto err;
+        record_key(m);
+        if (emit_copy(m, member, cdr, cdr_pos, size) < 0)
+          goto err;
+        break;
+      }
+      case DDS_OP_VAL_ARR:
+        if (DDS_OP_SUBTYPE(code) == DDS_OP_VAL_STU) {
+          if (emit_struct_array(m, ctype, op, member, cdr, cdr_pos) < 0)
+            goto err;
+        } else {
+          const uint32_t size = prim_size(DDS_OP_SUBTYPE(code));
+          if (emit_align(m, align_of(m->xcdr2, size), cdr, cdr_pos) < 0)
+            goto err;
+          record_key(m);
+          if (emit_copy(m, member, cdr, cdr_pos, size * table[op + 2].data.single) < 0)
+            goto err;
+        }
+        break;
+      case DDS_OP_VAL_EXT: {
+        const struct constructed_type *ext = find_ctype(m->descriptor, table[op + 2].data.inst_offset.node);
+        assert(ext);
+        if (emit_ctype(m, ext, member, cdr, cdr_pos) < 0)
+          goto err;
+        break;
+      }
+      default:
+        abort();
+    }
+    m->n_path--;
+    free(offset);
+    offset = NULL;
+    free(member);
+    member = NULL;
+  }
+  ret = 0;
+err:
+  free(offset);
+  free(member);
+  return ret;
+}
+
+static const struct constructed_type *ctype_at(const struct descriptor *descriptor, uint32_t offs)
+{
+  for (const struct constructed_type *ctype = descriptor->constructed_types; ctype; ctype = ctype->next) {
+    if (offs >= ctype->offset && offs < ctype->offset + ctype->instructions.count)
+      return ctype;
+  }
+  return NULL;
+}
+
+/* resolve the key offset lists in the order in which the keys are serialized
+   (i.e. the order of the key descriptors), the first offset is relative to the
+   start of the ops, the others relative to the start of the nested type */
+static int init_keys(const struct descriptor *descriptor, struct marshal_key *keys)
+{
+  struct key_print_meta *meta;
+
+  if (!(meta = key_print_meta_init((struct descriptor *)descriptor)))
+    return -1;
+  for (uint32_t k = 0; k < descriptor->n_keys; k++) {
+    const struct instruction *kof = &descriptor->key_offsets.table[meta[k].inst_offs];
+    const struct constructed_type *ctype = NULL;
+    char *sample = idl_strdup("s"), *sample1;
+    assert(kof->type == KEY_OFFSET);
+    keys[k].n_ops = kof->data.key_offset.len;
+    for (uint32_t i = 0; i < keys[k].n_ops && sample; i++) {
+      const struct instruction *inst;
+      uint32_t offs = kof[1 + i].data.key_offset_val.offs;
+      if (i == 0) {
+        ctype = ctype_at(descriptor, offs);
+        assert(ctype);
+        offs -= ctype->offset;
+      }
+      keys[k].ops[i] = offs;
+      inst = &ctype->instructions.table[offs];
+      keys[k].leaf = inst->data.opcode.code;
+      keys[k].count = (DDS_OP_TYPE(keys[k].leaf) == DDS_OP_VAL_ARR) ? inst[2].data.single : 0;
+      if (!(sample1 = offset_expr(inst + 1)) || idl_asprintf(&keys[k].sample, "%s + %s", sample, sample1) < 0)
+        keys[k].sample = NULL;
+      free(sample);
+      free(sample1);
+      sample = keys[k].sample;
+      if (DDS_OP_TYPE(inst->data.opcode.code) == DDS_OP_VAL_EXT)
+        ctype = find_ctype(descriptor, inst[2].data.inst_offset.node);
+    }
+    if (!sample) {
+      key_print_meta_free(meta, descriptor->n_keys);
+      return -1;
+    }
+  }
+  key_print_meta_free(meta, descriptor->n_keys);
+  return 0;
+}
+
+/* layout of the keys mirrors dds_stream_write_key: arrays are aligned to the
+   element size regardless of the XCDR version */
+static int emit_keys(FILE *fp, const struct descriptor *descriptor, const struct marshal_key *keys, bool xcdr2, bool from_sample, uint32_t *keysize)
+{
+  uint32_t pos = 0;
+  for (uint32_t k = 0; k < descriptor->n_keys; k++) {
+    const struct marshal_key *key = &keys[k];
+    const uint32_t size = prim_size(key->count ? DDS_OP_SUBTYPE(key->leaf) : DDS_OP_TYPE(key->leaf));
+    const uint32_t align = key->count ? size : align_of(xcdr2, size);
+    const uint32_t pad = (align - pos % align) % align;
+    if (pad && idl_fprintf(fp, "  memset (dst + %"PRIu32"u, 0, %"PRIu32"u);\n", pos, pad) < 0)
+      return -1;
+    pos += pad;
+    if (from_sample && idl_fprintf(fp, "  memcpy (dst + %"PRIu32"u, %s, %"PRIu32"u);\n", pos, key->sample, size * (key->count ? key->count : 1)) < 0)
+      return -1;
+    if (!from_sample && idl_fprintf(fp, "  memcpy (dst + %"PRIu32"u, src + %"PRIu32"u, %"PRIu32"u);\n", pos, key->pos, size * (key->count ? key->count : 1)) < 0)
+      return -1;
+    pos += size * (key->count ? key->count : 1);
+  }
+  if (keysize)
+    *keysize = pos;
+  return 0;
+}
+
+static int print_marshal_xcdr(FILE *fp, const struct descriptor *descriptor, struct marshal_key *keys, const char *type, uint32_t xcdrv, uint32_t *size, uint32_t *keysize)
+{
+  struct marshal m;
+  const char *fmt;
+
+  memset(&m, 0, sizeof(m));
+  m.descriptor = descriptor;
+  m.xcdr2 = (xcdrv == 2);
+  m.n_keys = descriptor->n_keys;
+  m.keys = keys;
+  for (uint32_t k = 0; k < m.n_keys; k++)
+    keys[k].found = false;
+
+  /* layout only, for the size and the positions of the keys */
+  if (emit_ctype(&m, descriptor->constructed_types, "s", "dst", 0) < 0)
+    return -1;
+  *size = m.pos;
+  for (uint32_t k = 0; k < m.n_keys; k++)
+    if (!keys[k].found)
+      return -1;
+
+  fmt = "static void %1$s_marshal_write_xcdr%2$"PRIu32" (unsigned char *dst, const void *sample)\n"
+        "{\n"
+        "  const char *s = (const char *) sample;\n";
+  if (idl_fprintf(fp, fmt, type, xcdrv) < 0)
+    return -1;
+  m.fp = fp;
+  m.pos = 0;
+  m.mode = MARSHAL_WRITE;
+  if (emit_ctype(&m, descriptor->constructed_types, "s", "dst", 0) < 0)
+    return -1;
+  fmt = "}\n\n"
+        "static void %1$s_marshal_read_xcdr%2$"PRIu32" (void *sample, const unsigned char *src)\n"
+        "{\n"
+        "  char *s = (char *) sample;\n";
+  if (idl_fprintf(fp, fmt, type, xcdrv) < 0)
+    return -1;
+  m.pos = 0;
+  m.mode = MARSHAL_READ;
+  if (emit_ctype(&m, descriptor->constructed_types, "s", "src", 0) < 0)
+    return -1;
+  if (fputs("}\n\n", fp) < 0)
+    return -1;
+
+  if (descriptor->n_keys == 0) {
+    *keysize = 0;
+    return 0;
+  }
+  fmt = "static void %1$s_marshal_write_key_xcdr%2$"PRIu32" (unsigned char *dst, const void *sample)\n"
+        "{\n"
+        "  const char *s = (const char *) sample;\n";
+  if (idl_fprintf(fp, fmt, type, xcdrv) < 0)
+    return -1;
+  if (emit_keys(fp, descriptor, keys, m.xcdr2, true, keysize) < 0)
+    return -1;
+  fmt = "}\n\n"
+        "static void %1$s_marshal_extract_key_xcdr%2$"PRIu32" (unsigned char *dst, const unsigned char *src)\n"
+        "{\n";
+  if (idl_fprintf(fp, fmt, type, xcdrv) < 0)
+    return -1;
+  if (emit_keys(fp, descriptor, keys, true, false, NULL) < 0)
+    return -1;
+  if (fputs("}\n\n", fp) < 0)
+    return -1;
+  return 0;
+}
+
+idl_retcode_t
+generate_marshal(
+  const idl_pstate_t *pstate,
+  struct generator *generator,
+  struct descriptor *descriptor)
+{
+  struct marshal_key *keys = NULL;
+  uint32_t size[2], keysize[2];
+  char *type;
+  const char *fmt;
+  idl_retcode_t ret = IDL_RETCODE_NO_MEMORY;
+  FILE *fp = generator->source.handle;
+
+  (void)pstate;
+  if (!is_fixed_layout(descriptor))
+    return IDL_RETCODE_OK;
+  if (IDL_PRINTA(&type, print_type, descriptor->topic) < 0)
+    return IDL_RETCODE_NO_MEMORY;
+  if (descriptor->n_keys && !(keys = calloc(descriptor->n_keys, sizeof(*keys))))
+    return IDL_RETCODE_NO_MEMORY;
+  if (descriptor->n_keys && init_keys(descriptor, keys) < 0)
+    goto err;
+  for (uint32_t v = 1; v <= 2; v++)
+    if (print_marshal_xcdr(fp, descriptor, keys, type, v, &size[v - 1], &keysize[v - 1]) < 0)
+      goto err;
+
+  fmt = "static const dds_topic_marshal_t %1$s_marshal =\n{\n";
+  if (idl_fprintf(fp, fmt, type) < 0)
+    goto err;
+  for (uint32_t v = 1; v <= 2; v++) {
+    if (descriptor->n_keys)
+      fmt = "  .m_xcdr%2$"PRIu32" = { %3$"PRIu32"u, %4$"PRIu32"u, %1$s_marshal_write_xcdr%2$"PRIu32", %1$s_marshal_read_xcdr%2$"PRIu32", "
+            "%1$s_marshal_write_key_xcdr%2$"PRIu32", %1$s_marshal_extract_key_xcdr%2$"PRIu32" }%5$s\n";
+    else
+      fmt = "  .m_xcdr%2$"PRIu32" = { %3$"PRIu32"u, %4$"PRIu32"u, %1$s_marshal_write_xcdr%2$"PRIu32", %1$s_marshal_read_xcdr%2$"PRIu32", 0, 0 }%5$s\n";
+    if (idl_fprintf(fp, fmt, type, v, size[v - 1], keysize[v - 1], v == 1 ? "," : "") < 0)
+      goto err;
+  }
+  if (fputs("};\n\n", fp) < 0)
+    goto err;
+  descriptor->flags |= DDS_TOPIC_MARSHAL;
+  ret = IDL_RETCODE_OK;
+
+err:
+  if (keys) {
+    for (uint32_t k = 0; k < descriptor->n_keys; k++)
+      free(keys[k].sample);
+    free(keys);
+  }
+  return ret;
+}